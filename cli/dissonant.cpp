@@ -1,18 +1,20 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Dec 24 15:39:34 PST 2016
-// Last Modified: Sat Dec 24 15:39:38 PST 2016
+// Last Modified: Sun Oct 18 09:17:07 UTC 2026
 // Filename:      dissonant.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/cli/dissonant.cpp
 // Syntax:        C++11
 // vim:           ts=3 noexpandtab nowrap
 //
-// Description:   Add beams to Humdrum file(s).
+// Description:   Identify and label dissonances in Humdrum file(s).
+//                With --batch, print a single table of dissonance
+//                counts for all input files.
 //
 
 #include "humlib.h"
 
-STREAM_INTERFACE(Tool_dissonant)
+STREAM_BATCH_INTERFACE(Tool_dissonant)
 
 
 
@@ -0,0 +1,117 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 03:10:17 UTC 2026
+// Last Modified: Sun Oct 18 03:10:17 UTC 2026
+// Filename:      humbin.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/cli/humbin.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab nowrap
+//
+// Description:   Convert Humdrum files into the pre-analyzed binary
+//                format read by HumdrumFileBase::readBinary(), or
+//                convert binary files back into Humdrum text.
+//
+//                Examples:
+//                   humbin file.krn -o file.hbin    (one file)
+//                   humbin *.krn                    (write *.krn.hbin)
+//                   humbin -d file.hbin             (print as text)
+//
+
+#include "humlib.h"
+
+using namespace std;
+using namespace hum;
+
+bool   encodeFile   (const string& input, const string& output, bool strandQ);
+bool   decodeFile   (const string& input);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("d|decode=b",      "print binary files as Humdrum text");
+	options.define("o|output=s",      "output filename (for one input file)");
+	options.define("x|extension=s:.hbin", "extension added to output filenames");
+	options.define("S|no-strands=b",  "do not store strand analysis");
+	options.process(argc, argv);
+
+	bool decodeQ = options.getBoolean("decode");
+	bool strandQ = !options.getBoolean("no-strands");
+	string extension = options.getString("extension");
+	int count = options.getArgCount();
+
+	int status = 0;
+	if (decodeQ) {
+		if (count == 0) {
+			status |= !decodeFile("");
+		}
+		for (int i=1; i<=count; i++) {
+			status |= !decodeFile(options.getArg(i));
+		}
+		return status;
+	}
+
+	if (count == 0) {
+		string output = options.getBoolean("output") ? options.getString("output") : "";
+		return !encodeFile("", output, strandQ);
+	}
+	if ((count == 1) && options.getBoolean("output")) {
+		return !encodeFile(options.getArg(1), options.getString("output"), strandQ);
+	}
+	for (int i=1; i<=count; i++) {
+		string input = options.getArg(i);
+		status |= !encodeFile(input, input + extension, strandQ);
+	}
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// encodeFile -- Read a Humdrum file and store it in the binary format.
+//     An empty filename means standard input or output.
+//
+
+bool encodeFile(const string& input, const string& output, bool strandQ) {
+	HumdrumFile infile;
+	if (input.empty()) {
+		infile.read(cin);
+	} else {
+		infile.read(input);
+		infile.setFilename(input);
+	}
+	if (!infile.isValid()) {
+		cerr << "Error reading " << input << ": " << infile.getParseError() << endl;
+		return false;
+	}
+	if (strandQ) {
+		infile.analyzeStrands();
+	}
+	if (!infile.writeBinary(output)) {
+		cerr << "Error writing " << output << endl;
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// decodeFile -- Print a binary file as Humdrum text.
+//
+
+bool decodeFile(const string& input) {
+	HumdrumFile infile;
+	if (!infile.readBinary(input)) {
+		cerr << "Error reading " << input << ": " << infile.getParseError() << endl;
+		return false;
+	}
+	cout << infile;
+	return true;
+}
+
+
+
@@ -0,0 +1,87 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 03:21:32 UTC 2026
+// Last Modified: Sun Oct 18 03:21:32 UTC 2026
+// Filename:      msindex.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/cli/msindex.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab nowrap
+//
+// Description:   Build an n-gram index of a corpus of Humdrum files, or
+//                search the files in an index with the same music query
+//                options as msearch.  Each match is printed as the
+//                filename, line number and field number of the first
+//                note of the match.
+//
+//                Examples:
+//                   msindex -b corpus.msidx *.krn     (build an index)
+//                   ls *.krn | msindex -b corpus.msidx
+//                   msindex -p cdefg corpus.msidx     (search an index)
+//
+
+#include "humlib.h"
+
+using namespace std;
+using namespace hum;
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Tool_msearch interface;
+	interface.define("b|build=s", "build an index of the input files");
+	if (!interface.process(argc, argv)) {
+		interface.getError(cerr);
+		return -1;
+	}
+
+	MSearchIndex index;
+	int count = interface.getArgCount();
+
+	if (interface.getBoolean("build")) {
+		// Read the list of files from standard input if none are given
+		// on the command line (for corpora too large for the command line).
+		vector<string> filenames;
+		for (int i=1; i<=count; i++) {
+			filenames.push_back(interface.getArg(i));
+		}
+		string line;
+		if (filenames.empty()) {
+			while (getline(cin, line)) {
+				if (!line.empty()) {
+					filenames.push_back(line);
+				}
+			}
+		}
+		for (int i=0; i<(int)filenames.size(); i++) {
+			const string& filename = filenames[i];
+			HumdrumFile infile;
+			if (!infile.read(filename)) {
+				cerr << "Warning: cannot read " << filename << endl;
+				continue;
+			}
+			index.addFile(infile, filename);
+		}
+		if (!index.write(interface.getString("build"))) {
+			cerr << "Error: cannot write " << interface.getString("build") << endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	if (count != 1) {
+		cerr << "Usage: " << interface.getCommand() << " [query options] index-file" << endl;
+		return 1;
+	}
+	if (!index.read(interface.getArg(1))) {
+		cerr << "Error: cannot read index " << interface.getArg(1) << endl;
+		return 1;
+	}
+	if (!interface.searchIndex(index, cout)) {
+		cerr << "Error: no music query given" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+
+
@@ -1,14 +1,16 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  6 10:53:40 CEST 2016
-// Last Modified: Sun Sep 18 13:11:26 PDT 2016
+// Last Modified: Sun Oct 18 07:24:54 UTC 2026
 // Filename:      musicxml2hum.cpp
 // URL:           https://github.com/craigsapp/musicxml2hum/blob/master/src/musicxml2hum.cpp
 // Syntax:        C++11
 // vim:           ts=3 noexpandtab
 //
 // Description:   Command-line interface for converting MusicXML files into
-//                Humdrum files.
+//                Humdrum files.  With --batch, convert all input files
+//                (or directories of MusicXML files).  With --stream,
+//                read partwise files one measure at a time.
 //
 
 #include "humlib.h"
@@ -26,19 +28,39 @@ int main(int argc, char** argv) {
 	// hum::Options options(converter.getOptionDefinitions());
 	// options.process(argc, argv);
 
+	if (converter.getBoolean("batch")) {
+		vector<string> filenames;
+		for (int i=1; i<=converter.getArgCount(); i++) {
+			filenames.push_back(converter.getArg(i));
+		}
+		bool status = converter.convertFiles(cout, filenames);
+		if (converter.hasError()) {
+			converter.getError(cerr);
+		}
+		return !status;
+	}
+
 	pugi::xml_document infile;
 	string filename;
+	stringstream out;
+	bool status;
 	if (converter.getArgCount() == 0) {
 		filename = "<STDIN>";
 		infile.load(cin);
+		status = converter.convert(out, infile);
+	} else if (converter.getBoolean("stream")) {
+		filename = converter.getArg(1);
+		status = converter.convertFile(out, filename.c_str());
 	} else {
 		filename = converter.getArg(1);
 		infile.load_file(filename.c_str());
+		status = converter.convert(out, infile);
 	}
 
 	//converter.setOptions(argc, argv);
-	stringstream out;
-	bool status = converter.convert(out, infile);
+	if (converter.hasError()) {
+		converter.getError(cerr);
+	}
 	if (!status) {
 		cerr << "Error converting file: " << filename << endl;
 	}
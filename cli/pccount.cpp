@@ -1,18 +1,20 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Sep  7 21:16:17 PDT 2019
-// Last Modified: Sat Sep  7 21:16:19 PDT 2019
+// Last Modified: Sun Oct 18 09:17:07 UTC 2026
 // Filename:      pccount.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/cli/pccount.cpp
 // Syntax:        C++11
 // vim:           ts=3 noexpandtab nowrap
 //
 // Description:   Count pitch-classes by voice and all voices.
+//                With --csv or --binary, print pitch-class profiles
+//                for all input files and the corpus totals.
 //
 
 #include "humlib.h"
 
-STREAM_INTERFACE(Tool_pccount)
+STREAM_BATCH_INTERFACE(Tool_pccount)
 
 
 
@@ -0,0 +1,122 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 06:08:53 UTC 2026
+// Last Modified: Sun Oct 18 06:08:53 UTC 2026
+// Filename:      CompactNoteGrid.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/CompactNoteGrid.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Struct-of-arrays version of NoteGrid.  Pitches are stored
+//                in contiguous 16-bit columns (one column per voice),
+//                and the current/previous/next attack indexes are
+//                calculated once when the grid is loaded.  A HumdrumFile
+//                keeps one of these grids as a cached analysis (see
+//                HumdrumFileBase::getCompactNoteGrid()), which NoteGrid
+//                and tools then read from rather than parsing the notes
+//                of the score again.
+//
+
+#ifndef _COMPACTNOTEGRID_H_INCLUDED
+#define _COMPACTNOTEGRID_H_INCLUDED
+
+#include "HumNum.h"
+#include "HumdrumToken.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class HumdrumFileBase;
+
+class CompactNoteGrid {
+	public:
+		enum { REST = INT16_MIN };
+
+		                CompactNoteGrid       (void);
+		                CompactNoteGrid       (HumdrumFileBase& infile);
+		               ~CompactNoteGrid       ();
+
+		void            clear                 (void);
+		bool            load                  (HumdrumFileBase& infile);
+		bool            isValid               (void) const { return m_valid; }
+
+		int             getVoiceCount         (void) const { return m_voices; }
+		int             getSliceCount         (void) const { return m_slices; }
+
+		// Signed pitch values: REST for rests, negative for sustains.
+		const int16_t*  getDiatonicColumn     (int vindex) const;
+		const int16_t*  getMidiColumn         (int vindex) const;
+		const int16_t*  getBase40Column       (int vindex) const;
+		const int16_t*  getAccidentalColumn   (int vindex) const;
+		int             getSgnDiatonicPitch   (int vindex, int sindex) const
+		                                          { return m_b7[index(vindex, sindex)]; }
+		int             getSgnMidiPitch       (int vindex, int sindex) const
+		                                          { return m_b12[index(vindex, sindex)]; }
+		int             getSgnBase40Pitch     (int vindex, int sindex) const
+		                                          { return m_b40[index(vindex, sindex)]; }
+		int             getSgnAccidental      (int vindex, int sindex) const
+		                                          { return m_accidental[index(vindex, sindex)]; }
+
+		bool            isRest                (int vindex, int sindex) const
+		                                          { return m_b40[index(vindex, sindex)] == REST; }
+		bool            isAttack              (int vindex, int sindex) const;
+		bool            isSustained           (int vindex, int sindex) const;
+
+		int             getCurrAttackIndex    (int vindex, int sindex) const
+		                                          { return m_currattack[index(vindex, sindex)]; }
+		int             getPrevAttackIndex    (int vindex, int sindex) const
+		                                          { return m_prevattack[index(vindex, sindex)]; }
+		int             getNextAttackIndex    (int vindex, int sindex) const
+		                                          { return m_nextattack[index(vindex, sindex)]; }
+
+		HTp             getToken              (int vindex, int sindex) const
+		                                          { return m_tokens[index(vindex, sindex)]; }
+		int             getLineIndex          (int sindex) const { return m_lines.at(sindex); }
+		int             getMeterTop           (int vindex, int sindex) const;
+		HumNum          getMeterBottom        (int vindex, int sindex) const;
+		const std::vector<HTp>& getKernSpineStarts(void) const { return m_kernspines; }
+
+		size_t          getMemoryUsage        (void) const;
+
+	protected:
+		int             index                 (int vindex, int sindex) const
+		                                          { return vindex * m_slices + sindex; }
+		void            storePitch            (int cell, HTp token);
+		void            buildAttackIndex      (int vindex);
+
+	private:
+		bool                 m_valid  = false;
+		int                  m_voices = 0;
+		int                  m_slices = 0;
+
+		// Cell columns, stored voice by voice: the cell for a voice and
+		// slice is at index vindex * m_slices + sindex.
+		std::vector<int16_t> m_b7;          // diatonic note number
+		std::vector<int16_t> m_b12;         // MIDI note number
+		std::vector<int16_t> m_b40;         // base-40 note number
+		std::vector<int16_t> m_accidental;  // chromatic alteration
+		std::vector<int16_t> m_meter;       // index into m_meters
+		std::vector<int>     m_currattack;  // slice of the current attack
+		std::vector<int>     m_prevattack;  // slice of previous attack, or -1
+		std::vector<int>     m_nextattack;  // slice of next attack, or -1
+		std::vector<HTp>     m_tokens;      // primary-layer token for cell
+
+		std::vector<int>     m_lines;       // line index for each slice
+		std::vector<HTp>     m_kernspines;  // voice starting tokens
+		std::vector<std::pair<int, HumNum>> m_meters; // distinct time signatures
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _COMPACTNOTEGRID_H_INCLUDED */
+
+
+
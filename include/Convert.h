@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Sun Aug  9 21:03:12 PDT 2015
+// Last Modified: Sun Oct 18 09:29:43 UTC 2026
 // Filename:      Convert.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/Convert.h
 // Syntax:        C++11; humlib
@@ -13,8 +13,10 @@
 #ifndef _CONVERT_H_INCLUDED
 #define _CONVERT_H_INCLUDED
 
-#include <vector>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "HumNum.h"
 #include "HumdrumToken.h"
@@ -23,6 +25,28 @@ namespace hum {
 
 // START_MERGE
 
+// KernDecoding: pitch and rhythm information extracted from a **kern
+// token by Convert::decodeKern().  Only the first subtoken of a chord
+// is described.
+class KernDecoding {
+	public:
+		int    base7;        // Convert::kernToBase7()
+		int    base12;       // Convert::kernToBase12()
+		int    base40;       // Convert::kernToBase40()
+		int    octave;       // Convert::kernToOctaveNumber()
+		HumNum duration;     // Convert::recipToDuration() in quarter notes
+		short  accidentals;  // Convert::kernToAccidentalCount()
+		short  dots;         // number of augmentation dots
+		bool   rest;         // "r"
+		bool   grace;        // "q" or "Q"
+		bool   tieStart;     // "["
+		bool   tieContinue;  // "_"
+		bool   tieEnd;       // "]"
+		bool   slurStart;    // "("
+		bool   slurEnd;      // ")"
+};
+
+
 class Convert {
 	public:
 
@@ -33,6 +57,9 @@ class Convert {
 		static HumNum  recipToDuration      (std::string* recip,
 		                                     HumNum scale = 4,
 		                                     const std::string& separator = " ");
+		static HumNum  recipToDurationUncached(const std::string& recip,
+		                                     HumNum scale = 4,
+		                                     const std::string& separator = " ");
 		static HumNum  recipToDurationIgnoreGrace(const std::string& recip,
 		                                     HumNum scale = 4,
 		                                     const std::string& separator = " ");
@@ -92,13 +119,13 @@ class Convert {
 				{ return kernToBase7PC        ((std::string)*token); }
 		static int     kernToBase40         (const std::string& kerndata);
 		static int     kernToBase40         (HTp token)
-				{ return kernToBase40         ((std::string)*token); }
+				{ return kernToBase40         (*token); }
 		static int     kernToBase12         (const std::string& kerndata);
 		static int     kernToBase12         (HTp token)
-				{ return kernToBase12         ((std::string)*token); }
+				{ return kernToBase12         (*token); }
 		static int     kernToBase7          (const std::string& kerndata);
 		static int     kernToBase7          (HTp token)
-				{ return kernToBase7          ((std::string)*token); }
+				{ return kernToBase7          (*token); }
 		static std::string  kernToRecip     (const std::string& kerndata);
 		static std::string  kernToRecip     (HTp token);
 		static int     kernToMidiNoteNumber (const std::string& kerndata);
@@ -193,6 +220,10 @@ class Convert {
 
 		static bool isKernSecondaryTiedNote (const std::string& kerndata);
 		static std::string getKernPitchAttributes(const std::string& kerndata);
+		static const KernDecoding& decodeKern(const std::string& kerndata);
+		static const KernDecoding& decodeKern(HTp token)
+				{ return decodeKern(*token); }
+		static void clearKernDecodings      (void);
 
 		// String processing, defined in Convert-string.cpp
 		static std::vector<std::string> splitString   (const std::string& data,
@@ -210,6 +241,8 @@ class Convert {
 		static bool    contains(const std::string& input, char pattern);
 		static bool    contains(std::string* input, const std::string& pattern);
 		static bool    contains(std::string* input, char pattern);
+		static void    appendLittleEndian   (std::string& output, uint64_t value,
+		                                     int bytes);
 		static void    makeBooleanTrackList(std::vector<bool>& spinelist,
 		                                     const std::string& spinestring,
 		                                     int maxtrack);
@@ -240,6 +273,19 @@ class Convert {
 		static std::string getReferenceKeyMeaning(HTp token);
 		static std::string getReferenceKeyMeaning(const std::string& token);
 		static std::string getLanguageName(const std::string& abbreviation);
+
+	private:
+		static void fillKernDecoding(KernDecoding& decoding,
+		                             const std::string& kerndata);
+
+		// s_kernDecodings: per-thread cache of decodeKern() results,
+		// indexed by token text.
+		static thread_local std::unordered_map<std::string, KernDecoding>
+				s_kernDecodings;
+
+		// s_lastKernDecoding: the most recent decodeKern() result.
+		static thread_local const std::pair<const std::string, KernDecoding>*
+				s_lastKernDecoding;
 };
 
 
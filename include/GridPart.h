@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Oct 16 16:08:05 PDT 2016
-// Last Modified: Sun Oct 16 16:08:08 PDT 2016
+// Last Modified: Sun Oct 18 08:32:14 UTC 2026
 // Filename:      GridPart.h
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/include/GridPart.h
 // Syntax:        C++11; humlib
@@ -19,6 +19,7 @@
 #define _GRIDPART_H
 
 #include "GridStaff.h"
+#include "HumArena.h"
 
 #include <iostream>
 #include <vector>
@@ -31,6 +32,10 @@ class GridPart : public std::vector<GridStaff*>, public GridSide {
 	public:
 		GridPart(void);
 		~GridPart();
+		static void* operator new   (size_t size)
+		                             { return HumArena::allocateObject(size); }
+		static void  operator delete(void* pointer)
+		                                  { HumArena::freeObject(pointer); }
 
 	private:
 		std::string m_partName;
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Oct 16 16:08:05 PDT 2016
-// Last Modified: Sat Oct 21 21:59:45 PDT 2017
+// Last Modified: Sun Oct 18 08:32:14 UTC 2026
 // Filename:      GridSlice.h
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/include/GridSlice.h
 // Syntax:        C++11; humlib
@@ -17,6 +17,7 @@
 #define _GRIDSLICE_H
 
 #include "GridCommon.h"
+#include "HumArena.h"
 #include "MxmlPart.h"
 #include "GridPart.h"
 #include "GridMeasure.h"
@@ -42,6 +43,10 @@ class GridSlice : public std::vector<GridPart*> {
 		GridSlice(GridMeasure* measure, HumNum timestamp, SliceType type,
 		          GridSlice* slice);
 		~GridSlice();
+		static void* operator new   (size_t size)
+		                             { return HumArena::allocateObject(size); }
+		static void  operator delete(void* pointer)
+		                                  { HumArena::freeObject(pointer); }
 
 		bool isNoteSlice(void)          { return m_type == SliceType::Notes;            }
 		bool isGraceSlice(void)         { return m_type == SliceType::GraceNotes;       }
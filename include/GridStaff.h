@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Oct 16 16:08:05 PDT 2016
-// Last Modified: Sun Oct 16 16:08:08 PDT 2016
+// Last Modified: Sun Oct 18 08:32:14 UTC 2026
 // Filename:      GridStaff.h
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/include/GridStaff.h
 // Syntax:        C++11; humlib
@@ -20,6 +20,7 @@
 #include "GridCommon.h"
 #include "GridSide.h"
 #include "GridVoice.h"
+#include "HumArena.h"
 
 #include <iostream>
 #include <string>
@@ -35,6 +36,10 @@ class GridStaff : public std::vector<GridVoice*>, public GridSide {
 	public:
 		GridStaff(void);
 		~GridStaff();
+		static void* operator new   (size_t size)
+		                             { return HumArena::allocateObject(size); }
+		static void  operator delete(void* pointer)
+		                                  { HumArena::freeObject(pointer); }
 		GridVoice* setTokenLayer (int layerindex, HTp token, HumNum duration);
 		void setNullTokenLayer   (int layerindex, SliceType type, HumNum nextdur);
 		void appendTokenLayer    (int layerindex, HTp token, HumNum duration,
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Tue Oct 18 12:01:36 PDT 2016
-// Last Modified: Tue Oct 18 12:01:41 PDT 2016
+// Last Modified: Sun Oct 18 08:32:14 UTC 2026
 // Filename:      GridVoice.h
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/include/GridVoice.h
 // Syntax:        C++11; humlib
@@ -18,6 +18,7 @@
 #ifndef _GRIDVOICE_H
 #define _GRIDVOICE_H
 
+#include "HumArena.h"
 #include "HumdrumToken.h"
 
 #include <iostream>
@@ -36,6 +37,10 @@ class GridVoice {
 		GridVoice(const char* token, HumNum duration);
 		GridVoice(const std::string& token, HumNum duration);
 		~GridVoice();
+		static void* operator new   (size_t size)
+		                             { return HumArena::allocateObject(size); }
+		static void  operator delete(void* pointer)
+		                                  { HumArena::freeObject(pointer); }
 
 		bool   isTransfered       (void);
 
@@ -0,0 +1,100 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 00:10:57 UTC 2026
+// Last Modified: Sun Oct 18 10:49:06 UTC 2026
+// Filename:      HumArena.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumArena.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Block allocator for HumdrumLine, HumdrumToken and HumGrid
+//                node objects.  When an arena is made active for the
+//                current thread (such as by HumdrumFileBase::read), new
+//                objects are carved out of large memory blocks rather
+//                than being individually allocated on the heap.  Deleting
+//                an arena-allocated object only runs its destructor; the
+//                memory blocks are freed together when the arena is
+//                cleared.  Blocks which still contain live objects when
+//                the arena is cleared (such as tokens which were moved
+//                into another file) are freed when their last object
+//                is deleted.  Tokens can be allocated from a separate
+//                arena (setTokenArena), so that tokens which are moved
+//                into another file only keep the token blocks alive.
+//
+
+#ifndef _HUMARENA_H_INCLUDED
+#define _HUMARENA_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace hum {
+
+// START_MERGE
+
+class HumArena {
+	public:
+		              HumArena          (void);
+		             ~HumArena          ();
+
+		void          clear             (void);
+		int           getBlockCount     (void) const;
+		size_t        getObjectCount    (void) const;
+		static int    getRetiredBlockCount(void);
+
+		static HumArena* getActive      (void);
+		static HumArena* setActive      (HumArena* arena);
+
+		void          setTokenArena     (HumArena* arena);
+		HumArena*     getTokenArena     (void) const;
+
+		static void*  allocateObject    (size_t size);
+		static void*  allocateToken     (size_t size);
+		static void   freeObject        (void* pointer);
+
+	private:
+		                HumArena        (const HumArena& arena) = delete;
+		HumArena&       operator=       (const HumArena& arena) = delete;
+		void*           allocate        (size_t size);
+		static void*    allocateFrom    (HumArena* arena, size_t size);
+
+		struct HumArenaBlock {
+			size_t m_live;      // number of objects not yet deleted
+			bool   m_retired;   // block no longer owned by an arena
+		};
+
+		// m_blocks: memory blocks from which objects are allocated.
+		// The first bytes of each block store a HumArenaBlock header.
+		std::vector<HumArenaBlock*> m_blocks;
+
+		// m_used: number of bytes used in the last block of m_blocks.
+		size_t m_used;
+
+		// m_size: number of bytes in the last block of m_blocks.
+		size_t m_size;
+
+		// m_objects: total number of objects allocated from the arena.
+		size_t m_objects;
+
+		// m_tokens: arena for allocating tokens while this arena is
+		// active, or NULL to allocate them from this arena.
+		HumArena* m_tokens;
+
+		// s_active: the arena for allocating objects in the current thread.
+		static thread_local HumArena* s_active;
+
+		// s_retired: number of blocks in all threads which were released by
+		// their arena while still containing objects, and not yet freed.
+		static std::atomic<int> s_retired;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMARENA_H_INCLUDED */
+
+
+
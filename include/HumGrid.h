@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Oct 16 16:08:05 PDT 2016
-// Last Modified: Sun Oct 16 16:08:08 PDT 2016
+// Last Modified: Sun Oct 18 09:47:34 UTC 2026
 // Filename:      HumGrid.h
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/include/HumGrid.h
 // Syntax:        C++11; humlib
@@ -16,6 +16,7 @@
 
 #include "GridMeasure.h"
 #include "GridSlice.h"
+#include "HumArena.h"
 
 #include <vector>
 
@@ -28,6 +29,7 @@ class HumGrid : public std::vector<GridMeasure*> {
 		HumGrid(void);
 		~HumGrid();
 		void enableRecipSpine           (void);
+		HumArena* getArena              (void);
 		bool transferTokens             (HumdrumFile& outfile, int startbarnum = 0);
 		int  getHarmonyCount            (int partindex);
 		int  getDynamicsCount           (int partindex);
@@ -51,6 +53,8 @@ class HumGrid : public std::vector<GridMeasure*> {
 		void setPartName                (int index, const string& name);
 		std::string getPartName         (int index);
 		void addInvisibleRestsInFirstTrack(void);
+		void addInvisibleRestsInFirstTrack(std::vector<std::vector<GridSlice*>>& nextevent,
+		                                 int i);
 		void setPartStaffDimensions     (std::vector<std::vector<GridSlice*>>& nextevent,
 		                                 GridSlice* startslice);
 		void addInvisibleRest           (std::vector<std::vector<GridSlice*>>& nextevent,
@@ -70,10 +74,10 @@ class HumGrid : public std::vector<GridMeasure*> {
 		void insertStaffIndications        (HumdrumFile& outfile);
 		void insertPartNames               (HumdrumFile& outfile);
 		void addNullTokens                 (void);
-		void addNullTokensForGraceNotes    (void);
-		void addNullTokensForClefChanges   (void);
-		void addNullTokensForLayoutComments(void);
-		void checkForNullDataHoles         (void);
+		bool finalizeSlices                (void);
+		void fillInNullTokens              (std::vector<GridSlice*>& slices,
+		                                    GridSlice* lastnote, GridSlice* nextnote);
+		void checkForNullDataHoles         (int i);
 
 		void fillInNullTokensForGraceNotes(GridSlice* graceslice, GridSlice* lastnote,
 		                                   GridSlice* nextnote);
@@ -85,10 +89,10 @@ class HumGrid : public std::vector<GridMeasure*> {
 		void extendDurationToken           (int slicei, int parti,
 		                                    int staffi, int voicei);
 		GridVoice* getGridVoice(int slicei, int parti, int staffi, int voicei);
-		void addMeasureLines               (void);
+		GridSlice* addMeasureLine          (int m, std::vector<int>& barnums);
 		void addLastMeasure                (void);
-		bool manipulatorCheck              (void);
 		GridSlice* manipulatorCheck        (GridSlice* ice1, GridSlice* ice2);
+		bool hasSameVoiceCounts            (GridSlice* ice1, GridSlice* ice2);
 		void cleanupManipulators           (void);
 		void cleanManipulator              (std::vector<GridSlice*>& newslices,
 		                                    GridSlice* curr);
@@ -116,7 +120,6 @@ class HumGrid : public std::vector<GridMeasure*> {
 		void insertMelodyString            (GridMeasure* measure, const string& melody);
 		GridVoice* createVoice             (const string& tok, const string& post, HumNum duration, int pindex, int sindex);
 		HTp createHumdrumToken             (const string& tok, int pindex, int sindex);
-		GridSlice* getNextSpinedLine       (const GridMeasure::iterator& it, int measureindex);
 		void matchVoices                   (GridSlice* current, GridSlice* last);
 		void adjustVoices                  (GridSlice* curr, GridSlice* newmanip, int partsplit);
 		void createMatchedVoiceCount       (GridStaff* snew, GridStaff* sold, int p, int s);
@@ -134,6 +137,15 @@ class HumGrid : public std::vector<GridMeasure*> {
 
 		std::vector<std::string>      m_partnames;
 
+		// m_arena: Used to allocate the slices, parts, staves and voices
+		// of the grid when it is the active arena.
+		HumArena                      m_arena;
+
+		// m_tokenarena: Used to allocate the tokens of the grid when
+		// m_arena is the active arena.  The tokens are moved into the
+		// output file, so its blocks are freed with the output file.
+		HumArena                      m_tokenarena;
+
 		// options:
 		bool m_recip;               // include **recip spine in output
 		bool m_musicxmlbarlines;    // use measure numbers from <measure> element
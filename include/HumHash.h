@@ -122,6 +122,20 @@ class HumParameter : public std::string {
 		HumdrumToken* origin;
 };
 
+// HumHashEntry: a single parameter in a HumHash, stored with its
+// namespaces and key.
+class HumHashEntry {
+	public:
+		std::string  ns1;
+		std::string  ns2;
+		std::string  key;
+		HumParameter value;
+};
+
+typedef std::vector<HumHashEntry> HumHashList;
+
+// Nested maps which HumHash used to store parameters in.  HumHash no
+// longer uses them, but they are kept for code which refers to them.
 typedef std::map<std::string, std::map<std::string, std::map<std::string, HumParameter> > > MapNNKV;
 typedef std::map<std::string, std::map<std::string, HumParameter> > MapNKV;
 typedef std::map<std::string, HumParameter> MapKV;
@@ -259,9 +273,26 @@ class HumHash {
 	protected:
 		void                     initializeParameters  (void);
 		std::vector<std::string> getKeyList            (const std::string& keys) const;
+		HumHashEntry*            findEntry             (const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key) const;
+		size_t                   findIndex             (const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key) const;
+		size_t                   findNamespaceEnd      (size_t index,
+		                                                const std::string& ns1) const;
+		size_t                   findNamespaceEnd      (size_t index,
+		                                                const std::string& ns1,
+		                                                const std::string& ns2) const;
+		static int               compareEntry          (const HumHashEntry& entry,
+		                                                const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key);
 
 	private:
-		MapNNKV*    parameters;
+		// parameters: list of parameters sorted by NS1, NS2 and then key.
+		// Remains NULL until the first parameter is set.
+		HumHashList* parameters;
 		std::string prefix;
 
 	friend std::ostream& operator<<(std::ostream& out, const HumHash& hash);
@@ -0,0 +1,85 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 01:25:45 UTC 2026
+// Last Modified: Sun Oct 18 01:25:45 UTC 2026
+// Filename:      HumMemoryMap.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/HumMemoryMap.h
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Read-only view of the contents of a file.  On POSIX
+//                systems the file is memory-mapped, so lines can be
+//                split directly from the mapped bytes without first
+//                copying them into a stream buffer.  On other systems
+//                (or if the file cannot be mapped, such as for pipes)
+//                the contents are read into memory instead.
+//
+
+#ifndef _HUMMEMORYMAP_H_INCLUDED
+#define _HUMMEMORYMAP_H_INCLUDED
+
+#include <cstddef>
+#include <string>
+
+namespace hum {
+
+// START_MERGE
+
+class HumMemoryMap {
+	public:
+		               HumMemoryMap       (void);
+		              ~HumMemoryMap       ();
+
+		bool           open               (const std::string& filename);
+		void           close              (void);
+		bool           isOpen             (void) const;
+		bool           isMapped           (void) const;
+		const char*    getData            (void) const;
+		size_t         getSize            (void) const;
+		bool           getLine            (std::string& line);
+		bool           eof                (void) const;
+		void           discardRead        (void);
+
+	private:
+		                HumMemoryMap      (const HumMemoryMap& map) = delete;
+		HumMemoryMap&   operator=         (const HumMemoryMap& map) = delete;
+		void            setData           (const char* data, size_t size);
+
+		// m_data: the contents of the file.
+		const char* m_data;
+
+		// m_size: the number of bytes in m_data.
+		size_t m_size;
+
+		// m_mapped: true if m_data is memory-mapped, false if m_data
+		// points into m_contents.
+		bool m_mapped;
+
+		// m_open: true if a file is open.
+		bool m_open;
+
+		// m_discarded: the number of bytes at the start of m_data
+		// which have been released by discardRead().
+		size_t m_discarded;
+
+		// m_contents: storage for file contents when the file
+		// cannot be memory-mapped.
+		std::string m_contents;
+
+		// m_position: the offset in m_data of the next line to be read
+		// by getLine().
+		size_t m_position;
+
+		// m_eof: true if getLine() has reached the end of m_data.
+		bool m_eof;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _HUMMEMORYMAP_H_INCLUDED */
+
+
+
@@ -99,15 +99,25 @@ class HumNum {
 		                             std::string separator = "_") const;
 		std::ostream& printList          (std::ostream& out) const;
 		std::ostream& printTwoPart  (std::ostream& out, const std::string& spacer = "+") const;
+		static bool hasOverflow     (void);
+		static void clearOverflow   (void);
 
 	protected:
 		void     reduce             (void);
+		void     reduce             (long long numerator, long long denominator);
+		void     approximate        (long long numerator, long long denominator);
 		int      gcdIterative       (int a, int b);
 		int      gcdRecursive       (int a, int b);
+		static long long gcdBinary  (long long a, long long b);
+		static int countTrailingZeros(unsigned long long value);
 
 	private:
 		int top;
 		int bot;
+
+		// s_overflow: set when the result of an operation in the current
+		// thread did not fit into ints and was approximated.
+		static thread_local bool s_overflow;
 };
 
 
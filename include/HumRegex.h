@@ -113,6 +113,10 @@ class HumRegex {
 	protected:
 		std::regex_constants::syntax_option_type
 				getTemporaryRegexFlags(const std::string& sflags);
+		void  setRegex               (const std::string& exp,
+		                              std::regex_constants::syntax_option_type flags);
+		static std::regex getCompiledRegex(const std::string& exp,
+		                              std::regex_constants::syntax_option_type flags);
 		std::regex_constants::match_flag_type
 				getTemporarySearchFlags(const std::string& sflags);
 
@@ -127,6 +131,17 @@ class HumRegex {
 		// .flags()        == return syntax_option_type used to construct.
 		std::regex m_regex;
 
+		// m_expression: the expression string which was compiled into
+		// m_regex.  Used to skip recompiling when the same expression
+		// is used in successive calls.
+		std::string m_expression;
+
+		// m_compiledflags: the syntax flags used to compile m_regex.
+		std::regex_constants::syntax_option_type m_compiledflags;
+
+		// m_compiled: true if m_regex was set by setRegex().
+		bool m_compiled;
+
 		// m_matches: stores the matches from a search:
 		//
 		// http://en.cppreference.com/w/cpp/regex/match_results
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Nov 28 08:55:15 PST 2016
-// Last Modified: Mon Nov 28 08:55:38 PST 2016
+// Last Modified: Sun Oct 18 14:52:48 UTC 2026
 // Filename:      HumTool.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/HumTool.h
 // Syntax:        C++11; humlib
@@ -15,9 +15,17 @@
 
 #include "Options.h"
 #include "HumdrumFileSet.h"
+#include "HumdrumFileStream.h"
 
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace hum {
 
@@ -56,6 +64,10 @@ class HumTool : public Options {
 		ostream&      getError        (ostream& out);
 		void          setError        (const string& message);
 
+		void          defineThreadOption(void);
+		int           getThreadCount  (void);
+		int           getThreadCount  (const std::string& option);
+
 	protected:
 		std::stringstream m_humdrum_text;  // output text in Humdrum syntax.
 		std::stringstream m_json_text;     // output text in JSON syntax.
@@ -68,6 +80,286 @@ class HumTool : public Options {
 };
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// StreamSegmentResult -- The output of processing one input segment
+//    in runStreamPool().
+//
+
+class StreamSegmentResult {
+	public:
+		bool        status = true;   // false if the segment failed
+		bool        error  = false;  // stop processing after this segment
+		std::string text;            // written to the output stream
+		std::string warning;         // written to std::cerr
+		std::string errortext;       // written to std::cerr
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// runStreamPool -- Process the segments of an input stream with a pool
+//    of threads.  A reader thread splits the input into segments, and
+//    each worker thread parses a segment into its own HumdrumFileSet
+//    and calls process(tool, infiles, result) with a separate instance
+//    of the tool (TOOL) which has processed the given command-line
+//    arguments.  The calling thread writes the text of the results
+//    to out (and their warnings and errors to std::cerr) in input
+//    order, and stops after a result which sets its error flag.  When
+//    a worker thread has finished, finish(tool) is called with its
+//    instance of the tool while no other thread is finishing, so that
+//    counts kept by each instance can be merged.  At most four
+//    segments for each thread are kept in memory.  Returns -1 if
+//    processing was stopped by an error, 1 if any result had a false
+//    status, and 0 otherwise.
+//
+
+template <class TOOL, class PROCESS, class FINISH>
+int runStreamPool(HumdrumFileStream& instream,
+		const std::vector<std::string>& arguments, int threads,
+		std::ostream& out, PROCESS process, FINISH finish) {
+
+	if (threads < 1) {
+		threads = 1;
+	}
+	int maxqueue = 4 * threads;   // maximum number of segments in memory
+
+	std::mutex mutex;
+	std::condition_variable readercv;  // reader waiting for queue space
+	std::condition_variable workercv;  // workers waiting for segments
+	std::condition_variable writercv;  // writer waiting for results
+	std::deque<std::pair<int, std::pair<std::string, std::string>>> segments;
+	std::map<int, StreamSegmentResult> results;
+	int readcount  = 0;      // number of segments read so far
+	int writecount = 0;      // number of segments written so far
+	bool readdone  = false;  // all segments have been read
+	bool abort     = false;  // stop processing after an error
+
+	auto reader = [&]() {
+		std::string contents;
+		std::string filename;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				readercv.wait(lock, [&]() {
+					return abort || (readcount - writecount < maxqueue);
+				});
+				if (abort) {
+					break;
+				}
+			}
+			if (!instream.getSegment(contents, filename)) {
+				break;
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			segments.emplace_back(readcount++, std::make_pair(contents, filename));
+			workercv.notify_one();
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		readdone = true;
+		workercv.notify_all();
+		writercv.notify_all();
+	};
+
+	auto worker = [&]() {
+		TOOL tool;
+		tool.process(arguments);
+		while (true) {
+			std::pair<int, std::pair<std::string, std::string>> segment;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				workercv.wait(lock, [&]() {
+					return abort || readdone || !segments.empty();
+				});
+				if (abort || segments.empty()) {
+					break;
+				}
+				segment = std::move(segments.front());
+				segments.pop_front();
+			}
+			HumdrumFileSet infiles;
+			HumdrumFile* infile = new HumdrumFile;
+			HumdrumFileStream::parseSegment(*infile, segment.second.first,
+					segment.second.second);
+			infiles.appendHumdrumPointer(infile);
+
+			StreamSegmentResult result;
+			process(tool, infiles, result);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			results[segment.first] = std::move(result);
+			writercv.notify_one();
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		finish(tool);
+	};
+
+	std::thread readthread(reader);
+	std::vector<std::thread> pool;
+	for (int i=0; i<threads; i++) {
+		pool.emplace_back(worker);
+	}
+
+	int output = 0;
+	while (true) {
+		StreamSegmentResult result;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			writercv.wait(lock, [&]() {
+				return (results.find(writecount) != results.end())
+						|| (readdone && (writecount == readcount));
+			});
+			auto it = results.find(writecount);
+			if (it == results.end()) {
+				break;
+			}
+			result = std::move(it->second);
+			results.erase(it);
+			writecount++;
+			readercv.notify_one();
+		}
+		if (!result.status) {
+			output = 1;
+		}
+		std::cerr << result.warning;
+		out << result.text;
+		std::cerr << result.errortext;
+		if (result.error) {
+			output = -1;
+			break;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		abort = true;
+		readercv.notify_all();
+		workercv.notify_all();
+	}
+	readthread.join();
+	for (int i=0; i<(int)pool.size(); i++) {
+		pool[i].join();
+	}
+	return output;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// runParallelStream -- Multi-threaded version of STREAM_INTERFACE, used
+//    when the -j option is larger than one.  Each segment of the input
+//    is processed by a separate instance of the tool in runStreamPool(),
+//    and the results are printed in input order.  The output is
+//    identical to the serial interface for tools which process each
+//    segment independently.  Only tools which define the -j option with
+//    HumTool::defineThreadOption() in their constructor can run here,
+//    so each worker's instance of the tool also accepts the
+//    command-line options.
+//
+
+template <class TOOL>
+int runParallelStream(TOOL& interface, int argc, char** argv) {
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	std::vector<std::string> arguments(argv, argv + argc);
+
+	auto process = [](TOOL& tool, HumdrumFileSet& infiles,
+			StreamSegmentResult& result) {
+		std::stringstream text;
+		result.status = tool.run(infiles);
+		if (tool.hasWarning()) {
+			result.warning = tool.getWarning();
+		}
+		if (tool.hasAnyText()) {
+			tool.getAllText(text);
+		}
+		if (tool.hasError()) {
+			result.error = true;
+			result.errortext = tool.getError();
+		} else if (!tool.hasAnyText()) {
+			for (int i=0; i<infiles.getCount(); i++) {
+				text << infiles[i];
+			}
+		}
+		result.text = text.str();
+		tool.clearOutput();
+	};
+
+	return runStreamPool<TOOL>(instream, arguments,
+			interface.getThreadCount(), std::cout, process, [](TOOL& tool) {});
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// runStreamInterface -- Process each segment of the input stream
+//    separately and print the results (the body of STREAM_INTERFACE).
+//    The command-line options must already have been processed.  The
+//    segments are processed in parallel if the tool defines the -j
+//    option and it is larger than one.
+//
+
+template <class TOOL>
+int runStreamInterface(TOOL& interface, int argc, char** argv) {
+	if (interface.getThreadCount() > 1) {
+		return runParallelStream(interface, argc, argv);
+	}
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	HumdrumFileSet infiles;
+	bool status = true;
+	while (instream.readSingleSegment(infiles)) {
+		status &= interface.run(infiles);
+		if (interface.hasWarning()) {
+			interface.getWarning(std::cerr);
+		}
+		if (interface.hasAnyText()) {
+			interface.getAllText(std::cout);
+		}
+		if (interface.hasError()) {
+			interface.getError(std::cerr);
+			return -1;
+		}
+		if (!interface.hasAnyText()) {
+			for (int i=0; i<infiles.getCount(); i++) {
+				std::cout << infiles[i];
+			}
+		}
+		interface.clearOutput();
+	}
+	return !status;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// runBatchStream -- Send the entire input stream to the tool's
+//    .run(HumdrumFileStream& instream, ostream& out) function, which
+//    writes its results for all input files to standard output.
+//
+
+template <class TOOL>
+int runBatchStream(TOOL& interface) {
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	bool status = interface.run(instream, std::cout);
+	if (interface.hasWarning()) {
+		interface.getWarning(std::cerr);
+	}
+	if (interface.hasAnyText()) {
+		interface.getAllText(std::cout);
+	}
+	if (interface.hasError()) {
+		interface.getError(std::cerr);
+		return -1;
+	}
+	interface.clearOutput();
+	return !status;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // common command-line Interfaces
@@ -116,7 +408,8 @@ int main(int argc, char** argv) {                      \
 //////////////////////////////
 //
 // STREAM_INTERFACE -- Use HumdrumFileStream (low-memory
-//    usage implementation).
+//    usage implementation).  Tools which define the -j option
+//    process the input segments in parallel.
 //
 
 #define STREAM_INTERFACE(CLASS)                                  \
@@ -128,29 +421,33 @@ int main(int argc, char** argv) {                                \
 		interface.getError(cerr);                                  \
 		return -1;                                                 \
 	}                                                             \
-	HumdrumFileStream instream(static_cast<Options&>(interface)); \
-	HumdrumFileSet infiles;                                       \
-	bool status = true;                                           \
-	while (instream.readSingleSegment(infiles)) {                 \
-		status &= interface.run(infiles);                          \
-		if (interface.hasWarning()) {                              \
-			interface.getWarning(cerr);                             \
-		}                                                          \
-		if (interface.hasAnyText()) {                              \
-		   interface.getAllText(cout);                             \
-		}                                                          \
-		if (interface.hasError()) {                                \
-			interface.getError(cerr);                               \
-         return -1;                                              \
-		}                                                          \
-		if (!interface.hasAnyText()) {                             \
-			for (int i=0; i<infiles.getCount(); i++) {              \
-				cout << infiles[i];                                  \
-			}                                                       \
-		}                                                          \
-		interface.clearOutput();                                   \
+	return runStreamInterface(interface, argc, argv);             \
+}
+
+
+
+//////////////////////////////
+//
+// STREAM_BATCH_INTERFACE -- STREAM_INTERFACE for tools which can
+//    also summarize all input files at once.  When the tool's
+//    .isBatchMode() returns true, the whole HumdrumFileStream is sent
+//    to .run(HumdrumFileStream& instream, ostream& out); otherwise each
+//    input file is processed separately.
+//
+
+#define STREAM_BATCH_INTERFACE(CLASS)                            \
+using namespace std;                                             \
+using namespace hum;                                             \
+int main(int argc, char** argv) {                                \
+	CLASS interface;                                              \
+	if (!interface.process(argc, argv)) {                         \
+		interface.getError(cerr);                                  \
+		return -1;                                                 \
 	}                                                             \
-	return !status;                                               \
+	if (interface.isBatchMode()) {                                \
+		return runBatchStream(interface);                          \
+	}                                                             \
+	return runStreamInterface(interface, argc, argv);             \
 }
 
 
@@ -192,7 +489,8 @@ int main(int argc, char** argv) {                                \
 //////////////////////////////
 //
 // SET_INTERFACE -- Use HumdrumFileSet (multiple file high-memory
-//    usage implementation).
+//    usage implementation).  Tools which define the -j option parse
+//    the input files in parallel.
 //
 
 #define SET_INTERFACE(CLASS)                                     \
@@ -206,7 +504,7 @@ int main(int argc, char** argv) {                                \
 	}                                                             \
 	HumdrumFileStream instream(static_cast<Options&>(interface)); \
 	HumdrumFileSet infiles;                                       \
-	instream.read(infiles);                                       \
+	instream.read(infiles, interface.getThreadCount());           \
 	bool status = interface.run(infiles);                         \
 	if (interface.hasWarning()) {                                 \
 		interface.getWarning(cerr);                                \
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Thu Jun 13 08:38:17 CEST 2019
+// Last Modified: Sun Oct 18 09:34:30 UTC 2026
 // Filename:      HumdrumFileBase.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/HumdrumFileBase.h
 // Syntax:        C++11; humlib
@@ -20,6 +20,7 @@
 
 #include <iostream>
 #include <string>
+#include <unordered_map>
 #include <sstream>
 #include <vector>
 
@@ -107,6 +108,9 @@ class HumFileAnalysis {
 			m_phrases_analyzed   = false;
 			m_nulls_analyzed     = false;
 			m_strophes_analyzed  = false;
+			m_parameters_analyzed = false;
+			m_signifiers_analyzed = false;
+			m_notegrid_analyzed  = false;
 
 			m_barlines_analyzed  = false;
 			m_barlines_different = false;
@@ -140,6 +144,18 @@ class HumFileAnalysis {
 		// null tokens have been analyzed yet.
 		bool m_nulls_analyzed = false;
 
+		// m_parameters_analyzed: Used to keep track of whether or not
+		// global and local layout parameters have been linked to tokens.
+		bool m_parameters_analyzed = false;
+
+		// m_signifiers_analyzed: Used to keep track of whether or not
+		// !!!RDF signifier records have been stored.
+		bool m_signifiers_analyzed = false;
+
+		// m_notegrid_analyzed: Used to keep track of whether or not the
+		// cached CompactNoteGrid matches the current contents of the file.
+		bool m_notegrid_analyzed = false;
+
 		// m_barlines_analyzed: Used to keep track of wheter or not
 		// barlines have beena analyzed yet.
 		bool m_barlines_analyzed = false;
@@ -151,6 +167,8 @@ class HumFileAnalysis {
 
 bool sortTokenPairsByLineIndex(const TokenPair& a, const TokenPair& b);
 
+class CompactNoteGrid;
+
 
 class HumdrumFileBase : public HumHash {
 	public:
@@ -182,11 +200,18 @@ class HumdrumFileBase : public HumHash {
 		bool          isQuiet                  (void) const;
 		void          setQuietParsing          (void);
 		void          setNoisyParsing          (void);
+		void          setArenaAllocation       (bool state = true);
+		bool          getArenaAllocation       (void) const;
+		HumArena*     getArena                 (void);
 		void          clear                    (void);
 		bool          isStructureAnalyzed      (void);
 		bool          isRhythmAnalyzed         (void);
 		bool          areStrandsAnalyzed       (void);
 		bool          areStrophesAnalyzed      (void);
+		bool          areParametersAnalyzed    (void);
+		bool          areSignifiersAnalyzed    (void);
+		CompactNoteGrid& getCompactNoteGrid    (void);
+		void          invalidateNoteGrid       (void);
 
     	template <class TYPE>
 		   void       initializeArray          (std::vector<std::vector<TYPE>>& array, TYPE value);
@@ -268,6 +293,7 @@ class HumdrumFileBase : public HumHash {
 		int           getTrackEndCount         (int track) const;
 		HTp           getTrackEnd              (int track, int subtrack = 0) const;
 		void          createLinesFromTokens    (void);
+		void          clearDirtyLines          (void);
 		void          removeExtraTabs          (void);
 		void          addExtraTabs             (void);
 		std::vector<int> getTrackWidths        (void);
@@ -336,6 +362,13 @@ class HumdrumFileBase : public HumHash {
 		static void   readStringFromHttpUri     (std::stringstream& inputdata,
 		                                         const std::string& webaddress);
 
+		// functions defined in HumdrumFileBase-binary.cpp:
+		bool          readBinary                (const std::string& filename);
+		bool          readBinary                (std::istream& contents);
+		bool          writeBinary               (const std::string& filename);
+		bool          writeBinary               (std::ostream& out);
+		static bool   isBinary                  (const char* contents, size_t size);
+
 	protected:
 		static int    getChunk                  (int socket_id,
 		                                         std::stringstream& inputdata,
@@ -351,6 +384,78 @@ class HumdrumFileBase : public HumHash {
 		                                         unsigned short int port);
 
 	protected:
+		bool          readBinaryBuffer          (const char* contents, size_t size);
+		int           getBinaryTokenIndex       (HTp token,
+		                                         const std::vector<int>& offsets);
+		void          appendBinaryToken         (std::string& output, HTp token,
+		                                         int base,
+		                                         const std::vector<int>& offsets);
+		void          appendBinaryTokenList     (std::string& output,
+		                                         const std::vector<HTp>& tokens,
+		                                         int base,
+		                                         const std::vector<int>& offsets);
+		void          appendBinaryTokenPairs    (std::string& output,
+		                                         const std::vector<TokenPair>& pairs,
+		                                         int base,
+		                                         const std::vector<int>& offsets);
+		HTp           getBinaryFieldToken       (int lineindex, int fieldindex);
+		int           getBinaryLinkFlags        (HTp token, int lineindex,
+		                                         int fieldindex);
+		static HTp    getBinaryNullResolve      (HTp token);
+		static bool   isBinaryLink              (const std::vector<HTp>& links,
+		                                         HTp token);
+		static void   setBinaryLink             (std::vector<HTp>& links, HTp token);
+		static void   getBinaryNonNullLinks     (const std::vector<HTp>& links,
+		                                         bool nextQ,
+		                                         std::vector<HTp>& output);
+		static bool   joinBinaryTokens          (HumdrumLine& line,
+		                                         std::string& output);
+		static void   appendBinaryAddress       (std::string& output, HTp token,
+		                                         std::unordered_map<std::string, int>& spineinfos);
+		static void   extractBinaryAddress      (HTp token, const char*& ptr,
+		                                         const char* end, bool& ok,
+		                                         std::vector<std::string>& spineinfos);
+		static int    appendBinaryText          (std::string& output,
+		                                         const std::string& value,
+		                                         std::unordered_map<std::string, int>& table);
+		static int    extractBinaryText         (std::string& output,
+		                                         const char*& ptr, const char* end,
+		                                         bool& ok,
+		                                         std::vector<std::string>& table);
+		static void   appendBinaryInt           (std::string& output, int value);
+		static void   appendBinaryString        (std::string& output,
+		                                         const std::string& value);
+		static void   appendBinaryNum           (std::string& output,
+		                                         const HumNum& value);
+		static int    extractBinaryInt          (const char*& ptr, const char* end,
+		                                         bool& ok);
+		static int    extractBinaryCount        (const char*& ptr, const char* end,
+		                                         bool& ok);
+		static void   extractBinaryString       (std::string& output,
+		                                         const char*& ptr, const char* end,
+		                                         bool& ok);
+		static HumNum extractBinaryNum          (const char*& ptr, const char* end,
+		                                         bool& ok);
+		static HTp    extractBinaryToken        (const char*& ptr, const char* end,
+		                                         bool& ok, int base,
+		                                         const std::vector<HTp>& tokens);
+		static void   extractBinaryTokenList    (std::vector<HTp>& output,
+		                                         const char*& ptr, const char* end,
+		                                         bool& ok, int base,
+		                                         const std::vector<HTp>& tokens);
+		static void   extractBinaryTokenPairs   (std::vector<TokenPair>& output,
+		                                         const char*& ptr, const char* end,
+		                                         bool& ok, int base,
+		                                         const std::vector<HTp>& tokens);
+
+		// BINARY_MAGIC: signature at the start of writeBinary() data.
+		static const char BINARY_MAGIC[9];
+
+		// BINARY_VERSION: version number of the writeBinary() format.
+		static const int BINARY_VERSION;
+
+	protected:
+		bool          readBuffer                (const char* contents, size_t size);
 		bool          analyzeTokens             (void);
 		bool          analyzeSpines             (void);
 		bool          analyzeLinks              (void);
@@ -441,6 +546,19 @@ class HumdrumFileBase : public HumHash {
 		// m_analysis: Used to keep track of analysis states for the file.
 		HumFileAnalysis m_analyses;
 
+		// m_arena: Used to allocate lines and tokens when reading data
+		// if m_arenaQ is true.  The arena is cleared with the file.
+		HumArena m_arena;
+
+		// m_arenaQ: Set to true to allocate lines and tokens from m_arena
+		// when reading data rather than individually on the heap.
+		bool m_arenaQ = false;
+
+		// m_notegrid: Cached note grid for the **kern spines, created on
+		// demand by getCompactNoteGrid() and reloaded in place when the
+		// file's contents change.
+		CompactNoteGrid* m_notegrid = NULL;
+
 	public:
 		// Dummy functions to allow the HumdrumFile class's inheritance
 		// to be shifted between HumdrumFileContent (the top-level default),
@@ -19,6 +19,7 @@
 #define _HUMDRUMFILESTREAM_H_INCLUDED
 
 #include "HumdrumFile.h"
+#include "HumMemoryMap.h"
 #include "Options.h"
 
 
@@ -42,6 +43,7 @@ class HumdrumFileStream {
 		                HumdrumFileStream  (const string& datastream);
 
 		void            loadString         (const string& data);
+		int             loadFile           (const std::string& filename);
 
 		int             setFileList        (char** list);
 		int             setFileList        (const std::vector<std::string>& list);
@@ -52,11 +54,18 @@ class HumdrumFileStream {
 		int             getFile            (HumdrumFile& infile);
 		int             read               (HumdrumFile& infile);
 		int             read               (HumdrumFileSet& infiles);
+		int             read               (HumdrumFileSet& infiles, int threads);
 		int             readSingleSegment  (HumdrumFileSet& infiles);
 
+		int             getSegment         (std::string& contents,
+		                                    std::string& filename);
+		static void     parseSegment       (HumdrumFile& infile,
+		                                    const std::string& contents,
+		                                    const std::string& filename);
+
 	protected:
 		std::stringstream m_stringbuffer;   // used to read files from a string
-		std::ifstream     m_instream;       // used to read from list of files
+		HumMemoryMap      m_mapfile;        // used to read from list of files
 		std::stringstream m_urlbuffer;      // used to read data over internet
 		std::string       m_newfilebuffer;  // used to keep track of !!!!segment:
 		                                    // records.
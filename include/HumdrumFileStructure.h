@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Aug 17 02:39:28 PDT 2015
-// Last Modified: Tue Feb  4 21:02:30 PST 2020 Strophe analysis
+// Last Modified: Sun Oct 18 07:52:26 UTC 2026 Added analyzeFromTokens()
 // Filename:      HumdrumFileStructure.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/HumdrumFileStructure.h
 // Syntax:        C++11; humlib
@@ -129,8 +129,12 @@ class HumdrumFileStructure : public HumdrumFileBase {
 
 		bool          analyzeStructure             (void);
 		bool          analyzeStructureNoRhythm     (void);
+		bool          analyzeFromTokens            (void);
 		bool          analyzeRhythmStructure       (void);
 		bool          analyzeStrands               (void);
+		bool          analyzeParameters            (void);
+		void          analyzeSignifiers            (void);
+		bool          analyzeDirtyLines            (int linecount);
 
 		// signifier access
 		std::string   getKernLinkSignifier         (void);
@@ -140,12 +144,12 @@ class HumdrumFileStructure : public HumdrumFileBase {
 
 	protected:
 		bool          analyzeRhythm                (void);
+		bool          analyzeStructureFromTimes    (void);
 		bool          assignRhythmFromRecip        (HTp spinestart);
 		bool          analyzeMeter                 (void);
 		bool          analyzeTokenDurations        (void);
 		bool          analyzeGlobalParameters      (void);
 		bool          analyzeLocalParameters       (void);
-		// bool          analyzeParameters            (void);
 		bool          analyzeDurationsOfNonRhythmicSpines(void);
 		HumNum        getMinDur                    (std::vector<HumNum>& durs,
 		                                            std::vector<HumNum>& durstate);
@@ -173,8 +177,8 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          assignDurationsToNonRhythmicTrack(HTp endtoken, HTp ptoken);
 		void          analyzeSpineStrands          (std::vector<TokenPair>& ends,
 		                                            HTp starttok);
-		void          analyzeSignifiers            (void);
 		void          setLineRhythmAnalyzed        (void);
+		bool          isAnalysisPreserved          (HumdrumLine& line);
 };
 
 
@@ -34,10 +34,16 @@ class HumdrumLine : public std::string, public HumHash {
 		            HumdrumLine            (void);
 		            HumdrumLine            (const std::string& aString);
 		            HumdrumLine            (const char* aString);
+		            HumdrumLine            (const char* aString, size_t length);
 		            HumdrumLine            (HumdrumLine& line);
 		            HumdrumLine            (HumdrumLine& line, void* owner);
 		           ~HumdrumLine            ();
 
+		static void* operator new          (size_t size)
+		                             { return HumArena::allocateObject(size); }
+		static void  operator delete       (void* pointer)
+		                                  { HumArena::freeObject(pointer); }
+
 		HumdrumLine& operator=             (HumdrumLine& line);
 		bool        isComment              (void) const;
 		bool        isCommentLocal         (void) const;
@@ -102,6 +108,10 @@ class HumdrumLine : public std::string, public HumHash {
 		HumdrumFile*  getOwner             (void);
 		void          setText              (const std::string& text);
 		std::string   getText              (void);
+		bool          isDirty              (void) const { return m_dirty; }
+		void          setDirty             (void);
+		void          clearDirty           (void);
+		const std::string& getCleanText    (void) const { return m_cleantext; }
 		int           getBarNumber         (void);
 		int           getMeasureNumber     (void) { return getBarNumber(); }
 
@@ -234,6 +244,13 @@ class HumdrumLine : public std::string, public HumHash {
 		// has been added to line.
 		bool m_rhythm_analyzed = false;
 
+		// m_dirty: True if the tokens or text of the line have been changed
+		// since the line was read (or since clearDirty() was called).
+		bool m_dirty = false;
+
+		// m_cleantext: The text of the line before it became dirty.
+		std::string m_cleantext;
+
 		// owner: This is the HumdrumFile which manages the given line.
 		void* m_owner;
 
@@ -19,6 +19,7 @@
 
 class HumParamSet;
 
+#include "HumArena.h"
 #include "HumNum.h"
 #include "HumAddress.h"
 #include "HumHash.h"
@@ -42,6 +43,11 @@ class HumdrumToken : public std::string, public HumHash {
 		         HumdrumToken              (const std::string& token);
 		        ~HumdrumToken              ();
 
+		static void* operator new          (size_t size)
+		                             { return HumArena::allocateToken(size); }
+		static void  operator delete       (void* pointer)
+		                                  { HumArena::freeObject(pointer); }
+
 		bool     isNull                    (void) const;
 		bool     isManipulator             (void) const;
 
@@ -291,6 +297,8 @@ class HumdrumToken : public std::string, public HumHash {
 		void     setStrandIndex            (int index);
 
 		bool     analyzeDuration           (void);
+		void     analyzeOwnerStrands       (void) const;
+		void     analyzeOwnerParameters    (void);
 		std::ostream& printXmlBaseInfo     (std::ostream& out = std::cout, int level = 0,
 		                                    const std::string& indent = "\t");
 		std::ostream& printXmlContentInfo  (std::ostream& out = std::cout, int level = 0,
@@ -370,6 +378,7 @@ class HumdrumToken : public std::string, public HumHash {
 	friend class HumdrumFileStructure;
 	friend class HumdrumFileContent;
 	friend class HumdrumFile;
+	friend class GridSlice;
 };
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  6 10:53:40 CEST 2016
-// Last Modified: Sun Sep 18 14:16:18 PDT 2016
+// Last Modified: Sun Oct 18 07:13:13 UTC 2026
 // Filename:      MxmlEvent.cpp
 // URL:           https://github.com/craigsapp/musicxml2hum/blob/master/include/MxmlEvent.h
 // Syntax:        C++11; humlib
@@ -158,7 +158,7 @@ class MxmlEvent {
 		std::vector<MxmlEvent*> m_links;   // list of secondary chord notes
 		bool               m_linked;       // true if a secondary chord note
 		int                m_sequence;     // ordering of event in XML file
-		static int         m_counter;      // counter for sequence variable
+		static thread_local int m_counter; // counter for sequence variable
 		short              m_staff;        // staff number in part for event
 		short              m_voice;        // voice number in part for event
 		int                m_voiceindex;   // voice index of item (remapping)
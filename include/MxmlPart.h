@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  6 10:53:40 CEST 2016
-// Last Modified: Sun Sep 18 14:16:18 PDT 2016
+// Last Modified: Sun Oct 18 07:24:54 UTC 2026
 // Filename:      MxmlPart.cpp
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/include/MxmlPart.h
 // Syntax:        C++11; humlib
@@ -44,6 +44,8 @@ class MxmlPart {
 		                                    xml_node part);
 		bool          addMeasure           (xml_node mel);
 		bool          addMeasure           (xpath_node mel);
+		void          deleteMeasure        (int index);
+		void          clearMeasures        (void);
 		int           getMeasureCount      (void) const;
 		MxmlMeasure*  getMeasure           (int index) const;
 		long          getQTicks            (void) const;
@@ -0,0 +1,91 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 07:24:54 UTC 2026
+// Last Modified: Sun Oct 18 07:24:54 UTC 2026
+// Filename:      MxmlStream.h
+// URL:           https://github.com/craigsapp/humlib/blob/master/include/MxmlStream.h
+// Syntax:        C++11; humlib
+// vim:           ts=3 noexpandtab
+//
+// Description:   Index of the part and measure elements in a partwise
+//                MusicXML file.  The file is scanned once with a
+//                lightweight tag tokenizer (no DOM), after which each
+//                measure can be parsed into its own small document.
+//                The rest of the score (part-list, identification,
+//                credits, etc.) is loaded as a skeleton document with
+//                the contents of the part elements removed.
+//
+
+#ifndef _MXMLSTREAM_H
+#define _MXMLSTREAM_H
+
+#include "HumMemoryMap.h"
+
+#include "pugiconfig.hpp"
+#include "pugixml.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace pugi;
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+class MxmlStream {
+	public:
+		              MxmlStream           (void);
+		             ~MxmlStream           ();
+		void          clear                (void);
+		bool          open                 (const string& filename);
+		bool          loadSkeleton         (xml_document& doc);
+		int           getPartCount         (void) const;
+		int           getPartIndex         (const string& id) const;
+		int           getMeasureCount      (int partindex) const;
+		xml_node      loadMeasure          (xml_document& doc, int partindex,
+		                                    int measureindex);
+		const string& getError             (void) const;
+
+	protected:
+		bool          scan                 (void);
+		size_t        skipPast             (size_t index, const char* target);
+		size_t        findTagEnd           (size_t index);
+		string        getTagName           (size_t index);
+		bool          isUtf8               (void);
+
+	private:
+		// m_file: the contents of the MusicXML file.
+		HumMemoryMap m_file;
+
+		// m_data: the contents of m_file.
+		const char* m_data;
+
+		// m_size: the number of bytes in m_data.
+		size_t m_size;
+
+		// m_partids: the id attribute of each part element, in file order.
+		vector<string> m_partids;
+
+		// m_contents: the byte range of the contents of each part element
+		// (between its start and end tags).
+		vector<pair<size_t, size_t>> m_contents;
+
+		// m_measures: the byte range of each measure element in each part.
+		vector<vector<pair<size_t, size_t>>> m_measures;
+
+		// m_error: description of the problem if the file cannot be indexed.
+		string m_error;
+};
+
+
+// END_MERGE
+
+} // end namespace hum
+
+#endif /* _MXMLSTREAM_H */
+
+
+
@@ -29,6 +29,7 @@ namespace hum {
 #define GRIDREST NAN
 
 class NoteGrid;
+class CompactNoteGrid;
 
 
 class NoteCell {
@@ -84,6 +85,8 @@ class NoteCell {
 		std::vector<HTp> m_tiedtokens;  // list of tied notes/rests after note attack
 
 	protected:
+		       NoteCell             (NoteGrid* owner, const CompactNoteGrid& source,
+		                             int vindex, int sindex);
 		void clear                  (void);
 		void calculateNumericPitches(void);
 		void setVoiceIndex          (int index) { m_voice = index;           }
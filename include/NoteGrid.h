@@ -14,6 +14,7 @@
 #define _NOTEGRID_H_INCLUDED
 
 #include "NoteCell.h"
+#include "CompactNoteGrid.h"
 
 using namespace std;
 
@@ -69,8 +70,7 @@ class NoteGrid {
 		HumNum     getNoteDuration       (int vindex, int sindex);
 
 	protected:
-		void       buildAttackIndexes    (void);
-		void       buildAttackIndex      (int vindex);
+		void       buildTiedTokens       (int vindex);
 
 	private:
 		vector<vector<NoteCell*> > m_grid;
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Wed Feb  3 23:31:08 PST 2021
+// Last Modified: Sun Oct 18 17:48:11 UTC 2026
 // Filename:      humlib.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/humlib.h
 // Syntax:        C++11
@@ -43,21 +43,33 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <chrono>
+#include <climits>
 #include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <istream>
+#include <iterator>
 #include <list>
 #include <locale>
 #include <map>
+#include <mutex>
 #include <regex>
 #include <set>
 #include <sstream>
+#include <streambuf>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -79,8 +91,20 @@ using std::set;
 using std::string;
 using std::stringstream;
 using std::to_string;
+using std::unordered_map;
 using std::vector;
 
+#ifndef _WIN32
+	#include <dirent.h>      /* opendir, readdir */
+	#include <fcntl.h>       /* open            */
+	#include <sys/mman.h>    /* mmap, munmap    */
+	#include <sys/stat.h>    /* fstat, stat     */
+	#include <unistd.h>      /* close           */
+#else
+	#include <sys/types.h>
+	#include <sys/stat.h>    /* _stat           */
+#endif
+
 #ifdef USING_URI
 	#include <sys/types.h>   /* socket, connect */
 	#include <sys/socket.h>  /* socket, connect */
@@ -115,6 +139,115 @@ class HumdrumFile;
 class GridVoice;
 
 
+class HumArena {
+	public:
+		              HumArena          (void);
+		             ~HumArena          ();
+
+		void          clear             (void);
+		int           getBlockCount     (void) const;
+		size_t        getObjectCount    (void) const;
+		static int    getRetiredBlockCount(void);
+
+		static HumArena* getActive      (void);
+		static HumArena* setActive      (HumArena* arena);
+
+		void          setTokenArena     (HumArena* arena);
+		HumArena*     getTokenArena     (void) const;
+
+		static void*  allocateObject    (size_t size);
+		static void*  allocateToken     (size_t size);
+		static void   freeObject        (void* pointer);
+
+	private:
+		                HumArena        (const HumArena& arena) = delete;
+		HumArena&       operator=       (const HumArena& arena) = delete;
+		void*           allocate        (size_t size);
+		static void*    allocateFrom    (HumArena* arena, size_t size);
+
+		struct HumArenaBlock {
+			size_t m_live;      // number of objects not yet deleted
+			bool   m_retired;   // block no longer owned by an arena
+		};
+
+		// m_blocks: memory blocks from which objects are allocated.
+		// The first bytes of each block store a HumArenaBlock header.
+		std::vector<HumArenaBlock*> m_blocks;
+
+		// m_used: number of bytes used in the last block of m_blocks.
+		size_t m_used;
+
+		// m_size: number of bytes in the last block of m_blocks.
+		size_t m_size;
+
+		// m_objects: total number of objects allocated from the arena.
+		size_t m_objects;
+
+		// m_tokens: arena for allocating tokens while this arena is
+		// active, or NULL to allocate them from this arena.
+		HumArena* m_tokens;
+
+		// s_active: the arena for allocating objects in the current thread.
+		static thread_local HumArena* s_active;
+
+		// s_retired: number of blocks in all threads which were released by
+		// their arena while still containing objects, and not yet freed.
+		static std::atomic<int> s_retired;
+};
+
+
+
+class HumMemoryMap {
+	public:
+		               HumMemoryMap       (void);
+		              ~HumMemoryMap       ();
+
+		bool           open               (const std::string& filename);
+		void           close              (void);
+		bool           isOpen             (void) const;
+		bool           isMapped           (void) const;
+		const char*    getData            (void) const;
+		size_t         getSize            (void) const;
+		bool           getLine            (std::string& line);
+		bool           eof                (void) const;
+		void           discardRead        (void);
+
+	private:
+		                HumMemoryMap      (const HumMemoryMap& map) = delete;
+		HumMemoryMap&   operator=         (const HumMemoryMap& map) = delete;
+		void            setData           (const char* data, size_t size);
+
+		// m_data: the contents of the file.
+		const char* m_data;
+
+		// m_size: the number of bytes in m_data.
+		size_t m_size;
+
+		// m_mapped: true if m_data is memory-mapped, false if m_data
+		// points into m_contents.
+		bool m_mapped;
+
+		// m_open: true if a file is open.
+		bool m_open;
+
+		// m_discarded: the number of bytes at the start of m_data
+		// which have been released by discardRead().
+		size_t m_discarded;
+
+		// m_contents: storage for file contents when the file
+		// cannot be memory-mapped.
+		std::string m_contents;
+
+		// m_position: the offset in m_data of the next line to be read
+		// by getLine().
+		size_t m_position;
+
+		// m_eof: true if getLine() has reached the end of m_data.
+		bool m_eof;
+};
+
+
+
 class HumParameter : public std::string {
 	public:
 		HumParameter(void);
@@ -122,6 +255,20 @@ class HumParameter : public std::string {
 		HumdrumToken* origin;
 };
 
+// HumHashEntry: a single parameter in a HumHash, stored with its
+// namespaces and key.
+class HumHashEntry {
+	public:
+		std::string  ns1;
+		std::string  ns2;
+		std::string  key;
+		HumParameter value;
+};
+
+typedef std::vector<HumHashEntry> HumHashList;
+
+// Nested maps which HumHash used to store parameters in.  HumHash no
+// longer uses them, but they are kept for code which refers to them.
 typedef std::map<std::string, std::map<std::string, std::map<std::string, HumParameter> > > MapNNKV;
 typedef std::map<std::string, std::map<std::string, HumParameter> > MapNKV;
 typedef std::map<std::string, HumParameter> MapKV;
@@ -259,9 +406,26 @@ class HumHash {
 	protected:
 		void                     initializeParameters  (void);
 		std::vector<std::string> getKeyList            (const std::string& keys) const;
+		HumHashEntry*            findEntry             (const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key) const;
+		size_t                   findIndex             (const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key) const;
+		size_t                   findNamespaceEnd      (size_t index,
+		                                                const std::string& ns1) const;
+		size_t                   findNamespaceEnd      (size_t index,
+		                                                const std::string& ns1,
+		                                                const std::string& ns2) const;
+		static int               compareEntry          (const HumHashEntry& entry,
+		                                                const std::string& ns1,
+		                                                const std::string& ns2,
+		                                                const std::string& key);
 
 	private:
-		MapNNKV*    parameters;
+		// parameters: list of parameters sorted by NS1, NS2 and then key.
+		// Remains NULL until the first parameter is set.
+		HumHashList* parameters;
 		std::string prefix;
 
 	friend std::ostream& operator<<(std::ostream& out, const HumHash& hash);
@@ -348,15 +512,25 @@ class HumNum {
 		                             std::string separator = "_") const;
 		std::ostream& printList          (std::ostream& out) const;
 		std::ostream& printTwoPart  (std::ostream& out, const std::string& spacer = "+") const;
+		static bool hasOverflow     (void);
+		static void clearOverflow   (void);
 
 	protected:
 		void     reduce             (void);
+		void     reduce             (long long numerator, long long denominator);
+		void     approximate        (long long numerator, long long denominator);
 		int      gcdIterative       (int a, int b);
 		int      gcdRecursive       (int a, int b);
+		static long long gcdBinary  (long long a, long long b);
+		static int countTrailingZeros(unsigned long long value);
 
 	private:
 		int top;
 		int bot;
+
+		// s_overflow: set when the result of an operation in the current
+		// thread did not fit into ints and was approximated.
+		static thread_local bool s_overflow;
 };
 
 
@@ -675,6 +849,10 @@ class HumRegex {
 	protected:
 		std::regex_constants::syntax_option_type
 				getTemporaryRegexFlags(const std::string& sflags);
+		void  setRegex               (const std::string& exp,
+		                              std::regex_constants::syntax_option_type flags);
+		static std::regex getCompiledRegex(const std::string& exp,
+		                              std::regex_constants::syntax_option_type flags);
 		std::regex_constants::match_flag_type
 				getTemporarySearchFlags(const std::string& sflags);
 
@@ -689,6 +867,17 @@ class HumRegex {
 		// .flags()        == return syntax_option_type used to construct.
 		std::regex m_regex;
 
+		// m_expression: the expression string which was compiled into
+		// m_regex.  Used to skip recompiling when the same expression
+		// is used in successive calls.
+		std::string m_expression;
+
+		// m_compiledflags: the syntax flags used to compile m_regex.
+		std::regex_constants::syntax_option_type m_compiledflags;
+
+		// m_compiled: true if m_regex was set by setRegex().
+		bool m_compiled;
+
 		// m_matches: stores the matches from a search:
 		//
 		// http://en.cppreference.com/w/cpp/regex/match_results
@@ -1209,10 +1398,16 @@ class HumdrumLine : public std::string, public HumHash {
 		            HumdrumLine            (void);
 		            HumdrumLine            (const std::string& aString);
 		            HumdrumLine            (const char* aString);
+		            HumdrumLine            (const char* aString, size_t length);
 		            HumdrumLine            (HumdrumLine& line);
 		            HumdrumLine            (HumdrumLine& line, void* owner);
 		           ~HumdrumLine            ();
 
+		static void* operator new          (size_t size)
+		                             { return HumArena::allocateObject(size); }
+		static void  operator delete       (void* pointer)
+		                                  { HumArena::freeObject(pointer); }
+
 		HumdrumLine& operator=             (HumdrumLine& line);
 		bool        isComment              (void) const;
 		bool        isCommentLocal         (void) const;
@@ -1277,6 +1472,10 @@ class HumdrumLine : public std::string, public HumHash {
 		HumdrumFile*  getOwner             (void);
 		void          setText              (const std::string& text);
 		std::string   getText              (void);
+		bool          isDirty              (void) const { return m_dirty; }
+		void          setDirty             (void);
+		void          clearDirty           (void);
+		const std::string& getCleanText    (void) const { return m_cleantext; }
 		int           getBarNumber         (void);
 		int           getMeasureNumber     (void) { return getBarNumber(); }
 
@@ -1409,6 +1608,13 @@ class HumdrumLine : public std::string, public HumHash {
 		// has been added to line.
 		bool m_rhythm_analyzed = false;
 
+		// m_dirty: True if the tokens or text of the line have been changed
+		// since the line was read (or since clearDirty() was called).
+		bool m_dirty = false;
+
+		// m_cleantext: The text of the line before it became dirty.
+		std::string m_cleantext;
+
 		// owner: This is the HumdrumFile which manages the given line.
 		void* m_owner;
 
@@ -1437,6 +1643,11 @@ class HumdrumToken : public std::string, public HumHash {
 		         HumdrumToken              (const std::string& token);
 		        ~HumdrumToken              ();
 
+		static void* operator new          (size_t size)
+		                             { return HumArena::allocateToken(size); }
+		static void  operator delete       (void* pointer)
+		                                  { HumArena::freeObject(pointer); }
+
 		bool     isNull                    (void) const;
 		bool     isManipulator             (void) const;
 
@@ -1686,6 +1897,8 @@ class HumdrumToken : public std::string, public HumHash {
 		void     setStrandIndex            (int index);
 
 		bool     analyzeDuration           (void);
+		void     analyzeOwnerStrands       (void) const;
+		void     analyzeOwnerParameters    (void);
 		std::ostream& printXmlBaseInfo     (std::ostream& out = std::cout, int level = 0,
 		                                    const std::string& indent = "\t");
 		std::ostream& printXmlContentInfo  (std::ostream& out = std::cout, int level = 0,
@@ -1765,6 +1978,7 @@ class HumdrumToken : public std::string, public HumHash {
 	friend class HumdrumFileStructure;
 	friend class HumdrumFileContent;
 	friend class HumdrumFile;
+	friend class GridSlice;
 };
 
 
@@ -1838,6 +2052,9 @@ class HumFileAnalysis {
 			m_phrases_analyzed   = false;
 			m_nulls_analyzed     = false;
 			m_strophes_analyzed  = false;
+			m_parameters_analyzed = false;
+			m_signifiers_analyzed = false;
+			m_notegrid_analyzed  = false;
 
 			m_barlines_analyzed  = false;
 			m_barlines_different = false;
@@ -1871,6 +2088,18 @@ class HumFileAnalysis {
 		// null tokens have been analyzed yet.
 		bool m_nulls_analyzed = false;
 
+		// m_parameters_analyzed: Used to keep track of whether or not
+		// global and local layout parameters have been linked to tokens.
+		bool m_parameters_analyzed = false;
+
+		// m_signifiers_analyzed: Used to keep track of whether or not
+		// !!!RDF signifier records have been stored.
+		bool m_signifiers_analyzed = false;
+
+		// m_notegrid_analyzed: Used to keep track of whether or not the
+		// cached CompactNoteGrid matches the current contents of the file.
+		bool m_notegrid_analyzed = false;
+
 		// m_barlines_analyzed: Used to keep track of wheter or not
 		// barlines have beena analyzed yet.
 		bool m_barlines_analyzed = false;
@@ -1882,6 +2111,8 @@ class HumFileAnalysis {
 
 bool sortTokenPairsByLineIndex(const TokenPair& a, const TokenPair& b);
 
+class CompactNoteGrid;
+
 
 class HumdrumFileBase : public HumHash {
 	public:
@@ -1913,11 +2144,18 @@ class HumdrumFileBase : public HumHash {
 		bool          isQuiet                  (void) const;
 		void          setQuietParsing          (void);
 		void          setNoisyParsing          (void);
+		void          setArenaAllocation       (bool state = true);
+		bool          getArenaAllocation       (void) const;
+		HumArena*     getArena                 (void);
 		void          clear                    (void);
 		bool          isStructureAnalyzed      (void);
 		bool          isRhythmAnalyzed         (void);
 		bool          areStrandsAnalyzed       (void);
 		bool          areStrophesAnalyzed      (void);
+		bool          areParametersAnalyzed    (void);
+		bool          areSignifiersAnalyzed    (void);
+		CompactNoteGrid& getCompactNoteGrid    (void);
+		void          invalidateNoteGrid       (void);
 
     	template <class TYPE>
 		   void       initializeArray          (std::vector<std::vector<TYPE>>& array, TYPE value);
@@ -1999,6 +2237,7 @@ class HumdrumFileBase : public HumHash {
 		int           getTrackEndCount         (int track) const;
 		HTp           getTrackEnd              (int track, int subtrack = 0) const;
 		void          createLinesFromTokens    (void);
+		void          clearDirtyLines          (void);
 		void          removeExtraTabs          (void);
 		void          addExtraTabs             (void);
 		std::vector<int> getTrackWidths        (void);
@@ -2067,6 +2306,13 @@ class HumdrumFileBase : public HumHash {
 		static void   readStringFromHttpUri     (std::stringstream& inputdata,
 		                                         const std::string& webaddress);
 
+		// functions defined in HumdrumFileBase-binary.cpp:
+		bool          readBinary                (const std::string& filename);
+		bool          readBinary                (std::istream& contents);
+		bool          writeBinary               (const std::string& filename);
+		bool          writeBinary               (std::ostream& out);
+		static bool   isBinary                  (const char* contents, size_t size);
+
 	protected:
 		static int    getChunk                  (int socket_id,
 		                                         std::stringstream& inputdata,
@@ -2082,6 +2328,78 @@ class HumdrumFileBase : public HumHash {
 		                                         unsigned short int port);
 
 	protected:
+		bool          readBinaryBuffer          (const char* contents, size_t size);
+		int           getBinaryTokenIndex       (HTp token,
+		                                         const std::vector<int>& offsets);
+		void          appendBinaryToken         (std::string& output, HTp token,
+		                                         int base,
+		                                         const std::vector<int>& offsets);
+		void          appendBinaryTokenList     (std::string& output,
+		                                         const std::vector<HTp>& tokens,
+		                                         int base,
+		                                         const std::vector<int>& offsets);
+		void          appendBinaryTokenPairs    (std::string& output,
+		                                         const std::vector<TokenPair>& pairs,
+		                                         int base,
+		                                         const std::vector<int>& offsets);
+		HTp           getBinaryFieldToken       (int lineindex, int fieldindex);
+		int           getBinaryLinkFlags        (HTp token, int lineindex,
+		                                         int fieldindex);
+		static HTp    getBinaryNullResolve      (HTp token);
+		static bool   isBinaryLink              (const std::vector<HTp>& links,
+		                                         HTp token);
+		static void   setBinaryLink             (std::vector<HTp>& links, HTp token);
+		static void   getBinaryNonNullLinks     (const std::vector<HTp>& links,
+		                                         bool nextQ,
+		                                         std::vector<HTp>& output);
+		static bool   joinBinaryTokens          (HumdrumLine& line,
+		                                         std::string& output);
+		static void   appendBinaryAddress       (std::string& output, HTp token,
+		                                         std::unordered_map<std::string, int>& spineinfos);
+		static void   extractBinaryAddress      (HTp token, const char*& ptr,
+		                                         const char* end, bool& ok,
+		                                         std::vector<std::string>& spineinfos);
+		static int    appendBinaryText          (std::string& output,
+		                                         const std::string& value,
+		                                         std::unordered_map<std::string, int>& table);
+		static int    extractBinaryText         (std::string& output,
+		                                         const char*& ptr, const char* end,
+		                                         bool& ok,
+		                                         std::vector<std::string>& table);
+		static void   appendBinaryInt           (std::string& output, int value);
+		static void   appendBinaryString        (std::string& output,
+		                                         const std::string& value);
+		static void   appendBinaryNum           (std::string& output,
+		                                         const HumNum& value);
+		static int    extractBinaryInt          (const char*& ptr, const char* end,
+		                                         bool& ok);
+		static int    extractBinaryCount        (const char*& ptr, const char* end,
+		                                         bool& ok);
+		static void   extractBinaryString       (std::string& output,
+		                                         const char*& ptr, const char* end,
+		                                         bool& ok);
+		static HumNum extractBinaryNum          (const char*& ptr, const char* end,
+		                                         bool& ok);
+		static HTp    extractBinaryToken        (const char*& ptr, const char* end,
+		                                         bool& ok, int base,
+		                                         const std::vector<HTp>& tokens);
+		static void   extractBinaryTokenList    (std::vector<HTp>& output,
+		                                         const char*& ptr, const char* end,
+		                                         bool& ok, int base,
+		                                         const std::vector<HTp>& tokens);
+		static void   extractBinaryTokenPairs   (std::vector<TokenPair>& output,
+		                                         const char*& ptr, const char* end,
+		                                         bool& ok, int base,
+		                                         const std::vector<HTp>& tokens);
+
+		// BINARY_MAGIC: signature at the start of writeBinary() data.
+		static const char BINARY_MAGIC[9];
+
+		// BINARY_VERSION: version number of the writeBinary() format.
+		static const int BINARY_VERSION;
+
+	protected:
+		bool          readBuffer                (const char* contents, size_t size);
 		bool          analyzeTokens             (void);
 		bool          analyzeSpines             (void);
 		bool          analyzeLinks              (void);
@@ -2172,6 +2490,19 @@ class HumdrumFileBase : public HumHash {
 		// m_analysis: Used to keep track of analysis states for the file.
 		HumFileAnalysis m_analyses;
 
+		// m_arena: Used to allocate lines and tokens when reading data
+		// if m_arenaQ is true.  The arena is cleared with the file.
+		HumArena m_arena;
+
+		// m_arenaQ: Set to true to allocate lines and tokens from m_arena
+		// when reading data rather than individually on the heap.
+		bool m_arenaQ = false;
+
+		// m_notegrid: Cached note grid for the **kern spines, created on
+		// demand by getCompactNoteGrid() and reloaded in place when the
+		// file's contents change.
+		CompactNoteGrid* m_notegrid = NULL;
+
 	public:
 		// Dummy functions to allow the HumdrumFile class's inheritance
 		// to be shifted between HumdrumFileContent (the top-level default),
@@ -2305,8 +2636,12 @@ class HumdrumFileStructure : public HumdrumFileBase {
 
 		bool          analyzeStructure             (void);
 		bool          analyzeStructureNoRhythm     (void);
+		bool          analyzeFromTokens            (void);
 		bool          analyzeRhythmStructure       (void);
 		bool          analyzeStrands               (void);
+		bool          analyzeParameters            (void);
+		void          analyzeSignifiers            (void);
+		bool          analyzeDirtyLines            (int linecount);
 
 		// signifier access
 		std::string   getKernLinkSignifier         (void);
@@ -2316,12 +2651,12 @@ class HumdrumFileStructure : public HumdrumFileBase {
 
 	protected:
 		bool          analyzeRhythm                (void);
+		bool          analyzeStructureFromTimes    (void);
 		bool          assignRhythmFromRecip        (HTp spinestart);
 		bool          analyzeMeter                 (void);
 		bool          analyzeTokenDurations        (void);
 		bool          analyzeGlobalParameters      (void);
 		bool          analyzeLocalParameters       (void);
-		// bool          analyzeParameters            (void);
 		bool          analyzeDurationsOfNonRhythmicSpines(void);
 		HumNum        getMinDur                    (std::vector<HumNum>& durs,
 		                                            std::vector<HumNum>& durstate);
@@ -2349,8 +2684,8 @@ class HumdrumFileStructure : public HumdrumFileBase {
 		bool          assignDurationsToNonRhythmicTrack(HTp endtoken, HTp ptoken);
 		void          analyzeSpineStrands          (std::vector<TokenPair>& ends,
 		                                            HTp starttok);
-		void          analyzeSignifiers            (void);
 		void          setLineRhythmAnalyzed        (void);
+		bool          isAnalysisPreserved          (HumdrumLine& line);
 };
 
 
@@ -3555,9 +3890,92 @@ std::ostream& operator<<(std::ostream& out, MuseDataSet& musedata);
 
 
 
+class HumdrumFileBase;
+
+class CompactNoteGrid {
+	public:
+		enum { REST = INT16_MIN };
+
+		                CompactNoteGrid       (void);
+		                CompactNoteGrid       (HumdrumFileBase& infile);
+		               ~CompactNoteGrid       ();
+
+		void            clear                 (void);
+		bool            load                  (HumdrumFileBase& infile);
+		bool            isValid               (void) const { return m_valid; }
+
+		int             getVoiceCount         (void) const { return m_voices; }
+		int             getSliceCount         (void) const { return m_slices; }
+
+		// Signed pitch values: REST for rests, negative for sustains.
+		const int16_t*  getDiatonicColumn     (int vindex) const;
+		const int16_t*  getMidiColumn         (int vindex) const;
+		const int16_t*  getBase40Column       (int vindex) const;
+		const int16_t*  getAccidentalColumn   (int vindex) const;
+		int             getSgnDiatonicPitch   (int vindex, int sindex) const
+		                                          { return m_b7[index(vindex, sindex)]; }
+		int             getSgnMidiPitch       (int vindex, int sindex) const
+		                                          { return m_b12[index(vindex, sindex)]; }
+		int             getSgnBase40Pitch     (int vindex, int sindex) const
+		                                          { return m_b40[index(vindex, sindex)]; }
+		int             getSgnAccidental      (int vindex, int sindex) const
+		                                          { return m_accidental[index(vindex, sindex)]; }
+
+		bool            isRest                (int vindex, int sindex) const
+		                                          { return m_b40[index(vindex, sindex)] == REST; }
+		bool            isAttack              (int vindex, int sindex) const;
+		bool            isSustained           (int vindex, int sindex) const;
+
+		int             getCurrAttackIndex    (int vindex, int sindex) const
+		                                          { return m_currattack[index(vindex, sindex)]; }
+		int             getPrevAttackIndex    (int vindex, int sindex) const
+		                                          { return m_prevattack[index(vindex, sindex)]; }
+		int             getNextAttackIndex    (int vindex, int sindex) const
+		                                          { return m_nextattack[index(vindex, sindex)]; }
+
+		HTp             getToken              (int vindex, int sindex) const
+		                                          { return m_tokens[index(vindex, sindex)]; }
+		int             getLineIndex          (int sindex) const { return m_lines.at(sindex); }
+		int             getMeterTop           (int vindex, int sindex) const;
+		HumNum          getMeterBottom        (int vindex, int sindex) const;
+		const std::vector<HTp>& getKernSpineStarts(void) const { return m_kernspines; }
+
+		size_t          getMemoryUsage        (void) const;
+
+	protected:
+		int             index                 (int vindex, int sindex) const
+		                                          { return vindex * m_slices + sindex; }
+		void            storePitch            (int cell, HTp token);
+		void            buildAttackIndex      (int vindex);
+
+	private:
+		bool                 m_valid  = false;
+		int                  m_voices = 0;
+		int                  m_slices = 0;
+
+		// Cell columns, stored voice by voice: the cell for a voice and
+		// slice is at index vindex * m_slices + sindex.
+		std::vector<int16_t> m_b7;          // diatonic note number
+		std::vector<int16_t> m_b12;         // MIDI note number
+		std::vector<int16_t> m_b40;         // base-40 note number
+		std::vector<int16_t> m_accidental;  // chromatic alteration
+		std::vector<int16_t> m_meter;       // index into m_meters
+		std::vector<int>     m_currattack;  // slice of the current attack
+		std::vector<int>     m_prevattack;  // slice of previous attack, or -1
+		std::vector<int>     m_nextattack;  // slice of next attack, or -1
+		std::vector<HTp>     m_tokens;      // primary-layer token for cell
+
+		std::vector<int>     m_lines;       // line index for each slice
+		std::vector<HTp>     m_kernspines;  // voice starting tokens
+		std::vector<std::pair<int, HumNum>> m_meters; // distinct time signatures
+};
+
+
+
 #define GRIDREST NAN
 
 class NoteGrid;
+class CompactNoteGrid;
 
 
 class NoteCell {
@@ -3613,6 +4031,8 @@ class NoteCell {
 		std::vector<HTp> m_tiedtokens;  // list of tied notes/rests after note attack
 
 	protected:
+		       NoteCell             (NoteGrid* owner, const CompactNoteGrid& source,
+		                             int vindex, int sindex);
 		void clear                  (void);
 		void calculateNumericPitches(void);
 		void setVoiceIndex          (int index) { m_voice = index;           }
@@ -3695,8 +4115,7 @@ class NoteGrid {
 		HumNum     getNoteDuration       (int vindex, int sindex);
 
 	protected:
-		void       buildAttackIndexes    (void);
-		void       buildAttackIndex      (int vindex);
+		void       buildTiedTokens       (int vindex);
 
 	private:
 		vector<vector<NoteCell*> > m_grid;
@@ -3707,6 +4126,28 @@ class NoteGrid {
 
 
 
+// KernDecoding: pitch and rhythm information extracted from a **kern
+// token by Convert::decodeKern().  Only the first subtoken of a chord
+// is described.
+class KernDecoding {
+	public:
+		int    base7;        // Convert::kernToBase7()
+		int    base12;       // Convert::kernToBase12()
+		int    base40;       // Convert::kernToBase40()
+		int    octave;       // Convert::kernToOctaveNumber()
+		HumNum duration;     // Convert::recipToDuration() in quarter notes
+		short  accidentals;  // Convert::kernToAccidentalCount()
+		short  dots;         // number of augmentation dots
+		bool   rest;         // "r"
+		bool   grace;        // "q" or "Q"
+		bool   tieStart;     // "["
+		bool   tieContinue;  // "_"
+		bool   tieEnd;       // "]"
+		bool   slurStart;    // "("
+		bool   slurEnd;      // ")"
+};
+
+
 class Convert {
 	public:
 
@@ -3717,6 +4158,9 @@ class Convert {
 		static HumNum  recipToDuration      (std::string* recip,
 		                                     HumNum scale = 4,
 		                                     const std::string& separator = " ");
+		static HumNum  recipToDurationUncached(const std::string& recip,
+		                                     HumNum scale = 4,
+		                                     const std::string& separator = " ");
 		static HumNum  recipToDurationIgnoreGrace(const std::string& recip,
 		                                     HumNum scale = 4,
 		                                     const std::string& separator = " ");
@@ -3776,13 +4220,13 @@ class Convert {
 				{ return kernToBase7PC        ((std::string)*token); }
 		static int     kernToBase40         (const std::string& kerndata);
 		static int     kernToBase40         (HTp token)
-				{ return kernToBase40         ((std::string)*token); }
+				{ return kernToBase40         (*token); }
 		static int     kernToBase12         (const std::string& kerndata);
 		static int     kernToBase12         (HTp token)
-				{ return kernToBase12         ((std::string)*token); }
+				{ return kernToBase12         (*token); }
 		static int     kernToBase7          (const std::string& kerndata);
 		static int     kernToBase7          (HTp token)
-				{ return kernToBase7          ((std::string)*token); }
+				{ return kernToBase7          (*token); }
 		static std::string  kernToRecip     (const std::string& kerndata);
 		static std::string  kernToRecip     (HTp token);
 		static int     kernToMidiNoteNumber (const std::string& kerndata);
@@ -3877,6 +4321,10 @@ class Convert {
 
 		static bool isKernSecondaryTiedNote (const std::string& kerndata);
 		static std::string getKernPitchAttributes(const std::string& kerndata);
+		static const KernDecoding& decodeKern(const std::string& kerndata);
+		static const KernDecoding& decodeKern(HTp token)
+				{ return decodeKern(*token); }
+		static void clearKernDecodings      (void);
 
 		// String processing, defined in Convert-string.cpp
 		static std::vector<std::string> splitString   (const std::string& data,
@@ -3894,6 +4342,8 @@ class Convert {
 		static bool    contains(const std::string& input, char pattern);
 		static bool    contains(std::string* input, const std::string& pattern);
 		static bool    contains(std::string* input, char pattern);
+		static void    appendLittleEndian   (std::string& output, uint64_t value,
+		                                     int bytes);
 		static void    makeBooleanTrackList(std::vector<bool>& spinelist,
 		                                     const std::string& spinestring,
 		                                     int maxtrack);
@@ -3924,6 +4374,19 @@ class Convert {
 		static std::string getReferenceKeyMeaning(HTp token);
 		static std::string getReferenceKeyMeaning(const std::string& token);
 		static std::string getLanguageName(const std::string& abbreviation);
+
+	private:
+		static void fillKernDecoding(KernDecoding& decoding,
+		                             const std::string& kerndata);
+
+		// s_kernDecodings: per-thread cache of decodeKern() results,
+		// indexed by token text.
+		static thread_local std::unordered_map<std::string, KernDecoding>
+				s_kernDecodings;
+
+		// s_lastKernDecoding: the most recent decodeKern() result.
+		static thread_local const std::pair<const std::string, KernDecoding>*
+				s_lastKernDecoding;
 };
 
 
@@ -4067,6 +4530,8 @@ class MxmlPart {
 		                                    xml_node part);
 		bool          addMeasure           (xml_node mel);
 		bool          addMeasure           (xpath_node mel);
+		void          deleteMeasure        (int index);
+		void          clearMeasures        (void);
 		int           getMeasureCount      (void) const;
 		MxmlMeasure*  getMeasure           (int index) const;
 		long          getQTicks            (void) const;
@@ -4179,6 +4644,10 @@ class GridStaff : public std::vector<GridVoice*>, public GridSide {
 	public:
 		GridStaff(void);
 		~GridStaff();
+		static void* operator new   (size_t size)
+		                             { return HumArena::allocateObject(size); }
+		static void  operator delete(void* pointer)
+		                                  { HumArena::freeObject(pointer); }
 		GridVoice* setTokenLayer (int layerindex, HTp token, HumNum duration);
 		void setNullTokenLayer   (int layerindex, SliceType type, HumNum nextdur);
 		void appendTokenLayer    (int layerindex, HTp token, HumNum duration,
@@ -4195,6 +4664,10 @@ class GridPart : public std::vector<GridStaff*>, public GridSide {
 	public:
 		GridPart(void);
 		~GridPart();
+		static void* operator new   (size_t size)
+		                             { return HumArena::allocateObject(size); }
+		static void  operator delete(void* pointer)
+		                                  { HumArena::freeObject(pointer); }
 
 	private:
 		std::string m_partName;
@@ -4320,6 +4793,10 @@ class GridSlice : public std::vector<GridPart*> {
 		GridSlice(GridMeasure* measure, HumNum timestamp, SliceType type,
 		          GridSlice* slice);
 		~GridSlice();
+		static void* operator new   (size_t size)
+		                             { return HumArena::allocateObject(size); }
+		static void  operator delete(void* pointer)
+		                                  { HumArena::freeObject(pointer); }
 
 		bool isNoteSlice(void)          { return m_type == SliceType::Notes;            }
 		bool isGraceSlice(void)         { return m_type == SliceType::GraceNotes;       }
@@ -4402,6 +4879,10 @@ class GridVoice {
 		GridVoice(const char* token, HumNum duration);
 		GridVoice(const std::string& token, HumNum duration);
 		~GridVoice();
+		static void* operator new   (size_t size)
+		                             { return HumArena::allocateObject(size); }
+		static void  operator delete(void* pointer)
+		                                  { HumArena::freeObject(pointer); }
 
 		bool   isTransfered       (void);
 
@@ -4442,6 +4923,7 @@ class HumGrid : public std::vector<GridMeasure*> {
 		HumGrid(void);
 		~HumGrid();
 		void enableRecipSpine           (void);
+		HumArena* getArena              (void);
 		bool transferTokens             (HumdrumFile& outfile, int startbarnum = 0);
 		int  getHarmonyCount            (int partindex);
 		int  getDynamicsCount           (int partindex);
@@ -4465,6 +4947,8 @@ class HumGrid : public std::vector<GridMeasure*> {
 		void setPartName                (int index, const string& name);
 		std::string getPartName         (int index);
 		void addInvisibleRestsInFirstTrack(void);
+		void addInvisibleRestsInFirstTrack(std::vector<std::vector<GridSlice*>>& nextevent,
+		                                 int i);
 		void setPartStaffDimensions     (std::vector<std::vector<GridSlice*>>& nextevent,
 		                                 GridSlice* startslice);
 		void addInvisibleRest           (std::vector<std::vector<GridSlice*>>& nextevent,
@@ -4484,10 +4968,10 @@ class HumGrid : public std::vector<GridMeasure*> {
 		void insertStaffIndications        (HumdrumFile& outfile);
 		void insertPartNames               (HumdrumFile& outfile);
 		void addNullTokens                 (void);
-		void addNullTokensForGraceNotes    (void);
-		void addNullTokensForClefChanges   (void);
-		void addNullTokensForLayoutComments(void);
-		void checkForNullDataHoles         (void);
+		bool finalizeSlices                (void);
+		void fillInNullTokens              (std::vector<GridSlice*>& slices,
+		                                    GridSlice* lastnote, GridSlice* nextnote);
+		void checkForNullDataHoles         (int i);
 
 		void fillInNullTokensForGraceNotes(GridSlice* graceslice, GridSlice* lastnote,
 		                                   GridSlice* nextnote);
@@ -4499,10 +4983,10 @@ class HumGrid : public std::vector<GridMeasure*> {
 		void extendDurationToken           (int slicei, int parti,
 		                                    int staffi, int voicei);
 		GridVoice* getGridVoice(int slicei, int parti, int staffi, int voicei);
-		void addMeasureLines               (void);
+		GridSlice* addMeasureLine          (int m, std::vector<int>& barnums);
 		void addLastMeasure                (void);
-		bool manipulatorCheck              (void);
 		GridSlice* manipulatorCheck        (GridSlice* ice1, GridSlice* ice2);
+		bool hasSameVoiceCounts            (GridSlice* ice1, GridSlice* ice2);
 		void cleanupManipulators           (void);
 		void cleanManipulator              (std::vector<GridSlice*>& newslices,
 		                                    GridSlice* curr);
@@ -4530,7 +5014,6 @@ class HumGrid : public std::vector<GridMeasure*> {
 		void insertMelodyString            (GridMeasure* measure, const string& melody);
 		GridVoice* createVoice             (const string& tok, const string& post, HumNum duration, int pindex, int sindex);
 		HTp createHumdrumToken             (const string& tok, int pindex, int sindex);
-		GridSlice* getNextSpinedLine       (const GridMeasure::iterator& it, int measureindex);
 		void matchVoices                   (GridSlice* current, GridSlice* last);
 		void adjustVoices                  (GridSlice* curr, GridSlice* newmanip, int partsplit);
 		void createMatchedVoiceCount       (GridStaff* snew, GridStaff* sold, int p, int s);
@@ -4548,6 +5031,15 @@ class HumGrid : public std::vector<GridMeasure*> {
 
 		std::vector<std::string>      m_partnames;
 
+		// m_arena: Used to allocate the slices, parts, staves and voices
+		// of the grid when it is the active arena.
+		HumArena                      m_arena;
+
+		// m_tokenarena: Used to allocate the tokens of the grid when
+		// m_arena is the active arena.  The tokens are moved into the
+		// output file, so its blocks are freed with the output file.
+		HumArena                      m_tokenarena;
+
 		// options:
 		bool m_recip;               // include **recip spine in output
 		bool m_musicxmlbarlines;    // use measure numbers from <measure> element
@@ -4684,7 +5176,7 @@ class MxmlEvent {
 		std::vector<MxmlEvent*> m_links;   // list of secondary chord notes
 		bool               m_linked;       // true if a secondary chord note
 		int                m_sequence;     // ordering of event in XML file
-		static int         m_counter;      // counter for sequence variable
+		static thread_local int m_counter; // counter for sequence variable
 		short              m_staff;        // staff number in part for event
 		short              m_voice;        // voice number in part for event
 		int                m_voiceindex;   // voice index of item (remapping)
@@ -4821,6 +5313,53 @@ class MxmlMeasure {
 
 
 
+class MxmlStream {
+	public:
+		              MxmlStream           (void);
+		             ~MxmlStream           ();
+		void          clear                (void);
+		bool          open                 (const string& filename);
+		bool          loadSkeleton         (xml_document& doc);
+		int           getPartCount         (void) const;
+		int           getPartIndex         (const string& id) const;
+		int           getMeasureCount      (int partindex) const;
+		xml_node      loadMeasure          (xml_document& doc, int partindex,
+		                                    int measureindex);
+		const string& getError             (void) const;
+
+	protected:
+		bool          scan                 (void);
+		size_t        skipPast             (size_t index, const char* target);
+		size_t        findTagEnd           (size_t index);
+		string        getTagName           (size_t index);
+		bool          isUtf8               (void);
+
+	private:
+		// m_file: the contents of the MusicXML file.
+		HumMemoryMap m_file;
+
+		// m_data: the contents of m_file.
+		const char* m_data;
+
+		// m_size: the number of bytes in m_data.
+		size_t m_size;
+
+		// m_partids: the id attribute of each part element, in file order.
+		vector<string> m_partids;
+
+		// m_contents: the byte range of the contents of each part element
+		// (between its start and end tags).
+		vector<pair<size_t, size_t>> m_contents;
+
+		// m_measures: the byte range of each measure element in each part.
+		vector<vector<pair<size_t, size_t>>> m_measures;
+
+		// m_error: description of the problem if the file cannot be indexed.
+		string m_error;
+};
+
+
+
 class Option_register {
 	public:
 		         Option_register     (void);
@@ -4982,6 +5521,102 @@ class Options {
 
 
 
+class HumdrumFileSet;
+
+class HumdrumFileStream {
+	public:
+		                HumdrumFileStream  (void);
+		                HumdrumFileStream  (char** list);
+		                HumdrumFileStream  (const std::vector<std::string>& list);
+		                HumdrumFileStream  (Options& options);
+		                HumdrumFileStream  (const string& datastream);
+
+		void            loadString         (const string& data);
+		int             loadFile           (const std::string& filename);
+
+		int             setFileList        (char** list);
+		int             setFileList        (const std::vector<std::string>& list);
+
+		void            clear              (void);
+		int             eof                (void);
+
+		int             getFile            (HumdrumFile& infile);
+		int             read               (HumdrumFile& infile);
+		int             read               (HumdrumFileSet& infiles);
+		int             read               (HumdrumFileSet& infiles, int threads);
+		int             readSingleSegment  (HumdrumFileSet& infiles);
+
+		int             getSegment         (std::string& contents,
+		                                    std::string& filename);
+		static void     parseSegment       (HumdrumFile& infile,
+		                                    const std::string& contents,
+		                                    const std::string& filename);
+
+	protected:
+		std::stringstream m_stringbuffer;   // used to read files from a string
+		HumMemoryMap      m_mapfile;        // used to read from list of files
+		std::stringstream m_urlbuffer;      // used to read data over internet
+		std::string       m_newfilebuffer;  // used to keep track of !!!!segment:
+		                                    // records.
+
+		std::vector<std::string>  m_filelist;       // used when not using cin
+		int                       m_curfile;        // index into filelist
+
+		std::vector<std::string>  m_universals;     // storage for universal comments
+
+		// Automatic URL downloading of data from internet in read():
+		void     fillUrlBuffer            (std::stringstream& uribuffer,
+		                                   const std::string& uriname);
+
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////
+
+class HumdrumFileSet {
+   public:
+                            HumdrumFileSet   (void);
+                            HumdrumFileSet   (Options& options);
+                            HumdrumFileSet   (const std::string& contents);
+                           ~HumdrumFileSet   ();
+
+      void                  clear            (void);
+      void                  clearNoFree      (void);
+      int                   getSize          (void);
+      int                   getCount         (void) { return getSize(); }
+      HumdrumFile&          operator[]       (int index);
+		bool                  swap             (int index1, int index2);
+		bool                  hasFilters       (void);
+		bool                  hasGlobalFilters    (void);
+		bool                  hasUniversalFilters (void);
+		std::vector<HLp>      getUniversalReferenceRecords(void);
+
+      int                   readFile         (const std::string& filename);
+      int                   readString       (const std::string& contents);
+      int                   readStringCsv    (const std::string& contents);
+      int                   read             (std::istream& inStream);
+      int                   read             (Options& options);
+      int                   read             (HumdrumFileStream& instream);
+
+      int                   readAppendFile   (const std::string& filename);
+      int                   readAppendString (const std::string& contents);
+      int                   readAppendStringCsv (const std::string& contents);
+      int                   readAppend       (std::istream& inStream);
+      int                   readAppend       (Options& options);
+      int                   readAppend       (HumdrumFileStream& instream);
+      int                   readAppendHumdrum(HumdrumFile& infile);
+		int                   appendHumdrumPointer(HumdrumFile* infile);
+
+   protected:
+      vector<HumdrumFile*>  m_data;
+
+      void                  appendHumdrumFileContent(const std::string& filename,
+                                               std::stringstream& inbuffer);
+};
+
+
+
 class HumTool : public Options {
 	public:
 		              HumTool         (void);
@@ -5015,6 +5650,10 @@ class HumTool : public Options {
 		ostream&      getError        (ostream& out);
 		void          setError        (const string& message);
 
+		void          defineThreadOption(void);
+		int           getThreadCount  (void);
+		int           getThreadCount  (const std::string& option);
+
 	protected:
 		std::stringstream m_humdrum_text;  // output text in Humdrum syntax.
 		std::stringstream m_json_text;     // output text in JSON syntax.
@@ -5027,6 +5666,286 @@ class HumTool : public Options {
 };
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// StreamSegmentResult -- The output of processing one input segment
+//    in runStreamPool().
+//
+
+class StreamSegmentResult {
+	public:
+		bool        status = true;   // false if the segment failed
+		bool        error  = false;  // stop processing after this segment
+		std::string text;            // written to the output stream
+		std::string warning;         // written to std::cerr
+		std::string errortext;       // written to std::cerr
+};
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// runStreamPool -- Process the segments of an input stream with a pool
+//    of threads.  A reader thread splits the input into segments, and
+//    each worker thread parses a segment into its own HumdrumFileSet
+//    and calls process(tool, infiles, result) with a separate instance
+//    of the tool (TOOL) which has processed the given command-line
+//    arguments.  The calling thread writes the text of the results
+//    to out (and their warnings and errors to std::cerr) in input
+//    order, and stops after a result which sets its error flag.  When
+//    a worker thread has finished, finish(tool) is called with its
+//    instance of the tool while no other thread is finishing, so that
+//    counts kept by each instance can be merged.  At most four
+//    segments for each thread are kept in memory.  Returns -1 if
+//    processing was stopped by an error, 1 if any result had a false
+//    status, and 0 otherwise.
+//
+
+template <class TOOL, class PROCESS, class FINISH>
+int runStreamPool(HumdrumFileStream& instream,
+		const std::vector<std::string>& arguments, int threads,
+		std::ostream& out, PROCESS process, FINISH finish) {
+
+	if (threads < 1) {
+		threads = 1;
+	}
+	int maxqueue = 4 * threads;   // maximum number of segments in memory
+
+	std::mutex mutex;
+	std::condition_variable readercv;  // reader waiting for queue space
+	std::condition_variable workercv;  // workers waiting for segments
+	std::condition_variable writercv;  // writer waiting for results
+	std::deque<std::pair<int, std::pair<std::string, std::string>>> segments;
+	std::map<int, StreamSegmentResult> results;
+	int readcount  = 0;      // number of segments read so far
+	int writecount = 0;      // number of segments written so far
+	bool readdone  = false;  // all segments have been read
+	bool abort     = false;  // stop processing after an error
+
+	auto reader = [&]() {
+		std::string contents;
+		std::string filename;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				readercv.wait(lock, [&]() {
+					return abort || (readcount - writecount < maxqueue);
+				});
+				if (abort) {
+					break;
+				}
+			}
+			if (!instream.getSegment(contents, filename)) {
+				break;
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			segments.emplace_back(readcount++, std::make_pair(contents, filename));
+			workercv.notify_one();
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		readdone = true;
+		workercv.notify_all();
+		writercv.notify_all();
+	};
+
+	auto worker = [&]() {
+		TOOL tool;
+		tool.process(arguments);
+		while (true) {
+			std::pair<int, std::pair<std::string, std::string>> segment;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				workercv.wait(lock, [&]() {
+					return abort || readdone || !segments.empty();
+				});
+				if (abort || segments.empty()) {
+					break;
+				}
+				segment = std::move(segments.front());
+				segments.pop_front();
+			}
+			HumdrumFileSet infiles;
+			HumdrumFile* infile = new HumdrumFile;
+			HumdrumFileStream::parseSegment(*infile, segment.second.first,
+					segment.second.second);
+			infiles.appendHumdrumPointer(infile);
+
+			StreamSegmentResult result;
+			process(tool, infiles, result);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			results[segment.first] = std::move(result);
+			writercv.notify_one();
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		finish(tool);
+	};
+
+	std::thread readthread(reader);
+	std::vector<std::thread> pool;
+	for (int i=0; i<threads; i++) {
+		pool.emplace_back(worker);
+	}
+
+	int output = 0;
+	while (true) {
+		StreamSegmentResult result;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			writercv.wait(lock, [&]() {
+				return (results.find(writecount) != results.end())
+						|| (readdone && (writecount == readcount));
+			});
+			auto it = results.find(writecount);
+			if (it == results.end()) {
+				break;
+			}
+			result = std::move(it->second);
+			results.erase(it);
+			writecount++;
+			readercv.notify_one();
+		}
+		if (!result.status) {
+			output = 1;
+		}
+		std::cerr << result.warning;
+		out << result.text;
+		std::cerr << result.errortext;
+		if (result.error) {
+			output = -1;
+			break;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		abort = true;
+		readercv.notify_all();
+		workercv.notify_all();
+	}
+	readthread.join();
+	for (int i=0; i<(int)pool.size(); i++) {
+		pool[i].join();
+	}
+	return output;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// runParallelStream -- Multi-threaded version of STREAM_INTERFACE, used
+//    when the -j option is larger than one.  Each segment of the input
+//    is processed by a separate instance of the tool in runStreamPool(),
+//    and the results are printed in input order.  The output is
+//    identical to the serial interface for tools which process each
+//    segment independently.  Only tools which define the -j option with
+//    HumTool::defineThreadOption() in their constructor can run here,
+//    so each worker's instance of the tool also accepts the
+//    command-line options.
+//
+
+template <class TOOL>
+int runParallelStream(TOOL& interface, int argc, char** argv) {
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	std::vector<std::string> arguments(argv, argv + argc);
+
+	auto process = [](TOOL& tool, HumdrumFileSet& infiles,
+			StreamSegmentResult& result) {
+		std::stringstream text;
+		result.status = tool.run(infiles);
+		if (tool.hasWarning()) {
+			result.warning = tool.getWarning();
+		}
+		if (tool.hasAnyText()) {
+			tool.getAllText(text);
+		}
+		if (tool.hasError()) {
+			result.error = true;
+			result.errortext = tool.getError();
+		} else if (!tool.hasAnyText()) {
+			for (int i=0; i<infiles.getCount(); i++) {
+				text << infiles[i];
+			}
+		}
+		result.text = text.str();
+		tool.clearOutput();
+	};
+
+	return runStreamPool<TOOL>(instream, arguments,
+			interface.getThreadCount(), std::cout, process, [](TOOL& tool) {});
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// runStreamInterface -- Process each segment of the input stream
+//    separately and print the results (the body of STREAM_INTERFACE).
+//    The command-line options must already have been processed.  The
+//    segments are processed in parallel if the tool defines the -j
+//    option and it is larger than one.
+//
+
+template <class TOOL>
+int runStreamInterface(TOOL& interface, int argc, char** argv) {
+	if (interface.getThreadCount() > 1) {
+		return runParallelStream(interface, argc, argv);
+	}
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	HumdrumFileSet infiles;
+	bool status = true;
+	while (instream.readSingleSegment(infiles)) {
+		status &= interface.run(infiles);
+		if (interface.hasWarning()) {
+			interface.getWarning(std::cerr);
+		}
+		if (interface.hasAnyText()) {
+			interface.getAllText(std::cout);
+		}
+		if (interface.hasError()) {
+			interface.getError(std::cerr);
+			return -1;
+		}
+		if (!interface.hasAnyText()) {
+			for (int i=0; i<infiles.getCount(); i++) {
+				std::cout << infiles[i];
+			}
+		}
+		interface.clearOutput();
+	}
+	return !status;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// runBatchStream -- Send the entire input stream to the tool's
+//    .run(HumdrumFileStream& instream, ostream& out) function, which
+//    writes its results for all input files to standard output.
+//
+
+template <class TOOL>
+int runBatchStream(TOOL& interface) {
+	HumdrumFileStream instream(static_cast<Options&>(interface));
+	bool status = interface.run(instream, std::cout);
+	if (interface.hasWarning()) {
+		interface.getWarning(std::cerr);
+	}
+	if (interface.hasAnyText()) {
+		interface.getAllText(std::cout);
+	}
+	if (interface.hasError()) {
+		interface.getError(std::cerr);
+		return -1;
+	}
+	interface.clearOutput();
+	return !status;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // common command-line Interfaces
@@ -5075,7 +5994,8 @@ int main(int argc, char** argv) {                      \
 //////////////////////////////
 //
 // STREAM_INTERFACE -- Use HumdrumFileStream (low-memory
-//    usage implementation).
+//    usage implementation).  Tools which define the -j option
+//    process the input segments in parallel.
 //
 
 #define STREAM_INTERFACE(CLASS)                                  \
@@ -5087,29 +6007,33 @@ int main(int argc, char** argv) {                                \
 		interface.getError(cerr);                                  \
 		return -1;                                                 \
 	}                                                             \
-	HumdrumFileStream instream(static_cast<Options&>(interface)); \
-	HumdrumFileSet infiles;                                       \
-	bool status = true;                                           \
-	while (instream.readSingleSegment(infiles)) {                 \
-		status &= interface.run(infiles);                          \
-		if (interface.hasWarning()) {                              \
-			interface.getWarning(cerr);                             \
-		}                                                          \
-		if (interface.hasAnyText()) {                              \
-		   interface.getAllText(cout);                             \
-		}                                                          \
-		if (interface.hasError()) {                                \
-			interface.getError(cerr);                               \
-         return -1;                                              \
-		}                                                          \
-		if (!interface.hasAnyText()) {                             \
-			for (int i=0; i<infiles.getCount(); i++) {              \
-				cout << infiles[i];                                  \
-			}                                                       \
-		}                                                          \
-		interface.clearOutput();                                   \
+	return runStreamInterface(interface, argc, argv);             \
+}
+
+
+
+//////////////////////////////
+//
+// STREAM_BATCH_INTERFACE -- STREAM_INTERFACE for tools which can
+//    also summarize all input files at once.  When the tool's
+//    .isBatchMode() returns true, the whole HumdrumFileStream is sent
+//    to .run(HumdrumFileStream& instream, ostream& out); otherwise each
+//    input file is processed separately.
+//
+
+#define STREAM_BATCH_INTERFACE(CLASS)                            \
+using namespace std;                                             \
+using namespace hum;                                             \
+int main(int argc, char** argv) {                                \
+	CLASS interface;                                              \
+	if (!interface.process(argc, argv)) {                         \
+		interface.getError(cerr);                                  \
+		return -1;                                                 \
 	}                                                             \
-	return !status;                                               \
+	if (interface.isBatchMode()) {                                \
+		return runBatchStream(interface);                          \
+	}                                                             \
+	return runStreamInterface(interface, argc, argv);             \
 }
 
 
@@ -5151,7 +6075,8 @@ int main(int argc, char** argv) {                                \
 //////////////////////////////
 //
 // SET_INTERFACE -- Use HumdrumFileSet (multiple file high-memory
-//    usage implementation).
+//    usage implementation).  Tools which define the -j option parse
+//    the input files in parallel.
 //
 
 #define SET_INTERFACE(CLASS)                                     \
@@ -5165,7 +6090,7 @@ int main(int argc, char** argv) {                                \
 	}                                                             \
 	HumdrumFileStream instream(static_cast<Options&>(interface)); \
 	HumdrumFileSet infiles;                                       \
-	instream.read(infiles);                                       \
+	instream.read(infiles, interface.getThreadCount());           \
 	bool status = interface.run(infiles);                         \
 	if (interface.hasWarning()) {                                 \
 		interface.getWarning(cerr);                                \
@@ -5188,94 +6113,6 @@ int main(int argc, char** argv) {                                \
 
 
 
-class HumdrumFileSet;
-
-class HumdrumFileStream {
-	public:
-		                HumdrumFileStream  (void);
-		                HumdrumFileStream  (char** list);
-		                HumdrumFileStream  (const std::vector<std::string>& list);
-		                HumdrumFileStream  (Options& options);
-		                HumdrumFileStream  (const string& datastream);
-
-		void            loadString         (const string& data);
-
-		int             setFileList        (char** list);
-		int             setFileList        (const std::vector<std::string>& list);
-
-		void            clear              (void);
-		int             eof                (void);
-
-		int             getFile            (HumdrumFile& infile);
-		int             read               (HumdrumFile& infile);
-		int             read               (HumdrumFileSet& infiles);
-		int             readSingleSegment  (HumdrumFileSet& infiles);
-
-	protected:
-		std::stringstream m_stringbuffer;   // used to read files from a string
-		std::ifstream     m_instream;       // used to read from list of files
-		std::stringstream m_urlbuffer;      // used to read data over internet
-		std::string       m_newfilebuffer;  // used to keep track of !!!!segment:
-		                                    // records.
-
-		std::vector<std::string>  m_filelist;       // used when not using cin
-		int                       m_curfile;        // index into filelist
-
-		std::vector<std::string>  m_universals;     // storage for universal comments
-
-		// Automatic URL downloading of data from internet in read():
-		void     fillUrlBuffer            (std::stringstream& uribuffer,
-		                                   const std::string& uriname);
-
-};
-
-
-
-///////////////////////////////////////////////////////////////////////////
-
-class HumdrumFileSet {
-   public:
-                            HumdrumFileSet   (void);
-                            HumdrumFileSet   (Options& options);
-                            HumdrumFileSet   (const std::string& contents);
-                           ~HumdrumFileSet   ();
-
-      void                  clear            (void);
-      void                  clearNoFree      (void);
-      int                   getSize          (void);
-      int                   getCount         (void) { return getSize(); }
-      HumdrumFile&          operator[]       (int index);
-		bool                  swap             (int index1, int index2);
-		bool                  hasFilters       (void);
-		bool                  hasGlobalFilters    (void);
-		bool                  hasUniversalFilters (void);
-		std::vector<HLp>      getUniversalReferenceRecords(void);
-
-      int                   readFile         (const std::string& filename);
-      int                   readString       (const std::string& contents);
-      int                   readStringCsv    (const std::string& contents);
-      int                   read             (std::istream& inStream);
-      int                   read             (Options& options);
-      int                   read             (HumdrumFileStream& instream);
-
-      int                   readAppendFile   (const std::string& filename);
-      int                   readAppendString (const std::string& contents);
-      int                   readAppendStringCsv (const std::string& contents);
-      int                   readAppend       (std::istream& inStream);
-      int                   readAppend       (Options& options);
-      int                   readAppend       (HumdrumFileStream& instream);
-      int                   readAppendHumdrum(HumdrumFile& infile);
-		int                   appendHumdrumPointer(HumdrumFile* infile);
-
-   protected:
-      vector<HumdrumFile*>  m_data;
-
-      void                  appendHumdrumFileContent(const std::string& filename,
-                                               std::stringstream& inbuffer);
-};
-
-
-
 
 class Tool_autobeam : public HumTool {
 	public:
@@ -5419,16 +6256,33 @@ class Tool_binroll : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const string& indata, ostream& out);
 		bool     run               (HumdrumFile& infile, ostream& out);
+		bool     run               (HumdrumFileStream& instream, ostream& out);
 
 	protected:
-		void     processFile       (HumdrumFile& infile);
+		void     initialize        (void);
+		void     processFile       (HumdrumFile& infile, ostream& out);
 		void     processStrand     (vector<vector<char>>& roll, HTp starting,
-		                            HTp ending);
+		                            HTp ending, int voice);
+		void     storeNote         (vector<vector<char>>& roll, int voice,
+		                            int base12, int startindex, int endindex);
 		void     printAnalysis     (HumdrumFile& infile,
-		                            vector<vector<char>>& roll);
+		                            vector<vector<char>>& roll, ostream& out);
+		void     writeBinaryRoll   (ostream& out, int steps);
+		void     writeWords        (ostream& out, const uint64_t* words,
+		                            size_t count);
 
 	private:
 		HumNum    m_duration;
+		bool      m_binaryQ = false;   // used with -b option
+		bool      m_rleQ    = false;   // used with -r option
+		int       m_low     = 0;       // used with --low option
+		int       m_high    = 127;     // used with --high option
+		int       m_voices  = 0;       // number of **kern spines
+		int       m_words   = 0;       // 64-bit words for pitch range
+		// m_bits: packed binary roll: for each time step and voice,
+		// m_words words of sounding notes followed by m_words words
+		// of note attacks.
+		vector<uint64_t> m_bits;
 
 };
 
@@ -5648,6 +6502,19 @@ class Tool_cint : public HumTool {
 		int       getTriangleIndex(int number, int num1, int num2);
 		void      adjustKTracks        (vector<int>& ktracks, const string& koption);
 		int       getMeasure           (HumdrumFile& infile, int line);
+		int       printModuleCounts    (HumdrumFile& infile, vector<int>& ktracks,
+		                                vector<int>& reverselookup);
+		int       extractNoteMatrix    (vector<int>& pitches, HumdrumFile& infile,
+		                                vector<int>& reverselookup, int voices);
+		void      countPairModules     (vector<pair<string, int>>& counts,
+		                                const int* pitch1, const int* pitch2,
+		                                int rows, int n);
+		int64_t   getIntervalCode      (int b40a, int b40b, int type);
+		int       getIntervalValue     (int b40a, int b40b, int type,
+		                                int octaveadjust = 0);
+		void      printModuleLabel     (ostream& out, const int* pitch1,
+		                                const int* pitch2, const vector<int>& events,
+		                                int start, int n);
 
 	private:
 
@@ -5689,6 +6556,8 @@ class Tool_cint : public HumTool {
 		int       markQ        = 0;      // used with --mark option
 		int       countQ       = 0;      // used with --count option
 		int       suspensionsQ = 0;      // used with --suspensions option
+		int       moduleCountQ = 0;      // used with --module-counts option
+		int       jsonQ        = 0;      // used with --json option
 		int       uncrossQ     = 0;      // used with -c option
 		int       retroQ       = 0;      // used with --retro option
 		int       idQ          = 0;      // used with --id option
@@ -5782,6 +6651,9 @@ class Tool_dissonant : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const string& indata, ostream& out);
 		bool     run               (HumdrumFile& infile, ostream& out);
+		bool     run               (HumdrumFileStream& instream);
+		bool     run               (HumdrumFileStream& instream, ostream& out);
+		bool     isBatchMode       (void);
 
 	protected:
 		void    doAnalysis         (vector<vector<string> >& results,
@@ -5815,6 +6687,11 @@ class Tool_dissonant : public HumTool {
 		void    fillLabels         (void);
 		void    fillLabels2        (void);
 		void    printCountAnalysis (vector<vector<string> >& data);
+		void    countAnalysis      (vector<map<string, int> >& analysis,
+		                            vector<vector<string> >& data);
+		void    printCountTable    (vector<map<string, int> >& analysis);
+		void    storeLowestNotes   (NoteGrid& grid);
+		void    storeVoiceFeatures (vector<NoteCell*>& attacks, int vindex);
 		void    suppressDissonances(HumdrumFile& infile, NoteGrid& grid,
 		                            vector<vector<NoteCell* > >& attacks,
 		                            vector<vector<string> >& results);
@@ -5859,6 +6736,19 @@ class Tool_dissonant : public HumTool {
 
 		vector<string> m_labels;
 
+		// Features of the note/rest attacks in each voice, indexed by voice
+		// and then by attack (the interval is from the previous attack).
+		// These are shared by the dissonance candidate checks:
+		vector<vector<double> > m_intervals;  // diatonic melodic intervals
+		vector<vector<HumNum> > m_durations;  // durations to next attacks
+		vector<vector<double> > m_levels;     // metric levels
+		vector<int>             m_lowestnote; // lowest diatonic note in slice
+
+		// Accumulated counts (--batch):
+		bool                          m_accumulateQ = false;
+		vector<map<string, int> >     m_counts;
+		int                           m_filecount = 0;
+
 		// unaccdented non-harmonic tones:
 		const int PASSING_UP           =  0; // rising passing tone
 		const int PASSING_DOWN         =  1; // downward passing tone
@@ -6160,34 +7050,13 @@ class Tool_filter : public HumTool {
 		void     removeGlobalFilterLines    (HumdrumFile& infile);
 		void     removeUniversalFilterLines (HumdrumFileSet& infiles);
 		void     splitPipeline      (vector<string>& clist, const string& command);
+		void     updateFile         (HumdrumFile& infile, const string& text,
+		                             int linecount);
 
 	private:
 		string   m_variant;        // used with -v option.
 		bool     m_debugQ = false; // used with --debug option
-
-};
-
-
-class Tool_fixps : public HumTool {
-	public:
-		         Tool_fixps         (void);
-		        ~Tool_fixps         () {};
-
-		bool     run                (HumdrumFileSet& infiles);
-		bool     run                (HumdrumFile& infile);
-		bool     run                (const string& indata, ostream& out);
-		bool     run                (HumdrumFile& infile, ostream& out);
-
-	protected:
-		void     initialize         (HumdrumFile& infile);
-		void     processFile        (HumdrumFile& infile);
-		void     markEmptyVoices    (HumdrumFile& infile);
-		void     removeEmpties      (vector<vector<HTp>>& newlist, HumdrumFile& infile);
-		void     removeDuplicateDynamics(HumdrumFile& infile);
-		void     outputNewSpining   (vector<vector<HTp>>& newlist, HumdrumFile& infile);
-		void     printNewManipulator(HumdrumFile& infile, vector<vector<HTp>>& newlist, int line);
-
-	private:
+		bool     m_reparseQ = false; // used with --reparse option
 
 };
 
@@ -6384,6 +7253,29 @@ class NotePoint {
 };
 
 
+// MeasurePoint is a measure from a score (or the music before the first
+// barline) which is aligned to measures in another score by a fingerprint
+// of its notes.
+class MeasurePoint {
+	public:
+		int               measure     = -1;  // measure number
+		int               line        = -1;  // line index of barline (or first data line)
+		HumNum            duration    = 0;   // duration of measure
+		uint64_t          fingerprint = 0;   // hash of duration and note keys
+		vector<NotePoint> notes;             // sorted by onset, pitch and duration
+		vector<uint64_t>  keys;              // hash of onset, pitch and duration of notes
+
+		void clear(void) {
+			measure = -1;
+			line = -1;
+			duration = 0;
+			fingerprint = 0;
+			notes.clear();
+			keys.clear();
+		}
+};
+
+
 // Function declarations:
 
 class Tool_humdiff : public HumTool {
@@ -6404,9 +7296,36 @@ class Tool_humdiff : public HumTool {
 		void     printNotePoints    (vector<NotePoint>& notelist);
 		void     markNote           (NotePoint& np);
 
+		void     alignFiles         (HumdrumFile& reference, HumdrumFile& alternate, int altindex);
+		void     extractMeasurePoints(vector<MeasurePoint>& measures, HumdrumFile& infile, int sourceindex);
+		void     alignMeasureGap    (vector<MeasurePoint>& refmeasures, int rstart, int rend,
+		                             vector<MeasurePoint>& altmeasures, int astart, int aend);
+		void     alignMeasureNotes  (MeasurePoint& refmeasure, MeasurePoint& altmeasure);
+		void     addEdit            (const string& op, MeasurePoint* refmeasure, NotePoint* refnote,
+		                             MeasurePoint* altmeasure, NotePoint* altnote);
+		void     printEditLocation  (ostream& out, MeasurePoint& mp, NotePoint* np);
+		string   getJsonString      (const string& value);
+		uint64_t hashValue          (uint64_t hash, int64_t value);
+		void     alignSequences     (vector<pair<int, int>>& matches,
+		                             const vector<uint64_t>& a, const vector<uint64_t>& b);
+		void     alignRange         (vector<pair<int, int>>& matches,
+		                             const vector<uint64_t>& a, int alow, int ahigh,
+		                             const vector<uint64_t>& b, int blow, int bhigh);
+		int      findMiddleSnake    (const vector<uint64_t>& a, int alow, int ahigh,
+		                             const vector<uint64_t>& b, int blow, int bhigh,
+		                             int& xstart, int& ystart, int& xend, int& yend);
+
 	private:
 		int m_marked = 0;
 
+		// variables for --align and --json:
+		bool           m_reportQ   = false;
+		bool           m_jsonQ     = false;
+		int            m_altindex  = 0;      // sequence number of alternate score
+		vector<string> m_edits;              // JSON edit script for alternate score
+		vector<int>    m_forward;            // furthest forward path for each diagonal
+		vector<int>    m_backward;           // furthest backward path for each diagonal
+
 
 };
 
@@ -6478,6 +7397,30 @@ class Tool_humsort : public HumTool {
 };
 
 
+// ImitationSequence: the notes of one voice reduced to symbols for
+// imitation matching.  The order of the notes is reversed for retrograde
+// searches, and the intervals are negated for inversion searches.
+class ImitationSequence {
+	public:
+		enum { IMITATION_REST = -1000000 }; // interval to or from a rest
+
+		int         m_voice = -1;
+		vector<int> m_notes;             // attack index in voice for each position
+		vector<int> m_durations;         // duration ID for each position (or 0)
+		vector<int> m_intervals;         // diatonic interval to next position
+};
+
+
+// ImitationCandidates: the groups of sequence positions which start with
+// the same symbols.  Pairs of positions from the same group in different
+// voices are the candidate matches.
+class ImitationCandidates {
+	public:
+		vector<vector<int>>            m_group;   // group of each position in each sequence (or -1)
+		vector<vector<pair<int, int>>> m_members; // sorted (sequence, position) list for each group
+};
+
+
 class Tool_imitation : public HumTool {
 	public:
 		         Tool_imitation    (void);
@@ -6496,12 +7439,20 @@ class Tool_imitation : public HumTool {
 		void    analyzeImitation  (vector<vector<string>>& results,
 		                            vector<vector<NoteCell*>>& attacks,
 		                            vector<vector<double>>& intervals,
-		                            int v1, int v2);
+		                            vector<ImitationSequence>& sequences,
+		                            int index1, int index2,
+		                            ImitationCandidates& candidates);
 		void    getIntervals       (vector<double>& intervals,
 		                            vector<NoteCell*>& attacks);
-		int     compareSequences   (vector<NoteCell*>& attack1, vector<double>& seq1,
-		                            int i1, vector<NoteCell*>& attack2,
-		                            vector<double>& seq2, int i2);
+		void    getSequences       (vector<ImitationSequence>& sequences,
+		                            vector<vector<NoteCell*>>& attacks,
+		                            vector<vector<double>>& intervals);
+		void    getCandidates      (ImitationCandidates& candidates,
+		                            vector<ImitationSequence>& sequences);
+		static void buildSuffixArray(vector<int>& suffixes, vector<int>& lcp,
+		                            const vector<int>& text);
+		int     compareSequences   (ImitationSequence& seq1, int p1,
+		                            ImitationSequence& seq2, int p2);
 		int     checkForIntervalSequence(vector<int>& m_intervals,
 		                            vector<double>& v1i, int starti, int count);
 		void    markedTiedNotes    (vector<HTp>& tokens);
@@ -6518,7 +7469,7 @@ class Tool_imitation : public HumTool {
 		bool m_mark;
 		char m_marker = '@';
 		bool m_single = false;
-		static int Enumerator;
+		int m_enumerator = 0;
 		bool m_first = false;
 		bool m_nozero = false;
 		bool m_onlyzero = false;
@@ -7013,15 +7964,13 @@ class SonorityNoteData {
 				m_tok = *token;
 				m_index = 0;
 			}
-			if (m_tok.find('_') != std::string::npos) {
+			const KernDecoding& decoding = Convert::decodeKern(m_tok);
+			if (decoding.tieContinue || decoding.tieEnd) {
 				m_attackQ = false;
 			}
-			if (m_tok.find(']') != std::string::npos) {
-				m_attackQ = false;
-			}
-			m_base7 = Convert::kernToBase7(m_tok);
-			m_base12 = Convert::kernToBase12(m_tok);
-			m_base40 = Convert::kernToBase40(m_tok);
+			m_base7 = decoding.base7;
+			m_base12 = decoding.base12;
+			m_base40 = decoding.base40;
 		}
 
 		void setString(std::string tok) {
@@ -7266,6 +8215,85 @@ class TextInfo {
 };
 
 
+//////////////////////////////
+//
+// MSearchIndex -- Trigram index of note features for a corpus of files,
+//    used to find the note attacks which can start a match to a music
+//    query without checking every note of every voice in every file.
+//    Each posting is a file index and an attack position in the NoteGrid
+//    of the file (the index of the attack in the list of all attacks of
+//    voice 0, then voice 1, and so on).  Postings are candidates only,
+//    so matches still have to be verified with the score.
+//
+
+class MSearchIndex {
+	public:
+		enum Feature {
+			FEATURE_PITCH40 = 1,  // base-40 pitch class
+			FEATURE_PITCH12,      // base-12 pitch class
+			FEATURE_PITCH7,       // diatonic pitch class
+			FEATURE_CINTERVAL,    // base-40 interval to next attack
+			FEATURE_DINTERVAL,    // diatonic interval to next attack
+			FEATURE_DURATION,     // duration to next attack
+			FEATURE_COUNT
+		};
+
+		                   MSearchIndex      (void);
+		                  ~MSearchIndex      ();
+
+		void               clear             (void);
+		void               addFile           (HumdrumFile& infile,
+		                                      const std::string& filename);
+		bool               write             (const std::string& filename);
+		bool               read              (const std::string& filename);
+		int                getFileCount      (void);
+		std::string        getFilename       (int index);
+		int                getPostingCount   (uint64_t key);
+		void               getPostings       (uint64_t key,
+		                                      std::vector<std::pair<int, int>>& postings);
+		bool               hasPosting        (uint64_t key, int file, int position);
+
+		static uint64_t    makeKey           (int feature, int64_t value1,
+		                                      int64_t value2, int64_t value3);
+		static int64_t     getNoteFeature    (std::vector<NoteCell*>& notes,
+		                                      int index, int feature);
+		static bool        getQueryFeature   (MSearchQueryToken& token,
+		                                      int feature, int64_t& value);
+
+		static const char  INDEX_MAGIC[9];
+		static const int   INDEX_VERSION;
+
+	protected:
+		int                findKey           (uint64_t key);
+
+	private:
+		// m_filenames: the files in the index.
+		std::vector<std::string> m_filenames;
+
+		// m_entries: key/posting pairs of files added to the index
+		// (the posting is the file index in the upper 32 bits and the
+		// attack position in the lower 32 bits).
+		std::vector<std::pair<uint64_t, uint64_t>> m_entries;
+
+		// m_map: the contents of an index read from a file.
+		HumMemoryMap m_map;
+
+		// m_keys: sorted list of unique keys in the index file.
+		const uint64_t* m_keys = NULL;
+
+		// m_offsets: starting index in m_postings for each key (with
+		// an extra entry at the end of the list).
+		const uint64_t* m_offsets = NULL;
+
+		// m_postings: file index and attack position for each posting.
+		const uint32_t* m_postings = NULL;
+
+		// m_keyCount: the number of entries in m_keys.
+		uint64_t m_keyCount = 0;
+};
+
+
+
 class Tool_msearch : public HumTool {
 	public:
 		         Tool_msearch      (void);
@@ -7275,6 +8303,7 @@ class Tool_msearch : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const std::string& indata, ostream& out);
 		bool     run               (HumdrumFile& infile, ostream& out);
+		bool     searchIndex       (MSearchIndex& index, ostream& out);
 
 	protected:
 		void    initialize         (void);
@@ -7314,6 +8343,9 @@ class Tool_msearch : public HumTool {
 		                           SonorityDatabase& sonorities, bool suppressQ);
 		bool    checkVerticalOnly  (const std::string& input);
 		void    makeLowerCase      (std::string& inout);
+		bool    planIndexSearch    (MSearchIndex& index,
+		                            vector<MSearchQueryToken>& query,
+		                            vector<pair<uint64_t, int>>& lookups);
 
 	private:
 	 	vector<HTp> m_kernspines;
@@ -7404,6 +8436,12 @@ class Tool_musicxml2hum : public HumTool {
 		       ~Tool_musicxml2hum    () {}
 
 		bool    convertFile          (ostream& out, const char* filename);
+		bool    convertFile          (ostream& out, const char* filename,
+		                              pugi::xml_document& doc,
+		                              std::vector<char>& buffer);
+		bool    convertFiles         (ostream& out,
+		                              const std::vector<std::string>& filenames);
+		bool    convertStream        (ostream& out, MxmlStream& stream);
 		bool    convert              (ostream& out, pugi::xml_document& infile);
 		bool    convert              (ostream& out, const char* input);
 		bool    convert              (ostream& out, istream& input);
@@ -7439,6 +8477,22 @@ class Tool_musicxml2hum : public HumTool {
 		bool   fillPartData         (MxmlPart& partdata, const std::string& id,
 		                             pugi::xml_node partdeclaration,
 		                             pugi::xml_node partcontent);
+		bool   fillPartData         (std::vector<MxmlPart>& partdata,
+		                             const std::vector<std::string>& partids,
+		                             map<std::string, pugi::xml_node>& partinfo,
+		                             MxmlStream& stream,
+		                             const std::vector<int>& partindex);
+		void   addPartMeasure       (MxmlPart& partdata, pugi::xml_node measure);
+		bool   stitchParts          (HumGrid& outdata,
+		                             std::vector<MxmlPart>& partdata,
+		                             MxmlStream& stream,
+		                             const std::vector<int>& partindex);
+		void   releaseMeasureNodes  (pugi::xml_document& doc);
+		void   carryNode            (pugi::xml_node& node, pugi::xml_document& doc);
+		bool   convertGrid          (ostream& out, pugi::xml_document& doc,
+		                             HumGrid& outdata,
+		                             std::vector<std::string>& partids,
+		                             std::vector<MxmlPart>& partdata);
 		void   appendZeroEvents     (GridMeasure* outfile,
 		                             std::vector<SimultaneousEvents*>& nowevents,
 		                             HumNum nowtime,
@@ -7559,6 +8613,10 @@ class Tool_musicxml2hum : public HumTool {
 		void setSoftwareInfo   (pugi::xml_document& doc);
 		std::string getSystemDecoration(pugi::xml_document& doc, HumGrid& grid, std::vector<std::string>& partids);
 		void getChildrenVector (std::vector<pugi::xml_node>& children, pugi::xml_node parent);
+		pugi::xml_node getFirstNode(pugi::xml_node parent,
+		                        const std::vector<std::string>& path, int index = 0);
+		bool getInputFiles     (std::vector<std::string>& files, const std::string& path);
+		std::string getOutputFilename(const std::string& filename);
 		void insertPartTranspositions(pugi::xml_node transposition, GridPart& part);
 		pugi::xml_node convertTranspositionToHumdrum(pugi::xml_node transpose, HTp& token, int& staffindex);
 		void prepareRdfs       (std::vector<MxmlPart>& partdata);
@@ -7617,6 +8675,11 @@ class Tool_musicxml2hum : public HumTool {
 		// to process.
 		std::map<std::string, vector<pugi::xml_node>> m_post_note_text;
 
+		// m_carry: copies of pending direction nodes (m_current_dynamic,
+		// etc.) from measure documents which have been released when
+		// converting with --stream.
+		pugi::xml_document m_carry;
+
 };
 
 
@@ -7788,14 +8851,36 @@ class Tool_pccount : public HumTool {
 		bool  run                       (HumdrumFile& infile);
 		bool  run                       (const string& indata, ostream& out);
 		bool  run                       (HumdrumFile& infile, ostream& out);
+		bool  run                       (HumdrumFileStream& instream, ostream& out);
+		bool  isBatchMode               (void);
  
 	protected:
 		void   initialize               (HumdrumFile& infile);
 		void   processFile              (HumdrumFile& infile);
 		void   initializePartInfo       (HumdrumFile& infile);
 		void   addCounts                (HTp sstart, HTp send);
+		void   addTokenCounts           (HTp token, double* counts);
+		void   addSubtokenCounts        (const std::string& subtoken,
+		                                 double* counts);
 		void   countPitches             (HumdrumFile& infile);
+		void   countMeasures            (HumdrumFile& infile);
 		void   printHumdrumTable        (void);
+		void   printProfiles            (ostream& out, const std::string& filename);
+		void   printCsvHeader           (ostream& out);
+		void   printCsvRow              (ostream& out, const std::string& filename,
+		                                 int measure, int part,
+		                                 const std::string& name,
+		                                 const double* counts);
+		void   writeBinaryHeader        (ostream& out);
+		void   writeBinaryBlock         (ostream& out, const std::string& filename,
+		                                 const std::vector<std::string>& names,
+		                                 const std::vector<int>& measures,
+		                                 const std::vector<double>& counts);
+		void   printTotals              (ostream& out,
+		                                 std::vector<std::vector<double>>& totals);
+		static void addTotals           (std::vector<std::vector<double>>& totals,
+		                                 const std::vector<std::vector<double>>& counts);
+		std::string getCsvField         (const std::string& value);
 		void   printPitchClassList      (void);
 		void   printVegaLiteJsonTemplate(const std::string& datavariable, HumdrumFile& infile);
 		void   printVegaLiteJsonData    (void);
@@ -7827,6 +8912,9 @@ class Tool_pccount : public HumTool {
 		std::vector<std::string>       m_names;
 		std::vector<std::string>       m_abbreviations;
 		std::vector<std::vector<double>> m_counts;
+		std::vector<std::vector<double>> m_totals;       // sum of m_counts (--csv)
+		std::vector<double>            m_measurecounts; // [measure][part][40]
+		std::vector<int>               m_measurenums;   // bar number of measures
 		bool m_attack       = false;
 		bool m_full         = false;
 		bool m_doublefull   = false;
@@ -7837,6 +8925,9 @@ class Tool_pccount : public HumTool {
 		bool m_script       = false;
 		bool m_html         = false;
 		bool m_page         = false;
+		bool m_csv          = false;
+		bool m_binary       = false;
+		bool m_measures     = false;
 		int  m_width        = 500;
 		double m_ratio      = 0.67;
 		bool m_key          = true;
@@ -7867,7 +8958,8 @@ class Tool_periodicity : public HumTool {
 		void     processFile        (HumdrumFile& infile);
 		void     fillAttackGrids    (HumdrumFile& infile, vector<vector<double>>& grids, HumNum minrhy);
 		void     printAttackGrid    (ostream& out, HumdrumFile& infile, vector<vector<double>>& grids, HumNum minrhy);
-		void     doAnalysis         (vector<vector<double>>& analysis, int level, vector<double>& grid);
+		void     doAnalysis         (vector<vector<double>>& analysis, int level,
+		                             vector<int>& positions, vector<double>& weights);
 		void     doPeriodicityAnalysis(vector<vector<double>> & analysis, vector<double>& grid, HumNum minrhy);
 		void     printPeriodicityAnalysis(ostream& out, vector<vector<double>>& analysis);
 		void     printSvgAnalysis(ostream& out, vector<vector<double>>& analysis, HumNum minrhy);
@@ -8350,6 +9442,37 @@ class MeasureComparison {
 
 
 
+// MeasureHistogramMatrix: pitch-class histograms of a MeasureDataSet,
+// normalized so that the correlation between two measures is the dot
+// product of their columns.  Stored as 7 rows (one for each pitch class)
+// of length size() for vectorized row-by-row evaluation.
+class MeasureHistogramMatrix {
+	public:
+		           MeasureHistogramMatrix (void);
+		           MeasureHistogramMatrix (MeasureDataSet& set);
+		          ~MeasureHistogramMatrix ();
+
+		void       clear                  (void);
+		void       load                   (MeasureDataSet& set);
+		int        size                   (void) const { return m_size; }
+		int        getState               (int index) const { return m_state[index]; }
+		const double* getRow              (int pc) const;
+		void       correlateRow           (const MeasureHistogramMatrix& other,
+		                                   int index, int startcol, int stopcol,
+		                                   double* output) const;
+
+		// histogram states:
+		enum { EMPTY = 0, FLAT = 1, NORMAL = 2 };
+
+	private:
+		std::vector<double> m_values;
+		std::vector<char>   m_state;
+		int                 m_size = 0;
+		MeasureDataSet*     m_set = NULL;
+};
+
+
+
 class MeasureComparisonGrid {
 	public:
 		             MeasureComparisonGrid     (void);
@@ -8358,8 +9481,16 @@ class MeasureComparisonGrid {
 		            ~MeasureComparisonGrid     ();
 
 		void         clear                     (void);
-		void         analyze                   (MeasureDataSet& set1, MeasureDataSet& set2);
-		void         analyze                   (MeasureDataSet* set1, MeasureDataSet* set2);
+		void         analyze                   (MeasureDataSet& set1, MeasureDataSet& set2,
+		                                        int threads = 1);
+		void         analyze                   (MeasureDataSet* set1, MeasureDataSet* set2,
+		                                        int threads = 1);
+		void         analyzeTopMatches         (MeasureDataSet& set1, MeasureDataSet& set2,
+		                                        int count, bool skipdiagonal = false,
+		                                        int threads = 1);
+		int          getRowCount               (void) { return m_rows; }
+		int          getColumnCount            (void) { return m_cols; }
+		double       getCorrelation            (int index1, int index2);
 
 		double       getStartTime1             (int index);
 		double       getStopTime1              (int index);
@@ -8379,11 +9510,23 @@ class MeasureComparisonGrid {
 		ostream&     printCorrelationGrid      (ostream& out = std::cout);
 		ostream&     printCorrelationDiagonal  (ostream& out = std::cout);
 		ostream&     printSvgGrid              (ostream& out = std::cout);
+		ostream&     printTopMatches           (ostream& out = std::cout);
 		void         getColorMapping           (double input, double& hue, double& saturation,
 				 double& lightness);
 
+	protected:
+		static void  printCorrelation          (ostream& out, double correl);
+
 	private:
-		std::vector<std::vector<MeasureComparison>> m_grid;
+		// m_grid: correlations stored row by row (m_rows x m_cols).
+		std::vector<double> m_grid;
+		int                 m_rows = 0;
+		int                 m_cols = 0;
+
+		// m_matches: most similar measures in set2 for each measure in set1,
+		// when analyzed with analyzeTopMatches().
+		std::vector<std::vector<std::pair<int, double>>> m_matches;
+
 		MeasureDataSet* m_set1 = NULL;
 		MeasureDataSet* m_set2 = NULL;
 };
@@ -1,13 +1,16 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Mar  4 21:15:15 PST 2018
-// Last Modified: Sun Mar  4 21:15:19 PST 2018
+// Last Modified: Sun Oct 18 09:29:43 UTC 2026
 // Filename:      tool-binroll.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-binroll.h
 // Syntax:        C++11; humlib
 // vim:           ts=3 noexpandtab
 //
 // Description:   Extract a binary pinao roll of note in a score.
+//                With -b, a packed binary roll is written instead of text
+//                (see Tool_binroll::writeBinaryRoll() for the format and
+//                for when it is smaller than the text roll).
 //
 
 #ifndef _TOOL_BINROLL_H
@@ -16,6 +19,9 @@
 #include "HumTool.h"
 #include "HumNum.h"
 #include "HumdrumFile.h"
+#include "HumdrumFileStream.h"
+
+#include <cstdint>
 
 namespace hum {
 
@@ -30,16 +36,33 @@ class Tool_binroll : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const string& indata, ostream& out);
 		bool     run               (HumdrumFile& infile, ostream& out);
+		bool     run               (HumdrumFileStream& instream, ostream& out);
 
 	protected:
-		void     processFile       (HumdrumFile& infile);
+		void     initialize        (void);
+		void     processFile       (HumdrumFile& infile, ostream& out);
 		void     processStrand     (vector<vector<char>>& roll, HTp starting,
-		                            HTp ending);
+		                            HTp ending, int voice);
+		void     storeNote         (vector<vector<char>>& roll, int voice,
+		                            int base12, int startindex, int endindex);
 		void     printAnalysis     (HumdrumFile& infile,
-		                            vector<vector<char>>& roll);
+		                            vector<vector<char>>& roll, ostream& out);
+		void     writeBinaryRoll   (ostream& out, int steps);
+		void     writeWords        (ostream& out, const uint64_t* words,
+		                            size_t count);
 
 	private:
 		HumNum    m_duration;
+		bool      m_binaryQ = false;   // used with -b option
+		bool      m_rleQ    = false;   // used with -r option
+		int       m_low     = 0;       // used with --low option
+		int       m_high    = 127;     // used with --high option
+		int       m_voices  = 0;       // number of **kern spines
+		int       m_words   = 0;       // 64-bit words for pitch range
+		// m_bits: packed binary roll: for each time step and voice,
+		// m_words words of sounding notes followed by m_words words
+		// of note attacks.
+		vector<uint64_t> m_bits;
 
 };
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Date: Mon Sep 16 13:53:47 PDT 2013
-// Last Modified: Tue May 30 15:19:23 CEST 2017 Ported from Humdrum Extras
+// Last Modified: Sun Oct 18 06:48:48 UTC 2026
 // Filename:      tool-cint.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-dissonant.h
 // Syntax:        C++11; humlib
@@ -19,8 +19,10 @@
 #include "NoteGrid.h"
 #include "HumRegex.h"
 
-#include <vector>
+#include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace hum {
 
@@ -157,6 +159,19 @@ class Tool_cint : public HumTool {
 		int       getTriangleIndex(int number, int num1, int num2);
 		void      adjustKTracks        (vector<int>& ktracks, const string& koption);
 		int       getMeasure           (HumdrumFile& infile, int line);
+		int       printModuleCounts    (HumdrumFile& infile, vector<int>& ktracks,
+		                                vector<int>& reverselookup);
+		int       extractNoteMatrix    (vector<int>& pitches, HumdrumFile& infile,
+		                                vector<int>& reverselookup, int voices);
+		void      countPairModules     (vector<pair<string, int>>& counts,
+		                                const int* pitch1, const int* pitch2,
+		                                int rows, int n);
+		int64_t   getIntervalCode      (int b40a, int b40b, int type);
+		int       getIntervalValue     (int b40a, int b40b, int type,
+		                                int octaveadjust = 0);
+		void      printModuleLabel     (ostream& out, const int* pitch1,
+		                                const int* pitch2, const vector<int>& events,
+		                                int start, int n);
 
 	private:
 
@@ -198,6 +213,8 @@ class Tool_cint : public HumTool {
 		int       markQ        = 0;      // used with --mark option
 		int       countQ       = 0;      // used with --count option
 		int       suspensionsQ = 0;      // used with --suspensions option
+		int       moduleCountQ = 0;      // used with --module-counts option
+		int       jsonQ        = 0;      // used with --json option
 		int       uncrossQ     = 0;      // used with -c option
 		int       retroQ       = 0;      // used with --retro option
 		int       idQ          = 0;      // used with --id option
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Nov 28 08:55:15 PST 2016
-// Last Modified: Mon Nov 28 08:55:38 PST 2016
+// Last Modified: Sun Oct 18 14:52:48 UTC 2026
 // Filename:      tool-dissonant.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-dissonant.h
 // Syntax:        C++11; humlib
@@ -15,8 +15,11 @@
 
 #include "HumTool.h"
 #include "HumdrumFile.h"
+#include "HumdrumFileStream.h"
 #include "NoteGrid.h"
 
+#include <map>
+
 namespace hum {
 
 // START_MERGE
@@ -30,6 +33,9 @@ class Tool_dissonant : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const string& indata, ostream& out);
 		bool     run               (HumdrumFile& infile, ostream& out);
+		bool     run               (HumdrumFileStream& instream);
+		bool     run               (HumdrumFileStream& instream, ostream& out);
+		bool     isBatchMode       (void);
 
 	protected:
 		void    doAnalysis         (vector<vector<string> >& results,
@@ -63,6 +69,11 @@ class Tool_dissonant : public HumTool {
 		void    fillLabels         (void);
 		void    fillLabels2        (void);
 		void    printCountAnalysis (vector<vector<string> >& data);
+		void    countAnalysis      (vector<map<string, int> >& analysis,
+		                            vector<vector<string> >& data);
+		void    printCountTable    (vector<map<string, int> >& analysis);
+		void    storeLowestNotes   (NoteGrid& grid);
+		void    storeVoiceFeatures (vector<NoteCell*>& attacks, int vindex);
 		void    suppressDissonances(HumdrumFile& infile, NoteGrid& grid,
 		                            vector<vector<NoteCell* > >& attacks,
 		                            vector<vector<string> >& results);
@@ -107,6 +118,19 @@ class Tool_dissonant : public HumTool {
 
 		vector<string> m_labels;
 
+		// Features of the note/rest attacks in each voice, indexed by voice
+		// and then by attack (the interval is from the previous attack).
+		// These are shared by the dissonance candidate checks:
+		vector<vector<double> > m_intervals;  // diatonic melodic intervals
+		vector<vector<HumNum> > m_durations;  // durations to next attacks
+		vector<vector<double> > m_levels;     // metric levels
+		vector<int>             m_lowestnote; // lowest diatonic note in slice
+
+		// Accumulated counts (--batch):
+		bool                          m_accumulateQ = false;
+		vector<map<string, int> >     m_counts;
+		int                           m_filecount = 0;
+
 		// unaccdented non-harmonic tones:
 		const int PASSING_UP           =  0; // rising passing tone
 		const int PASSING_DOWN         =  1; // downward passing tone
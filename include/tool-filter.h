@@ -40,10 +40,13 @@ class Tool_filter : public HumTool {
 		void     removeGlobalFilterLines    (HumdrumFile& infile);
 		void     removeUniversalFilterLines (HumdrumFileSet& infiles);
 		void     splitPipeline      (vector<string>& clist, const string& command);
+		void     updateFile         (HumdrumFile& infile, const string& text,
+		                             int linecount);
 
 	private:
 		string   m_variant;        // used with -v option.
 		bool     m_debugQ = false; // used with --debug option
+		bool     m_reparseQ = false; // used with --reparse option
 
 };
 
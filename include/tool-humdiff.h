@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Jul 29 11:38:01 CEST 2019
-// Last Modified: Sat Aug  3 17:48:04 EDT 2019
+// Last Modified: Sun Oct 18 07:07:32 UTC 2026
 // Filename:      tool-humdiff.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-humdiff.h
 // Syntax:        C++11; humlib
@@ -17,7 +17,9 @@
 #include "HumdrumFile.h"
 #include "HumdrumFileSet.h"
 
+#include <cstdint>
 #include <iostream>
+#include <utility>
 
 namespace hum {
 
@@ -88,6 +90,29 @@ class NotePoint {
 };
 
 
+// MeasurePoint is a measure from a score (or the music before the first
+// barline) which is aligned to measures in another score by a fingerprint
+// of its notes.
+class MeasurePoint {
+	public:
+		int               measure     = -1;  // measure number
+		int               line        = -1;  // line index of barline (or first data line)
+		HumNum            duration    = 0;   // duration of measure
+		uint64_t          fingerprint = 0;   // hash of duration and note keys
+		vector<NotePoint> notes;             // sorted by onset, pitch and duration
+		vector<uint64_t>  keys;              // hash of onset, pitch and duration of notes
+
+		void clear(void) {
+			measure = -1;
+			line = -1;
+			duration = 0;
+			fingerprint = 0;
+			notes.clear();
+			keys.clear();
+		}
+};
+
+
 // Function declarations:
 
 class Tool_humdiff : public HumTool {
@@ -108,9 +133,36 @@ class Tool_humdiff : public HumTool {
 		void     printNotePoints    (vector<NotePoint>& notelist);
 		void     markNote           (NotePoint& np);
 
+		void     alignFiles         (HumdrumFile& reference, HumdrumFile& alternate, int altindex);
+		void     extractMeasurePoints(vector<MeasurePoint>& measures, HumdrumFile& infile, int sourceindex);
+		void     alignMeasureGap    (vector<MeasurePoint>& refmeasures, int rstart, int rend,
+		                             vector<MeasurePoint>& altmeasures, int astart, int aend);
+		void     alignMeasureNotes  (MeasurePoint& refmeasure, MeasurePoint& altmeasure);
+		void     addEdit            (const string& op, MeasurePoint* refmeasure, NotePoint* refnote,
+		                             MeasurePoint* altmeasure, NotePoint* altnote);
+		void     printEditLocation  (ostream& out, MeasurePoint& mp, NotePoint* np);
+		string   getJsonString      (const string& value);
+		uint64_t hashValue          (uint64_t hash, int64_t value);
+		void     alignSequences     (vector<pair<int, int>>& matches,
+		                             const vector<uint64_t>& a, const vector<uint64_t>& b);
+		void     alignRange         (vector<pair<int, int>>& matches,
+		                             const vector<uint64_t>& a, int alow, int ahigh,
+		                             const vector<uint64_t>& b, int blow, int bhigh);
+		int      findMiddleSnake    (const vector<uint64_t>& a, int alow, int ahigh,
+		                             const vector<uint64_t>& b, int blow, int bhigh,
+		                             int& xstart, int& ystart, int& xend, int& yend);
+
 	private:
 		int m_marked = 0;
 
+		// variables for --align and --json:
+		bool           m_reportQ   = false;
+		bool           m_jsonQ     = false;
+		int            m_altindex  = 0;      // sequence number of alternate score
+		vector<string> m_edits;              // JSON edit script for alternate score
+		vector<int>    m_forward;            // furthest forward path for each diagonal
+		vector<int>    m_backward;           // furthest backward path for each diagonal
+
 
 };
 
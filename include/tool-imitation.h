@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Jun 17 20:18:23 CEST 2017
-// Last Modified: Sat Jun 17 22:40:59 CEST 2017
+// Last Modified: Sun Oct 18 10:37:17 UTC 2026
 // Filename:      tool-imitation.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-imitation.h
 // Syntax:        C++11; humlib
@@ -17,10 +17,37 @@
 #include "HumdrumFile.h"
 #include "NoteGrid.h"
 
+#include <utility>
+#include <vector>
+
 namespace hum {
 
 // START_MERGE
 
+// ImitationSequence: the notes of one voice reduced to symbols for
+// imitation matching.  The order of the notes is reversed for retrograde
+// searches, and the intervals are negated for inversion searches.
+class ImitationSequence {
+	public:
+		enum { IMITATION_REST = -1000000 }; // interval to or from a rest
+
+		int         m_voice = -1;
+		vector<int> m_notes;             // attack index in voice for each position
+		vector<int> m_durations;         // duration ID for each position (or 0)
+		vector<int> m_intervals;         // diatonic interval to next position
+};
+
+
+// ImitationCandidates: the groups of sequence positions which start with
+// the same symbols.  Pairs of positions from the same group in different
+// voices are the candidate matches.
+class ImitationCandidates {
+	public:
+		vector<vector<int>>            m_group;   // group of each position in each sequence (or -1)
+		vector<vector<pair<int, int>>> m_members; // sorted (sequence, position) list for each group
+};
+
+
 class Tool_imitation : public HumTool {
 	public:
 		         Tool_imitation    (void);
@@ -39,12 +66,20 @@ class Tool_imitation : public HumTool {
 		void    analyzeImitation  (vector<vector<string>>& results,
 		                            vector<vector<NoteCell*>>& attacks,
 		                            vector<vector<double>>& intervals,
-		                            int v1, int v2);
+		                            vector<ImitationSequence>& sequences,
+		                            int index1, int index2,
+		                            ImitationCandidates& candidates);
 		void    getIntervals       (vector<double>& intervals,
 		                            vector<NoteCell*>& attacks);
-		int     compareSequences   (vector<NoteCell*>& attack1, vector<double>& seq1,
-		                            int i1, vector<NoteCell*>& attack2,
-		                            vector<double>& seq2, int i2);
+		void    getSequences       (vector<ImitationSequence>& sequences,
+		                            vector<vector<NoteCell*>>& attacks,
+		                            vector<vector<double>>& intervals);
+		void    getCandidates      (ImitationCandidates& candidates,
+		                            vector<ImitationSequence>& sequences);
+		static void buildSuffixArray(vector<int>& suffixes, vector<int>& lcp,
+		                            const vector<int>& text);
+		int     compareSequences   (ImitationSequence& seq1, int p1,
+		                            ImitationSequence& seq2, int p2);
 		int     checkForIntervalSequence(vector<int>& m_intervals,
 		                            vector<double>& v1i, int starti, int count);
 		void    markedTiedNotes    (vector<HTp>& tokens);
@@ -61,7 +96,7 @@ class Tool_imitation : public HumTool {
 		bool m_mark;
 		char m_marker = '@';
 		bool m_single = false;
-		static int Enumerator;
+		int m_enumerator = 0;
 		bool m_first = false;
 		bool m_nozero = false;
 		bool m_onlyzero = false;
@@ -17,6 +17,12 @@
 #include "HumdrumFile.h"
 #include "NoteGrid.h"
 #include "Convert.h"
+#include "HumMemoryMap.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace hum {
 
@@ -65,15 +71,13 @@ class SonorityNoteData {
 				m_tok = *token;
 				m_index = 0;
 			}
-			if (m_tok.find('_') != std::string::npos) {
+			const KernDecoding& decoding = Convert::decodeKern(m_tok);
+			if (decoding.tieContinue || decoding.tieEnd) {
 				m_attackQ = false;
 			}
-			if (m_tok.find(']') != std::string::npos) {
-				m_attackQ = false;
-			}
-			m_base7 = Convert::kernToBase7(m_tok);
-			m_base12 = Convert::kernToBase12(m_tok);
-			m_base40 = Convert::kernToBase40(m_tok);
+			m_base7 = decoding.base7;
+			m_base12 = decoding.base12;
+			m_base40 = decoding.base40;
 		}
 
 		void setString(std::string tok) {
@@ -318,6 +322,85 @@ class TextInfo {
 };
 
 
+//////////////////////////////
+//
+// MSearchIndex -- Trigram index of note features for a corpus of files,
+//    used to find the note attacks which can start a match to a music
+//    query without checking every note of every voice in every file.
+//    Each posting is a file index and an attack position in the NoteGrid
+//    of the file (the index of the attack in the list of all attacks of
+//    voice 0, then voice 1, and so on).  Postings are candidates only,
+//    so matches still have to be verified with the score.
+//
+
+class MSearchIndex {
+	public:
+		enum Feature {
+			FEATURE_PITCH40 = 1,  // base-40 pitch class
+			FEATURE_PITCH12,      // base-12 pitch class
+			FEATURE_PITCH7,       // diatonic pitch class
+			FEATURE_CINTERVAL,    // base-40 interval to next attack
+			FEATURE_DINTERVAL,    // diatonic interval to next attack
+			FEATURE_DURATION,     // duration to next attack
+			FEATURE_COUNT
+		};
+
+		                   MSearchIndex      (void);
+		                  ~MSearchIndex      ();
+
+		void               clear             (void);
+		void               addFile           (HumdrumFile& infile,
+		                                      const std::string& filename);
+		bool               write             (const std::string& filename);
+		bool               read              (const std::string& filename);
+		int                getFileCount      (void);
+		std::string        getFilename       (int index);
+		int                getPostingCount   (uint64_t key);
+		void               getPostings       (uint64_t key,
+		                                      std::vector<std::pair<int, int>>& postings);
+		bool               hasPosting        (uint64_t key, int file, int position);
+
+		static uint64_t    makeKey           (int feature, int64_t value1,
+		                                      int64_t value2, int64_t value3);
+		static int64_t     getNoteFeature    (std::vector<NoteCell*>& notes,
+		                                      int index, int feature);
+		static bool        getQueryFeature   (MSearchQueryToken& token,
+		                                      int feature, int64_t& value);
+
+		static const char  INDEX_MAGIC[9];
+		static const int   INDEX_VERSION;
+
+	protected:
+		int                findKey           (uint64_t key);
+
+	private:
+		// m_filenames: the files in the index.
+		std::vector<std::string> m_filenames;
+
+		// m_entries: key/posting pairs of files added to the index
+		// (the posting is the file index in the upper 32 bits and the
+		// attack position in the lower 32 bits).
+		std::vector<std::pair<uint64_t, uint64_t>> m_entries;
+
+		// m_map: the contents of an index read from a file.
+		HumMemoryMap m_map;
+
+		// m_keys: sorted list of unique keys in the index file.
+		const uint64_t* m_keys = NULL;
+
+		// m_offsets: starting index in m_postings for each key (with
+		// an extra entry at the end of the list).
+		const uint64_t* m_offsets = NULL;
+
+		// m_postings: file index and attack position for each posting.
+		const uint32_t* m_postings = NULL;
+
+		// m_keyCount: the number of entries in m_keys.
+		uint64_t m_keyCount = 0;
+};
+
+
+
 class Tool_msearch : public HumTool {
 	public:
 		         Tool_msearch      (void);
@@ -327,6 +410,7 @@ class Tool_msearch : public HumTool {
 		bool     run               (HumdrumFile& infile);
 		bool     run               (const std::string& indata, ostream& out);
 		bool     run               (HumdrumFile& infile, ostream& out);
+		bool     searchIndex       (MSearchIndex& index, ostream& out);
 
 	protected:
 		void    initialize         (void);
@@ -366,6 +450,9 @@ class Tool_msearch : public HumTool {
 		                           SonorityDatabase& sonorities, bool suppressQ);
 		bool    checkVerticalOnly  (const std::string& input);
 		void    makeLowerCase      (std::string& inout);
+		bool    planIndexSearch    (MSearchIndex& index,
+		                            vector<MSearchQueryToken>& query,
+		                            vector<pair<uint64_t, int>>& lookups);
 
 	private:
 	 	vector<HTp> m_kernspines;
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  6 10:53:40 CEST 2016
-// Last Modified: Wed Oct 26 18:25:45 PDT 2016 Renamed class
+// Last Modified: Sun Oct 18 08:59:36 UTC 2026
 // Filename:      tool-musicxml2hum.h
 // URL:           https://github.com/craigsapp/musicxml2hum/blob/master/include/tool-musicxml2hum.h
 // Syntax:        C++11; humlib
@@ -24,6 +24,7 @@
 #include "MxmlPart.h"
 #include "MxmlMeasure.h"
 #include "MxmlEvent.h"
+#include "MxmlStream.h"
 #include "HumGrid.h"
 
 #include <string>
@@ -54,6 +55,12 @@ class Tool_musicxml2hum : public HumTool {
 		       ~Tool_musicxml2hum    () {}
 
 		bool    convertFile          (ostream& out, const char* filename);
+		bool    convertFile          (ostream& out, const char* filename,
+		                              pugi::xml_document& doc,
+		                              std::vector<char>& buffer);
+		bool    convertFiles         (ostream& out,
+		                              const std::vector<std::string>& filenames);
+		bool    convertStream        (ostream& out, MxmlStream& stream);
 		bool    convert              (ostream& out, pugi::xml_document& infile);
 		bool    convert              (ostream& out, const char* input);
 		bool    convert              (ostream& out, istream& input);
@@ -89,6 +96,22 @@ class Tool_musicxml2hum : public HumTool {
 		bool   fillPartData         (MxmlPart& partdata, const std::string& id,
 		                             pugi::xml_node partdeclaration,
 		                             pugi::xml_node partcontent);
+		bool   fillPartData         (std::vector<MxmlPart>& partdata,
+		                             const std::vector<std::string>& partids,
+		                             map<std::string, pugi::xml_node>& partinfo,
+		                             MxmlStream& stream,
+		                             const std::vector<int>& partindex);
+		void   addPartMeasure       (MxmlPart& partdata, pugi::xml_node measure);
+		bool   stitchParts          (HumGrid& outdata,
+		                             std::vector<MxmlPart>& partdata,
+		                             MxmlStream& stream,
+		                             const std::vector<int>& partindex);
+		void   releaseMeasureNodes  (pugi::xml_document& doc);
+		void   carryNode            (pugi::xml_node& node, pugi::xml_document& doc);
+		bool   convertGrid          (ostream& out, pugi::xml_document& doc,
+		                             HumGrid& outdata,
+		                             std::vector<std::string>& partids,
+		                             std::vector<MxmlPart>& partdata);
 		void   appendZeroEvents     (GridMeasure* outfile,
 		                             std::vector<SimultaneousEvents*>& nowevents,
 		                             HumNum nowtime,
@@ -209,6 +232,10 @@ class Tool_musicxml2hum : public HumTool {
 		void setSoftwareInfo   (pugi::xml_document& doc);
 		std::string getSystemDecoration(pugi::xml_document& doc, HumGrid& grid, std::vector<std::string>& partids);
 		void getChildrenVector (std::vector<pugi::xml_node>& children, pugi::xml_node parent);
+		pugi::xml_node getFirstNode(pugi::xml_node parent,
+		                        const std::vector<std::string>& path, int index = 0);
+		bool getInputFiles     (std::vector<std::string>& files, const std::string& path);
+		std::string getOutputFilename(const std::string& filename);
 		void insertPartTranspositions(pugi::xml_node transposition, GridPart& part);
 		pugi::xml_node convertTranspositionToHumdrum(pugi::xml_node transpose, HTp& token, int& staffindex);
 		void prepareRdfs       (std::vector<MxmlPart>& partdata);
@@ -267,6 +294,11 @@ class Tool_musicxml2hum : public HumTool {
 		// to process.
 		std::map<std::string, vector<pugi::xml_node>> m_post_note_text;
 
+		// m_carry: copies of pending direction nodes (m_current_dynamic,
+		// etc.) from measure documents which have been released when
+		// converting with --stream.
+		pugi::xml_document m_carry;
+
 };
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Sep  7 20:13:13 PDT 2019
-// Last Modified: Sat Sep  7 20:13:15 PDT 2019
+// Last Modified: Sun Oct 18 14:53:01 UTC 2026
 // Filename:      tool-pccount.h
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-pccount.h
 // Syntax:        C++11; humlib
@@ -15,6 +15,8 @@
 
 #include "HumTool.h"
 #include "HumdrumFile.h"
+#include "HumdrumFileStream.h"
+#include <cstdint>
 #include <map>
 #include <vector>
 
@@ -32,14 +34,36 @@ class Tool_pccount : public HumTool {
 		bool  run                       (HumdrumFile& infile);
 		bool  run                       (const string& indata, ostream& out);
 		bool  run                       (HumdrumFile& infile, ostream& out);
+		bool  run                       (HumdrumFileStream& instream, ostream& out);
+		bool  isBatchMode               (void);
  
 	protected:
 		void   initialize               (HumdrumFile& infile);
 		void   processFile              (HumdrumFile& infile);
 		void   initializePartInfo       (HumdrumFile& infile);
 		void   addCounts                (HTp sstart, HTp send);
+		void   addTokenCounts           (HTp token, double* counts);
+		void   addSubtokenCounts        (const std::string& subtoken,
+		                                 double* counts);
 		void   countPitches             (HumdrumFile& infile);
+		void   countMeasures            (HumdrumFile& infile);
 		void   printHumdrumTable        (void);
+		void   printProfiles            (ostream& out, const std::string& filename);
+		void   printCsvHeader           (ostream& out);
+		void   printCsvRow              (ostream& out, const std::string& filename,
+		                                 int measure, int part,
+		                                 const std::string& name,
+		                                 const double* counts);
+		void   writeBinaryHeader        (ostream& out);
+		void   writeBinaryBlock         (ostream& out, const std::string& filename,
+		                                 const std::vector<std::string>& names,
+		                                 const std::vector<int>& measures,
+		                                 const std::vector<double>& counts);
+		void   printTotals              (ostream& out,
+		                                 std::vector<std::vector<double>>& totals);
+		static void addTotals           (std::vector<std::vector<double>>& totals,
+		                                 const std::vector<std::vector<double>>& counts);
+		std::string getCsvField         (const std::string& value);
 		void   printPitchClassList      (void);
 		void   printVegaLiteJsonTemplate(const std::string& datavariable, HumdrumFile& infile);
 		void   printVegaLiteJsonData    (void);
@@ -71,6 +95,9 @@ class Tool_pccount : public HumTool {
 		std::vector<std::string>       m_names;
 		std::vector<std::string>       m_abbreviations;
 		std::vector<std::vector<double>> m_counts;
+		std::vector<std::vector<double>> m_totals;       // sum of m_counts (--csv)
+		std::vector<double>            m_measurecounts; // [measure][part][40]
+		std::vector<int>               m_measurenums;   // bar number of measures
 		bool m_attack       = false;
 		bool m_full         = false;
 		bool m_doublefull   = false;
@@ -81,6 +108,9 @@ class Tool_pccount : public HumTool {
 		bool m_script       = false;
 		bool m_html         = false;
 		bool m_page         = false;
+		bool m_csv          = false;
+		bool m_binary       = false;
+		bool m_measures     = false;
 		int  m_width        = 500;
 		double m_ratio      = 0.67;
 		bool m_key          = true;
@@ -39,7 +39,8 @@ class Tool_periodicity : public HumTool {
 		void     processFile        (HumdrumFile& infile);
 		void     fillAttackGrids    (HumdrumFile& infile, vector<vector<double>>& grids, HumNum minrhy);
 		void     printAttackGrid    (ostream& out, HumdrumFile& infile, vector<vector<double>>& grids, HumNum minrhy);
-		void     doAnalysis         (vector<vector<double>>& analysis, int level, vector<double>& grid);
+		void     doAnalysis         (vector<vector<double>>& analysis, int level,
+		                             vector<int>& positions, vector<double>& weights);
 		void     doPeriodicityAnalysis(vector<vector<double>> & analysis, vector<double>& grid, HumNum minrhy);
 		void     printPeriodicityAnalysis(ostream& out, vector<vector<double>>& analysis);
 		void     printSvgAnalysis(ostream& out, vector<vector<double>>& analysis, HumNum minrhy);
@@ -17,6 +17,8 @@
 #include "HumdrumFile.h"
 
 #include <iostream>
+#include <utility>
+#include <vector>
 
 namespace hum {
 
@@ -95,6 +97,37 @@ class MeasureComparison {
 
 
 
+// MeasureHistogramMatrix: pitch-class histograms of a MeasureDataSet,
+// normalized so that the correlation between two measures is the dot
+// product of their columns.  Stored as 7 rows (one for each pitch class)
+// of length size() for vectorized row-by-row evaluation.
+class MeasureHistogramMatrix {
+	public:
+		           MeasureHistogramMatrix (void);
+		           MeasureHistogramMatrix (MeasureDataSet& set);
+		          ~MeasureHistogramMatrix ();
+
+		void       clear                  (void);
+		void       load                   (MeasureDataSet& set);
+		int        size                   (void) const { return m_size; }
+		int        getState               (int index) const { return m_state[index]; }
+		const double* getRow              (int pc) const;
+		void       correlateRow           (const MeasureHistogramMatrix& other,
+		                                   int index, int startcol, int stopcol,
+		                                   double* output) const;
+
+		// histogram states:
+		enum { EMPTY = 0, FLAT = 1, NORMAL = 2 };
+
+	private:
+		std::vector<double> m_values;
+		std::vector<char>   m_state;
+		int                 m_size = 0;
+		MeasureDataSet*     m_set = NULL;
+};
+
+
+
 class MeasureComparisonGrid {
 	public:
 		             MeasureComparisonGrid     (void);
@@ -103,8 +136,16 @@ class MeasureComparisonGrid {
 		            ~MeasureComparisonGrid     ();
 
 		void         clear                     (void);
-		void         analyze                   (MeasureDataSet& set1, MeasureDataSet& set2);
-		void         analyze                   (MeasureDataSet* set1, MeasureDataSet* set2);
+		void         analyze                   (MeasureDataSet& set1, MeasureDataSet& set2,
+		                                        int threads = 1);
+		void         analyze                   (MeasureDataSet* set1, MeasureDataSet* set2,
+		                                        int threads = 1);
+		void         analyzeTopMatches         (MeasureDataSet& set1, MeasureDataSet& set2,
+		                                        int count, bool skipdiagonal = false,
+		                                        int threads = 1);
+		int          getRowCount               (void) { return m_rows; }
+		int          getColumnCount            (void) { return m_cols; }
+		double       getCorrelation            (int index1, int index2);
 
 		double       getStartTime1             (int index);
 		double       getStopTime1              (int index);
@@ -124,11 +165,23 @@ class MeasureComparisonGrid {
 		ostream&     printCorrelationGrid      (ostream& out = std::cout);
 		ostream&     printCorrelationDiagonal  (ostream& out = std::cout);
 		ostream&     printSvgGrid              (ostream& out = std::cout);
+		ostream&     printTopMatches           (ostream& out = std::cout);
 		void         getColorMapping           (double input, double& hue, double& saturation,
 				 double& lightness);
 
+	protected:
+		static void  printCorrelation          (ostream& out, double correl);
+
 	private:
-		std::vector<std::vector<MeasureComparison>> m_grid;
+		// m_grid: correlations stored row by row (m_rows x m_cols).
+		std::vector<double> m_grid;
+		int                 m_rows = 0;
+		int                 m_cols = 0;
+
+		// m_matches: most similar measures in set2 for each measure in set1,
+		// when analyzed with analyzeTopMatches().
+		std::vector<std::vector<std::pair<int, double>>> m_matches;
+
 		MeasureDataSet* m_set1 = NULL;
 		MeasureDataSet* m_set2 = NULL;
 };
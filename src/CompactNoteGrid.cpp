@@ -0,0 +1,408 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 06:08:53 UTC 2026
+// Last Modified: Sun Oct 18 06:08:53 UTC 2026
+// Filename:      CompactNoteGrid.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/CompactNoteGrid.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Struct-of-arrays version of NoteGrid.
+//
+
+#include "CompactNoteGrid.h"
+#include "HumdrumFileBase.h"
+#include "Convert.h"
+#include "HumRegex.h"
+
+#include <cstdlib>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+//////////////////////////////
+//
+// CompactNoteGrid::CompactNoteGrid -- Constructor.
+//
+
+CompactNoteGrid::CompactNoteGrid(void) {
+	// do nothing
+}
+
+
+CompactNoteGrid::CompactNoteGrid(HumdrumFileBase& infile) {
+	load(infile);
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::~CompactNoteGrid -- Deconstructor.
+//
+
+CompactNoteGrid::~CompactNoteGrid() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::clear -- Make the grid empty.  Allocated storage
+//     is kept so that a reload of the same file does not need to
+//     allocate again.
+//
+
+void CompactNoteGrid::clear(void) {
+	m_valid  = false;
+	m_voices = 0;
+	m_slices = 0;
+	m_b7.clear();
+	m_b12.clear();
+	m_b40.clear();
+	m_accidental.clear();
+	m_meter.clear();
+	m_currattack.clear();
+	m_prevattack.clear();
+	m_nextattack.clear();
+	m_tokens.clear();
+	m_lines.clear();
+	m_kernspines.clear();
+	m_meters.clear();
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::load -- Extract the primary-layer notes of each
+//     **kern spine for every data line in the file.  Returns false
+//     if there are no **kern spines or if a data line does not
+//     contain a token for each **kern spine.
+//
+
+bool CompactNoteGrid::load(HumdrumFileBase& infile) {
+	clear();
+
+	infile.getKernSpineStartList(m_kernspines);
+	if (m_kernspines.empty()) {
+		cerr << "Warning: no **kern spines in file" << endl;
+		return false;
+	}
+
+	int slices = 0;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isData()) {
+			slices++;
+		}
+	}
+
+	m_voices = (int)m_kernspines.size();
+	m_slices = slices;
+	int size = m_voices * m_slices;
+	m_b7.resize(size);
+	m_b12.resize(size);
+	m_b40.resize(size);
+	m_accidental.resize(size);
+	m_meter.resize(size);
+	m_currattack.resize(size);
+	m_prevattack.resize(size);
+	m_nextattack.resize(size);
+	m_tokens.resize(size);
+	m_lines.resize(m_slices);
+
+	// Time signatures are stored once in m_meters and referenced by index
+	// in each cell.  Index 0 is used for cells with no time signature.
+	m_meters.emplace_back(0, 0);
+	vector<int16_t> meters(infile.getMaxTrack() + 1, 0);
+
+	int sindex = 0;
+	int track;
+	int lasttrack;
+	int vindex;
+	HumRegex hre;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isInterpretation()) {
+			for (int j=0; j<infile[i].getFieldCount(); j++) {
+				HTp token = infile.token(i, j);
+				if (!token->isKern()) {
+					continue;
+				}
+				int top;
+				HumNum bot;
+				if (hre.search(*token, "\\*M(\\d+)/(\\d+)%(\\d+)")) {
+					top = hre.getMatchInt(1);
+					bot = hre.getMatchInt(2);
+					bot /= hre.getMatchInt(3);
+				} else if (hre.search(*token, "\\*M(\\d+)/(\\d+)")) {
+					top = hre.getMatchInt(1);
+					bot = hre.getMatchInt(2);
+				} else {
+					continue;
+				}
+				int mindex = -1;
+				for (int k=0; k<(int)m_meters.size(); k++) {
+					if ((m_meters[k].first == top) && (m_meters[k].second == bot)) {
+						mindex = k;
+						break;
+					}
+				}
+				if (mindex < 0) {
+					mindex = (int)m_meters.size();
+					m_meters.emplace_back(top, bot);
+				}
+				meters[token->getTrack()] = (int16_t)mindex;
+			}
+		}
+		if (!infile[i].isData()) {
+			continue;
+		}
+		m_lines[sindex] = i;
+		track = 0;
+		vindex = 0;
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			lasttrack = track;
+			track = token->getTrack();
+			if (!token->isDataType("**kern")) {
+				continue;
+			}
+			if (track == lasttrack) {
+				// secondary voice: ignore
+				continue;
+			}
+			if (vindex >= m_voices) {
+				vindex++;
+				break;
+			}
+			int cell = index(vindex, sindex);
+			m_tokens[cell] = token;
+			m_meter[cell] = meters[track];
+			storePitch(cell, token);
+			vindex++;
+		}
+		if (vindex != m_voices) {
+			cerr << "Error: Unequal vector sizes " << vindex
+			     << " compared to " << m_voices << endl;
+			// Keep the voice list, but do not store any slices:
+			vector<HTp> kernspines;
+			kernspines.swap(m_kernspines);
+			clear();
+			m_kernspines.swap(kernspines);
+			m_voices = (int)m_kernspines.size();
+			return false;
+		}
+		sindex++;
+	}
+
+	for (int i=0; i<m_voices; i++) {
+		buildAttackIndex(i);
+	}
+
+	m_valid = true;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::storePitch -- Fill in the pitch columns for a cell.
+//    Rests (including null tokens which resolve to rests) are stored
+//    as REST, and sustained notes (null tokens and secondary tied notes)
+//    are stored as negative values.  This follows the calculation in
+//    NoteCell::calculateNumericPitches(), including the handling of
+//    tokens with no pitch.
+//
+
+void CompactNoteGrid::storePitch(int cell, HTp token) {
+	int b40 = REST;
+	bool sustain = token->isNull() || token->isSecondaryTiedNote();
+	if (!token->isRest()) {
+		HTp resolve = token->resolveNull();
+		if (!resolve->isRest() && !resolve->isNull()) {
+			b40 = Convert::kernToBase40(resolve);
+			b40 = (sustain ? -b40 : b40);
+		}
+	}
+	m_b40[cell] = (int16_t)b40;
+	if ((b40 == REST) || (b40 == 0)) {
+		m_b7[cell]         = REST;
+		m_b12[cell]        = REST;
+		m_accidental[cell] = REST;
+		return;
+	}
+	int sign = b40 < 0 ? -1 : 1;
+	b40 *= sign;
+	m_b7[cell]         = (int16_t)(sign * Convert::base40ToDiatonic(b40));
+	m_b12[cell]        = (int16_t)(sign * Convert::base40ToMidiNoteNumber(b40));
+	m_accidental[cell] = (int16_t)(sign * Convert::base40ToAccidental(b40));
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::buildAttackIndex -- Create the current, forward and
+//     backward note attack indexes for each cell in a single voice.
+//     The first rest in a sequence of rests is treated as the "attack"
+//     of the rest.
+//
+
+void CompactNoteGrid::buildAttackIndex(int vindex) {
+	int start = index(vindex, 0);
+	const int16_t* b40 = m_b40.data() + start;
+	int* curr = m_currattack.data() + start;
+	int* prev = m_prevattack.data() + start;
+	int* next = m_nextattack.data() + start;
+
+	for (int i=0; i<m_slices; i++) {
+		if (i == 0) {
+			curr[i] = 0;
+		} else if (b40[i] == REST) {
+			curr[i] = (b40[i-1] == REST) ? curr[i-1] : i;
+		} else if (b40[i] > 0) {
+			curr[i] = i;
+		} else {
+			curr[i] = curr[i-1];
+		}
+	}
+
+	// The previous attack of a sustain is the same as for its attack:
+	int value = -1;
+	for (int i=0; i<m_slices; i++) {
+		if (isSustained(vindex, i)) {
+			prev[i] = (i > 0) ? prev[i-1] : -1;
+		} else {
+			prev[i] = value;
+			value = i;
+		}
+	}
+
+	value = -1;
+	for (int i=m_slices-1; i>=0; i--) {
+		next[i] = value;
+		if (!isSustained(vindex, i)) {
+			value = i;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::isAttack -- True if the cell is a note attack
+//     (rests are never attacks).
+//
+
+bool CompactNoteGrid::isAttack(int vindex, int sindex) const {
+	return m_b40[index(vindex, sindex)] > 0;
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::isSustained -- True if the cell is a sustained note,
+//     or a rest which is not the first in a sequence of rests.
+//
+
+bool CompactNoteGrid::isSustained(int vindex, int sindex) const {
+	int cell = index(vindex, sindex);
+	int16_t value = m_b40[cell];
+	if (value > 0) {
+		return false;
+	} else if ((value < 0) && (value != REST)) {
+		return true;
+	}
+	return m_currattack[cell] != sindex;
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::getDiatonicColumn -- Return the diatonic pitches for
+//     all slices of a voice.  Similarly for MIDI, base-40 and accidentals.
+//
+
+const int16_t* CompactNoteGrid::getDiatonicColumn(int vindex) const {
+	return m_b7.data() + index(vindex, 0);
+}
+
+
+const int16_t* CompactNoteGrid::getMidiColumn(int vindex) const {
+	return m_b12.data() + index(vindex, 0);
+}
+
+
+const int16_t* CompactNoteGrid::getBase40Column(int vindex) const {
+	return m_b40.data() + index(vindex, 0);
+}
+
+
+const int16_t* CompactNoteGrid::getAccidentalColumn(int vindex) const {
+	return m_accidental.data() + index(vindex, 0);
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::getMeterTop -- Return the top number of the time
+//     signature active for the cell (0 if none).
+//
+
+int CompactNoteGrid::getMeterTop(int vindex, int sindex) const {
+	return m_meters[m_meter[index(vindex, sindex)]].first;
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::getMeterBottom -- Return the bottom number of the time
+//     signature active for the cell (0 if none).
+//
+
+HumNum CompactNoteGrid::getMeterBottom(int vindex, int sindex) const {
+	return m_meters[m_meter[index(vindex, sindex)]].second;
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::getMemoryUsage -- Return the number of bytes used
+//     by the grid.
+//
+
+size_t CompactNoteGrid::getMemoryUsage(void) const {
+	size_t output = sizeof(*this);
+	output += m_b7.capacity()         * sizeof(int16_t);
+	output += m_b12.capacity()        * sizeof(int16_t);
+	output += m_b40.capacity()        * sizeof(int16_t);
+	output += m_accidental.capacity() * sizeof(int16_t);
+	output += m_meter.capacity()      * sizeof(int16_t);
+	output += m_currattack.capacity() * sizeof(int);
+	output += m_prevattack.capacity() * sizeof(int);
+	output += m_nextattack.capacity() * sizeof(int);
+	output += m_tokens.capacity()     * sizeof(HTp);
+	output += m_lines.capacity()      * sizeof(int);
+	output += m_kernspines.capacity() * sizeof(HTp);
+	output += m_meters.capacity()     * sizeof(pair<int, HumNum>);
+	return output;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
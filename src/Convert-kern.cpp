@@ -21,6 +21,9 @@ namespace hum {
 
 // START_MERGE
 
+thread_local unordered_map<string, KernDecoding> Convert::s_kernDecodings;
+thread_local const pair<const string, KernDecoding>* Convert::s_lastKernDecoding = NULL;
+
 
 //////////////////////////////
 //
@@ -408,6 +411,97 @@ string Convert::kernToRecip(HTp token) {
 
 
 
+//////////////////////////////
+//
+// Convert::decodeKern -- Return the pitch and rhythm information for
+//     a **kern token.  Each distinct token string is parsed only once per
+//     thread, and later requests for the same string are served from a
+//     cache.  The returned reference is valid until the next call to
+//     decodeKern() in the same thread.
+//
+
+const KernDecoding& Convert::decodeKern(const string& kerndata) {
+	// Long strings are unlikely to repeat, so do not store them.
+	if (kerndata.size() > 32) {
+		static thread_local KernDecoding scratch;
+		Convert::fillKernDecoding(scratch, kerndata);
+		return scratch;
+	}
+	// Pitch and rhythm are often requested one after another for the
+	// same token, so check the previous entry before searching the cache.
+	const auto* last = s_lastKernDecoding;
+	if (last && (last->first == kerndata)) {
+		return last->second;
+	}
+	auto it = s_kernDecodings.find(kerndata);
+	if (it == s_kernDecodings.end()) {
+		if (s_kernDecodings.size() >= 0x10000) {
+			s_kernDecodings.clear();
+		}
+		it = s_kernDecodings.emplace(kerndata, KernDecoding()).first;
+		Convert::fillKernDecoding(it->second, kerndata);
+	}
+	s_lastKernDecoding = &(*it);
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::clearKernDecodings -- Free the decodeKern() cache for the
+//     current thread.
+//
+
+void Convert::clearKernDecodings(void) {
+	s_lastKernDecoding = NULL;
+	s_kernDecodings.clear();
+}
+
+
+
+//////////////////////////////
+//
+// Convert::fillKernDecoding -- Parse a **kern token for decodeKern().
+//
+
+void Convert::fillKernDecoding(KernDecoding& decoding, const string& kerndata) {
+	int diatonic = Convert::kernToDiatonicPC(kerndata);
+	int octave   = Convert::kernToOctaveNumber(kerndata);
+	decoding.octave = octave;
+	decoding.accidentals = (short)Convert::kernToAccidentalCount(kerndata);
+	decoding.base7 = diatonic < 0 ? diatonic : diatonic + 7 * octave;
+	int pc40 = Convert::kernToBase40PC(kerndata);
+	decoding.base40 = pc40 < 0 ? pc40 : pc40 + 40 * octave;
+	decoding.base12 = Convert::kernToBase12PC(kerndata) + 12 * octave;
+	decoding.duration = Convert::recipToDurationUncached(kerndata);
+
+	decoding.dots        = 0;
+	decoding.rest        = false;
+	decoding.grace       = false;
+	decoding.tieStart    = false;
+	decoding.tieContinue = false;
+	decoding.tieEnd      = false;
+	decoding.slurStart   = false;
+	decoding.slurEnd     = false;
+	for (int i=0; i<(int)kerndata.size(); i++) {
+		switch (kerndata[i]) {
+			case ' ': i = (int)kerndata.size(); break;
+			case '.': decoding.dots++;              break;
+			case 'r': decoding.rest        = true;  break;
+			case 'q': decoding.grace       = true;  break;
+			case 'Q': decoding.grace       = true;  break;
+			case '[': decoding.tieStart    = true;  break;
+			case '_': decoding.tieContinue = true;  break;
+			case ']': decoding.tieEnd      = true;  break;
+			case '(': decoding.slurStart   = true;  break;
+			case ')': decoding.slurEnd     = true;  break;
+		}
+	}
+}
+
+
+
 // END_MERGE
 
 } // end namespace hum
@@ -231,16 +231,12 @@ int Convert::kernToBase40PC(const string& kerndata) {
 //////////////////////////////
 //
 // Convert::kernToBase40 -- Convert **kern pitch to a base-40 integer.
-//    Will ignore subsequent pitches in a chord.
+//    Will ignore subsequent pitches in a chord.  The pitch is taken
+//    from the decodeKern() cache.
 //
 
 int Convert::kernToBase40(const string& kerndata) {
-	int pc = Convert::kernToBase40PC(kerndata);
-	if (pc < 0) {
-		return pc;
-	}
-	int octave   = Convert::kernToOctaveNumber(kerndata);
-	return pc + 40 * octave;
+	return Convert::decodeKern(kerndata).base40;
 }
 
 
@@ -277,13 +273,11 @@ int Convert::kernToBase12PC(const string& kerndata) {
 //////////////////////////////
 //
 // Convert::kernToBase12 -- Convert **kern pitch to a base-12 integer.
-//     (middle C = 48).
+//     (middle C = 48).  The pitch is taken from the decodeKern() cache.
 //
 
 int Convert::kernToBase12(const string& kerndata) {
-	int pc = Convert::kernToBase12PC(kerndata);
-	int octave = Convert::kernToOctaveNumber(kerndata);
-	return pc + 12 * octave;
+	return Convert::decodeKern(kerndata).base12;
 }
 
 
@@ -487,16 +481,12 @@ int Convert::kernToMidiNoteNumber(const string& kerndata) {
 //////////////////////////////
 //
 // Convert::kernToBase7 -- Convert **kern pitch to a base-7 integer.
-//    This is a diatonic pitch class with C=0, D=1, ..., B=6.
+//    This is a diatonic pitch class with C=0, D=1, ..., B=6.  The pitch
+//    is taken from the decodeKern() cache.
 //
 
 int Convert::kernToBase7(const string& kerndata) {
-	int diatonic = Convert::kernToDiatonicPC(kerndata);
-	if (diatonic < 0) {
-		return diatonic;
-	}
-	int octave = Convert::kernToOctaveNumber(kerndata);
-	return diatonic + 7 * octave;;
+	return Convert::decodeKern(kerndata).base7;
 }
 
 
@@ -36,6 +36,8 @@ namespace hum {
 //     string contains a space, anything after the first space will be ignored
 //     when extracting the string.  **kern data which also includes the pitch
 //     along with the rhythm can also be given and will be ignored.
+//     Durations for the default separator are taken from the decodeKern()
+//     cache, so each distinct string is only parsed once.
 // default value: scale = 4 (duration in terms of quarter notes)
 // default value: separator = " " (sub-token separator)
 //
@@ -48,6 +50,29 @@ HumNum Convert::recipToDuration(string* recip, HumNum scale,
 
 HumNum Convert::recipToDuration(const string& recip, HumNum scale,
 		const string& separator) {
+	if (separator != " ") {
+		return Convert::recipToDurationUncached(recip, scale, separator);
+	}
+	const HumNum& duration = Convert::decodeKern(recip).duration;
+	if (scale == 4) {
+		return duration;
+	}
+	return duration * scale / 4;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::recipToDurationUncached -- Same as recipToDuration(), but
+//     always parse the input string rather than using the decodeKern()
+//     cache.
+// default value: scale = 4 (duration in terms of quarter notes)
+// default value: separator = " " (sub-token separator)
+//
+
+HumNum Convert::recipToDurationUncached(const string& recip, HumNum scale,
+		const string& separator) {
 	size_t loc;
 	loc = recip.find(separator);
 	string subtok;
@@ -240,7 +265,7 @@ HumNum Convert::recipToDurationNoDots(const string& recip, HumNum scale,
 		const string& separator) {
 	string temp = recip;
 	std::replace(temp.begin(), temp.end(), '.', 'Z');
-	return Convert::recipToDuration(temp, scale, separator);
+	return Convert::recipToDurationUncached(temp, scale, separator);
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Sun Aug  9 21:03:12 PDT 2015
+// Last Modified: Sun Oct 18 09:29:43 UTC 2026
 // Filename:      Convert-string.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/Convert-string.cpp
 // Syntax:        C++11; humlib
@@ -440,6 +440,21 @@ void Convert::removeDollarsFromString(string& buffer, int maximum) {
 
 
 
+//////////////////////////////
+//
+// Convert::appendLittleEndian -- Append the lowest bytes of a value to
+//    a string in little-endian order (used for packed binary output).
+//
+
+void Convert::appendLittleEndian(string& output, uint64_t value, int bytes) {
+	for (int i=0; i<bytes; i++) {
+		output.push_back((char)(value & 0xff));
+		value >>= 8;
+	}
+}
+
+
+
 // END_MERGE
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Oct 16 16:08:05 PDT 2016
-// Last Modified: Sun Oct 16 16:08:08 PDT 2016
+// Last Modified: Sun Oct 18 10:49:06 UTC 2026
 // Filename:      GridSide.cpp
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/src/GridSide.cpp
 // Syntax:        C++11; humlib
@@ -55,6 +55,11 @@ GridSide::~GridSide(void) {
 		delete m_harmony;
 		m_harmony = NULL;
 	}
+
+	if (m_figured_bass) {
+		delete m_figured_bass;
+		m_figured_bass = NULL;
+	}
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Oct 16 16:08:05 PDT 2016
-// Last Modified: Sun Oct 16 16:08:08 PDT 2016
+// Last Modified: Sun Oct 18 10:49:06 UTC 2026
 // Filename:      GridSlice.cpp
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/src/GridSlice.cpp
 // Syntax:        C++11; humlib
@@ -254,7 +254,9 @@ bool GridSlice::isDataSlice(void) {
 //////////////////////////////
 //
 // GridSlice::transferTokens -- Create a HumdrumLine and append it to
-//    the data.
+//    the data.  The start time of a line for a note or grace-note slice
+//    and the durations of the notes are taken from the grid, so they do not
+//    have to be parsed again by HumdrumFileStructure::analyzeFromTokens().
 //
 
 void GridSlice::transferTokens(HumdrumFile& outfile, bool recip) {
@@ -337,6 +339,14 @@ void GridSlice::transferTokens(HumdrumFile& outfile, bool recip) {
 			} else {
 				for (v=0; v<(int)staff.size(); v++) {
 					if (staff.at(v) && staff.at(v)->getToken()) {
+						if (isNoteSlice() && !staff.at(v)->isNull()
+								&& staff.at(v)->getDuration().isPositive()) {
+							// Pass the duration of the note on to the analysis
+							// (see HumdrumFileStructure::analyzeFromTokens()).
+							// Tokens added without a duration are parsed.
+							staff.at(v)->getToken()->setDuration(
+									staff.at(v)->getDuration());
+						}
 						line->appendToken(staff.at(v)->getToken());
 						staff.at(v)->forgetToken();
 					} else if (!staff.at(v)) {
@@ -373,6 +383,9 @@ void GridSlice::transferTokens(HumdrumFile& outfile, bool recip) {
 		}
 	}
 
+	if (isNoteSlice() || isGraceSlice()) {
+		line->setDurationFromStart(getTimestamp());
+	}
 	outfile.appendLine(line);
 }
 
@@ -490,7 +503,9 @@ int GridSlice::getFiguredBassCount(int partindex, int staffindex) {
 
 //////////////////////////////
 //
-// GridSlice::transferSides --
+// GridSlice::transferSides -- Move the verse, dynamics, figured bass
+//     and harmony tokens to the line, which is then responsible for
+//     deleting them.
 //
 
 // this version is used to transfer Sides from the Part
@@ -507,7 +522,7 @@ void GridSlice::transferSides(HumdrumLine& line, GridPart& sides,
 		HTp verse = sides.getVerse(i);
 		if (verse) {
 			line.appendToken(verse);
-			sides.detachHarmony();
+			sides.setVerse(i, NULL); // needed to avoid double delete
 		} else {
 			newtoken = new HumdrumToken(empty);
 			line.appendToken(newtoken);
@@ -0,0 +1,286 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 00:10:57 UTC 2026
+// Last Modified: Sun Oct 18 10:49:06 UTC 2026
+// Filename:      HumArena.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumArena.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Block allocator for HumdrumLine, HumdrumToken and HumGrid
+//                node objects.
+//
+
+#include "HumArena.h"
+
+#include <new>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+thread_local HumArena* HumArena::s_active = NULL;
+std::atomic<int> HumArena::s_retired(0);
+
+// HUMARENA_ALIGN: alignment of objects in the arena.  Each object is
+// preceded by a header of this size which stores the block which owns it
+// (or NULL if the object was allocated on the heap).
+#define HUMARENA_ALIGN (alignof(std::max_align_t))
+
+// HUMARENA_BLOCK: default size of an arena memory block.
+#define HUMARENA_BLOCK (64 * 1024)
+
+
+//////////////////////////////
+//
+// HumArena::HumArena -- Constructor.
+//
+
+HumArena::HumArena(void) {
+	m_used    = 0;
+	m_size    = 0;
+	m_objects = 0;
+	m_tokens  = NULL;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::~HumArena -- Deconstructor.
+//
+
+HumArena::~HumArena() {
+	clear();
+	if (s_active == this) {
+		s_active = NULL;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::clear -- Release all memory blocks of the arena.  Blocks
+//    which still contain undeleted objects will be freed when the last
+//    object in the block is deleted.
+//
+
+void HumArena::clear(void) {
+	for (int i=0; i<(int)m_blocks.size(); i++) {
+		if (m_blocks[i]->m_live == 0) {
+			::operator delete(m_blocks[i]);
+		} else {
+			m_blocks[i]->m_retired = true;
+			s_retired++;
+		}
+	}
+	m_blocks.clear();
+	m_used    = 0;
+	m_size    = 0;
+	m_objects = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::getBlockCount -- Return the number of memory blocks
+//     allocated by the arena.
+//
+
+int HumArena::getBlockCount(void) const {
+	return (int)m_blocks.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::getObjectCount -- Return the number of objects allocated
+//     from the arena since it was last cleared.
+//
+
+size_t HumArena::getObjectCount(void) const {
+	return m_objects;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::getRetiredBlockCount -- Return the number of memory blocks
+//     which are still in use by objects after their arena was cleared
+//     (in any thread).
+//
+
+int HumArena::getRetiredBlockCount(void) {
+	return s_retired;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::getActive -- Return the arena used for allocating lines
+//     and tokens in the current thread.  Returns NULL if objects
+//     are allocated on the heap.
+//
+
+HumArena* HumArena::getActive(void) {
+	return s_active;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::setActive -- Set the arena used for allocating lines and
+//     tokens in the current thread.  Use NULL to allocate on the heap.
+//     Returns the previously active arena so that it can be restored.
+//
+
+HumArena* HumArena::setActive(HumArena* arena) {
+	HumArena* output = s_active;
+	s_active = arena;
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::setTokenArena -- Set the arena for allocating tokens while
+//     this arena is active.  Use NULL to allocate tokens from this arena.
+//
+
+void HumArena::setTokenArena(HumArena* arena) {
+	m_tokens = arena;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::getTokenArena -- Return the arena for allocating tokens
+//     while this arena is active, or NULL if they are allocated from it.
+//
+
+HumArena* HumArena::getTokenArena(void) const {
+	return m_tokens;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::allocateObject -- Allocate memory for an object from the
+//     active arena, or from the heap if there is no active arena.
+//
+
+void* HumArena::allocateObject(size_t size) {
+	return allocateFrom(s_active, size);
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::allocateToken -- Allocate memory for a token from the token
+//     arena of the active arena (see setTokenArena()), otherwise the same
+//     as allocateObject().
+//
+
+void* HumArena::allocateToken(size_t size) {
+	if (s_active && s_active->m_tokens) {
+		return allocateFrom(s_active->m_tokens, size);
+	}
+	return allocateFrom(s_active, size);
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::allocateFrom -- Allocate memory for an object from the
+//     given arena, or from the heap if the arena is NULL.  The object
+//     is preceded by a header which stores its block.
+//
+
+void* HumArena::allocateFrom(HumArena* arena, size_t size) {
+	char* memory;
+	size_t total = size + HUMARENA_ALIGN;
+	if (arena) {
+		memory = (char*)arena->allocate(total);
+		*((HumArenaBlock**)memory) = arena->m_blocks.back();
+	} else {
+		memory = (char*)::operator new(total);
+		*((HumArenaBlock**)memory) = NULL;
+	}
+	return memory + HUMARENA_ALIGN;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::freeObject -- Free memory allocated with allocateObject().
+//
+
+void HumArena::freeObject(void* pointer) {
+	if (pointer == NULL) {
+		return;
+	}
+	char* memory = (char*)pointer - HUMARENA_ALIGN;
+	HumArenaBlock* block = *((HumArenaBlock**)memory);
+	if (block == NULL) {
+		::operator delete(memory);
+		return;
+	}
+	block->m_live--;
+	if (block->m_retired && (block->m_live == 0)) {
+		::operator delete(block);
+		s_retired--;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::allocate -- Return the next piece of memory from the
+//     current block, starting a new block if there is not enough space
+//     in it.  Objects larger than the default block size get their
+//     own block.
+//
+
+void* HumArena::allocate(size_t size) {
+	size = (size + HUMARENA_ALIGN - 1) / HUMARENA_ALIGN * HUMARENA_ALIGN;
+	if (m_blocks.empty() || (m_used + size > m_size)) {
+		size_t blocksize = HUMARENA_BLOCK;
+		if (size + HUMARENA_ALIGN > blocksize) {
+			blocksize = size + HUMARENA_ALIGN;
+		}
+		HumArenaBlock* block = (HumArenaBlock*)::operator new(blocksize);
+		block->m_live    = 0;
+		block->m_retired = false;
+		m_blocks.push_back(block);
+		m_used = HUMARENA_ALIGN;
+		m_size = blocksize;
+	}
+	char* output = (char*)m_blocks.back() + m_used;
+	m_used += size;
+	m_blocks.back()->m_live++;
+	m_objects++;
+	return output;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Oct 16 16:08:05 PDT 2016
-// Last Modified: Tue Nov  8 19:59:10 PST 2016
+// Last Modified: Sun Oct 18 10:49:06 UTC 2026
 // Filename:      HumGrid.cpp
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/src/HumGrid.cpp
 // Syntax:        C++11; humlib
@@ -18,6 +18,7 @@
 #include <string.h>
 
 #include <stdio.h>
+#include <algorithm>
 #include <iomanip>
 
 using namespace std;
@@ -45,6 +46,8 @@ HumGrid::HumGrid(void) {
 	m_musicxmlbarlines = false;
 	m_recip = false;
 	m_pickup = false;
+
+	m_arena.setTokenArena(&m_tokenarena);
 }
 
 
@@ -89,6 +92,31 @@ void HumGrid::enableRecipSpine(void) {
 
 
 
+//////////////////////////////
+//
+// HumGrid::getArena -- Return the arena for allocating the slices,
+//     parts, staves, voices and tokens of the grid.  Make it active
+//     with HumArena::setActive() while building the grid, so that these
+//     objects are carved out of large memory blocks.  Tokens are
+//     allocated from separate blocks (see HumArena::setTokenArena()).
+//     transferTokens() moves the grid tokens into the output file and
+//     allocates the new lines and tokens from the output file's arena
+//     (HumdrumFileBase::getArena()), so the blocks of the slices, parts,
+//     staves and voices are freed when the grid is deleted, and the
+//     token blocks when the output file is cleared.  Objects created for
+//     the output file after transferTokens() while the grid arena is
+//     still active would be allocated from the grid's blocks, so make
+//     the output file's arena active (or restore the previous one)
+//     before further editing of the file.  The previously active arena
+//     should be restored before the grid goes out of scope.
+//
+
+HumArena* HumGrid::getArena(void) {
+	return &m_arena;
+}
+
+
+
 //////////////////////////////
 //
 // HumGrid::getPartCount -- Return the number of parts in the Grid
@@ -336,7 +364,12 @@ void HumGrid::setVerseCount(int partindex, int staffindex, int count) {
 
 //////////////////////////////
 //
-// HumGrid::transferTokens --
+// HumGrid::transferTokens -- Create the lines of the output file from
+//   the tokens in the grid.  The lines are not analyzed: use
+//   HumdrumFileStructure::analyzeFromTokens() after adding any header or
+//   footer records instead of printing the data and reading it again
+//   (the start times of the note slices and the durations of their notes
+//   are passed on to the analysis).
 //   default value: startbarnum = 0.
 //
 
@@ -347,15 +380,15 @@ bool HumGrid::transferTokens(HumdrumFile& outfile, int startbarnum) {
 	}
 	calculateGridDurations();
 	addNullTokens();
-	addInvisibleRestsInFirstTrack();
-	addMeasureLines();
-	buildSingleList();  // is this needed a second time?
-	cleanTempos();
 	addLastMeasure();
-	if (manipulatorCheck()) {
+	if (finalizeSlices()) {
 		cleanupManipulators();
 	}
 
+	// Allocate the output lines and tokens from the arena of the output
+	// file so that the grid's memory blocks are not kept alive by them:
+	HumArena* gridarena = HumArena::setActive(outfile.getArena());
+
 	insertPartNames(outfile);
 	insertStaffIndications(outfile);
 	insertPartIndications(outfile);
@@ -372,6 +405,7 @@ bool HumGrid::transferTokens(HumdrumFile& outfile, int startbarnum) {
 		}
 	}
 	insertDataTerminationLine(outfile);
+	HumArena::setActive(gridarena);
 	return true;
 }
 
@@ -940,81 +974,6 @@ GridVoice* HumGrid::createVoice(const string& tok, const string& post, HumNum du
 
 
 //////////////////////////////
-//
-// HumGrid::getNextSpinedLine -- Find next spined GridSlice.
-//
-
-GridSlice* HumGrid::getNextSpinedLine(const GridMeasure::iterator& it, int measureindex) {
-	auto nextone = it;
-	nextone++;
-	while (nextone != this->at(measureindex)->end()) {
-		if ((*nextone)->hasSpines()) {
-			break;
-		}
-		nextone++;
-	}
-
-	if (nextone != this->at(measureindex)->end()) {
-		return *nextone;
-	}
-
-	measureindex++;
-	if (measureindex >= (int)this->size()) {
-		// end of data, so nothing to adjust with
-		// but this should never happen in general.
-		return NULL;
-	}
-	nextone = this->at(measureindex)->begin();
-	while (nextone != this->at(measureindex)->end()) {
-		if ((*nextone)->hasSpines()) {
-			return *nextone;
-		}
-		nextone++;
-	}
-
-	return NULL;
-}
-
-
-
-//////////////////////////////
-//
-// HumGrid::manipulatorCheck --
-//
-
-bool HumGrid::manipulatorCheck(void) {
-	GridSlice* manipulator;
-	int m;
-	GridSlice* s1;
-	GridSlice* s2;
-	bool output = false;
-	for (m=0; m<(int)this->size(); m++) {
-		if (this->at(m)->size() == 0) {
-			continue;
-		}
-		for (auto it = this->at(m)->begin(); it != this->at(m)->end(); it++) {
-			if (!(*it)->hasSpines()) {
-				// Don't monitor manipulators on no-spined lines.
-				continue;
-			}
-			s1 = *it;
-			s2 = getNextSpinedLine(it, m);
-
-			manipulator = manipulatorCheck(s1, s2);
-			if (manipulator == NULL) {
-				continue;
-			}
-			output = true;
-			auto inserter = it;
-			inserter++;
-			this->at(m)->insert(inserter, manipulator);
-			it++; // skip over the new manipulator line (expand it later)
-		}
-	}
-	return output;
-}
-
-
 //
 // HumGrid::manipulatorCheck -- Look for differences in voice/layer count
 //   for each part/staff pairing between adjacent lines.  If they do not match,
@@ -1213,86 +1172,73 @@ HTp HumGrid::createHumdrumToken(const string& tok, int pindex, int sindex) {
 
 //////////////////////////////
 //
-// HumGrid::addMeasureLines --
+// HumGrid::addMeasureLine -- Add a barline slice to the end of the
+//    given measure, with the timestamp of the start of the next measure.
+//    Returns the new slice, or NULL if no barline was added.
 //
 
-void HumGrid::addMeasureLines(void) {
-	HumNum timestamp;
-	GridSlice* mslice;
-	GridSlice* endslice;
-	GridPart* part;
-	GridStaff* staff;
-	GridVoice* gv;
-	string token;
-	int staffcount, partcount, vcount, nextvcount, lcount;
-	GridMeasure* measure = NULL;
-	GridMeasure* nextmeasure = NULL;
+GridSlice* HumGrid::addMeasureLine(int m, vector<int>& barnums) {
+	GridMeasure* measure = this->at(m);
+	GridMeasure* nextmeasure = this->at(m+1);
+	if (nextmeasure->size() == 0) {
+		// next measure is empty for some reason so give up
+		return NULL;
+	}
+	GridSlice* firstspined = nextmeasure->getFirstSpinedSlice();
+	HumNum timestamp = firstspined->getTimestamp();
+	if (measure->size() == 0) {
+		return NULL;
+	}
+	if (measure->getDuration() == 0) {
+		return NULL;
+	}
 
-	vector<int> barnums;
-	if (!m_musicxmlbarlines) {
-		getMetricBarNumbers(barnums);
+	GridSlice* mslice = new GridSlice(measure, timestamp, SliceType::Measures);
+	// what to do when endslice is NULL?
+	GridSlice* endslice = measure->getLastSpinedSlice(); // this has to come before next line
+	measure->push_back(mslice); // this has to come after the previous line
+	int partcount = (int)firstspined->size();
+	mslice->resize(partcount);
+
+	int num = measure->getMeasureNumber();
+	if (m < (int)barnums.size() - 1) {
+		num = barnums[m+1];
 	}
+	string token = createBarToken(m, num, measure);
 
-	for (int m=0; m<(int)this->size()-1; m++) {
-		measure = this->at(m);
-		nextmeasure = this->at(m+1);
-		if (nextmeasure->size() == 0) {
-			// next measure is empty for some reason so give up
-			continue;
-		}
-		GridSlice* firstspined = nextmeasure->getFirstSpinedSlice();
-		timestamp = firstspined->getTimestamp();
-		if (measure->size() == 0) {
-			continue;
-		}
+	for (int p=0; p<partcount; p++) {
+		GridPart* part = new GridPart();
+		mslice->at(p) = part;
+		int staffcount = (int)firstspined->at(p)->size();
+		mslice->at(p)->resize(staffcount);
+		for (int s=0; s<(int)staffcount; s++) {
+			GridStaff* staff = new GridStaff;
+			mslice->at(p)->at(s) = staff;
 
-		if (measure->getDuration() == 0) {
-			continue;
-		}
-		mslice = new GridSlice(measure, timestamp, SliceType::Measures);
-		// what to do when endslice is NULL?
-		endslice = measure->getLastSpinedSlice(); // this has to come before next line
-		measure->push_back(mslice); // this has to come after the previous line
-		partcount = (int)firstspined->size();
-		mslice->resize(partcount);
-
-		for (int p=0; p<partcount; p++) {
-			part = new GridPart();
-			mslice->at(p) = part;
-			staffcount = (int)firstspined->at(p)->size();
-			mslice->at(p)->resize(staffcount);
-			for (int s=0; s<(int)staffcount; s++) {
-				staff = new GridStaff;
-				mslice->at(p)->at(s) = staff;
-
-				// insert the minimum number of barlines based on the
-				// voices in the current and next measure.
-				vcount = (int)endslice->at(p)->at(s)->size();
-				if (firstspined) {
-					nextvcount = (int)firstspined->at(p)->at(s)->size();
-				} else {
-					// perhaps an empty measure?  This will cause problems.
-					nextvcount = 0;
-				}
-				lcount = vcount;
-				if (lcount > nextvcount) {
-					lcount = nextvcount;
-				}
-				if (lcount == 0) {
-					lcount = 1;
-				}
-				for (int v=0; v<lcount; v++) {
-					int num = measure->getMeasureNumber();
-					if (m < (int)barnums.size() - 1) {
-						num = barnums[m+1];
-					}
-					token = createBarToken(m, num, measure);
-					gv = new GridVoice(token, 0);
-					mslice->at(p)->at(s)->push_back(gv);
-				}
+			// insert the minimum number of barlines based on the
+			// voices in the current and next measure.
+			int vcount = (int)endslice->at(p)->at(s)->size();
+			int nextvcount;
+			if (firstspined) {
+				nextvcount = (int)firstspined->at(p)->at(s)->size();
+			} else {
+				// perhaps an empty measure?  This will cause problems.
+				nextvcount = 0;
+			}
+			int lcount = vcount;
+			if (lcount > nextvcount) {
+				lcount = nextvcount;
+			}
+			if (lcount == 0) {
+				lcount = 1;
+			}
+			for (int v=0; v<lcount; v++) {
+				GridVoice* gv = new GridVoice(token, 0);
+				mslice->at(p)->at(s)->push_back(gv);
 			}
 		}
 	}
+	return mslice;
 }
 
 
@@ -1512,138 +1458,6 @@ bool HumGrid::buildSingleList(void) {
 
 
 
-//////////////////////////////
-//
-// HumGrid::addNullTokensForGraceNotes -- Avoid grace notes at
-//     starts of measures from contracting the subspine count.
-//
-
-void HumGrid::addNullTokensForGraceNotes(void) {
-	// add null tokens for grace notes in other voices
-	GridSlice *lastnote = NULL;
-	GridSlice *nextnote = NULL;
-	for (int i=0; i<(int)m_allslices.size(); i++) {
-		if (!m_allslices[i]->isGraceSlice()) {
-			continue;
-		}
-		// cerr << "PROCESSING " << m_allslices[i] << endl;
-		lastnote = NULL;
-		nextnote = NULL;
-
-		for (int j=i+1; j<(int)m_allslices.size(); j++) {
-			if (m_allslices[j]->isNoteSlice()) {
-				nextnote = m_allslices[j];
-				break;
-			}
-		}
-		if (nextnote == NULL) {
-			continue;
-		}
-
-		for (int j=i-1; j>=0; j--) {
-			if (m_allslices[j]->isNoteSlice()) {
-				lastnote = m_allslices[j];
-				break;
-			}
-		}
-		if (lastnote == NULL) {
-			continue;
-		}
-
-		fillInNullTokensForGraceNotes(m_allslices[i], lastnote, nextnote);
-	}
-}
-
-
-
-//////////////////////////////
-//
-// HumGrid::addNullTokensForLayoutComments -- Avoid layout in multi-subspine
-//     regions from contracting to a single spine.
-//
-
-void HumGrid::addNullTokensForLayoutComments(void) {
-	// add null tokens for key changes in other voices
-	GridSlice *lastnote = NULL;
-	GridSlice *nextnote = NULL;
-	for (int i=0; i<(int)m_allslices.size(); i++) {
-		if (!m_allslices[i]->isLocalLayoutSlice()) {
-			continue;
-		}
-		// cerr << "PROCESSING " << m_allslices[i] << endl;
-		lastnote = NULL;
-		nextnote = NULL;
-
-		for (int j=i+1; j<(int)m_allslices.size(); j++) {
-			if (m_allslices[j]->isNoteSlice()) {
-				nextnote = m_allslices[j];
-				break;
-			}
-		}
-		if (nextnote == NULL) {
-			continue;
-		}
-
-		for (int j=i-1; j>=0; j--) {
-			if (m_allslices[j]->isNoteSlice()) {
-				lastnote = m_allslices[j];
-				break;
-			}
-		}
-		if (lastnote == NULL) {
-			continue;
-		}
-
-		fillInNullTokensForLayoutComments(m_allslices[i], lastnote, nextnote);
-	}
-}
-
-
-
-//////////////////////////////
-//
-// HumGrid::addNullTokensForClefChanges -- Avoid clef in multi-subspine
-//     regions from contracting to a single spine.
-//
-
-void HumGrid::addNullTokensForClefChanges(void) {
-	// add null tokens for clef changes in other voices
-	GridSlice *lastnote = NULL;
-	GridSlice *nextnote = NULL;
-	for (int i=0; i<(int)m_allslices.size(); i++) {
-		if (!m_allslices[i]->isClefSlice()) {
-			continue;
-		}
-		// cerr << "PROCESSING " << m_allslices[i] << endl;
-		lastnote = NULL;
-		nextnote = NULL;
-
-		for (int j=i+1; j<(int)m_allslices.size(); j++) {
-			if (m_allslices[j]->isNoteSlice()) {
-				nextnote = m_allslices[j];
-				break;
-			}
-		}
-		if (nextnote == NULL) {
-			continue;
-		}
-
-		for (int j=i-1; j>=0; j--) {
-			if (m_allslices[j]->isNoteSlice()) {
-				lastnote = m_allslices[j];
-				break;
-			}
-		}
-		if (lastnote == NULL) {
-			continue;
-		}
-
-		fillInNullTokensForClefChanges(m_allslices[i], lastnote, nextnote);
-	}
-}
-
-
-
 //////////////////////////////
 //
 // HumGrid::fillInNullTokensForClefChanges --
@@ -1831,7 +1645,13 @@ void HumGrid::fillInNullTokensForGraceNotes(GridSlice* graceslice, GridSlice* la
 
 //////////////////////////////
 //
-// HumGrid::addNullTokens --
+// HumGrid::addNullTokens -- Fill in the grid after the notes have been
+//    placed, in a forward sweep through the single list of slices: extend
+//    the duration of each note/rest with null tokens in the following
+//    slices.  The voice counts of a note slice are final once it is
+//    reached, so the grace-note, clef and layout slices before it are
+//    filled in at the same time.  The rest of the grid is completed by
+//    the backward sweep in finalizeSlices().
 //
 
 void HumGrid::addNullTokens(void) {
@@ -1852,13 +1672,24 @@ void HumGrid::addNullTokens(void) {
 		}
 	}
 
+	// non-note slices since the last note slice:
+	vector<GridSlice*> pending;
+	GridSlice* lastnote = NULL;
+
 	for (i=0; i<(int)m_allslices.size(); i++) {
 
 		GridSlice& slice = *m_allslices.at(i);
 		if (!slice.isNoteSlice()) {
 			// probably need to deal with grace note slices here
+			pending.push_back(&slice);
 			continue;
 		}
+		if (lastnote) {
+			fillInNullTokens(pending, lastnote, &slice);
+		}
+		pending.clear();
+		lastnote = &slice;
+
       for (p=0; p<(int)slice.size(); p++) {
 			GridPart& part = *slice.at(p);
       	for (s=0; s<(int)part.size(); s++) {
@@ -1882,78 +1713,249 @@ void HumGrid::addNullTokens(void) {
 
 	}
 
-	addNullTokensForGraceNotes();
 	adjustClefChanges();
-	addNullTokensForClefChanges();
-	addNullTokensForLayoutComments();
-	checkForNullDataHoles();
 }
 
 
 
 //////////////////////////////
 //
-// HumGrid::checkForNullData -- identify any spots in the grid which are NULL
-//     pointers and allocate invisible rests for them by finding the next
-//     durational item in the particular staff/layer.
+// HumGrid::finalizeSlices -- Second (backward) sweep through the single
+//    list of slices after addNullTokens() and addLastMeasure():
+//
+//    (1) Allocate invisible rests for holes in note slices and for timing
+//        gaps in the first voice of each staff.  These only look at later
+//        slices, which are already complete.
+//    (2) Add a barline slice at the end of each measure (except the last
+//        one, which addLastMeasure() has done).
+//    (3) Clean tempo slices.
+//    (4) Find the spined slices whose voice counts differ from those of
+//        the next spined slice in the same or following measure.  A
+//        manipulator slice is inserted after each of them (in forward
+//        order after the sweep, since manipulatorCheck() may print
+//        warnings).  Returns true if any manipulators were added (they
+//        still need to be expanded with cleanupManipulators()).
+//
+//    The single list of slices is rebuilt in the same sweep to include
+//    the barlines (but not the final barline or the manipulators), with
+//    the slice durations recalculated from the timestamps.  The old list
+//    is still used by (1) until the sweep is finished.
 //
 
-void HumGrid::checkForNullDataHoles(void) {
-	for (int i=0; i<(int)m_allslices.size(); i++) {
-		GridSlice& slice = *m_allslices.at(i);
-		if (!slice.isNoteSlice()) {
+bool HumGrid::finalizeSlices(void) {
+	vector<int> barnums;
+	if (!m_musicxmlbarlines) {
+		getMetricBarNumbers(barnums);
+	}
+
+	vector<vector<GridSlice*>> nextevent;
+	setPartStaffDimensions(nextevent, m_allslices.back());
+
+	// The new list is filled from the end:
+	vector<GridSlice*> slices(m_allslices.size() + this->size());
+	int k = (int)slices.size();
+
+	// Pairs of adjacent spined slices which need a manipulator check:
+	class ManipulatorCheck {
+		public:
+			GridSlice* slice;  // spined slice to insert a manipulator after
+			GridSlice* next;   // next spined slice
+			int measure;       // measure index of slice
+	};
+	vector<ManipulatorCheck> checks;
+	GridSlice* nextspined = NULL; // next spined slice (except manipulators)
+	int nextmeasure = -1;         // measure index of nextspined
+	int m = (int)this->size() - 1;
+	while ((m >= 0) && this->at(m)->empty()) {
+		m--;
+	}
+	if ((m >= 0) && this->at(m)->back()->isMeasureSlice()) {
+		// final barline from addLastMeasure()
+		nextspined = this->at(m)->back();
+		nextmeasure = m;
+	}
+
+	for (int i=(int)m_allslices.size()-1; i>=0; i--) {
+		GridSlice* slice = m_allslices[i];
+		if (slice->isNoteSlice()) {
+			checkForNullDataHoles(i);
+			addInvisibleRestsInFirstTrack(nextevent, i);
+		}
+
+		GridSlice* barline = NULL;
+		if ((m >= 0) && (m < (int)this->size() - 1) && (slice == this->at(m)->back())) {
+			barline = addMeasureLine(m, barnums);
+		}
+		GridSlice* current = barline ? barline : slice;
+		while (current) {
+			if (k < (int)slices.size()) {
+				current->setDuration(slices[k]->getTimestamp() - current->getTimestamp());
+			}
+			slices[--k] = current;
+			if (current->isTempoSlice()) {
+				cleanTempos(current);
+			}
+			if (current->hasSpines()) {
+				if (((nextmeasure == m) || (nextmeasure == m + 1))
+						&& !hasSameVoiceCounts(current, nextspined)) {
+					checks.push_back({current, nextspined, m});
+				}
+				nextspined = current;
+				nextmeasure = m;
+			}
+			current = (current == barline) ? slice : NULL;
+		}
+
+		if ((m >= 0) && (slice == this->at(m)->front())) {
+			m--;
+			while ((m >= 0) && this->at(m)->empty()) {
+				m--;
+			}
+		}
+	}
+
+	slices.erase(slices.begin(), slices.begin() + k);
+	m_allslices.swap(slices);
+
+	bool output = false;
+	for (int i=(int)checks.size()-1; i>=0; i--) {
+		GridSlice* manipulator = manipulatorCheck(checks[i].slice, checks[i].next);
+		if (!manipulator) {
 			continue;
 		}
-      for (int p=0; p<(int)slice.size(); p++) {
-			GridPart& part = *slice.at(p);
-      	for (int s=0; s<(int)part.size(); s++) {
-				GridStaff& staff = *part.at(s);
-      		for (int v=0; v<(int)staff.size(); v++) {
-					if (!staff.at(v)) {
-						staff.at(v) = new GridVoice();
-						// Calculate duration of void by searching
-						// for the next non-null voice in the current part/staff/voice
-						HumNum duration = slice.getDuration();
-						GridPart *pp;
-						GridStaff *sp;
-						GridVoice *vp;
-						for (int q=i+1; q<(int)m_allslices.size(); q++) {
-							GridSlice *slicep = m_allslices.at(q);
-							if (!slicep->isNoteSlice()) {
-								// or isDataSlice()?
-								continue;
-							}
-							if (p >= (int)slicep->size() - 1) {
-								continue;
-							}
-							pp = slicep->at(p);
-							if (s >= (int)pp->size() - 1) {
-								continue;
-							}
-							sp = pp->at(s);
-							if (v >= (int)sp->size() - 1) {
-								// Found a data line with no data at given voice, so
-								// add slice duration to cumulative duration.
-								duration += slicep->getDuration();
-								continue;
-							}
-							vp = sp->at(v);
-							if (!vp) {
-								// found another null spot which should be dealt with later.
-								break;
+		output = true;
+		GridMeasure* measure = this->at(checks[i].measure);
+		auto it = std::find(measure->begin(), measure->end(), checks[i].slice);
+		measure->insert(++it, manipulator);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumGrid::hasSameVoiceCounts -- Returns true if two spined slices have
+//    the same number of parts, staves and voices (an empty staff counts
+//    as one voice), so that manipulatorCheck() would not need to insert
+//    a manipulator or print a warning.
+//
+
+bool HumGrid::hasSameVoiceCounts(GridSlice* ice1, GridSlice* ice2) {
+	if ((ice1 == NULL) || (ice2 == NULL)) {
+		return true;
+	}
+	if (ice1->size() != ice2->size()) {
+		return false;
+	}
+	for (int p=0; p<(int)ice1->size(); p++) {
+		GridPart* part1 = ice1->at(p);
+		GridPart* part2 = ice2->at(p);
+		if (part1->size() != part2->size()) {
+			return false;
+		}
+		for (int s=0; s<(int)part1->size(); s++) {
+			int v1count = std::max(1, (int)part1->at(s)->size());
+			int v2count = std::max(1, (int)part2->at(s)->size());
+			if (v1count != v2count) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumGrid::fillInNullTokens -- Add null tokens to the grace-note, clef and
+//     layout slices between two note slices, so that they do not contract
+//     the subspine count.  Grace notes at the starts of measures, and clefs
+//     and layout comments in multi-subspine regions are the usual cases.
+//
+
+void HumGrid::fillInNullTokens(vector<GridSlice*>& slices, GridSlice* lastnote,
+		GridSlice* nextnote) {
+	for (int i=0; i<(int)slices.size(); i++) {
+		if (slices[i]->isGraceSlice()) {
+			fillInNullTokensForGraceNotes(slices[i], lastnote, nextnote);
+		}
+		if (slices[i]->isClefSlice()) {
+			fillInNullTokensForClefChanges(slices[i], lastnote, nextnote);
+		}
+		if (slices[i]->isLocalLayoutSlice()) {
+			fillInNullTokensForLayoutComments(slices[i], lastnote, nextnote);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumGrid::checkForNullDataHoles -- identify any spots in a note slice which
+//     are NULL pointers and allocate invisible rests for them by finding the
+//     next durational item in the particular staff/layer.
+//
+
+void HumGrid::checkForNullDataHoles(int i) {
+	GridSlice& slice = *m_allslices.at(i);
+	for (int p=0; p<(int)slice.size(); p++) {
+		GridPart& part = *slice.at(p);
+		for (int s=0; s<(int)part.size(); s++) {
+			GridStaff& staff = *part.at(s);
+			for (int v=0; v<(int)staff.size(); v++) {
+				if (!staff.at(v)) {
+					staff.at(v) = new GridVoice();
+					// Calculate duration of void by searching
+					// for the next non-null voice in the current part/staff/voice
+					HumNum duration = slice.getDuration();
+					GridPart *pp;
+					GridStaff *sp;
+					GridVoice *vp;
+					for (int q=i+1; q<(int)m_allslices.size(); q++) {
+						GridSlice *slicep = m_allslices.at(q);
+						if (!slicep->isNoteSlice()) {
+							// or isDataSlice()?
+							continue;
+						}
+						if (p >= (int)slicep->size() - 1) {
+							continue;
+						}
+						pp = slicep->at(p);
+						if (s >= (int)pp->size() - 1) {
+							continue;
+						}
+						sp = pp->at(s);
+						if (v >= (int)sp->size() - 1) {
+							// Found a data line with no data at given voice, so
+							// add slice duration to cumulative duration.  Use the
+							// timestamps since finalizeSlices() may already have
+							// recalculated the durations of later slices.
+							if (q < (int)m_allslices.size() - 1) {
+								duration += m_allslices[q+1]->getTimestamp() - slicep->getTimestamp();
 							} else {
-								// there is a token at the same part/staff/voice position.
-								// Maybe check if a null token, but if not a null token,
-								// then break here also.
-								break;
+								duration += slicep->getDuration();
 							}
+							continue;
+						}
+						vp = sp->at(v);
+						if (!vp) {
+							// found another null spot which should be dealt with later.
+							break;
+						} else {
+							// there is a token at the same part/staff/voice position.
+							// Maybe check if a null token, but if not a null token,
+							// then break here also.
+							break;
 						}
-						string recip = Convert::durationToRecip(duration);
-						// ggg @ marker is added to keep track of them for more debugging.
-						recip += "ryy@";
-						staff.at(v)->setToken(recip);
-						continue;
 					}
+					string recip = Convert::durationToRecip(duration);
+					// ggg @ marker is added to keep track of them for more debugging.
+					recip += "ryy@";
+					staff.at(v)->setToken(recip);
+					continue;
 				}
 			}
 		}
@@ -1992,54 +1994,60 @@ void HumGrid::setPartStaffDimensions(vector<vector<GridSlice*>>& nextevent,
 //
 // HumGrid::addInvisibleRestsInFirstTrack --  If there are any
 //    timing gaps in the first track of a **kern spine, then
-//    fill in with invisible rests.
+//    fill in with invisible rests.  The slices must be processed
+//    from the end of the list to the start.
 //
 // ggg
 
 void HumGrid::addInvisibleRestsInFirstTrack(void) {
-	int i; // slice index
-	int p; // part index
-	int s; // staff index
-	int v = 0; // only looking at first voice
-
 	vector<vector<GridSlice*>> nextevent;
 	GridSlice* lastslice = m_allslices.back();
 	setPartStaffDimensions(nextevent, lastslice);
 
-	for (i=(int)m_allslices.size()-1; i>=0; i--) {
-		GridSlice& slice = *m_allslices.at(i);
-		if (!slice.isNoteSlice()) {
+	for (int i=(int)m_allslices.size()-1; i>=0; i--) {
+		if (!m_allslices[i]->isNoteSlice()) {
 			continue;
 		}
-      for (p=0; p<(int)slice.size(); p++) {
-			GridPart& part = *slice.at(p);
-      	for (s=0; s<(int)part.size(); s++) {
-				GridStaff& staff = *part.at(s);
-				if (staff.size() == 0) {
-					// cerr << "EMPTY STAFF VOICE WILL BE FILLED IN LATER!!!!" << endl;
-					continue;
-				}
-				if (!staff.at(v)) {
-					// in theory should not happen
-					continue;
-				}
-				GridVoice& gv = *staff.at(v);
-				if (gv.isNull()) {
-					continue;
-				}
+		addInvisibleRestsInFirstTrack(nextevent, i);
+	}
+}
 
-				// Found a note/rest.  Check if its duration matches
-				// the next non-null data token.  If not, then add
-				// an invisible rest somewhere between the two
 
-				// first check to see if the previous item is a
-				// NULL.  If so, then store and continue.
-				if (nextevent[p][s] == NULL) {
-					nextevent[p][s] = &slice;
-					continue;
-				}
-				addInvisibleRest(nextevent, i, p, s);
+void HumGrid::addInvisibleRestsInFirstTrack(vector<vector<GridSlice*>>& nextevent,
+		int i) {
+	int p; // part index
+	int s; // staff index
+	int v = 0; // only looking at first voice
+
+	GridSlice& slice = *m_allslices.at(i);
+	for (p=0; p<(int)slice.size(); p++) {
+		GridPart& part = *slice.at(p);
+		for (s=0; s<(int)part.size(); s++) {
+			GridStaff& staff = *part.at(s);
+			if (staff.size() == 0) {
+				// cerr << "EMPTY STAFF VOICE WILL BE FILLED IN LATER!!!!" << endl;
+				continue;
+			}
+			if (!staff.at(v)) {
+				// in theory should not happen
+				continue;
+			}
+			GridVoice& gv = *staff.at(v);
+			if (gv.isNull()) {
+				continue;
+			}
+
+			// Found a note/rest.  Check if its duration matches
+			// the next non-null data token.  If not, then add
+			// an invisible rest somewhere between the two
+
+			// first check to see if the previous item is a
+			// NULL.  If so, then store and continue.
+			if (nextevent[p][s] == NULL) {
+				nextevent[p][s] = &slice;
+				continue;
 			}
+			addInvisibleRest(nextevent, i, p, s);
 		}
 	}
 }
@@ -198,23 +198,11 @@ string HumHash::getValue(const string& ns2, const string& key) const {
 
 string HumHash::getValue(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return "";
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return "";
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return "";
 	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return "";
-	}
-	return it3->second;
+	return entry->value;
 }
 
 
@@ -231,7 +219,7 @@ HTp HumHash::getValueHTp(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueHTp("", "", keys[2]);
+		return getValueHTp("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueHTp(keys[0], keys[1]);
 	} else {
@@ -287,7 +275,7 @@ int HumHash::getValueInt(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueInt("", "", keys[2]);
+		return getValueInt("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueInt(keys[0], keys[1]);
 	} else {
@@ -392,7 +380,7 @@ double HumHash::getValueFloat(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueFloat("", "", keys[2]);
+		return getValueFloat("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueFloat(keys[0], keys[1]);
 	} else {
@@ -446,7 +434,7 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 bool HumHash::getValueBool(const string& key) const {
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueBool("", "", keys[2]);
+		return getValueBool("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueBool(keys[0], keys[1]);
 	} else {
@@ -465,12 +453,13 @@ bool HumHash::getValueBool(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return false;
 	}
-	if (!isDefined(ns1, ns2, key)) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return false;
 	}
-	if ((*parameters)[ns1][ns2][key] == "false") {
+	if (entry->value == "false") {
 		return false;
-	} else if ((*parameters)[ns1][ns2][key] == "0") {
+	} else if (entry->value == "0") {
 		return false;
 	} else {
 		return true;
@@ -512,7 +501,17 @@ void HumHash::setValue(const string& ns2, const string& key,
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, const string& value) {
 	initializeParameters();
-	(*parameters)[ns1][ns2][key] = value;
+	size_t index = findIndex(ns1, ns2, key);
+	if ((index < parameters->size()) &&
+			(compareEntry((*parameters)[index], ns1, ns2, key) == 0)) {
+		(*parameters)[index].value = value;
+		return;
+	}
+	auto it = parameters->insert(parameters->begin() + index, HumHashEntry());
+	it->ns1 = ns1;
+	it->ns2 = ns2;
+	it->key = key;
+	it->value = value;
 }
 
 
@@ -552,10 +551,7 @@ void HumHash::setValue(const string& ns2, const string& key, int value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, int value) {
-	initializeParameters();
-	stringstream ss;
-	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(ns1, ns2, key, to_string(value));
 }
 
 
@@ -578,10 +574,7 @@ void HumHash::setValue(const string& ns2, const string& key, HTp value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HTp value) {
-	initializeParameters();
-	stringstream ss;
-	ss << "HT_" << ((long long)value);
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(ns1, ns2, key, "HT_" + to_string((long long)value));
 }
 
 
@@ -604,10 +597,9 @@ void HumHash::setValue(const string& ns2, const string& key, HumNum value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HumNum value) {
-	initializeParameters();
 	stringstream ss;
 	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(ns1, ns2, key, ss.str());
 }
 
 
@@ -630,10 +622,9 @@ void HumHash::setValue(const string& ns2, const string& key, double value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, double value) {
-	initializeParameters();
 	stringstream ss;
 	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(ns1, ns2, key, ss.str());
 }
 
 
@@ -650,8 +641,10 @@ map<string, string> HumHash::getParameters(const string& ns1, const string& ns2)
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it : (*parameters)[ns1][ns2]) {
-		output[it.first] = it.second;
+	size_t index = findIndex(ns1, ns2, "");
+	size_t end = findNamespaceEnd(index, ns1, ns2);
+	for (size_t i=index; i<end; i++) {
+		output[(*parameters)[i].key] = (*parameters)[i].value;
 	}
 	return output;
 }
@@ -691,8 +684,10 @@ vector<string> HumHash::getKeys(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it : (*parameters)[ns1][ns2]) {
-		output.push_back(it.first);
+	size_t index = findIndex(ns1, ns2, "");
+	size_t end = findNamespaceEnd(index, ns1, ns2);
+	for (size_t i=index; i<end; i++) {
+		output.push_back((*parameters)[i].key);
 	}
 	return output;
 }
@@ -710,10 +705,10 @@ vector<string> HumHash::getKeys(const string& ns) const {
 		return getKeys(ns1, ns2);
 	}
 
-	for (auto& it1 : (*parameters)[ns]) {
-		for (auto& it2 : it1.second) {
-			output.push_back(it1.first + ":" + it2.first);
-		}
+	size_t index = findIndex(ns, "", "");
+	size_t end = findNamespaceEnd(index, ns);
+	for (size_t i=index; i<end; i++) {
+		output.push_back((*parameters)[i].ns2 + ":" + (*parameters)[i].key);
 	}
 	return output;
 }
@@ -724,12 +719,8 @@ vector<string> HumHash::getKeys(void) const {
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it1 : (*parameters)) {
-		for (auto& it2 : it1.second) {
-			for (auto it3 : it2.second) {
-				output.push_back(it1.first + ":" + it2.first + ":" + it3.first);
-			}
-		}
+	for (auto& entry : *parameters) {
+		output.push_back(entry.ns1 + ":" + entry.ns2 + ":" + entry.key);
 	}
 	return output;
 }
@@ -750,19 +741,8 @@ bool HumHash::hasParameters(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return false;
 	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
-		return false;
-	}
-	auto it2 = (*parameters)[ns1].find(ns2);
-	if (it2 == (*parameters)[ns1].end()) {
-		return false;
-	} else {
-		return true;
-	}
+	size_t index = findIndex(ns1, ns2, "");
+	return findNamespaceEnd(index, ns1, ns2) > index;
 }
 
 
@@ -777,12 +757,8 @@ bool HumHash::hasParameters(const string& ns) const {
 		return hasParameters(ns1, ns2);
 	}
 
-	auto it = parameters->find(ns);
-	if (it == parameters->end()) {
-		return false;
-	} else {
-		return true;
-	}
+	size_t index = findIndex(ns, "", "");
+	return findNamespaceEnd(index, ns) > index;
 }
 
 
@@ -790,19 +766,7 @@ bool HumHash::hasParameters(void) const {
 	if (parameters == NULL) {
 		return false;
 	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	for (auto& it1 : *parameters) {
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			} else {
-				return true;
-			}
-		}
-	}
-	return false;
+	return !parameters->empty();
 }
 
 
@@ -822,18 +786,8 @@ int HumHash::getParameterCount(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
-		return 0;
-	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
-		return 0;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return 0;
-	}
-	return (int)it2->second.size();
+	size_t index = findIndex(ns1, ns2, "");
+	return (int)(findNamespaceEnd(index, ns1, ns2) - index);
 }
 
 
@@ -848,15 +802,8 @@ int HumHash::getParameterCount(const string& ns) const {
 		return getParameterCount(ns1, ns2);
 	}
 
-	auto it1 = parameters->find(ns);
-	if (it1 == parameters->end()) {
-		return false;
-	}
-	int sum = 0;
-	for (auto& it2 : it1->second) {
-		sum += (int)it2.second.size();
-	}
-	return sum;
+	size_t index = findIndex(ns, "", "");
+	return (int)(findNamespaceEnd(index, ns) - index);
 }
 
 
@@ -864,16 +811,7 @@ int HumHash::getParameterCount(void) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
-		return 0;
-	}
-	int sum = 0;
-	for (auto& it1 : (*parameters)) {
-		for (auto& it2 : it1.second) {
-			sum += (int)it2.second.size();
-		}
-	}
-	return sum;
+	return (int)parameters->size();
 }
 
 
@@ -892,11 +830,11 @@ bool HumHash::isDefined(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return (*parameters)[""][""].count(keys[0]) ? true : false;
+		return isDefined("", "", keys[0]);
 	} else if (keys.size() == 2) {
-		return (*parameters)[""][keys[0]].count(keys[1]) ? true : false;
+		return isDefined("", keys[0], keys[1]);
 	} else {
-		return (*parameters)[keys[0]][keys[1]].count(keys[2]) ? true : false;
+		return isDefined(keys[0], keys[1], keys[2]);
 	}
 }
 
@@ -905,7 +843,7 @@ bool HumHash::isDefined(const string& ns2, const string& key) const {
 	if (parameters == NULL) {
 		return false;
 	}
-	return (*parameters)[""][ns2].count(key) ? true : false;
+	return isDefined("", ns2, key);
 }
 
 
@@ -914,7 +852,7 @@ bool HumHash::isDefined(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return false;
 	}
-	return (*parameters)[ns1][ns2].count(key) ? true : false;
+	return findEntry(ns1, ns2, key) != NULL;
 }
 
 
@@ -954,36 +892,130 @@ void HumHash::deleteValue(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return;
 	}
-	(*parameters)[ns1][ns2].erase(key);
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry != NULL) {
+		parameters->erase(parameters->begin() + (entry - parameters->data()));
+	}
+}
 
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return;
+
+
+//////////////////////////////
+//
+// HumHash::initializeParameters -- Create the parameter list if it does not
+//     already exist.
+//
+
+void HumHash::initializeParameters(void) {
+	if (parameters == NULL) {
+		parameters = new HumHashList;
 	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findEntry -- Return the parameter for the given namespaces
+//     and key, or NULL if it is not defined.
+//
+
+HumHashEntry* HumHash::findEntry(const string& ns1, const string& ns2,
+		const string& key) const {
+	if (parameters == NULL) {
+		return NULL;
 	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return;
+	size_t index = findIndex(ns1, ns2, key);
+	if (index >= parameters->size()) {
+		return NULL;
 	}
-	it2->second.erase(key);
+	HumHashEntry& entry = (*parameters)[index];
+	if (compareEntry(entry, ns1, ns2, key) != 0) {
+		return NULL;
+	}
+	return &entry;
 }
 
 
 
 //////////////////////////////
 //
-// HumHash::initializeParameters -- Create the map structure if it does not
-//     already exist.
+// HumHash::findIndex -- Binary search for the index of the first parameter
+//     which does not sort before the given namespaces and key.  Returns
+//     the size of the parameter list if all parameters sort before it.
+//     Giving an empty key (and NS2) returns the index of the first
+//     parameter in the namespace.
 //
 
-void HumHash::initializeParameters(void) {
+size_t HumHash::findIndex(const string& ns1, const string& ns2,
+		const string& key) const {
+	size_t low = 0;
+	size_t high = parameters ? parameters->size() : 0;
+	while (low < high) {
+		size_t mid = (low + high) / 2;
+		if (compareEntry((*parameters)[mid], ns1, ns2, key) < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findNamespaceEnd -- Return the index after the last parameter
+//     (starting at the given index) which is in the given namespace.
+//
+
+size_t HumHash::findNamespaceEnd(size_t index, const string& ns1) const {
 	if (parameters == NULL) {
-		parameters = new MapNNKV;
+		return 0;
+	}
+	while ((index < parameters->size()) && ((*parameters)[index].ns1 == ns1)) {
+		index++;
+	}
+	return index;
+}
+
+
+size_t HumHash::findNamespaceEnd(size_t index, const string& ns1,
+		const string& ns2) const {
+	if (parameters == NULL) {
+		return 0;
 	}
+	while (index < parameters->size()) {
+		HumHashEntry& entry = (*parameters)[index];
+		if ((entry.ns1 != ns1) || (entry.ns2 != ns2)) {
+			break;
+		}
+		index++;
+	}
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::compareEntry -- Compare a parameter to the given namespaces
+//     and key.  Returns a negative number if the parameter sorts before
+//     them, zero if equal, and a positive number if it sorts after them.
+//
+
+int HumHash::compareEntry(const HumHashEntry& entry, const string& ns1,
+		const string& ns2, const string& key) {
+	int status = entry.ns1.compare(ns1);
+	if (status != 0) {
+		return status;
+	}
+	status = entry.ns2.compare(ns2);
+	if (status != 0) {
+		return status;
+	}
+	return entry.key.compare(key);
 }
 
 
@@ -995,11 +1027,16 @@ void HumHash::initializeParameters(void) {
 //
 
 vector<string> HumHash::getKeyList(const string& keys) const {
-	stringstream ss(keys);
-	string key;
 	vector<string> output;
-	while (getline(ss, key, ':')) {
-		output.push_back(key);
+	size_t start = 0;
+	while (start < keys.size()) {
+		size_t loc = keys.find(':', start);
+		if (loc == string::npos) {
+			output.push_back(keys.substr(start));
+			break;
+		}
+		output.push_back(keys.substr(start, loc - start));
+		start = loc + 1;
 	}
 	if (output.size() == 0) {
 		output.push_back(keys);
@@ -1079,23 +1116,11 @@ void HumHash::setOrigin(const string& ns2, const string& key,
 
 void HumHash::setOrigin(const string& ns1, const string& ns2,
 		const string& key, HumdrumToken* tok) {
-	if (parameters == NULL) {
-		return;
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return;
 	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return;
-	}
-	it3->second.origin = tok;
+	entry->value.origin = tok;
 }
 
 
@@ -1139,23 +1164,11 @@ HumdrumToken* HumHash::getOrigin(const string& ns2, const string& key) const {
 
 HumdrumToken* HumHash::getOrigin(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return NULL;
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return NULL;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return NULL;
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return NULL;
 	}
-	return it3->second.origin;
+	return entry->value.origin;
 }
 
 
@@ -1177,32 +1190,33 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 
 	stringstream str;
 	bool found = 0;
+	HumHashList& p = *parameters;
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
-		if (it1.second.size() == 0) {
-			continue;
-		}
+	size_t i1 = 0;
+	while (i1 < p.size()) {
+		const string& ns1 = p[i1].ns1;
+		size_t end1 = findNamespaceEnd(i1, ns1);
 		if (!found) {
 			found = 1;
 		}
 		str << Convert::repeatString(indent, level++);
-		str << "<namespace n=\"1\" name=\"" << it1.first << "\">\n";
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			}
+		str << "<namespace n=\"1\" name=\"" << ns1 << "\">\n";
+		size_t i2 = i1;
+		while (i2 < end1) {
+			const string& ns2 = p[i2].ns2;
+			size_t end2 = findNamespaceEnd(i2, ns1, ns2);
 
 			str << Convert::repeatString(indent, level++);
-			str << "<namespace n=\"2\" name=\"" << it2.first << "\">\n";
+			str << "<namespace n=\"2\" name=\"" << ns2 << "\">\n";
 
-			for (auto& it3 : it2.second) {
+			for (size_t i3=i2; i3<end2; i3++) {
 				str << Convert::repeatString(indent, level);
-				str << "<parameter key=\"" << it3.first << "\"";
+				str << "<parameter key=\"" << p[i3].key << "\"";
 				str << " value=\"";
-				str << Convert::encodeXml(it3.second) << "\"";
-				ref = it3.second.origin;
+				str << Convert::encodeXml(p[i3].value) << "\"";
+				ref = p[i3].value.origin;
 				if (ref != NULL) {
 					str << " idref=\"";
 					str << ref->getXmlId();
@@ -1211,8 +1225,10 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 				str << "/>\n";
 			}
 			str << Convert::repeatString(indent, --level) << "</namespace>\n";
+			i2 = end2;
 		}
 		str << Convert::repeatString(indent, --level) << "</namespace>\n";
+		i1 = end1;
 	}
 	if (found) {
 		str << Convert::repeatString(indent, --level) << "</parameters>\n";
@@ -1247,51 +1263,54 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 	string it2str;
 	int str2count = 0;
 	bool found = 0;
+	HumHashList& p = *parameters;
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
-		if (it1.second.size() == 0) {
-			continue;
-		}
+	size_t i1 = 0;
+	while (i1 < p.size()) {
+		const string& ns1 = p[i1].ns1;
+		size_t end1 = findNamespaceEnd(i1, ns1);
 		str2.str("");
-		it1str = it1.first;
+		it1str = ns1;
 		if (!found) {
 			found = 1;
 		}
-		if (it1.first == "") {
+		if (ns1 == "") {
 			str2 << Convert::repeatString(indent, level++);
-			str2 << "<namespace n=\"1\" name=\"" << it1.first << "\">\n";
+			str2 << "<namespace n=\"1\" name=\"" << ns1 << "\">\n";
 		} else {
 			str << Convert::repeatString(indent, level++);
-			str << "<namespace n=\"1\" name=\"" << it1.first << "\">\n";
+			str << "<namespace n=\"1\" name=\"" << ns1 << "\">\n";
 		}
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			}
-			it2str = it2.first;
+		size_t i2 = i1;
+		while (i2 < end1) {
+			const string& ns2 = p[i2].ns2;
+			size_t end2 = findNamespaceEnd(i2, ns1, ns2);
+			it2str = ns2;
 
-			if ((it2.first == "") && (it2.first == "")) {
+			if (ns2 == "") {
 				str2 << Convert::repeatString(indent, level++);
-				str2 << "<namespace n=\"2\" name=\"" << it2.first << "\">\n";
+				str2 << "<namespace n=\"2\" name=\"" << ns2 << "\">\n";
 			} else {
 				str << Convert::repeatString(indent, level++);
-				str << "<namespace n=\"2\" name=\"" << it2.first << "\">\n";
+				str << "<namespace n=\"2\" name=\"" << ns2 << "\">\n";
 			}
 
-			for (auto& it3 : it2.second) {
-				if ((it2.first == "") && (it2.first == "")) {
+			for (size_t i3=i2; i3<end2; i3++) {
+				const string& key = p[i3].key;
+				HumParameter& value = p[i3].value;
+				if (ns2 == "") {
 
-					if ((it3.first == "global") && (it3.second == "true")) {
+					if ((key == "global") && (value == "true")) {
 						// don't do anything because parameter should be removed
 					} else {
 						str2count++;
 						str2 << Convert::repeatString(indent, level);
-						str2 << "<parameter key=\"" << it3.first << "\"";
+						str2 << "<parameter key=\"" << key << "\"";
 						str2 << " value=\"";
-						str2 << Convert::encodeXml(it3.second) << "\"";
-						ref = it3.second.origin;
+						str2 << Convert::encodeXml(value) << "\"";
+						ref = value.origin;
 						if (ref != NULL) {
 							str2 << " idref=\"";
 							str2 << ref->getXmlId();
@@ -1301,10 +1320,10 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 					}
 				} else {
 					str << Convert::repeatString(indent, level);
-					str << "<parameter key=\"" << it3.first << "\"";
+					str << "<parameter key=\"" << key << "\"";
 					str << " value=\"";
-					str << Convert::encodeXml(it3.second) << "\"";
-					ref = it3.second.origin;
+					str << Convert::encodeXml(value) << "\"";
+					ref = value.origin;
 					if (ref != NULL) {
 						str << " idref=\"";
 						str << ref->getXmlId();
@@ -1321,6 +1340,7 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 			} else {
 				str << Convert::repeatString(indent, --level) << "</namespace>\n";
 			}
+			i2 = end2;
 		}
 		if ((it1str == "") && (it2str == "")) {
 			if (str2count > 0) {
@@ -1329,6 +1349,7 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 		} else {
 			str << Convert::repeatString(indent, --level) << "</namespace>\n";
 		}
+		i1 = end1;
 	}
 	if (found) {
 		str << Convert::repeatString(indent, --level) << "</parameters>\n";
@@ -1355,27 +1376,22 @@ ostream& operator<<(ostream& out, const HumHash& hash) {
 	}
 
 	string cleaned;
-
-	for (auto& it1 : *(hash.parameters)) {
-		if (it1.second.size() == 0) {
-			continue;
-		}
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			}
-			out << hash.prefix;
-			out << it1.first << ":" << it2.first;
-			for (auto& it3 : it2.second) {
-				out << ":" << it3.first;
-				if (it3.second != "true") {
-					cleaned = it3.second;
-					Convert::replaceOccurrences(cleaned, ":", "&colon;");
-					out << "=" << cleaned;
-				}
+	HumHashList& p = *(hash.parameters);
+
+	size_t i = 0;
+	while (i < p.size()) {
+		size_t end = hash.findNamespaceEnd(i, p[i].ns1, p[i].ns2);
+		out << hash.prefix;
+		out << p[i].ns1 << ":" << p[i].ns2;
+		for ( ; i<end; i++) {
+			out << ":" << p[i].key;
+			if (p[i].value != "true") {
+				cleaned = p[i].value;
+				Convert::replaceOccurrences(cleaned, ":", "&colon;");
+				out << "=" << cleaned;
 			}
-			out << endl;
 		}
+		out << endl;
 	}
 
 	return out;
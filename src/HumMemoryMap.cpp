@@ -0,0 +1,267 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 01:25:45 UTC 2026
+// Last Modified: Sun Oct 18 08:57:07 UTC 2026
+// Filename:      HumMemoryMap.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumMemoryMap.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Read-only view of the contents of a file.
+//
+
+#include "HumMemoryMap.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+	#include <fcntl.h>       /* open            */
+	#include <sys/mman.h>    /* mmap, munmap    */
+	#include <sys/stat.h>    /* fstat           */
+	#include <unistd.h>      /* close           */
+#endif
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+
+//////////////////////////////
+//
+// HumMemoryMap::HumMemoryMap -- Constructor.
+//
+
+HumMemoryMap::HumMemoryMap(void) {
+	m_data   = NULL;
+	m_size   = 0;
+	m_mapped = false;
+	m_open   = false;
+	m_discarded = 0;
+	setData(NULL, 0);
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::~HumMemoryMap -- Deconstructor.
+//
+
+HumMemoryMap::~HumMemoryMap() {
+	close();
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::open -- Access the contents of the given file.  Returns
+//     false if the file cannot be opened.
+//
+
+bool HumMemoryMap::open(const string& filename) {
+	close();
+
+#ifndef _WIN32
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode)) {
+		if (info.st_size == 0) {
+			::close(fd);
+			m_open = true;
+			setData(NULL, 0);
+			return true;
+		}
+		void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED) {
+			::close(fd);
+			#ifdef MADV_SEQUENTIAL
+				madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+			#endif
+			m_mapped = true;
+			m_open = true;
+			setData((const char*)data, (size_t)info.st_size);
+			return true;
+		}
+	}
+	::close(fd);
+#endif
+
+	// Cannot memory-map the file, so read it into memory instead:
+	ifstream input(filename, std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+	m_contents.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+	m_open = true;
+	setData(m_contents.data(), m_contents.size());
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::close -- Release the contents of the file.
+//
+
+void HumMemoryMap::close(void) {
+#ifndef _WIN32
+	if (m_mapped) {
+		munmap((void*)m_data, m_size);
+	}
+#endif
+	m_contents.clear();
+	m_contents.shrink_to_fit();
+	m_mapped = false;
+	m_open   = false;
+	m_discarded = 0;
+	setData(NULL, 0);
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::isOpen -- Returns true if a file is open.
+//
+
+bool HumMemoryMap::isOpen(void) const {
+	return m_open;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::isMapped -- Returns true if the file contents are
+//     memory-mapped rather than copied into memory.
+//
+
+bool HumMemoryMap::isMapped(void) const {
+	return m_mapped;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::getData -- Return the contents of the file.  The
+//     contents are not null-terminated, so use getSize() to find
+//     the end of the data.
+//
+
+const char* HumMemoryMap::getData(void) const {
+	return m_data;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::getSize -- Return the number of bytes in the file.
+//
+
+size_t HumMemoryMap::getSize(void) const {
+	return m_size;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::getLine -- Copy the next line of the file (without its
+//     newline) into line.  Lines are split directly from the contents of
+//     the file.  Returns false if there are no more lines, in which case
+//     line is empty.  Like std::getline(), the end of the file is reached
+//     after reading a last line which has no newline, or after trying to
+//     read past the last newline.
+//
+
+bool HumMemoryMap::getLine(string& line) {
+	if (m_position >= m_size) {
+		line.clear();
+		m_eof = true;
+		return false;
+	}
+	const char* start = m_data + m_position;
+	const char* newline = (const char*)memchr(start, '\n', m_size - m_position);
+	if (newline == NULL) {
+		line.assign(start, m_size - m_position);
+		m_position = m_size;
+		m_eof = true;
+	} else {
+		line.assign(start, newline - start);
+		m_position = newline - m_data + 1;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::eof -- Returns true if getLine() has reached the end
+//     of the file.
+//
+
+bool HumMemoryMap::eof(void) const {
+	return m_eof;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::discardRead -- Allow the operating system to drop the
+//     memory pages of a mapped file which have already been read with
+//     getLine().  This keeps memory usage low when streaming through
+//     large files of segments.  Pages are released at most once per
+//     megabyte of input read.
+//
+
+void HumMemoryMap::discardRead(void) {
+#if !defined(_WIN32) && defined(MADV_DONTNEED)
+	if (!m_mapped) {
+		return;
+	}
+	size_t pagesize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t position = m_position;
+	position -= position % pagesize;
+	if (position < m_discarded + 0x100000) {
+		return;
+	}
+	madvise((void*)(m_data + m_discarded), position - m_discarded, MADV_DONTNEED);
+	m_discarded = position;
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::setData -- Set the data region and start reading
+//     lines from the start of it.
+//
+
+void HumMemoryMap::setData(const char* data, size_t size) {
+	m_data = data;
+	m_size = size;
+	m_position = 0;
+	m_eof = false;
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -16,12 +16,16 @@
 
 #include "HumNum.h"
 
+#include <climits>
+
 using namespace std;
 
 namespace hum {
 
 // START_MERGE
 
+thread_local bool HumNum::s_overflow = false;
+
 //////////////////////////////
 //
 // HumNum::HumNum -- HumNum Constructor.  Set the default value
@@ -303,26 +307,106 @@ HumNum& HumNum::makeAbs(void) {
 //    reduce to 1/6 since a factor of 4 is common to the numerator
 //    and denominator.
 //
+//    The two-parameter version stores the reduced value of a fraction
+//    calculated with 64-bit integers, which is how arithmetic results
+//    are stored without intermediate int overflow.  Most durations
+//    have a power-of-two denominator, and in that case the only common
+//    factors are twos which are removed with a shift.  If the reduced
+//    fraction still does not fit into ints, it is approximated by the
+//    closest fraction which does rather than wrapping around.
+//
 
 void HumNum::reduce(void) {
-	int a = getNumerator();
-	int b = getDenominator();
-	if (a == 1 || b == 1) {
-		return;
+	reduce(top, bot);
+}
+
+
+void HumNum::reduce(long long numerator, long long denominator) {
+	if ((numerator == 1) || (denominator == 1)) {
+		// already reduced
+	} else if ((denominator > 0) && !(denominator & (denominator - 1))) {
+		if (numerator == 0) {
+			denominator = 1;
+		} else {
+			int shift = countTrailingZeros((unsigned long long)numerator);
+			int bshift = countTrailingZeros((unsigned long long)denominator);
+			if (bshift < shift) {
+				shift = bshift;
+			}
+			if (numerator < 0) {
+				numerator = -(-numerator >> shift);
+			} else {
+				numerator >>= shift;
+			}
+			denominator >>= shift;
+		}
+	} else {
+		if (numerator == 0) {
+			denominator = 1;
+		} else if (denominator != 0) {
+			long long gcdval = gcdBinary(numerator, denominator);
+			if (gcdval > 1) {
+				numerator /= gcdval;
+				denominator /= gcdval;
+			}
+		}
 	}
-	if (a == 0) {
-		bot = 1;
+
+	if ((numerator > INT_MAX) || (numerator < -INT_MAX) ||
+			(denominator > INT_MAX) || (denominator < -INT_MAX)) {
+		approximate(numerator, denominator);
 		return;
 	}
-	if (b == 0) {
-		a = 0;
-		b = 0;
+
+	top = (int)numerator;
+	bot = (int)denominator;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::approximate -- Store the closest fraction to the given one
+//    that fits into ints (the last continued-fraction convergent with
+//    numerator and denominator no larger than INT_MAX).  Values too
+//    large for an int are clamped to +/-INT_MAX.  Used when an arithmetic
+//    result overflows, which is recorded for hasOverflow().
+//
+
+void HumNum::approximate(long long numerator, long long denominator) {
+	s_overflow = true;
+	bool negative = (numerator < 0) != (denominator < 0);
+	unsigned long long n = numerator < 0 ? 0 - (unsigned long long)numerator : numerator;
+	unsigned long long d = denominator < 0 ? 0 - (unsigned long long)denominator : denominator;
+	unsigned long long h0 = 0;
+	unsigned long long h1 = 1;
+	unsigned long long k0 = 1;
+	unsigned long long k1 = 0;
+	while (d != 0) {
+		unsigned long long q = n / d;
+		if ((h1 != 0) && (q > (INT_MAX - h0) / h1)) {
+			break;
+		}
+		if ((k1 != 0) && (q > (INT_MAX - k0) / k1)) {
+			break;
+		}
+		unsigned long long h2 = q * h1 + h0;
+		unsigned long long k2 = q * k1 + k0;
+		h0 = h1;
+		h1 = h2;
+		k0 = k1;
+		k1 = k2;
+		unsigned long long r = n - q * d;
+		n = d;
+		d = r;
 	}
-	int gcdval = gcdIterative(a, b);
-	if (gcdval > 1) {
-		top /= gcdval;
-		bot /= gcdval;
+	if (k1 == 0) {
+		top = negative ? -INT_MAX : INT_MAX;
+		bot = 1;
+		return;
 	}
+	top = negative ? -(int)h1 : (int)h1;
+	bot = (int)k1;
 }
 
 
@@ -345,6 +429,69 @@ int HumNum::gcdIterative(int a, int b) {
 
 
 
+//////////////////////////////
+//
+// HumNum::gcdBinary -- Returns the greatest common divisor of two
+//      numbers using the binary GCD algorithm, which uses shifts and
+//      subtractions rather than repeated divisions.
+//
+
+long long HumNum::gcdBinary(long long a, long long b) {
+	unsigned long long u = a < 0 ? 0 - (unsigned long long)a : (unsigned long long)a;
+	unsigned long long v = b < 0 ? 0 - (unsigned long long)b : (unsigned long long)b;
+	if (u == 0) {
+		return (long long)v;
+	}
+	if (v == 0) {
+		return (long long)u;
+	}
+	// Durations usually have a small denominator, so reduce the larger
+	// value with one division before the shift/subtract loop.
+	if (u > v) {
+		u = (u <= UINT_MAX) ? (unsigned int)u % (unsigned int)v : u % v;
+		if (u == 0) {
+			return (long long)v;
+		}
+	} else if (v > u) {
+		v = (v <= UINT_MAX) ? (unsigned int)v % (unsigned int)u : v % u;
+		if (v == 0) {
+			return (long long)u;
+		}
+	}
+	int shift = countTrailingZeros(u | v);
+	u >>= countTrailingZeros(u);
+	do {
+		v >>= countTrailingZeros(v);
+		unsigned long long smaller = u < v ? u : v;
+		v = (u < v ? v : u) - smaller;
+		u = smaller;
+	} while (v != 0);
+	return (long long)(u << shift);
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::countTrailingZeros -- Returns the number of zero bits
+//      below the lowest one bit.  The value must not be zero.
+//
+
+int HumNum::countTrailingZeros(unsigned long long value) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(value);
+#else
+	int count = 0;
+	while (!(value & 1)) {
+		value >>= 1;
+		count++;
+	}
+	return count;
+#endif
+}
+
+
+
 //////////////////////////////
 //
 // HumNum::gcdRecursive -- Returns the greatest common divisor of two
@@ -436,19 +583,39 @@ bool HumNum::isPowerOfTwo(void) const {
 //
 
 HumNum HumNum::operator+(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2 + a2 * b1;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
+	long long a1 = getNumerator();
+	long long b1 = getDenominator();
+	long long a2 = value.getNumerator();
+	long long b2 = value.getDenominator();
+	HumNum output;
+	if ((b1 > 0) && (b2 > 0) && !(b1 & (b1 - 1)) && !(b2 & (b2 - 1))) {
+		// power-of-two denominators: the larger one is the common denominator.
+		if (b1 < b2) {
+			a1 *= b2 >> countTrailingZeros(b1);
+			b1 = b2;
+		} else if (b2 < b1) {
+			a2 *= b1 >> countTrailingZeros(b2);
+		}
+		output.reduce(a1 + a2, b1);
+	} else {
+		long long x = a1 * b2;
+		long long y = a2 * b1;
+		if (((y > 0) && (x > LLONG_MAX - y)) || ((y < 0) && (x < LLONG_MIN - y))) {
+			// The cross products (from INT_MIN terms) do not add within
+			// 64 bits: halve the fraction, which may lose precision.
+			s_overflow = true;
+			output.reduce(x / 2 + y / 2, b1 * b2 / 2);
+		} else {
+			output.reduce(x + y, b1 * b2);
+		}
+	}
 	return output;
 }
 
 
 HumNum HumNum::operator+(int value) const {
-	HumNum output(value * bot + top, bot);
+	HumNum output;
+	output.reduce((long long)value * bot + top, bot);
 	return output;
 }
 
@@ -462,19 +629,39 @@ HumNum HumNum::operator+(int value) const {
 //
 
 HumNum HumNum::operator-(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2 - a2*b1;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
+	long long a1 = getNumerator();
+	long long b1 = getDenominator();
+	long long a2 = value.getNumerator();
+	long long b2 = value.getDenominator();
+	HumNum output;
+	if ((b1 > 0) && (b2 > 0) && !(b1 & (b1 - 1)) && !(b2 & (b2 - 1))) {
+		// power-of-two denominators: the larger one is the common denominator.
+		if (b1 < b2) {
+			a1 *= b2 >> countTrailingZeros(b1);
+			b1 = b2;
+		} else if (b2 < b1) {
+			a2 *= b1 >> countTrailingZeros(b2);
+		}
+		output.reduce(a1 - a2, b1);
+	} else {
+		long long x = a1 * b2;
+		long long y = a2 * b1;
+		if (((y < 0) && (x > LLONG_MAX + y)) || ((y > 0) && (x < LLONG_MIN + y))) {
+			// The cross products (from INT_MIN terms) do not subtract
+			// within 64 bits: halve the fraction, which may lose precision.
+			s_overflow = true;
+			output.reduce(x / 2 - y / 2, b1 * b2 / 2);
+		} else {
+			output.reduce(x - y, b1 * b2);
+		}
+	}
 	return output;
 }
 
 
 HumNum HumNum::operator-(int value) const {
-	HumNum output(top - value * bot, bot);
+	HumNum output;
+	output.reduce(top - (long long)value * bot, bot);
 	return output;
 }
 
@@ -487,7 +674,8 @@ HumNum HumNum::operator-(int value) const {
 //
 
 HumNum HumNum::operator-(void) const {
-	HumNum output(-top, bot);
+	HumNum output;
+	output.reduce(-(long long)top, bot);
 	return output;
 }
 
@@ -500,19 +688,19 @@ HumNum HumNum::operator-(void) const {
 //
 
 HumNum HumNum::operator*(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*a2;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
+	long long a1 = getNumerator();
+	long long b1 = getDenominator();
+	long long a2 = value.getNumerator();
+	long long b2 = value.getDenominator();
+	HumNum output;
+	output.reduce(a1*a2, b1*b2);
 	return output;
 }
 
 
 HumNum HumNum::operator*(int value) const {
-	HumNum output(top * value, bot);
+	HumNum output;
+	output.reduce((long long)top * value, bot);
 	return output;
 }
 
@@ -525,27 +713,27 @@ HumNum HumNum::operator*(int value) const {
 //
 
 HumNum HumNum::operator/(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2;
-	int bo = b1*a2;
-	HumNum output(ao, bo);
+	long long a1 = getNumerator();
+	long long b1 = getDenominator();
+	long long a2 = value.getNumerator();
+	long long b2 = value.getDenominator();
+	HumNum output;
+	output.reduce(a1*b2, b1*a2);
 	return output;
 }
 
 
 HumNum HumNum::operator/(int value) const {
-	int a  = getNumerator();
-	int b  = getDenominator();
+	long long a = getNumerator();
+	long long b = getDenominator();
 	if (value < 0) {
 		a = -a;
-		b *= -value;
+		b *= -(long long)value;
 	} else {
 		b *= value;
 	}
-	HumNum output(a, b);
+	HumNum output;
+	output.reduce(a, b);
 	return output;
 }
 
@@ -558,10 +746,9 @@ HumNum HumNum::operator/(int value) const {
 //
 
 HumNum& HumNum::operator=(const HumNum& value) {
-	if (this == &value) {
-		return *this;
-	}
-	setValue(value.top, value.bot);
+	// value is already reduced, so copy it directly:
+	top = value.top;
+	bot = value.bot;
 	return *this;
 }
 
@@ -655,11 +842,17 @@ bool HumNum::operator<(const HumNum& value) const {
 	if (this == &value) {
 		return false;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot < (long long)value.top * bot;
+	}
 	return getFloat() < value.getFloat();
 }
 
 
 bool HumNum::operator<(int value) const {
+	if (bot > 0) {
+		return top < (long long)value * bot;
+	}
 	return getFloat() < value;
 }
 
@@ -680,11 +873,17 @@ bool HumNum::operator<=(const HumNum& value) const {
 	if (this == &value) {
 		return true;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot <= (long long)value.top * bot;
+	}
 	return getFloat() <= value.getFloat();
 }
 
 
 bool HumNum::operator<=(int value) const {
+	if (bot > 0) {
+		return top <= (long long)value * bot;
+	}
 	return getFloat() <= value;
 }
 
@@ -705,11 +904,17 @@ bool HumNum::operator>(const HumNum& value) const {
 	if (this == &value) {
 		return false;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot > (long long)value.top * bot;
+	}
 	return getFloat() > value.getFloat();
 }
 
 
 bool HumNum::operator>(int value) const {
+	if (bot > 0) {
+		return top > (long long)value * bot;
+	}
 	return getFloat() > value;
 }
 
@@ -730,11 +935,17 @@ bool HumNum::operator>=(const HumNum& value) const {
 	if (this == &value) {
 		return true;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot >= (long long)value.top * bot;
+	}
 	return getFloat() >= value.getFloat();
 }
 
 
 bool HumNum::operator>=(int value) const {
+	if (bot > 0) {
+		return top >= (long long)value * bot;
+	}
 	return getFloat() >= value;
 }
 
@@ -755,11 +966,19 @@ bool HumNum::operator==(const HumNum& value) const {
 	if (this == &value) {
 		return true;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		// both values are reduced, so they are equal only if their
+		// numerators and denominators are equal.
+		return (top == value.top) && (bot == value.bot);
+	}
 	return getFloat() == value.getFloat();
 }
 
 
 bool HumNum::operator==(int value) const {
+	if (bot > 0) {
+		return (top == value) && (bot == 1);
+	}
 	return getFloat() == value;
 }
 
@@ -780,11 +999,19 @@ bool HumNum::operator!=(const HumNum& value) const {
 	if (this == &value) {
 		return false;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		// both values are reduced, so they are equal only if their
+		// numerators and denominators are equal.
+		return (top != value.top) || (bot != value.bot);
+	}
 	return getFloat() != value.getFloat();
 }
 
 
 bool HumNum::operator!=(int value) const {
+	if (bot > 0) {
+		return (top != value) || (bot != 1);
+	}
 	return getFloat() != value;
 }
 
@@ -888,6 +1115,30 @@ ostream& HumNum::printTwoPart(ostream& out, const string& spacer) const {
 
 
 
+//////////////////////////////
+//
+// HumNum::hasOverflow -- Returns true if an arithmetic result in the
+//    current thread did not fit into ints since the last call to
+//    clearOverflow(), so that an approximation of it was stored.
+//
+
+bool HumNum::hasOverflow(void) {
+	return s_overflow;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::clearOverflow -- Reset the overflow state of the current thread.
+//
+
+void HumNum::clearOverflow(void) {
+	s_overflow = false;
+}
+
+
+
 //////////////////////////////
 //
 // HumNum::printList -- Print as a list of two numbers, such as
@@ -19,6 +19,9 @@
 #include "HumRegex.h"
 
 #include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
 
 using namespace std;
 
@@ -37,6 +40,7 @@ HumRegex::HumRegex(void) {
 	m_regexflags  = std::regex_constants::ECMAScript;
 
 	m_searchflags = std::regex_constants::format_first_only;
+	m_compiled = false;
 }
 
 
@@ -48,7 +52,8 @@ HumRegex::HumRegex(const string& exp, const string& options) {
 		// explicitly set the default syntax
 		m_regexflags = std::regex_constants::ECMAScript;
 	}
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	m_compiled = false;
+	setRegex(exp, getTemporaryRegexFlags(options));
 	m_searchflags = (std::regex_constants::match_flag_type)0;
 	m_searchflags = getTemporarySearchFlags(options);
 }
@@ -155,7 +160,7 @@ void HumRegex::unsetGlobal(void) {
 //
 
 int HumRegex::search(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	bool result = regex_search(input, m_matches, m_regex, m_searchflags);
 	if (!result) {
 		return 0;
@@ -170,7 +175,7 @@ int HumRegex::search(const string& input, const string& exp) {
 
 int HumRegex::search(const string& input, int startindex,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
 	bool result = regex_search(startit, endit, m_matches, m_regex, m_searchflags);
@@ -199,7 +204,7 @@ int HumRegex::search(string* input, int startindex, const string& exp) {
 
 int HumRegex::search(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	bool result = regex_search(input, m_matches, m_regex, getTemporarySearchFlags(options));
 	if (!result) {
 		return 0;
@@ -213,7 +218,7 @@ int HumRegex::search(const string& input, const string& exp,
 
 int HumRegex::search(const string& input, int startindex, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
 	bool result = regex_search(startit, endit, m_matches, m_regex, getTemporarySearchFlags(options));
@@ -385,14 +390,14 @@ int HumRegex::getMatchLength(int index) {
 //
 
 bool HumRegex::match(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	return regex_match(input, m_regex, m_searchflags);
 }
 
 
 bool HumRegex::match(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	return regex_match(input, m_regex, getTemporarySearchFlags(options));
 }
 
@@ -424,7 +429,7 @@ bool HumRegex::match(const string* input, const string& exp,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	input = regex_replace(input, m_regex, replacement, m_searchflags);
 	return input;
 }
@@ -441,7 +446,7 @@ string& HumRegex::replaceDestructive(string* input, const string& replacement,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	input = regex_replace(input, m_regex, replacement, getTemporarySearchFlags(options));
 	return input;
 }
@@ -462,7 +467,7 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
 			input.end(), m_regex, replacement);
@@ -481,7 +486,7 @@ string HumRegex::replaceCopy(string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& exp,
 		const string& replacement, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
 			input.end(), m_regex, replacement, getTemporarySearchFlags(options));
@@ -558,6 +563,79 @@ bool HumRegex::split(vector<string>& entries, const string& buffer,
 
 
 
+//////////////////////////////
+//
+// HumRegex::setRegex -- Set the regular expression used for the next
+//    search/match/replace.  The expression is not recompiled if it
+//    is the same as the previous one used by this object, and otherwise
+//    a compiled copy is fetched from the process-wide regex cache.
+//
+
+void HumRegex::setRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	if (m_compiled && (flags == m_compiledflags) && (exp == m_expression)) {
+		return;
+	}
+	m_regex = getCompiledRegex(exp, flags);
+	m_expression = exp;
+	m_compiledflags = flags;
+	m_compiled = true;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getCompiledRegex -- Return a compiled regular expression
+//    for the given expression and syntax flags.  Compiled expressions
+//    are stored in a cache shared by all HumRegex objects (and threads),
+//    so that tools which search for the same expressions on every token
+//    do not recompile them each time.  The least recently used
+//    expression is removed from the cache when it becomes full.
+//    Copying a std::regex only copies a reference to the compiled
+//    automaton, so the returned copy is cheap.  Invalid expressions
+//    throw std::regex_error and are not stored in the cache.
+//
+
+std::regex HumRegex::getCompiledRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	typedef pair<std::regex_constants::syntax_option_type, string> RegexKey;
+	typedef list<pair<RegexKey, std::regex>> RegexList;
+
+	// HUMREGEX_CACHE_SIZE: maximum number of expressions in the cache.
+	static const int HUMREGEX_CACHE_SIZE = 512;
+
+	static std::mutex cachemutex;
+	static RegexList cachelist;  // most recently used at front
+	static map<RegexKey, RegexList::iterator> cachemap;
+
+	RegexKey key(flags, exp);
+	{
+		std::lock_guard<std::mutex> lock(cachemutex);
+		auto found = cachemap.find(key);
+		if (found != cachemap.end()) {
+			cachelist.splice(cachelist.begin(), cachelist, found->second);
+			return found->second->second;
+		}
+	}
+
+	// Compile outside of the lock since this is the slow part:
+	std::regex output(exp, flags);
+
+	std::lock_guard<std::mutex> lock(cachemutex);
+	if (cachemap.find(key) == cachemap.end()) {
+		cachelist.emplace_front(key, output);
+		cachemap[key] = cachelist.begin();
+		if ((int)cachelist.size() > HUMREGEX_CACHE_SIZE) {
+			cachemap.erase(cachelist.back().first);
+			cachelist.pop_back();
+		}
+	}
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // HumRegex::getTemporaryRegexFlags --
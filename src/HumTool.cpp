@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Nov 28 08:55:15 PST 2016
-// Last Modified: Tue Dec 20 22:33:15 PST 2016
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      HumTool.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/HumTool.cpp
 // Syntax:        C++11; humlib
@@ -12,6 +12,8 @@
 
 #include "HumTool.h"
 
+#include <thread>
+
 using namespace std;
 
 namespace hum {
@@ -278,6 +280,62 @@ void HumTool::clearOutput(void) {
 
 
 
+///////////////////////////////
+//
+// HumTool::defineThreadOption -- Define the -j option for setting the
+//     number of threads used by STREAM_INTERFACE and SET_INTERFACE
+//     programs.  Only the long form --jobs is defined if the tool
+//     already uses -j for something else.  A tool opts in to -j by
+//     calling this function in its constructor.  Only do that after
+//     checking that separate instances of the tool can run at the same
+//     time: no static or global variables that the tool changes, no
+//     direct printing to cout, and no data carried from one input file
+//     to the next.
+//
+
+void HumTool::defineThreadOption(void) {
+	if (isDefined("jobs")) {
+		return;
+	}
+	if (isDefined("j")) {
+		define("jobs=i:1", "number of threads for processing input segments");
+	} else {
+		define("j|jobs=i:1", "number of threads for processing input segments");
+	}
+}
+
+
+
+///////////////////////////////
+//
+// HumTool::getThreadCount -- Return the number of threads requested
+//     with the -j option (or another integer option, such as the
+//     --threads option of tools which use threads within the analysis of
+//     each file).  A value of 0 means to use one thread for each
+//     processor core.  Returns 1 if the option is not defined.
+//
+
+int HumTool::getThreadCount(void) {
+	return getThreadCount("jobs");
+}
+
+
+int HumTool::getThreadCount(const string& option) {
+	if (!isDefined(option)) {
+		return 1;
+	}
+	int output = getInteger(option);
+	if (output == 0) {
+		output = (int)std::thread::hardware_concurrency();
+	}
+	if (output < 1) {
+		output = 1;
+	}
+	return output;
+}
+
+
+
 ///////////////////////////////
 //
 // HumTool::setError --
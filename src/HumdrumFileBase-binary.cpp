@@ -0,0 +1,1128 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 03:10:17 UTC 2026
+// Last Modified: Sun Oct 18 08:58:23 UTC 2026
+// Filename:      HumdrumFileBase-binary.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/HumdrumFileBase-binary.cpp
+// Syntax:        C++11; humlib
+// vim:           syntax=cpp ts=3 noexpandtab nowrap
+//
+// Description:   Binary storage of analyzed Humdrum files, so that they
+//                can be reloaded without parsing and analyzing the text
+//                again.  The binary data contains the lines and tokens
+//                of the file, the spine links between tokens, track and
+//                spine information, rhythmic analysis, barlines, strands
+//                and strophes.  Content analyses (such as slurs and ties)
+//                and parameters are not stored, and will be calculated
+//                again when they are needed.  Most values are stored only
+//                when they differ from a prediction made from the data
+//                already stored (such as the token above, or the last
+//                token with the same text), so binary files are usually
+//                only one and a half to two times the size of the Humdrum
+//                text.
+//                HumdrumFile::read() (for files, strings and istreams)
+//                and HumdrumFileStream detect the format automatically.
+//
+//                Format (integers are stored as variable-length
+//                zigzag-encoded values using 7 bits per byte, strings as
+//                a byte count followed by the bytes, rational numbers as
+//                a numerator and denominator, texts as an index into a
+//                table of the previous texts followed by the string if it
+//                is new, and tokens as an offset from the index of the
+//                current token in the list of all token fields in the
+//                file, plus one, with 0 meaning no token):
+//
+//                   magic number "\0HUMDRUM"
+//                   format version
+//                   filename, segment level, ticks per quarter note,
+//                      XML ID prefix, parse error, analysis flags
+//                   line count, then for each line:
+//                      line flags, line text (if it is not the tokens
+//                      joined by tabs), duration, duration from start,
+//                      duration from barline, duration to barline, rhythm
+//                      analyzed, tab counts, token count (each after the
+//                      text only if flagged), then for each token:
+//                         token flags (0 for no token), token text,
+//                         spine info text, track, subtrack, subtrack count,
+//                         duration, rhythm analyzed, rhythm check state,
+//                         strand index (each after the text only if flagged)
+//                   for each token with stored links: link flags, then
+//                      (only if flagged) next tokens, previous tokens, next
+//                      non-null tokens, previous non-null tokens, null
+//                      resolution, strophe
+//                   track starts, track ends, barline line indexes,
+//                      1-D strands, 2-D strands, 1-D strophes, 2-D strophes
+//                      (tokens offset from index 0)
+//
+//                Line flags (a value is stored if its bit is set):
+//                   0x01  text (otherwise the tokens joined by tabs)
+//                   0x02  rhythm analyzed (otherwise 1)
+//                   0x04  tab counts (otherwise 1 between each token)
+//                   0x08  duration from start (otherwise the previous
+//                         line's duration from start plus its duration)
+//                   0x10  duration from barline (otherwise 0 after a
+//                         barline, or the previous line's value plus its
+//                         duration)
+//                   0x20  duration to barline (otherwise the previous
+//                         line's value minus its duration)
+//                   0x40  token count (otherwise that of the previous line)
+//
+//                Token flags:
+//                   0x03  1 = address stored, 2 = same address as the token
+//                         in the same field on the previous line
+//                   0x04  duration (otherwise the duration of the last
+//                         token with the same text, or -1)
+//                   0x08  rhythm analyzed (otherwise that of the line)
+//                   0x10  rhythm check state (otherwise rhythm analyzed)
+//                   0x20  link flags (otherwise all links are predicted)
+//                   0x40  strand index (otherwise that of the token above,
+//                         or -1)
+//
+//                Link flags:
+//                   0x01  next tokens (otherwise the token in the same
+//                         field on the next line)
+//                   0x02  previous tokens (otherwise the token in the same
+//                         field on the previous line)
+//                   0x04  next non-null tokens (otherwise the next tokens
+//                         which are non-null data, and the next non-null
+//                         tokens of the others)
+//                   0x08  previous non-null tokens (likewise)
+//                   0x30  null resolution: 0x00 = the first previous
+//                         non-null token for null data tokens, otherwise
+//                         none; 0x10 = the token itself; 0x20 = none;
+//                         0x30 = stored
+//                   0x40  strophe (otherwise none)
+//
+
+#include "HumdrumFileBase.h"
+#include "HumMemoryMap.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+const char HumdrumFileBase::BINARY_MAGIC[9] = "\0HUMDRUM";
+const int HumdrumFileBase::BINARY_VERSION = 2;
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readBinary -- Load a file which was stored with
+//     writeBinary().  Returns false if the data is not in the binary
+//     format, or is corrupted.
+//
+
+bool HumdrumFileBase::readBinary(const string& filename) {
+	m_displayError = true;
+	if (filename.empty() || (filename == "-")) {
+		return HumdrumFileBase::readBinary(cin);
+	}
+	HumMemoryMap infile;
+	if (!infile.open(filename)) {
+		return setParseError("Cannot open file >>%s<< for reading.", filename.c_str());
+	}
+	return readBinaryBuffer(infile.getData(), infile.getSize());
+}
+
+
+bool HumdrumFileBase::readBinary(istream& contents) {
+	m_displayError = true;
+	string buffer((istreambuf_iterator<char>(contents)), istreambuf_iterator<char>());
+	return readBinaryBuffer(buffer.data(), buffer.size());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::writeBinary -- Store the contents and structural
+//     analysis of the file in a binary format which can be loaded
+//     with readBinary().
+//
+
+bool HumdrumFileBase::writeBinary(const string& filename) {
+	if (filename.empty() || (filename == "-")) {
+		return HumdrumFileBase::writeBinary(cout);
+	}
+	std::ofstream outfile(filename, std::ios::out | std::ios::binary);
+	if (!outfile.is_open()) {
+		return false;
+	}
+	return HumdrumFileBase::writeBinary(outfile);
+}
+
+
+bool HumdrumFileBase::writeBinary(ostream& out) {
+	string output;
+	output.append(BINARY_MAGIC, sizeof(BINARY_MAGIC) - 1);
+	appendBinaryInt(output, BINARY_VERSION);
+
+	appendBinaryString(output, m_filename);
+	appendBinaryInt(output, m_segmentlevel);
+	appendBinaryInt(output, m_ticksperquarternote);
+	appendBinaryString(output, m_idprefix);
+	appendBinaryString(output, m_parseError);
+	int flags = 0;
+	if (m_analyses.m_structure_analyzed) { flags |= 0x01; }
+	if (m_analyses.m_rhythm_analyzed)    { flags |= 0x02; }
+	if (m_analyses.m_strands_analyzed)   { flags |= 0x04; }
+	if (m_analyses.m_strophes_analyzed)  { flags |= 0x08; }
+	if (m_analyses.m_nulls_analyzed)     { flags |= 0x10; }
+	appendBinaryInt(output, flags);
+
+	// offsets: index of the first token of each line in the list of
+	// all tokens in the file.
+	vector<int> offsets(m_lines.size());
+	int tokencount = 0;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		offsets[i] = tokencount;
+		tokencount += (int)m_lines[i]->m_tokens.size();
+	}
+
+	// texts: table of token texts which have been stored, and the duration
+	// of the last token with each text.
+	unordered_map<string, int> texts;
+	vector<HumNum> durations;
+
+	// spineinfos: table of spine info strings which have been stored.
+	unordered_map<string, int> spineinfos;
+	string linetext;
+
+	appendBinaryInt(output, (int)m_lines.size());
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		HumdrumLine* previous = i > 0 ? m_lines[i-1] : NULL;
+
+		HumNum fromstart = 0;
+		HumNum frombarline = 0;
+		HumNum tobarline = 0;
+		if (previous) {
+			fromstart = previous->m_durationFromStart + previous->m_duration;
+			if (!previous->isBarline()) {
+				frombarline = previous->m_durationFromBarline + previous->m_duration;
+			}
+			tobarline = previous->m_durationToBarline - previous->m_duration;
+		}
+		bool tabsQ = (int)line.m_tabs.size() == (int)line.m_tokens.size();
+		for (int j=0; tabsQ && (j<(int)line.m_tabs.size()); j++) {
+			tabsQ = line.m_tabs[j] == (j < (int)line.m_tabs.size() - 1 ? 1 : 0);
+		}
+
+		// Usually the text of the line can be recreated from the tokens:
+		bool textQ = !(joinBinaryTokens(line, linetext) && (linetext == line));
+		int flags = 0;
+		if (textQ)                                    { flags |= 0x01; }
+		if (line.m_rhythm_analyzed != 1)              { flags |= 0x02; }
+		if (!tabsQ)                                   { flags |= 0x04; }
+		if (line.m_durationFromStart != fromstart)     { flags |= 0x08; }
+		if (line.m_durationFromBarline != frombarline) { flags |= 0x10; }
+		if (line.m_durationToBarline != tobarline)     { flags |= 0x20; }
+		if ((int)line.m_tokens.size() != (previous ? (int)previous->m_tokens.size() : 0)) {
+			flags |= 0x40;
+		}
+		appendBinaryInt(output, flags);
+		if (flags & 0x01) { appendBinaryString(output, line); }
+		appendBinaryNum(output, line.m_duration);
+		if (flags & 0x08) { appendBinaryNum(output, line.m_durationFromStart); }
+		if (flags & 0x10) { appendBinaryNum(output, line.m_durationFromBarline); }
+		if (flags & 0x20) { appendBinaryNum(output, line.m_durationToBarline); }
+		if (flags & 0x02) { appendBinaryInt(output, line.m_rhythm_analyzed); }
+		if (flags & 0x04) {
+			appendBinaryInt(output, (int)line.m_tabs.size());
+			for (int j=0; j<(int)line.m_tabs.size(); j++) {
+				appendBinaryInt(output, line.m_tabs[j]);
+			}
+		}
+
+		if (flags & 0x40) {
+			appendBinaryInt(output, (int)line.m_tokens.size());
+		}
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			HTp token = line.m_tokens[j];
+			if (!token) {
+				appendBinaryInt(output, 0);
+				continue;
+			}
+			HTp above = getBinaryFieldToken(i - 1, j);
+			HumNum duration = -1;
+			auto it = texts.find(*token);
+			if (it != texts.end()) {
+				duration = durations[it->second];
+			}
+			// Token addresses are usually the same as the token above:
+			int tflags = 1;
+			if (above && (above->m_address.getSpineInfo() == token->m_address.getSpineInfo())
+					&& (above->m_address.getTrack() == token->m_address.getTrack())
+					&& (above->m_address.getSubtrack() == token->m_address.getSubtrack())
+					&& (above->m_address.getSubtrackCount() == token->m_address.getSubtrackCount())) {
+				tflags = 2;
+			}
+			if (token->m_duration != duration)                   { tflags |= 0x04; }
+			if (token->m_rhythm_analyzed != line.m_rhythm_analyzed) { tflags |= 0x08; }
+			if (token->m_rhycheck != token->m_rhythm_analyzed)    { tflags |= 0x10; }
+			if (getBinaryLinkFlags(token, i, j) != 0)             { tflags |= 0x20; }
+			if (token->m_strand != (above ? above->m_strand : -1)) { tflags |= 0x40; }
+			appendBinaryInt(output, tflags);
+
+			int index = appendBinaryText(output, *token, texts);
+			if (index == (int)durations.size()) {
+				durations.push_back(0);
+			}
+			durations[index] = token->m_duration;
+
+			if ((tflags & 0x03) == 1) { appendBinaryAddress(output, token, spineinfos); }
+			if (tflags & 0x04) { appendBinaryNum(output, token->m_duration); }
+			if (tflags & 0x08) { appendBinaryInt(output, token->m_rhythm_analyzed); }
+			if (tflags & 0x10) { appendBinaryInt(output, token->m_rhycheck); }
+			if (tflags & 0x40) { appendBinaryInt(output, token->m_strand); }
+		}
+	}
+
+	// Links between tokens which cannot be predicted are stored after all
+	// tokens are known:
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			HTp token = line.m_tokens[j];
+			int flags = token ? getBinaryLinkFlags(token, i, j) : 0;
+			if (flags == 0) {
+				continue;
+			}
+			int index = offsets[i] + j;
+			appendBinaryInt(output, flags);
+			if (flags & 0x01) {
+				appendBinaryTokenList(output, token->m_nextTokens, index, offsets);
+			}
+			if (flags & 0x02) {
+				appendBinaryTokenList(output, token->m_previousTokens, index, offsets);
+			}
+			if (flags & 0x04) {
+				appendBinaryTokenList(output, token->m_nextNonNullTokens, index, offsets);
+			}
+			if (flags & 0x08) {
+				appendBinaryTokenList(output, token->m_previousNonNullTokens, index, offsets);
+			}
+			if ((flags & 0x30) == 0x30) {
+				appendBinaryToken(output, token->m_nullresolve, index, offsets);
+			}
+			if (flags & 0x40) {
+				appendBinaryToken(output, token->m_strophe, index, offsets);
+			}
+		}
+	}
+
+	appendBinaryTokenList(output, m_trackstarts, 0, offsets);
+	appendBinaryInt(output, (int)m_trackends.size());
+	for (int i=0; i<(int)m_trackends.size(); i++) {
+		appendBinaryTokenList(output, m_trackends[i], 0, offsets);
+	}
+	appendBinaryInt(output, (int)m_barlines.size());
+	for (int i=0; i<(int)m_barlines.size(); i++) {
+		appendBinaryInt(output, m_barlines[i]->getLineIndex());
+	}
+	appendBinaryTokenPairs(output, m_strand1d, 0, offsets);
+	appendBinaryInt(output, (int)m_strand2d.size());
+	for (int i=0; i<(int)m_strand2d.size(); i++) {
+		appendBinaryTokenPairs(output, m_strand2d[i], 0, offsets);
+	}
+	appendBinaryTokenPairs(output, m_strophes1d, 0, offsets);
+	appendBinaryInt(output, (int)m_strophes2d.size());
+	for (int i=0; i<(int)m_strophes2d.size(); i++) {
+		appendBinaryTokenPairs(output, m_strophes2d[i], 0, offsets);
+	}
+
+	out.write(output.data(), output.size());
+	return (bool)out;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::isBinary -- Returns true if the given data starts
+//     with the signature of the binary format written by writeBinary().
+//
+
+bool HumdrumFileBase::isBinary(const char* contents, size_t size) {
+	size_t length = sizeof(BINARY_MAGIC) - 1;
+	if (size < length) {
+		return false;
+	}
+	return memcmp(contents, BINARY_MAGIC, length) == 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readBinaryBuffer -- Load binary data which was
+//     created by writeBinary().
+//
+
+bool HumdrumFileBase::readBinaryBuffer(const char* contents, size_t size) {
+	clear();
+	if (!isBinary(contents, size)) {
+		return setParseError("Data is not in the binary Humdrum format.");
+	}
+	const char* ptr = contents + sizeof(BINARY_MAGIC) - 1;
+	const char* end = contents + size;
+	bool ok = true;
+	int version = extractBinaryInt(ptr, end, ok);
+	if (version != BINARY_VERSION) {
+		return setParseError("Unknown binary Humdrum format version %d.", version);
+	}
+
+	extractBinaryString(m_filename, ptr, end, ok);
+	m_segmentlevel = extractBinaryInt(ptr, end, ok);
+	m_ticksperquarternote = extractBinaryInt(ptr, end, ok);
+	extractBinaryString(m_idprefix, ptr, end, ok);
+	extractBinaryString(m_parseError, ptr, end, ok);
+	int flags = extractBinaryInt(ptr, end, ok);
+	m_analyses.m_structure_analyzed = flags & 0x01;
+	m_analyses.m_rhythm_analyzed    = flags & 0x02;
+	m_analyses.m_strands_analyzed   = flags & 0x04;
+	m_analyses.m_strophes_analyzed  = flags & 0x08;
+	m_analyses.m_nulls_analyzed     = flags & 0x10;
+
+	// tokens: list of all token fields in the file, used to resolve
+	// links between tokens.
+	vector<HTp> tokens;
+
+	// texts: table of token texts which have been read, and the duration
+	// of the last token with each text.
+	vector<string> texts;
+	vector<HumNum> durations;
+
+	// spineinfos: table of spine info strings which have been read.
+	vector<string> spineinfos;
+
+	// linkflags: link flags of each token (non-zero if they are stored).
+	vector<int> linkflags;
+
+	HumArena* oldarena = HumArena::getActive();
+	if (m_arenaQ) {
+		HumArena::setActive(&m_arena);
+	}
+	int linecount = extractBinaryCount(ptr, end, ok);
+	m_lines.reserve(linecount);
+	for (int i=0; ok && (i<linecount); i++) {
+		HLp line = new HumdrumLine;
+		line->setOwner(this);
+		line->m_lineindex = i;
+		m_lines.push_back(line);
+		HumdrumLine* previous = i > 0 ? m_lines[i-1] : NULL;
+
+		int flags = extractBinaryInt(ptr, end, ok);
+		if (flags & 0x01) {
+			extractBinaryString(*line, ptr, end, ok);
+		}
+		line->m_duration = extractBinaryNum(ptr, end, ok);
+		line->m_durationFromStart = 0;
+		line->m_durationFromBarline = 0;
+		line->m_durationToBarline = 0;
+		if (previous) {
+			line->m_durationFromStart = previous->m_durationFromStart + previous->m_duration;
+			if (!previous->isBarline()) {
+				line->m_durationFromBarline = previous->m_durationFromBarline + previous->m_duration;
+			}
+			line->m_durationToBarline = previous->m_durationToBarline - previous->m_duration;
+		}
+		if (flags & 0x08) {
+			line->m_durationFromStart = extractBinaryNum(ptr, end, ok);
+		}
+		if (flags & 0x10) {
+			line->m_durationFromBarline = extractBinaryNum(ptr, end, ok);
+		}
+		if (flags & 0x20) {
+			line->m_durationToBarline = extractBinaryNum(ptr, end, ok);
+		}
+		line->m_rhythm_analyzed = (flags & 0x02) ? extractBinaryInt(ptr, end, ok) : 1;
+		if (flags & 0x04) {
+			int tabcount = extractBinaryCount(ptr, end, ok);
+			line->m_tabs.resize(tabcount);
+			for (int j=0; j<tabcount; j++) {
+				line->m_tabs[j] = extractBinaryInt(ptr, end, ok);
+			}
+		}
+
+		int tokencount = previous ? (int)previous->m_tokens.size() : 0;
+		if (flags & 0x40) {
+			tokencount = extractBinaryCount(ptr, end, ok);
+		}
+		if (!(flags & 0x04)) {
+			line->m_tabs.assign(tokencount, 1);
+			if (tokencount > 0) {
+				line->m_tabs.back() = 0;
+			}
+		}
+		line->m_tokens.reserve(tokencount);
+		for (int j=0; ok && (j<tokencount); j++) {
+			int tflags = extractBinaryInt(ptr, end, ok);
+			linkflags.push_back(tflags & 0x20);
+			if (tflags == 0) {
+				line->m_tokens.push_back(NULL);
+				tokens.push_back(NULL);
+				continue;
+			}
+			HTp token = new HumdrumToken;
+			token->setOwner(line);
+			token->setFieldIndex(j);
+			line->m_tokens.push_back(token);
+			tokens.push_back(token);
+
+			int index = extractBinaryText(*token, ptr, end, ok, texts);
+			if (!ok) {
+				break;
+			}
+			if (index == (int)durations.size()) {
+				durations.push_back(-1);
+			}
+
+			HTp above = NULL;
+			if (previous && (j < (int)previous->m_tokens.size())) {
+				above = previous->m_tokens[j];
+			}
+			if ((tflags & 0x03) == 2) {
+				// address is the same as the token above
+				if (!above) {
+					ok = false;
+					break;
+				}
+				token->setSpineInfo(above->m_address.getSpineInfo());
+				token->setTrack(above->m_address.getTrack(), above->m_address.getSubtrack());
+				token->setSubtrackCount(above->m_address.getSubtrackCount());
+			} else {
+				extractBinaryAddress(token, ptr, end, ok, spineinfos);
+			}
+			if (tflags & 0x04) {
+				durations[index] = extractBinaryNum(ptr, end, ok);
+			}
+			token->m_duration = durations[index];
+			token->m_rhythm_analyzed = (tflags & 0x08) ? extractBinaryInt(ptr, end, ok)
+					: line->m_rhythm_analyzed;
+			token->m_rhycheck = (tflags & 0x10) ? extractBinaryInt(ptr, end, ok)
+					: token->m_rhythm_analyzed;
+			token->m_strand = (tflags & 0x40) ? extractBinaryInt(ptr, end, ok)
+					: (above ? above->m_strand : -1);
+		}
+		if (ok && !(flags & 0x01) && !joinBinaryTokens(*line, *line)) {
+			ok = false;
+		}
+	}
+	HumArena::setActive(oldarena);
+
+	// The next non-null tokens which are not stored depend on the tokens
+	// after them, so they are filled in afterwards in reverse order.
+	for (int i=0; ok && (i<(int)tokens.size()); i++) {
+		HTp token = tokens[i];
+		if (!token) {
+			continue;
+		}
+		int lineindex = token->getLineIndex();
+		int fieldindex = token->getFieldIndex();
+		int flags = linkflags[i] ? extractBinaryInt(ptr, end, ok) : 0;
+		linkflags[i] = flags;
+		if (flags & 0x01) {
+			extractBinaryTokenList(token->m_nextTokens, ptr, end, ok, i, tokens);
+		} else {
+			setBinaryLink(token->m_nextTokens, getBinaryFieldToken(lineindex + 1, fieldindex));
+		}
+		if (flags & 0x02) {
+			extractBinaryTokenList(token->m_previousTokens, ptr, end, ok, i, tokens);
+		} else {
+			setBinaryLink(token->m_previousTokens, getBinaryFieldToken(lineindex - 1, fieldindex));
+		}
+		if (flags & 0x04) {
+			extractBinaryTokenList(token->m_nextNonNullTokens, ptr, end, ok, i, tokens);
+		}
+		if (flags & 0x08) {
+			extractBinaryTokenList(token->m_previousNonNullTokens, ptr, end, ok, i, tokens);
+		} else {
+			getBinaryNonNullLinks(token->m_previousTokens, false, token->m_previousNonNullTokens);
+		}
+		switch (flags & 0x30) {
+			case 0x00:
+				token->m_nullresolve = getBinaryNullResolve(token);
+				break;
+			case 0x10:
+				token->m_nullresolve = token;
+				break;
+			case 0x20:
+				token->m_nullresolve = NULL;
+				break;
+			case 0x30:
+				token->m_nullresolve = extractBinaryToken(ptr, end, ok, i, tokens);
+				break;
+		}
+		if (flags & 0x40) {
+			token->m_strophe = extractBinaryToken(ptr, end, ok, i, tokens);
+		}
+	}
+	for (int i=(int)tokens.size()-1; ok && (i>=0); i--) {
+		if (tokens[i] && !(linkflags[i] & 0x04)) {
+			getBinaryNonNullLinks(tokens[i]->m_nextTokens, true, tokens[i]->m_nextNonNullTokens);
+		}
+	}
+
+	extractBinaryTokenList(m_trackstarts, ptr, end, ok, 0, tokens);
+	m_trackends.resize(extractBinaryCount(ptr, end, ok));
+	for (int i=0; i<(int)m_trackends.size(); i++) {
+		extractBinaryTokenList(m_trackends[i], ptr, end, ok, 0, tokens);
+	}
+	int barcount = extractBinaryCount(ptr, end, ok);
+	for (int i=0; ok && (i<barcount); i++) {
+		int index = extractBinaryInt(ptr, end, ok);
+		if ((index < 0) || (index >= (int)m_lines.size())) {
+			ok = false;
+			break;
+		}
+		m_barlines.push_back(m_lines[index]);
+	}
+	extractBinaryTokenPairs(m_strand1d, ptr, end, ok, 0, tokens);
+	m_strand2d.resize(extractBinaryCount(ptr, end, ok));
+	for (int i=0; i<(int)m_strand2d.size(); i++) {
+		extractBinaryTokenPairs(m_strand2d[i], ptr, end, ok, 0, tokens);
+	}
+	extractBinaryTokenPairs(m_strophes1d, ptr, end, ok, 0, tokens);
+	m_strophes2d.resize(extractBinaryCount(ptr, end, ok));
+	for (int i=0; i<(int)m_strophes2d.size(); i++) {
+		extractBinaryTokenPairs(m_strophes2d[i], ptr, end, ok, 0, tokens);
+	}
+
+	if (!ok) {
+		clear();
+		return setParseError("Binary Humdrum data is corrupted.");
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getBinaryTokenIndex -- Return the index of a token
+//     in the list of all tokens in the file for writeBinary(), or -1 if
+//     the token is NULL or does not belong to the file.
+//
+
+int HumdrumFileBase::getBinaryTokenIndex(HTp token, const vector<int>& offsets) {
+	if (!token) {
+		return -1;
+	}
+	int lineindex = token->getLineIndex();
+	int fieldindex = token->getFieldIndex();
+	if ((lineindex < 0) || (lineindex >= (int)m_lines.size())) {
+		return -1;
+	}
+	HumdrumLine& line = *m_lines[lineindex];
+	if ((fieldindex < 0) || (fieldindex >= (int)line.m_tokens.size())) {
+		return -1;
+	}
+	if (line.m_tokens[fieldindex] != token) {
+		return -1;
+	}
+	return offsets[lineindex] + fieldindex;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::joinBinaryTokens -- Recreate the text of a line from
+//     its tokens and tab counts.  Returns false if the line contains
+//     missing tokens or tab counts.
+//
+
+bool HumdrumFileBase::joinBinaryTokens(HumdrumLine& line, string& output) {
+	int count = (int)line.m_tokens.size();
+	if ((int)line.m_tabs.size() < count - 1) {
+		return false;
+	}
+	string text;
+	for (int i=0; i<count; i++) {
+		if (!line.m_tokens[i]) {
+			return false;
+		}
+		text += *line.m_tokens[i];
+		if (i < count - 1) {
+			if (line.m_tabs[i] < 1) {
+				return false;
+			}
+			text.append(line.m_tabs[i], '\t');
+		}
+	}
+	output.swap(text);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getBinaryFieldToken -- Return the token in the given
+//     line and field, or NULL if there is no such token.
+//
+
+HTp HumdrumFileBase::getBinaryFieldToken(int lineindex, int fieldindex) {
+	if ((lineindex < 0) || (lineindex >= (int)m_lines.size())) {
+		return NULL;
+	}
+	HumdrumLine& line = *m_lines[lineindex];
+	if ((fieldindex < 0) || (fieldindex >= (int)line.m_tokens.size())) {
+		return NULL;
+	}
+	return line.m_tokens[fieldindex];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getBinaryLinkFlags -- Return the link flags of a
+//     token, which mark the links that differ from their prediction
+//     (0 if all links can be predicted).
+//
+
+int HumdrumFileBase::getBinaryLinkFlags(HTp token, int lineindex, int fieldindex) {
+	int flags = 0;
+	if (!isBinaryLink(token->m_nextTokens, getBinaryFieldToken(lineindex + 1, fieldindex))) {
+		flags |= 0x01;
+	}
+	if (!isBinaryLink(token->m_previousTokens, getBinaryFieldToken(lineindex - 1, fieldindex))) {
+		flags |= 0x02;
+	}
+	vector<HTp> nonnull;
+	getBinaryNonNullLinks(token->m_nextTokens, true, nonnull);
+	if (nonnull != token->m_nextNonNullTokens) {
+		flags |= 0x04;
+	}
+	getBinaryNonNullLinks(token->m_previousTokens, false, nonnull);
+	if (nonnull != token->m_previousNonNullTokens) {
+		flags |= 0x08;
+	}
+	if (token->m_nullresolve == getBinaryNullResolve(token)) {
+		// predicted
+	} else if (token->m_nullresolve == token) {
+		flags |= 0x10;
+	} else if (!token->m_nullresolve) {
+		flags |= 0x20;
+	} else {
+		flags |= 0x30;
+	}
+	if (token->m_strophe) {
+		flags |= 0x40;
+	}
+	return flags;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getBinaryNullResolve -- Return the usual null
+//     resolution of a token: the first previous non-null token for null
+//     data tokens, otherwise none.
+//
+
+HTp HumdrumFileBase::getBinaryNullResolve(HTp token) {
+	if (token->isData() && token->isNull() && !token->m_previousNonNullTokens.empty()) {
+		return token->m_previousNonNullTokens[0];
+	}
+	return NULL;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::isBinaryLink -- Returns true if the list of links
+//     contains only the given token (or is empty if the token is NULL).
+//     setBinaryLink() sets the list in the same way.
+//
+
+bool HumdrumFileBase::isBinaryLink(const vector<HTp>& links, HTp token) {
+	if (!token) {
+		return links.empty();
+	}
+	return (links.size() == 1) && (links[0] == token);
+}
+
+
+void HumdrumFileBase::setBinaryLink(vector<HTp>& links, HTp token) {
+	links.clear();
+	if (token) {
+		links.push_back(token);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getBinaryNonNullLinks -- Return the usual next (or
+//     previous) non-null data tokens of a token with the given next (or
+//     previous) tokens: the linked tokens which are non-null data, and the
+//     next (or previous) non-null data tokens of the other linked tokens.
+//
+
+void HumdrumFileBase::getBinaryNonNullLinks(const vector<HTp>& links,
+		bool nextQ, vector<HTp>& output) {
+	output.clear();
+	for (int i=0; i<(int)links.size(); i++) {
+		HTp link = links[i];
+		if (!link) {
+			continue;
+		}
+		if (link->isData() && !link->isNull()) {
+			if (std::find(output.begin(), output.end(), link) == output.end()) {
+				output.push_back(link);
+			}
+			continue;
+		}
+		const vector<HTp>& nonnull = nextQ ? link->m_nextNonNullTokens
+				: link->m_previousNonNullTokens;
+		for (int j=0; j<(int)nonnull.size(); j++) {
+			if (std::find(output.begin(), output.end(), nonnull[j]) == output.end()) {
+				output.push_back(nonnull[j]);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryAddress -- Store the spine information,
+//     track, subtrack and subtrack count of a token.
+//
+
+void HumdrumFileBase::appendBinaryAddress(string& output, HTp token,
+		unordered_map<string, int>& spineinfos) {
+	appendBinaryText(output, token->m_address.getSpineInfo(), spineinfos);
+	appendBinaryInt(output, token->m_address.getTrack());
+	appendBinaryInt(output, token->m_address.getSubtrack());
+	appendBinaryInt(output, token->m_address.getSubtrackCount());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryText -- Store a string as an index into
+//     the table of previously stored strings, followed by the string
+//     itself if it has not been stored yet.  Returns the index.
+//
+
+int HumdrumFileBase::appendBinaryText(string& output, const string& value,
+		unordered_map<string, int>& table) {
+	auto it = table.find(value);
+	if (it != table.end()) {
+		appendBinaryInt(output, it->second);
+		return it->second;
+	}
+	int index = (int)table.size();
+	table[value] = index;
+	appendBinaryInt(output, index);
+	appendBinaryString(output, value);
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryInt -- Store an integer as a zigzag
+//     variable-length value, so that small positive and negative numbers
+//     use a single byte.
+//
+
+void HumdrumFileBase::appendBinaryInt(string& output, int value) {
+	unsigned int uvalue = ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+	while (uvalue >= 0x80) {
+		output.push_back((char)((uvalue & 0x7f) | 0x80));
+		uvalue >>= 7;
+	}
+	output.push_back((char)uvalue);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryString -- Store a string as its length
+//     followed by its contents.
+//
+
+void HumdrumFileBase::appendBinaryString(string& output, const string& value) {
+	appendBinaryInt(output, (int)value.size());
+	output.append(value);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryNum -- Store a rational number as its
+//     numerator followed by its denominator.
+//
+
+void HumdrumFileBase::appendBinaryNum(string& output, const HumNum& value) {
+	appendBinaryInt(output, value.getNumerator());
+	appendBinaryInt(output, value.getDenominator());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryToken -- Store a token as its offset from
+//     the token at index "base", plus one.  NULL tokens (and tokens which
+//     are not in the file) are stored as 0.  Links between tokens are
+//     mostly to nearby tokens, so the offsets are usually small.
+//
+
+void HumdrumFileBase::appendBinaryToken(string& output, HTp token, int base,
+		const vector<int>& offsets) {
+	int index = getBinaryTokenIndex(token, offsets);
+	if (index < 0) {
+		appendBinaryInt(output, 0);
+		return;
+	}
+	int delta = index - base;
+	appendBinaryInt(output, delta >= 0 ? delta + 1 : delta);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryTokenList -- Store a list of tokens as a
+//     count followed by each token.
+//
+
+void HumdrumFileBase::appendBinaryTokenList(string& output,
+		const vector<HTp>& tokens, int base, const vector<int>& offsets) {
+	appendBinaryInt(output, (int)tokens.size());
+	for (int i=0; i<(int)tokens.size(); i++) {
+		appendBinaryToken(output, tokens[i], base, offsets);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryTokenPairs -- Store a list of strands
+//     or strophes.
+//
+
+void HumdrumFileBase::appendBinaryTokenPairs(string& output,
+		const vector<TokenPair>& pairs, int base, const vector<int>& offsets) {
+	appendBinaryInt(output, (int)pairs.size());
+	for (int i=0; i<(int)pairs.size(); i++) {
+		appendBinaryToken(output, pairs[i].first, base, offsets);
+		appendBinaryToken(output, pairs[i].last, base, offsets);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryInt -- Read an integer stored by
+//     appendBinaryInt().  "ok" is set to false if the data is truncated.
+//
+
+int HumdrumFileBase::extractBinaryInt(const char*& ptr, const char* end, bool& ok) {
+	unsigned int uvalue = 0;
+	int shift = 0;
+	while (ok) {
+		if ((ptr >= end) || (shift > 28)) {
+			ok = false;
+			break;
+		}
+		unsigned char byte = (unsigned char)*ptr++;
+		uvalue |= (unsigned int)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			return (int)(uvalue >> 1) ^ -(int)(uvalue & 1);
+		}
+		shift += 7;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryCount -- Read the size of a list.
+//     "ok" is set to false if the size is negative or larger than the
+//     remaining data (every entry uses at least one byte).
+//
+
+int HumdrumFileBase::extractBinaryCount(const char*& ptr, const char* end, bool& ok) {
+	int count = extractBinaryInt(ptr, end, ok);
+	if (!ok || (count < 0) || (count > end - ptr)) {
+		ok = false;
+		return 0;
+	}
+	return count;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryString -- Read a string stored by
+//     appendBinaryString().
+//
+
+void HumdrumFileBase::extractBinaryString(string& output, const char*& ptr,
+		const char* end, bool& ok) {
+	int length = extractBinaryCount(ptr, end, ok);
+	if (!ok) {
+		return;
+	}
+	output.assign(ptr, length);
+	ptr += length;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryAddress -- Read the address of a token
+//     stored by appendBinaryAddress().
+//
+
+void HumdrumFileBase::extractBinaryAddress(HTp token, const char*& ptr,
+		const char* end, bool& ok, vector<string>& spineinfos) {
+	string spineinfo;
+	extractBinaryText(spineinfo, ptr, end, ok, spineinfos);
+	if (!ok) {
+		return;
+	}
+	token->setSpineInfo(spineinfo);
+	int track = extractBinaryInt(ptr, end, ok);
+	int subtrack = extractBinaryInt(ptr, end, ok);
+	token->setTrack(track, subtrack);
+	token->setSubtrackCount(extractBinaryInt(ptr, end, ok));
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryText -- Read a string stored by
+//     appendBinaryText().  Returns its index in the table.
+//
+
+int HumdrumFileBase::extractBinaryText(string& output, const char*& ptr,
+		const char* end, bool& ok, vector<string>& table) {
+	int index = extractBinaryInt(ptr, end, ok);
+	if (ok && (index == (int)table.size())) {
+		table.resize(table.size() + 1);
+		extractBinaryString(table.back(), ptr, end, ok);
+	} else if ((index < 0) || (index > (int)table.size())) {
+		ok = false;
+	}
+	if (!ok) {
+		return -1;
+	}
+	output = table[index];
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryNum -- Read a rational number stored by
+//     appendBinaryNum().
+//
+
+HumNum HumdrumFileBase::extractBinaryNum(const char*& ptr, const char* end, bool& ok) {
+	int top = extractBinaryInt(ptr, end, ok);
+	int bot = extractBinaryInt(ptr, end, ok);
+	if (!ok || (bot == 0)) {
+		ok = false;
+		return 0;
+	}
+	return HumNum(top, bot);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryToken -- Read a token stored by
+//     appendBinaryToken().
+//
+
+HTp HumdrumFileBase::extractBinaryToken(const char*& ptr, const char* end,
+		bool& ok, int base, const vector<HTp>& tokens) {
+	int value = extractBinaryInt(ptr, end, ok);
+	if (!ok || (value == 0)) {
+		return NULL;
+	}
+	int index = base + (value > 0 ? value - 1 : value);
+	if ((index < 0) || (index >= (int)tokens.size())) {
+		ok = false;
+		return NULL;
+	}
+	return tokens[index];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryTokenList -- Read a list of tokens
+//     stored by appendBinaryTokenList().
+//
+
+void HumdrumFileBase::extractBinaryTokenList(vector<HTp>& output,
+		const char*& ptr, const char* end, bool& ok, int base,
+		const vector<HTp>& tokens) {
+	int count = extractBinaryCount(ptr, end, ok);
+	output.resize(count);
+	for (int i=0; i<count; i++) {
+		output[i] = extractBinaryToken(ptr, end, ok, base, tokens);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryTokenPairs -- Read a list of strands or
+//     strophes stored by appendBinaryTokenPairs().
+//
+
+void HumdrumFileBase::extractBinaryTokenPairs(vector<TokenPair>& output,
+		const char*& ptr, const char* end, bool& ok, int base,
+		const vector<HTp>& tokens) {
+	int count = extractBinaryCount(ptr, end, ok);
+	output.resize(count);
+	for (int i=0; i<count; i++) {
+		output[i].first = extractBinaryToken(ptr, end, ok, base, tokens);
+		output[i].last  = extractBinaryToken(ptr, end, ok, base, tokens);
+	}
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Fri Aug 14 21:57:09 PDT 2015
+// Last Modified: Sun Oct 18 09:34:30 UTC 2026
 // Filename:      HumdrumFileBase.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/HumdrumFileBase.cpp
 // Syntax:        C++11; humlib
@@ -16,13 +16,16 @@
 //
 
 #include "HumdrumFileBase.h"
+#include "CompactNoteGrid.h"
 #include "Convert.h"
+#include "HumMemoryMap.h"
 #include "HumRegex.h"
 
 #include <stdarg.h>
 #include <string.h>
 
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
 using namespace std;
@@ -80,6 +83,7 @@ HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
 	m_strophes1d.clear();
 	m_strophes2d.clear();
 	m_quietParse = infile.m_quietParse;
+	m_arenaQ = infile.m_arenaQ;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
 
@@ -118,6 +122,7 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 	m_strophes1d.clear();
 	m_strophes2d.clear();
 	m_quietParse = infile.m_quietParse;
+	m_arenaQ = infile.m_arenaQ;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
 
@@ -140,6 +145,10 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 
 HumdrumFileBase::~HumdrumFileBase() {
 	clear();
+	if (m_notegrid) {
+		delete m_notegrid;
+		m_notegrid = NULL;
+	}
 }
 
 
@@ -158,6 +167,7 @@ void HumdrumFileBase::clear(void) {
 		}
 	}
 	m_lines.clear();
+	m_arena.clear();
 
 	// clear state variables which are now invalid:
 	m_trackstarts.clear();
@@ -220,6 +230,62 @@ bool HumdrumFileBase::areStrophesAnalyzed(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::areParametersAnalyzed --
+//
+
+bool HumdrumFileBase::areParametersAnalyzed(void) {
+	return m_analyses.m_parameters_analyzed;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::areSignifiersAnalyzed --
+//
+
+bool HumdrumFileBase::areSignifiersAnalyzed(void) {
+	return m_analyses.m_signifiers_analyzed;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getCompactNoteGrid -- Return the note grid for the
+//    **kern spines in the file.  The grid is created on the first call
+//    and then shared by later callers (such as the tools in a filter
+//    chain) until the contents of the file change, at which point it is
+//    reloaded in place on the next call.
+//
+
+CompactNoteGrid& HumdrumFileBase::getCompactNoteGrid(void) {
+	if (!m_notegrid) {
+		m_notegrid = new CompactNoteGrid;
+	}
+	if (!m_analyses.m_notegrid_analyzed) {
+		m_notegrid->load(*this);
+		m_analyses.m_notegrid_analyzed = true;
+	}
+	return *m_notegrid;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::invalidateNoteGrid -- Mark the cached note grid as out
+//    of date.  Called when lines or tokens in the file are changed.
+//
+
+void HumdrumFileBase::invalidateNoteGrid(void) {
+	m_analyses.m_notegrid_analyzed = false;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::setXmlIdPrefix -- Set the prefix for a HumdrumXML ID
@@ -300,6 +366,8 @@ bool HumdrumFileBase::setParseError(const char* format, ...) {
 //////////////////////////////
 //
 // HumdrumFileBase::read -- Load file contents from an input stream or file.
+//    Data stored with writeBinary() is detected and loaded with
+//    readBinary() instead.
 //
 
 bool HumdrumFileBase::read(const string& filename) {
@@ -331,32 +399,42 @@ bool HumdrumFileBase::read(const char* filename) {
 	}
 #endif
 
-	ifstream infile;
 	if (fname.empty() || (fname ==  "-")) {
 		return HumdrumFileBase::read(cin);
-	} else {
-		infile.open(filename);
-		if (!infile.is_open()) {
-			return setParseError("Cannot open file >>%s<< for reading. A", filename);
-		}
 	}
-	HumdrumFileBase::read(infile);
-	infile.close();
-	return isValid();
+	HumMemoryMap infile;
+	if (!infile.open(fname)) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	return readBuffer(infile.getData(), infile.getSize());
 }
 
 
 bool HumdrumFileBase::read(istream& contents) {
+	if (contents.peek() == BINARY_MAGIC[0]) {
+		// Text data cannot start with a null character, so this is
+		// (probably) data stored with writeBinary():
+		string buffer((istreambuf_iterator<char>(contents)),
+				istreambuf_iterator<char>());
+		return readBuffer(buffer.data(), buffer.size());
+	}
 	clear();
 	m_displayError = true;
 	char buffer[123123] = {0};
 	HLp s;
+	HumArena* oldarena = HumArena::getActive();
+	if (m_arenaQ) {
+		HumArena::setActive(&m_arena);
+	}
 	while (contents.getline(buffer, sizeof(buffer), '\n')) {
 		s = new HumdrumLine(buffer);
 		s->setOwner(this);
 		m_lines.push_back(s);
 	}
-	return analyzeBaseFromLines();
+	HumArena::setActive(oldarena);
+	// Tokens were already created by the HumdrumLine constructor,
+	// so do not create them again with analyzeBaseFromLines():
+	return analyzeBaseFromTokens();
 /*
 	if (!analyzeTokens()) { return isValid(); }
 	if (!analyzeLines() ) { return isValid(); }
@@ -369,6 +447,44 @@ bool HumdrumFileBase::read(istream& contents) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::readBuffer -- Read file contents from a block of
+//    memory (such as a memory-mapped file).  Lines are split directly
+//    from the buffer without copying them through a stream.  The
+//    contents do not need to be null-terminated.  Data stored with
+//    writeBinary() is loaded with readBinary() instead.
+//
+
+bool HumdrumFileBase::readBuffer(const char* contents, size_t size) {
+	if (isBinary(contents, size)) {
+		return readBinaryBuffer(contents, size);
+	}
+	clear();
+	m_displayError = true;
+	HLp s;
+	HumArena* oldarena = HumArena::getActive();
+	if (m_arenaQ) {
+		HumArena::setActive(&m_arena);
+	}
+	const char* ptr = contents;
+	const char* end = contents + size;
+	while (ptr < end) {
+		const char* newline = (const char*)memchr(ptr, '\n', end - ptr);
+		if (!newline) {
+			newline = end;
+		}
+		s = new HumdrumLine(ptr, newline - ptr);
+		s->setOwner(this);
+		m_lines.push_back(s);
+		ptr = newline + 1;
+	}
+	HumArena::setActive(oldarena);
+	return analyzeBaseFromTokens();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::readCsv -- Read a Humdrum file in CSV format
@@ -401,12 +517,17 @@ bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
 	m_displayError = true;
 	char buffer[123123] = {0};
 	HLp s;
+	HumArena* oldarena = HumArena::getActive();
+	if (m_arenaQ) {
+		HumArena::setActive(&m_arena);
+	}
 	while (contents.getline(buffer, sizeof(buffer), '\n')) {
 		s = new HumdrumLine;
 		s->setLineFromCsv(buffer);
 		s->setOwner(this);
 		m_lines.push_back(s);
 	}
+	HumArena::setActive(oldarena);
 	return analyzeBaseFromLines();
 }
 
@@ -418,6 +539,7 @@ bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
 //
 
 bool HumdrumFileBase::analyzeBaseFromLines(void)  {
+	invalidateNoteGrid();
 	if (!analyzeTokens()) { return isValid(); }
 	if (!analyzeLines() ) { return isValid(); }
 	if (!analyzeSpines()) { return isValid(); }
@@ -434,6 +556,7 @@ bool HumdrumFileBase::analyzeBaseFromLines(void)  {
 //
 
 bool HumdrumFileBase::analyzeBaseFromTokens(void) {
+	invalidateNoteGrid();
 	// if (!analyzeTokens()) { return isValid(); } // this creates tokens from lines
 	if (!analyzeLines() ) { return isValid(); }
 	if (!analyzeSpines()) { return isValid(); }
@@ -451,17 +574,12 @@ bool HumdrumFileBase::analyzeBaseFromTokens(void) {
 //
 
 bool HumdrumFileBase::readString(const string& contents) {
-	stringstream infile;
-	infile << contents;
-	bool status = read(infile);
-	return status;
+	return readBuffer(contents.data(), contents.size());
 }
 
 
 bool HumdrumFileBase::readString(const char* contents) {
-	stringstream infile;
-	infile << contents;
-	return read(infile);
+	return readBuffer(contents, strlen(contents));
 }
 
 
@@ -529,6 +647,52 @@ void HumdrumFileBase::setQuietParsing(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::setArenaAllocation -- Allocate lines and tokens
+//    from a memory arena owned by the file when reading data, so that
+//    they can be freed in one operation when the file is cleared.
+//    This is useful for large scores where there are many tokens.
+//    Lines and tokens added to the file after reading are allocated
+//    on the heap as usual.  Files read by HumdrumFileStream (and so
+//    by the STREAM_INTERFACE and SET_INTERFACE tools) use the arena.
+// default value: state = true
+// @SEEALSO: getArenaAllocation
+//
+
+void HumdrumFileBase::setArenaAllocation(bool state) {
+	m_arenaQ = state;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getArenaAllocation -- Returns true if lines and
+//    tokens are allocated from an arena when reading data.
+// @SEEALSO: setArenaAllocation
+//
+
+bool HumdrumFileBase::getArenaAllocation(void) const {
+	return m_arenaQ;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getArena -- Return the arena owned by the file.
+//    Lines and tokens which are added to the file while it is the
+//    active arena (such as by HumGrid::transferTokens()) are freed
+//    together when the file is cleared.
+//
+
+HumArena* HumdrumFileBase::getArena(void) {
+	return &m_arena;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::setFilename --
@@ -822,6 +986,21 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::clearDirtyLines -- Mark all lines in the file as
+//   unchanged.  Used to track which lines are edited by a later process
+//   (see HumdrumFileStructure::analyzeDirtyLines()).
+//
+
+void HumdrumFileBase::clearDirtyLines(void) {
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		m_lines[i]->clearDirty();
+	}
+}
+
+
+
 ////////////////////////////
 //
 // HumdrumFileBase::appendLine -- Add a line to the file's contents.  The file's
@@ -829,12 +1008,14 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 //
 
 void HumdrumFileBase::appendLine(const string& line) {
+	invalidateNoteGrid();
 	HLp s = new HumdrumLine(line);
 	m_lines.push_back(s);
 }
 
 
 void HumdrumFileBase::appendLine(HLp line) {
+	invalidateNoteGrid();
 	// deletion will be handled by class.
 	m_lines.push_back(line);
 }
@@ -848,6 +1029,7 @@ void HumdrumFileBase::appendLine(HLp line) {
 //
 
 void HumdrumFileBase::insertLine(int index, const string& line) {
+	invalidateNoteGrid();
 	HLp s = new HumdrumLine(line);
 	m_lines.insert(m_lines.begin() + index, s);
 
@@ -859,6 +1041,7 @@ void HumdrumFileBase::insertLine(int index, const string& line) {
 
 
 void HumdrumFileBase::insertLine(int index, HLp line) {
+	invalidateNoteGrid();
 	// deletion will be handled by class.
 	m_lines.insert(m_lines.begin() + index, line);
 
@@ -885,6 +1068,7 @@ void HumdrumFileBase::deleteLine(int index) {
 	if (index < 0) {
 		return;
 	}
+	invalidateNoteGrid();
 	delete m_lines[index];
 	for (int i=index+1; i<(int)m_lines.size(); i++) {
 		m_lines[i-1] = m_lines[i];
@@ -2282,6 +2466,7 @@ void HumdrumFileBase::fixMerges(int linei) {
 	// the line type for the new line.
 
 	// add the new line to the file:
+	invalidateNoteGrid();
 	m_lines.insert(m_lines.begin() + linei + 1, newline);
 
 }
@@ -103,7 +103,7 @@ bool HumdrumFileContent::analyzeMensSlurs(void) {
 	vector<HTp> mensspines;
 	getSpineStartList(mensspines, "**mens");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	for (int i=0; i<(int)mensspines.size(); i++) {
 		output = output && analyzeKernSlurs(mensspines[i], slurstarts, slurends, labels, endings, linkSignifier);
 	}
@@ -174,7 +174,7 @@ bool HumdrumFileContent::analyzeKernSlurs(void) {
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	for (int i=0; i<(int)kernspines.size(); i++) {
 		output = output && analyzeKernSlurs(kernspines[i], slurstarts, slurends, labels, endings, linkSignifier);
 	}
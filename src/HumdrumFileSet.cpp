@@ -171,10 +171,8 @@ int HumdrumFileSet::read(HumdrumFileStream& instream) {
 //
 
 int HumdrumFileSet::readAppendFile(const string& filename) {
-	ifstream indata;
-	indata.open(filename);
-	string contents((istreambuf_iterator<char>(indata)), istreambuf_iterator<char>());
-	HumdrumFileStream instream(contents);
+	HumdrumFileStream instream;
+	instream.loadFile(filename);
 	return readAppend(instream);
 }
 
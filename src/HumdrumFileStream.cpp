@@ -18,10 +18,13 @@
 #include "HumdrumFileSet.h"
 #include "HumRegex.h"
 
+#include <atomic>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -76,6 +79,7 @@ void HumdrumFileStream::clear(void) {
 	m_newfilebuffer.resize(0);
 	// m_stringbuffer.clear(0);
 	m_stringbuffer.str("");
+	m_mapfile.close();
 }
 
 
@@ -116,6 +120,23 @@ void HumdrumFileStream::loadString(const string& data) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::loadFile -- Read segments from the given file
+//    (memory-mapped when possible) rather than from a list of files or
+//    standard input.  Segments are not given the filename unless
+//    it is set by a !!!!SEGMENT: record.  Returns false if the file
+//    cannot be opened.
+//
+
+int HumdrumFileStream::loadFile(const string& filename) {
+	m_curfile = 0;
+	m_filelist.clear();
+	return m_mapfile.open(filename);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::read -- alias for getFile.
@@ -139,6 +160,55 @@ int HumdrumFileStream::read(HumdrumFileSet& infiles) {
 
 
 
+//
+// Multi-threaded version: the segments are extracted from the input
+// in sequence, then parsed by a pool of threads.  The files are stored
+// in infiles in input order.
+//
+
+int HumdrumFileStream::read(HumdrumFileSet& infiles, int threads) {
+	if (threads <= 1) {
+		return read(infiles);
+	}
+	infiles.clear();
+	vector<string> contents;
+	vector<string> filenames;
+	string text;
+	string filename;
+	while (getSegment(text, filename)) {
+		contents.push_back(text);
+		filenames.push_back(filename);
+	}
+
+	vector<HumdrumFile*> files(contents.size(), NULL);
+	std::atomic<int> next(0);
+	auto parser = [&]() {
+		while (true) {
+			int index = next++;
+			if (index >= (int)files.size()) {
+				break;
+			}
+			files[index] = new HumdrumFile;
+			parseSegment(*files[index], contents[index], filenames[index]);
+			contents[index].clear();
+		}
+	};
+	vector<std::thread> pool;
+	for (int i=0; i<threads; i++) {
+		pool.emplace_back(parser);
+	}
+	for (int i=0; i<(int)pool.size(); i++) {
+		pool[i].join();
+	}
+
+	for (int i=0; i<(int)files.size(); i++) {
+		infiles.appendHumdrumPointer(files[i]);
+	}
+	return 0;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::readSingleSegment -- Get a single file for a set structure.
@@ -172,8 +242,8 @@ int HumdrumFileStream::eof(void) {
 	// (2) Next filename if ifstream is done
 	// (3) cin if no ifstream open and no filenames
 
-	// (1) Is an ifstream open?, then yes, there is more data to read.
-	if (m_instream.is_open() && !m_instream.eof()) {
+	// (1) Is a file open?, then yes, there is more data to read.
+	if (m_mapfile.isOpen() && !m_mapfile.eof()) {
 		return 0;
 	}
 
@@ -213,11 +283,60 @@ int HumdrumFileStream::eof(void) {
 
 int HumdrumFileStream::getFile(HumdrumFile& infile) {
 	infile.clear();
+	string contents;
+	string filename;
+	if (!getSegment(contents, filename)) {
+		return 0;
+	}
+	parseSegment(infile, contents, filename);
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::parseSegment -- Parse the text of a segment
+//    extracted with getSegment() into a HumdrumFile.  This function
+//    does not access the stream, so segments can be parsed in parallel
+//    by separate threads.  The lines and tokens of the file are
+//    allocated from the file's arena, since stream files are read
+//    once and then discarded as a whole.
+//
+
+void HumdrumFileStream::parseSegment(HumdrumFile& infile,
+		const string& contents, const string& filename) {
+	infile.setArenaAllocation(true);
+	infile.readStringNoRhythm(contents);
+	if (!filename.empty()) {
+		infile.setFilename(filename);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegment -- Extract the text content of the
+//    next HumdrumFile from the input stream or next input file in the
+//    list, without parsing it.  Universal comments are demoted to global
+//    comments at the start of the content.  The filename is set from
+//    the input filename or a !!!!SEGMENT: record.  Returns true if
+//    content was extracted, fails if there is no more HumdrumFiles in
+//    the input stream.
+//
+
+int HumdrumFileStream::getSegment(string& contents, string& filename) {
+	contents.clear();
+	filename.clear();
 	istream* newinput = NULL;
+	// mapQ: true if reading lines from m_mapfile rather than newinput.
+	bool mapQ = false;
 
 restarting:
 
 	newinput = NULL;
+	mapQ = false;
 
 	if (m_urlbuffer.eof()) {
 		// If the URL buffer is at its end, clear the buffer.
@@ -235,9 +354,10 @@ restarting:
 		newinput = &m_stringbuffer;
 	}
 
-	// (2) Is an ifstream open?
-	else if (m_instream.is_open() && !m_instream.eof()) {
-		newinput = &m_instream;
+	// (2) Is a file open?
+	else if (m_mapfile.isOpen() && !m_mapfile.eof()) {
+		m_mapfile.discardRead();
+		mapQ = true;
 	}
 
 	// (2b) Is the URL data buffer open?
@@ -251,28 +371,31 @@ restarting:
 	else if (((int)m_filelist.size() > 0) &&
 			(m_curfile < (int)m_filelist.size()-1)) {
 		m_curfile++;
-		if (m_instream.is_open()) {
-			m_instream.close();
-		}
+		m_mapfile.close();
 		if (strstr(m_filelist[m_curfile].c_str(), "://") != NULL) {
 			// The next file to read is a URL/URI, so buffer the
 			// data from the internet and start reading that instead
 			// of reading from a file on the hard disk.
 			fillUrlBuffer(m_urlbuffer, m_filelist[m_curfile].c_str());
-			infile.setFilename(m_filelist[m_curfile].c_str());
+			filename = m_filelist[m_curfile];
 			goto restarting;
 		}
-		m_instream.open(m_filelist[m_curfile].c_str());
-		infile.setFilename(m_filelist[m_curfile].c_str());
-		if (!m_instream.is_open()) {
+		filename = m_filelist[m_curfile];
+		if (!m_mapfile.open(m_filelist[m_curfile])) {
 			// file does not exist or cannot be opened close
 			// the file and try luck with next file in the list
 			// (perhaps given an error or warning?).
-			infile.setFilename("");
-			m_instream.close();
+			filename.clear();
 			goto restarting;
 		}
-		newinput = &m_instream;
+		if (HumdrumFileBase::isBinary(m_mapfile.getData(), m_mapfile.getSize())) {
+			// Files stored with HumdrumFileBase::writeBinary() are not
+			// split into segments, so pass the whole file to the parser.
+			contents.assign(m_mapfile.getData(), m_mapfile.getSize());
+			m_mapfile.close();
+			return 1;
+		}
+		mapQ = true;
 	} else {
 		// no input fstream open and no list of files to process, so
 		// start (or continue) reading from standard input.
@@ -292,26 +415,30 @@ restarting:
 		HumRegex hre;
 		if (hre.search(m_newfilebuffer,
 				R"(^!!!!SEGMENT\s*([+-]?\d+)?\s*:\s*(.*)\s*$)")) {
-			if (hre.getMatchLength(1) > 0) {
-				infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-			} else {
-				infile.setSegmentLevel(0);
-			}
-			infile.setFilename(hre.getMatch(2));
+			filename = hre.getMatch(2);
 		} else if ((m_curfile >=0) && (m_curfile < (int)m_filelist.size())
 				&& (m_filelist.size() > 0)) {
-			infile.setFilename(m_filelist[m_curfile].c_str());
+			filename = m_filelist[m_curfile];
 		} else {
 			// reading from standard input, but no name.
 		}
 	}
 
-	if (newinput == NULL) {
+	if ((newinput == NULL) && !mapQ) {
 		// something strange happened, or no more files to read.
 		return 0;
 	}
 
-	stringstream buffer;
+	if ((newinput == &cin) && (m_newfilebuffer.empty()) &&
+			(cin.peek() == '\0')) {
+		// Data stored with HumdrumFileBase::writeBinary() starts with a
+		// null character.  It is not split into segments, so pass all
+		// of standard input to the parser.
+		contents.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+		return 1;
+	}
+
+	string buffer;
 	int foundUniversalQ = 0;
 
 	// Start reading the input stream.  If !!!!SEGMENT: universal comment
@@ -327,9 +454,15 @@ restarting:
 	if (m_newfilebuffer.size() < 4) {
 		//searchName = 1;
 	}
-	char templine[123123] = {0};
+	string templine;
 
-	if (newinput->eof()) {
+	// Lines of files are split directly from their contents (see
+	// HumMemoryMap::getLine()), and otherwise read from newinput:
+	auto atEnd = [&](void) {
+		return mapQ ? m_mapfile.eof() : newinput->eof();
+	};
+
+	if (atEnd()) {
 		if (m_curfile < (int)m_filelist.size()-1) {
 			m_curfile++;
 			goto restarting;
@@ -338,36 +471,32 @@ restarting:
 		return 0;
 	}
 
-	istream& input = *newinput;
-
 	// if the previous line from the last read starts with "**"
 	// then treat it as part of the current file.
 	if ((m_newfilebuffer.size() > 1) &&
 		 (strncmp(m_newfilebuffer.c_str(), "**", 2)) == 0) {
-		buffer << m_newfilebuffer << "\n";
+		buffer += m_newfilebuffer;
+		buffer += "\n";
 		m_newfilebuffer = "";
 		starstarFoundQ = 1;
 	}
 
-	while (!input.eof()) {
-		input.getline(templine, 123123, '\n');
+	while (!atEnd()) {
+		if (mapQ) {
+			m_mapfile.getLine(templine);
+		} else {
+			getline(*newinput, templine, '\n');
+		}
 		if ((!dataFoundQ) &&
-				(strncmp(templine, "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0)) {
-			string tempstring;
-			tempstring = templine;
+				(templine.compare(0, strlen("!!!!SEGMENT"), "!!!!SEGMENT") == 0)) {
 			HumRegex hre;
-			if (hre.search(tempstring,
+			if (hre.search(templine,
 					"^!!!!SEGMENT\\s*([+-]?\\d+)?\\s*:\\s*(.*)\\s*$")) {
-				if (hre.getMatchLength(1) > 0) {
-					infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-				} else {
-					infile.setSegmentLevel(0);
-				}
-				infile.setFilename(hre.getMatch(2));
+				filename = hre.getMatch(2);
 			}
 		}
 
-		if (strncmp(templine, "**", 2) == 0) {
+		if (templine.compare(0, 2, "**") == 0) {
 			if (starstarFoundQ == 1) {
 				m_newfilebuffer = templine;
 				// already found a **, so this one is defined as a file
@@ -379,7 +508,7 @@ restarting:
 			starstarFoundQ = 1;
 		}
 
-		if (input.eof() && (strcmp(templine, "") == 0)) {
+		if (atEnd() && templine.empty()) {
 			// No more data coming from current stream, so this is
 			// the end of the HumdrumFile.  Break from the while loop
 			// and then store the read contents of the stream in the
@@ -391,7 +520,7 @@ restarting:
 		// (1a) this is the name of the current file to process if no
 		// data has yet been found,
 		// (1b) or a name is being actively searched for.
-		if (strncmp(templine, "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0) {
+		if (templine.compare(0, strlen("!!!!SEGMENT"), "!!!!SEGMENT") == 0) {
 			m_newfilebuffer = templine;
 			if (dataFoundQ) {
 				// this new filename is for the next chunk to process in the
@@ -406,21 +535,16 @@ restarting:
 				HumRegex hre;
 				if (hre.search(m_newfilebuffer,
 						R"(^!!!!SEGMENT\s*([+-]?\d+)?\s:\s*(.*)\s*$)")) {
-					if (hre.getMatchLength(1) > 0) {
-						infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-					} else {
-						infile.setSegmentLevel(0);
-					}
-					infile.setFilename(hre.getMatch(2));
+					filename = hre.getMatch(2);
 				}
 			}
 		}
-		int len = (int)strlen(templine);
-		if ((len > 4) && (strncmp(templine, "!!!!", 4) == 0) &&
+		int len = (int)templine.size();
+		if ((len > 4) && (templine.compare(0, 4, "!!!!") == 0) &&
 				(templine[4] != '!') &&
 				(dataFoundQ == 0) &&
-				(strncmp(templine, "!!!!filter:", strlen("!!!!filter:")) != 0) &&
-				(strncmp(templine, "!!!!SEGMENT:", strlen("!!!!SEGMENT:")) != 0)) {
+				(templine.compare(0, strlen("!!!!filter:"), "!!!!filter:") != 0) &&
+				(templine.compare(0, strlen("!!!!SEGMENT:"), "!!!!SEGMENT:") != 0)) {
 			// This is a universal comment.  Should it be appended
 			// to the list or should the current list be erased and
 			// this record placed into the first entry?
@@ -438,7 +562,7 @@ restarting:
 			continue;
 		}
 
-		if (strncmp(templine, "*-", 2) == 0) {
+		if (templine.compare(0, 2, "*-") == 0) {
 			starminusFoundQ = 1;
 		}
 
@@ -452,7 +576,7 @@ restarting:
 				// so that infinite loops are prevented.
 				int found = 0;
 				for (int mm=0; mm<(int)m_filelist.size(); mm++) {
-					if (strcmp(m_filelist[mm].c_str(), templine) == 0) {
+					if (m_filelist[mm] == templine) {
 						found = 1;
 					}
 				}
@@ -468,7 +592,8 @@ restarting:
 		// should empty lines be treated somewhat as universal comments?
 
 		// store the data line for later parsing into HumdrumFile record:
-		buffer << templine << "\n";
+		buffer += templine;
+		buffer += "\n";
 	}
 
 	if (dataFoundQ == 0) {
@@ -485,22 +610,19 @@ restarting:
 	// Universal comments (demoted into Global comments) at the start
 	// of the data stream (maybe allow for postpending Universal comments
 	// in the future).
-	stringstream contents;
-	contents.str(""); // empty any contents in buffer
-	contents.clear(); // reset error flags in buffer
-
 	for (int i=0; i<(int)m_universals.size(); i++) {
 		// Convert universals reference records to globals, but do not demote !!!!filter:
 		if (m_universals[i].compare(0, 11, "!!!!filter:") == 0) {
 			continue;
 		}
-		contents << &(m_universals[i][1]) << "\n";
+		contents += &(m_universals[i][1]);
+		contents += "\n";
 	}
-	contents << buffer.str();
-	string filename = infile.getFilename();
-	infile.readNoRhythm(contents);
-	if (!filename.empty()) {
-		infile.setFilename(filename);
+	if (contents.empty()) {
+		// No universal comments, so avoid copying the segment.
+		contents.swap(buffer);
+	} else {
+		contents += buffer;
 	}
 	return 1;
 }
@@ -97,7 +97,8 @@ void HumdrumFileStructure::analyzeStropheMarkers(void) {
 
 bool HumdrumFileStructure::analyzeStrophes(void) {
 	if (!m_analyses.m_strands_analyzed) {
-		analyzeStrands();
+		// strophes are analyzed at the end of analyzeStrands():
+		return analyzeStrands();
 	}
 	analyzeStropheMarkers();
 
@@ -189,11 +190,17 @@ bool HumdrumFileStructure::analyzeStrophes(void) {
 //
 
 int HumdrumFileStructure::getStropheCount(void) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 	return (int)m_strophes1d.size();
 }
 
 
 int HumdrumFileStructure::getStropheCount(int spineindex) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 	if ((spineindex < 0) || (spineindex >= (int)m_strophes2d.size())) {
 		return 0;
 	}
@@ -208,13 +215,19 @@ int HumdrumFileStructure::getStropheCount(int spineindex) {
 //
 
 HTp HumdrumFileStructure::getStropheStart(int index) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 	if ((index < 0) || (index >= (int)m_strophes1d.size())) {
 		return NULL;
 	}
 	return m_strophes1d.at(index).first;
 }
 
-HTp HumdrumFileStructure::getStropheStart(int spine, int index) { 
+HTp HumdrumFileStructure::getStropheStart(int spine, int index) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 		if ((spine < 0) || (index < 0)) {
 			return NULL;
 		}
@@ -235,6 +248,9 @@ HTp HumdrumFileStructure::getStropheStart(int spine, int index) {
 //
 
 HTp HumdrumFileStructure::getStropheEnd(int index) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 	if ((index < 0) || (index >= (int)m_strophes1d.size())) {
 		return NULL;
 	}
@@ -243,6 +259,9 @@ HTp HumdrumFileStructure::getStropheEnd(int index) {
 
 
 HTp HumdrumFileStructure::getStropheEnd(int spine, int index) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 		if ((spine < 0) || (index < 0)) {
 			return NULL;
 		}
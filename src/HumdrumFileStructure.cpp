@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Aug 17 02:39:28 PDT 2015
-// Last Modified: Mon Aug 17 02:39:32 PDT 2015
+// Last Modified: Sun Oct 18 10:55:15 UTC 2026
 // Filename:      HumdrumFileStructure.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/HumdrumFileStructure.cpp
 // Syntax:        C++11; humlib
@@ -66,7 +66,8 @@ HumdrumFileStructure::~HumdrumFileStructure() {
 //
 // HumdrumFileStructure::read --  Read the contents of a file from a file or
 //   istream.  The file's structure is analyzed, and then the rhythmic structure
-//   is calculated.
+//   is calculated.  Files stored with writeBinary() already contain the
+//   analysis, so they are not analyzed again.
 //
 
 
@@ -75,6 +76,10 @@ bool HumdrumFileStructure::read(istream& contents) {
 	if (!readNoRhythm(contents)) {
 		return isValid();
 	}
+	if (isRhythmAnalyzed()) {
+		// file was stored with writeBinary(), so already analyzed
+		return isValid();
+	}
 	return analyzeStructure();
 }
 
@@ -84,6 +89,10 @@ bool HumdrumFileStructure::read(const char* filename) {
 	if (!readNoRhythm(filename)) {
 		return isValid();
 	}
+	if (isRhythmAnalyzed()) {
+		// file was stored with writeBinary(), so already analyzed
+		return isValid();
+	}
 	return analyzeStructure();
 }
 
@@ -93,6 +102,10 @@ bool HumdrumFileStructure::read(const string& filename) {
 	if (!readNoRhythm(filename)) {
 		return isValid();
 	}
+	if (isRhythmAnalyzed()) {
+		// file was stored with writeBinary(), so already analyzed
+		return isValid();
+	}
 	return analyzeStructure();
 }
 
@@ -149,6 +162,10 @@ bool HumdrumFileStructure::readString(const char* contents) {
 	if (!HumdrumFileBase::readString(contents)) {
 		return isValid();
 	}
+	if (isRhythmAnalyzed()) {
+		// data was stored with writeBinary(), so already analyzed
+		return isValid();
+	}
 	return analyzeStructure();
 }
 
@@ -158,6 +175,10 @@ bool HumdrumFileStructure::readString(const string& contents) {
 	if (!HumdrumFileBase::readString(contents)) {
 		return isValid();
 	}
+	if (isRhythmAnalyzed()) {
+		// data was stored with writeBinary(), so already analyzed
+		return isValid();
+	}
 	return analyzeStructure();
 }
 
@@ -193,22 +214,17 @@ bool HumdrumFileStructure::readStringCsv(const string& contents,
 
 //////////////////////////////
 //
-// HumdrumFileStructure::analyzeStructure -- Analyze global/local
-//    parameters and rhythmic structure.
+// HumdrumFileStructure::analyzeStructure -- Analyze token durations
+//    and rhythmic structure.  Spine strands, layout parameters and
+//    signifiers are analyzed on demand when first accessed.
 //
 
 bool HumdrumFileStructure::analyzeStructure(void) {
 	m_analyses.m_structure_analyzed = false;
-	if (!m_analyses.m_strands_analyzed) {
-		if (!analyzeStrands()       ) { return isValid(); }
-	}
-	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
-	if (!analyzeTokenDurations()   ) { return isValid(); }
+	m_analyses.m_parameters_analyzed = false;
 	if (!analyzeTokenDurations()   ) { return isValid(); }
 	m_analyses.m_structure_analyzed = true;
 	if (!analyzeRhythmStructure()  ) { return isValid(); }
-	analyzeSignifiers();
 	return isValid();
 }
 
@@ -216,19 +232,123 @@ bool HumdrumFileStructure::analyzeStructure(void) {
 
 //////////////////////////////
 //
-// HumdrumFileStructure::analyzeStructureNoRhythm -- Analyze global/local
-//    parameters but not rhythmic structure.
+// HumdrumFileStructure::analyzeStructureNoRhythm -- Analyze token
+//    durations but not rhythmic structure.
 //
 
 bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 	m_analyses.m_structure_analyzed = true;
-	if (!m_analyses.m_strands_analyzed) {
-		if (!analyzeStrands()          ) { return isValid(); }
-	}
-	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
+	m_analyses.m_parameters_analyzed = false;
 	if (!analyzeTokenDurations()   ) { return isValid(); }
-	analyzeSignifiers();
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeFromTokens -- Analyze a file whose lines
+//    were built token by token (such as by HumGrid::transferTokens())
+//    rather than read from text.  The text of each line is generated from
+//    its tokens, and the spine structure is rebuilt from the spine
+//    manipulators on the existing tokens.  If any line already has a
+//    start time, the start times of the data lines and the durations of
+//    the notes set when the lines were built are used rather than
+//    parsing the durations and following each track to calculate them
+//    (see analyzeStructureFromTimes()).  Otherwise the same structure
+//    analysis as for a file read from text is done.  The tokens must not
+//    have been analyzed already (their spine links would be added a
+//    second time), so after an analyzed file is edited use
+//    analyzeDirtyLines() or read it again.  The gridtransfer test program
+//    (tests/test-gridtransfer) compares the result and time of this with
+//    printing and reading the text.
+//
+
+bool HumdrumFileStructure::analyzeFromTokens(void) {
+	m_displayError = true;
+	m_analyses.clear();
+	bool timed = false;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HLp line = m_lines[i];
+		line->setOwner(static_cast<HumdrumFileBase*>(this));
+		line->createLineFromTokens();
+		if (line->m_tokens.empty()) {
+			// Empty line: use the same tokens as when reading text.
+			line->createTokensFromLine();
+		}
+		for (int j=0; j<(int)line->m_tokens.size(); j++) {
+			if (line->m_tokens[j]) {
+				line->m_tokens[j]->setOwner(line);
+			}
+		}
+		if (line->m_durationFromStart.isNonNegative()) {
+			timed = true;
+		}
+	}
+	if (!analyzeBaseFromTokens()) {
+		return isValid();
+	}
+	HTp firstspine = getSpineStart(0);
+	if ((!timed) || (firstspine && firstspine->isDataType("**recip"))) {
+		return analyzeStructure();
+	}
+	return analyzeStructureFromTimes();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeStructureFromTimes -- Analyze token
+//    durations and rhythmic structure for analyzeFromTokens() when the
+//    start times of the data lines and the durations of the notes on
+//    them are already known.  Only tokens without a duration are parsed,
+//    and the end of the data is the latest end of a note, so the tracks
+//    do not have to be followed to add up the durations.  Lines of null
+//    tokens and non-data lines are given start times in the same way as
+//    in analyzeRhythm().
+//
+
+bool HumdrumFileStructure::analyzeStructureFromTimes(void) {
+	m_analyses.m_structure_analyzed = true;
+	m_analyses.m_parameters_analyzed = false;
+	m_analyses.m_rhythm_analyzed = true;
+	setLineRhythmAnalyzed();
+	if (getMaxTrack() == 0) {
+		return isValid();
+	}
+
+	HumNum enddur = 0;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (!line.hasSpines()) {
+			continue;
+		}
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			HTp token = line.m_tokens[j];
+			if (!token->m_rhythm_analyzed) {
+				token->analyzeDuration();
+			}
+			if (line.m_durationFromStart.isNonNegative()
+					&& token->m_duration.isPositive()
+					&& (line.m_durationFromStart + token->m_duration > enddur)) {
+				enddur = line.m_durationFromStart + token->m_duration;
+			}
+		}
+		if (line.isData() && line.isAllRhythmicNull()) {
+			// Start time to be interpolated by analyzeNullLineRhythms().
+			line.m_durationFromStart = -1;
+		} else if (line.isTerminator()) {
+			line.m_durationFromStart = enddur;
+		}
+	}
+
+	if (!analyzeNullLineRhythms()) { return isValid(); }
+	fillInNegativeStartTimes();
+	assignLineDurations();
+	if (!analyzeMeter()) { return isValid(); }
+	if (!analyzeNonNullDataTokens()) { return isValid(); }
+	if (!analyzeDurationsOfNonRhythmicSpines()) { return isValid(); }
 	return isValid();
 }
 
@@ -236,7 +356,8 @@ bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 
 /////////////////////////////
 //
-// HumdrumFileStructure::analyzeRhythmStructure --
+// HumdrumFileStructure::analyzeRhythmStructure -- An overflow in the
+//    HumNum calculations (see HumNum::hasOverflow()) is a parse error.
 //
 
 bool HumdrumFileStructure::analyzeRhythmStructure(void) {
@@ -246,6 +367,7 @@ bool HumdrumFileStructure::analyzeRhythmStructure(void) {
 		if (!analyzeStructureNoRhythm()) { return isValid(); }
 	}
 
+	HumNum::clearOverflow();
 	HTp firstspine = getSpineStart(0);
 	if (firstspine && firstspine->isDataType("**recip")) {
 		assignRhythmFromRecip(firstspine);
@@ -253,11 +375,165 @@ bool HumdrumFileStructure::analyzeRhythmStructure(void) {
 		if (!analyzeRhythm()           ) { return isValid(); }
 		if (!analyzeDurationsOfNonRhythmicSpines()) { return isValid(); }
 	}
+	if (HumNum::hasOverflow()) {
+		return setParseError("Error: durations too large to be calculated exactly");
+	}
 	return isValid();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeDirtyLines -- Update the analyses of the
+//    file after its tokens have been edited in place, without parsing
+//    the file again.  linecount is the number of lines in the file before
+//    editing started (at the time of the last call to clearDirtyLines()).
+//    Lines after linecount must be global comments or reference records
+//    appended to the end of the file.  Returns false if the edits change
+//    the spine or rhythmic structure of the file (or otherwise cannot be
+//    checked); in that case the file should be parsed again from its text.
+//
+
+bool HumdrumFileStructure::analyzeDirtyLines(int linecount) {
+	if ((linecount <= 0) || (linecount > getLineCount())) {
+		return false;
+	}
+	void* owner = static_cast<HumdrumFileBase*>(this);
+
+	for (int i=0; i<linecount; i++) {
+		HumdrumLine& line = *m_lines[i];
+		if ((line.m_owner != owner) || (line.getLineIndex() != i)) {
+			return false;
+		}
+		if (line.isDirty() && !isAnalysisPreserved(line)) {
+			return false;
+		}
+	}
+	for (int i=linecount; i<getLineCount(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (line.m_owner != NULL) {
+			return false;
+		}
+		if (line.hasSpines() || (line.compare(0, 5, "!!LO:") == 0)) {
+			return false;
+		}
+	}
+
+	// Attach the appended lines to the file:
+	for (int i=linecount; i<getLineCount(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		HumdrumLine& previous = *m_lines[i-1];
+		line.setOwner(this);
+		line.setLineIndex(i);
+		if (line.getTokenCount() == 0) {
+			line.createTokensFromLine();
+		}
+		line.token(0)->setFieldIndex(0);
+		line.setDuration(0);
+		line.setDurationFromStart(previous.m_durationFromStart
+				+ previous.m_duration);
+		line.setDurationFromBarline(previous.m_durationFromBarline
+				+ previous.m_duration);
+		line.setDurationToBarline(previous.m_durationToBarline
+				- previous.m_duration);
+		line.m_rhythm_analyzed = previous.m_rhythm_analyzed;
+		if (line.isReference()) {
+			m_analyses.m_signifiers_analyzed = false;
+		}
+	}
+
+	clearDirtyLines();
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::isAnalysisPreserved -- Returns true if the edits
+//    to a data line do not change the analyses done when the file was
+//    read: the spine structure, durations, null tokens, ties, slurs,
+//    phrases and pitches of each token must be the same as in the
+//    original text of the line.  Edited **kern and **recip tokens must
+//    not have been empty, and the duration of their new text must be
+//    the same as the analyzed duration.
+//
+
+bool HumdrumFileStructure::isAnalysisPreserved(HumdrumLine& line) {
+	const string& clean = line.getCleanText();
+	if (clean.empty() || (clean[0] == '*') || (clean[0] == '!') ||
+			(clean[0] == '=')) {
+		return false;
+	}
+	if (!line.isData()) {
+		return false;
+	}
+
+	// Characters in **kern and **recip tokens that must not change:
+	static const char* fixed = "0123456789.%qQr()[]{}_& abcdefgABCDEFG#-n";
+
+	int j = 0;
+	size_t start = 0;
+	while (start <= clean.size()) {
+		size_t end = clean.find('\t', start);
+		if (end == string::npos) {
+			end = clean.size();
+		}
+		if (j >= line.getTokenCount()) {
+			return false;
+		}
+		HTp token = line.token(j);
+		if ((token->getOwner() != &line) || (token->getFieldIndex() != j)) {
+			return false;
+		}
+		if (token->compare(0, string::npos, clean, start, end - start) != 0) {
+			bool wasnull = (end - start == 1) && (clean[start] == '.');
+			if (wasnull != token->isNull()) {
+				return false;
+			}
+			if (token->isMens()) {
+				return false;
+			}
+			if (token->isKern() || token->isDataType("**recip")) {
+				if ((start == end) || !token->m_rhythm_analyzed) {
+					// An empty field or an unanalyzed token has no rhythm
+					// which can be compared.
+					return false;
+				}
+				// The duration parsed from the new text must be the same
+				// as the one analyzed from the original text:
+				HumNum duration = token->getDuration();
+				token->analyzeDuration();
+				if (token->m_duration != duration) {
+					token->m_duration = duration;
+					return false;
+				}
+				string oldfixed;
+				string newfixed;
+				for (size_t k=start; k<end; k++) {
+					if (strchr(fixed, clean[k])) {
+						oldfixed.push_back(clean[k]);
+					}
+				}
+				for (size_t k=0; k<token->size(); k++) {
+					if (strchr(fixed, token->at(k))) {
+						newfixed.push_back(token->at(k));
+					}
+				}
+				if (oldfixed != newfixed) {
+					return false;
+				}
+			}
+		}
+		j++;
+		start = end + 1;
+	}
+	return j == line.getTokenCount();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::assignRhythmFromRecip --
@@ -721,6 +997,26 @@ bool HumdrumFileStructure::analyzeTokenDurations (void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeParameters -- Link global and local
+//    layout parameters to the tokens which they apply to.  This is
+//    done automatically the first time that parameters are requested
+//    from a token (such as with HumdrumToken::getLayoutParameter).
+//
+
+bool HumdrumFileStructure::analyzeParameters(void) {
+	if (m_analyses.m_parameters_analyzed) {
+		return isValid();
+	}
+	m_analyses.m_parameters_analyzed = true;
+	if (!analyzeGlobalParameters() ) { return isValid(); }
+	if (!analyzeLocalParameters()  ) { return isValid(); }
+	return isValid();
+}
+
+
+
 ///////////////////////////////
 //
 // HumdrumFileStructure::analyzeGlobalParameters -- only allowing layout
@@ -1430,8 +1726,6 @@ bool HumdrumFileStructure::analyzeStrands(void) {
 
 	resolveNullTokens();
 
-	analyzeLocalParameters();
-
 	analyzeStrophes();
 
 	return isValid();
@@ -1675,10 +1969,13 @@ bool HumdrumFileStructure::hasUniversalFilters(void) {
 
 //////////////////////////////
 //
-// HumdrumFileStructure::analyzeSignifiers --
+// HumdrumFileStructure::analyzeSignifiers -- Store !!!RDF records.  This
+//    is done automatically when a signifier is first requested.
 //
 
 void HumdrumFileStructure::analyzeSignifiers(void) {
+	m_analyses.m_signifiers_analyzed = true;
+	m_signifiers.clear();
 	HumdrumFileStructure& infile = *this;
 	for (int i=0; i<getLineCount(); i++) {
 		if (!infile[i].isSignifier()) {
@@ -1697,6 +1994,9 @@ void HumdrumFileStructure::analyzeSignifiers(void) {
 //
 
 std::string HumdrumFileStructure::getKernLinkSignifier(void) {
+	if (!m_analyses.m_signifiers_analyzed) {
+		analyzeSignifiers();
+	}
 	return m_signifiers.getKernLinkSignifier();
 }
 
@@ -1710,6 +2010,9 @@ std::string HumdrumFileStructure::getKernLinkSignifier(void) {
 //
 
 std::string HumdrumFileStructure::getKernAboveSignifier(void) {
+	if (!m_analyses.m_signifiers_analyzed) {
+		analyzeSignifiers();
+	}
 	return m_signifiers.getKernAboveSignifier();
 }
 
@@ -1723,6 +2026,9 @@ std::string HumdrumFileStructure::getKernAboveSignifier(void) {
 //
 
 std::string HumdrumFileStructure::getKernBelowSignifier(void) {
+	if (!m_analyses.m_signifiers_analyzed) {
+		analyzeSignifiers();
+	}
 	return m_signifiers.getKernBelowSignifier();
 }
 
@@ -62,6 +62,19 @@ HumdrumLine::HumdrumLine(const char* aString) : string(aString) {
 }
 
 
+HumdrumLine::HumdrumLine(const char* aString, size_t length) :
+		string(aString, length) {
+	m_owner = NULL;
+	if ((this->size() > 0) && (this->back() == 0x0d)) {
+		this->resize(this->size() - 1);
+	}
+	m_duration = -1;
+	m_durationFromStart = -1;
+	setPrefix("!!");
+	createTokensFromLine();
+}
+
+
 HumdrumLine::HumdrumLine(HumdrumLine& line)  : string((string)line) {
 	m_lineindex           = line.m_lineindex;
 	m_duration            = line.m_duration;
@@ -225,6 +238,39 @@ string HumdrumLine::getText(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::setDirty -- Mark the line as changed.  The text of the
+//    line before the first change is kept (see getCleanText()), so that
+//    the owning file can check which analyses need to be updated.  Any
+//    note grid cached by the owning file is invalidated.
+//
+
+void HumdrumLine::setDirty(void) {
+	if (!m_dirty) {
+		m_dirty = true;
+		m_cleantext = *this;
+	}
+	HumdrumFile* infile = getOwner();
+	if (infile) {
+		infile->invalidateNoteGrid();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::clearDirty -- Mark the line as unchanged.
+//
+
+void HumdrumLine::clearDirty(void) {
+	m_dirty = false;
+	m_cleantext.clear();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::clear -- Remove stored tokens.
@@ -1274,9 +1320,6 @@ int HumdrumLine::createTokensFromLine(void) {
 	m_tokens.clear();
 	m_tabs.clear();
 	HTp token;
-	char ch = 0;
-	char lastch = 0;
-	string tstring;
 
 	if (this->size() == 0) {
 		token = new HumdrumToken();
@@ -1289,34 +1332,35 @@ int HumdrumLine::createTokensFromLine(void) {
 		m_tokens.push_back(token);
 		m_tabs.push_back(0);
 	} else {
-		for (int i=0; i<(int)size(); i++) {
-			lastch = ch;
-			ch = getChar(i);
-			if (ch == '\t') {
-				// Parser now allows multiple tab characters in a
-				// row to represent a single tab.
-				if (lastch != '\t') {
-					token = new HumdrumToken(tstring);
-					token->setOwner(this);
-					m_tokens.push_back(token);
-					m_tabs.push_back(1);
-					tstring.clear();
-				} else {
-					if (m_tabs.size() > 0) {
-						m_tabs.back()++;
-					}
-				}
+		// Scan the line for tabs and copy each token directly from
+		// the line rather than building it up character by character.
+		const char* text = this->c_str();
+		int length = (int)this->size();
+		int start = 0;
+		for (int i=0; i<length; i++) {
+			if (text[i] != '\t') {
+				continue;
+			}
+			// Parser now allows multiple tab characters in a
+			// row to represent a single tab.
+			if ((i == 0) || (text[i-1] != '\t')) {
+				token = new HumdrumToken(string(text + start, i - start));
+				token->setOwner(this);
+				m_tokens.push_back(token);
+				m_tabs.push_back(1);
 			} else {
-				tstring += ch;
+				if (m_tabs.size() > 0) {
+					m_tabs.back()++;
+				}
 			}
+			start = i + 1;
+		}
+		if (start < length) {
+			token = new HumdrumToken(string(text + start, length - start));
+			token->setOwner(this);
+			m_tokens.push_back(token);
+			m_tabs.push_back(0);
 		}
-	}
-	if (tstring.size() > 0) {
-		token = new HumdrumToken(tstring);
-		token->setOwner(this);
-		m_tokens.push_back(token);
-		m_tabs.push_back(0);
-		tstring.clear();
 	}
 
 	return (int)m_tokens.size();
@@ -1334,8 +1378,7 @@ int HumdrumLine::createTokensFromLine(void) {
 //
 
 void HumdrumLine::createLineFromTokens(void) {
-	string& iline = *this;
-	iline = "";
+	string iline;
 	// needed for empty lines for some reason:
 	if (m_tokens.size()) {
 		if (m_tokens.back() == NULL) {
@@ -1343,7 +1386,7 @@ void HumdrumLine::createLineFromTokens(void) {
 		}
 	}
 	for (int i=0; i<(int)m_tokens.size(); i++) {
-		iline += (string)(*m_tokens.at(i));
+		iline += *m_tokens.at(i);
 		if (i < (int)m_tokens.size() - 1) {
 			if ((int)m_tabs.size() <= i) {
 				for (int j=0; j<(int)m_tokens.size() - (int)m_tabs.size(); j++) {
@@ -1358,6 +1401,10 @@ void HumdrumLine::createLineFromTokens(void) {
 			}
 		}
 	}
+	if (iline != *this) {
+		setDirty();
+		string::swap(iline);
+	}
 }
 
 
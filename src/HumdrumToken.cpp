@@ -772,7 +772,7 @@ bool HumdrumToken::analyzeDuration(void) {
 					if (strchr(this->c_str(), 'q') != NULL) {
 						m_duration = 0;
 					} else {
-						m_duration = Convert::recipToDuration((string)(*this));
+						m_duration = Convert::recipToDuration(*this);
 					}
 				} else if (isMens()) {
 					m_duration = Convert::mensToDuration((string)(*this));
@@ -941,11 +941,14 @@ HumNum HumdrumToken::getDurationNoDots(HumNum scale) {
 //////////////////////////////
 //
 // HumdrumToken::setDuration -- Sets the duration of the token.  This is done in
-//    HumdrumFileStructure::analyzeTokenDurations().
+//    HumdrumFileStructure::analyzeTokenDurations().  The duration will not be
+//    parsed again from the token (GridSlice::transferTokens() uses this
+//    to pass on the durations of notes in a HumGrid).
 //
 
 void HumdrumToken::setDuration(const HumNum& dur) {
 	m_duration = dur;
+	m_rhythm_analyzed = true;
 }
 
 
@@ -2365,10 +2368,19 @@ void HumdrumToken::setParameters(const string& pdata, HumdrumToken* ptok) {
 
 //////////////////////////////
 //
-// HumdrumToken::setText --
+// HumdrumToken::setText -- Change the text of the token.  The owning
+//    line is marked as dirty (which also invalidates any note grid cached
+//    by the file).
 //
 
 void HumdrumToken::setText(const string& text) {
+	if (text == *this) {
+		return;
+	}
+	HLp owner = getOwner();
+	if (owner) {
+		owner->setDirty();
+	}
 	string::assign(text);
 }
 
@@ -2437,6 +2449,7 @@ int HumdrumToken::addLinkedParameterSet(HTp token) {
 //
 
 bool HumdrumToken::linkedParameterIsGlobal(int index) {
+	analyzeOwnerParameters();
 	return m_linkedParameterTokens.at(index)->isCommentGlobal();
 }
 
@@ -2448,6 +2461,7 @@ bool HumdrumToken::linkedParameterIsGlobal(int index) {
 //
 
 int HumdrumToken::getLinkedParameterSetCount(void) {
+	analyzeOwnerParameters();
 	return (int)m_linkedParameterTokens.size();
 }
 
@@ -2459,6 +2473,7 @@ int HumdrumToken::getLinkedParameterSetCount(void) {
 //
 
 HumParamSet* HumdrumToken::getParameterSet(void) {
+	analyzeOwnerParameters();
 	return m_parameterSet;
 }
 
@@ -2470,6 +2485,7 @@ HumParamSet* HumdrumToken::getParameterSet(void) {
 //
 
 HumParamSet* HumdrumToken::getLinkedParameterSet(int index) {
+	analyzeOwnerParameters();
 	return m_linkedParameterTokens.at(index)->getParameterSet();
 }
 
@@ -2495,6 +2511,52 @@ void HumdrumToken::storeParameterSet(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::analyzeOwnerStrands -- Analyze the spine strands (and
+//    strophes) of the owning HumdrumFile if they have not yet been
+//    analyzed.
+//
+
+void HumdrumToken::analyzeOwnerStrands(void) const {
+	HLp hline = getOwner();
+	if (!hline) {
+		return;
+	}
+	HumdrumFile* infile = hline->getOwner();
+	if (!infile) {
+		return;
+	}
+	if (!infile->areStrandsAnalyzed()) {
+		infile->analyzeStrands();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::analyzeOwnerParameters -- Link layout parameters
+//    to tokens in the owning HumdrumFile if they have not yet been
+//    analyzed.
+//
+
+void HumdrumToken::analyzeOwnerParameters(void) {
+	HLp hline = getOwner();
+	if (!hline) {
+		return;
+	}
+	HumdrumFile* infile = hline->getOwner();
+	if (!infile) {
+		return;
+	}
+	if (!infile->areParametersAnalyzed()) {
+		infile->analyzeParameters();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::makeForwardLink -- Line a following spine token to this one.
@@ -2974,6 +3036,7 @@ int HumdrumToken::getState(void) const {
 //
 
 int  HumdrumToken::getStrandIndex(void) const {
+	analyzeOwnerStrands();
 	return m_strand;
 }
 
@@ -3185,6 +3248,7 @@ ostream& HumdrumToken::printXml(ostream& out, int level, const string& indent) {
 //
 
 ostream&	HumdrumToken::printXmlLinkedParameters(ostream& out, int level, const string& indent) {
+	analyzeOwnerParameters();
 	if (m_parameterSet) {
 		m_parameterSet->printXml(out, level, indent);
 	}
@@ -3199,6 +3263,7 @@ ostream&	HumdrumToken::printXmlLinkedParameters(ostream& out, int level, const s
 //
 
 ostream& HumdrumToken::printXmlLinkedParameterInfo(ostream& out, int level, const string& indent) {
+	analyzeOwnerParameters();
 	if (m_linkedParameterTokens.empty()) {
 		return out;
 	}
@@ -3608,6 +3673,7 @@ void HumdrumToken::copyStructure(HTp token) {
 //
 
 HTp HumdrumToken::getStrophe(void) {
+	analyzeOwnerStrands();
 	return m_strophe;
 }
 
@@ -3641,6 +3707,7 @@ void HumdrumToken::setStrophe(HTp strophe) {
 //
 
 bool HumdrumToken::hasStrophe(void) {
+	analyzeOwnerStrands();
 	return m_strophe ? true : false;
 }
 
@@ -3665,6 +3732,7 @@ void HumdrumToken::clearStrophe(void) {
 //
 
 int HumdrumToken::getStropheStartIndex(void) {
+	analyzeOwnerStrands();
 	if (!m_strophe) {
 		return -1;
 	}
@@ -3680,6 +3748,7 @@ int HumdrumToken::getStropheStartIndex(void) {
 //
 
 bool HumdrumToken::isFirstStrophe(void) {
+	analyzeOwnerStrands();
 	if (!m_strophe) {
 		return true;
 	}
@@ -3706,6 +3775,7 @@ bool HumdrumToken::isPrimaryStrophe(void) {
 //
 
 bool HumdrumToken::isStrophe(const string& label) {
+	analyzeOwnerStrands();
 	if (!m_strophe) {
 		return false;
 	}
@@ -3727,6 +3797,7 @@ bool HumdrumToken::isStrophe(const string& label) {
 //
 
 string HumdrumToken::getStropheLabel(void) {
+	analyzeOwnerStrands();
 	if (!m_strophe) {
 		return "";
 	}
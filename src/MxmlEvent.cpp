@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  6 10:53:40 CEST 2016
-// Last Modified: Sun Sep 18 14:16:18 PDT 2016
+// Last Modified: Sun Oct 18 07:13:13 UTC 2026
 // Filename:      musicxml2hum.cpp
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/src/MxmlEvent.cpp
 // Syntax:        C++11; humlib
@@ -37,7 +37,7 @@ namespace hum {
 class MxmlMeasure;
 class MxmlPart;
 
-int MxmlEvent::m_counter = 0;
+thread_local int MxmlEvent::m_counter = 0;
 
 ////////////////////////////////////////////////////////////////////////////
 
@@ -1129,7 +1129,7 @@ bool MxmlEvent::parseEvent(xml_node el, xml_node nextel, HumNum starttime) {
 	switch (m_eventtype) {
 		case mevent_note:
 			setDuration(0);
-			if (hasChild("./chord")) {
+			if (m_node.child("chord")) {
 				setDuration(0);
 				attachToLastEvent();
 			} else {
@@ -1166,7 +1166,7 @@ bool MxmlEvent::parseEvent(xml_node el, xml_node nextel, HumNum starttime) {
 			break;
 
 		case mevent_attributes:
-			setQTicks(getIntValue("./divisions"));
+			setQTicks(atoi(m_node.child("divisions").child_value()));
 			timesigdur = getTimeSigDur();
 			if (timesigdur > 0) {
 				reportTimeSigDurToOwner(timesigdur);
@@ -1714,7 +1714,7 @@ void MxmlEvent::addNotations(stringstream& ss, xml_node notations,
 					downbow = true;
 				} else if (strcmp(grandchild.name(), "harmonic") == 0) {
 					// check of not an artificial harmonic
-					xml_node artificial = grandchild.select_node("artificial").node();
+					xml_node artificial = grandchild.child("artificial");
 					if (!artificial) {
 						// natural harmonic
 						harmonic = true;
@@ -1950,24 +1950,24 @@ int MxmlEvent::getDotCount(void) const {
 //
 
 string MxmlEvent::getRestPitch(void) const {
-	xpath_node rest = m_node.select_node("./rest");
-	if (rest.node().empty()) {
+	xml_node rest = m_node.child("rest");
+	if (rest.empty()) {
 		// not a rest, so no pitch information.
 		return "";
 	}
-	xpath_node step = rest.node().select_node("./display-step");
-	if (step.node().empty()) {
+	xml_node step = rest.child("display-step");
+	if (step.empty()) {
 		// no vertical positioning information
 	}
-	string steptext = step.node().child_value();
+	string steptext = step.child_value();
 	if (steptext.empty()) {
 		return "";
 	}
-	xpath_node octave = rest.node().select_node("./display-octave");
-	if (octave.node().empty()) {
+	xml_node octave = rest.child("display-octave");
+	if (octave.empty()) {
 		// not enough vertical positioning information
 	}
-	string octavetext = octave.node().child_value();
+	string octavetext = octave.child_value();
 	if (octavetext.empty()) {
 		return "";
 	}
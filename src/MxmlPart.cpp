@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  6 10:53:40 CEST 2016
-// Last Modified: Sun Sep 18 14:16:18 PDT 2016
+// Last Modified: Sun Oct 18 07:24:54 UTC 2026
 // Filename:      MxmlPart.cpp
 // URL:           https://github.com/craigsapp/musicxml2hum/blob/master/src/MxmlPart.cpp
 // Syntax:        C++11; humlib
@@ -145,7 +145,7 @@ bool MxmlPart::addMeasure(xml_node mel) {
 	if (m_stems) {
 		meas->enableStems();
 	}
-	if (m_measures.size() > 0) {
+	if ((m_measures.size() > 0) && m_measures.back()) {
 		meas->setPreviousMeasure(m_measures.back());
 		m_measures.back()->setNextMeasure(meas);
 	}
@@ -157,6 +157,50 @@ bool MxmlPart::addMeasure(xml_node mel) {
 
 
 
+//////////////////////////////
+//
+// MxmlPart::deleteMeasure -- Free the memory for a measure which is no
+//    longer needed.  The measure index is kept (getMeasure() will return
+//    NULL for it), so later measures do not change their index.
+//
+
+void MxmlPart::deleteMeasure(int index) {
+	MxmlMeasure* measure = getMeasure(index);
+	if (!measure) {
+		return;
+	}
+	MxmlMeasure* previous = measure->getPreviousMeasure();
+	MxmlMeasure* next = measure->getNextMeasure();
+	if (previous) {
+		previous->setNextMeasure(NULL);
+	}
+	if (next) {
+		next->setPreviousMeasure(NULL);
+	}
+	delete measure;
+	m_measures[index] = NULL;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlPart::clearMeasures -- Delete all measures and the divisions
+//    history, but keep the information which the measures reported
+//    to the part (staff/voice counts, verse counts, etc.).
+//
+
+void MxmlPart::clearMeasures(void) {
+	for (int i=0; i<(int)m_measures.size(); i++) {
+		delete m_measures[i];
+		m_measures[i] = NULL;
+	}
+	m_measures.clear();
+	m_qtick.clear();
+}
+
+
+
 //////////////////////////////
 //
 // MxmlPart::getMeasureCount -- Return the number of stored measures.
@@ -729,12 +773,12 @@ void MxmlPart::printStaffVoiceInfo(void) {
 
 void MxmlPart::parsePartInfo(xml_node partinfo) {
 // ggg cerr << "PART INFO ID " << partinfo.attribute("id").value() << endl;
-	xml_node partnamenode = partinfo.select_node("./part-name").node();
+	xml_node partnamenode = partinfo.child("part-name");
 	if (partnamenode) {
 // ggg cerr << "PART NAME " << partnamenode.child_value() << endl;
 		m_partname = cleanSpaces(partnamenode.child_value());
 	}
-	xml_node abbrnode = partinfo.select_node("./part-abbreviation").node();
+	xml_node abbrnode = partinfo.child("part-abbreviation");
 	if (abbrnode) {
 		m_partabbr = cleanSpaces(abbrnode.child_value());
 	}
@@ -0,0 +1,423 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 07:24:54 UTC 2026
+// Last Modified: Sun Oct 18 09:01:31 UTC 2026
+// Filename:      MxmlStream.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/src/MxmlStream.cpp
+// Syntax:        C++11; humlib
+// vim:           ts=3 noexpandtab
+//
+// Description:   Index of the part and measure elements in a partwise
+//                MusicXML file, for parsing one measure at a time.
+//
+
+#include "MxmlStream.h"
+
+#include "pugiconfig.hpp"
+#include "pugixml.hpp"
+
+#include <cctype>
+#include <cstring>
+#include <sstream>
+
+using namespace pugi;
+using namespace std;
+
+namespace hum {
+
+// START_MERGE
+
+//////////////////////////////
+//
+// MxmlStream::MxmlStream -- Constructor.
+//
+
+MxmlStream::MxmlStream(void) {
+	m_data = NULL;
+	m_size = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::~MxmlStream -- Deconstructor.
+//
+
+MxmlStream::~MxmlStream() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::clear -- Close the file and remove the index.
+//
+
+void MxmlStream::clear(void) {
+	m_file.close();
+	m_data = NULL;
+	m_size = 0;
+	m_partids.clear();
+	m_contents.clear();
+	m_measures.clear();
+	m_error.clear();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::open -- Open a MusicXML file and index its part and
+//     measure elements.  Returns false if the file cannot be read, is
+//     not a UTF-8 score-partwise document, or if its tags are not
+//     balanced.  The reason is available from getError().
+//
+
+bool MxmlStream::open(const string& filename) {
+	clear();
+	if (!m_file.open(filename)) {
+		m_error = "Cannot read file " + filename;
+		return false;
+	}
+	m_data = m_file.getData();
+	m_size = m_file.getSize();
+	if (!isUtf8()) {
+		m_error = "Only UTF-8 files can be read one measure at a time";
+		return false;
+	}
+	return scan();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::loadSkeleton -- Parse the file with the contents of the part
+//     elements removed.  The part elements remain (empty) so that the
+//     part IDs can be matched to the part-list.
+//
+
+bool MxmlStream::loadSkeleton(xml_document& doc) {
+	string skeleton;
+	size_t start = 0;
+	for (int i=0; i<(int)m_contents.size(); i++) {
+		skeleton.append(m_data + start, m_contents[i].first - start);
+		start = m_contents[i].second;
+	}
+	skeleton.append(m_data + start, m_size - start);
+
+	pugi::xml_parse_result result = doc.load_buffer(skeleton.data(), skeleton.size());
+	if (!result) {
+		stringstream ss;
+		ss << "XML content has syntax errors: " << result.description();
+		m_error = ss.str();
+		return false;
+	}
+
+	m_partids.clear();
+	for (xml_node part : doc.child("score-partwise").children("part")) {
+		m_partids.push_back(part.attribute("id").value());
+	}
+	if (m_partids.size() != m_measures.size()) {
+		m_error = "Part elements could not be indexed";
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::getPartCount -- Return the number of part elements in the file.
+//
+
+int MxmlStream::getPartCount(void) const {
+	return (int)m_measures.size();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::getPartIndex -- Return the index of the (first) part element
+//     with the given ID, or -1 if there is no such part.  Only available
+//     after loadSkeleton().
+//
+
+int MxmlStream::getPartIndex(const string& id) const {
+	for (int i=0; i<(int)m_partids.size(); i++) {
+		if (m_partids[i] == id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::getMeasureCount -- Return the number of measure elements
+//     in a part.
+//
+
+int MxmlStream::getMeasureCount(int partindex) const {
+	if ((partindex < 0) || (partindex >= (int)m_measures.size())) {
+		return 0;
+	}
+	return (int)m_measures[partindex].size();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::loadMeasure -- Parse a single measure element into the given
+//     document (replacing any previous contents) and return the measure
+//     node.  An empty node is returned if the measure has syntax errors.
+//
+
+xml_node MxmlStream::loadMeasure(xml_document& doc, int partindex,
+		int measureindex) {
+	const pair<size_t, size_t>& range = m_measures.at(partindex).at(measureindex);
+	pugi::xml_parse_result result = doc.load_buffer(m_data + range.first,
+			range.second - range.first, pugi::parse_default, pugi::encoding_utf8);
+	if (!result) {
+		stringstream ss;
+		ss << "XML content has syntax errors: " << result.description()
+		   << " at offset " << (range.first + result.offset);
+		m_error = ss.str();
+		return xml_node();
+	}
+	return doc.child("measure");
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::getError -- Return a description of the last problem.
+//
+
+const string& MxmlStream::getError(void) const {
+	return m_error;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::scan -- Store the byte ranges of the part contents and
+//     measure elements.  Only tags are tokenized: comments, CDATA sections,
+//     processing instructions and the DOCTYPE declaration are skipped, and
+//     text content is never examined.
+//
+
+bool MxmlStream::scan(void) {
+	size_t i = 0;
+	int depth = 0;
+	bool inpart = false;
+	bool inmeasure = false;
+	while (i < m_size) {
+		const char* ptr = (const char*)memchr(m_data + i, '<', m_size - i);
+		if (!ptr) {
+			i = m_size;
+			break;
+		}
+		i = ptr - m_data;
+		if (i + 1 >= m_size) {
+			break;
+		}
+
+		char next = m_data[i+1];
+		if (next == '?') {
+			i = skipPast(i + 2, "?>");
+			continue;
+		} else if ((next == '!') && (strncmp(m_data + i, "<!--", 4) == 0)) {
+			i = skipPast(i + 4, "-->");
+			continue;
+		} else if ((next == '!') && (strncmp(m_data + i, "<![CDATA[", 9) == 0)) {
+			i = skipPast(i + 9, "]]>");
+			continue;
+		}
+
+		size_t end = findTagEnd(i);
+		if (end == string::npos) {
+			break;
+		}
+
+		if (next == '!') {
+			// DOCTYPE declaration
+		} else if (next == '/') {
+			depth--;
+			if ((depth == 1) && inpart) {
+				m_contents.back().second = i;
+				inpart = false;
+			} else if ((depth == 2) && inmeasure) {
+				m_measures.back().back().second = end + 1;
+				inmeasure = false;
+			}
+		} else {
+			bool empty = m_data[end-1] == '/';
+			string name = getTagName(i + 1);
+			if (depth == 0) {
+				if (name != "score-partwise") {
+					m_error = "Only score-partwise files can be read one measure at a time";
+					return false;
+				}
+			} else if ((depth == 1) && (name == "part")) {
+				m_contents.emplace_back(end + 1, end + 1);
+				m_measures.resize(m_measures.size() + 1);
+				inpart = !empty;
+			} else if ((depth == 2) && inpart && (name == "measure")) {
+				m_measures.back().emplace_back(i, end + 1);
+				inmeasure = !empty;
+			}
+			if (!empty) {
+				depth++;
+			}
+		}
+		i = end + 1;
+	}
+
+	if ((i < m_size) || (depth != 0)) {
+		m_error = "Unexpected end of file";
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::skipPast -- Return the index after the next occurrence of
+//     the target string, or the size of the data if not found.
+//
+
+size_t MxmlStream::skipPast(size_t index, const char* target) {
+	size_t length = strlen(target);
+	while (index < m_size) {
+		const char* ptr = (const char*)memchr(m_data + index, target[0],
+				m_size - index);
+		if (!ptr) {
+			break;
+		}
+		index = ptr - m_data;
+		if ((m_size - index >= length) && (strncmp(ptr, target, length) == 0)) {
+			return index + length;
+		}
+		index++;
+	}
+	return m_size;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::findTagEnd -- Return the index of the ">" which closes the
+//     tag starting at the given index, ignoring any ">" inside of quoted
+//     attribute values or the internal subset of a DOCTYPE declaration.
+//     Returns string::npos if the tag is not closed.
+//
+
+size_t MxmlStream::findTagEnd(size_t index) {
+	char quote = 0;
+	int brackets = 0;
+	for (size_t i=index+1; i<m_size; i++) {
+		char c = m_data[i];
+		if (quote) {
+			if (c == quote) {
+				quote = 0;
+			}
+		} else if ((c == '"') || (c == '\'')) {
+			quote = c;
+		} else if (c == '[') {
+			brackets++;
+		} else if (c == ']') {
+			brackets--;
+		} else if ((c == '>') && (brackets <= 0)) {
+			return i;
+		}
+	}
+	return string::npos;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::getTagName -- Return the element name starting at the
+//     given index.
+//
+
+string MxmlStream::getTagName(size_t index) {
+	size_t end = index;
+	while (end < m_size) {
+		char c = m_data[end];
+		if (isspace((unsigned char)c) || (c == '/') || (c == '>')) {
+			break;
+		}
+		end++;
+	}
+	return string(m_data + index, end - index);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::isUtf8 -- True if the file is encoded in UTF-8 (or ASCII),
+//     according to its XML declaration.  Files without a declaration are
+//     UTF-8 unless they start with a UTF-16 or UTF-32 byte-order mark.
+//
+
+bool MxmlStream::isUtf8(void) {
+	size_t start = 0;
+	if ((m_size >= 3) && (strncmp(m_data, "\xEF\xBB\xBF", 3) == 0)) {
+		start = 3;
+	}
+	if (m_size - start < 2) {
+		return true;
+	}
+	if ((m_data[start] == '\0') || (m_data[start+1] == '\0') ||
+			(m_data[start] == '\xFE') || (m_data[start] == '\xFF')) {
+		return false;
+	}
+	if ((m_size - start < 5) || (strncmp(m_data + start, "<?xml", 5) != 0)) {
+		return true;
+	}
+
+	size_t end = skipPast(start, "?>");
+	string declaration(m_data + start, end - start);
+	size_t index = declaration.find("encoding");
+	if (index == string::npos) {
+		return true;
+	}
+	index = declaration.find_first_of("\"'", index);
+	if (index == string::npos) {
+		return true;
+	}
+	size_t index2 = declaration.find(declaration[index], index + 1);
+	if (index2 == string::npos) {
+		return false;
+	}
+	string encoding = declaration.substr(index + 1, index2 - index - 1);
+	for (int i=0; i<(int)encoding.size(); i++) {
+		encoding[i] = tolower(encoding[i]);
+	}
+	return (encoding == "utf-8") || (encoding == "utf8") ||
+			(encoding == "us-ascii") || (encoding == "ascii");
+}
+
+
+// END_MERGE
+
+} // end namespace hum
+
+
+
@@ -13,6 +13,7 @@
 
 #include "NoteCell.h"
 #include "NoteGrid.h"
+#include "CompactNoteGrid.h"
 #include "Convert.h"
 
 using namespace std;
@@ -34,6 +35,34 @@ NoteCell::NoteCell(NoteGrid* owner, HTp token) {
 }
 
 
+//
+// Copy a cell from a CompactNoteGrid rather than calculating the
+// pitches from the token again (used by NoteGrid::load).
+//
+
+NoteCell::NoteCell(NoteGrid* owner, const CompactNoteGrid& source, int vindex,
+		int sindex) {
+	clear();
+	m_owner     = owner;
+	m_token     = source.getToken(vindex, sindex);
+	m_voice     = vindex;
+	m_timeslice = sindex;
+	int b7         = source.getSgnDiatonicPitch(vindex, sindex);
+	int b12        = source.getSgnMidiPitch(vindex, sindex);
+	int b40        = source.getSgnBase40Pitch(vindex, sindex);
+	int accidental = source.getSgnAccidental(vindex, sindex);
+	m_b7         = (b7  == CompactNoteGrid::REST) ? NAN : b7;
+	m_b12        = (b12 == CompactNoteGrid::REST) ? NAN : b12;
+	m_b40        = (b40 == CompactNoteGrid::REST) ? NAN : b40;
+	m_accidental = (accidental == CompactNoteGrid::REST) ? NAN : accidental;
+	m_currAttackIndex = source.getCurrAttackIndex(vindex, sindex);
+	m_prevAttackIndex = source.getPrevAttackIndex(vindex, sindex);
+	m_nextAttackIndex = source.getNextAttackIndex(vindex, sindex);
+	m_metertop        = source.getMeterTop(vindex, sindex);
+	m_meterbot        = source.getMeterBottom(vindex, sindex);
+}
+
+
 
 //////////////////////////////
 //
@@ -12,7 +12,6 @@
 //
 
 #include "NoteGrid.h"
-#include "HumRegex.h"
 
 using namespace std;
 
@@ -99,7 +98,10 @@ int NoteGrid::getSliceCount(void) {
 //
 // NoteGrid::load -- Generate a two-dimensional list of notes
 //     in a score.  Each row has at least one note attack, or an
-//     empty data line in the Humdrum file will be skipped.
+//     empty data line in the Humdrum file will be skipped.  The
+//     pitches and attack indexes are copied from the CompactNoteGrid
+//     cached on the file, so several NoteGrids (or tools) using the
+//     same file share a single analysis of the notes.
 //
 
 bool NoteGrid::load(HumdrumFile& infile) {
@@ -108,86 +110,23 @@ bool NoteGrid::load(HumdrumFile& infile) {
 
 	m_infile = &infile;
 
-	m_kernspines = infile.getKernSpineStartList();
-	vector<HTp>& kernspines = m_kernspines;
+	CompactNoteGrid& source = infile.getCompactNoteGrid();
+	m_kernspines = source.getKernSpineStarts();
 
-	vector<int> metertops(infile.getMaxTrack() + 1, 0);
-	vector<HumNum> meterbots(infile.getMaxTrack() + 1, 0);
-
-	if (kernspines.size() == 0) {
-		cerr << "Warning: no **kern spines in file" << endl;
+	int slices = source.getSliceCount();
+	vector<vector<NoteCell* > >& grid = m_grid;
+	grid.resize(source.getVoiceCount());
+	if (!source.isValid()) {
 		return false;
 	}
-
-	vector<vector<NoteCell* > >& grid = m_grid;
-	grid.resize(kernspines.size());
 	for (int i=0; i<(int)grid.size(); i++) {
-		grid[i].reserve(infile.getLineCount());
-	}
-
-	int attack = 0;
-	int track, lasttrack;
-	vector<HTp> current;
-	HumRegex hre;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (infile[i].isInterpretation()) {
-			for (int j=0; j<infile[i].getFieldCount(); j++) {
-				if (!infile[i].token(j)->isKern()) {
-					continue;
-				}
-				track = infile.token(i, j)->getTrack();
-				if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)%(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
-					meterbots[track] /= hre.getMatchInt(3);
-				} else if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
-				} else {
-					continue;
-				}
-
-			}
-		}
-		if (!infile[i].isData()) {
-			continue;
-		}
-		track = 0;
-		attack = 0;
-		current.clear();
-		for (int j=0; j<infile[i].getFieldCount(); j++) {
-			lasttrack = track;
-			track = infile.token(i, j)->getTrack();
-			if (!infile[i].token(j)->isDataType("**kern")) {
-				continue;
-			}
-			if (track == lasttrack) {
-				// secondary voice: ignore
-				continue;
-			}
-			current.push_back(infile.token(i, j));
-			if (!(current.back()->isRest()
-					|| current.back()->isSecondaryTiedNote())) {
-				attack++;
-			}
-		}
-		if (current.size() != kernspines.size()) {
-			cerr << "Error: Unequal vector sizes " << current.size()
-			     << " compared to " << kernspines.size() << endl;
-			return false;
-		}
-		for (int j=0; j<(int)current.size(); j++) {
-			NoteCell* cell = new NoteCell(this, current[j]);
-			track = current[j]->getTrack();
-			cell->setVoiceIndex(j);
-			cell->setSliceIndex((int)grid[j].size());
-			cell->setMeter(metertops[track], meterbots[track]);
-			grid[j].push_back(cell);
+		grid[i].resize(slices);
+		for (int j=0; j<slices; j++) {
+			grid[i][j] = new NoteCell(this, source, i, j);
 		}
+		buildTiedTokens(i);
 	}
 
-	buildAttackIndexes();
-
 	return true;
 }
 
@@ -302,106 +241,27 @@ void NoteGrid::printKernGrid(ostream& output) {
 
 //////////////////////////////
 //
-// NoteGrid::buildAttackIndexes -- create forward and backward
-//     note attack indexes for each cell.
+// NoteGrid::buildTiedTokens -- Store the tokens of sustained notes
+//     (and of rests after the first rest in a sequence) in the
+//     m_tiedtokens list of the last note attack in a voice.
 //
 
-void NoteGrid::buildAttackIndexes(void) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		buildAttackIndex(i);
-	}
-}
-
-
-
-//////////////////////////////
-//
-// NoteGrid::buildAttackIndex -- create forward and backward
-//     note attack indexes for each cell in a single voice.
-//
-
-void NoteGrid::buildAttackIndex(int vindex) {
+void NoteGrid::buildTiedTokens(int vindex) {
 	vector<NoteCell*>& part = m_grid[vindex];
-
-	// Set the slice index for the attack of the current note.  This
-	// will be the same as the current slice if the NoteCell is an attack.
-	// Otherwise if the note is a sustain, thie index will be set
-	// to the slice of the attack correspinding to this NoteCell.
-	// For rests, the first rest in a continuous sequence of rests
-	// will be marked as the "attack" of the rest.
 	NoteCell* currentcell = NULL;
-	for (int i=0; i<(int)part.size(); i++) {
-		if (i == 0) {
-			part[0]->setCurrAttackIndex(0);
-			continue;
-		}
-		if (part[i]->isRest()) {
-			// This is a rest, so check for a rest sustain or start
-			// of a rest sequence.
-			if (part[i-1]->isRest()) {
-				// rest "sustain"
-				if (currentcell && !part[i]->getToken()->isNull()) {
-					currentcell->m_tiedtokens.push_back(part[i]->getToken());
-				}
-				part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
-			} else {
-				// rest "attack";
-				part[i]->setCurrAttackIndex(i);
-			}
-		} else if (part[i]->isAttack()) {
-			part[i]->setCurrAttackIndex(i);
-			currentcell = part[i];
-		} else {
-			// This is a sustain, so get the attack index of the
-			// note from the previous slice index.
-			part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
-			if (currentcell && !part[i]->getToken()->isNull()) {
-				currentcell->m_tiedtokens.push_back(part[i]->getToken());
-			}
-		}
-	}
-
-	// start with note attacks marked in the previous and next note slots:
-	for (int i=0; i<(int)part.size(); i++) {
+	for (int i=1; i<(int)part.size(); i++) {
 		if (part[i]->isAttack()) {
-			part[i]->setNextAttackIndex(i);
-			part[i]->setPrevAttackIndex(i);
-		} else if (part[i]->isRest()) {
-			if (part[i]->getCurrAttackIndex() == i) {
-				part[i]->setNextAttackIndex(i);
-				part[i]->setPrevAttackIndex(i);
-			}
+			currentcell = part[i];
+			continue;
 		}
-	}
-
-	// Go back and adjust the next note attack index:
-	int value = -1;
-	int temp  = -1;
-	for (int i=(int)part.size()-1; i>=0; i--) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getNextAttackIndex();
-			part[i]->setNextAttackIndex(value);
-			value = temp;
-		} else {
-			part[i]->setNextAttackIndex(value);
+		if (part[i]->isRest() && !part[i-1]->isRest()) {
+			// rest "attack"
+			continue;
 		}
-	}
-
-	// Go back and adjust the previous note attack index:
-	value = -1;
-	temp  = -1;
-	for (int i=0; i<(int)part.size(); i++) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getPrevAttackIndex();
-			part[i]->setPrevAttackIndex(value);
-			value = temp;
-		} else {
-			if (i != 0) {
-				part[i]->setPrevAttackIndex(part[i-1]->getPrevAttackIndex());
-			}
+		if (currentcell && !part[i]->getToken()->isNull()) {
+			currentcell->m_tiedtokens.push_back(part[i]->getToken());
 		}
 	}
-
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Wed Feb  3 23:31:08 PST 2021
+// Last Modified: Sun Oct 18 17:48:11 UTC 2026
 // Filename:      /include/humlib.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/humlib.cpp
 // Syntax:        C++11
@@ -41,6 +41,384 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace hum {
 
 
+//////////////////////////////
+//
+// CompactNoteGrid::CompactNoteGrid -- Constructor.
+//
+
+CompactNoteGrid::CompactNoteGrid(void) {
+	// do nothing
+}
+
+
+CompactNoteGrid::CompactNoteGrid(HumdrumFileBase& infile) {
+	load(infile);
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::~CompactNoteGrid -- Deconstructor.
+//
+
+CompactNoteGrid::~CompactNoteGrid() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::clear -- Make the grid empty.  Allocated storage
+//     is kept so that a reload of the same file does not need to
+//     allocate again.
+//
+
+void CompactNoteGrid::clear(void) {
+	m_valid  = false;
+	m_voices = 0;
+	m_slices = 0;
+	m_b7.clear();
+	m_b12.clear();
+	m_b40.clear();
+	m_accidental.clear();
+	m_meter.clear();
+	m_currattack.clear();
+	m_prevattack.clear();
+	m_nextattack.clear();
+	m_tokens.clear();
+	m_lines.clear();
+	m_kernspines.clear();
+	m_meters.clear();
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::load -- Extract the primary-layer notes of each
+//     **kern spine for every data line in the file.  Returns false
+//     if there are no **kern spines or if a data line does not
+//     contain a token for each **kern spine.
+//
+
+bool CompactNoteGrid::load(HumdrumFileBase& infile) {
+	clear();
+
+	infile.getKernSpineStartList(m_kernspines);
+	if (m_kernspines.empty()) {
+		cerr << "Warning: no **kern spines in file" << endl;
+		return false;
+	}
+
+	int slices = 0;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isData()) {
+			slices++;
+		}
+	}
+
+	m_voices = (int)m_kernspines.size();
+	m_slices = slices;
+	int size = m_voices * m_slices;
+	m_b7.resize(size);
+	m_b12.resize(size);
+	m_b40.resize(size);
+	m_accidental.resize(size);
+	m_meter.resize(size);
+	m_currattack.resize(size);
+	m_prevattack.resize(size);
+	m_nextattack.resize(size);
+	m_tokens.resize(size);
+	m_lines.resize(m_slices);
+
+	// Time signatures are stored once in m_meters and referenced by index
+	// in each cell.  Index 0 is used for cells with no time signature.
+	m_meters.emplace_back(0, 0);
+	vector<int16_t> meters(infile.getMaxTrack() + 1, 0);
+
+	int sindex = 0;
+	int track;
+	int lasttrack;
+	int vindex;
+	HumRegex hre;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isInterpretation()) {
+			for (int j=0; j<infile[i].getFieldCount(); j++) {
+				HTp token = infile.token(i, j);
+				if (!token->isKern()) {
+					continue;
+				}
+				int top;
+				HumNum bot;
+				if (hre.search(*token, "\\*M(\\d+)/(\\d+)%(\\d+)")) {
+					top = hre.getMatchInt(1);
+					bot = hre.getMatchInt(2);
+					bot /= hre.getMatchInt(3);
+				} else if (hre.search(*token, "\\*M(\\d+)/(\\d+)")) {
+					top = hre.getMatchInt(1);
+					bot = hre.getMatchInt(2);
+				} else {
+					continue;
+				}
+				int mindex = -1;
+				for (int k=0; k<(int)m_meters.size(); k++) {
+					if ((m_meters[k].first == top) && (m_meters[k].second == bot)) {
+						mindex = k;
+						break;
+					}
+				}
+				if (mindex < 0) {
+					mindex = (int)m_meters.size();
+					m_meters.emplace_back(top, bot);
+				}
+				meters[token->getTrack()] = (int16_t)mindex;
+			}
+		}
+		if (!infile[i].isData()) {
+			continue;
+		}
+		m_lines[sindex] = i;
+		track = 0;
+		vindex = 0;
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			lasttrack = track;
+			track = token->getTrack();
+			if (!token->isDataType("**kern")) {
+				continue;
+			}
+			if (track == lasttrack) {
+				// secondary voice: ignore
+				continue;
+			}
+			if (vindex >= m_voices) {
+				vindex++;
+				break;
+			}
+			int cell = index(vindex, sindex);
+			m_tokens[cell] = token;
+			m_meter[cell] = meters[track];
+			storePitch(cell, token);
+			vindex++;
+		}
+		if (vindex != m_voices) {
+			cerr << "Error: Unequal vector sizes " << vindex
+			     << " compared to " << m_voices << endl;
+			// Keep the voice list, but do not store any slices:
+			vector<HTp> kernspines;
+			kernspines.swap(m_kernspines);
+			clear();
+			m_kernspines.swap(kernspines);
+			m_voices = (int)m_kernspines.size();
+			return false;
+		}
+		sindex++;
+	}
+
+	for (int i=0; i<m_voices; i++) {
+		buildAttackIndex(i);
+	}
+
+	m_valid = true;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::storePitch -- Fill in the pitch columns for a cell.
+//    Rests (including null tokens which resolve to rests) are stored
+//    as REST, and sustained notes (null tokens and secondary tied notes)
+//    are stored as negative values.  This follows the calculation in
+//    NoteCell::calculateNumericPitches(), including the handling of
+//    tokens with no pitch.
+//
+
+void CompactNoteGrid::storePitch(int cell, HTp token) {
+	int b40 = REST;
+	bool sustain = token->isNull() || token->isSecondaryTiedNote();
+	if (!token->isRest()) {
+		HTp resolve = token->resolveNull();
+		if (!resolve->isRest() && !resolve->isNull()) {
+			b40 = Convert::kernToBase40(resolve);
+			b40 = (sustain ? -b40 : b40);
+		}
+	}
+	m_b40[cell] = (int16_t)b40;
+	if ((b40 == REST) || (b40 == 0)) {
+		m_b7[cell]         = REST;
+		m_b12[cell]        = REST;
+		m_accidental[cell] = REST;
+		return;
+	}
+	int sign = b40 < 0 ? -1 : 1;
+	b40 *= sign;
+	m_b7[cell]         = (int16_t)(sign * Convert::base40ToDiatonic(b40));
+	m_b12[cell]        = (int16_t)(sign * Convert::base40ToMidiNoteNumber(b40));
+	m_accidental[cell] = (int16_t)(sign * Convert::base40ToAccidental(b40));
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::buildAttackIndex -- Create the current, forward and
+//     backward note attack indexes for each cell in a single voice.
+//     The first rest in a sequence of rests is treated as the "attack"
+//     of the rest.
+//
+
+void CompactNoteGrid::buildAttackIndex(int vindex) {
+	int start = index(vindex, 0);
+	const int16_t* b40 = m_b40.data() + start;
+	int* curr = m_currattack.data() + start;
+	int* prev = m_prevattack.data() + start;
+	int* next = m_nextattack.data() + start;
+
+	for (int i=0; i<m_slices; i++) {
+		if (i == 0) {
+			curr[i] = 0;
+		} else if (b40[i] == REST) {
+			curr[i] = (b40[i-1] == REST) ? curr[i-1] : i;
+		} else if (b40[i] > 0) {
+			curr[i] = i;
+		} else {
+			curr[i] = curr[i-1];
+		}
+	}
+
+	// The previous attack of a sustain is the same as for its attack:
+	int value = -1;
+	for (int i=0; i<m_slices; i++) {
+		if (isSustained(vindex, i)) {
+			prev[i] = (i > 0) ? prev[i-1] : -1;
+		} else {
+			prev[i] = value;
+			value = i;
+		}
+	}
+
+	value = -1;
+	for (int i=m_slices-1; i>=0; i--) {
+		next[i] = value;
+		if (!isSustained(vindex, i)) {
+			value = i;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::isAttack -- True if the cell is a note attack
+//     (rests are never attacks).
+//
+
+bool CompactNoteGrid::isAttack(int vindex, int sindex) const {
+	return m_b40[index(vindex, sindex)] > 0;
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::isSustained -- True if the cell is a sustained note,
+//     or a rest which is not the first in a sequence of rests.
+//
+
+bool CompactNoteGrid::isSustained(int vindex, int sindex) const {
+	int cell = index(vindex, sindex);
+	int16_t value = m_b40[cell];
+	if (value > 0) {
+		return false;
+	} else if ((value < 0) && (value != REST)) {
+		return true;
+	}
+	return m_currattack[cell] != sindex;
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::getDiatonicColumn -- Return the diatonic pitches for
+//     all slices of a voice.  Similarly for MIDI, base-40 and accidentals.
+//
+
+const int16_t* CompactNoteGrid::getDiatonicColumn(int vindex) const {
+	return m_b7.data() + index(vindex, 0);
+}
+
+
+const int16_t* CompactNoteGrid::getMidiColumn(int vindex) const {
+	return m_b12.data() + index(vindex, 0);
+}
+
+
+const int16_t* CompactNoteGrid::getBase40Column(int vindex) const {
+	return m_b40.data() + index(vindex, 0);
+}
+
+
+const int16_t* CompactNoteGrid::getAccidentalColumn(int vindex) const {
+	return m_accidental.data() + index(vindex, 0);
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::getMeterTop -- Return the top number of the time
+//     signature active for the cell (0 if none).
+//
+
+int CompactNoteGrid::getMeterTop(int vindex, int sindex) const {
+	return m_meters[m_meter[index(vindex, sindex)]].first;
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::getMeterBottom -- Return the bottom number of the time
+//     signature active for the cell (0 if none).
+//
+
+HumNum CompactNoteGrid::getMeterBottom(int vindex, int sindex) const {
+	return m_meters[m_meter[index(vindex, sindex)]].second;
+}
+
+
+
+//////////////////////////////
+//
+// CompactNoteGrid::getMemoryUsage -- Return the number of bytes used
+//     by the grid.
+//
+
+size_t CompactNoteGrid::getMemoryUsage(void) const {
+	size_t output = sizeof(*this);
+	output += m_b7.capacity()         * sizeof(int16_t);
+	output += m_b12.capacity()        * sizeof(int16_t);
+	output += m_b40.capacity()        * sizeof(int16_t);
+	output += m_accidental.capacity() * sizeof(int16_t);
+	output += m_meter.capacity()      * sizeof(int16_t);
+	output += m_currattack.capacity() * sizeof(int);
+	output += m_prevattack.capacity() * sizeof(int);
+	output += m_nextattack.capacity() * sizeof(int);
+	output += m_tokens.capacity()     * sizeof(HTp);
+	output += m_lines.capacity()      * sizeof(int);
+	output += m_kernspines.capacity() * sizeof(HTp);
+	output += m_meters.capacity()     * sizeof(pair<int, HumNum>);
+	return output;
+}
+
+
+
 
 //////////////////////////////
 //
@@ -443,6 +821,9 @@ vector<int> Convert::harmToBase40(const string& harm, int keyroot, int keymode)
 
 
 
+thread_local unordered_map<string, KernDecoding> Convert::s_kernDecodings;
+thread_local const pair<const string, KernDecoding>* Convert::s_lastKernDecoding = NULL;
+
 
 //////////////////////////////
 //
@@ -830,6 +1211,97 @@ string Convert::kernToRecip(HTp token) {
 
 
 
+//////////////////////////////
+//
+// Convert::decodeKern -- Return the pitch and rhythm information for
+//     a **kern token.  Each distinct token string is parsed only once per
+//     thread, and later requests for the same string are served from a
+//     cache.  The returned reference is valid until the next call to
+//     decodeKern() in the same thread.
+//
+
+const KernDecoding& Convert::decodeKern(const string& kerndata) {
+	// Long strings are unlikely to repeat, so do not store them.
+	if (kerndata.size() > 32) {
+		static thread_local KernDecoding scratch;
+		Convert::fillKernDecoding(scratch, kerndata);
+		return scratch;
+	}
+	// Pitch and rhythm are often requested one after another for the
+	// same token, so check the previous entry before searching the cache.
+	const auto* last = s_lastKernDecoding;
+	if (last && (last->first == kerndata)) {
+		return last->second;
+	}
+	auto it = s_kernDecodings.find(kerndata);
+	if (it == s_kernDecodings.end()) {
+		if (s_kernDecodings.size() >= 0x10000) {
+			s_kernDecodings.clear();
+		}
+		it = s_kernDecodings.emplace(kerndata, KernDecoding()).first;
+		Convert::fillKernDecoding(it->second, kerndata);
+	}
+	s_lastKernDecoding = &(*it);
+	return it->second;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::clearKernDecodings -- Free the decodeKern() cache for the
+//     current thread.
+//
+
+void Convert::clearKernDecodings(void) {
+	s_lastKernDecoding = NULL;
+	s_kernDecodings.clear();
+}
+
+
+
+//////////////////////////////
+//
+// Convert::fillKernDecoding -- Parse a **kern token for decodeKern().
+//
+
+void Convert::fillKernDecoding(KernDecoding& decoding, const string& kerndata) {
+	int diatonic = Convert::kernToDiatonicPC(kerndata);
+	int octave   = Convert::kernToOctaveNumber(kerndata);
+	decoding.octave = octave;
+	decoding.accidentals = (short)Convert::kernToAccidentalCount(kerndata);
+	decoding.base7 = diatonic < 0 ? diatonic : diatonic + 7 * octave;
+	int pc40 = Convert::kernToBase40PC(kerndata);
+	decoding.base40 = pc40 < 0 ? pc40 : pc40 + 40 * octave;
+	decoding.base12 = Convert::kernToBase12PC(kerndata) + 12 * octave;
+	decoding.duration = Convert::recipToDurationUncached(kerndata);
+
+	decoding.dots        = 0;
+	decoding.rest        = false;
+	decoding.grace       = false;
+	decoding.tieStart    = false;
+	decoding.tieContinue = false;
+	decoding.tieEnd      = false;
+	decoding.slurStart   = false;
+	decoding.slurEnd     = false;
+	for (int i=0; i<(int)kerndata.size(); i++) {
+		switch (kerndata[i]) {
+			case ' ': i = (int)kerndata.size(); break;
+			case '.': decoding.dots++;              break;
+			case 'r': decoding.rest        = true;  break;
+			case 'q': decoding.grace       = true;  break;
+			case 'Q': decoding.grace       = true;  break;
+			case '[': decoding.tieStart    = true;  break;
+			case '_': decoding.tieContinue = true;  break;
+			case ']': decoding.tieEnd      = true;  break;
+			case '(': decoding.slurStart   = true;  break;
+			case ')': decoding.slurEnd     = true;  break;
+		}
+	}
+}
+
+
+
 
 
 
@@ -1915,16 +2387,12 @@ int Convert::kernToBase40PC(const string& kerndata) {
 //////////////////////////////
 //
 // Convert::kernToBase40 -- Convert **kern pitch to a base-40 integer.
-//    Will ignore subsequent pitches in a chord.
+//    Will ignore subsequent pitches in a chord.  The pitch is taken
+//    from the decodeKern() cache.
 //
 
 int Convert::kernToBase40(const string& kerndata) {
-	int pc = Convert::kernToBase40PC(kerndata);
-	if (pc < 0) {
-		return pc;
-	}
-	int octave   = Convert::kernToOctaveNumber(kerndata);
-	return pc + 40 * octave;
+	return Convert::decodeKern(kerndata).base40;
 }
 
 
@@ -1961,13 +2429,11 @@ int Convert::kernToBase12PC(const string& kerndata) {
 //////////////////////////////
 //
 // Convert::kernToBase12 -- Convert **kern pitch to a base-12 integer.
-//     (middle C = 48).
+//     (middle C = 48).  The pitch is taken from the decodeKern() cache.
 //
 
 int Convert::kernToBase12(const string& kerndata) {
-	int pc = Convert::kernToBase12PC(kerndata);
-	int octave = Convert::kernToOctaveNumber(kerndata);
-	return pc + 12 * octave;
+	return Convert::decodeKern(kerndata).base12;
 }
 
 
@@ -2171,16 +2637,12 @@ int Convert::kernToMidiNoteNumber(const string& kerndata) {
 //////////////////////////////
 //
 // Convert::kernToBase7 -- Convert **kern pitch to a base-7 integer.
-//    This is a diatonic pitch class with C=0, D=1, ..., B=6.
+//    This is a diatonic pitch class with C=0, D=1, ..., B=6.  The pitch
+//    is taken from the decodeKern() cache.
 //
 
 int Convert::kernToBase7(const string& kerndata) {
-	int diatonic = Convert::kernToDiatonicPC(kerndata);
-	if (diatonic < 0) {
-		return diatonic;
-	}
-	int octave = Convert::kernToOctaveNumber(kerndata);
-	return diatonic + 7 * octave;;
+	return Convert::decodeKern(kerndata).base7;
 }
 
 
@@ -3940,6 +4402,8 @@ string Convert::getLanguageName(const string& abbreviation) {
 //     string contains a space, anything after the first space will be ignored
 //     when extracting the string.  **kern data which also includes the pitch
 //     along with the rhythm can also be given and will be ignored.
+//     Durations for the default separator are taken from the decodeKern()
+//     cache, so each distinct string is only parsed once.
 // default value: scale = 4 (duration in terms of quarter notes)
 // default value: separator = " " (sub-token separator)
 //
@@ -3952,6 +4416,29 @@ HumNum Convert::recipToDuration(string* recip, HumNum scale,
 
 HumNum Convert::recipToDuration(const string& recip, HumNum scale,
 		const string& separator) {
+	if (separator != " ") {
+		return Convert::recipToDurationUncached(recip, scale, separator);
+	}
+	const HumNum& duration = Convert::decodeKern(recip).duration;
+	if (scale == 4) {
+		return duration;
+	}
+	return duration * scale / 4;
+}
+
+
+
+//////////////////////////////
+//
+// Convert::recipToDurationUncached -- Same as recipToDuration(), but
+//     always parse the input string rather than using the decodeKern()
+//     cache.
+// default value: scale = 4 (duration in terms of quarter notes)
+// default value: separator = " " (sub-token separator)
+//
+
+HumNum Convert::recipToDurationUncached(const string& recip, HumNum scale,
+		const string& separator) {
 	size_t loc;
 	loc = recip.find(separator);
 	string subtok;
@@ -4144,7 +4631,7 @@ HumNum Convert::recipToDurationNoDots(const string& recip, HumNum scale,
 		const string& separator) {
 	string temp = recip;
 	std::replace(temp.begin(), temp.end(), '.', 'Z');
-	return Convert::recipToDuration(temp, scale, separator);
+	return Convert::recipToDurationUncached(temp, scale, separator);
 }
 
 
@@ -4762,89 +5249,17 @@ void Convert::removeDollarsFromString(string& buffer, int maximum) {
 
 
 
-
-
-
 //////////////////////////////
 //
-// Convert::tempoNameToMm -- Guess what the MM tempo should be given
-//    a tempo name.  Returns 0 if no guess is made.
-// 
-// Also add cases where there is a tempo marking, such as [quarter] = 132 
-// in the input text.
+// Convert::appendLittleEndian -- Append the lowest bytes of a value to
+//    a string in little-endian order (used for packed binary output).
 //
 
-int Convert::tempoNameToMm (const string& name, int bot, int top) {
-	HumRegex hre;
-	int output = -1;
-
-	if      (hre.search(name, "larghissimo"      , "i")) { output = 24;  }
-	else if (hre.search(name, "adagissimo"       , "i")) { output = 35;  }
-	else if (hre.search(name, "all.*molto"       , "i")) { output = 146; }
-	else if (hre.search(name, "all.*vivace"      , "i")) { output = 144; }
-	else if (hre.search(name, "all.*moderato"    , "i")) { output = 116; }
-	else if (hre.search(name, "all.*fuoco"       , "i")) { output = 138; }
-	else if (hre.search(name, "all.*presto"      , "i")) { output = 160; }
-	else if (hre.search(name, "grave"            , "i")) { output = 40;  }
-	else if (hre.search(name, "largo"            , "i")) { output = 45;  }
-	else if (hre.search(name, "lento?"           , "i")) { output = 50;  }
-	else if (hre.search(name, "larghetto"        , "i")) { output = 63;  }
-	else if (hre.search(name, "adagio"           , "i")) { output = 70;  }
-	else if (hre.search(name, "adagietto"        , "i")) { output = 74;  }
-	else if (hre.search(name, "andantino"        , "i")) { output = 90;  }
-	else if (hre.search(name, "marcia moderato"  , "i")) { output = 85;  }
-	else if (hre.search(name, "andante moderato" , "i")) { output = 92;  }
-	else if (hre.search(name, "allegretto"       , "i")) { output = 116; }
-	else if (hre.search(name, "rasch"            , "i")) { output = 128; }
-	else if (hre.search(name, "vivo"             , "i")) { output = 152; }
-	else if (hre.search(name, "vif"              , "i")) { output = 152; }
-	else if (hre.search(name, "vivace"           , "i")) { output = 164; }
-	else if (hre.search(name, "schnell"          , "i")) { output = 164; }
-	else if (hre.search(name, "vivacissimo"      , "i")) { output = 172; }
-	else if (hre.search(name, "allegrissimo"     , "i")) { output = 176; }
-	else if (hre.search(name, "moderato"         , "i")) { output = 108; }
-	else if (hre.search(name, "andante"          , "i")) { output = 88;  }
-	else if (hre.search(name, "presto"           , "i")) { output = 180; }
-	else if (hre.search(name, "allegro"          , "i")) { output = 128; }
-	else if (hre.search(name, "prestissimo"      , "i")) { output = 208; }
-	else if (hre.search(name, "bewegt"           , "i")) { output = 144; }
-	else if (hre.search(name, "all(?!a)"         , "i")) { output = 128; }
-
-	if (output <= 0) {
-		return output;
-	}
-
-	if (hre.search(name, "ma non troppo", "i") || hre.search(name, "non tanto")) {
-		if (output > 100) {
-			output = int(output * 0.93 + 0.5);
-		} else {
-			output = int(output / 0.93 + 0.5);
-		}
-	}
-
-	if (bot == 2) {
-		output = int(output * 1.75 + 0.5);
-	} else if (bot == 1) {
-		output = int (output * 3.0 + 0.5);
-	} else if ((bot == 8) && (top % 3 == 0)) {
-		output = int(output * 1.5 + 0.5);
-	} else if (bot == 8) {
-		output = int(output * 0.75 + 0.5);
-	} else if ((bot == 16) && (top % 3 == 0)) {
-		output = int(output * 1.5 / 2.0 + 0.5);
-	} else if (bot == 16) {
-		output = int(output / 2.0 + 0.5);
-	} else if ((bot == 32) && (top % 3 == 0)) {
-		output = int(output * 1.5 / 4.0 + 0.5);
-	} else if (bot == 32) {
-		output = int(output / 4.0 + 0.5);
+void Convert::appendLittleEndian(string& output, uint64_t value, int bytes) {
+	for (int i=0; i<bytes; i++) {
+		output.push_back((char)(value & 0xff));
+		value >>= 8;
 	}
-
-	if ((bot == 2) && (top % 3 == 0)) {
-		output = int(output * 1.5 + 0.5);
-	}
-
-	return output;
 }
 
 
@@ -6616,6 +7031,11 @@ GridSide::~GridSide(void) {
 		delete m_harmony;
 		m_harmony = NULL;
 	}
+
+	if (m_figured_bass) {
+		delete m_figured_bass;
+		m_figured_bass = NULL;
+	}
 }
 
 
@@ -7128,7 +7548,9 @@ bool GridSlice::isDataSlice(void) {
 //////////////////////////////
 //
 // GridSlice::transferTokens -- Create a HumdrumLine and append it to
-//    the data.
+//    the data.  The start time of a line for a note or grace-note slice
+//    and the durations of the notes are taken from the grid, so they do not
+//    have to be parsed again by HumdrumFileStructure::analyzeFromTokens().
 //
 
 void GridSlice::transferTokens(HumdrumFile& outfile, bool recip) {
@@ -7211,6 +7633,14 @@ void GridSlice::transferTokens(HumdrumFile& outfile, bool recip) {
 			} else {
 				for (v=0; v<(int)staff.size(); v++) {
 					if (staff.at(v) && staff.at(v)->getToken()) {
+						if (isNoteSlice() && !staff.at(v)->isNull()
+								&& staff.at(v)->getDuration().isPositive()) {
+							// Pass the duration of the note on to the analysis
+							// (see HumdrumFileStructure::analyzeFromTokens()).
+							// Tokens added without a duration are parsed.
+							staff.at(v)->getToken()->setDuration(
+									staff.at(v)->getDuration());
+						}
 						line->appendToken(staff.at(v)->getToken());
 						staff.at(v)->forgetToken();
 					} else if (!staff.at(v)) {
@@ -7247,6 +7677,9 @@ void GridSlice::transferTokens(HumdrumFile& outfile, bool recip) {
 		}
 	}
 
+	if (isNoteSlice() || isGraceSlice()) {
+		line->setDurationFromStart(getTimestamp());
+	}
 	outfile.appendLine(line);
 }
 
@@ -7364,7 +7797,9 @@ int GridSlice::getFiguredBassCount(int partindex, int staffindex) {
 
 //////////////////////////////
 //
-// GridSlice::transferSides --
+// GridSlice::transferSides -- Move the verse, dynamics, figured bass
+//     and harmony tokens to the line, which is then responsible for
+//     deleting them.
 //
 
 // this version is used to transfer Sides from the Part
@@ -7381,7 +7816,7 @@ void GridSlice::transferSides(HumdrumLine& line, GridPart& sides,
 		HTp verse = sides.getVerse(i);
 		if (verse) {
 			line.appendToken(verse);
-			sides.detachHarmony();
+			sides.setVerse(i, NULL); // needed to avoid double delete
 		} else {
 			newtoken = new HumdrumToken(empty);
 			line.appendToken(newtoken);
@@ -8600,6 +9035,264 @@ void HumAddress::setSubtrackCount(int count) {
 
 
 
+thread_local HumArena* HumArena::s_active = NULL;
+std::atomic<int> HumArena::s_retired(0);
+
+// HUMARENA_ALIGN: alignment of objects in the arena.  Each object is
+// preceded by a header of this size which stores the block which owns it
+// (or NULL if the object was allocated on the heap).
+#define HUMARENA_ALIGN (alignof(std::max_align_t))
+
+// HUMARENA_BLOCK: default size of an arena memory block.
+#define HUMARENA_BLOCK (64 * 1024)
+
+
+//////////////////////////////
+//
+// HumArena::HumArena -- Constructor.
+//
+
+HumArena::HumArena(void) {
+	m_used    = 0;
+	m_size    = 0;
+	m_objects = 0;
+	m_tokens  = NULL;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::~HumArena -- Deconstructor.
+//
+
+HumArena::~HumArena() {
+	clear();
+	if (s_active == this) {
+		s_active = NULL;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::clear -- Release all memory blocks of the arena.  Blocks
+//    which still contain undeleted objects will be freed when the last
+//    object in the block is deleted.
+//
+
+void HumArena::clear(void) {
+	for (int i=0; i<(int)m_blocks.size(); i++) {
+		if (m_blocks[i]->m_live == 0) {
+			::operator delete(m_blocks[i]);
+		} else {
+			m_blocks[i]->m_retired = true;
+			s_retired++;
+		}
+	}
+	m_blocks.clear();
+	m_used    = 0;
+	m_size    = 0;
+	m_objects = 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::getBlockCount -- Return the number of memory blocks
+//     allocated by the arena.
+//
+
+int HumArena::getBlockCount(void) const {
+	return (int)m_blocks.size();
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::getObjectCount -- Return the number of objects allocated
+//     from the arena since it was last cleared.
+//
+
+size_t HumArena::getObjectCount(void) const {
+	return m_objects;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::getRetiredBlockCount -- Return the number of memory blocks
+//     which are still in use by objects after their arena was cleared
+//     (in any thread).
+//
+
+int HumArena::getRetiredBlockCount(void) {
+	return s_retired;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::getActive -- Return the arena used for allocating lines
+//     and tokens in the current thread.  Returns NULL if objects
+//     are allocated on the heap.
+//
+
+HumArena* HumArena::getActive(void) {
+	return s_active;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::setActive -- Set the arena used for allocating lines and
+//     tokens in the current thread.  Use NULL to allocate on the heap.
+//     Returns the previously active arena so that it can be restored.
+//
+
+HumArena* HumArena::setActive(HumArena* arena) {
+	HumArena* output = s_active;
+	s_active = arena;
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::setTokenArena -- Set the arena for allocating tokens while
+//     this arena is active.  Use NULL to allocate tokens from this arena.
+//
+
+void HumArena::setTokenArena(HumArena* arena) {
+	m_tokens = arena;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::getTokenArena -- Return the arena for allocating tokens
+//     while this arena is active, or NULL if they are allocated from it.
+//
+
+HumArena* HumArena::getTokenArena(void) const {
+	return m_tokens;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::allocateObject -- Allocate memory for an object from the
+//     active arena, or from the heap if there is no active arena.
+//
+
+void* HumArena::allocateObject(size_t size) {
+	return allocateFrom(s_active, size);
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::allocateToken -- Allocate memory for a token from the token
+//     arena of the active arena (see setTokenArena()), otherwise the same
+//     as allocateObject().
+//
+
+void* HumArena::allocateToken(size_t size) {
+	if (s_active && s_active->m_tokens) {
+		return allocateFrom(s_active->m_tokens, size);
+	}
+	return allocateFrom(s_active, size);
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::allocateFrom -- Allocate memory for an object from the
+//     given arena, or from the heap if the arena is NULL.  The object
+//     is preceded by a header which stores its block.
+//
+
+void* HumArena::allocateFrom(HumArena* arena, size_t size) {
+	char* memory;
+	size_t total = size + HUMARENA_ALIGN;
+	if (arena) {
+		memory = (char*)arena->allocate(total);
+		*((HumArenaBlock**)memory) = arena->m_blocks.back();
+	} else {
+		memory = (char*)::operator new(total);
+		*((HumArenaBlock**)memory) = NULL;
+	}
+	return memory + HUMARENA_ALIGN;
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::freeObject -- Free memory allocated with allocateObject().
+//
+
+void HumArena::freeObject(void* pointer) {
+	if (pointer == NULL) {
+		return;
+	}
+	char* memory = (char*)pointer - HUMARENA_ALIGN;
+	HumArenaBlock* block = *((HumArenaBlock**)memory);
+	if (block == NULL) {
+		::operator delete(memory);
+		return;
+	}
+	block->m_live--;
+	if (block->m_retired && (block->m_live == 0)) {
+		::operator delete(block);
+		s_retired--;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumArena::allocate -- Return the next piece of memory from the
+//     current block, starting a new block if there is not enough space
+//     in it.  Objects larger than the default block size get their
+//     own block.
+//
+
+void* HumArena::allocate(size_t size) {
+	size = (size + HUMARENA_ALIGN - 1) / HUMARENA_ALIGN * HUMARENA_ALIGN;
+	if (m_blocks.empty() || (m_used + size > m_size)) {
+		size_t blocksize = HUMARENA_BLOCK;
+		if (size + HUMARENA_ALIGN > blocksize) {
+			blocksize = size + HUMARENA_ALIGN;
+		}
+		HumArenaBlock* block = (HumArenaBlock*)::operator new(blocksize);
+		block->m_live    = 0;
+		block->m_retired = false;
+		m_blocks.push_back(block);
+		m_used = HUMARENA_ALIGN;
+		m_size = blocksize;
+	}
+	char* output = (char*)m_blocks.back() + m_used;
+	m_used += size;
+	m_blocks.back()->m_live++;
+	m_objects++;
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // HumGrid::HumGrid -- Constructor.
@@ -8619,6 +9312,8 @@ HumGrid::HumGrid(void) {
 	m_musicxmlbarlines = false;
 	m_recip = false;
 	m_pickup = false;
+
+	m_arena.setTokenArena(&m_tokenarena);
 }
 
 
@@ -8663,6 +9358,31 @@ void HumGrid::enableRecipSpine(void) {
 
 
 
+//////////////////////////////
+//
+// HumGrid::getArena -- Return the arena for allocating the slices,
+//     parts, staves, voices and tokens of the grid.  Make it active
+//     with HumArena::setActive() while building the grid, so that these
+//     objects are carved out of large memory blocks.  Tokens are
+//     allocated from separate blocks (see HumArena::setTokenArena()).
+//     transferTokens() moves the grid tokens into the output file and
+//     allocates the new lines and tokens from the output file's arena
+//     (HumdrumFileBase::getArena()), so the blocks of the slices, parts,
+//     staves and voices are freed when the grid is deleted, and the
+//     token blocks when the output file is cleared.  Objects created for
+//     the output file after transferTokens() while the grid arena is
+//     still active would be allocated from the grid's blocks, so make
+//     the output file's arena active (or restore the previous one)
+//     before further editing of the file.  The previously active arena
+//     should be restored before the grid goes out of scope.
+//
+
+HumArena* HumGrid::getArena(void) {
+	return &m_arena;
+}
+
+
+
 //////////////////////////////
 //
 // HumGrid::getPartCount -- Return the number of parts in the Grid
@@ -8910,7 +9630,12 @@ void HumGrid::setVerseCount(int partindex, int staffindex, int count) {
 
 //////////////////////////////
 //
-// HumGrid::transferTokens --
+// HumGrid::transferTokens -- Create the lines of the output file from
+//   the tokens in the grid.  The lines are not analyzed: use
+//   HumdrumFileStructure::analyzeFromTokens() after adding any header or
+//   footer records instead of printing the data and reading it again
+//   (the start times of the note slices and the durations of their notes
+//   are passed on to the analysis).
 //   default value: startbarnum = 0.
 //
 
@@ -8921,15 +9646,15 @@ bool HumGrid::transferTokens(HumdrumFile& outfile, int startbarnum) {
 	}
 	calculateGridDurations();
 	addNullTokens();
-	addInvisibleRestsInFirstTrack();
-	addMeasureLines();
-	buildSingleList();  // is this needed a second time?
-	cleanTempos();
 	addLastMeasure();
-	if (manipulatorCheck()) {
+	if (finalizeSlices()) {
 		cleanupManipulators();
 	}
 
+	// Allocate the output lines and tokens from the arena of the output
+	// file so that the grid's memory blocks are not kept alive by them:
+	HumArena* gridarena = HumArena::setActive(outfile.getArena());
+
 	insertPartNames(outfile);
 	insertStaffIndications(outfile);
 	insertPartIndications(outfile);
@@ -8946,6 +9671,7 @@ bool HumGrid::transferTokens(HumdrumFile& outfile, int startbarnum) {
 		}
 	}
 	insertDataTerminationLine(outfile);
+	HumArena::setActive(gridarena);
 	return true;
 }
 
@@ -9514,81 +10240,6 @@ GridVoice* HumGrid::createVoice(const string& tok, const string& post, HumNum du
 
 
 //////////////////////////////
-//
-// HumGrid::getNextSpinedLine -- Find next spined GridSlice.
-//
-
-GridSlice* HumGrid::getNextSpinedLine(const GridMeasure::iterator& it, int measureindex) {
-	auto nextone = it;
-	nextone++;
-	while (nextone != this->at(measureindex)->end()) {
-		if ((*nextone)->hasSpines()) {
-			break;
-		}
-		nextone++;
-	}
-
-	if (nextone != this->at(measureindex)->end()) {
-		return *nextone;
-	}
-
-	measureindex++;
-	if (measureindex >= (int)this->size()) {
-		// end of data, so nothing to adjust with
-		// but this should never happen in general.
-		return NULL;
-	}
-	nextone = this->at(measureindex)->begin();
-	while (nextone != this->at(measureindex)->end()) {
-		if ((*nextone)->hasSpines()) {
-			return *nextone;
-		}
-		nextone++;
-	}
-
-	return NULL;
-}
-
-
-
-//////////////////////////////
-//
-// HumGrid::manipulatorCheck --
-//
-
-bool HumGrid::manipulatorCheck(void) {
-	GridSlice* manipulator;
-	int m;
-	GridSlice* s1;
-	GridSlice* s2;
-	bool output = false;
-	for (m=0; m<(int)this->size(); m++) {
-		if (this->at(m)->size() == 0) {
-			continue;
-		}
-		for (auto it = this->at(m)->begin(); it != this->at(m)->end(); it++) {
-			if (!(*it)->hasSpines()) {
-				// Don't monitor manipulators on no-spined lines.
-				continue;
-			}
-			s1 = *it;
-			s2 = getNextSpinedLine(it, m);
-
-			manipulator = manipulatorCheck(s1, s2);
-			if (manipulator == NULL) {
-				continue;
-			}
-			output = true;
-			auto inserter = it;
-			inserter++;
-			this->at(m)->insert(inserter, manipulator);
-			it++; // skip over the new manipulator line (expand it later)
-		}
-	}
-	return output;
-}
-
-
 //
 // HumGrid::manipulatorCheck -- Look for differences in voice/layer count
 //   for each part/staff pairing between adjacent lines.  If they do not match,
@@ -9787,86 +10438,73 @@ HTp HumGrid::createHumdrumToken(const string& tok, int pindex, int sindex) {
 
 //////////////////////////////
 //
-// HumGrid::addMeasureLines --
+// HumGrid::addMeasureLine -- Add a barline slice to the end of the
+//    given measure, with the timestamp of the start of the next measure.
+//    Returns the new slice, or NULL if no barline was added.
 //
 
-void HumGrid::addMeasureLines(void) {
-	HumNum timestamp;
-	GridSlice* mslice;
-	GridSlice* endslice;
-	GridPart* part;
-	GridStaff* staff;
-	GridVoice* gv;
-	string token;
-	int staffcount, partcount, vcount, nextvcount, lcount;
-	GridMeasure* measure = NULL;
-	GridMeasure* nextmeasure = NULL;
-
-	vector<int> barnums;
-	if (!m_musicxmlbarlines) {
-		getMetricBarNumbers(barnums);
+GridSlice* HumGrid::addMeasureLine(int m, vector<int>& barnums) {
+	GridMeasure* measure = this->at(m);
+	GridMeasure* nextmeasure = this->at(m+1);
+	if (nextmeasure->size() == 0) {
+		// next measure is empty for some reason so give up
+		return NULL;
+	}
+	GridSlice* firstspined = nextmeasure->getFirstSpinedSlice();
+	HumNum timestamp = firstspined->getTimestamp();
+	if (measure->size() == 0) {
+		return NULL;
+	}
+	if (measure->getDuration() == 0) {
+		return NULL;
 	}
 
-	for (int m=0; m<(int)this->size()-1; m++) {
-		measure = this->at(m);
-		nextmeasure = this->at(m+1);
-		if (nextmeasure->size() == 0) {
-			// next measure is empty for some reason so give up
-			continue;
-		}
-		GridSlice* firstspined = nextmeasure->getFirstSpinedSlice();
-		timestamp = firstspined->getTimestamp();
-		if (measure->size() == 0) {
-			continue;
-		}
+	GridSlice* mslice = new GridSlice(measure, timestamp, SliceType::Measures);
+	// what to do when endslice is NULL?
+	GridSlice* endslice = measure->getLastSpinedSlice(); // this has to come before next line
+	measure->push_back(mslice); // this has to come after the previous line
+	int partcount = (int)firstspined->size();
+	mslice->resize(partcount);
 
-		if (measure->getDuration() == 0) {
-			continue;
-		}
-		mslice = new GridSlice(measure, timestamp, SliceType::Measures);
-		// what to do when endslice is NULL?
-		endslice = measure->getLastSpinedSlice(); // this has to come before next line
-		measure->push_back(mslice); // this has to come after the previous line
-		partcount = (int)firstspined->size();
-		mslice->resize(partcount);
+	int num = measure->getMeasureNumber();
+	if (m < (int)barnums.size() - 1) {
+		num = barnums[m+1];
+	}
+	string token = createBarToken(m, num, measure);
 
-		for (int p=0; p<partcount; p++) {
-			part = new GridPart();
-			mslice->at(p) = part;
-			staffcount = (int)firstspined->at(p)->size();
-			mslice->at(p)->resize(staffcount);
-			for (int s=0; s<(int)staffcount; s++) {
-				staff = new GridStaff;
-				mslice->at(p)->at(s) = staff;
-
-				// insert the minimum number of barlines based on the
-				// voices in the current and next measure.
-				vcount = (int)endslice->at(p)->at(s)->size();
-				if (firstspined) {
-					nextvcount = (int)firstspined->at(p)->at(s)->size();
-				} else {
-					// perhaps an empty measure?  This will cause problems.
-					nextvcount = 0;
-				}
-				lcount = vcount;
-				if (lcount > nextvcount) {
-					lcount = nextvcount;
-				}
-				if (lcount == 0) {
-					lcount = 1;
-				}
-				for (int v=0; v<lcount; v++) {
-					int num = measure->getMeasureNumber();
-					if (m < (int)barnums.size() - 1) {
-						num = barnums[m+1];
-					}
-					token = createBarToken(m, num, measure);
-					gv = new GridVoice(token, 0);
-					mslice->at(p)->at(s)->push_back(gv);
-				}
+	for (int p=0; p<partcount; p++) {
+		GridPart* part = new GridPart();
+		mslice->at(p) = part;
+		int staffcount = (int)firstspined->at(p)->size();
+		mslice->at(p)->resize(staffcount);
+		for (int s=0; s<(int)staffcount; s++) {
+			GridStaff* staff = new GridStaff;
+			mslice->at(p)->at(s) = staff;
+
+			// insert the minimum number of barlines based on the
+			// voices in the current and next measure.
+			int vcount = (int)endslice->at(p)->at(s)->size();
+			int nextvcount;
+			if (firstspined) {
+				nextvcount = (int)firstspined->at(p)->at(s)->size();
+			} else {
+				// perhaps an empty measure?  This will cause problems.
+				nextvcount = 0;
+			}
+			int lcount = vcount;
+			if (lcount > nextvcount) {
+				lcount = nextvcount;
+			}
+			if (lcount == 0) {
+				lcount = 1;
+			}
+			for (int v=0; v<lcount; v++) {
+				GridVoice* gv = new GridVoice(token, 0);
+				mslice->at(p)->at(s)->push_back(gv);
 			}
 		}
 	}
+	return mslice;
 }
 
 
@@ -10086,138 +10724,6 @@ bool HumGrid::buildSingleList(void) {
 
 
 
-//////////////////////////////
-//
-// HumGrid::addNullTokensForGraceNotes -- Avoid grace notes at
-//     starts of measures from contracting the subspine count.
-//
-
-void HumGrid::addNullTokensForGraceNotes(void) {
-	// add null tokens for grace notes in other voices
-	GridSlice *lastnote = NULL;
-	GridSlice *nextnote = NULL;
-	for (int i=0; i<(int)m_allslices.size(); i++) {
-		if (!m_allslices[i]->isGraceSlice()) {
-			continue;
-		}
-		// cerr << "PROCESSING " << m_allslices[i] << endl;
-		lastnote = NULL;
-		nextnote = NULL;
-
-		for (int j=i+1; j<(int)m_allslices.size(); j++) {
-			if (m_allslices[j]->isNoteSlice()) {
-				nextnote = m_allslices[j];
-				break;
-			}
-		}
-		if (nextnote == NULL) {
-			continue;
-		}
-
-		for (int j=i-1; j>=0; j--) {
-			if (m_allslices[j]->isNoteSlice()) {
-				lastnote = m_allslices[j];
-				break;
-			}
-		}
-		if (lastnote == NULL) {
-			continue;
-		}
-
-		fillInNullTokensForGraceNotes(m_allslices[i], lastnote, nextnote);
-	}
-}
-
-
-
-//////////////////////////////
-//
-// HumGrid::addNullTokensForLayoutComments -- Avoid layout in multi-subspine
-//     regions from contracting to a single spine.
-//
-
-void HumGrid::addNullTokensForLayoutComments(void) {
-	// add null tokens for key changes in other voices
-	GridSlice *lastnote = NULL;
-	GridSlice *nextnote = NULL;
-	for (int i=0; i<(int)m_allslices.size(); i++) {
-		if (!m_allslices[i]->isLocalLayoutSlice()) {
-			continue;
-		}
-		// cerr << "PROCESSING " << m_allslices[i] << endl;
-		lastnote = NULL;
-		nextnote = NULL;
-
-		for (int j=i+1; j<(int)m_allslices.size(); j++) {
-			if (m_allslices[j]->isNoteSlice()) {
-				nextnote = m_allslices[j];
-				break;
-			}
-		}
-		if (nextnote == NULL) {
-			continue;
-		}
-
-		for (int j=i-1; j>=0; j--) {
-			if (m_allslices[j]->isNoteSlice()) {
-				lastnote = m_allslices[j];
-				break;
-			}
-		}
-		if (lastnote == NULL) {
-			continue;
-		}
-
-		fillInNullTokensForLayoutComments(m_allslices[i], lastnote, nextnote);
-	}
-}
-
-
-
-//////////////////////////////
-//
-// HumGrid::addNullTokensForClefChanges -- Avoid clef in multi-subspine
-//     regions from contracting to a single spine.
-//
-
-void HumGrid::addNullTokensForClefChanges(void) {
-	// add null tokens for clef changes in other voices
-	GridSlice *lastnote = NULL;
-	GridSlice *nextnote = NULL;
-	for (int i=0; i<(int)m_allslices.size(); i++) {
-		if (!m_allslices[i]->isClefSlice()) {
-			continue;
-		}
-		// cerr << "PROCESSING " << m_allslices[i] << endl;
-		lastnote = NULL;
-		nextnote = NULL;
-
-		for (int j=i+1; j<(int)m_allslices.size(); j++) {
-			if (m_allslices[j]->isNoteSlice()) {
-				nextnote = m_allslices[j];
-				break;
-			}
-		}
-		if (nextnote == NULL) {
-			continue;
-		}
-
-		for (int j=i-1; j>=0; j--) {
-			if (m_allslices[j]->isNoteSlice()) {
-				lastnote = m_allslices[j];
-				break;
-			}
-		}
-		if (lastnote == NULL) {
-			continue;
-		}
-
-		fillInNullTokensForClefChanges(m_allslices[i], lastnote, nextnote);
-	}
-}
-
-
-
 //////////////////////////////
 //
 // HumGrid::fillInNullTokensForClefChanges --
@@ -10405,7 +10911,13 @@ void HumGrid::fillInNullTokensForGraceNotes(GridSlice* graceslice, GridSlice* la
 
 //////////////////////////////
 //
-// HumGrid::addNullTokens --
+// HumGrid::addNullTokens -- Fill in the grid after the notes have been
+//    placed, in a forward sweep through the single list of slices: extend
+//    the duration of each note/rest with null tokens in the following
+//    slices.  The voice counts of a note slice are final once it is
+//    reached, so the grace-note, clef and layout slices before it are
+//    filled in at the same time.  The rest of the grid is completed by
+//    the backward sweep in finalizeSlices().
 //
 
 void HumGrid::addNullTokens(void) {
@@ -10426,13 +10938,24 @@ void HumGrid::addNullTokens(void) {
 		}
 	}
 
+	// non-note slices since the last note slice:
+	vector<GridSlice*> pending;
+	GridSlice* lastnote = NULL;
+
 	for (i=0; i<(int)m_allslices.size(); i++) {
 
 		GridSlice& slice = *m_allslices.at(i);
 		if (!slice.isNoteSlice()) {
 			// probably need to deal with grace note slices here
+			pending.push_back(&slice);
 			continue;
 		}
+		if (lastnote) {
+			fillInNullTokens(pending, lastnote, &slice);
+		}
+		pending.clear();
+		lastnote = &slice;
+
       for (p=0; p<(int)slice.size(); p++) {
 			GridPart& part = *slice.at(p);
       	for (s=0; s<(int)part.size(); s++) {
@@ -10456,78 +10979,249 @@ void HumGrid::addNullTokens(void) {
 
 	}
 
-	addNullTokensForGraceNotes();
 	adjustClefChanges();
-	addNullTokensForClefChanges();
-	addNullTokensForLayoutComments();
-	checkForNullDataHoles();
 }
 
 
 
 //////////////////////////////
 //
-// HumGrid::checkForNullData -- identify any spots in the grid which are NULL
-//     pointers and allocate invisible rests for them by finding the next
-//     durational item in the particular staff/layer.
+// HumGrid::finalizeSlices -- Second (backward) sweep through the single
+//    list of slices after addNullTokens() and addLastMeasure():
+//
+//    (1) Allocate invisible rests for holes in note slices and for timing
+//        gaps in the first voice of each staff.  These only look at later
+//        slices, which are already complete.
+//    (2) Add a barline slice at the end of each measure (except the last
+//        one, which addLastMeasure() has done).
+//    (3) Clean tempo slices.
+//    (4) Find the spined slices whose voice counts differ from those of
+//        the next spined slice in the same or following measure.  A
+//        manipulator slice is inserted after each of them (in forward
+//        order after the sweep, since manipulatorCheck() may print
+//        warnings).  Returns true if any manipulators were added (they
+//        still need to be expanded with cleanupManipulators()).
+//
+//    The single list of slices is rebuilt in the same sweep to include
+//    the barlines (but not the final barline or the manipulators), with
+//    the slice durations recalculated from the timestamps.  The old list
+//    is still used by (1) until the sweep is finished.
 //
 
-void HumGrid::checkForNullDataHoles(void) {
-	for (int i=0; i<(int)m_allslices.size(); i++) {
-		GridSlice& slice = *m_allslices.at(i);
-		if (!slice.isNoteSlice()) {
+bool HumGrid::finalizeSlices(void) {
+	vector<int> barnums;
+	if (!m_musicxmlbarlines) {
+		getMetricBarNumbers(barnums);
+	}
+
+	vector<vector<GridSlice*>> nextevent;
+	setPartStaffDimensions(nextevent, m_allslices.back());
+
+	// The new list is filled from the end:
+	vector<GridSlice*> slices(m_allslices.size() + this->size());
+	int k = (int)slices.size();
+
+	// Pairs of adjacent spined slices which need a manipulator check:
+	class ManipulatorCheck {
+		public:
+			GridSlice* slice;  // spined slice to insert a manipulator after
+			GridSlice* next;   // next spined slice
+			int measure;       // measure index of slice
+	};
+	vector<ManipulatorCheck> checks;
+	GridSlice* nextspined = NULL; // next spined slice (except manipulators)
+	int nextmeasure = -1;         // measure index of nextspined
+	int m = (int)this->size() - 1;
+	while ((m >= 0) && this->at(m)->empty()) {
+		m--;
+	}
+	if ((m >= 0) && this->at(m)->back()->isMeasureSlice()) {
+		// final barline from addLastMeasure()
+		nextspined = this->at(m)->back();
+		nextmeasure = m;
+	}
+
+	for (int i=(int)m_allslices.size()-1; i>=0; i--) {
+		GridSlice* slice = m_allslices[i];
+		if (slice->isNoteSlice()) {
+			checkForNullDataHoles(i);
+			addInvisibleRestsInFirstTrack(nextevent, i);
+		}
+
+		GridSlice* barline = NULL;
+		if ((m >= 0) && (m < (int)this->size() - 1) && (slice == this->at(m)->back())) {
+			barline = addMeasureLine(m, barnums);
+		}
+		GridSlice* current = barline ? barline : slice;
+		while (current) {
+			if (k < (int)slices.size()) {
+				current->setDuration(slices[k]->getTimestamp() - current->getTimestamp());
+			}
+			slices[--k] = current;
+			if (current->isTempoSlice()) {
+				cleanTempos(current);
+			}
+			if (current->hasSpines()) {
+				if (((nextmeasure == m) || (nextmeasure == m + 1))
+						&& !hasSameVoiceCounts(current, nextspined)) {
+					checks.push_back({current, nextspined, m});
+				}
+				nextspined = current;
+				nextmeasure = m;
+			}
+			current = (current == barline) ? slice : NULL;
+		}
+
+		if ((m >= 0) && (slice == this->at(m)->front())) {
+			m--;
+			while ((m >= 0) && this->at(m)->empty()) {
+				m--;
+			}
+		}
+	}
+
+	slices.erase(slices.begin(), slices.begin() + k);
+	m_allslices.swap(slices);
+
+	bool output = false;
+	for (int i=(int)checks.size()-1; i>=0; i--) {
+		GridSlice* manipulator = manipulatorCheck(checks[i].slice, checks[i].next);
+		if (!manipulator) {
 			continue;
 		}
-      for (int p=0; p<(int)slice.size(); p++) {
-			GridPart& part = *slice.at(p);
-      	for (int s=0; s<(int)part.size(); s++) {
-				GridStaff& staff = *part.at(s);
-      		for (int v=0; v<(int)staff.size(); v++) {
-					if (!staff.at(v)) {
-						staff.at(v) = new GridVoice();
-						// Calculate duration of void by searching
-						// for the next non-null voice in the current part/staff/voice
-						HumNum duration = slice.getDuration();
-						GridPart *pp;
-						GridStaff *sp;
-						GridVoice *vp;
-						for (int q=i+1; q<(int)m_allslices.size(); q++) {
-							GridSlice *slicep = m_allslices.at(q);
-							if (!slicep->isNoteSlice()) {
-								// or isDataSlice()?
-								continue;
-							}
-							if (p >= (int)slicep->size() - 1) {
-								continue;
-							}
-							pp = slicep->at(p);
-							if (s >= (int)pp->size() - 1) {
-								continue;
-							}
-							sp = pp->at(s);
-							if (v >= (int)sp->size() - 1) {
-								// Found a data line with no data at given voice, so
-								// add slice duration to cumulative duration.
-								duration += slicep->getDuration();
-								continue;
-							}
-							vp = sp->at(v);
-							if (!vp) {
-								// found another null spot which should be dealt with later.
-								break;
+		output = true;
+		GridMeasure* measure = this->at(checks[i].measure);
+		auto it = std::find(measure->begin(), measure->end(), checks[i].slice);
+		measure->insert(++it, manipulator);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// HumGrid::hasSameVoiceCounts -- Returns true if two spined slices have
+//    the same number of parts, staves and voices (an empty staff counts
+//    as one voice), so that manipulatorCheck() would not need to insert
+//    a manipulator or print a warning.
+//
+
+bool HumGrid::hasSameVoiceCounts(GridSlice* ice1, GridSlice* ice2) {
+	if ((ice1 == NULL) || (ice2 == NULL)) {
+		return true;
+	}
+	if (ice1->size() != ice2->size()) {
+		return false;
+	}
+	for (int p=0; p<(int)ice1->size(); p++) {
+		GridPart* part1 = ice1->at(p);
+		GridPart* part2 = ice2->at(p);
+		if (part1->size() != part2->size()) {
+			return false;
+		}
+		for (int s=0; s<(int)part1->size(); s++) {
+			int v1count = std::max(1, (int)part1->at(s)->size());
+			int v2count = std::max(1, (int)part2->at(s)->size());
+			if (v1count != v2count) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumGrid::fillInNullTokens -- Add null tokens to the grace-note, clef and
+//     layout slices between two note slices, so that they do not contract
+//     the subspine count.  Grace notes at the starts of measures, and clefs
+//     and layout comments in multi-subspine regions are the usual cases.
+//
+
+void HumGrid::fillInNullTokens(vector<GridSlice*>& slices, GridSlice* lastnote,
+		GridSlice* nextnote) {
+	for (int i=0; i<(int)slices.size(); i++) {
+		if (slices[i]->isGraceSlice()) {
+			fillInNullTokensForGraceNotes(slices[i], lastnote, nextnote);
+		}
+		if (slices[i]->isClefSlice()) {
+			fillInNullTokensForClefChanges(slices[i], lastnote, nextnote);
+		}
+		if (slices[i]->isLocalLayoutSlice()) {
+			fillInNullTokensForLayoutComments(slices[i], lastnote, nextnote);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumGrid::checkForNullDataHoles -- identify any spots in a note slice which
+//     are NULL pointers and allocate invisible rests for them by finding the
+//     next durational item in the particular staff/layer.
+//
+
+void HumGrid::checkForNullDataHoles(int i) {
+	GridSlice& slice = *m_allslices.at(i);
+	for (int p=0; p<(int)slice.size(); p++) {
+		GridPart& part = *slice.at(p);
+		for (int s=0; s<(int)part.size(); s++) {
+			GridStaff& staff = *part.at(s);
+			for (int v=0; v<(int)staff.size(); v++) {
+				if (!staff.at(v)) {
+					staff.at(v) = new GridVoice();
+					// Calculate duration of void by searching
+					// for the next non-null voice in the current part/staff/voice
+					HumNum duration = slice.getDuration();
+					GridPart *pp;
+					GridStaff *sp;
+					GridVoice *vp;
+					for (int q=i+1; q<(int)m_allslices.size(); q++) {
+						GridSlice *slicep = m_allslices.at(q);
+						if (!slicep->isNoteSlice()) {
+							// or isDataSlice()?
+							continue;
+						}
+						if (p >= (int)slicep->size() - 1) {
+							continue;
+						}
+						pp = slicep->at(p);
+						if (s >= (int)pp->size() - 1) {
+							continue;
+						}
+						sp = pp->at(s);
+						if (v >= (int)sp->size() - 1) {
+							// Found a data line with no data at given voice, so
+							// add slice duration to cumulative duration.  Use the
+							// timestamps since finalizeSlices() may already have
+							// recalculated the durations of later slices.
+							if (q < (int)m_allslices.size() - 1) {
+								duration += m_allslices[q+1]->getTimestamp() - slicep->getTimestamp();
 							} else {
-								// there is a token at the same part/staff/voice position.
-								// Maybe check if a null token, but if not a null token,
-								// then break here also.
-								break;
+								duration += slicep->getDuration();
 							}
+							continue;
+						}
+						vp = sp->at(v);
+						if (!vp) {
+							// found another null spot which should be dealt with later.
+							break;
+						} else {
+							// there is a token at the same part/staff/voice position.
+							// Maybe check if a null token, but if not a null token,
+							// then break here also.
+							break;
 						}
-						string recip = Convert::durationToRecip(duration);
-						// ggg @ marker is added to keep track of them for more debugging.
-						recip += "ryy@";
-						staff.at(v)->setToken(recip);
-						continue;
 					}
+					string recip = Convert::durationToRecip(duration);
+					// ggg @ marker is added to keep track of them for more debugging.
+					recip += "ryy@";
+					staff.at(v)->setToken(recip);
+					continue;
 				}
 			}
 		}
@@ -10566,54 +11260,60 @@ void HumGrid::setPartStaffDimensions(vector<vector<GridSlice*>>& nextevent,
 //
 // HumGrid::addInvisibleRestsInFirstTrack --  If there are any
 //    timing gaps in the first track of a **kern spine, then
-//    fill in with invisible rests.
+//    fill in with invisible rests.  The slices must be processed
+//    from the end of the list to the start.
 //
 // ggg
 
 void HumGrid::addInvisibleRestsInFirstTrack(void) {
-	int i; // slice index
-	int p; // part index
-	int s; // staff index
-	int v = 0; // only looking at first voice
-
 	vector<vector<GridSlice*>> nextevent;
 	GridSlice* lastslice = m_allslices.back();
 	setPartStaffDimensions(nextevent, lastslice);
 
-	for (i=(int)m_allslices.size()-1; i>=0; i--) {
-		GridSlice& slice = *m_allslices.at(i);
-		if (!slice.isNoteSlice()) {
+	for (int i=(int)m_allslices.size()-1; i>=0; i--) {
+		if (!m_allslices[i]->isNoteSlice()) {
 			continue;
 		}
-      for (p=0; p<(int)slice.size(); p++) {
-			GridPart& part = *slice.at(p);
-      	for (s=0; s<(int)part.size(); s++) {
-				GridStaff& staff = *part.at(s);
-				if (staff.size() == 0) {
-					// cerr << "EMPTY STAFF VOICE WILL BE FILLED IN LATER!!!!" << endl;
-					continue;
-				}
-				if (!staff.at(v)) {
-					// in theory should not happen
-					continue;
-				}
-				GridVoice& gv = *staff.at(v);
-				if (gv.isNull()) {
-					continue;
-				}
+		addInvisibleRestsInFirstTrack(nextevent, i);
+	}
+}
 
-				// Found a note/rest.  Check if its duration matches
-				// the next non-null data token.  If not, then add
-				// an invisible rest somewhere between the two
 
-				// first check to see if the previous item is a
-				// NULL.  If so, then store and continue.
-				if (nextevent[p][s] == NULL) {
-					nextevent[p][s] = &slice;
-					continue;
-				}
-				addInvisibleRest(nextevent, i, p, s);
+void HumGrid::addInvisibleRestsInFirstTrack(vector<vector<GridSlice*>>& nextevent,
+		int i) {
+	int p; // part index
+	int s; // staff index
+	int v = 0; // only looking at first voice
+
+	GridSlice& slice = *m_allslices.at(i);
+	for (p=0; p<(int)slice.size(); p++) {
+		GridPart& part = *slice.at(p);
+		for (s=0; s<(int)part.size(); s++) {
+			GridStaff& staff = *part.at(s);
+			if (staff.size() == 0) {
+				// cerr << "EMPTY STAFF VOICE WILL BE FILLED IN LATER!!!!" << endl;
+				continue;
+			}
+			if (!staff.at(v)) {
+				// in theory should not happen
+				continue;
 			}
+			GridVoice& gv = *staff.at(v);
+			if (gv.isNull()) {
+				continue;
+			}
+
+			// Found a note/rest.  Check if its duration matches
+			// the next non-null data token.  If not, then add
+			// an invisible rest somewhere between the two
+
+			// first check to see if the previous item is a
+			// NULL.  If so, then store and continue.
+			if (nextevent[p][s] == NULL) {
+				nextevent[p][s] = &slice;
+				continue;
+			}
+			addInvisibleRest(nextevent, i, p, s);
 		}
 	}
 }
@@ -11917,23 +12617,11 @@ string HumHash::getValue(const string& ns2, const string& key) const {
 
 string HumHash::getValue(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return "";
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return "";
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return "";
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return "";
 	}
-	return it3->second;
+	return entry->value;
 }
 
 
@@ -11950,7 +12638,7 @@ HTp HumHash::getValueHTp(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueHTp("", "", keys[2]);
+		return getValueHTp("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueHTp(keys[0], keys[1]);
 	} else {
@@ -12006,7 +12694,7 @@ int HumHash::getValueInt(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueInt("", "", keys[2]);
+		return getValueInt("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueInt(keys[0], keys[1]);
 	} else {
@@ -12111,7 +12799,7 @@ double HumHash::getValueFloat(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueFloat("", "", keys[2]);
+		return getValueFloat("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueFloat(keys[0], keys[1]);
 	} else {
@@ -12165,7 +12853,7 @@ double HumHash::getValueFloat(const string& ns1, const string& ns2,
 bool HumHash::getValueBool(const string& key) const {
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return getValueBool("", "", keys[2]);
+		return getValueBool("", "", keys[0]);
 	} else if (keys.size() == 2) {
 		return getValueBool(keys[0], keys[1]);
 	} else {
@@ -12184,12 +12872,13 @@ bool HumHash::getValueBool(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return false;
 	}
-	if (!isDefined(ns1, ns2, key)) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return false;
 	}
-	if ((*parameters)[ns1][ns2][key] == "false") {
+	if (entry->value == "false") {
 		return false;
-	} else if ((*parameters)[ns1][ns2][key] == "0") {
+	} else if (entry->value == "0") {
 		return false;
 	} else {
 		return true;
@@ -12231,7 +12920,17 @@ void HumHash::setValue(const string& ns2, const string& key,
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, const string& value) {
 	initializeParameters();
-	(*parameters)[ns1][ns2][key] = value;
+	size_t index = findIndex(ns1, ns2, key);
+	if ((index < parameters->size()) &&
+			(compareEntry((*parameters)[index], ns1, ns2, key) == 0)) {
+		(*parameters)[index].value = value;
+		return;
+	}
+	auto it = parameters->insert(parameters->begin() + index, HumHashEntry());
+	it->ns1 = ns1;
+	it->ns2 = ns2;
+	it->key = key;
+	it->value = value;
 }
 
 
@@ -12271,10 +12970,7 @@ void HumHash::setValue(const string& ns2, const string& key, int value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, int value) {
-	initializeParameters();
-	stringstream ss;
-	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(ns1, ns2, key, to_string(value));
 }
 
 
@@ -12297,10 +12993,7 @@ void HumHash::setValue(const string& ns2, const string& key, HTp value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HTp value) {
-	initializeParameters();
-	stringstream ss;
-	ss << "HT_" << ((long long)value);
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(ns1, ns2, key, "HT_" + to_string((long long)value));
 }
 
 
@@ -12323,10 +13016,9 @@ void HumHash::setValue(const string& ns2, const string& key, HumNum value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, HumNum value) {
-	initializeParameters();
 	stringstream ss;
 	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(ns1, ns2, key, ss.str());
 }
 
 
@@ -12349,10 +13041,9 @@ void HumHash::setValue(const string& ns2, const string& key, double value) {
 
 void HumHash::setValue(const string& ns1, const string& ns2,
 		const string& key, double value) {
-	initializeParameters();
 	stringstream ss;
 	ss << value;
-	(*parameters)[ns1][ns2][key] = ss.str();
+	setValue(ns1, ns2, key, ss.str());
 }
 
 
@@ -12369,8 +13060,10 @@ map<string, string> HumHash::getParameters(const string& ns1, const string& ns2)
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it : (*parameters)[ns1][ns2]) {
-		output[it.first] = it.second;
+	size_t index = findIndex(ns1, ns2, "");
+	size_t end = findNamespaceEnd(index, ns1, ns2);
+	for (size_t i=index; i<end; i++) {
+		output[(*parameters)[i].key] = (*parameters)[i].value;
 	}
 	return output;
 }
@@ -12410,8 +13103,10 @@ vector<string> HumHash::getKeys(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it : (*parameters)[ns1][ns2]) {
-		output.push_back(it.first);
+	size_t index = findIndex(ns1, ns2, "");
+	size_t end = findNamespaceEnd(index, ns1, ns2);
+	for (size_t i=index; i<end; i++) {
+		output.push_back((*parameters)[i].key);
 	}
 	return output;
 }
@@ -12429,10 +13124,10 @@ vector<string> HumHash::getKeys(const string& ns) const {
 		return getKeys(ns1, ns2);
 	}
 
-	for (auto& it1 : (*parameters)[ns]) {
-		for (auto& it2 : it1.second) {
-			output.push_back(it1.first + ":" + it2.first);
-		}
+	size_t index = findIndex(ns, "", "");
+	size_t end = findNamespaceEnd(index, ns);
+	for (size_t i=index; i<end; i++) {
+		output.push_back((*parameters)[i].ns2 + ":" + (*parameters)[i].key);
 	}
 	return output;
 }
@@ -12443,12 +13138,8 @@ vector<string> HumHash::getKeys(void) const {
 	if (parameters == NULL) {
 		return output;
 	}
-	for (auto& it1 : (*parameters)) {
-		for (auto& it2 : it1.second) {
-			for (auto it3 : it2.second) {
-				output.push_back(it1.first + ":" + it2.first + ":" + it3.first);
-			}
-		}
+	for (auto& entry : *parameters) {
+		output.push_back(entry.ns1 + ":" + entry.ns2 + ":" + entry.key);
 	}
 	return output;
 }
@@ -12469,19 +13160,8 @@ bool HumHash::hasParameters(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return false;
 	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
-		return false;
-	}
-	auto it2 = (*parameters)[ns1].find(ns2);
-	if (it2 == (*parameters)[ns1].end()) {
-		return false;
-	} else {
-		return true;
-	}
+	size_t index = findIndex(ns1, ns2, "");
+	return findNamespaceEnd(index, ns1, ns2) > index;
 }
 
 
@@ -12496,12 +13176,8 @@ bool HumHash::hasParameters(const string& ns) const {
 		return hasParameters(ns1, ns2);
 	}
 
-	auto it = parameters->find(ns);
-	if (it == parameters->end()) {
-		return false;
-	} else {
-		return true;
-	}
+	size_t index = findIndex(ns, "", "");
+	return findNamespaceEnd(index, ns) > index;
 }
 
 
@@ -12509,19 +13185,7 @@ bool HumHash::hasParameters(void) const {
 	if (parameters == NULL) {
 		return false;
 	}
-	if (parameters->size() == 0) {
-		return false;
-	}
-	for (auto& it1 : *parameters) {
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			} else {
-				return true;
-			}
-		}
-	}
-	return false;
+	return !parameters->empty();
 }
 
 
@@ -12541,18 +13205,8 @@ int HumHash::getParameterCount(const string& ns1, const string& ns2) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
-		return 0;
-	}
-	auto it1 = parameters->find(ns1);
-	if (it1 == parameters->end()) {
-		return 0;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return 0;
-	}
-	return (int)it2->second.size();
+	size_t index = findIndex(ns1, ns2, "");
+	return (int)(findNamespaceEnd(index, ns1, ns2) - index);
 }
 
 
@@ -12567,15 +13221,8 @@ int HumHash::getParameterCount(const string& ns) const {
 		return getParameterCount(ns1, ns2);
 	}
 
-	auto it1 = parameters->find(ns);
-	if (it1 == parameters->end()) {
-		return false;
-	}
-	int sum = 0;
-	for (auto& it2 : it1->second) {
-		sum += (int)it2.second.size();
-	}
-	return sum;
+	size_t index = findIndex(ns, "", "");
+	return (int)(findNamespaceEnd(index, ns) - index);
 }
 
 
@@ -12583,16 +13230,7 @@ int HumHash::getParameterCount(void) const {
 	if (parameters == NULL) {
 		return 0;
 	}
-	if (parameters->size() == 0) {
-		return 0;
-	}
-	int sum = 0;
-	for (auto& it1 : (*parameters)) {
-		for (auto& it2 : it1.second) {
-			sum += (int)it2.second.size();
-		}
-	}
-	return sum;
+	return (int)parameters->size();
 }
 
 
@@ -12611,11 +13249,11 @@ bool HumHash::isDefined(const string& key) const {
 	}
 	vector<string> keys = getKeyList(key);
 	if (keys.size() == 1) {
-		return (*parameters)[""][""].count(keys[0]) ? true : false;
+		return isDefined("", "", keys[0]);
 	} else if (keys.size() == 2) {
-		return (*parameters)[""][keys[0]].count(keys[1]) ? true : false;
+		return isDefined("", keys[0], keys[1]);
 	} else {
-		return (*parameters)[keys[0]][keys[1]].count(keys[2]) ? true : false;
+		return isDefined(keys[0], keys[1], keys[2]);
 	}
 }
 
@@ -12624,7 +13262,7 @@ bool HumHash::isDefined(const string& ns2, const string& key) const {
 	if (parameters == NULL) {
 		return false;
 	}
-	return (*parameters)[""][ns2].count(key) ? true : false;
+	return isDefined("", ns2, key);
 }
 
 
@@ -12633,7 +13271,7 @@ bool HumHash::isDefined(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return false;
 	}
-	return (*parameters)[ns1][ns2].count(key) ? true : false;
+	return findEntry(ns1, ns2, key) != NULL;
 }
 
 
@@ -12673,36 +13311,130 @@ void HumHash::deleteValue(const string& ns1, const string& ns2,
 	if (parameters == NULL) {
 		return;
 	}
-	(*parameters)[ns1][ns2].erase(key);
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry != NULL) {
+		parameters->erase(parameters->begin() + (entry - parameters->data()));
+	}
+}
 
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return;
+
+
+//////////////////////////////
+//
+// HumHash::initializeParameters -- Create the parameter list if it does not
+//     already exist.
+//
+
+void HumHash::initializeParameters(void) {
+	if (parameters == NULL) {
+		parameters = new HumHashList;
 	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findEntry -- Return the parameter for the given namespaces
+//     and key, or NULL if it is not defined.
+//
+
+HumHashEntry* HumHash::findEntry(const string& ns1, const string& ns2,
+		const string& key) const {
+	if (parameters == NULL) {
+		return NULL;
 	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return;
+	size_t index = findIndex(ns1, ns2, key);
+	if (index >= parameters->size()) {
+		return NULL;
 	}
-	it2->second.erase(key);
+	HumHashEntry& entry = (*parameters)[index];
+	if (compareEntry(entry, ns1, ns2, key) != 0) {
+		return NULL;
+	}
+	return &entry;
 }
 
 
 
 //////////////////////////////
 //
-// HumHash::initializeParameters -- Create the map structure if it does not
-//     already exist.
+// HumHash::findIndex -- Binary search for the index of the first parameter
+//     which does not sort before the given namespaces and key.  Returns
+//     the size of the parameter list if all parameters sort before it.
+//     Giving an empty key (and NS2) returns the index of the first
+//     parameter in the namespace.
 //
 
-void HumHash::initializeParameters(void) {
+size_t HumHash::findIndex(const string& ns1, const string& ns2,
+		const string& key) const {
+	size_t low = 0;
+	size_t high = parameters ? parameters->size() : 0;
+	while (low < high) {
+		size_t mid = (low + high) / 2;
+		if (compareEntry((*parameters)[mid], ns1, ns2, key) < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::findNamespaceEnd -- Return the index after the last parameter
+//     (starting at the given index) which is in the given namespace.
+//
+
+size_t HumHash::findNamespaceEnd(size_t index, const string& ns1) const {
 	if (parameters == NULL) {
-		parameters = new MapNNKV;
+		return 0;
 	}
+	while ((index < parameters->size()) && ((*parameters)[index].ns1 == ns1)) {
+		index++;
+	}
+	return index;
+}
+
+
+size_t HumHash::findNamespaceEnd(size_t index, const string& ns1,
+		const string& ns2) const {
+	if (parameters == NULL) {
+		return 0;
+	}
+	while (index < parameters->size()) {
+		HumHashEntry& entry = (*parameters)[index];
+		if ((entry.ns1 != ns1) || (entry.ns2 != ns2)) {
+			break;
+		}
+		index++;
+	}
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// HumHash::compareEntry -- Compare a parameter to the given namespaces
+//     and key.  Returns a negative number if the parameter sorts before
+//     them, zero if equal, and a positive number if it sorts after them.
+//
+
+int HumHash::compareEntry(const HumHashEntry& entry, const string& ns1,
+		const string& ns2, const string& key) {
+	int status = entry.ns1.compare(ns1);
+	if (status != 0) {
+		return status;
+	}
+	status = entry.ns2.compare(ns2);
+	if (status != 0) {
+		return status;
+	}
+	return entry.key.compare(key);
 }
 
 
@@ -12714,11 +13446,16 @@ void HumHash::initializeParameters(void) {
 //
 
 vector<string> HumHash::getKeyList(const string& keys) const {
-	stringstream ss(keys);
-	string key;
 	vector<string> output;
-	while (getline(ss, key, ':')) {
-		output.push_back(key);
+	size_t start = 0;
+	while (start < keys.size()) {
+		size_t loc = keys.find(':', start);
+		if (loc == string::npos) {
+			output.push_back(keys.substr(start));
+			break;
+		}
+		output.push_back(keys.substr(start, loc - start));
+		start = loc + 1;
 	}
 	if (output.size() == 0) {
 		output.push_back(keys);
@@ -12798,23 +13535,11 @@ void HumHash::setOrigin(const string& ns2, const string& key,
 
 void HumHash::setOrigin(const string& ns1, const string& ns2,
 		const string& key, HumdrumToken* tok) {
-	if (parameters == NULL) {
-		return;
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return;
 	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
-		return;
-	}
-	it3->second.origin = tok;
+	entry->value.origin = tok;
 }
 
 
@@ -12858,23 +13583,11 @@ HumdrumToken* HumHash::getOrigin(const string& ns2, const string& key) const {
 
 HumdrumToken* HumHash::getOrigin(const string& ns1, const string& ns2,
 		const string& key) const {
-	if (parameters == NULL) {
-		return NULL;
-	}
-	MapNNKV& p = *parameters;
-	auto it1 = p.find(ns1);
-	if (it1 == p.end()) {
-		return NULL;
-	}
-	auto it2 = it1->second.find(ns2);
-	if (it2 == it1->second.end()) {
-		return NULL;
-	}
-	auto it3 = it2->second.find(key);
-	if (it3 == it2->second.end()) {
+	HumHashEntry* entry = findEntry(ns1, ns2, key);
+	if (entry == NULL) {
 		return NULL;
 	}
-	return it3->second.origin;
+	return entry->value.origin;
 }
 
 
@@ -12896,32 +13609,33 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 
 	stringstream str;
 	bool found = 0;
+	HumHashList& p = *parameters;
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
-		if (it1.second.size() == 0) {
-			continue;
-		}
+	size_t i1 = 0;
+	while (i1 < p.size()) {
+		const string& ns1 = p[i1].ns1;
+		size_t end1 = findNamespaceEnd(i1, ns1);
 		if (!found) {
 			found = 1;
 		}
 		str << Convert::repeatString(indent, level++);
-		str << "<namespace n=\"1\" name=\"" << it1.first << "\">\n";
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			}
+		str << "<namespace n=\"1\" name=\"" << ns1 << "\">\n";
+		size_t i2 = i1;
+		while (i2 < end1) {
+			const string& ns2 = p[i2].ns2;
+			size_t end2 = findNamespaceEnd(i2, ns1, ns2);
 
 			str << Convert::repeatString(indent, level++);
-			str << "<namespace n=\"2\" name=\"" << it2.first << "\">\n";
+			str << "<namespace n=\"2\" name=\"" << ns2 << "\">\n";
 
-			for (auto& it3 : it2.second) {
+			for (size_t i3=i2; i3<end2; i3++) {
 				str << Convert::repeatString(indent, level);
-				str << "<parameter key=\"" << it3.first << "\"";
+				str << "<parameter key=\"" << p[i3].key << "\"";
 				str << " value=\"";
-				str << Convert::encodeXml(it3.second) << "\"";
-				ref = it3.second.origin;
+				str << Convert::encodeXml(p[i3].value) << "\"";
+				ref = p[i3].value.origin;
 				if (ref != NULL) {
 					str << " idref=\"";
 					str << ref->getXmlId();
@@ -12930,8 +13644,10 @@ ostream& HumHash::printXml(ostream& out, int level, const string& indent) {
 				str << "/>\n";
 			}
 			str << Convert::repeatString(indent, --level) << "</namespace>\n";
+			i2 = end2;
 		}
 		str << Convert::repeatString(indent, --level) << "</namespace>\n";
+		i1 = end1;
 	}
 	if (found) {
 		str << Convert::repeatString(indent, --level) << "</parameters>\n";
@@ -12966,51 +13682,54 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 	string it2str;
 	int str2count = 0;
 	bool found = 0;
+	HumHashList& p = *parameters;
 
 	HumdrumToken* ref = NULL;
 	level++;
-	for (auto& it1 : *(parameters)) {
-		if (it1.second.size() == 0) {
-			continue;
-		}
+	size_t i1 = 0;
+	while (i1 < p.size()) {
+		const string& ns1 = p[i1].ns1;
+		size_t end1 = findNamespaceEnd(i1, ns1);
 		str2.str("");
-		it1str = it1.first;
+		it1str = ns1;
 		if (!found) {
 			found = 1;
 		}
-		if (it1.first == "") {
+		if (ns1 == "") {
 			str2 << Convert::repeatString(indent, level++);
-			str2 << "<namespace n=\"1\" name=\"" << it1.first << "\">\n";
+			str2 << "<namespace n=\"1\" name=\"" << ns1 << "\">\n";
 		} else {
 			str << Convert::repeatString(indent, level++);
-			str << "<namespace n=\"1\" name=\"" << it1.first << "\">\n";
+			str << "<namespace n=\"1\" name=\"" << ns1 << "\">\n";
 		}
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			}
-			it2str = it2.first;
+		size_t i2 = i1;
+		while (i2 < end1) {
+			const string& ns2 = p[i2].ns2;
+			size_t end2 = findNamespaceEnd(i2, ns1, ns2);
+			it2str = ns2;
 
-			if ((it2.first == "") && (it2.first == "")) {
+			if (ns2 == "") {
 				str2 << Convert::repeatString(indent, level++);
-				str2 << "<namespace n=\"2\" name=\"" << it2.first << "\">\n";
+				str2 << "<namespace n=\"2\" name=\"" << ns2 << "\">\n";
 			} else {
 				str << Convert::repeatString(indent, level++);
-				str << "<namespace n=\"2\" name=\"" << it2.first << "\">\n";
+				str << "<namespace n=\"2\" name=\"" << ns2 << "\">\n";
 			}
 
-			for (auto& it3 : it2.second) {
-				if ((it2.first == "") && (it2.first == "")) {
+			for (size_t i3=i2; i3<end2; i3++) {
+				const string& key = p[i3].key;
+				HumParameter& value = p[i3].value;
+				if (ns2 == "") {
 
-					if ((it3.first == "global") && (it3.second == "true")) {
+					if ((key == "global") && (value == "true")) {
 						// don't do anything because parameter should be removed
 					} else {
 						str2count++;
 						str2 << Convert::repeatString(indent, level);
-						str2 << "<parameter key=\"" << it3.first << "\"";
+						str2 << "<parameter key=\"" << key << "\"";
 						str2 << " value=\"";
-						str2 << Convert::encodeXml(it3.second) << "\"";
-						ref = it3.second.origin;
+						str2 << Convert::encodeXml(value) << "\"";
+						ref = value.origin;
 						if (ref != NULL) {
 							str2 << " idref=\"";
 							str2 << ref->getXmlId();
@@ -13020,10 +13739,10 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 					}
 				} else {
 					str << Convert::repeatString(indent, level);
-					str << "<parameter key=\"" << it3.first << "\"";
+					str << "<parameter key=\"" << key << "\"";
 					str << " value=\"";
-					str << Convert::encodeXml(it3.second) << "\"";
-					ref = it3.second.origin;
+					str << Convert::encodeXml(value) << "\"";
+					ref = value.origin;
 					if (ref != NULL) {
 						str << " idref=\"";
 						str << ref->getXmlId();
@@ -13040,6 +13759,7 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 			} else {
 				str << Convert::repeatString(indent, --level) << "</namespace>\n";
 			}
+			i2 = end2;
 		}
 		if ((it1str == "") && (it2str == "")) {
 			if (str2count > 0) {
@@ -13048,6 +13768,7 @@ ostream& HumHash::printXmlAsGlobal(ostream& out, int level,
 		} else {
 			str << Convert::repeatString(indent, --level) << "</namespace>\n";
 		}
+		i1 = end1;
 	}
 	if (found) {
 		str << Convert::repeatString(indent, --level) << "</parameters>\n";
@@ -13074,27 +13795,22 @@ ostream& operator<<(ostream& out, const HumHash& hash) {
 	}
 
 	string cleaned;
+	HumHashList& p = *(hash.parameters);
 
-	for (auto& it1 : *(hash.parameters)) {
-		if (it1.second.size() == 0) {
-			continue;
-		}
-		for (auto& it2 : it1.second) {
-			if (it2.second.size() == 0) {
-				continue;
-			}
-			out << hash.prefix;
-			out << it1.first << ":" << it2.first;
-			for (auto& it3 : it2.second) {
-				out << ":" << it3.first;
-				if (it3.second != "true") {
-					cleaned = it3.second;
-					Convert::replaceOccurrences(cleaned, ":", "&colon;");
-					out << "=" << cleaned;
-				}
+	size_t i = 0;
+	while (i < p.size()) {
+		size_t end = hash.findNamespaceEnd(i, p[i].ns1, p[i].ns2);
+		out << hash.prefix;
+		out << p[i].ns1 << ":" << p[i].ns2;
+		for ( ; i<end; i++) {
+			out << ":" << p[i].key;
+			if (p[i].value != "true") {
+				cleaned = p[i].value;
+				Convert::replaceOccurrences(cleaned, ":", "&colon;");
+				out << "=" << cleaned;
 			}
-			out << endl;
 		}
+		out << endl;
 	}
 
 	return out;
@@ -13526,6 +14242,239 @@ void HumInstrument::sortData(void) {
 
 
 
+
+//////////////////////////////
+//
+// HumMemoryMap::HumMemoryMap -- Constructor.
+//
+
+HumMemoryMap::HumMemoryMap(void) {
+	m_data   = NULL;
+	m_size   = 0;
+	m_mapped = false;
+	m_open   = false;
+	m_discarded = 0;
+	setData(NULL, 0);
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::~HumMemoryMap -- Deconstructor.
+//
+
+HumMemoryMap::~HumMemoryMap() {
+	close();
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::open -- Access the contents of the given file.  Returns
+//     false if the file cannot be opened.
+//
+
+bool HumMemoryMap::open(const string& filename) {
+	close();
+
+#ifndef _WIN32
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if ((fstat(fd, &info) == 0) && S_ISREG(info.st_mode)) {
+		if (info.st_size == 0) {
+			::close(fd);
+			m_open = true;
+			setData(NULL, 0);
+			return true;
+		}
+		void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED) {
+			::close(fd);
+			#ifdef MADV_SEQUENTIAL
+				madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+			#endif
+			m_mapped = true;
+			m_open = true;
+			setData((const char*)data, (size_t)info.st_size);
+			return true;
+		}
+	}
+	::close(fd);
+#endif
+
+	// Cannot memory-map the file, so read it into memory instead:
+	ifstream input(filename, std::ios::in | std::ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+	m_contents.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+	m_open = true;
+	setData(m_contents.data(), m_contents.size());
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::close -- Release the contents of the file.
+//
+
+void HumMemoryMap::close(void) {
+#ifndef _WIN32
+	if (m_mapped) {
+		munmap((void*)m_data, m_size);
+	}
+#endif
+	m_contents.clear();
+	m_contents.shrink_to_fit();
+	m_mapped = false;
+	m_open   = false;
+	m_discarded = 0;
+	setData(NULL, 0);
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::isOpen -- Returns true if a file is open.
+//
+
+bool HumMemoryMap::isOpen(void) const {
+	return m_open;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::isMapped -- Returns true if the file contents are
+//     memory-mapped rather than copied into memory.
+//
+
+bool HumMemoryMap::isMapped(void) const {
+	return m_mapped;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::getData -- Return the contents of the file.  The
+//     contents are not null-terminated, so use getSize() to find
+//     the end of the data.
+//
+
+const char* HumMemoryMap::getData(void) const {
+	return m_data;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::getSize -- Return the number of bytes in the file.
+//
+
+size_t HumMemoryMap::getSize(void) const {
+	return m_size;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::getLine -- Copy the next line of the file (without its
+//     newline) into line.  Lines are split directly from the contents of
+//     the file.  Returns false if there are no more lines, in which case
+//     line is empty.  Like std::getline(), the end of the file is reached
+//     after reading a last line which has no newline, or after trying to
+//     read past the last newline.
+//
+
+bool HumMemoryMap::getLine(string& line) {
+	if (m_position >= m_size) {
+		line.clear();
+		m_eof = true;
+		return false;
+	}
+	const char* start = m_data + m_position;
+	const char* newline = (const char*)memchr(start, '\n', m_size - m_position);
+	if (newline == NULL) {
+		line.assign(start, m_size - m_position);
+		m_position = m_size;
+		m_eof = true;
+	} else {
+		line.assign(start, newline - start);
+		m_position = newline - m_data + 1;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::eof -- Returns true if getLine() has reached the end
+//     of the file.
+//
+
+bool HumMemoryMap::eof(void) const {
+	return m_eof;
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::discardRead -- Allow the operating system to drop the
+//     memory pages of a mapped file which have already been read with
+//     getLine().  This keeps memory usage low when streaming through
+//     large files of segments.  Pages are released at most once per
+//     megabyte of input read.
+//
+
+void HumMemoryMap::discardRead(void) {
+#if !defined(_WIN32) && defined(MADV_DONTNEED)
+	if (!m_mapped) {
+		return;
+	}
+	size_t pagesize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t position = m_position;
+	position -= position % pagesize;
+	if (position < m_discarded + 0x100000) {
+		return;
+	}
+	madvise((void*)(m_data + m_discarded), position - m_discarded, MADV_DONTNEED);
+	m_discarded = position;
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// HumMemoryMap::setData -- Set the data region and start reading
+//     lines from the start of it.
+//
+
+void HumMemoryMap::setData(const char* data, size_t size) {
+	m_data = data;
+	m_size = size;
+	m_position = 0;
+	m_eof = false;
+}
+
+
+
+thread_local bool HumNum::s_overflow = false;
+
 //////////////////////////////
 //
 // HumNum::HumNum -- HumNum Constructor.  Set the default value
@@ -13807,26 +14756,106 @@ HumNum& HumNum::makeAbs(void) {
 //    reduce to 1/6 since a factor of 4 is common to the numerator
 //    and denominator.
 //
+//    The two-parameter version stores the reduced value of a fraction
+//    calculated with 64-bit integers, which is how arithmetic results
+//    are stored without intermediate int overflow.  Most durations
+//    have a power-of-two denominator, and in that case the only common
+//    factors are twos which are removed with a shift.  If the reduced
+//    fraction still does not fit into ints, it is approximated by the
+//    closest fraction which does rather than wrapping around.
+//
 
 void HumNum::reduce(void) {
-	int a = getNumerator();
-	int b = getDenominator();
-	if (a == 1 || b == 1) {
+	reduce(top, bot);
+}
+
+
+void HumNum::reduce(long long numerator, long long denominator) {
+	if ((numerator == 1) || (denominator == 1)) {
+		// already reduced
+	} else if ((denominator > 0) && !(denominator & (denominator - 1))) {
+		if (numerator == 0) {
+			denominator = 1;
+		} else {
+			int shift = countTrailingZeros((unsigned long long)numerator);
+			int bshift = countTrailingZeros((unsigned long long)denominator);
+			if (bshift < shift) {
+				shift = bshift;
+			}
+			if (numerator < 0) {
+				numerator = -(-numerator >> shift);
+			} else {
+				numerator >>= shift;
+			}
+			denominator >>= shift;
+		}
+	} else {
+		if (numerator == 0) {
+			denominator = 1;
+		} else if (denominator != 0) {
+			long long gcdval = gcdBinary(numerator, denominator);
+			if (gcdval > 1) {
+				numerator /= gcdval;
+				denominator /= gcdval;
+			}
+		}
+	}
+
+	if ((numerator > INT_MAX) || (numerator < -INT_MAX) ||
+			(denominator > INT_MAX) || (denominator < -INT_MAX)) {
+		approximate(numerator, denominator);
 		return;
 	}
-	if (a == 0) {
+
+	top = (int)numerator;
+	bot = (int)denominator;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::approximate -- Store the closest fraction to the given one
+//    that fits into ints (the last continued-fraction convergent with
+//    numerator and denominator no larger than INT_MAX).  Values too
+//    large for an int are clamped to +/-INT_MAX.  Used when an arithmetic
+//    result overflows, which is recorded for hasOverflow().
+//
+
+void HumNum::approximate(long long numerator, long long denominator) {
+	s_overflow = true;
+	bool negative = (numerator < 0) != (denominator < 0);
+	unsigned long long n = numerator < 0 ? 0 - (unsigned long long)numerator : numerator;
+	unsigned long long d = denominator < 0 ? 0 - (unsigned long long)denominator : denominator;
+	unsigned long long h0 = 0;
+	unsigned long long h1 = 1;
+	unsigned long long k0 = 1;
+	unsigned long long k1 = 0;
+	while (d != 0) {
+		unsigned long long q = n / d;
+		if ((h1 != 0) && (q > (INT_MAX - h0) / h1)) {
+			break;
+		}
+		if ((k1 != 0) && (q > (INT_MAX - k0) / k1)) {
+			break;
+		}
+		unsigned long long h2 = q * h1 + h0;
+		unsigned long long k2 = q * k1 + k0;
+		h0 = h1;
+		h1 = h2;
+		k0 = k1;
+		k1 = k2;
+		unsigned long long r = n - q * d;
+		n = d;
+		d = r;
+	}
+	if (k1 == 0) {
+		top = negative ? -INT_MAX : INT_MAX;
 		bot = 1;
 		return;
 	}
-	if (b == 0) {
-		a = 0;
-		b = 0;
-	}
-	int gcdval = gcdIterative(a, b);
-	if (gcdval > 1) {
-		top /= gcdval;
-		bot /= gcdval;
-	}
+	top = negative ? -(int)h1 : (int)h1;
+	bot = (int)k1;
 }
 
 
@@ -13849,6 +14878,69 @@ int HumNum::gcdIterative(int a, int b) {
 
 
 
+//////////////////////////////
+//
+// HumNum::gcdBinary -- Returns the greatest common divisor of two
+//      numbers using the binary GCD algorithm, which uses shifts and
+//      subtractions rather than repeated divisions.
+//
+
+long long HumNum::gcdBinary(long long a, long long b) {
+	unsigned long long u = a < 0 ? 0 - (unsigned long long)a : (unsigned long long)a;
+	unsigned long long v = b < 0 ? 0 - (unsigned long long)b : (unsigned long long)b;
+	if (u == 0) {
+		return (long long)v;
+	}
+	if (v == 0) {
+		return (long long)u;
+	}
+	// Durations usually have a small denominator, so reduce the larger
+	// value with one division before the shift/subtract loop.
+	if (u > v) {
+		u = (u <= UINT_MAX) ? (unsigned int)u % (unsigned int)v : u % v;
+		if (u == 0) {
+			return (long long)v;
+		}
+	} else if (v > u) {
+		v = (v <= UINT_MAX) ? (unsigned int)v % (unsigned int)u : v % u;
+		if (v == 0) {
+			return (long long)u;
+		}
+	}
+	int shift = countTrailingZeros(u | v);
+	u >>= countTrailingZeros(u);
+	do {
+		v >>= countTrailingZeros(v);
+		unsigned long long smaller = u < v ? u : v;
+		v = (u < v ? v : u) - smaller;
+		u = smaller;
+	} while (v != 0);
+	return (long long)(u << shift);
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::countTrailingZeros -- Returns the number of zero bits
+//      below the lowest one bit.  The value must not be zero.
+//
+
+int HumNum::countTrailingZeros(unsigned long long value) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(value);
+#else
+	int count = 0;
+	while (!(value & 1)) {
+		value >>= 1;
+		count++;
+	}
+	return count;
+#endif
+}
+
+
+
 //////////////////////////////
 //
 // HumNum::gcdRecursive -- Returns the greatest common divisor of two
@@ -13940,19 +15032,39 @@ bool HumNum::isPowerOfTwo(void) const {
 //
 
 HumNum HumNum::operator+(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2 + a2 * b1;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
+	long long a1 = getNumerator();
+	long long b1 = getDenominator();
+	long long a2 = value.getNumerator();
+	long long b2 = value.getDenominator();
+	HumNum output;
+	if ((b1 > 0) && (b2 > 0) && !(b1 & (b1 - 1)) && !(b2 & (b2 - 1))) {
+		// power-of-two denominators: the larger one is the common denominator.
+		if (b1 < b2) {
+			a1 *= b2 >> countTrailingZeros(b1);
+			b1 = b2;
+		} else if (b2 < b1) {
+			a2 *= b1 >> countTrailingZeros(b2);
+		}
+		output.reduce(a1 + a2, b1);
+	} else {
+		long long x = a1 * b2;
+		long long y = a2 * b1;
+		if (((y > 0) && (x > LLONG_MAX - y)) || ((y < 0) && (x < LLONG_MIN - y))) {
+			// The cross products (from INT_MIN terms) do not add within
+			// 64 bits: halve the fraction, which may lose precision.
+			s_overflow = true;
+			output.reduce(x / 2 + y / 2, b1 * b2 / 2);
+		} else {
+			output.reduce(x + y, b1 * b2);
+		}
+	}
 	return output;
 }
 
 
 HumNum HumNum::operator+(int value) const {
-	HumNum output(value * bot + top, bot);
+	HumNum output;
+	output.reduce((long long)value * bot + top, bot);
 	return output;
 }
 
@@ -13966,19 +15078,39 @@ HumNum HumNum::operator+(int value) const {
 //
 
 HumNum HumNum::operator-(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2 - a2*b1;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
+	long long a1 = getNumerator();
+	long long b1 = getDenominator();
+	long long a2 = value.getNumerator();
+	long long b2 = value.getDenominator();
+	HumNum output;
+	if ((b1 > 0) && (b2 > 0) && !(b1 & (b1 - 1)) && !(b2 & (b2 - 1))) {
+		// power-of-two denominators: the larger one is the common denominator.
+		if (b1 < b2) {
+			a1 *= b2 >> countTrailingZeros(b1);
+			b1 = b2;
+		} else if (b2 < b1) {
+			a2 *= b1 >> countTrailingZeros(b2);
+		}
+		output.reduce(a1 - a2, b1);
+	} else {
+		long long x = a1 * b2;
+		long long y = a2 * b1;
+		if (((y < 0) && (x > LLONG_MAX + y)) || ((y > 0) && (x < LLONG_MIN + y))) {
+			// The cross products (from INT_MIN terms) do not subtract
+			// within 64 bits: halve the fraction, which may lose precision.
+			s_overflow = true;
+			output.reduce(x / 2 - y / 2, b1 * b2 / 2);
+		} else {
+			output.reduce(x - y, b1 * b2);
+		}
+	}
 	return output;
 }
 
 
 HumNum HumNum::operator-(int value) const {
-	HumNum output(top - value * bot, bot);
+	HumNum output;
+	output.reduce(top - (long long)value * bot, bot);
 	return output;
 }
 
@@ -13991,7 +15123,8 @@ HumNum HumNum::operator-(int value) const {
 //
 
 HumNum HumNum::operator-(void) const {
-	HumNum output(-top, bot);
+	HumNum output;
+	output.reduce(-(long long)top, bot);
 	return output;
 }
 
@@ -14004,19 +15137,19 @@ HumNum HumNum::operator-(void) const {
 //
 
 HumNum HumNum::operator*(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*a2;
-	int bo = b1*b2;
-	HumNum output(ao, bo);
+	long long a1 = getNumerator();
+	long long b1 = getDenominator();
+	long long a2 = value.getNumerator();
+	long long b2 = value.getDenominator();
+	HumNum output;
+	output.reduce(a1*a2, b1*b2);
 	return output;
 }
 
 
 HumNum HumNum::operator*(int value) const {
-	HumNum output(top * value, bot);
+	HumNum output;
+	output.reduce((long long)top * value, bot);
 	return output;
 }
 
@@ -14029,27 +15162,27 @@ HumNum HumNum::operator*(int value) const {
 //
 
 HumNum HumNum::operator/(const HumNum& value) const {
-	int a1  = getNumerator();
-	int b1  = getDenominator();
-	int a2  = value.getNumerator();
-	int b2  = value.getDenominator();
-	int ao = a1*b2;
-	int bo = b1*a2;
-	HumNum output(ao, bo);
+	long long a1 = getNumerator();
+	long long b1 = getDenominator();
+	long long a2 = value.getNumerator();
+	long long b2 = value.getDenominator();
+	HumNum output;
+	output.reduce(a1*b2, b1*a2);
 	return output;
 }
 
 
 HumNum HumNum::operator/(int value) const {
-	int a  = getNumerator();
-	int b  = getDenominator();
+	long long a = getNumerator();
+	long long b = getDenominator();
 	if (value < 0) {
 		a = -a;
-		b *= -value;
+		b *= -(long long)value;
 	} else {
 		b *= value;
 	}
-	HumNum output(a, b);
+	HumNum output;
+	output.reduce(a, b);
 	return output;
 }
 
@@ -14062,10 +15195,9 @@ HumNum HumNum::operator/(int value) const {
 //
 
 HumNum& HumNum::operator=(const HumNum& value) {
-	if (this == &value) {
-		return *this;
-	}
-	setValue(value.top, value.bot);
+	// value is already reduced, so copy it directly:
+	top = value.top;
+	bot = value.bot;
 	return *this;
 }
 
@@ -14159,11 +15291,17 @@ bool HumNum::operator<(const HumNum& value) const {
 	if (this == &value) {
 		return false;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot < (long long)value.top * bot;
+	}
 	return getFloat() < value.getFloat();
 }
 
 
 bool HumNum::operator<(int value) const {
+	if (bot > 0) {
+		return top < (long long)value * bot;
+	}
 	return getFloat() < value;
 }
 
@@ -14184,11 +15322,17 @@ bool HumNum::operator<=(const HumNum& value) const {
 	if (this == &value) {
 		return true;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot <= (long long)value.top * bot;
+	}
 	return getFloat() <= value.getFloat();
 }
 
 
 bool HumNum::operator<=(int value) const {
+	if (bot > 0) {
+		return top <= (long long)value * bot;
+	}
 	return getFloat() <= value;
 }
 
@@ -14209,11 +15353,17 @@ bool HumNum::operator>(const HumNum& value) const {
 	if (this == &value) {
 		return false;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot > (long long)value.top * bot;
+	}
 	return getFloat() > value.getFloat();
 }
 
 
 bool HumNum::operator>(int value) const {
+	if (bot > 0) {
+		return top > (long long)value * bot;
+	}
 	return getFloat() > value;
 }
 
@@ -14234,11 +15384,17 @@ bool HumNum::operator>=(const HumNum& value) const {
 	if (this == &value) {
 		return true;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		return (long long)top * value.bot >= (long long)value.top * bot;
+	}
 	return getFloat() >= value.getFloat();
 }
 
 
 bool HumNum::operator>=(int value) const {
+	if (bot > 0) {
+		return top >= (long long)value * bot;
+	}
 	return getFloat() >= value;
 }
 
@@ -14259,11 +15415,19 @@ bool HumNum::operator==(const HumNum& value) const {
 	if (this == &value) {
 		return true;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		// both values are reduced, so they are equal only if their
+		// numerators and denominators are equal.
+		return (top == value.top) && (bot == value.bot);
+	}
 	return getFloat() == value.getFloat();
 }
 
 
 bool HumNum::operator==(int value) const {
+	if (bot > 0) {
+		return (top == value) && (bot == 1);
+	}
 	return getFloat() == value;
 }
 
@@ -14284,11 +15448,19 @@ bool HumNum::operator!=(const HumNum& value) const {
 	if (this == &value) {
 		return false;
 	}
+	if ((bot > 0) && (value.bot > 0)) {
+		// both values are reduced, so they are equal only if their
+		// numerators and denominators are equal.
+		return (top != value.top) || (bot != value.bot);
+	}
 	return getFloat() != value.getFloat();
 }
 
 
 bool HumNum::operator!=(int value) const {
+	if (bot > 0) {
+		return (top != value) || (bot != 1);
+	}
 	return getFloat() != value;
 }
 
@@ -14392,6 +15564,30 @@ ostream& HumNum::printTwoPart(ostream& out, const string& spacer) const {
 
 
 
+//////////////////////////////
+//
+// HumNum::hasOverflow -- Returns true if an arithmetic result in the
+//    current thread did not fit into ints since the last call to
+//    clearOverflow(), so that an approximation of it was stored.
+//
+
+bool HumNum::hasOverflow(void) {
+	return s_overflow;
+}
+
+
+
+//////////////////////////////
+//
+// HumNum::clearOverflow -- Reset the overflow state of the current thread.
+//
+
+void HumNum::clearOverflow(void) {
+	s_overflow = false;
+}
+
+
+
 //////////////////////////////
 //
 // HumNum::printList -- Print as a list of two numbers, such as
@@ -15116,6 +16312,7 @@ HumRegex::HumRegex(void) {
 	m_regexflags  = std::regex_constants::ECMAScript;
 
 	m_searchflags = std::regex_constants::format_first_only;
+	m_compiled = false;
 }
 
 
@@ -15127,7 +16324,8 @@ HumRegex::HumRegex(const string& exp, const string& options) {
 		// explicitly set the default syntax
 		m_regexflags = std::regex_constants::ECMAScript;
 	}
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	m_compiled = false;
+	setRegex(exp, getTemporaryRegexFlags(options));
 	m_searchflags = (std::regex_constants::match_flag_type)0;
 	m_searchflags = getTemporarySearchFlags(options);
 }
@@ -15234,7 +16432,7 @@ void HumRegex::unsetGlobal(void) {
 //
 
 int HumRegex::search(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	bool result = regex_search(input, m_matches, m_regex, m_searchflags);
 	if (!result) {
 		return 0;
@@ -15249,7 +16447,7 @@ int HumRegex::search(const string& input, const string& exp) {
 
 int HumRegex::search(const string& input, int startindex,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
 	bool result = regex_search(startit, endit, m_matches, m_regex, m_searchflags);
@@ -15278,7 +16476,7 @@ int HumRegex::search(string* input, int startindex, const string& exp) {
 
 int HumRegex::search(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	bool result = regex_search(input, m_matches, m_regex, getTemporarySearchFlags(options));
 	if (!result) {
 		return 0;
@@ -15292,7 +16490,7 @@ int HumRegex::search(const string& input, const string& exp,
 
 int HumRegex::search(const string& input, int startindex, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	auto startit = input.begin() + startindex;
 	auto endit   = input.end();
 	bool result = regex_search(startit, endit, m_matches, m_regex, getTemporarySearchFlags(options));
@@ -15464,14 +16662,14 @@ int HumRegex::getMatchLength(int index) {
 //
 
 bool HumRegex::match(const string& input, const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	return regex_match(input, m_regex, m_searchflags);
 }
 
 
 bool HumRegex::match(const string& input, const string& exp,
 		const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	return regex_match(input, m_regex, getTemporarySearchFlags(options));
 }
 
@@ -15503,7 +16701,7 @@ bool HumRegex::match(const string* input, const string& exp,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	input = regex_replace(input, m_regex, replacement, m_searchflags);
 	return input;
 }
@@ -15520,7 +16718,7 @@ string& HumRegex::replaceDestructive(string* input, const string& replacement,
 
 string& HumRegex::replaceDestructive(string& input, const string& replacement,
 		const string& exp, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	input = regex_replace(input, m_regex, replacement, getTemporarySearchFlags(options));
 	return input;
 }
@@ -15541,7 +16739,7 @@ string& HumRegex::replaceDestructive (string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& replacement,
 		const string& exp) {
-	m_regex = regex(exp, m_regexflags);
+	setRegex(exp, m_regexflags);
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
 			input.end(), m_regex, replacement);
@@ -15560,7 +16758,7 @@ string HumRegex::replaceCopy(string* input, const string& replacement,
 
 string HumRegex::replaceCopy(const string& input, const string& exp,
 		const string& replacement, const string& options) {
-	m_regex = regex(exp, getTemporaryRegexFlags(options));
+	setRegex(exp, getTemporaryRegexFlags(options));
 	string output;
 	regex_replace(std::back_inserter(output), input.begin(),
 			input.end(), m_regex, replacement, getTemporarySearchFlags(options));
@@ -15637,6 +16835,79 @@ bool HumRegex::split(vector<string>& entries, const string& buffer,
 
 
 
+//////////////////////////////
+//
+// HumRegex::setRegex -- Set the regular expression used for the next
+//    search/match/replace.  The expression is not recompiled if it
+//    is the same as the previous one used by this object, and otherwise
+//    a compiled copy is fetched from the process-wide regex cache.
+//
+
+void HumRegex::setRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	if (m_compiled && (flags == m_compiledflags) && (exp == m_expression)) {
+		return;
+	}
+	m_regex = getCompiledRegex(exp, flags);
+	m_expression = exp;
+	m_compiledflags = flags;
+	m_compiled = true;
+}
+
+
+
+//////////////////////////////
+//
+// HumRegex::getCompiledRegex -- Return a compiled regular expression
+//    for the given expression and syntax flags.  Compiled expressions
+//    are stored in a cache shared by all HumRegex objects (and threads),
+//    so that tools which search for the same expressions on every token
+//    do not recompile them each time.  The least recently used
+//    expression is removed from the cache when it becomes full.
+//    Copying a std::regex only copies a reference to the compiled
+//    automaton, so the returned copy is cheap.  Invalid expressions
+//    throw std::regex_error and are not stored in the cache.
+//
+
+std::regex HumRegex::getCompiledRegex(const string& exp,
+		std::regex_constants::syntax_option_type flags) {
+	typedef pair<std::regex_constants::syntax_option_type, string> RegexKey;
+	typedef list<pair<RegexKey, std::regex>> RegexList;
+
+	// HUMREGEX_CACHE_SIZE: maximum number of expressions in the cache.
+	static const int HUMREGEX_CACHE_SIZE = 512;
+
+	static std::mutex cachemutex;
+	static RegexList cachelist;  // most recently used at front
+	static map<RegexKey, RegexList::iterator> cachemap;
+
+	RegexKey key(flags, exp);
+	{
+		std::lock_guard<std::mutex> lock(cachemutex);
+		auto found = cachemap.find(key);
+		if (found != cachemap.end()) {
+			cachelist.splice(cachelist.begin(), cachelist, found->second);
+			return found->second->second;
+		}
+	}
+
+	// Compile outside of the lock since this is the slow part:
+	std::regex output(exp, flags);
+
+	std::lock_guard<std::mutex> lock(cachemutex);
+	if (cachemap.find(key) == cachemap.end()) {
+		cachelist.emplace_front(key, output);
+		cachemap[key] = cachelist.begin();
+		if ((int)cachelist.size() > HUMREGEX_CACHE_SIZE) {
+			cachemap.erase(cachelist.back().first);
+			cachelist.pop_back();
+		}
+	}
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // HumRegex::getTemporaryRegexFlags --
@@ -16274,6 +17545,62 @@ void HumTool::clearOutput(void) {
 
 
 
+///////////////////////////////
+//
+// HumTool::defineThreadOption -- Define the -j option for setting the
+//     number of threads used by STREAM_INTERFACE and SET_INTERFACE
+//     programs.  Only the long form --jobs is defined if the tool
+//     already uses -j for something else.  A tool opts in to -j by
+//     calling this function in its constructor.  Only do that after
+//     checking that separate instances of the tool can run at the same
+//     time: no static or global variables that the tool changes, no
+//     direct printing to cout, and no data carried from one input file
+//     to the next.
+//
+
+void HumTool::defineThreadOption(void) {
+	if (isDefined("jobs")) {
+		return;
+	}
+	if (isDefined("j")) {
+		define("jobs=i:1", "number of threads for processing input segments");
+	} else {
+		define("j|jobs=i:1", "number of threads for processing input segments");
+	}
+}
+
+
+
+///////////////////////////////
+//
+// HumTool::getThreadCount -- Return the number of threads requested
+//     with the -j option (or another integer option, such as the
+//     --threads option of tools which use threads within the analysis of
+//     each file).  A value of 0 means to use one thread for each
+//     processor core.  Returns 1 if the option is not defined.
+//
+
+int HumTool::getThreadCount(void) {
+	return getThreadCount("jobs");
+}
+
+
+int HumTool::getThreadCount(const string& option) {
+	if (!isDefined(option)) {
+		return 1;
+	}
+	int output = getInteger(option);
+	if (output == 0) {
+		output = (int)std::thread::hardware_concurrency();
+	}
+	if (output < 1) {
+		output = 1;
+	}
+	return output;
+}
+
+
+
 ///////////////////////////////
 //
 // HumTool::setError --
@@ -18311,6 +19638,1018 @@ ostream& HumdrumFile::printXmlParameterInfo(ostream& out, int level,
 
 
 
+const char HumdrumFileBase::BINARY_MAGIC[9] = "\0HUMDRUM";
+const int HumdrumFileBase::BINARY_VERSION = 2;
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readBinary -- Load a file which was stored with
+//     writeBinary().  Returns false if the data is not in the binary
+//     format, or is corrupted.
+//
+
+bool HumdrumFileBase::readBinary(const string& filename) {
+	m_displayError = true;
+	if (filename.empty() || (filename == "-")) {
+		return HumdrumFileBase::readBinary(cin);
+	}
+	HumMemoryMap infile;
+	if (!infile.open(filename)) {
+		return setParseError("Cannot open file >>%s<< for reading.", filename.c_str());
+	}
+	return readBinaryBuffer(infile.getData(), infile.getSize());
+}
+
+
+bool HumdrumFileBase::readBinary(istream& contents) {
+	m_displayError = true;
+	string buffer((istreambuf_iterator<char>(contents)), istreambuf_iterator<char>());
+	return readBinaryBuffer(buffer.data(), buffer.size());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::writeBinary -- Store the contents and structural
+//     analysis of the file in a binary format which can be loaded
+//     with readBinary().
+//
+
+bool HumdrumFileBase::writeBinary(const string& filename) {
+	if (filename.empty() || (filename == "-")) {
+		return HumdrumFileBase::writeBinary(cout);
+	}
+	std::ofstream outfile(filename, std::ios::out | std::ios::binary);
+	if (!outfile.is_open()) {
+		return false;
+	}
+	return HumdrumFileBase::writeBinary(outfile);
+}
+
+
+bool HumdrumFileBase::writeBinary(ostream& out) {
+	string output;
+	output.append(BINARY_MAGIC, sizeof(BINARY_MAGIC) - 1);
+	appendBinaryInt(output, BINARY_VERSION);
+
+	appendBinaryString(output, m_filename);
+	appendBinaryInt(output, m_segmentlevel);
+	appendBinaryInt(output, m_ticksperquarternote);
+	appendBinaryString(output, m_idprefix);
+	appendBinaryString(output, m_parseError);
+	int flags = 0;
+	if (m_analyses.m_structure_analyzed) { flags |= 0x01; }
+	if (m_analyses.m_rhythm_analyzed)    { flags |= 0x02; }
+	if (m_analyses.m_strands_analyzed)   { flags |= 0x04; }
+	if (m_analyses.m_strophes_analyzed)  { flags |= 0x08; }
+	if (m_analyses.m_nulls_analyzed)     { flags |= 0x10; }
+	appendBinaryInt(output, flags);
+
+	// offsets: index of the first token of each line in the list of
+	// all tokens in the file.
+	vector<int> offsets(m_lines.size());
+	int tokencount = 0;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		offsets[i] = tokencount;
+		tokencount += (int)m_lines[i]->m_tokens.size();
+	}
+
+	// texts: table of token texts which have been stored, and the duration
+	// of the last token with each text.
+	unordered_map<string, int> texts;
+	vector<HumNum> durations;
+
+	// spineinfos: table of spine info strings which have been stored.
+	unordered_map<string, int> spineinfos;
+	string linetext;
+
+	appendBinaryInt(output, (int)m_lines.size());
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		HumdrumLine* previous = i > 0 ? m_lines[i-1] : NULL;
+
+		HumNum fromstart = 0;
+		HumNum frombarline = 0;
+		HumNum tobarline = 0;
+		if (previous) {
+			fromstart = previous->m_durationFromStart + previous->m_duration;
+			if (!previous->isBarline()) {
+				frombarline = previous->m_durationFromBarline + previous->m_duration;
+			}
+			tobarline = previous->m_durationToBarline - previous->m_duration;
+		}
+		bool tabsQ = (int)line.m_tabs.size() == (int)line.m_tokens.size();
+		for (int j=0; tabsQ && (j<(int)line.m_tabs.size()); j++) {
+			tabsQ = line.m_tabs[j] == (j < (int)line.m_tabs.size() - 1 ? 1 : 0);
+		}
+
+		// Usually the text of the line can be recreated from the tokens:
+		bool textQ = !(joinBinaryTokens(line, linetext) && (linetext == line));
+		int flags = 0;
+		if (textQ)                                    { flags |= 0x01; }
+		if (line.m_rhythm_analyzed != 1)              { flags |= 0x02; }
+		if (!tabsQ)                                   { flags |= 0x04; }
+		if (line.m_durationFromStart != fromstart)     { flags |= 0x08; }
+		if (line.m_durationFromBarline != frombarline) { flags |= 0x10; }
+		if (line.m_durationToBarline != tobarline)     { flags |= 0x20; }
+		if ((int)line.m_tokens.size() != (previous ? (int)previous->m_tokens.size() : 0)) {
+			flags |= 0x40;
+		}
+		appendBinaryInt(output, flags);
+		if (flags & 0x01) { appendBinaryString(output, line); }
+		appendBinaryNum(output, line.m_duration);
+		if (flags & 0x08) { appendBinaryNum(output, line.m_durationFromStart); }
+		if (flags & 0x10) { appendBinaryNum(output, line.m_durationFromBarline); }
+		if (flags & 0x20) { appendBinaryNum(output, line.m_durationToBarline); }
+		if (flags & 0x02) { appendBinaryInt(output, line.m_rhythm_analyzed); }
+		if (flags & 0x04) {
+			appendBinaryInt(output, (int)line.m_tabs.size());
+			for (int j=0; j<(int)line.m_tabs.size(); j++) {
+				appendBinaryInt(output, line.m_tabs[j]);
+			}
+		}
+
+		if (flags & 0x40) {
+			appendBinaryInt(output, (int)line.m_tokens.size());
+		}
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			HTp token = line.m_tokens[j];
+			if (!token) {
+				appendBinaryInt(output, 0);
+				continue;
+			}
+			HTp above = getBinaryFieldToken(i - 1, j);
+			HumNum duration = -1;
+			auto it = texts.find(*token);
+			if (it != texts.end()) {
+				duration = durations[it->second];
+			}
+			// Token addresses are usually the same as the token above:
+			int tflags = 1;
+			if (above && (above->m_address.getSpineInfo() == token->m_address.getSpineInfo())
+					&& (above->m_address.getTrack() == token->m_address.getTrack())
+					&& (above->m_address.getSubtrack() == token->m_address.getSubtrack())
+					&& (above->m_address.getSubtrackCount() == token->m_address.getSubtrackCount())) {
+				tflags = 2;
+			}
+			if (token->m_duration != duration)                   { tflags |= 0x04; }
+			if (token->m_rhythm_analyzed != line.m_rhythm_analyzed) { tflags |= 0x08; }
+			if (token->m_rhycheck != token->m_rhythm_analyzed)    { tflags |= 0x10; }
+			if (getBinaryLinkFlags(token, i, j) != 0)             { tflags |= 0x20; }
+			if (token->m_strand != (above ? above->m_strand : -1)) { tflags |= 0x40; }
+			appendBinaryInt(output, tflags);
+
+			int index = appendBinaryText(output, *token, texts);
+			if (index == (int)durations.size()) {
+				durations.push_back(0);
+			}
+			durations[index] = token->m_duration;
+
+			if ((tflags & 0x03) == 1) { appendBinaryAddress(output, token, spineinfos); }
+			if (tflags & 0x04) { appendBinaryNum(output, token->m_duration); }
+			if (tflags & 0x08) { appendBinaryInt(output, token->m_rhythm_analyzed); }
+			if (tflags & 0x10) { appendBinaryInt(output, token->m_rhycheck); }
+			if (tflags & 0x40) { appendBinaryInt(output, token->m_strand); }
+		}
+	}
+
+	// Links between tokens which cannot be predicted are stored after all
+	// tokens are known:
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			HTp token = line.m_tokens[j];
+			int flags = token ? getBinaryLinkFlags(token, i, j) : 0;
+			if (flags == 0) {
+				continue;
+			}
+			int index = offsets[i] + j;
+			appendBinaryInt(output, flags);
+			if (flags & 0x01) {
+				appendBinaryTokenList(output, token->m_nextTokens, index, offsets);
+			}
+			if (flags & 0x02) {
+				appendBinaryTokenList(output, token->m_previousTokens, index, offsets);
+			}
+			if (flags & 0x04) {
+				appendBinaryTokenList(output, token->m_nextNonNullTokens, index, offsets);
+			}
+			if (flags & 0x08) {
+				appendBinaryTokenList(output, token->m_previousNonNullTokens, index, offsets);
+			}
+			if ((flags & 0x30) == 0x30) {
+				appendBinaryToken(output, token->m_nullresolve, index, offsets);
+			}
+			if (flags & 0x40) {
+				appendBinaryToken(output, token->m_strophe, index, offsets);
+			}
+		}
+	}
+
+	appendBinaryTokenList(output, m_trackstarts, 0, offsets);
+	appendBinaryInt(output, (int)m_trackends.size());
+	for (int i=0; i<(int)m_trackends.size(); i++) {
+		appendBinaryTokenList(output, m_trackends[i], 0, offsets);
+	}
+	appendBinaryInt(output, (int)m_barlines.size());
+	for (int i=0; i<(int)m_barlines.size(); i++) {
+		appendBinaryInt(output, m_barlines[i]->getLineIndex());
+	}
+	appendBinaryTokenPairs(output, m_strand1d, 0, offsets);
+	appendBinaryInt(output, (int)m_strand2d.size());
+	for (int i=0; i<(int)m_strand2d.size(); i++) {
+		appendBinaryTokenPairs(output, m_strand2d[i], 0, offsets);
+	}
+	appendBinaryTokenPairs(output, m_strophes1d, 0, offsets);
+	appendBinaryInt(output, (int)m_strophes2d.size());
+	for (int i=0; i<(int)m_strophes2d.size(); i++) {
+		appendBinaryTokenPairs(output, m_strophes2d[i], 0, offsets);
+	}
+
+	out.write(output.data(), output.size());
+	return (bool)out;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::isBinary -- Returns true if the given data starts
+//     with the signature of the binary format written by writeBinary().
+//
+
+bool HumdrumFileBase::isBinary(const char* contents, size_t size) {
+	size_t length = sizeof(BINARY_MAGIC) - 1;
+	if (size < length) {
+		return false;
+	}
+	return memcmp(contents, BINARY_MAGIC, length) == 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::readBinaryBuffer -- Load binary data which was
+//     created by writeBinary().
+//
+
+bool HumdrumFileBase::readBinaryBuffer(const char* contents, size_t size) {
+	clear();
+	if (!isBinary(contents, size)) {
+		return setParseError("Data is not in the binary Humdrum format.");
+	}
+	const char* ptr = contents + sizeof(BINARY_MAGIC) - 1;
+	const char* end = contents + size;
+	bool ok = true;
+	int version = extractBinaryInt(ptr, end, ok);
+	if (version != BINARY_VERSION) {
+		return setParseError("Unknown binary Humdrum format version %d.", version);
+	}
+
+	extractBinaryString(m_filename, ptr, end, ok);
+	m_segmentlevel = extractBinaryInt(ptr, end, ok);
+	m_ticksperquarternote = extractBinaryInt(ptr, end, ok);
+	extractBinaryString(m_idprefix, ptr, end, ok);
+	extractBinaryString(m_parseError, ptr, end, ok);
+	int flags = extractBinaryInt(ptr, end, ok);
+	m_analyses.m_structure_analyzed = flags & 0x01;
+	m_analyses.m_rhythm_analyzed    = flags & 0x02;
+	m_analyses.m_strands_analyzed   = flags & 0x04;
+	m_analyses.m_strophes_analyzed  = flags & 0x08;
+	m_analyses.m_nulls_analyzed     = flags & 0x10;
+
+	// tokens: list of all token fields in the file, used to resolve
+	// links between tokens.
+	vector<HTp> tokens;
+
+	// texts: table of token texts which have been read, and the duration
+	// of the last token with each text.
+	vector<string> texts;
+	vector<HumNum> durations;
+
+	// spineinfos: table of spine info strings which have been read.
+	vector<string> spineinfos;
+
+	// linkflags: link flags of each token (non-zero if they are stored).
+	vector<int> linkflags;
+
+	HumArena* oldarena = HumArena::getActive();
+	if (m_arenaQ) {
+		HumArena::setActive(&m_arena);
+	}
+	int linecount = extractBinaryCount(ptr, end, ok);
+	m_lines.reserve(linecount);
+	for (int i=0; ok && (i<linecount); i++) {
+		HLp line = new HumdrumLine;
+		line->setOwner(this);
+		line->m_lineindex = i;
+		m_lines.push_back(line);
+		HumdrumLine* previous = i > 0 ? m_lines[i-1] : NULL;
+
+		int flags = extractBinaryInt(ptr, end, ok);
+		if (flags & 0x01) {
+			extractBinaryString(*line, ptr, end, ok);
+		}
+		line->m_duration = extractBinaryNum(ptr, end, ok);
+		line->m_durationFromStart = 0;
+		line->m_durationFromBarline = 0;
+		line->m_durationToBarline = 0;
+		if (previous) {
+			line->m_durationFromStart = previous->m_durationFromStart + previous->m_duration;
+			if (!previous->isBarline()) {
+				line->m_durationFromBarline = previous->m_durationFromBarline + previous->m_duration;
+			}
+			line->m_durationToBarline = previous->m_durationToBarline - previous->m_duration;
+		}
+		if (flags & 0x08) {
+			line->m_durationFromStart = extractBinaryNum(ptr, end, ok);
+		}
+		if (flags & 0x10) {
+			line->m_durationFromBarline = extractBinaryNum(ptr, end, ok);
+		}
+		if (flags & 0x20) {
+			line->m_durationToBarline = extractBinaryNum(ptr, end, ok);
+		}
+		line->m_rhythm_analyzed = (flags & 0x02) ? extractBinaryInt(ptr, end, ok) : 1;
+		if (flags & 0x04) {
+			int tabcount = extractBinaryCount(ptr, end, ok);
+			line->m_tabs.resize(tabcount);
+			for (int j=0; j<tabcount; j++) {
+				line->m_tabs[j] = extractBinaryInt(ptr, end, ok);
+			}
+		}
+
+		int tokencount = previous ? (int)previous->m_tokens.size() : 0;
+		if (flags & 0x40) {
+			tokencount = extractBinaryCount(ptr, end, ok);
+		}
+		if (!(flags & 0x04)) {
+			line->m_tabs.assign(tokencount, 1);
+			if (tokencount > 0) {
+				line->m_tabs.back() = 0;
+			}
+		}
+		line->m_tokens.reserve(tokencount);
+		for (int j=0; ok && (j<tokencount); j++) {
+			int tflags = extractBinaryInt(ptr, end, ok);
+			linkflags.push_back(tflags & 0x20);
+			if (tflags == 0) {
+				line->m_tokens.push_back(NULL);
+				tokens.push_back(NULL);
+				continue;
+			}
+			HTp token = new HumdrumToken;
+			token->setOwner(line);
+			token->setFieldIndex(j);
+			line->m_tokens.push_back(token);
+			tokens.push_back(token);
+
+			int index = extractBinaryText(*token, ptr, end, ok, texts);
+			if (!ok) {
+				break;
+			}
+			if (index == (int)durations.size()) {
+				durations.push_back(-1);
+			}
+
+			HTp above = NULL;
+			if (previous && (j < (int)previous->m_tokens.size())) {
+				above = previous->m_tokens[j];
+			}
+			if ((tflags & 0x03) == 2) {
+				// address is the same as the token above
+				if (!above) {
+					ok = false;
+					break;
+				}
+				token->setSpineInfo(above->m_address.getSpineInfo());
+				token->setTrack(above->m_address.getTrack(), above->m_address.getSubtrack());
+				token->setSubtrackCount(above->m_address.getSubtrackCount());
+			} else {
+				extractBinaryAddress(token, ptr, end, ok, spineinfos);
+			}
+			if (tflags & 0x04) {
+				durations[index] = extractBinaryNum(ptr, end, ok);
+			}
+			token->m_duration = durations[index];
+			token->m_rhythm_analyzed = (tflags & 0x08) ? extractBinaryInt(ptr, end, ok)
+					: line->m_rhythm_analyzed;
+			token->m_rhycheck = (tflags & 0x10) ? extractBinaryInt(ptr, end, ok)
+					: token->m_rhythm_analyzed;
+			token->m_strand = (tflags & 0x40) ? extractBinaryInt(ptr, end, ok)
+					: (above ? above->m_strand : -1);
+		}
+		if (ok && !(flags & 0x01) && !joinBinaryTokens(*line, *line)) {
+			ok = false;
+		}
+	}
+	HumArena::setActive(oldarena);
+
+	// The next non-null tokens which are not stored depend on the tokens
+	// after them, so they are filled in afterwards in reverse order.
+	for (int i=0; ok && (i<(int)tokens.size()); i++) {
+		HTp token = tokens[i];
+		if (!token) {
+			continue;
+		}
+		int lineindex = token->getLineIndex();
+		int fieldindex = token->getFieldIndex();
+		int flags = linkflags[i] ? extractBinaryInt(ptr, end, ok) : 0;
+		linkflags[i] = flags;
+		if (flags & 0x01) {
+			extractBinaryTokenList(token->m_nextTokens, ptr, end, ok, i, tokens);
+		} else {
+			setBinaryLink(token->m_nextTokens, getBinaryFieldToken(lineindex + 1, fieldindex));
+		}
+		if (flags & 0x02) {
+			extractBinaryTokenList(token->m_previousTokens, ptr, end, ok, i, tokens);
+		} else {
+			setBinaryLink(token->m_previousTokens, getBinaryFieldToken(lineindex - 1, fieldindex));
+		}
+		if (flags & 0x04) {
+			extractBinaryTokenList(token->m_nextNonNullTokens, ptr, end, ok, i, tokens);
+		}
+		if (flags & 0x08) {
+			extractBinaryTokenList(token->m_previousNonNullTokens, ptr, end, ok, i, tokens);
+		} else {
+			getBinaryNonNullLinks(token->m_previousTokens, false, token->m_previousNonNullTokens);
+		}
+		switch (flags & 0x30) {
+			case 0x00:
+				token->m_nullresolve = getBinaryNullResolve(token);
+				break;
+			case 0x10:
+				token->m_nullresolve = token;
+				break;
+			case 0x20:
+				token->m_nullresolve = NULL;
+				break;
+			case 0x30:
+				token->m_nullresolve = extractBinaryToken(ptr, end, ok, i, tokens);
+				break;
+		}
+		if (flags & 0x40) {
+			token->m_strophe = extractBinaryToken(ptr, end, ok, i, tokens);
+		}
+	}
+	for (int i=(int)tokens.size()-1; ok && (i>=0); i--) {
+		if (tokens[i] && !(linkflags[i] & 0x04)) {
+			getBinaryNonNullLinks(tokens[i]->m_nextTokens, true, tokens[i]->m_nextNonNullTokens);
+		}
+	}
+
+	extractBinaryTokenList(m_trackstarts, ptr, end, ok, 0, tokens);
+	m_trackends.resize(extractBinaryCount(ptr, end, ok));
+	for (int i=0; i<(int)m_trackends.size(); i++) {
+		extractBinaryTokenList(m_trackends[i], ptr, end, ok, 0, tokens);
+	}
+	int barcount = extractBinaryCount(ptr, end, ok);
+	for (int i=0; ok && (i<barcount); i++) {
+		int index = extractBinaryInt(ptr, end, ok);
+		if ((index < 0) || (index >= (int)m_lines.size())) {
+			ok = false;
+			break;
+		}
+		m_barlines.push_back(m_lines[index]);
+	}
+	extractBinaryTokenPairs(m_strand1d, ptr, end, ok, 0, tokens);
+	m_strand2d.resize(extractBinaryCount(ptr, end, ok));
+	for (int i=0; i<(int)m_strand2d.size(); i++) {
+		extractBinaryTokenPairs(m_strand2d[i], ptr, end, ok, 0, tokens);
+	}
+	extractBinaryTokenPairs(m_strophes1d, ptr, end, ok, 0, tokens);
+	m_strophes2d.resize(extractBinaryCount(ptr, end, ok));
+	for (int i=0; i<(int)m_strophes2d.size(); i++) {
+		extractBinaryTokenPairs(m_strophes2d[i], ptr, end, ok, 0, tokens);
+	}
+
+	if (!ok) {
+		clear();
+		return setParseError("Binary Humdrum data is corrupted.");
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getBinaryTokenIndex -- Return the index of a token
+//     in the list of all tokens in the file for writeBinary(), or -1 if
+//     the token is NULL or does not belong to the file.
+//
+
+int HumdrumFileBase::getBinaryTokenIndex(HTp token, const vector<int>& offsets) {
+	if (!token) {
+		return -1;
+	}
+	int lineindex = token->getLineIndex();
+	int fieldindex = token->getFieldIndex();
+	if ((lineindex < 0) || (lineindex >= (int)m_lines.size())) {
+		return -1;
+	}
+	HumdrumLine& line = *m_lines[lineindex];
+	if ((fieldindex < 0) || (fieldindex >= (int)line.m_tokens.size())) {
+		return -1;
+	}
+	if (line.m_tokens[fieldindex] != token) {
+		return -1;
+	}
+	return offsets[lineindex] + fieldindex;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::joinBinaryTokens -- Recreate the text of a line from
+//     its tokens and tab counts.  Returns false if the line contains
+//     missing tokens or tab counts.
+//
+
+bool HumdrumFileBase::joinBinaryTokens(HumdrumLine& line, string& output) {
+	int count = (int)line.m_tokens.size();
+	if ((int)line.m_tabs.size() < count - 1) {
+		return false;
+	}
+	string text;
+	for (int i=0; i<count; i++) {
+		if (!line.m_tokens[i]) {
+			return false;
+		}
+		text += *line.m_tokens[i];
+		if (i < count - 1) {
+			if (line.m_tabs[i] < 1) {
+				return false;
+			}
+			text.append(line.m_tabs[i], '\t');
+		}
+	}
+	output.swap(text);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getBinaryFieldToken -- Return the token in the given
+//     line and field, or NULL if there is no such token.
+//
+
+HTp HumdrumFileBase::getBinaryFieldToken(int lineindex, int fieldindex) {
+	if ((lineindex < 0) || (lineindex >= (int)m_lines.size())) {
+		return NULL;
+	}
+	HumdrumLine& line = *m_lines[lineindex];
+	if ((fieldindex < 0) || (fieldindex >= (int)line.m_tokens.size())) {
+		return NULL;
+	}
+	return line.m_tokens[fieldindex];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getBinaryLinkFlags -- Return the link flags of a
+//     token, which mark the links that differ from their prediction
+//     (0 if all links can be predicted).
+//
+
+int HumdrumFileBase::getBinaryLinkFlags(HTp token, int lineindex, int fieldindex) {
+	int flags = 0;
+	if (!isBinaryLink(token->m_nextTokens, getBinaryFieldToken(lineindex + 1, fieldindex))) {
+		flags |= 0x01;
+	}
+	if (!isBinaryLink(token->m_previousTokens, getBinaryFieldToken(lineindex - 1, fieldindex))) {
+		flags |= 0x02;
+	}
+	vector<HTp> nonnull;
+	getBinaryNonNullLinks(token->m_nextTokens, true, nonnull);
+	if (nonnull != token->m_nextNonNullTokens) {
+		flags |= 0x04;
+	}
+	getBinaryNonNullLinks(token->m_previousTokens, false, nonnull);
+	if (nonnull != token->m_previousNonNullTokens) {
+		flags |= 0x08;
+	}
+	if (token->m_nullresolve == getBinaryNullResolve(token)) {
+		// predicted
+	} else if (token->m_nullresolve == token) {
+		flags |= 0x10;
+	} else if (!token->m_nullresolve) {
+		flags |= 0x20;
+	} else {
+		flags |= 0x30;
+	}
+	if (token->m_strophe) {
+		flags |= 0x40;
+	}
+	return flags;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getBinaryNullResolve -- Return the usual null
+//     resolution of a token: the first previous non-null token for null
+//     data tokens, otherwise none.
+//
+
+HTp HumdrumFileBase::getBinaryNullResolve(HTp token) {
+	if (token->isData() && token->isNull() && !token->m_previousNonNullTokens.empty()) {
+		return token->m_previousNonNullTokens[0];
+	}
+	return NULL;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::isBinaryLink -- Returns true if the list of links
+//     contains only the given token (or is empty if the token is NULL).
+//     setBinaryLink() sets the list in the same way.
+//
+
+bool HumdrumFileBase::isBinaryLink(const vector<HTp>& links, HTp token) {
+	if (!token) {
+		return links.empty();
+	}
+	return (links.size() == 1) && (links[0] == token);
+}
+
+
+void HumdrumFileBase::setBinaryLink(vector<HTp>& links, HTp token) {
+	links.clear();
+	if (token) {
+		links.push_back(token);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getBinaryNonNullLinks -- Return the usual next (or
+//     previous) non-null data tokens of a token with the given next (or
+//     previous) tokens: the linked tokens which are non-null data, and the
+//     next (or previous) non-null data tokens of the other linked tokens.
+//
+
+void HumdrumFileBase::getBinaryNonNullLinks(const vector<HTp>& links,
+		bool nextQ, vector<HTp>& output) {
+	output.clear();
+	for (int i=0; i<(int)links.size(); i++) {
+		HTp link = links[i];
+		if (!link) {
+			continue;
+		}
+		if (link->isData() && !link->isNull()) {
+			if (std::find(output.begin(), output.end(), link) == output.end()) {
+				output.push_back(link);
+			}
+			continue;
+		}
+		const vector<HTp>& nonnull = nextQ ? link->m_nextNonNullTokens
+				: link->m_previousNonNullTokens;
+		for (int j=0; j<(int)nonnull.size(); j++) {
+			if (std::find(output.begin(), output.end(), nonnull[j]) == output.end()) {
+				output.push_back(nonnull[j]);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryAddress -- Store the spine information,
+//     track, subtrack and subtrack count of a token.
+//
+
+void HumdrumFileBase::appendBinaryAddress(string& output, HTp token,
+		unordered_map<string, int>& spineinfos) {
+	appendBinaryText(output, token->m_address.getSpineInfo(), spineinfos);
+	appendBinaryInt(output, token->m_address.getTrack());
+	appendBinaryInt(output, token->m_address.getSubtrack());
+	appendBinaryInt(output, token->m_address.getSubtrackCount());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryText -- Store a string as an index into
+//     the table of previously stored strings, followed by the string
+//     itself if it has not been stored yet.  Returns the index.
+//
+
+int HumdrumFileBase::appendBinaryText(string& output, const string& value,
+		unordered_map<string, int>& table) {
+	auto it = table.find(value);
+	if (it != table.end()) {
+		appendBinaryInt(output, it->second);
+		return it->second;
+	}
+	int index = (int)table.size();
+	table[value] = index;
+	appendBinaryInt(output, index);
+	appendBinaryString(output, value);
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryInt -- Store an integer as a zigzag
+//     variable-length value, so that small positive and negative numbers
+//     use a single byte.
+//
+
+void HumdrumFileBase::appendBinaryInt(string& output, int value) {
+	unsigned int uvalue = ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+	while (uvalue >= 0x80) {
+		output.push_back((char)((uvalue & 0x7f) | 0x80));
+		uvalue >>= 7;
+	}
+	output.push_back((char)uvalue);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryString -- Store a string as its length
+//     followed by its contents.
+//
+
+void HumdrumFileBase::appendBinaryString(string& output, const string& value) {
+	appendBinaryInt(output, (int)value.size());
+	output.append(value);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryNum -- Store a rational number as its
+//     numerator followed by its denominator.
+//
+
+void HumdrumFileBase::appendBinaryNum(string& output, const HumNum& value) {
+	appendBinaryInt(output, value.getNumerator());
+	appendBinaryInt(output, value.getDenominator());
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryToken -- Store a token as its offset from
+//     the token at index "base", plus one.  NULL tokens (and tokens which
+//     are not in the file) are stored as 0.  Links between tokens are
+//     mostly to nearby tokens, so the offsets are usually small.
+//
+
+void HumdrumFileBase::appendBinaryToken(string& output, HTp token, int base,
+		const vector<int>& offsets) {
+	int index = getBinaryTokenIndex(token, offsets);
+	if (index < 0) {
+		appendBinaryInt(output, 0);
+		return;
+	}
+	int delta = index - base;
+	appendBinaryInt(output, delta >= 0 ? delta + 1 : delta);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryTokenList -- Store a list of tokens as a
+//     count followed by each token.
+//
+
+void HumdrumFileBase::appendBinaryTokenList(string& output,
+		const vector<HTp>& tokens, int base, const vector<int>& offsets) {
+	appendBinaryInt(output, (int)tokens.size());
+	for (int i=0; i<(int)tokens.size(); i++) {
+		appendBinaryToken(output, tokens[i], base, offsets);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::appendBinaryTokenPairs -- Store a list of strands
+//     or strophes.
+//
+
+void HumdrumFileBase::appendBinaryTokenPairs(string& output,
+		const vector<TokenPair>& pairs, int base, const vector<int>& offsets) {
+	appendBinaryInt(output, (int)pairs.size());
+	for (int i=0; i<(int)pairs.size(); i++) {
+		appendBinaryToken(output, pairs[i].first, base, offsets);
+		appendBinaryToken(output, pairs[i].last, base, offsets);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryInt -- Read an integer stored by
+//     appendBinaryInt().  "ok" is set to false if the data is truncated.
+//
+
+int HumdrumFileBase::extractBinaryInt(const char*& ptr, const char* end, bool& ok) {
+	unsigned int uvalue = 0;
+	int shift = 0;
+	while (ok) {
+		if ((ptr >= end) || (shift > 28)) {
+			ok = false;
+			break;
+		}
+		unsigned char byte = (unsigned char)*ptr++;
+		uvalue |= (unsigned int)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			return (int)(uvalue >> 1) ^ -(int)(uvalue & 1);
+		}
+		shift += 7;
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryCount -- Read the size of a list.
+//     "ok" is set to false if the size is negative or larger than the
+//     remaining data (every entry uses at least one byte).
+//
+
+int HumdrumFileBase::extractBinaryCount(const char*& ptr, const char* end, bool& ok) {
+	int count = extractBinaryInt(ptr, end, ok);
+	if (!ok || (count < 0) || (count > end - ptr)) {
+		ok = false;
+		return 0;
+	}
+	return count;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryString -- Read a string stored by
+//     appendBinaryString().
+//
+
+void HumdrumFileBase::extractBinaryString(string& output, const char*& ptr,
+		const char* end, bool& ok) {
+	int length = extractBinaryCount(ptr, end, ok);
+	if (!ok) {
+		return;
+	}
+	output.assign(ptr, length);
+	ptr += length;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryAddress -- Read the address of a token
+//     stored by appendBinaryAddress().
+//
+
+void HumdrumFileBase::extractBinaryAddress(HTp token, const char*& ptr,
+		const char* end, bool& ok, vector<string>& spineinfos) {
+	string spineinfo;
+	extractBinaryText(spineinfo, ptr, end, ok, spineinfos);
+	if (!ok) {
+		return;
+	}
+	token->setSpineInfo(spineinfo);
+	int track = extractBinaryInt(ptr, end, ok);
+	int subtrack = extractBinaryInt(ptr, end, ok);
+	token->setTrack(track, subtrack);
+	token->setSubtrackCount(extractBinaryInt(ptr, end, ok));
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryText -- Read a string stored by
+//     appendBinaryText().  Returns its index in the table.
+//
+
+int HumdrumFileBase::extractBinaryText(string& output, const char*& ptr,
+		const char* end, bool& ok, vector<string>& table) {
+	int index = extractBinaryInt(ptr, end, ok);
+	if (ok && (index == (int)table.size())) {
+		table.resize(table.size() + 1);
+		extractBinaryString(table.back(), ptr, end, ok);
+	} else if ((index < 0) || (index > (int)table.size())) {
+		ok = false;
+	}
+	if (!ok) {
+		return -1;
+	}
+	output = table[index];
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryNum -- Read a rational number stored by
+//     appendBinaryNum().
+//
+
+HumNum HumdrumFileBase::extractBinaryNum(const char*& ptr, const char* end, bool& ok) {
+	int top = extractBinaryInt(ptr, end, ok);
+	int bot = extractBinaryInt(ptr, end, ok);
+	if (!ok || (bot == 0)) {
+		ok = false;
+		return 0;
+	}
+	return HumNum(top, bot);
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryToken -- Read a token stored by
+//     appendBinaryToken().
+//
+
+HTp HumdrumFileBase::extractBinaryToken(const char*& ptr, const char* end,
+		bool& ok, int base, const vector<HTp>& tokens) {
+	int value = extractBinaryInt(ptr, end, ok);
+	if (!ok || (value == 0)) {
+		return NULL;
+	}
+	int index = base + (value > 0 ? value - 1 : value);
+	if ((index < 0) || (index >= (int)tokens.size())) {
+		ok = false;
+		return NULL;
+	}
+	return tokens[index];
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryTokenList -- Read a list of tokens
+//     stored by appendBinaryTokenList().
+//
+
+void HumdrumFileBase::extractBinaryTokenList(vector<HTp>& output,
+		const char*& ptr, const char* end, bool& ok, int base,
+		const vector<HTp>& tokens) {
+	int count = extractBinaryCount(ptr, end, ok);
+	output.resize(count);
+	for (int i=0; i<count; i++) {
+		output[i] = extractBinaryToken(ptr, end, ok, base, tokens);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::extractBinaryTokenPairs -- Read a list of strands or
+//     strophes stored by appendBinaryTokenPairs().
+//
+
+void HumdrumFileBase::extractBinaryTokenPairs(vector<TokenPair>& output,
+		const char*& ptr, const char* end, bool& ok, int base,
+		const vector<HTp>& tokens) {
+	int count = extractBinaryCount(ptr, end, ok);
+	output.resize(count);
+	for (int i=0; i<count; i++) {
+		output[i].first = extractBinaryToken(ptr, end, ok, base, tokens);
+		output[i].last  = extractBinaryToken(ptr, end, ok, base, tokens);
+	}
+}
+
+
+
 
 //////////////////////////////
 //
@@ -18798,6 +21137,7 @@ HumdrumFileBase::HumdrumFileBase(HumdrumFileBase& infile) {
 	m_strophes1d.clear();
 	m_strophes2d.clear();
 	m_quietParse = infile.m_quietParse;
+	m_arenaQ = infile.m_arenaQ;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
 
@@ -18836,6 +21176,7 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 	m_strophes1d.clear();
 	m_strophes2d.clear();
 	m_quietParse = infile.m_quietParse;
+	m_arenaQ = infile.m_arenaQ;
 	m_parseError = infile.m_parseError;
 	m_displayError = infile.m_displayError;
 
@@ -18858,6 +21199,10 @@ HumdrumFileBase& HumdrumFileBase::operator=(HumdrumFileBase& infile) {
 
 HumdrumFileBase::~HumdrumFileBase() {
 	clear();
+	if (m_notegrid) {
+		delete m_notegrid;
+		m_notegrid = NULL;
+	}
 }
 
 
@@ -18876,6 +21221,7 @@ void HumdrumFileBase::clear(void) {
 		}
 	}
 	m_lines.clear();
+	m_arena.clear();
 
 	// clear state variables which are now invalid:
 	m_trackstarts.clear();
@@ -18938,6 +21284,62 @@ bool HumdrumFileBase::areStrophesAnalyzed(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::areParametersAnalyzed --
+//
+
+bool HumdrumFileBase::areParametersAnalyzed(void) {
+	return m_analyses.m_parameters_analyzed;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::areSignifiersAnalyzed --
+//
+
+bool HumdrumFileBase::areSignifiersAnalyzed(void) {
+	return m_analyses.m_signifiers_analyzed;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getCompactNoteGrid -- Return the note grid for the
+//    **kern spines in the file.  The grid is created on the first call
+//    and then shared by later callers (such as the tools in a filter
+//    chain) until the contents of the file change, at which point it is
+//    reloaded in place on the next call.
+//
+
+CompactNoteGrid& HumdrumFileBase::getCompactNoteGrid(void) {
+	if (!m_notegrid) {
+		m_notegrid = new CompactNoteGrid;
+	}
+	if (!m_analyses.m_notegrid_analyzed) {
+		m_notegrid->load(*this);
+		m_analyses.m_notegrid_analyzed = true;
+	}
+	return *m_notegrid;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::invalidateNoteGrid -- Mark the cached note grid as out
+//    of date.  Called when lines or tokens in the file are changed.
+//
+
+void HumdrumFileBase::invalidateNoteGrid(void) {
+	m_analyses.m_notegrid_analyzed = false;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::setXmlIdPrefix -- Set the prefix for a HumdrumXML ID
@@ -19018,6 +21420,8 @@ bool HumdrumFileBase::setParseError(const char* format, ...) {
 //////////////////////////////
 //
 // HumdrumFileBase::read -- Load file contents from an input stream or file.
+//    Data stored with writeBinary() is detected and loaded with
+//    readBinary() instead.
 //
 
 bool HumdrumFileBase::read(const string& filename) {
@@ -19049,32 +21453,42 @@ bool HumdrumFileBase::read(const char* filename) {
 	}
 #endif
 
-	ifstream infile;
 	if (fname.empty() || (fname ==  "-")) {
 		return HumdrumFileBase::read(cin);
-	} else {
-		infile.open(filename);
-		if (!infile.is_open()) {
-			return setParseError("Cannot open file >>%s<< for reading. A", filename);
-		}
 	}
-	HumdrumFileBase::read(infile);
-	infile.close();
-	return isValid();
+	HumMemoryMap infile;
+	if (!infile.open(fname)) {
+		return setParseError("Cannot open file >>%s<< for reading. A", filename);
+	}
+	return readBuffer(infile.getData(), infile.getSize());
 }
 
 
 bool HumdrumFileBase::read(istream& contents) {
+	if (contents.peek() == BINARY_MAGIC[0]) {
+		// Text data cannot start with a null character, so this is
+		// (probably) data stored with writeBinary():
+		string buffer((istreambuf_iterator<char>(contents)),
+				istreambuf_iterator<char>());
+		return readBuffer(buffer.data(), buffer.size());
+	}
 	clear();
 	m_displayError = true;
 	char buffer[123123] = {0};
 	HLp s;
+	HumArena* oldarena = HumArena::getActive();
+	if (m_arenaQ) {
+		HumArena::setActive(&m_arena);
+	}
 	while (contents.getline(buffer, sizeof(buffer), '\n')) {
 		s = new HumdrumLine(buffer);
 		s->setOwner(this);
 		m_lines.push_back(s);
 	}
-	return analyzeBaseFromLines();
+	HumArena::setActive(oldarena);
+	// Tokens were already created by the HumdrumLine constructor,
+	// so do not create them again with analyzeBaseFromLines():
+	return analyzeBaseFromTokens();
 /*
 	if (!analyzeTokens()) { return isValid(); }
 	if (!analyzeLines() ) { return isValid(); }
@@ -19087,6 +21501,44 @@ bool HumdrumFileBase::read(istream& contents) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::readBuffer -- Read file contents from a block of
+//    memory (such as a memory-mapped file).  Lines are split directly
+//    from the buffer without copying them through a stream.  The
+//    contents do not need to be null-terminated.  Data stored with
+//    writeBinary() is loaded with readBinary() instead.
+//
+
+bool HumdrumFileBase::readBuffer(const char* contents, size_t size) {
+	if (isBinary(contents, size)) {
+		return readBinaryBuffer(contents, size);
+	}
+	clear();
+	m_displayError = true;
+	HLp s;
+	HumArena* oldarena = HumArena::getActive();
+	if (m_arenaQ) {
+		HumArena::setActive(&m_arena);
+	}
+	const char* ptr = contents;
+	const char* end = contents + size;
+	while (ptr < end) {
+		const char* newline = (const char*)memchr(ptr, '\n', end - ptr);
+		if (!newline) {
+			newline = end;
+		}
+		s = new HumdrumLine(ptr, newline - ptr);
+		s->setOwner(this);
+		m_lines.push_back(s);
+		ptr = newline + 1;
+	}
+	HumArena::setActive(oldarena);
+	return analyzeBaseFromTokens();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::readCsv -- Read a Humdrum file in CSV format
@@ -19119,12 +21571,17 @@ bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
 	m_displayError = true;
 	char buffer[123123] = {0};
 	HLp s;
+	HumArena* oldarena = HumArena::getActive();
+	if (m_arenaQ) {
+		HumArena::setActive(&m_arena);
+	}
 	while (contents.getline(buffer, sizeof(buffer), '\n')) {
 		s = new HumdrumLine;
 		s->setLineFromCsv(buffer);
 		s->setOwner(this);
 		m_lines.push_back(s);
 	}
+	HumArena::setActive(oldarena);
 	return analyzeBaseFromLines();
 }
 
@@ -19136,6 +21593,7 @@ bool HumdrumFileBase::readCsv(istream& contents, const string& separator) {
 //
 
 bool HumdrumFileBase::analyzeBaseFromLines(void)  {
+	invalidateNoteGrid();
 	if (!analyzeTokens()) { return isValid(); }
 	if (!analyzeLines() ) { return isValid(); }
 	if (!analyzeSpines()) { return isValid(); }
@@ -19152,6 +21610,7 @@ bool HumdrumFileBase::analyzeBaseFromLines(void)  {
 //
 
 bool HumdrumFileBase::analyzeBaseFromTokens(void) {
+	invalidateNoteGrid();
 	// if (!analyzeTokens()) { return isValid(); } // this creates tokens from lines
 	if (!analyzeLines() ) { return isValid(); }
 	if (!analyzeSpines()) { return isValid(); }
@@ -19169,17 +21628,12 @@ bool HumdrumFileBase::analyzeBaseFromTokens(void) {
 //
 
 bool HumdrumFileBase::readString(const string& contents) {
-	stringstream infile;
-	infile << contents;
-	bool status = read(infile);
-	return status;
+	return readBuffer(contents.data(), contents.size());
 }
 
 
 bool HumdrumFileBase::readString(const char* contents) {
-	stringstream infile;
-	infile << contents;
-	return read(infile);
+	return readBuffer(contents, strlen(contents));
 }
 
 
@@ -19247,6 +21701,52 @@ void HumdrumFileBase::setQuietParsing(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::setArenaAllocation -- Allocate lines and tokens
+//    from a memory arena owned by the file when reading data, so that
+//    they can be freed in one operation when the file is cleared.
+//    This is useful for large scores where there are many tokens.
+//    Lines and tokens added to the file after reading are allocated
+//    on the heap as usual.  Files read by HumdrumFileStream (and so
+//    by the STREAM_INTERFACE and SET_INTERFACE tools) use the arena.
+// default value: state = true
+// @SEEALSO: getArenaAllocation
+//
+
+void HumdrumFileBase::setArenaAllocation(bool state) {
+	m_arenaQ = state;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getArenaAllocation -- Returns true if lines and
+//    tokens are allocated from an arena when reading data.
+// @SEEALSO: setArenaAllocation
+//
+
+bool HumdrumFileBase::getArenaAllocation(void) const {
+	return m_arenaQ;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileBase::getArena -- Return the arena owned by the file.
+//    Lines and tokens which are added to the file while it is the
+//    active arena (such as by HumGrid::transferTokens()) are freed
+//    together when the file is cleared.
+//
+
+HumArena* HumdrumFileBase::getArena(void) {
+	return &m_arena;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileBase::setFilename --
@@ -19540,6 +22040,21 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileBase::clearDirtyLines -- Mark all lines in the file as
+//   unchanged.  Used to track which lines are edited by a later process
+//   (see HumdrumFileStructure::analyzeDirtyLines()).
+//
+
+void HumdrumFileBase::clearDirtyLines(void) {
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		m_lines[i]->clearDirty();
+	}
+}
+
+
+
 ////////////////////////////
 //
 // HumdrumFileBase::appendLine -- Add a line to the file's contents.  The file's
@@ -19547,12 +22062,14 @@ void HumdrumFileBase::createLinesFromTokens(void) {
 //
 
 void HumdrumFileBase::appendLine(const string& line) {
+	invalidateNoteGrid();
 	HLp s = new HumdrumLine(line);
 	m_lines.push_back(s);
 }
 
 
 void HumdrumFileBase::appendLine(HLp line) {
+	invalidateNoteGrid();
 	// deletion will be handled by class.
 	m_lines.push_back(line);
 }
@@ -19566,6 +22083,7 @@ void HumdrumFileBase::appendLine(HLp line) {
 //
 
 void HumdrumFileBase::insertLine(int index, const string& line) {
+	invalidateNoteGrid();
 	HLp s = new HumdrumLine(line);
 	m_lines.insert(m_lines.begin() + index, s);
 
@@ -19577,6 +22095,7 @@ void HumdrumFileBase::insertLine(int index, const string& line) {
 
 
 void HumdrumFileBase::insertLine(int index, HLp line) {
+	invalidateNoteGrid();
 	// deletion will be handled by class.
 	m_lines.insert(m_lines.begin() + index, line);
 
@@ -19603,6 +22122,7 @@ void HumdrumFileBase::deleteLine(int index) {
 	if (index < 0) {
 		return;
 	}
+	invalidateNoteGrid();
 	delete m_lines[index];
 	for (int i=index+1; i<(int)m_lines.size(); i++) {
 		m_lines[i-1] = m_lines[i];
@@ -21000,6 +23520,7 @@ void HumdrumFileBase::fixMerges(int linei) {
 	// the line type for the new line.
 
 	// add the new line to the file:
+	invalidateNoteGrid();
 	m_lines.insert(m_lines.begin() + linei + 1, newline);
 
 }
@@ -22587,7 +25108,7 @@ bool HumdrumFileContent::analyzeKernPhrasings(void) {
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	for (int i=0; i<(int)kernspines.size(); i++) {
 		output = output && analyzeKernPhrasings(kernspines[i], phrasestarts, phraseends, labels, endings, linkSignifier);
 	}
@@ -23648,7 +26169,7 @@ bool HumdrumFileContent::analyzeMensSlurs(void) {
 	vector<HTp> mensspines;
 	getSpineStartList(mensspines, "**mens");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	for (int i=0; i<(int)mensspines.size(); i++) {
 		output = output && analyzeKernSlurs(mensspines[i], slurstarts, slurends, labels, endings, linkSignifier);
 	}
@@ -23719,7 +26240,7 @@ bool HumdrumFileContent::analyzeKernSlurs(void) {
 	vector<HTp> kernspines;
 	getSpineStartList(kernspines, "**kern");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	for (int i=0; i<(int)kernspines.size(); i++) {
 		output = output && analyzeKernSlurs(kernspines[i], slurstarts, slurends, labels, endings, linkSignifier);
 	}
@@ -24227,7 +26748,7 @@ bool HumdrumFileContent::analyzeKernTies(void) {
 	// vector<HTp> kernspines;
 	// getSpineStartList(kernspines, "**kern");
 	bool output = true;
-	string linkSignifier = m_signifiers.getKernLinkSignifier();
+	string linkSignifier = getKernLinkSignifier();
 	output = analyzeKernTies(linkedtiestarts, linkedtieends, linkSignifier);
 	createLinkedTies(linkedtiestarts, linkedtieends);
 	return output;
@@ -24817,10 +27338,8 @@ int HumdrumFileSet::read(HumdrumFileStream& instream) {
 //
 
 int HumdrumFileSet::readAppendFile(const string& filename) {
-	ifstream indata;
-	indata.open(filename);
-	string contents((istreambuf_iterator<char>(indata)), istreambuf_iterator<char>());
-	HumdrumFileStream instream(contents);
+	HumdrumFileStream instream;
+	instream.loadFile(filename);
 	return readAppend(instream);
 }
 
@@ -25034,6 +27553,7 @@ void HumdrumFileStream::clear(void) {
 	m_newfilebuffer.resize(0);
 	// m_stringbuffer.clear(0);
 	m_stringbuffer.str("");
+	m_mapfile.close();
 }
 
 
@@ -25074,6 +27594,23 @@ void HumdrumFileStream::loadString(const string& data) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStream::loadFile -- Read segments from the given file
+//    (memory-mapped when possible) rather than from a list of files or
+//    standard input.  Segments are not given the filename unless
+//    it is set by a !!!!SEGMENT: record.  Returns false if the file
+//    cannot be opened.
+//
+
+int HumdrumFileStream::loadFile(const string& filename) {
+	m_curfile = 0;
+	m_filelist.clear();
+	return m_mapfile.open(filename);
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::read -- alias for getFile.
@@ -25097,6 +27634,55 @@ int HumdrumFileStream::read(HumdrumFileSet& infiles) {
 
 
 
+//
+// Multi-threaded version: the segments are extracted from the input
+// in sequence, then parsed by a pool of threads.  The files are stored
+// in infiles in input order.
+//
+
+int HumdrumFileStream::read(HumdrumFileSet& infiles, int threads) {
+	if (threads <= 1) {
+		return read(infiles);
+	}
+	infiles.clear();
+	vector<string> contents;
+	vector<string> filenames;
+	string text;
+	string filename;
+	while (getSegment(text, filename)) {
+		contents.push_back(text);
+		filenames.push_back(filename);
+	}
+
+	vector<HumdrumFile*> files(contents.size(), NULL);
+	std::atomic<int> next(0);
+	auto parser = [&]() {
+		while (true) {
+			int index = next++;
+			if (index >= (int)files.size()) {
+				break;
+			}
+			files[index] = new HumdrumFile;
+			parseSegment(*files[index], contents[index], filenames[index]);
+			contents[index].clear();
+		}
+	};
+	vector<std::thread> pool;
+	for (int i=0; i<threads; i++) {
+		pool.emplace_back(parser);
+	}
+	for (int i=0; i<(int)pool.size(); i++) {
+		pool[i].join();
+	}
+
+	for (int i=0; i<(int)files.size(); i++) {
+		infiles.appendHumdrumPointer(files[i]);
+	}
+	return 0;
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStream::readSingleSegment -- Get a single file for a set structure.
@@ -25130,8 +27716,8 @@ int HumdrumFileStream::eof(void) {
 	// (2) Next filename if ifstream is done
 	// (3) cin if no ifstream open and no filenames
 
-	// (1) Is an ifstream open?, then yes, there is more data to read.
-	if (m_instream.is_open() && !m_instream.eof()) {
+	// (1) Is a file open?, then yes, there is more data to read.
+	if (m_mapfile.isOpen() && !m_mapfile.eof()) {
 		return 0;
 	}
 
@@ -25171,11 +27757,60 @@ int HumdrumFileStream::eof(void) {
 
 int HumdrumFileStream::getFile(HumdrumFile& infile) {
 	infile.clear();
+	string contents;
+	string filename;
+	if (!getSegment(contents, filename)) {
+		return 0;
+	}
+	parseSegment(infile, contents, filename);
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::parseSegment -- Parse the text of a segment
+//    extracted with getSegment() into a HumdrumFile.  This function
+//    does not access the stream, so segments can be parsed in parallel
+//    by separate threads.  The lines and tokens of the file are
+//    allocated from the file's arena, since stream files are read
+//    once and then discarded as a whole.
+//
+
+void HumdrumFileStream::parseSegment(HumdrumFile& infile,
+		const string& contents, const string& filename) {
+	infile.setArenaAllocation(true);
+	infile.readStringNoRhythm(contents);
+	if (!filename.empty()) {
+		infile.setFilename(filename);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStream::getSegment -- Extract the text content of the
+//    next HumdrumFile from the input stream or next input file in the
+//    list, without parsing it.  Universal comments are demoted to global
+//    comments at the start of the content.  The filename is set from
+//    the input filename or a !!!!SEGMENT: record.  Returns true if
+//    content was extracted, fails if there is no more HumdrumFiles in
+//    the input stream.
+//
+
+int HumdrumFileStream::getSegment(string& contents, string& filename) {
+	contents.clear();
+	filename.clear();
 	istream* newinput = NULL;
+	// mapQ: true if reading lines from m_mapfile rather than newinput.
+	bool mapQ = false;
 
 restarting:
 
 	newinput = NULL;
+	mapQ = false;
 
 	if (m_urlbuffer.eof()) {
 		// If the URL buffer is at its end, clear the buffer.
@@ -25193,9 +27828,10 @@ restarting:
 		newinput = &m_stringbuffer;
 	}
 
-	// (2) Is an ifstream open?
-	else if (m_instream.is_open() && !m_instream.eof()) {
-		newinput = &m_instream;
+	// (2) Is a file open?
+	else if (m_mapfile.isOpen() && !m_mapfile.eof()) {
+		m_mapfile.discardRead();
+		mapQ = true;
 	}
 
 	// (2b) Is the URL data buffer open?
@@ -25209,28 +27845,31 @@ restarting:
 	else if (((int)m_filelist.size() > 0) &&
 			(m_curfile < (int)m_filelist.size()-1)) {
 		m_curfile++;
-		if (m_instream.is_open()) {
-			m_instream.close();
-		}
+		m_mapfile.close();
 		if (strstr(m_filelist[m_curfile].c_str(), "://") != NULL) {
 			// The next file to read is a URL/URI, so buffer the
 			// data from the internet and start reading that instead
 			// of reading from a file on the hard disk.
 			fillUrlBuffer(m_urlbuffer, m_filelist[m_curfile].c_str());
-			infile.setFilename(m_filelist[m_curfile].c_str());
+			filename = m_filelist[m_curfile];
 			goto restarting;
 		}
-		m_instream.open(m_filelist[m_curfile].c_str());
-		infile.setFilename(m_filelist[m_curfile].c_str());
-		if (!m_instream.is_open()) {
+		filename = m_filelist[m_curfile];
+		if (!m_mapfile.open(m_filelist[m_curfile])) {
 			// file does not exist or cannot be opened close
 			// the file and try luck with next file in the list
 			// (perhaps given an error or warning?).
-			infile.setFilename("");
-			m_instream.close();
+			filename.clear();
 			goto restarting;
 		}
-		newinput = &m_instream;
+		if (HumdrumFileBase::isBinary(m_mapfile.getData(), m_mapfile.getSize())) {
+			// Files stored with HumdrumFileBase::writeBinary() are not
+			// split into segments, so pass the whole file to the parser.
+			contents.assign(m_mapfile.getData(), m_mapfile.getSize());
+			m_mapfile.close();
+			return 1;
+		}
+		mapQ = true;
 	} else {
 		// no input fstream open and no list of files to process, so
 		// start (or continue) reading from standard input.
@@ -25250,26 +27889,30 @@ restarting:
 		HumRegex hre;
 		if (hre.search(m_newfilebuffer,
 				R"(^!!!!SEGMENT\s*([+-]?\d+)?\s*:\s*(.*)\s*$)")) {
-			if (hre.getMatchLength(1) > 0) {
-				infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-			} else {
-				infile.setSegmentLevel(0);
-			}
-			infile.setFilename(hre.getMatch(2));
+			filename = hre.getMatch(2);
 		} else if ((m_curfile >=0) && (m_curfile < (int)m_filelist.size())
 				&& (m_filelist.size() > 0)) {
-			infile.setFilename(m_filelist[m_curfile].c_str());
+			filename = m_filelist[m_curfile];
 		} else {
 			// reading from standard input, but no name.
 		}
 	}
 
-	if (newinput == NULL) {
+	if ((newinput == NULL) && !mapQ) {
 		// something strange happened, or no more files to read.
 		return 0;
 	}
 
-	stringstream buffer;
+	if ((newinput == &cin) && (m_newfilebuffer.empty()) &&
+			(cin.peek() == '\0')) {
+		// Data stored with HumdrumFileBase::writeBinary() starts with a
+		// null character.  It is not split into segments, so pass all
+		// of standard input to the parser.
+		contents.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+		return 1;
+	}
+
+	string buffer;
 	int foundUniversalQ = 0;
 
 	// Start reading the input stream.  If !!!!SEGMENT: universal comment
@@ -25285,9 +27928,15 @@ restarting:
 	if (m_newfilebuffer.size() < 4) {
 		//searchName = 1;
 	}
-	char templine[123123] = {0};
+	string templine;
+
+	// Lines of files are split directly from their contents (see
+	// HumMemoryMap::getLine()), and otherwise read from newinput:
+	auto atEnd = [&](void) {
+		return mapQ ? m_mapfile.eof() : newinput->eof();
+	};
 
-	if (newinput->eof()) {
+	if (atEnd()) {
 		if (m_curfile < (int)m_filelist.size()-1) {
 			m_curfile++;
 			goto restarting;
@@ -25296,36 +27945,32 @@ restarting:
 		return 0;
 	}
 
-	istream& input = *newinput;
-
 	// if the previous line from the last read starts with "**"
 	// then treat it as part of the current file.
 	if ((m_newfilebuffer.size() > 1) &&
 		 (strncmp(m_newfilebuffer.c_str(), "**", 2)) == 0) {
-		buffer << m_newfilebuffer << "\n";
+		buffer += m_newfilebuffer;
+		buffer += "\n";
 		m_newfilebuffer = "";
 		starstarFoundQ = 1;
 	}
 
-	while (!input.eof()) {
-		input.getline(templine, 123123, '\n');
+	while (!atEnd()) {
+		if (mapQ) {
+			m_mapfile.getLine(templine);
+		} else {
+			getline(*newinput, templine, '\n');
+		}
 		if ((!dataFoundQ) &&
-				(strncmp(templine, "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0)) {
-			string tempstring;
-			tempstring = templine;
+				(templine.compare(0, strlen("!!!!SEGMENT"), "!!!!SEGMENT") == 0)) {
 			HumRegex hre;
-			if (hre.search(tempstring,
+			if (hre.search(templine,
 					"^!!!!SEGMENT\\s*([+-]?\\d+)?\\s*:\\s*(.*)\\s*$")) {
-				if (hre.getMatchLength(1) > 0) {
-					infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-				} else {
-					infile.setSegmentLevel(0);
-				}
-				infile.setFilename(hre.getMatch(2));
+				filename = hre.getMatch(2);
 			}
 		}
 
-		if (strncmp(templine, "**", 2) == 0) {
+		if (templine.compare(0, 2, "**") == 0) {
 			if (starstarFoundQ == 1) {
 				m_newfilebuffer = templine;
 				// already found a **, so this one is defined as a file
@@ -25337,7 +27982,7 @@ restarting:
 			starstarFoundQ = 1;
 		}
 
-		if (input.eof() && (strcmp(templine, "") == 0)) {
+		if (atEnd() && templine.empty()) {
 			// No more data coming from current stream, so this is
 			// the end of the HumdrumFile.  Break from the while loop
 			// and then store the read contents of the stream in the
@@ -25349,7 +27994,7 @@ restarting:
 		// (1a) this is the name of the current file to process if no
 		// data has yet been found,
 		// (1b) or a name is being actively searched for.
-		if (strncmp(templine, "!!!!SEGMENT", strlen("!!!!SEGMENT")) == 0) {
+		if (templine.compare(0, strlen("!!!!SEGMENT"), "!!!!SEGMENT") == 0) {
 			m_newfilebuffer = templine;
 			if (dataFoundQ) {
 				// this new filename is for the next chunk to process in the
@@ -25364,21 +28009,16 @@ restarting:
 				HumRegex hre;
 				if (hre.search(m_newfilebuffer,
 						R"(^!!!!SEGMENT\s*([+-]?\d+)?\s:\s*(.*)\s*$)")) {
-					if (hre.getMatchLength(1) > 0) {
-						infile.setSegmentLevel(atoi(hre.getMatch(1).c_str()));
-					} else {
-						infile.setSegmentLevel(0);
-					}
-					infile.setFilename(hre.getMatch(2));
+					filename = hre.getMatch(2);
 				}
 			}
 		}
-		int len = (int)strlen(templine);
-		if ((len > 4) && (strncmp(templine, "!!!!", 4) == 0) &&
+		int len = (int)templine.size();
+		if ((len > 4) && (templine.compare(0, 4, "!!!!") == 0) &&
 				(templine[4] != '!') &&
 				(dataFoundQ == 0) &&
-				(strncmp(templine, "!!!!filter:", strlen("!!!!filter:")) != 0) &&
-				(strncmp(templine, "!!!!SEGMENT:", strlen("!!!!SEGMENT:")) != 0)) {
+				(templine.compare(0, strlen("!!!!filter:"), "!!!!filter:") != 0) &&
+				(templine.compare(0, strlen("!!!!SEGMENT:"), "!!!!SEGMENT:") != 0)) {
 			// This is a universal comment.  Should it be appended
 			// to the list or should the current list be erased and
 			// this record placed into the first entry?
@@ -25396,7 +28036,7 @@ restarting:
 			continue;
 		}
 
-		if (strncmp(templine, "*-", 2) == 0) {
+		if (templine.compare(0, 2, "*-") == 0) {
 			starminusFoundQ = 1;
 		}
 
@@ -25410,7 +28050,7 @@ restarting:
 				// so that infinite loops are prevented.
 				int found = 0;
 				for (int mm=0; mm<(int)m_filelist.size(); mm++) {
-					if (strcmp(m_filelist[mm].c_str(), templine) == 0) {
+					if (m_filelist[mm] == templine) {
 						found = 1;
 					}
 				}
@@ -25426,7 +28066,8 @@ restarting:
 		// should empty lines be treated somewhat as universal comments?
 
 		// store the data line for later parsing into HumdrumFile record:
-		buffer << templine << "\n";
+		buffer += templine;
+		buffer += "\n";
 	}
 
 	if (dataFoundQ == 0) {
@@ -25443,22 +28084,19 @@ restarting:
 	// Universal comments (demoted into Global comments) at the start
 	// of the data stream (maybe allow for postpending Universal comments
 	// in the future).
-	stringstream contents;
-	contents.str(""); // empty any contents in buffer
-	contents.clear(); // reset error flags in buffer
-
 	for (int i=0; i<(int)m_universals.size(); i++) {
 		// Convert universals reference records to globals, but do not demote !!!!filter:
 		if (m_universals[i].compare(0, 11, "!!!!filter:") == 0) {
 			continue;
 		}
-		contents << &(m_universals[i][1]) << "\n";
+		contents += &(m_universals[i][1]);
+		contents += "\n";
 	}
-	contents << buffer.str();
-	string filename = infile.getFilename();
-	infile.readNoRhythm(contents);
-	if (!filename.empty()) {
-		infile.setFilename(filename);
+	if (contents.empty()) {
+		// No universal comments, so avoid copying the segment.
+		contents.swap(buffer);
+	} else {
+		contents += buffer;
 	}
 	return 1;
 }
@@ -25562,7 +28200,8 @@ void HumdrumFileStructure::analyzeStropheMarkers(void) {
 
 bool HumdrumFileStructure::analyzeStrophes(void) {
 	if (!m_analyses.m_strands_analyzed) {
-		analyzeStrands();
+		// strophes are analyzed at the end of analyzeStrands():
+		return analyzeStrands();
 	}
 	analyzeStropheMarkers();
 
@@ -25654,11 +28293,17 @@ bool HumdrumFileStructure::analyzeStrophes(void) {
 //
 
 int HumdrumFileStructure::getStropheCount(void) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 	return (int)m_strophes1d.size();
 }
 
 
 int HumdrumFileStructure::getStropheCount(int spineindex) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 	if ((spineindex < 0) || (spineindex >= (int)m_strophes2d.size())) {
 		return 0;
 	}
@@ -25673,13 +28318,19 @@ int HumdrumFileStructure::getStropheCount(int spineindex) {
 //
 
 HTp HumdrumFileStructure::getStropheStart(int index) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 	if ((index < 0) || (index >= (int)m_strophes1d.size())) {
 		return NULL;
 	}
 	return m_strophes1d.at(index).first;
 }
 
-HTp HumdrumFileStructure::getStropheStart(int spine, int index) { 
+HTp HumdrumFileStructure::getStropheStart(int spine, int index) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 		if ((spine < 0) || (index < 0)) {
 			return NULL;
 		}
@@ -25700,6 +28351,9 @@ HTp HumdrumFileStructure::getStropheStart(int spine, int index) {
 //
 
 HTp HumdrumFileStructure::getStropheEnd(int index) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 	if ((index < 0) || (index >= (int)m_strophes1d.size())) {
 		return NULL;
 	}
@@ -25708,6 +28362,9 @@ HTp HumdrumFileStructure::getStropheEnd(int index) {
 
 
 HTp HumdrumFileStructure::getStropheEnd(int spine, int index) {
+	if (!m_analyses.m_strophes_analyzed) {
+		analyzeStrophes();
+	}
 		if ((spine < 0) || (index < 0)) {
 			return NULL;
 		}
@@ -25761,7 +28418,8 @@ HumdrumFileStructure::~HumdrumFileStructure() {
 //
 // HumdrumFileStructure::read --  Read the contents of a file from a file or
 //   istream.  The file's structure is analyzed, and then the rhythmic structure
-//   is calculated.
+//   is calculated.  Files stored with writeBinary() already contain the
+//   analysis, so they are not analyzed again.
 //
 
 
@@ -25770,6 +28428,10 @@ bool HumdrumFileStructure::read(istream& contents) {
 	if (!readNoRhythm(contents)) {
 		return isValid();
 	}
+	if (isRhythmAnalyzed()) {
+		// file was stored with writeBinary(), so already analyzed
+		return isValid();
+	}
 	return analyzeStructure();
 }
 
@@ -25779,6 +28441,10 @@ bool HumdrumFileStructure::read(const char* filename) {
 	if (!readNoRhythm(filename)) {
 		return isValid();
 	}
+	if (isRhythmAnalyzed()) {
+		// file was stored with writeBinary(), so already analyzed
+		return isValid();
+	}
 	return analyzeStructure();
 }
 
@@ -25788,6 +28454,10 @@ bool HumdrumFileStructure::read(const string& filename) {
 	if (!readNoRhythm(filename)) {
 		return isValid();
 	}
+	if (isRhythmAnalyzed()) {
+		// file was stored with writeBinary(), so already analyzed
+		return isValid();
+	}
 	return analyzeStructure();
 }
 
@@ -25844,6 +28514,10 @@ bool HumdrumFileStructure::readString(const char* contents) {
 	if (!HumdrumFileBase::readString(contents)) {
 		return isValid();
 	}
+	if (isRhythmAnalyzed()) {
+		// data was stored with writeBinary(), so already analyzed
+		return isValid();
+	}
 	return analyzeStructure();
 }
 
@@ -25853,6 +28527,10 @@ bool HumdrumFileStructure::readString(const string& contents) {
 	if (!HumdrumFileBase::readString(contents)) {
 		return isValid();
 	}
+	if (isRhythmAnalyzed()) {
+		// data was stored with writeBinary(), so already analyzed
+		return isValid();
+	}
 	return analyzeStructure();
 }
 
@@ -25888,22 +28566,17 @@ bool HumdrumFileStructure::readStringCsv(const string& contents,
 
 //////////////////////////////
 //
-// HumdrumFileStructure::analyzeStructure -- Analyze global/local
-//    parameters and rhythmic structure.
+// HumdrumFileStructure::analyzeStructure -- Analyze token durations
+//    and rhythmic structure.  Spine strands, layout parameters and
+//    signifiers are analyzed on demand when first accessed.
 //
 
 bool HumdrumFileStructure::analyzeStructure(void) {
 	m_analyses.m_structure_analyzed = false;
-	if (!m_analyses.m_strands_analyzed) {
-		if (!analyzeStrands()       ) { return isValid(); }
-	}
-	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
-	if (!analyzeTokenDurations()   ) { return isValid(); }
+	m_analyses.m_parameters_analyzed = false;
 	if (!analyzeTokenDurations()   ) { return isValid(); }
 	m_analyses.m_structure_analyzed = true;
 	if (!analyzeRhythmStructure()  ) { return isValid(); }
-	analyzeSignifiers();
 	return isValid();
 }
 
@@ -25911,19 +28584,123 @@ bool HumdrumFileStructure::analyzeStructure(void) {
 
 //////////////////////////////
 //
-// HumdrumFileStructure::analyzeStructureNoRhythm -- Analyze global/local
-//    parameters but not rhythmic structure.
+// HumdrumFileStructure::analyzeStructureNoRhythm -- Analyze token
+//    durations but not rhythmic structure.
 //
 
 bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 	m_analyses.m_structure_analyzed = true;
-	if (!m_analyses.m_strands_analyzed) {
-		if (!analyzeStrands()          ) { return isValid(); }
-	}
-	if (!analyzeGlobalParameters() ) { return isValid(); }
-	if (!analyzeLocalParameters()  ) { return isValid(); }
+	m_analyses.m_parameters_analyzed = false;
 	if (!analyzeTokenDurations()   ) { return isValid(); }
-	analyzeSignifiers();
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeFromTokens -- Analyze a file whose lines
+//    were built token by token (such as by HumGrid::transferTokens())
+//    rather than read from text.  The text of each line is generated from
+//    its tokens, and the spine structure is rebuilt from the spine
+//    manipulators on the existing tokens.  If any line already has a
+//    start time, the start times of the data lines and the durations of
+//    the notes set when the lines were built are used rather than
+//    parsing the durations and following each track to calculate them
+//    (see analyzeStructureFromTimes()).  Otherwise the same structure
+//    analysis as for a file read from text is done.  The tokens must not
+//    have been analyzed already (their spine links would be added a
+//    second time), so after an analyzed file is edited use
+//    analyzeDirtyLines() or read it again.  The gridtransfer test program
+//    (tests/test-gridtransfer) compares the result and time of this with
+//    printing and reading the text.
+//
+
+bool HumdrumFileStructure::analyzeFromTokens(void) {
+	m_displayError = true;
+	m_analyses.clear();
+	bool timed = false;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HLp line = m_lines[i];
+		line->setOwner(static_cast<HumdrumFileBase*>(this));
+		line->createLineFromTokens();
+		if (line->m_tokens.empty()) {
+			// Empty line: use the same tokens as when reading text.
+			line->createTokensFromLine();
+		}
+		for (int j=0; j<(int)line->m_tokens.size(); j++) {
+			if (line->m_tokens[j]) {
+				line->m_tokens[j]->setOwner(line);
+			}
+		}
+		if (line->m_durationFromStart.isNonNegative()) {
+			timed = true;
+		}
+	}
+	if (!analyzeBaseFromTokens()) {
+		return isValid();
+	}
+	HTp firstspine = getSpineStart(0);
+	if ((!timed) || (firstspine && firstspine->isDataType("**recip"))) {
+		return analyzeStructure();
+	}
+	return analyzeStructureFromTimes();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeStructureFromTimes -- Analyze token
+//    durations and rhythmic structure for analyzeFromTokens() when the
+//    start times of the data lines and the durations of the notes on
+//    them are already known.  Only tokens without a duration are parsed,
+//    and the end of the data is the latest end of a note, so the tracks
+//    do not have to be followed to add up the durations.  Lines of null
+//    tokens and non-data lines are given start times in the same way as
+//    in analyzeRhythm().
+//
+
+bool HumdrumFileStructure::analyzeStructureFromTimes(void) {
+	m_analyses.m_structure_analyzed = true;
+	m_analyses.m_parameters_analyzed = false;
+	m_analyses.m_rhythm_analyzed = true;
+	setLineRhythmAnalyzed();
+	if (getMaxTrack() == 0) {
+		return isValid();
+	}
+
+	HumNum enddur = 0;
+	for (int i=0; i<(int)m_lines.size(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (!line.hasSpines()) {
+			continue;
+		}
+		for (int j=0; j<(int)line.m_tokens.size(); j++) {
+			HTp token = line.m_tokens[j];
+			if (!token->m_rhythm_analyzed) {
+				token->analyzeDuration();
+			}
+			if (line.m_durationFromStart.isNonNegative()
+					&& token->m_duration.isPositive()
+					&& (line.m_durationFromStart + token->m_duration > enddur)) {
+				enddur = line.m_durationFromStart + token->m_duration;
+			}
+		}
+		if (line.isData() && line.isAllRhythmicNull()) {
+			// Start time to be interpolated by analyzeNullLineRhythms().
+			line.m_durationFromStart = -1;
+		} else if (line.isTerminator()) {
+			line.m_durationFromStart = enddur;
+		}
+	}
+
+	if (!analyzeNullLineRhythms()) { return isValid(); }
+	fillInNegativeStartTimes();
+	assignLineDurations();
+	if (!analyzeMeter()) { return isValid(); }
+	if (!analyzeNonNullDataTokens()) { return isValid(); }
+	if (!analyzeDurationsOfNonRhythmicSpines()) { return isValid(); }
 	return isValid();
 }
 
@@ -25931,7 +28708,8 @@ bool HumdrumFileStructure::analyzeStructureNoRhythm(void) {
 
 /////////////////////////////
 //
-// HumdrumFileStructure::analyzeRhythmStructure --
+// HumdrumFileStructure::analyzeRhythmStructure -- An overflow in the
+//    HumNum calculations (see HumNum::hasOverflow()) is a parse error.
 //
 
 bool HumdrumFileStructure::analyzeRhythmStructure(void) {
@@ -25941,6 +28719,7 @@ bool HumdrumFileStructure::analyzeRhythmStructure(void) {
 		if (!analyzeStructureNoRhythm()) { return isValid(); }
 	}
 
+	HumNum::clearOverflow();
 	HTp firstspine = getSpineStart(0);
 	if (firstspine && firstspine->isDataType("**recip")) {
 		assignRhythmFromRecip(firstspine);
@@ -25948,11 +28727,165 @@ bool HumdrumFileStructure::analyzeRhythmStructure(void) {
 		if (!analyzeRhythm()           ) { return isValid(); }
 		if (!analyzeDurationsOfNonRhythmicSpines()) { return isValid(); }
 	}
+	if (HumNum::hasOverflow()) {
+		return setParseError("Error: durations too large to be calculated exactly");
+	}
+	return isValid();
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeDirtyLines -- Update the analyses of the
+//    file after its tokens have been edited in place, without parsing
+//    the file again.  linecount is the number of lines in the file before
+//    editing started (at the time of the last call to clearDirtyLines()).
+//    Lines after linecount must be global comments or reference records
+//    appended to the end of the file.  Returns false if the edits change
+//    the spine or rhythmic structure of the file (or otherwise cannot be
+//    checked); in that case the file should be parsed again from its text.
+//
+
+bool HumdrumFileStructure::analyzeDirtyLines(int linecount) {
+	if ((linecount <= 0) || (linecount > getLineCount())) {
+		return false;
+	}
+	void* owner = static_cast<HumdrumFileBase*>(this);
+
+	for (int i=0; i<linecount; i++) {
+		HumdrumLine& line = *m_lines[i];
+		if ((line.m_owner != owner) || (line.getLineIndex() != i)) {
+			return false;
+		}
+		if (line.isDirty() && !isAnalysisPreserved(line)) {
+			return false;
+		}
+	}
+	for (int i=linecount; i<getLineCount(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		if (line.m_owner != NULL) {
+			return false;
+		}
+		if (line.hasSpines() || (line.compare(0, 5, "!!LO:") == 0)) {
+			return false;
+		}
+	}
+
+	// Attach the appended lines to the file:
+	for (int i=linecount; i<getLineCount(); i++) {
+		HumdrumLine& line = *m_lines[i];
+		HumdrumLine& previous = *m_lines[i-1];
+		line.setOwner(this);
+		line.setLineIndex(i);
+		if (line.getTokenCount() == 0) {
+			line.createTokensFromLine();
+		}
+		line.token(0)->setFieldIndex(0);
+		line.setDuration(0);
+		line.setDurationFromStart(previous.m_durationFromStart
+				+ previous.m_duration);
+		line.setDurationFromBarline(previous.m_durationFromBarline
+				+ previous.m_duration);
+		line.setDurationToBarline(previous.m_durationToBarline
+				- previous.m_duration);
+		line.m_rhythm_analyzed = previous.m_rhythm_analyzed;
+		if (line.isReference()) {
+			m_analyses.m_signifiers_analyzed = false;
+		}
+	}
+
+	clearDirtyLines();
 	return isValid();
 }
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::isAnalysisPreserved -- Returns true if the edits
+//    to a data line do not change the analyses done when the file was
+//    read: the spine structure, durations, null tokens, ties, slurs,
+//    phrases and pitches of each token must be the same as in the
+//    original text of the line.  Edited **kern and **recip tokens must
+//    not have been empty, and the duration of their new text must be
+//    the same as the analyzed duration.
+//
+
+bool HumdrumFileStructure::isAnalysisPreserved(HumdrumLine& line) {
+	const string& clean = line.getCleanText();
+	if (clean.empty() || (clean[0] == '*') || (clean[0] == '!') ||
+			(clean[0] == '=')) {
+		return false;
+	}
+	if (!line.isData()) {
+		return false;
+	}
+
+	// Characters in **kern and **recip tokens that must not change:
+	static const char* fixed = "0123456789.%qQr()[]{}_& abcdefgABCDEFG#-n";
+
+	int j = 0;
+	size_t start = 0;
+	while (start <= clean.size()) {
+		size_t end = clean.find('\t', start);
+		if (end == string::npos) {
+			end = clean.size();
+		}
+		if (j >= line.getTokenCount()) {
+			return false;
+		}
+		HTp token = line.token(j);
+		if ((token->getOwner() != &line) || (token->getFieldIndex() != j)) {
+			return false;
+		}
+		if (token->compare(0, string::npos, clean, start, end - start) != 0) {
+			bool wasnull = (end - start == 1) && (clean[start] == '.');
+			if (wasnull != token->isNull()) {
+				return false;
+			}
+			if (token->isMens()) {
+				return false;
+			}
+			if (token->isKern() || token->isDataType("**recip")) {
+				if ((start == end) || !token->m_rhythm_analyzed) {
+					// An empty field or an unanalyzed token has no rhythm
+					// which can be compared.
+					return false;
+				}
+				// The duration parsed from the new text must be the same
+				// as the one analyzed from the original text:
+				HumNum duration = token->getDuration();
+				token->analyzeDuration();
+				if (token->m_duration != duration) {
+					token->m_duration = duration;
+					return false;
+				}
+				string oldfixed;
+				string newfixed;
+				for (size_t k=start; k<end; k++) {
+					if (strchr(fixed, clean[k])) {
+						oldfixed.push_back(clean[k]);
+					}
+				}
+				for (size_t k=0; k<token->size(); k++) {
+					if (strchr(fixed, token->at(k))) {
+						newfixed.push_back(token->at(k));
+					}
+				}
+				if (oldfixed != newfixed) {
+					return false;
+				}
+			}
+		}
+		j++;
+		start = end + 1;
+	}
+	return j == line.getTokenCount();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumFileStructure::assignRhythmFromRecip --
@@ -26416,6 +29349,26 @@ bool HumdrumFileStructure::analyzeTokenDurations (void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumFileStructure::analyzeParameters -- Link global and local
+//    layout parameters to the tokens which they apply to.  This is
+//    done automatically the first time that parameters are requested
+//    from a token (such as with HumdrumToken::getLayoutParameter).
+//
+
+bool HumdrumFileStructure::analyzeParameters(void) {
+	if (m_analyses.m_parameters_analyzed) {
+		return isValid();
+	}
+	m_analyses.m_parameters_analyzed = true;
+	if (!analyzeGlobalParameters() ) { return isValid(); }
+	if (!analyzeLocalParameters()  ) { return isValid(); }
+	return isValid();
+}
+
+
+
 ///////////////////////////////
 //
 // HumdrumFileStructure::analyzeGlobalParameters -- only allowing layout
@@ -27125,8 +30078,6 @@ bool HumdrumFileStructure::analyzeStrands(void) {
 
 	resolveNullTokens();
 
-	analyzeLocalParameters();
-
 	analyzeStrophes();
 
 	return isValid();
@@ -27370,10 +30321,13 @@ bool HumdrumFileStructure::hasUniversalFilters(void) {
 
 //////////////////////////////
 //
-// HumdrumFileStructure::analyzeSignifiers --
+// HumdrumFileStructure::analyzeSignifiers -- Store !!!RDF records.  This
+//    is done automatically when a signifier is first requested.
 //
 
 void HumdrumFileStructure::analyzeSignifiers(void) {
+	m_analyses.m_signifiers_analyzed = true;
+	m_signifiers.clear();
 	HumdrumFileStructure& infile = *this;
 	for (int i=0; i<getLineCount(); i++) {
 		if (!infile[i].isSignifier()) {
@@ -27392,6 +30346,9 @@ void HumdrumFileStructure::analyzeSignifiers(void) {
 //
 
 std::string HumdrumFileStructure::getKernLinkSignifier(void) {
+	if (!m_analyses.m_signifiers_analyzed) {
+		analyzeSignifiers();
+	}
 	return m_signifiers.getKernLinkSignifier();
 }
 
@@ -27405,6 +30362,9 @@ std::string HumdrumFileStructure::getKernLinkSignifier(void) {
 //
 
 std::string HumdrumFileStructure::getKernAboveSignifier(void) {
+	if (!m_analyses.m_signifiers_analyzed) {
+		analyzeSignifiers();
+	}
 	return m_signifiers.getKernAboveSignifier();
 }
 
@@ -27418,6 +30378,9 @@ std::string HumdrumFileStructure::getKernAboveSignifier(void) {
 //
 
 std::string HumdrumFileStructure::getKernBelowSignifier(void) {
+	if (!m_analyses.m_signifiers_analyzed) {
+		analyzeSignifiers();
+	}
 	return m_signifiers.getKernBelowSignifier();
 }
 
@@ -27461,6 +30424,19 @@ HumdrumLine::HumdrumLine(const char* aString) : string(aString) {
 }
 
 
+HumdrumLine::HumdrumLine(const char* aString, size_t length) :
+		string(aString, length) {
+	m_owner = NULL;
+	if ((this->size() > 0) && (this->back() == 0x0d)) {
+		this->resize(this->size() - 1);
+	}
+	m_duration = -1;
+	m_durationFromStart = -1;
+	setPrefix("!!");
+	createTokensFromLine();
+}
+
+
 HumdrumLine::HumdrumLine(HumdrumLine& line)  : string((string)line) {
 	m_lineindex           = line.m_lineindex;
 	m_duration            = line.m_duration;
@@ -27624,6 +30600,39 @@ string HumdrumLine::getText(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumLine::setDirty -- Mark the line as changed.  The text of the
+//    line before the first change is kept (see getCleanText()), so that
+//    the owning file can check which analyses need to be updated.  Any
+//    note grid cached by the owning file is invalidated.
+//
+
+void HumdrumLine::setDirty(void) {
+	if (!m_dirty) {
+		m_dirty = true;
+		m_cleantext = *this;
+	}
+	HumdrumFile* infile = getOwner();
+	if (infile) {
+		infile->invalidateNoteGrid();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumLine::clearDirty -- Mark the line as unchanged.
+//
+
+void HumdrumLine::clearDirty(void) {
+	m_dirty = false;
+	m_cleantext.clear();
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumLine::clear -- Remove stored tokens.
@@ -28673,9 +31682,6 @@ int HumdrumLine::createTokensFromLine(void) {
 	m_tokens.clear();
 	m_tabs.clear();
 	HTp token;
-	char ch = 0;
-	char lastch = 0;
-	string tstring;
 
 	if (this->size() == 0) {
 		token = new HumdrumToken();
@@ -28688,34 +31694,35 @@ int HumdrumLine::createTokensFromLine(void) {
 		m_tokens.push_back(token);
 		m_tabs.push_back(0);
 	} else {
-		for (int i=0; i<(int)size(); i++) {
-			lastch = ch;
-			ch = getChar(i);
-			if (ch == '\t') {
-				// Parser now allows multiple tab characters in a
-				// row to represent a single tab.
-				if (lastch != '\t') {
-					token = new HumdrumToken(tstring);
-					token->setOwner(this);
-					m_tokens.push_back(token);
-					m_tabs.push_back(1);
-					tstring.clear();
-				} else {
-					if (m_tabs.size() > 0) {
-						m_tabs.back()++;
-					}
-				}
+		// Scan the line for tabs and copy each token directly from
+		// the line rather than building it up character by character.
+		const char* text = this->c_str();
+		int length = (int)this->size();
+		int start = 0;
+		for (int i=0; i<length; i++) {
+			if (text[i] != '\t') {
+				continue;
+			}
+			// Parser now allows multiple tab characters in a
+			// row to represent a single tab.
+			if ((i == 0) || (text[i-1] != '\t')) {
+				token = new HumdrumToken(string(text + start, i - start));
+				token->setOwner(this);
+				m_tokens.push_back(token);
+				m_tabs.push_back(1);
 			} else {
-				tstring += ch;
+				if (m_tabs.size() > 0) {
+					m_tabs.back()++;
+				}
 			}
+			start = i + 1;
+		}
+		if (start < length) {
+			token = new HumdrumToken(string(text + start, length - start));
+			token->setOwner(this);
+			m_tokens.push_back(token);
+			m_tabs.push_back(0);
 		}
-	}
-	if (tstring.size() > 0) {
-		token = new HumdrumToken(tstring);
-		token->setOwner(this);
-		m_tokens.push_back(token);
-		m_tabs.push_back(0);
-		tstring.clear();
 	}
 
 	return (int)m_tokens.size();
@@ -28733,8 +31740,7 @@ int HumdrumLine::createTokensFromLine(void) {
 //
 
 void HumdrumLine::createLineFromTokens(void) {
-	string& iline = *this;
-	iline = "";
+	string iline;
 	// needed for empty lines for some reason:
 	if (m_tokens.size()) {
 		if (m_tokens.back() == NULL) {
@@ -28742,7 +31748,7 @@ void HumdrumLine::createLineFromTokens(void) {
 		}
 	}
 	for (int i=0; i<(int)m_tokens.size(); i++) {
-		iline += (string)(*m_tokens.at(i));
+		iline += *m_tokens.at(i);
 		if (i < (int)m_tokens.size() - 1) {
 			if ((int)m_tabs.size() <= i) {
 				for (int j=0; j<(int)m_tokens.size() - (int)m_tabs.size(); j++) {
@@ -28757,6 +31763,10 @@ void HumdrumLine::createLineFromTokens(void) {
 			}
 		}
 	}
+	if (iline != *this) {
+		setDirty();
+		string::swap(iline);
+	}
 }
 
 
@@ -30383,7 +33393,7 @@ bool HumdrumToken::analyzeDuration(void) {
 					if (strchr(this->c_str(), 'q') != NULL) {
 						m_duration = 0;
 					} else {
-						m_duration = Convert::recipToDuration((string)(*this));
+						m_duration = Convert::recipToDuration(*this);
 					}
 				} else if (isMens()) {
 					m_duration = Convert::mensToDuration((string)(*this));
@@ -30552,11 +33562,14 @@ HumNum HumdrumToken::getDurationNoDots(HumNum scale) {
 //////////////////////////////
 //
 // HumdrumToken::setDuration -- Sets the duration of the token.  This is done in
-//    HumdrumFileStructure::analyzeTokenDurations().
+//    HumdrumFileStructure::analyzeTokenDurations().  The duration will not be
+//    parsed again from the token (GridSlice::transferTokens() uses this
+//    to pass on the durations of notes in a HumGrid).
 //
 
 void HumdrumToken::setDuration(const HumNum& dur) {
 	m_duration = dur;
+	m_rhythm_analyzed = true;
 }
 
 
@@ -31976,10 +34989,19 @@ void HumdrumToken::setParameters(const string& pdata, HumdrumToken* ptok) {
 
 //////////////////////////////
 //
-// HumdrumToken::setText --
+// HumdrumToken::setText -- Change the text of the token.  The owning
+//    line is marked as dirty (which also invalidates any note grid cached
+//    by the file).
 //
 
 void HumdrumToken::setText(const string& text) {
+	if (text == *this) {
+		return;
+	}
+	HLp owner = getOwner();
+	if (owner) {
+		owner->setDirty();
+	}
 	string::assign(text);
 }
 
@@ -32048,6 +35070,7 @@ int HumdrumToken::addLinkedParameterSet(HTp token) {
 //
 
 bool HumdrumToken::linkedParameterIsGlobal(int index) {
+	analyzeOwnerParameters();
 	return m_linkedParameterTokens.at(index)->isCommentGlobal();
 }
 
@@ -32059,6 +35082,7 @@ bool HumdrumToken::linkedParameterIsGlobal(int index) {
 //
 
 int HumdrumToken::getLinkedParameterSetCount(void) {
+	analyzeOwnerParameters();
 	return (int)m_linkedParameterTokens.size();
 }
 
@@ -32070,6 +35094,7 @@ int HumdrumToken::getLinkedParameterSetCount(void) {
 //
 
 HumParamSet* HumdrumToken::getParameterSet(void) {
+	analyzeOwnerParameters();
 	return m_parameterSet;
 }
 
@@ -32081,6 +35106,7 @@ HumParamSet* HumdrumToken::getParameterSet(void) {
 //
 
 HumParamSet* HumdrumToken::getLinkedParameterSet(int index) {
+	analyzeOwnerParameters();
 	return m_linkedParameterTokens.at(index)->getParameterSet();
 }
 
@@ -32106,6 +35132,52 @@ void HumdrumToken::storeParameterSet(void) {
 
 
 
+//////////////////////////////
+//
+// HumdrumToken::analyzeOwnerStrands -- Analyze the spine strands (and
+//    strophes) of the owning HumdrumFile if they have not yet been
+//    analyzed.
+//
+
+void HumdrumToken::analyzeOwnerStrands(void) const {
+	HLp hline = getOwner();
+	if (!hline) {
+		return;
+	}
+	HumdrumFile* infile = hline->getOwner();
+	if (!infile) {
+		return;
+	}
+	if (!infile->areStrandsAnalyzed()) {
+		infile->analyzeStrands();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// HumdrumToken::analyzeOwnerParameters -- Link layout parameters
+//    to tokens in the owning HumdrumFile if they have not yet been
+//    analyzed.
+//
+
+void HumdrumToken::analyzeOwnerParameters(void) {
+	HLp hline = getOwner();
+	if (!hline) {
+		return;
+	}
+	HumdrumFile* infile = hline->getOwner();
+	if (!infile) {
+		return;
+	}
+	if (!infile->areParametersAnalyzed()) {
+		infile->analyzeParameters();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // HumdrumToken::makeForwardLink -- Line a following spine token to this one.
@@ -32585,6 +35657,7 @@ int HumdrumToken::getState(void) const {
 //
 
 int  HumdrumToken::getStrandIndex(void) const {
+	analyzeOwnerStrands();
 	return m_strand;
 }
 
@@ -32796,6 +35869,7 @@ ostream& HumdrumToken::printXml(ostream& out, int level, const string& indent) {
 //
 
 ostream&	HumdrumToken::printXmlLinkedParameters(ostream& out, int level, const string& indent) {
+	analyzeOwnerParameters();
 	if (m_parameterSet) {
 		m_parameterSet->printXml(out, level, indent);
 	}
@@ -32810,6 +35884,7 @@ ostream&	HumdrumToken::printXmlLinkedParameters(ostream& out, int level, const s
 //
 
 ostream& HumdrumToken::printXmlLinkedParameterInfo(ostream& out, int level, const string& indent) {
+	analyzeOwnerParameters();
 	if (m_linkedParameterTokens.empty()) {
 		return out;
 	}
@@ -33219,6 +36294,7 @@ void HumdrumToken::copyStructure(HTp token) {
 //
 
 HTp HumdrumToken::getStrophe(void) {
+	analyzeOwnerStrands();
 	return m_strophe;
 }
 
@@ -33252,6 +36328,7 @@ void HumdrumToken::setStrophe(HTp strophe) {
 //
 
 bool HumdrumToken::hasStrophe(void) {
+	analyzeOwnerStrands();
 	return m_strophe ? true : false;
 }
 
@@ -33276,6 +36353,7 @@ void HumdrumToken::clearStrophe(void) {
 //
 
 int HumdrumToken::getStropheStartIndex(void) {
+	analyzeOwnerStrands();
 	if (!m_strophe) {
 		return -1;
 	}
@@ -33291,6 +36369,7 @@ int HumdrumToken::getStropheStartIndex(void) {
 //
 
 bool HumdrumToken::isFirstStrophe(void) {
+	analyzeOwnerStrands();
 	if (!m_strophe) {
 		return true;
 	}
@@ -33317,6 +36396,7 @@ bool HumdrumToken::isPrimaryStrophe(void) {
 //
 
 bool HumdrumToken::isStrophe(const string& label) {
+	analyzeOwnerStrands();
 	if (!m_strophe) {
 		return false;
 	}
@@ -33338,6 +36418,7 @@ bool HumdrumToken::isStrophe(const string& label) {
 //
 
 string HumdrumToken::getStropheLabel(void) {
+	analyzeOwnerStrands();
 	if (!m_strophe) {
 		return "";
 	}
@@ -41311,7 +44392,7 @@ ostream& operator<<(ostream& out, MuseRecordBasic* aRecord) {
 class MxmlMeasure;
 class MxmlPart;
 
-int MxmlEvent::m_counter = 0;
+thread_local int MxmlEvent::m_counter = 0;
 
 ////////////////////////////////////////////////////////////////////////////
 
@@ -42403,7 +45484,7 @@ bool MxmlEvent::parseEvent(xml_node el, xml_node nextel, HumNum starttime) {
 	switch (m_eventtype) {
 		case mevent_note:
 			setDuration(0);
-			if (hasChild("./chord")) {
+			if (m_node.child("chord")) {
 				setDuration(0);
 				attachToLastEvent();
 			} else {
@@ -42440,7 +45521,7 @@ bool MxmlEvent::parseEvent(xml_node el, xml_node nextel, HumNum starttime) {
 			break;
 
 		case mevent_attributes:
-			setQTicks(getIntValue("./divisions"));
+			setQTicks(atoi(m_node.child("divisions").child_value()));
 			timesigdur = getTimeSigDur();
 			if (timesigdur > 0) {
 				reportTimeSigDurToOwner(timesigdur);
@@ -42988,7 +46069,7 @@ void MxmlEvent::addNotations(stringstream& ss, xml_node notations,
 					downbow = true;
 				} else if (strcmp(grandchild.name(), "harmonic") == 0) {
 					// check of not an artificial harmonic
-					xml_node artificial = grandchild.select_node("artificial").node();
+					xml_node artificial = grandchild.child("artificial");
 					if (!artificial) {
 						// natural harmonic
 						harmonic = true;
@@ -43224,24 +46305,24 @@ int MxmlEvent::getDotCount(void) const {
 //
 
 string MxmlEvent::getRestPitch(void) const {
-	xpath_node rest = m_node.select_node("./rest");
-	if (rest.node().empty()) {
+	xml_node rest = m_node.child("rest");
+	if (rest.empty()) {
 		// not a rest, so no pitch information.
 		return "";
 	}
-	xpath_node step = rest.node().select_node("./display-step");
-	if (step.node().empty()) {
+	xml_node step = rest.child("display-step");
+	if (step.empty()) {
 		// no vertical positioning information
 	}
-	string steptext = step.node().child_value();
+	string steptext = step.child_value();
 	if (steptext.empty()) {
 		return "";
 	}
-	xpath_node octave = rest.node().select_node("./display-octave");
-	if (octave.node().empty()) {
+	xml_node octave = rest.child("display-octave");
+	if (octave.empty()) {
 		// not enough vertical positioning information
 	}
-	string octavetext = octave.node().child_value();
+	string octavetext = octave.child_value();
 	if (octavetext.empty()) {
 		return "";
 	}
@@ -44465,7 +47546,7 @@ bool MxmlPart::addMeasure(xml_node mel) {
 	if (m_stems) {
 		meas->enableStems();
 	}
-	if (m_measures.size() > 0) {
+	if ((m_measures.size() > 0) && m_measures.back()) {
 		meas->setPreviousMeasure(m_measures.back());
 		m_measures.back()->setNextMeasure(meas);
 	}
@@ -44477,6 +47558,50 @@ bool MxmlPart::addMeasure(xml_node mel) {
 
 
 
+//////////////////////////////
+//
+// MxmlPart::deleteMeasure -- Free the memory for a measure which is no
+//    longer needed.  The measure index is kept (getMeasure() will return
+//    NULL for it), so later measures do not change their index.
+//
+
+void MxmlPart::deleteMeasure(int index) {
+	MxmlMeasure* measure = getMeasure(index);
+	if (!measure) {
+		return;
+	}
+	MxmlMeasure* previous = measure->getPreviousMeasure();
+	MxmlMeasure* next = measure->getNextMeasure();
+	if (previous) {
+		previous->setNextMeasure(NULL);
+	}
+	if (next) {
+		next->setPreviousMeasure(NULL);
+	}
+	delete measure;
+	m_measures[index] = NULL;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlPart::clearMeasures -- Delete all measures and the divisions
+//    history, but keep the information which the measures reported
+//    to the part (staff/voice counts, verse counts, etc.).
+//
+
+void MxmlPart::clearMeasures(void) {
+	for (int i=0; i<(int)m_measures.size(); i++) {
+		delete m_measures[i];
+		m_measures[i] = NULL;
+	}
+	m_measures.clear();
+	m_qtick.clear();
+}
+
+
+
 //////////////////////////////
 //
 // MxmlPart::getMeasureCount -- Return the number of stored measures.
@@ -45049,12 +48174,12 @@ void MxmlPart::printStaffVoiceInfo(void) {
 
 void MxmlPart::parsePartInfo(xml_node partinfo) {
 // ggg cerr << "PART INFO ID " << partinfo.attribute("id").value() << endl;
-	xml_node partnamenode = partinfo.select_node("./part-name").node();
+	xml_node partnamenode = partinfo.child("part-name");
 	if (partnamenode) {
 // ggg cerr << "PART NAME " << partnamenode.child_value() << endl;
 		m_partname = cleanSpaces(partnamenode.child_value());
 	}
-	xml_node abbrnode = partinfo.select_node("./part-abbreviation").node();
+	xml_node abbrnode = partinfo.child("part-abbreviation");
 	if (abbrnode) {
 		m_partabbr = cleanSpaces(abbrnode.child_value());
 	}
@@ -45115,6 +48240,395 @@ string MxmlPart::cleanSpaces(const string& input) {
 
 
 
+//////////////////////////////
+//
+// MxmlStream::MxmlStream -- Constructor.
+//
+
+MxmlStream::MxmlStream(void) {
+	m_data = NULL;
+	m_size = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::~MxmlStream -- Deconstructor.
+//
+
+MxmlStream::~MxmlStream() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::clear -- Close the file and remove the index.
+//
+
+void MxmlStream::clear(void) {
+	m_file.close();
+	m_data = NULL;
+	m_size = 0;
+	m_partids.clear();
+	m_contents.clear();
+	m_measures.clear();
+	m_error.clear();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::open -- Open a MusicXML file and index its part and
+//     measure elements.  Returns false if the file cannot be read, is
+//     not a UTF-8 score-partwise document, or if its tags are not
+//     balanced.  The reason is available from getError().
+//
+
+bool MxmlStream::open(const string& filename) {
+	clear();
+	if (!m_file.open(filename)) {
+		m_error = "Cannot read file " + filename;
+		return false;
+	}
+	m_data = m_file.getData();
+	m_size = m_file.getSize();
+	if (!isUtf8()) {
+		m_error = "Only UTF-8 files can be read one measure at a time";
+		return false;
+	}
+	return scan();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::loadSkeleton -- Parse the file with the contents of the part
+//     elements removed.  The part elements remain (empty) so that the
+//     part IDs can be matched to the part-list.
+//
+
+bool MxmlStream::loadSkeleton(xml_document& doc) {
+	string skeleton;
+	size_t start = 0;
+	for (int i=0; i<(int)m_contents.size(); i++) {
+		skeleton.append(m_data + start, m_contents[i].first - start);
+		start = m_contents[i].second;
+	}
+	skeleton.append(m_data + start, m_size - start);
+
+	pugi::xml_parse_result result = doc.load_buffer(skeleton.data(), skeleton.size());
+	if (!result) {
+		stringstream ss;
+		ss << "XML content has syntax errors: " << result.description();
+		m_error = ss.str();
+		return false;
+	}
+
+	m_partids.clear();
+	for (xml_node part : doc.child("score-partwise").children("part")) {
+		m_partids.push_back(part.attribute("id").value());
+	}
+	if (m_partids.size() != m_measures.size()) {
+		m_error = "Part elements could not be indexed";
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::getPartCount -- Return the number of part elements in the file.
+//
+
+int MxmlStream::getPartCount(void) const {
+	return (int)m_measures.size();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::getPartIndex -- Return the index of the (first) part element
+//     with the given ID, or -1 if there is no such part.  Only available
+//     after loadSkeleton().
+//
+
+int MxmlStream::getPartIndex(const string& id) const {
+	for (int i=0; i<(int)m_partids.size(); i++) {
+		if (m_partids[i] == id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::getMeasureCount -- Return the number of measure elements
+//     in a part.
+//
+
+int MxmlStream::getMeasureCount(int partindex) const {
+	if ((partindex < 0) || (partindex >= (int)m_measures.size())) {
+		return 0;
+	}
+	return (int)m_measures[partindex].size();
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::loadMeasure -- Parse a single measure element into the given
+//     document (replacing any previous contents) and return the measure
+//     node.  An empty node is returned if the measure has syntax errors.
+//
+
+xml_node MxmlStream::loadMeasure(xml_document& doc, int partindex,
+		int measureindex) {
+	const pair<size_t, size_t>& range = m_measures.at(partindex).at(measureindex);
+	pugi::xml_parse_result result = doc.load_buffer(m_data + range.first,
+			range.second - range.first, pugi::parse_default, pugi::encoding_utf8);
+	if (!result) {
+		stringstream ss;
+		ss << "XML content has syntax errors: " << result.description()
+		   << " at offset " << (range.first + result.offset);
+		m_error = ss.str();
+		return xml_node();
+	}
+	return doc.child("measure");
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::getError -- Return a description of the last problem.
+//
+
+const string& MxmlStream::getError(void) const {
+	return m_error;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::scan -- Store the byte ranges of the part contents and
+//     measure elements.  Only tags are tokenized: comments, CDATA sections,
+//     processing instructions and the DOCTYPE declaration are skipped, and
+//     text content is never examined.
+//
+
+bool MxmlStream::scan(void) {
+	size_t i = 0;
+	int depth = 0;
+	bool inpart = false;
+	bool inmeasure = false;
+	while (i < m_size) {
+		const char* ptr = (const char*)memchr(m_data + i, '<', m_size - i);
+		if (!ptr) {
+			i = m_size;
+			break;
+		}
+		i = ptr - m_data;
+		if (i + 1 >= m_size) {
+			break;
+		}
+
+		char next = m_data[i+1];
+		if (next == '?') {
+			i = skipPast(i + 2, "?>");
+			continue;
+		} else if ((next == '!') && (strncmp(m_data + i, "<!--", 4) == 0)) {
+			i = skipPast(i + 4, "-->");
+			continue;
+		} else if ((next == '!') && (strncmp(m_data + i, "<![CDATA[", 9) == 0)) {
+			i = skipPast(i + 9, "]]>");
+			continue;
+		}
+
+		size_t end = findTagEnd(i);
+		if (end == string::npos) {
+			break;
+		}
+
+		if (next == '!') {
+			// DOCTYPE declaration
+		} else if (next == '/') {
+			depth--;
+			if ((depth == 1) && inpart) {
+				m_contents.back().second = i;
+				inpart = false;
+			} else if ((depth == 2) && inmeasure) {
+				m_measures.back().back().second = end + 1;
+				inmeasure = false;
+			}
+		} else {
+			bool empty = m_data[end-1] == '/';
+			string name = getTagName(i + 1);
+			if (depth == 0) {
+				if (name != "score-partwise") {
+					m_error = "Only score-partwise files can be read one measure at a time";
+					return false;
+				}
+			} else if ((depth == 1) && (name == "part")) {
+				m_contents.emplace_back(end + 1, end + 1);
+				m_measures.resize(m_measures.size() + 1);
+				inpart = !empty;
+			} else if ((depth == 2) && inpart && (name == "measure")) {
+				m_measures.back().emplace_back(i, end + 1);
+				inmeasure = !empty;
+			}
+			if (!empty) {
+				depth++;
+			}
+		}
+		i = end + 1;
+	}
+
+	if ((i < m_size) || (depth != 0)) {
+		m_error = "Unexpected end of file";
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::skipPast -- Return the index after the next occurrence of
+//     the target string, or the size of the data if not found.
+//
+
+size_t MxmlStream::skipPast(size_t index, const char* target) {
+	size_t length = strlen(target);
+	while (index < m_size) {
+		const char* ptr = (const char*)memchr(m_data + index, target[0],
+				m_size - index);
+		if (!ptr) {
+			break;
+		}
+		index = ptr - m_data;
+		if ((m_size - index >= length) && (strncmp(ptr, target, length) == 0)) {
+			return index + length;
+		}
+		index++;
+	}
+	return m_size;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::findTagEnd -- Return the index of the ">" which closes the
+//     tag starting at the given index, ignoring any ">" inside of quoted
+//     attribute values or the internal subset of a DOCTYPE declaration.
+//     Returns string::npos if the tag is not closed.
+//
+
+size_t MxmlStream::findTagEnd(size_t index) {
+	char quote = 0;
+	int brackets = 0;
+	for (size_t i=index+1; i<m_size; i++) {
+		char c = m_data[i];
+		if (quote) {
+			if (c == quote) {
+				quote = 0;
+			}
+		} else if ((c == '"') || (c == '\'')) {
+			quote = c;
+		} else if (c == '[') {
+			brackets++;
+		} else if (c == ']') {
+			brackets--;
+		} else if ((c == '>') && (brackets <= 0)) {
+			return i;
+		}
+	}
+	return string::npos;
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::getTagName -- Return the element name starting at the
+//     given index.
+//
+
+string MxmlStream::getTagName(size_t index) {
+	size_t end = index;
+	while (end < m_size) {
+		char c = m_data[end];
+		if (isspace((unsigned char)c) || (c == '/') || (c == '>')) {
+			break;
+		}
+		end++;
+	}
+	return string(m_data + index, end - index);
+}
+
+
+
+//////////////////////////////
+//
+// MxmlStream::isUtf8 -- True if the file is encoded in UTF-8 (or ASCII),
+//     according to its XML declaration.  Files without a declaration are
+//     UTF-8 unless they start with a UTF-16 or UTF-32 byte-order mark.
+//
+
+bool MxmlStream::isUtf8(void) {
+	size_t start = 0;
+	if ((m_size >= 3) && (strncmp(m_data, "\xEF\xBB\xBF", 3) == 0)) {
+		start = 3;
+	}
+	if (m_size - start < 2) {
+		return true;
+	}
+	if ((m_data[start] == '\0') || (m_data[start+1] == '\0') ||
+			(m_data[start] == '\xFE') || (m_data[start] == '\xFF')) {
+		return false;
+	}
+	if ((m_size - start < 5) || (strncmp(m_data + start, "<?xml", 5) != 0)) {
+		return true;
+	}
+
+	size_t end = skipPast(start, "?>");
+	string declaration(m_data + start, end - start);
+	size_t index = declaration.find("encoding");
+	if (index == string::npos) {
+		return true;
+	}
+	index = declaration.find_first_of("\"'", index);
+	if (index == string::npos) {
+		return true;
+	}
+	size_t index2 = declaration.find(declaration[index], index + 1);
+	if (index2 == string::npos) {
+		return false;
+	}
+	string encoding = declaration.substr(index + 1, index2 - index - 1);
+	for (int i=0; i<(int)encoding.size(); i++) {
+		encoding[i] = tolower(encoding[i]);
+	}
+	return (encoding == "utf-8") || (encoding == "utf8") ||
+			(encoding == "us-ascii") || (encoding == "ascii");
+}
+
+
+
 //////////////////////////////
 //
 // NoteCell::NoteCell -- Constructor.
@@ -45128,6 +48642,34 @@ NoteCell::NoteCell(NoteGrid* owner, HTp token) {
 }
 
 
+//
+// Copy a cell from a CompactNoteGrid rather than calculating the
+// pitches from the token again (used by NoteGrid::load).
+//
+
+NoteCell::NoteCell(NoteGrid* owner, const CompactNoteGrid& source, int vindex,
+		int sindex) {
+	clear();
+	m_owner     = owner;
+	m_token     = source.getToken(vindex, sindex);
+	m_voice     = vindex;
+	m_timeslice = sindex;
+	int b7         = source.getSgnDiatonicPitch(vindex, sindex);
+	int b12        = source.getSgnMidiPitch(vindex, sindex);
+	int b40        = source.getSgnBase40Pitch(vindex, sindex);
+	int accidental = source.getSgnAccidental(vindex, sindex);
+	m_b7         = (b7  == CompactNoteGrid::REST) ? NAN : b7;
+	m_b12        = (b12 == CompactNoteGrid::REST) ? NAN : b12;
+	m_b40        = (b40 == CompactNoteGrid::REST) ? NAN : b40;
+	m_accidental = (accidental == CompactNoteGrid::REST) ? NAN : accidental;
+	m_currAttackIndex = source.getCurrAttackIndex(vindex, sindex);
+	m_prevAttackIndex = source.getPrevAttackIndex(vindex, sindex);
+	m_nextAttackIndex = source.getNextAttackIndex(vindex, sindex);
+	m_metertop        = source.getMeterTop(vindex, sindex);
+	m_meterbot        = source.getMeterBottom(vindex, sindex);
+}
+
+
 
 //////////////////////////////
 //
@@ -45608,7 +49150,10 @@ int NoteGrid::getSliceCount(void) {
 //
 // NoteGrid::load -- Generate a two-dimensional list of notes
 //     in a score.  Each row has at least one note attack, or an
-//     empty data line in the Humdrum file will be skipped.
+//     empty data line in the Humdrum file will be skipped.  The
+//     pitches and attack indexes are copied from the CompactNoteGrid
+//     cached on the file, so several NoteGrids (or tools) using the
+//     same file share a single analysis of the notes.
 //
 
 bool NoteGrid::load(HumdrumFile& infile) {
@@ -45617,86 +49162,23 @@ bool NoteGrid::load(HumdrumFile& infile) {
 
 	m_infile = &infile;
 
-	m_kernspines = infile.getKernSpineStartList();
-	vector<HTp>& kernspines = m_kernspines;
-
-	vector<int> metertops(infile.getMaxTrack() + 1, 0);
-	vector<HumNum> meterbots(infile.getMaxTrack() + 1, 0);
+	CompactNoteGrid& source = infile.getCompactNoteGrid();
+	m_kernspines = source.getKernSpineStarts();
 
-	if (kernspines.size() == 0) {
-		cerr << "Warning: no **kern spines in file" << endl;
+	int slices = source.getSliceCount();
+	vector<vector<NoteCell* > >& grid = m_grid;
+	grid.resize(source.getVoiceCount());
+	if (!source.isValid()) {
 		return false;
 	}
-
-	vector<vector<NoteCell* > >& grid = m_grid;
-	grid.resize(kernspines.size());
 	for (int i=0; i<(int)grid.size(); i++) {
-		grid[i].reserve(infile.getLineCount());
-	}
-
-	int attack = 0;
-	int track, lasttrack;
-	vector<HTp> current;
-	HumRegex hre;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (infile[i].isInterpretation()) {
-			for (int j=0; j<infile[i].getFieldCount(); j++) {
-				if (!infile[i].token(j)->isKern()) {
-					continue;
-				}
-				track = infile.token(i, j)->getTrack();
-				if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)%(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
-					meterbots[track] /= hre.getMatchInt(3);
-				} else if (hre.search(*infile.token(i, j), "\\*M(\\d+)/(\\d+)")) {
-					metertops[track] = hre.getMatchInt(1);
-					meterbots[track] = hre.getMatchInt(2);
-				} else {
-					continue;
-				}
-
-			}
-		}
-		if (!infile[i].isData()) {
-			continue;
-		}
-		track = 0;
-		attack = 0;
-		current.clear();
-		for (int j=0; j<infile[i].getFieldCount(); j++) {
-			lasttrack = track;
-			track = infile.token(i, j)->getTrack();
-			if (!infile[i].token(j)->isDataType("**kern")) {
-				continue;
-			}
-			if (track == lasttrack) {
-				// secondary voice: ignore
-				continue;
-			}
-			current.push_back(infile.token(i, j));
-			if (!(current.back()->isRest()
-					|| current.back()->isSecondaryTiedNote())) {
-				attack++;
-			}
-		}
-		if (current.size() != kernspines.size()) {
-			cerr << "Error: Unequal vector sizes " << current.size()
-			     << " compared to " << kernspines.size() << endl;
-			return false;
-		}
-		for (int j=0; j<(int)current.size(); j++) {
-			NoteCell* cell = new NoteCell(this, current[j]);
-			track = current[j]->getTrack();
-			cell->setVoiceIndex(j);
-			cell->setSliceIndex((int)grid[j].size());
-			cell->setMeter(metertops[track], meterbots[track]);
-			grid[j].push_back(cell);
+		grid[i].resize(slices);
+		for (int j=0; j<slices; j++) {
+			grid[i][j] = new NoteCell(this, source, i, j);
 		}
+		buildTiedTokens(i);
 	}
 
-	buildAttackIndexes();
-
 	return true;
 }
 
@@ -45811,106 +49293,27 @@ void NoteGrid::printKernGrid(ostream& output) {
 
 //////////////////////////////
 //
-// NoteGrid::buildAttackIndexes -- create forward and backward
-//     note attack indexes for each cell.
-//
-
-void NoteGrid::buildAttackIndexes(void) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		buildAttackIndex(i);
-	}
-}
-
-
-
-//////////////////////////////
-//
-// NoteGrid::buildAttackIndex -- create forward and backward
-//     note attack indexes for each cell in a single voice.
+// NoteGrid::buildTiedTokens -- Store the tokens of sustained notes
+//     (and of rests after the first rest in a sequence) in the
+//     m_tiedtokens list of the last note attack in a voice.
 //
 
-void NoteGrid::buildAttackIndex(int vindex) {
+void NoteGrid::buildTiedTokens(int vindex) {
 	vector<NoteCell*>& part = m_grid[vindex];
-
-	// Set the slice index for the attack of the current note.  This
-	// will be the same as the current slice if the NoteCell is an attack.
-	// Otherwise if the note is a sustain, thie index will be set
-	// to the slice of the attack correspinding to this NoteCell.
-	// For rests, the first rest in a continuous sequence of rests
-	// will be marked as the "attack" of the rest.
 	NoteCell* currentcell = NULL;
-	for (int i=0; i<(int)part.size(); i++) {
-		if (i == 0) {
-			part[0]->setCurrAttackIndex(0);
-			continue;
-		}
-		if (part[i]->isRest()) {
-			// This is a rest, so check for a rest sustain or start
-			// of a rest sequence.
-			if (part[i-1]->isRest()) {
-				// rest "sustain"
-				if (currentcell && !part[i]->getToken()->isNull()) {
-					currentcell->m_tiedtokens.push_back(part[i]->getToken());
-				}
-				part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
-			} else {
-				// rest "attack";
-				part[i]->setCurrAttackIndex(i);
-			}
-		} else if (part[i]->isAttack()) {
-			part[i]->setCurrAttackIndex(i);
-			currentcell = part[i];
-		} else {
-			// This is a sustain, so get the attack index of the
-			// note from the previous slice index.
-			part[i]->setCurrAttackIndex(part[i-1]->getCurrAttackIndex());
-			if (currentcell && !part[i]->getToken()->isNull()) {
-				currentcell->m_tiedtokens.push_back(part[i]->getToken());
-			}
-		}
-	}
-
-	// start with note attacks marked in the previous and next note slots:
-	for (int i=0; i<(int)part.size(); i++) {
+	for (int i=1; i<(int)part.size(); i++) {
 		if (part[i]->isAttack()) {
-			part[i]->setNextAttackIndex(i);
-			part[i]->setPrevAttackIndex(i);
-		} else if (part[i]->isRest()) {
-			if (part[i]->getCurrAttackIndex() == i) {
-				part[i]->setNextAttackIndex(i);
-				part[i]->setPrevAttackIndex(i);
-			}
+			currentcell = part[i];
+			continue;
 		}
-	}
-
-	// Go back and adjust the next note attack index:
-	int value = -1;
-	int temp  = -1;
-	for (int i=(int)part.size()-1; i>=0; i--) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getNextAttackIndex();
-			part[i]->setNextAttackIndex(value);
-			value = temp;
-		} else {
-			part[i]->setNextAttackIndex(value);
+		if (part[i]->isRest() && !part[i-1]->isRest()) {
+			// rest "attack"
+			continue;
 		}
-	}
-
-	// Go back and adjust the previous note attack index:
-	value = -1;
-	temp  = -1;
-	for (int i=0; i<(int)part.size(); i++) {
-		if (!part[i]->isSustained()) {
-			temp = part[i]->getPrevAttackIndex();
-			part[i]->setPrevAttackIndex(value);
-			value = temp;
-		} else {
-			if (i != 0) {
-				part[i]->setPrevAttackIndex(part[i-1]->getPrevAttackIndex());
-			}
+		if (currentcell && !part[i]->getToken()->isNull()) {
+			currentcell->m_tiedtokens.push_back(part[i]->getToken());
 		}
 	}
-
 }
 
 
@@ -48371,6 +51774,7 @@ Tool_autobeam::Tool_autobeam(void) {
 	define("l|lyric|lyrics=b",     "break beam by lyric syllables");
 	define("L|lyric-info=b",       "return the number of breaks needed");
 	define("rest|include-rests=b", "include rests in beam edges");
+	defineThreadOption();
 }
 
 
@@ -49450,6 +52854,7 @@ Tool_autostem::Tool_autostem(void) {
 	define("version=b",       "Program version");
 	define("example=b",       "Program examples");
 	define("h|help=b",        "Short description");
+	defineThreadOption();
 }
 
 
@@ -50711,6 +54116,11 @@ void Tool_autostem::countBeamStuff(const string& token, int& start, int& stop,
 Tool_binroll::Tool_binroll(void) {
 	// add options here
 	define("t|timebase=s:16", "timebase to do analysis at");
+	define("b|binary=b",      "output packed binary roll (per voice)");
+	define("r|rle=b",         "run-length compress binary roll");
+	define("low=i:0",         "lowest MIDI pitch in binary roll");
+	define("high=i:127",      "highest MIDI pitch in binary roll");
+	defineThreadOption();
 }
 
 
@@ -50753,25 +54163,72 @@ bool Tool_binroll::run(HumdrumFile& infile, ostream& out) {
 
 
 bool Tool_binroll::run(HumdrumFile& infile) {
-	m_duration.setValue(1, 4); // 16th note
-	processFile(infile);
+	initialize();
+	processFile(infile, m_free_text);
+	return true;
+}
+
+
+//
+// Streaming interface: each file is written to the output as soon as it
+// has been read, so only one score is kept in memory.
+//
+
+bool Tool_binroll::run(HumdrumFileStream& instream, ostream& out) {
+	initialize();
+	HumdrumFile infile;
+	while (instream.read(infile)) {
+		processFile(infile, out);
+	}
 	return true;
 }
 
 
 
+//////////////////////////////
+//
+// Tool_binroll::initialize --
+//
+
+void Tool_binroll::initialize(void) {
+	m_duration.setValue(1, 4); // 16th note
+	m_binaryQ = getBoolean("binary");
+	m_rleQ    = getBoolean("rle");
+	m_low     = getInteger("low");
+	m_high    = getInteger("high");
+	m_low     = std::max(0, std::min(127, m_low));
+	m_high    = std::max(0, std::min(127, m_high));
+	if (m_low > m_high) {
+		std::swap(m_low, m_high);
+	}
+	m_words = (m_high - m_low) / 64 + 1;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_binroll::processFile --
 //
 
-void Tool_binroll::processFile(HumdrumFile& infile) {
-	vector<vector<char>> output;
-	output.resize(128);
+void Tool_binroll::processFile(HumdrumFile& infile, ostream& out) {
 	int count = (infile.getScoreDuration() / m_duration).getInteger() + 1;
-	for (int i=0; i<(int)output.size(); i++) {
-		output[i].resize(count);
-		std::fill(output[i].begin(), output[i].end(), 0);
+
+	vector<vector<char>> output;
+	vector<int> voices(infile.getMaxTrack() + 1, -1);
+	if (m_binaryQ) {
+		vector<HTp> kernspines = infile.getKernSpineStartList();
+		m_voices = (int)kernspines.size();
+		for (int i=0; i<m_voices; i++) {
+			voices[kernspines[i]->getTrack()] = i;
+		}
+		m_bits.assign((size_t)count * m_voices * 2 * m_words, 0);
+	} else {
+		output.resize(128);
+		for (int i=0; i<(int)output.size(); i++) {
+			output[i].resize(count);
+			std::fill(output[i].begin(), output[i].end(), 0);
+		}
 	}
 
 	int strandcount = infile.getStrandCount();
@@ -50781,11 +54238,120 @@ void Tool_binroll::processFile(HumdrumFile& infile) {
 			continue;
 		}
 		HTp ending = infile.getStrandEnd(i);
-		processStrand(output, starting, ending);
+		processStrand(output, starting, ending, voices[starting->getTrack()]);
 	}
 
-	printAnalysis(infile, output);
+	if (m_binaryQ) {
+		writeBinaryRoll(out, count);
+	} else {
+		printAnalysis(infile, output, out);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::writeBinaryRoll -- Write the packed roll of the current
+//    file.  All values are little-endian.  The 40-byte header is:
+//
+//       0  char[8]  "HUMBROLL"
+//       8  uint16   format version (1)
+//      10  uint16   flags (bit 0: run-length compressed)
+//      12  uint8    lowest MIDI pitch
+//      13  uint8    highest MIDI pitch
+//      14  uint16   number of voices (**kern spines)
+//      16  uint32   numerator of time step duration (in quarter notes)
+//      20  uint32   denominator of time step duration
+//      24  uint32   number of time steps
+//      28  uint32   words per voice plane: (high - low) / 64 + 1
+//      32  uint64   number of data bytes following the header
+//
+//    Each time step is a record of 64-bit words: for each voice, the
+//    sounding notes followed by the note attacks, one bit per pitch
+//    (bit 0 of the first word is the lowest pitch).  Uncompressed data
+//    is the records for each time step, so a step can be accessed
+//    directly when the file is memory-mapped.  Compressed data is a
+//    list of runs, each a uint64 repeat count followed by the record.
+//    Multiple scores are written one after another.
+//
+//    Voices are kept separate, so a record is 16 * voices * words bytes,
+//    while the text roll is about 256 bytes per step regardless of the
+//    number of voices.  The binary roll is therefore only smaller than
+//    the text roll when voices * words is less than 16: fewer than 8
+//    voices for the full MIDI range, or fewer than 16 voices when
+//    --low/--high limit the range to 64 keys or less (22k lines with
+//    16 voices: 10.2 MB text, 20.5 MB -b, 10.2 MB -b --low 36 --high 99).
+//    Use -b for access to individual voices or time steps without
+//    parsing text, and add -r for music with sustained textures, since
+//    only identical consecutive steps are compressed.
+//
+
+void Tool_binroll::writeBinaryRoll(ostream& out, int steps) {
+	size_t recordsize = (size_t)m_voices * 2 * m_words;
+
+	// Starting index of each run of identical records:
+	vector<int> runs;
+	if (m_rleQ) {
+		for (int i=0; i<steps; i++) {
+			if ((i == 0) || !std::equal(m_bits.data() + i * recordsize,
+					m_bits.data() + (i + 1) * recordsize,
+					m_bits.data() + (i - 1) * recordsize)) {
+				runs.push_back(i);
+			}
+		}
+	}
+	uint64_t databytes = m_bits.size() * 8;
+	if (m_rleQ) {
+		databytes = runs.size() * (recordsize + 1) * 8;
+	}
 
+	string header = "HUMBROLL";
+	Convert::appendLittleEndian(header, 1, 2);
+	Convert::appendLittleEndian(header, m_rleQ ? 1 : 0, 2);
+	Convert::appendLittleEndian(header, m_low, 1);
+	Convert::appendLittleEndian(header, m_high, 1);
+	Convert::appendLittleEndian(header, m_voices, 2);
+	Convert::appendLittleEndian(header, m_duration.getNumerator(), 4);
+	Convert::appendLittleEndian(header, m_duration.getDenominator(), 4);
+	Convert::appendLittleEndian(header, steps, 4);
+	Convert::appendLittleEndian(header, m_words, 4);
+	Convert::appendLittleEndian(header, databytes, 8);
+	out.write(header.data(), header.size());
+
+	if (!m_rleQ) {
+		writeWords(out, m_bits.data(), m_bits.size());
+		return;
+	}
+	for (int i=0; i<(int)runs.size(); i++) {
+		int next = (i + 1 < (int)runs.size()) ? runs[i+1] : steps;
+		uint64_t count = next - runs[i];
+		writeWords(out, &count, 1);
+		writeWords(out, m_bits.data() + runs[i] * recordsize, recordsize);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::writeWords -- Write 64-bit words in little-endian order.
+//
+
+void Tool_binroll::writeWords(ostream& out, const uint64_t* words,
+		size_t count) {
+	uint16_t test = 1;
+	if (*(char*)&test == 1) {
+		// little-endian computer: write the words directly.
+		out.write((const char*)words, count * 8);
+		return;
+	}
+	string buffer;
+	buffer.reserve(count * 8);
+	for (size_t i=0; i<count; i++) {
+		Convert::appendLittleEndian(buffer, words[i], 8);
+	}
+	out.write(buffer.data(), buffer.size());
 }
 
 
@@ -50796,7 +54362,7 @@ void Tool_binroll::processFile(HumdrumFile& infile) {
 //
 
 void Tool_binroll::printAnalysis(HumdrumFile& infile,
-		vector<vector<char>>& roll) {
+		vector<vector<char>>& roll, ostream& out) {
 	HumRegex hre;
 
 	for (int i=0; i<infile.getLineCount(); i++) {
@@ -50810,23 +54376,23 @@ void Tool_binroll::printAnalysis(HumdrumFile& infile,
 		int found = 0;
 		for (int j=0; j<(int)line.size(); j++) {
 			if ((line[j] == '!') && !found) {
-				m_free_text << "#";
+				out << "#";
 			} else {
 				found = 1;
-				m_free_text << line[j];
+				out << line[j];
 			}
 		}
-		m_free_text << "\n";
+		out << "\n";
 	}
 
 	for (int i=0; i<(int)roll[0].size(); i++) {
 		for (int j=0; j<(int)roll.size(); j++) {
-			m_free_text << (int)roll[j][i];
+			out << (int)roll[j][i];
 			if (j < (int)roll.size() - 1) {
-				m_free_text << ' ';
+				out << ' ';
 			}
 		}
-		m_free_text << "\n";
+		out << "\n";
 	}
 
 	int startindex = infile.getLineCount() - 1;
@@ -50846,13 +54412,13 @@ void Tool_binroll::printAnalysis(HumdrumFile& infile,
 		int found = 0;
 		for (int j=0; j<(int)line.size(); j++) {
 			if ((line[j] == '!') && !found) {
-				m_free_text << "#";
+				out << "#";
 			} else {
 				found = 1;
-				m_free_text << line[j];
+				out << line[j];
 			}
 		}
-		m_free_text << "\n";
+		out << "\n";
 	}
 }
 
@@ -50864,7 +54430,7 @@ void Tool_binroll::printAnalysis(HumdrumFile& infile,
 //
 
 void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
-		HTp ending) {
+		HTp ending, int voice) {
 	HTp current = starting;
 	int base12;
 	HumNum starttime;
@@ -50893,10 +54459,7 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 				}
 				duration = Convert::recipToDuration(tok);
 				endindex = ((starttime+duration) / m_duration).getInteger();
-				roll[base12][startindex] = 2;
-				for (int i=startindex+1; i<endindex; i++) {
-					roll[base12][i] = 1;
-				}
+				storeNote(roll, voice, base12, startindex, endindex);
 			}
 		} else {
 			base12 = Convert::kernToMidiNoteNumber(current);
@@ -50908,10 +54471,7 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 			duration = current->getDuration();
 			startindex = (starttime / m_duration).getInteger();
 			endindex   = ((starttime+duration) / m_duration).getInteger();
-			roll[base12][startindex] = 2;
-			for (int i=startindex+1; i<endindex; i++) {
-				roll[base12][i] = 1;
-			}
+			storeNote(roll, voice, base12, startindex, endindex);
 		}
 		current = current->getNextToken();
 	}
@@ -50919,6 +54479,38 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 
 
 
+//////////////////////////////
+//
+// Tool_binroll::storeNote -- Mark a note in the text roll (2 for the
+//    attack, 1 for the sustain), or in the packed binary roll.
+//
+
+void Tool_binroll::storeNote(vector<vector<char>>& roll, int voice,
+		int base12, int startindex, int endindex) {
+	if (!m_binaryQ) {
+		roll[base12][startindex] = 2;
+		for (int i=startindex+1; i<endindex; i++) {
+			roll[base12][i] = 1;
+		}
+		return;
+	}
+
+	if ((voice < 0) || (base12 < m_low) || (base12 > m_high)) {
+		return;
+	}
+	int bit = base12 - m_low;
+	uint64_t mask = (uint64_t)1 << (bit % 64);
+	size_t recordsize = (size_t)m_voices * 2 * m_words;
+	uint64_t* cell = m_bits.data() + (size_t)voice * 2 * m_words + bit / 64;
+	cell[startindex * recordsize] |= mask;
+	cell[startindex * recordsize + m_words] |= mask;
+	for (int i=startindex+1; i<endindex; i++) {
+		cell[i * recordsize] |= mask;
+	}
+}
+
+
+
 
 
 
@@ -50942,6 +54534,7 @@ Tool_chantize::Tool_chantize(void) {
 
 	define("N|do-not-remove-empty-transpositions=b", "Do not remove empty transposition instructions");
 	define ("n|only-remove-empty-transpositions=b", "Only remove empty transpositions");
+	defineThreadOption();
 }
 
 
@@ -51885,6 +55478,7 @@ Tool_chord::Tool_chord(void) {
 	define("s|spine=i:-1",        "spine to process (indexed from 1)");
 	define("m|minimize=b",        "minimize chords");
 	define("M|maximize=b",        "maximize chords");
+	defineThreadOption();
 }
 
 
@@ -52275,11 +55869,15 @@ Tool_cint::Tool_cint(void) {
 	define("search=s:", "search string");
 	define("mark=b", "mark matches notes from searches in data");
 	define("count=b", "count matched modules from search query");
+	define("module-counts|mc=b", "count all modules for each pair of voices");
+	define("json=b", "print module counts as JSON (one line per file)");
 	define("debug=b");              // determine bad input line num
 	define("author=b");             // author of program
 	define("version=b");            // compilation info
 	define("example=b");            // example usages
 	define("help=b");               // short description
+	define("threads=i:1", "number of threads for --module-counts in each file");
+	defineThreadOption();
 }
 
 
@@ -52328,15 +55926,7 @@ bool Tool_cint::run(HumdrumFile& infile, ostream& out) {
 
 bool Tool_cint::run(HumdrumFile& infile) {
 	processFile(infile);
-
-
-	if (hasAnyText()) {
-		// getAllText(cout);
-	} else {
-		// Re-load the text for each line from their tokens.
-		cout << infile;
-	}
-
+	// If there is no text output, the caller prints infile.
 	return true;
 }
 
@@ -52452,6 +56042,10 @@ int Tool_cint::processFile(HumdrumFile& infile) {
 		notes[i].resize(0);
 	}
 
+	if (moduleCountQ) {
+		return printModuleCounts(infile, ktracks, reverselookup);
+	}
+
 	getNames(names, reverselookup, infile);
 	HumRegex pre;
 	extractNoteArray(notes, infile, ktracks, reverselookup);
@@ -52504,6 +56098,441 @@ int Tool_cint::processFile(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_cint::printModuleCounts -- Count every module (or module chain of
+//     length -n) for each pair of voices in the score, and print one line
+//     for each distinct module and voice pair:
+//        filename <tab> part1 <tab> part2 <tab> count <tab> module
+//     where parts are indexed from 0 for the lowest voice.  With --json,
+//     print a single JSON object for the file instead.  The modules are
+//     identified with numeric interval codes, and voice pairs are
+//     processed in parallel with the --threads option (separate from
+//     the -j option, which processes input files in parallel).  Returns
+//     the total number of modules.
+//
+
+int Tool_cint::printModuleCounts(HumdrumFile& infile, vector<int>& ktracks,
+		vector<int>& reverselookup) {
+	if (attackQ || octaveQ) {
+		m_error_text << "Error: --module-counts cannot be used with --attacks or -o" << endl;
+		return 0;
+	}
+
+	int voices = (int)ktracks.size();
+	vector<int> pitches;
+	int rows = extractNoteMatrix(pitches, infile, reverselookup, voices);
+
+	vector<pair<int, int>> pairs;
+	for (int i=0; i<voices; i++) {
+		for (int j=i+1; j<voices; j++) {
+			pairs.emplace_back(i, j);
+		}
+	}
+	vector<vector<pair<string, int>>> counts(pairs.size());
+
+	int threads = getThreadCount("threads");
+	if (threads > (int)pairs.size()) {
+		threads = (int)pairs.size();
+	}
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		int index;
+		while ((index = next++) < (int)pairs.size()) {
+			countPairModules(counts[index],
+					pitches.data() + pairs[index].first * rows,
+					pitches.data() + pairs[index].second * rows, rows, Chaincount);
+		}
+	};
+	if (threads <= 1) {
+		worker();
+	} else {
+		vector<std::thread> pool;
+		for (int i=0; i<threads; i++) {
+			pool.emplace_back(worker);
+		}
+		for (int i=0; i<(int)pool.size(); i++) {
+			pool[i].join();
+		}
+	}
+
+	suppressHumdrumFileOutput();
+	string filename = infile.getFilename();
+	int total = 0;
+	if (jsonQ) {
+		string escaped;
+		for (int i=0; i<(int)filename.size(); i++) {
+			if ((filename[i] == '"') || (filename[i] == '\\')) {
+				escaped += '\\';
+			}
+			escaped += filename[i];
+		}
+		m_json_text << "{\"file\":\"" << escaped << "\",\"n\":" << Chaincount
+		            << ",\"voices\":" << voices << ",\"pairs\":[";
+		for (int i=0; i<(int)pairs.size(); i++) {
+			if (i > 0) {
+				m_json_text << ",";
+			}
+			m_json_text << "{\"parts\":[" << pairs[i].first << ","
+			            << pairs[i].second << "],\"modules\":[";
+			for (int j=0; j<(int)counts[i].size(); j++) {
+				if (j > 0) {
+					m_json_text << ",";
+				}
+				m_json_text << "[\"" << counts[i][j].first << "\","
+				            << counts[i][j].second << "]";
+				total += counts[i][j].second;
+			}
+			m_json_text << "]}";
+		}
+		m_json_text << "]}\n";
+	} else {
+		for (int i=0; i<(int)pairs.size(); i++) {
+			for (int j=0; j<(int)counts[i].size(); j++) {
+				m_free_text << filename
+				            << "\t" << pairs[i].first
+				            << "\t" << pairs[i].second
+				            << "\t" << counts[i][j].second
+				            << "\t" << counts[i][j].first << "\n";
+				total += counts[i][j].second;
+			}
+		}
+	}
+	return total;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::extractNoteMatrix -- Numeric version of extractNoteArray()
+//     for counting modules.  The base-40 pitch of each voice for each
+//     sonority is stored in pitches, one voice after another (index
+//     voice * rows + row).  Rests are 0 and sustained notes are negative.
+//     The same sonorities as in extractNoteArray() are stored.  Returns
+//     the number of sonorities (rows).
+//
+
+int Tool_cint::extractNoteMatrix(vector<int>& pitches, HumdrumFile& infile,
+		vector<int>& reverselookup, int voices) {
+	pitches.clear();
+	if (voices == 0) {
+		return 0;
+	}
+
+	vector<int> rowdata;  // sonorities stored one after another
+	rowdata.reserve(infile.getLineCount() * voices);
+	vector<int> current(voices);
+	bool lastrests = true;  // last voice contains only rests so far
+
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isBarline() && (infile.token(i, 0)->find("||") != string::npos)) {
+			// double barline: add a row of rests (see extractNoteArray).
+			rowdata.insert(rowdata.end(), voices, REST);
+			continue;
+		}
+		if (!infile[i].isData()) {
+			continue;
+		}
+		std::fill(current.begin(), current.end(), REST);
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (!token->isKern()) {
+				continue;
+			}
+			int index = reverselookup[token->getTrack()];
+			if (index < 0) {
+				continue;
+			}
+			int sign = 1;
+			if (token->isNull()) {
+				sign = -1;
+				token = token->resolveNull();
+				if (token == NULL) {
+					continue;
+				}
+			}
+			if (token->find('r') != string::npos) {
+				continue;
+			}
+			if ((token->find('_') != string::npos) ||
+					(token->find(']') != string::npos)) {
+				sign = -1;
+			}
+			current[index] = sign * Convert::kernToBase40(*token);
+		}
+
+		bool onlyrests = true;
+		bool attack = false;
+		for (int j=0; j<voices; j++) {
+			if (current[j] != REST) {
+				onlyrests = false;
+			}
+			if (current[j] > 0) {
+				attack = true;
+			}
+		}
+		if (onlyrests && lastrests) {
+			// don't store more than one row of rests.
+			continue;
+		}
+		if (!onlyrests && !attack) {
+			// don't store sonorities which are purely sustained.
+			continue;
+		}
+		rowdata.insert(rowdata.end(), current.begin(), current.end());
+		lastrests = lastrests && (current.back() == REST);
+	}
+
+	int rows = (int)rowdata.size() / voices;
+	pitches.resize(rowdata.size());
+	for (int i=0; i<rows; i++) {
+		for (int j=0; j<voices; j++) {
+			pitches[j * rows + i] = rowdata[i * voices + j];
+		}
+	}
+	return rows;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::countPairModules -- Count the modules between two voices.
+//     Sonorities where both voices are sustained (or resting) are skipped,
+//     so modules are built from the remaining "events".  Each event has a
+//     harmonic interval code, and melodic interval codes from the previous
+//     event.  A rolling hash of the codes for the n events after the start
+//     of a module (combined with its starting harmonic interval) is used
+//     to find repeated modules; the codes are compared to resolve
+//     collisions.  The output list is sorted by decreasing count.
+//
+
+void Tool_cint::countPairModules(vector<pair<string, int>>& counts,
+		const int* pitch1, const int* pitch2, int rows, int n) {
+	counts.clear();
+
+	vector<int> events;
+	for (int i=0; i<rows; i++) {
+		if ((pitch1[i] > 0) || (pitch2[i] > 0)) {
+			events.push_back(i);
+		}
+	}
+	int ecount = (int)events.size();
+	if (ecount <= n) {
+		return;
+	}
+
+	bool melodicQ = !nomelodicQ;
+	vector<int64_t> harmonic(ecount, 0);
+	vector<int64_t> bottom(ecount, 0);
+	vector<int64_t> top(ecount, 0);
+	vector<uint64_t> token(ecount, 0);
+	// prefix sums for rests and melodic unisons (-R and -U options):
+	vector<int> rests(ecount + 1, 0);
+	vector<int> unisons(ecount + 1, 0);
+
+	for (int k=0; k<ecount; k++) {
+		int a = pitch1[events[k]];
+		int b = pitch2[events[k]];
+		if (!noharmonicQ) {
+			harmonic[k] = getIntervalCode(a, b, INTERVAL_HARMONIC);
+		}
+		rests[k+1] = rests[k] + (((a == REST) || (b == REST)) ? 1 : 0);
+		bool unison = false;
+		if (k > 0) {
+			int preva = pitch1[events[k-1]];
+			int prevb = pitch2[events[k-1]];
+			if (melodicQ && !toponlyQ) {
+				bottom[k] = getIntervalCode(preva, a, INTERVAL_MELODIC);
+			}
+			if (melodicQ && (topQ || toponlyQ)) {
+				top[k] = getIntervalCode(prevb, b, INTERVAL_MELODIC);
+			}
+			unison = ((a != REST) && (abs(a) == abs(preva))) ||
+			         ((b != REST) && (abs(b) == abs(prevb)));
+		}
+		unisons[k+1] = unisons[k] + (unison ? 1 : 0);
+		uint64_t value = (uint64_t)bottom[k] * 0x9E3779B97F4A7C15ULL;
+		value ^= (uint64_t)top[k] * 0xC2B2AE3D27D4EB4FULL;
+		value ^= (uint64_t)harmonic[k] * 0x165667B19E3779F9ULL;
+		value ^= value >> 29;
+		token[k] = value;
+	}
+
+	// Rolling hash of the tokens for events start+1 to start+n:
+	const uint64_t base = 0x100000001B3ULL;
+	uint64_t highpower = 1;
+	for (int i=1; i<n; i++) {
+		highpower *= base;
+	}
+	uint64_t window = 0;
+	for (int i=1; i<=n; i++) {
+		window = window * base + token[i];
+	}
+
+	class ModuleEntry {
+		public:
+			int start; // starting event of first instance of module
+			int count; // number of instances
+			int next;  // next entry with the same hash, or -1
+	};
+	vector<ModuleEntry> entries;
+	unordered_map<uint64_t, int> table;
+
+	for (int k=0; k+n<ecount; k++) {
+		if (k > 0) {
+			if (n > 0) {
+				window = (window - token[k] * highpower) * base + token[k+n];
+			}
+		}
+		if ((n == 0) && (events[k] == 0)) {
+			// printCombinationModule() does not report this one.
+			continue;
+		}
+		if (norestsQ && (rests[k+n+1] - rests[k] > 0)) {
+			continue;
+		}
+		if (nounisonsQ && (unisons[k+n+1] - unisons[k+1] > 0)) {
+			continue;
+		}
+		uint64_t key = window ^ ((uint64_t)harmonic[k] * 0xD6E8FEB86659FD93ULL);
+		auto found = table.find(key);
+		if (found == table.end()) {
+			table[key] = (int)entries.size();
+			entries.push_back(ModuleEntry{k, 1, -1});
+			continue;
+		}
+		int index = found->second;
+		while (true) {
+			int start = entries[index].start;
+			bool same = (harmonic[start] == harmonic[k]);
+			for (int i=1; same && (i<=n); i++) {
+				same = (harmonic[start+i] == harmonic[k+i]) &&
+				       (bottom[start+i] == bottom[k+i]) &&
+				       (top[start+i] == top[k+i]);
+			}
+			if (same) {
+				entries[index].count++;
+				break;
+			}
+			if (entries[index].next < 0) {
+				entries[index].next = (int)entries.size();
+				entries.push_back(ModuleEntry{k, 1, -1});
+				break;
+			}
+			index = entries[index].next;
+		}
+	}
+
+	// Different codes may print the same (such as the sustain state of
+	// notes if -s is not given), so merge the counts by module text:
+	unordered_map<string, int> merged;
+	merged.reserve(entries.size());
+	stringstream label;
+	for (int i=0; i<(int)entries.size(); i++) {
+		label.str("");
+		printModuleLabel(label, pitch1, pitch2, events, entries[i].start, n);
+		merged[label.str()] += entries[i].count;
+	}
+	counts.assign(merged.begin(), merged.end());
+	std::sort(counts.begin(), counts.end(),
+		[](const pair<string, int>& a, const pair<string, int>& b) {
+			if (a.second != b.second) {
+				return a.second > b.second;
+			}
+			return a.first < b.first;
+		});
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::getIntervalCode -- Return a number which identifies the
+//     interval as printed by printInterval().
+//
+
+int64_t Tool_cint::getIntervalCode(int b40a, int b40b, int type) {
+	if ((b40a == REST) || (b40b == REST)) {
+		return (int64_t)RESTINT * 4;
+	}
+	int64_t output = (int64_t)getIntervalValue(b40a, b40b, type) * 4;
+	if (sustainQ || ((type == INTERVAL_HARMONIC) && xoptionQ)) {
+		output += (b40a < 0 ? 2 : 0) + (b40b < 0 ? 1 : 0);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::printModuleLabel -- Print a module in the same format as
+//     printCombinationModule() (without --dur or --id information).
+//
+
+void Tool_cint::printModuleLabel(ostream& out, const int* pitch1,
+		const int* pitch2, const vector<int>& events, int start, int n) {
+	NoteNode note1;
+	NoteNode note2;
+	NoteNode last1;
+	NoteNode last2;
+	if (parenQ) {
+		out << "(";
+	}
+	for (int count=0; count<=n; count++) {
+		note1.b40 = pitch1[events[start+count]];
+		note2.b40 = pitch2[events[start+count]];
+		if ((count > 0) && !nomelodicQ) {
+			if (mparenQ) {
+				out << "{";
+			}
+			if (!toponlyQ) {
+				printInterval(out, last1, note1, INTERVAL_MELODIC);
+				if (mmarkerQ) {
+					out << "m";
+				}
+			}
+			if (topQ || toponlyQ) {
+				if (!toponlyQ) {
+					printSpacer(out);
+				}
+				printInterval(out, last2, note2, INTERVAL_MELODIC);
+				if (mmarkerQ) {
+					out << "m";
+				}
+			}
+			if (mparenQ) {
+				out << "}";
+			}
+			printSpacer(out);
+		}
+		if (!noharmonicQ) {
+			if (hparenQ) {
+				out << "[";
+			}
+			printInterval(out, note1, note2, INTERVAL_HARMONIC);
+			if (hmarkerQ) {
+				out << "h";
+			}
+			if (hparenQ) {
+				out << "]";
+			}
+		}
+		if ((count < n) && !noharmonicQ) {
+			printSpacer(out);
+		}
+		last1.b40 = note1.b40;
+		last2.b40 = note2.b40;
+	}
+	if (parenQ) {
+		out << ")";
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_cint::adjustKTracks -- Select only two spines to do analysis on.
@@ -54068,12 +58097,59 @@ int Tool_cint::printInterval(ostream& out, NoteNode& note1, NoteNode& note2,
 		return 0;
 	}
 	int cross = 0;
-	int pitch1 = abs(note1.b40);
-	int pitch2 = abs(note2.b40);
+	if ((type == INTERVAL_HARMONIC) && (abs(note2.b40) < abs(note1.b40))) {
+		cross = 1;
+	}
+	int interval = getIntervalValue(note1.b40, note2.b40, type, octaveadjust);
+
+	if (chromaticQ) {
+		out << Convert::base40ToIntervalAbbr(interval);
+	} else {
+		int negative = 1;
+		if (interval < 0) {
+			negative = -1;
+			interval = -interval;
+		}
+		if (base7Q && !zeroQ) {
+			out << negative * (interval+1);
+		} else {
+			out << negative * interval;
+		}
+	}
+
+	if (sustainQ || ((type == INTERVAL_HARMONIC) && xoptionQ)) {
+		// print sustain/attack information of intervals.
+		if (note1.b40 < 0) {
+			out << "s";
+		} else {
+			out << "x";
+		}
+		if (note2.b40 < 0) {
+			out << "s";
+		} else {
+			out << "x";
+		}
+	}
+
+	return cross;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::getIntervalValue -- Return the interval between two
+//     (non-rest) notes in the units selected by the options, before
+//     formatting by printInterval().  Sustained notes are negative.
+//
+
+int Tool_cint::getIntervalValue(int b40a, int b40b, int type,
+		int octaveadjust) {
+	int pitch1 = abs(b40a);
+	int pitch2 = abs(b40b);
 	int interval = pitch2 - pitch1;
 
 	if ((type == INTERVAL_HARMONIC) && (interval < 0)) {
-		cross = 1;
 		if (uncrossQ) {
 			interval = -interval;
 		}
@@ -54131,37 +58207,7 @@ int Tool_cint::printInterval(ostream& out, NoteNode& note1, NoteNode& note2,
 		interval = interval + octaveadjust  * 7;
 	}
 
-
-	if (chromaticQ) {
-		out << Convert::base40ToIntervalAbbr(interval);
-	} else {
-		int negative = 1;
-		if (interval < 0) {
-			negative = -1;
-			interval = -interval;
-		}
-		if (base7Q && !zeroQ) {
-			out << negative * (interval+1);
-		} else {
-			out << negative * interval;
-		}
-	}
-
-	if (sustainQ || ((type == INTERVAL_HARMONIC) && xoptionQ)) {
-		// print sustain/attack information of intervals.
-		if (note1.b40 < 0) {
-			out << "s";
-		} else {
-			out << "x";
-		}
-		if (note2.b40 < 0) {
-			out << "s";
-		} else {
-			out << "x";
-		}
-	}
-
-	return cross;
+	return interval;
 }
 
 
@@ -54869,6 +58915,8 @@ void Tool_cint::initialize(void) {
 	markQ        = getBoolean("mark");
 	idQ          = getBoolean("id");
 	countQ       = getBoolean("count");
+	moduleCountQ = getBoolean("module-counts");
+	jsonQ        = getBoolean("json");
 	filenameQ    = getBoolean("filename");
 	suspensionsQ = getBoolean("suspensions");
 	uncrossQ     = getBoolean("uncross");
@@ -54941,6 +58989,7 @@ Tool_colorgroups::Tool_colorgroups(void) {
 	define("B=s:dodgerblue", "Color for group B");
 	define("C=s:limegreen",  "Color for group C");
 	define("command=b",     "print shed command only");
+	defineThreadOption();
 }
 
 
@@ -55063,6 +59112,7 @@ Tool_colortriads::Tool_colortriads(void) {
 	define("k|key=s",            "key to transpose coloring to");
 	define("commands=b",         "print msearch commands only");
 	define("filters=b",          "print filter commands only");
+	defineThreadOption();
 }
 
 
@@ -55302,6 +59352,7 @@ Tool_composite::Tool_composite(void) {
 	define("p|prepend=b",  "prepend data to end of line");
 	define("b|beam=b",     "apply automatic beaming");
 	define("G|no-grace=b", "do not include grace notes");
+	defineThreadOption();
 }
 
 
@@ -55933,6 +59984,20 @@ Tool_dissonant::Tool_dissonant(void) {
 	define("i|x|e|exinterp=s:**cdata","specify exinterp for **cdata spine");
 	define("color|colorize|color-by-rhythm=b", "color dissonant notes by beat level");
 	define("color2|colorize2|color-by-interval=b", "color dissonant notes by dissonant interval");
+	define("batch=b",                 "count dissonances over all input files");
+	defineThreadOption();
+}
+
+
+
+/////////////////////////////////
+//
+// Tool_dissonant::isBatchMode -- True if a single table of dissonance
+//     counts should be printed for all input files.
+//
+
+bool Tool_dissonant::isBatchMode(void) {
+	return getBoolean("batch");
 }
 
 
@@ -55987,6 +60052,65 @@ bool Tool_dissonant::run(HumdrumFile& infile, ostream& out) {
 }
 
 
+//
+// Batch version: count the dissonances in all files of the input stream
+// and print a single table of the totals (as for -c).  Input files are
+// parsed and analyzed by a pool of -j threads (see runStreamPool()), each
+// with its own copy of the tool, and the counts are merged by voice index.
+//
+
+bool Tool_dissonant::run(HumdrumFileStream& instream) {
+	if (getBoolean("undirected")) {
+		fillLabels2();
+	} else {
+		fillLabels();
+	}
+	m_counts.clear();
+	int filecount = 0;
+
+	auto process = [](Tool_dissonant& tool, HumdrumFileSet& infiles,
+			StreamSegmentResult& result) {
+		tool.m_accumulateQ = true;
+		tool.run(infiles[0]);
+		if (tool.hasError()) {
+			result.status = false;
+			result.errortext = tool.getError();
+		}
+		tool.clearOutput();
+		tool.m_filecount++;
+	};
+
+	auto finish = [&](Tool_dissonant& tool) {
+		filecount += tool.m_filecount;
+		if (m_counts.size() < tool.m_counts.size()) {
+			m_counts.resize(tool.m_counts.size());
+		}
+		for (int i=0; i<(int)tool.m_counts.size(); i++) {
+			for (auto& it : tool.m_counts[i]) {
+				m_counts[i][it.first] += it.second;
+			}
+		}
+	};
+
+	int status = runStreamPool<Tool_dissonant>(instream, argv(),
+			getThreadCount(), m_humdrum_text, process, finish);
+
+	printCountTable(m_counts);
+	m_humdrum_text << "!!total_files:\t" << filecount << endl;
+	return status == 0;
+}
+
+
+bool Tool_dissonant::run(HumdrumFileStream& instream, ostream& out) {
+	bool status = run(instream);
+	if (hasAnyText()) {
+		getAllText(out);
+	}
+	clearOutput();
+	return status;
+}
+
+
 bool Tool_dissonant::run(HumdrumFile& infile) {
 
 	if (getBoolean("voice-number")) {
@@ -56034,6 +60158,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 
 	suppressQ = getBoolean("suppress");
 	voiceFuncsQ = getBoolean("voice-functions");
+	bool countQ = getBoolean("count") || getBoolean("batch") || m_accumulateQ;
 
 	vector<vector<string>> results;
 	vector<vector<string>> results2;
@@ -56068,7 +60193,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 	}
 
 	if (suppressQ) {
-		if (getBoolean("count")) {
+		if (countQ) {
 			printCountAnalysis(results2);
 			return false;
 		} else {
@@ -56087,7 +60212,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 			return true;
 		}
 	} else if (voiceFuncsQ) { // run cadnetial-voice-function analysis if requested
-		if (getBoolean("count")) {
+		if (countQ) {
 			printCountAnalysis(voiceFuncs);
 			return false;
 		}
@@ -56115,7 +60240,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 		infile.createLinesFromTokens();
 		return true;
 	} else {
-		if (getBoolean("count")) {
+		if (countQ) {
 			printCountAnalysis(results);
 			return false;
 		} else {
@@ -57063,6 +61188,10 @@ void Tool_dissonant::printColorLegend(HumdrumFile& infile) {
 void Tool_dissonant::doAnalysis(vector<vector<string>>& results,
 		NoteGrid& grid, vector<vector<NoteCell*>>& attacks, bool debug) {
 	attacks.resize(grid.getVoiceCount());
+	m_intervals.resize(grid.getVoiceCount());
+	m_durations.resize(grid.getVoiceCount());
+	m_levels.resize(grid.getVoiceCount());
+	storeLowestNotes(grid);
 
 	for (int i=0; i<grid.getVoiceCount(); i++) {
 		attacks[i].clear();
@@ -57088,6 +61217,54 @@ void Tool_dissonant::doAnalysis(vector<vector<string>>& results,
 
 
 
+//////////////////////////////
+//
+// Tool_dissonant::storeLowestNotes -- Store the lowest sounding diatonic
+//     pitch in each slice of the grid (1000 if all voices are resting).
+//
+
+void Tool_dissonant::storeLowestNotes(NoteGrid& grid) {
+	int vcount = grid.getVoiceCount();
+	int scount = grid.getSliceCount();
+	m_lowestnote.assign(scount, 1000);
+	double tpitch;
+	for (int i=0; i<scount; i++) {
+		for (int v=0; v<vcount; v++) {
+			tpitch = grid.cell(v, i)->getAbsDiatonicPitch();
+			if ((!Convert::isNaN(tpitch)) && (tpitch <= m_lowestnote[i])) {
+				m_lowestnote[i] = (int)tpitch;
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_dissonant::storeVoiceFeatures -- Store the melodic interval from the
+//     previous attack, the duration and the metric level of each attack
+//     in a voice, so that they are calculated only once for all of the
+//     dissonance checks.
+//
+
+void Tool_dissonant::storeVoiceFeatures(vector<NoteCell*>& attacks, int vindex) {
+	int size = (int)attacks.size();
+	vector<double>& intervals = m_intervals[vindex];
+	vector<HumNum>& durations = m_durations[vindex];
+	vector<double>& levels    = m_levels[vindex];
+	intervals.resize(size);
+	durations.resize(size);
+	levels.resize(size);
+	for (int i=0; i<size; i++) {
+		intervals[i] = (i > 0) ? *attacks[i] - *attacks[i-1] : NAN;
+		durations[i] = attacks[i]->getDuration();
+		levels[i]    = attacks[i]->getMetricLevel();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_dissonant::doAnalysisForVoice -- do analysis for a single voice by
@@ -57098,6 +61275,10 @@ void Tool_dissonant::doAnalysisForVoice(vector<vector<string>>& results,
 		NoteGrid& grid, vector<NoteCell*>& attacks, int vindex, bool debug) {
 	attacks.clear();
 	grid.getNoteAndRestAttacks(attacks, vindex);
+	storeVoiceFeatures(attacks, vindex);
+	vector<double>& intervals = m_intervals[vindex];
+	vector<HumNum>& durations = m_durations[vindex];
+	vector<double>& levels    = m_levels[vindex];
 
 	if (debug) {
 		cerr << "=======================================================";
@@ -57150,17 +61331,8 @@ void Tool_dissonant::doAnalysisForVoice(vector<vector<string>>& results,
 		marking = '\0';
 
 		// calculate harmonic intervals:
-		int lowestnote = 1000;
-		double tpitch;
-		// int lowestnotei = -1;
+		int lowestnote = m_lowestnote[sliceindex];
 		for (int j=0; j<(int)harmint.size(); j++) {
-			tpitch = grid.cell(j, sliceindex)->getAbsDiatonicPitch();
-			if (!Convert::isNaN(tpitch)) {
-				if (tpitch <= lowestnote) {
-					lowestnote = (int)tpitch;
-					// lowestnotei = j;
-				}
-			}
 			if (j == vindex) {
 				harmint[j] = 0;
 			}
@@ -57267,7 +61439,7 @@ RECONSIDER:
 		}
 
 		if (colorizeQ) {
-			double metriclevel = attacks[i]->getMetricLevel();
+			double metriclevel = levels[i];
 			if (metriclevel <= 0) {
 				dissL0Q = true;
 				marking = 'N';
@@ -57290,17 +61462,17 @@ RECONSIDER:
 		}
 
 		// variables for dissonant voice
-		durp = attacks[i-1]->getDuration();
-		dur  = attacks[i]->getDuration();
-		durn = attacks[i+1]->getDuration();
-		intp = *attacks[i] - *attacks[i-1];
-		intn = *attacks[i+1] - *attacks[i];
-		levp = attacks[i-1]->getMetricLevel();
-		lev  = attacks[i]->getMetricLevel();
-		levn = attacks[i+1]->getMetricLevel();
+		durp = durations[i-1];
+		dur  = durations[i];
+		durn = durations[i+1];
+		intp = intervals[i];
+		intn = intervals[i+1];
+		levp = levels[i-1];
+		lev  = levels[i];
+		levn = levels[i+1];
 		if (i >= 2) {
-			intpp = *attacks[i-1] - *attacks[i-2];
-			durpp = attacks[i-2]->getDuration();
+			intpp = intervals[i-1];
+			durpp = durations[i-2];
 			lineindexpp = attacks[i-2]->getLineIndex();
 		}
 
@@ -57555,8 +61727,8 @@ RECONSIDER:
 
 		if (i < ((int)attacks.size() - 2)) { // expand the analysis window
 
-			double intnn = *attacks[i+2] - *attacks[i+1];
-			HumNum durnn = attacks[i+2]->getDuration();       // dur of note after next
+			double intnn = intervals[i+2];
+			HumNum durnn = durations[i+2];       // dur of note after next
 			// double levnn = attacks[i+2]->getMetricLevel(); // lev of note after next
 
 			if ((dur <= durp) && (lev >= levp) && (lev >= levn) &&
@@ -57617,6 +61789,7 @@ void Tool_dissonant::findFakeSuspensions(vector<vector<string>>& results, NoteGr
 	double intp;        // abs value of diatonic interval from previous melodic note
 	int lineindexn;     // line index of the next note in the voice
 	bool sfound;        // boolean for if a suspension is found after a Z dissonance
+	vector<double>& intervals = m_intervals[vindex];
 
 	for (int i=1; i<(int)attacks.size()-1; i++) {
 		int lineindex = attacks[i]->getLineIndex();
@@ -57626,7 +61799,7 @@ void Tool_dissonant::findFakeSuspensions(vector<vector<string>>& results, NoteGr
 			(results[vindex][lineindex].find("m") == string::npos)) {
 			continue;
 		}
-		intp = fabs(*attacks[i] - *attacks[i-1]);
+		intp = fabs(intervals[i]);
 		lineindexn = attacks[i+1]->getLineIndex();
 		sfound = false;
 		for (int j=lineindex + 1; j<=lineindexn; j++) {
@@ -57647,7 +61820,7 @@ void Tool_dissonant::findFakeSuspensions(vector<vector<string>>& results, NoteGr
 		} else if (intp > 1) {
 			results[vindex][lineindex] = m_labels[FAKE_SUSPENSION_LEAP];
 		} else if (i > 1) { // as long as i > 1 intpp will be in range.
-			double intpp = fabs(*attacks[i-1] - *attacks[i-2]);
+			double intpp = fabs(intervals[i-1]);
 			if (intp == 0) { // fake suspensions preceded by an anticipation.
 				if (intpp == 1) {
 					results[vindex][lineindex] = m_labels[FAKE_SUSPENSION_STEP];
@@ -57680,6 +61853,8 @@ void Tool_dissonant::findLs(vector<vector<string>>& results, NoteGrid& grid,
 	double opitchp;    // previous pitch in other voice
 	double opitch;     // current pitch in other voice
 	double opitchn;    // next pitch in other voice
+	vector<double>& intervals = m_intervals[vindex];
+	vector<HumNum>& durations = m_durations[vindex];
 
 	for (int i=1; i<(int)attacks.size()-1; i++) {
 		lineindex = attacks[i]->getLineIndex();
@@ -57687,9 +61862,9 @@ void Tool_dissonant::findLs(vector<vector<string>>& results, NoteGrid& grid,
 			(results[vindex][lineindex].find("z") == string::npos)) {
 			continue;
 		}
-		dur  = attacks[i]->getDuration();
-		intp = *attacks[i] - *attacks[i-1];
-		intn = *attacks[i+1] - *attacks[i];
+		dur  = durations[i];
+		intp = intervals[i];
+		intn = intervals[i+1];
 		sliceindex = attacks[i]->getSliceIndex();
 
 		for (int j=0; j<(int)grid.getVoiceCount(); j++) { // j is the voice index of the other voice
@@ -57750,6 +61925,7 @@ void Tool_dissonant::findYs(vector<vector<string>>& results, NoteGrid& grid,
 	double opitch;     // current pitch in other voice
 	bool onlyWithValids; // note is only dissonant with identifiable dissonances
 	bool valid_acc_exit; // if accompaniment voice conforms to necessary standards
+	vector<double>& intervals = m_intervals[vindex];
 
 	for (int i=1; i<(int)attacks.size()-1; i++) {
 		lineindex = attacks[i]->getLineIndex();
@@ -57757,20 +61933,12 @@ void Tool_dissonant::findYs(vector<vector<string>>& results, NoteGrid& grid,
 			(results[vindex][lineindex].find("z") == string::npos)) {
 			continue;
 		}
-		intp = *attacks[i] - *attacks[i-1];
-		intn = *attacks[i+1] - *attacks[i];
+		intp = intervals[i];
+		intn = intervals[i+1];
 		sliceindex = attacks[i]->getSliceIndex();
 
-		int lowestnote = 1000; // lowest sounding diatonic note in any voice at this sliceindex
-		double tpitch;
-		for (int v=0; v<(int)grid.getVoiceCount(); v++) {
-			tpitch = grid.cell(v, sliceindex)->getAbsDiatonicPitch();
-			if (!Convert::isNaN(tpitch)) {
-				if (tpitch <= lowestnote) {
-					lowestnote = (int)tpitch;
-				}
-			}
-		}
+		// lowest sounding diatonic note in any voice at this sliceindex
+		int lowestnote = m_lowestnote[sliceindex];
 
 		onlyWithValids = true;
 		for (int j=0; j<(int)grid.getVoiceCount(); j++) { // j = index of other voice
@@ -57849,6 +62017,9 @@ void Tool_dissonant::findAppoggiaturas(vector<vector<string>>& results, NoteGrid
 	bool ant_down;     // if the current note was preceded by a descending anticipation
 	bool ant_up;       // if the current note was preceded by an ascending anticipation
 	bool ant_leapt_to; // if the current note was preceded by an anticipation leapt to
+	vector<double>& intervals = m_intervals[vindex];
+	vector<HumNum>& durations = m_durations[vindex];
+	vector<double>& levels    = m_levels[vindex];
 
 	for (int i=1; i<(int)attacks.size()-1; i++) {
 		lineindexp = attacks[i-1]->getLineIndex();
@@ -57859,13 +62030,13 @@ void Tool_dissonant::findAppoggiaturas(vector<vector<string>>& results, NoteGrid
 			(results[vindex][lineindex].find("j") == string::npos)) {
 			continue;
 		}
-		durp = attacks[i-1]->getDuration();
-		dur  = attacks[i]->getDuration();
-		durn = attacks[i+1]->getDuration();
-		intp = *attacks[i] - *attacks[i-1];
-		intn = *attacks[i+1] - *attacks[i];
-		lev  = attacks[i]->getMetricLevel();
-		levn = attacks[i+1]->getMetricLevel();
+		durp = durations[i-1];
+		dur  = durations[i];
+		durn = durations[i+1];
+		intp = intervals[i];
+		intn = intervals[i+1];
+		lev  = levels[i];
+		levn = levels[i+1];
 		sliceindex = attacks[i]->getSliceIndex();
 
 		if (!((lev <= levn) && (dur <= durn))) {
@@ -57877,26 +62048,20 @@ void Tool_dissonant::findAppoggiaturas(vector<vector<string>>& results, NoteGrid
 		ant_up       = false;
 		ant_leapt_to = false;
 		if (i > 1) {
-			durpp = attacks[i-2]->getDuration();
+			durpp = durations[i-2];
 			if ((intp == 0) && (durp <= dur) && (durp <= durpp)) {
-				if ((*attacks[i-1] - *attacks[i-2]) == -1) {
+				if (intervals[i-1] == -1) {
 					ant_down = true;
-				} else if ((*attacks[i-1] - *attacks[i-2]) == 1) {
+				} else if (intervals[i-1] == 1) {
 					ant_up = true;
-				} else if (fabs(*attacks[i-1] - *attacks[i-2]) > 1) {
+				} else if (fabs(intervals[i-1]) > 1) {
 					ant_leapt_to = true;
 				}
 			}
 		}
 
-		int lowestnote = 1000; // lowest sounding diatonic note in any voice at this sliceindex
-		double tpitch;
-		for (int v=0; v<(int)grid.getVoiceCount(); v++) {
-			tpitch = grid.cell(v, sliceindex)->getAbsDiatonicPitch();
-			if ((!Convert::isNaN(tpitch)) && (tpitch <= lowestnote)) {
-				lowestnote = (int)tpitch;
-			}
-		}
+		// lowest sounding diatonic note in any voice at this sliceindex
+		int lowestnote = m_lowestnote[sliceindex];
 
 		for (int j=0; j<(int)grid.getVoiceCount(); j++) { // j is the voice index of the other voice
 			if (vindex == j) { // only compare different voices
@@ -58222,24 +62387,50 @@ void Tool_dissonant::findCadentialVoiceFunctions(vector<vector<string>>& results
 //
 
 void Tool_dissonant::printCountAnalysis(vector<vector<string>>& data) {
+	if (m_accumulateQ) {
+		countAnalysis(m_counts, data);
+		return;
+	}
+	vector<map<string, int>> analysis;
+	countAnalysis(analysis, data);
+	printCountTable(analysis);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_dissonant::countAnalysis -- Add the number of times each label
+//     occurs in each voice to the analysis counts.
+//
+
+void Tool_dissonant::countAnalysis(vector<map<string, int>>& analysis,
+		vector<vector<string>>& data) {
+	if (analysis.size() < data.size()) {
+		analysis.resize(data.size());
+	}
+	for (int i=0; i<(int)data.size(); i++) {
+		for (int j=0; j<(int)data[i].size(); j++) {
+			analysis[i][data[i][j]]++;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_dissonant::printCountTable -- Print the number of dissonances
+//     of each type for each voice.
+//
+
+void Tool_dissonant::printCountTable(vector<map<string, int>>& analysis) {
 
 	map<string, bool> reduced;
 	bool brief = getBoolean("u");
 	bool percentQ = getBoolean("percent");
-
-	vector<map<string, int>> analysis;
-	analysis.resize(data.size());
 	int i;
 	int j;
-	for (i=0; i<(int)data.size(); i++) {
-		for (j=0; j<(int)data[i].size(); j++) {
-			if (analysis[i].find(data[i][j]) != analysis[i].end()) {
-				analysis[i][data[i][j]]++;
-			} else {
-				analysis[i][data[i][j]] = 1;
-			}
-		}
-	}
 
 	m_humdrum_text << "**rdis";
 	if (brief) {
@@ -60222,6 +64413,7 @@ Tool_extract::Tool_extract(void) {
 	define("version=b");             // compilation info
 	define("example=b");             // example usages
 	define("h|help=b");              // short description
+	defineThreadOption();
 }
 
 
@@ -62286,6 +66478,7 @@ void Tool_extract::initialize(HumdrumFile& infile) {
 #define RUNTOOL(NAME, INFILE, COMMAND, STATUS)     \
 	Tool_##NAME *tool = new Tool_##NAME;            \
 	tool->process(COMMAND);                         \
+	int linecount = INFILE.getLineCount();          \
 	tool->run(INFILE);                              \
 	if (tool->hasError()) {                         \
 		status = false;                              \
@@ -62293,7 +66486,7 @@ void Tool_extract::initialize(HumdrumFile& infile) {
 		delete tool;                                 \
 		break;                                       \
 	} else if (tool->hasHumdrumText()) {            \
-		INFILE.readString(tool->getHumdrumText());   \
+		updateFile(INFILE, tool->getHumdrumText(), linecount); \
 	}                                               \
 	delete tool;
 
@@ -62348,6 +66541,8 @@ void Tool_extract::initialize(HumdrumFile& infile) {
 
 Tool_filter::Tool_filter(void) {
 	define("debug=b", "print debug statement");
+	define("reparse=b", "re-parse the output text after each filter stage");
+	defineThreadOption();
 }
 
 
@@ -62383,7 +66578,7 @@ bool Tool_filter::runUniversal(HumdrumFileSet& infiles) {
 		} else if (commands[i].first == "chooser") {
 			RUNTOOLSET(chooser, infiles, commands[i].second, status);
 		} else if (commands[i].first == "myank") {
-			RUNTOOL(myank, infiles, commands[i].second, status);
+			RUNTOOLSET(myank, infiles, commands[i].second, status);
 		}
 	}
 
@@ -62409,6 +66604,11 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 	bool status = true;
 	vector<pair<string, string> > commands;
 	getCommandList(commands, infile);
+	// Lines edited by a stage are checked when the next Humdrum text
+	// output of a stage is used to update the file (see updateFile()), so
+	// the edits of tools which only change the file in place are checked
+	// along with those of the next stage.
+	infile.clearDirtyLines();
 	for (int i=0; i<(int)commands.size(); i++) {
 		if (commands[i].first == "autobeam") {
 			RUNTOOL(autobeam, infile, commands[i].second, status);
@@ -62531,6 +66731,71 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 
 
 
+//////////////////////////////
+//
+// Tool_filter::updateFile -- Update the input file with the Humdrum text
+//    output of a filter stage.  Most tools edit tokens in the file and
+//    then print it (possibly with added global comments or reference
+//    records at the end).  In that case the file is kept in memory and
+//    only the edited lines are checked, rather than parsing the text
+//    again for the next stage.  Otherwise, or if the edits change the
+//    structure of the file, the text is parsed.  linecount is the number
+//    of lines in the file before the stage was run.  Lines edited in
+//    place by earlier stages without Humdrum text output are still marked
+//    as dirty, so they are checked as well.
+//
+
+void Tool_filter::updateFile(HumdrumFile& infile, const string& text,
+		int linecount) {
+	if (m_reparseQ) {
+		infile.readString(text);
+		return;
+	}
+
+	infile.createLinesFromTokens();
+	size_t pos = 0;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		const string& line = infile[i];
+		if (text.compare(pos, line.size(), line) != 0) {
+			infile.readString(text);
+			return;
+		}
+		pos += line.size();
+		if ((pos >= text.size()) || (text[pos] != '\n')) {
+			infile.readString(text);
+			return;
+		}
+		pos++;
+	}
+
+	// Lines added after the end of the file:
+	vector<string> extra;
+	while (pos < text.size()) {
+		size_t end = text.find('\n', pos);
+		if (end == string::npos) {
+			end = text.size();
+		}
+		if (text.compare(pos, 2, "!!") != 0) {
+			infile.readString(text);
+			return;
+		}
+		extra.push_back(text.substr(pos, end - pos));
+		pos = end + 1;
+	}
+	for (int i=0; i<(int)extra.size(); i++) {
+		infile.appendLine(extra[i]);
+	}
+
+	if (!infile.analyzeDirtyLines(linecount)) {
+		if (m_debugQ) {
+			cerr << "Re-parsing output of filter stage" << endl;
+		}
+		infile.readString(text);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_filter::removeGlobalFilterLines --
@@ -62753,298 +67018,7 @@ void Tool_filter::getUniversalCommandList(vector<pair<string, string> >& command
 
 void Tool_filter::initialize(HumdrumFile& infile) {
 	m_debugQ = getBoolean("debug");
-}
-
-
-
-
-
-/////////////////////////////////
-//
-// Tool_fixps::Tool_fixps -- Set the recognized options for the tool.
-//
-
-Tool_fixps::Tool_fixps(void) {
-	// define ("n|only-remove-empty-transpositions=b", "Only remove empty transpositions");
-}
-
-
-
-/////////////////////////////////
-//
-// Tool_fixps::run -- Primary interfaces to the tool.
-//
-
-bool Tool_fixps::run(HumdrumFileSet& infiles) {
-	bool status = true;
-	for (int i=0; i<infiles.getCount(); i++) {
-		status &= run(infiles[i]);
-	}
-	return status;
-}
-
-
-bool Tool_fixps::run(const string& indata, ostream& out) {
-	HumdrumFile infile(indata);
-	bool status = run(infile);
-	if (hasAnyText()) {
-		getAllText(out);
-	} else {
-		out << infile;
-	}
-	return status;
-}
-
-
-bool Tool_fixps::run(HumdrumFile& infile, ostream& out) {
-	bool status = run(infile);
-	if (hasAnyText()) {
-		getAllText(out);
-	} else {
-		out << infile;
-	}
-	return status;
-}
-
-//
-// In-place processing of file:
-//
-
-bool Tool_fixps::run(HumdrumFile& infile) {
-	processFile(infile);
-	return true;
-}
-
-
-
-//////////////////////////////
-//
-// Tool_fixps::processFile --
-//
-
-void Tool_fixps::processFile(HumdrumFile& infile) {
-	removeDuplicateDynamics(infile);
-	markEmptyVoices(infile);
-	vector<vector<HTp>> newlist;
-	removeEmpties(newlist, infile);
-	outputNewSpining(newlist, infile);
-}
-
-
-
-//////////////////////////////
-//
-// Tool_fixps::outputNewSpining --
-//
-
-void Tool_fixps::outputNewSpining(vector<vector<HTp>>& newlist, HumdrumFile& infile) {
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].hasSpines()) {
-			m_humdrum_text << infile[i] << endl;
-			continue;
-		}
-		if ((i > 0) && (!newlist[i].empty()) && newlist[i][0]->isCommentLocal()) {
-			if (!newlist[i-1].empty() && newlist[i-1][0]->isCommentLocal()) {
-				if (newlist[i].size() == newlist[i-1].size()) {
-					bool same = true;
-					for (int j=0; j<(int)newlist[i].size(); j++) {
-						if (*(newlist[i][j]) != *(newlist[i-1][j])) {
-cerr << "GOT HERE " << i << " " << j << endl;
-cerr << infile[i-1] << endl;
-cerr << infile[i] << endl;
-cerr << endl;
-							same = false;
-							break;
-						}
-					}
-					if (same) {
-						continue;
-					}
-				}
-			}
-		}
-		if (!infile[i].isManipulator()) {
-			m_humdrum_text << newlist[i].at(0);
-			for (int j=1; j<(int)newlist[i].size(); j++) {
-				m_humdrum_text << "\t";
-				m_humdrum_text << newlist[i].at(j);
-			}
-			m_humdrum_text << endl;
-			continue;
-		}
-		if ((i > 0) && !infile[i-1].isManipulator()) {
-			printNewManipulator(infile, newlist, i);
-		}
-	}
-}
-
-
-//////////////////////////////
-//
-// Tool_fixps::printNewManipulator --
-//
-
-void Tool_fixps::printNewManipulator(HumdrumFile& infile, vector<vector<HTp>>& newlist, int line) {
-	HTp token = infile.token(line, 0);
-	if (*token == "*-") {
-		m_humdrum_text << infile[line] << endl;
-		return;
-	}
-	if (token->compare(0, 2, "**") == 0) {
-		m_humdrum_text << infile[line] << endl;
-		return;
-	}
-	m_humdrum_text << "++++++++++++++++++++" << endl;
-}
-
-//////////////////////////////
-//
-// Tool_fixps::removeDuplicateDynamics --
-//
-
-void Tool_fixps::removeDuplicateDynamics(HumdrumFile& infile) {
-	int scount = infile.getStrandCount();
-	for (int i=0; i<scount; i++) {
-		HTp sstart = infile.getStrandBegin(i);
-		if (!sstart->isDataType("**dynam")) {
-			continue;
-		}
-		HTp send   = infile.getStrandEnd(i);
-		HTp current = sstart;
-		while (current && (current != send)) {
-			vector<string> subtoks = current->getSubtokens();
-			if (subtoks.size() % 2 == 1) {
-				current = current->getNextToken();
-				continue;
-			}
-			bool equal = true;
-			int half = (int)subtoks.size() / 2;
-			for (int j=0; j<half; j++) {
-				if (subtoks[i] != subtoks[i+half]) {
-					equal = false;
-				}
-			}
-			if (equal) {
-				string newtext = subtoks[0];
-				for (int j=1; j<half; j++) {
-					newtext += " ";
-					newtext += subtoks[j];
-				}
-				current->setText(newtext);
-			}
-		}
-	}
-}
-
-
-
-//////////////////////////////
-//
-// Tool_fixps::removeEmpties --
-//
-
-void Tool_fixps::removeEmpties(vector<vector<HTp>>& newlist, HumdrumFile& infile) {
-	newlist.resize(infile.getLineCount());
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].hasSpines()) {
-			continue;
-		}
-		if (infile[i].isManipulator()) {
-			continue;
-		}
-		for (int j=0; j<infile[i].getFieldCount(); j++) {
-			HTp token = infile.token(i, j);
-			string value = token->getValue("delete");
-			if (value == "true") {
-				continue;
-			}
-			newlist[i].push_back(token);
-		}
-	}
-}
-
-
-
-//////////////////////////////
-//
-// Tool_fixps::markEmptyVoices --
-//
-
-void Tool_fixps::markEmptyVoices(HumdrumFile& infile) {
-	HLp barline = NULL;
-	for (int i=0; i<infile.getLineCount(); i++) {
-		if (!infile[i].hasSpines()) {
-			continue;
-		}
-		if (infile[i].isManipulator()) {
-			continue;
-		}
-		if (infile[i].isInterpretation()) {
-			if (infile.token(i, 0)->compare(0, 2, "**")) {
-				barline = &infile[i];
-			}
-			continue;
-		}
-		if (infile[i].isBarline()) {
-			barline = &infile[i];
-		}
-		if (!infile[i].isData()) {
-			continue;
-		}
-		if (!barline) {
-			continue;
-		}
-		// check on the data line if:
-		// * it is in the first subspine
-		// * it is an invisible rest
-		// * it takes the full duration of the measure
-		// If so, then mark the tokens for deletion in that layer.
-		for (int j=0; j<infile[i].getFieldCount(); j++) {
-			HTp token = infile.token(i, j);
-			// int track = token->getTrack();
-			int subtrack = token->getSubtrack();
-			if (subtrack != 1) {
-				continue;
-			}
-			if (token->find("yy") == string::npos) {
-				continue;
-			}
-			if (!token->isRest()) {
-				continue;
-			}
-			HumNum duration = token->getDuration();
-			HumNum bardur = token->getDurationToBarline();
-			HTp current = token;
-			while (current) {
-			   subtrack = current->getSubtrack();
-				if (subtrack != 1) {
-					break;
-				}
-				current->setValue("delete", "true");
-				if (current->isBarline()) {
-					break;
-				}
-				current = current->getNextToken();
-			}
-			current = token;
-			current = current->getPreviousToken();
-			while (current) {
-				if (current->isManipulator()) {
-					break;
-				}
-				if (current->isBarline()) {
-					break;
-				}
-				subtrack = current->getSubtrack();
-				if (subtrack != 1) {
-					break;
-				}
-				current->setValue("delete", "true");
-				current = current->getPreviousToken();
-			}
-		}
-	}
-
+	m_reparseQ = getBoolean("reparse");
 }
 
 
@@ -63062,6 +67036,7 @@ Tool_flipper::Tool_flipper(void) {
 	define("s|strophe=b",      "flip inside of strophes as well");
 	define("S|strophe-only|only-strophe=b", "flip only inside of strophes as well");
 	define("i|interp=s:kern",  "flip only in this interpretation");
+	defineThreadOption();
 }
 
 
@@ -63342,6 +67317,7 @@ Tool_homorhythm::Tool_homorhythm(void) {
 	define("s|score=d:1.0", "Score assigned to a sonority with three or more attacks");
 	define("m|intermediate-score=d:0.5", "Score to give sonority between two adjacent attack sonoroties");
 	define("l|letter=b", "Display letter scoress before calculations");
+	defineThreadOption();
 }
 
 
@@ -63776,6 +67752,7 @@ Tool_homorhythm2::Tool_homorhythm2(void) {
 	define("s|score=b", "Show numeric scores");
 	define("n|length=i:4", "Sonority length to calculate");
 	define("f|fraction=b", "Report fraction of music that is homorhythm");
+	defineThreadOption();
 }
 
 
@@ -63857,7 +67834,7 @@ void Tool_homorhythm2::initialize(void) {
 
 void Tool_homorhythm2::processFile(HumdrumFile& infile) {
 	infile.analyzeStructure();
-	NoteGrid grid(infile);
+	CompactNoteGrid& grid = infile.getCompactNoteGrid();
 	m_score.resize(infile.getLineCount());
 	fill(m_score.begin(), m_score.end(), 0.0);
 
@@ -63871,16 +67848,14 @@ void Tool_homorhythm2::processFile(HumdrumFile& infile) {
 		for (int j=0; j<grid.getVoiceCount(); j++) {
 			for (int k=j+1; k<grid.getVoiceCount(); k++) {
 				for (int m=0; m<wsize; m++) {
-					NoteCell* cell1 = grid.cell(j, i+m);
-					if (cell1->isRest()) {
+					if (grid.isRest(j, i+m)) {
 						continue;
 					}
-					NoteCell* cell2 = grid.cell(k, i+m);
-					if (cell2->isRest()) {
+					if (grid.isRest(k, i+m)) {
 						continue;
 					}
 					count++;
-					if (cell1->isAttack() && cell2->isAttack()) {
+					if (grid.isAttack(j, i+m) && grid.isAttack(k, i+m)) {
 						score += 1.0;
 					}
 				}
@@ -63896,16 +67871,14 @@ void Tool_homorhythm2::processFile(HumdrumFile& infile) {
 		for (int j=0; j<grid.getVoiceCount(); j++) {
 			for (int k=j+1; k<grid.getVoiceCount(); k++) {
 				for (int m=0; m<wsize; m++) {
-					NoteCell* cell1 = grid.cell(j, i-m);
-					if (cell1->isRest()) {
+					if (grid.isRest(j, i-m)) {
 						continue;
 					}
-					NoteCell* cell2 = grid.cell(k, i-m);
-					if (cell2->isRest()) {
+					if (grid.isRest(k, i-m)) {
 						continue;
 					}
 					count++;
-					if (cell1->isAttack() && cell2->isAttack()) {
+					if (grid.isAttack(j, i-m) && grid.isAttack(k, i-m)) {
 						score += 1.0;
 					}
 				}
@@ -63970,6 +67943,7 @@ void Tool_homorhythm2::processFile(HumdrumFile& infile) {
 
 Tool_hproof::Tool_hproof(void) {
 	// put option definitions here
+	defineThreadOption();
 }
 
 
@@ -64170,6 +68144,9 @@ Tool_humdiff::Tool_humdiff(void) {
 	define("time-points|times=b", "display timepoint lists for each file");
 	define("note-points|notes=b", "display notepoint lists for each file");
 	define("c|color=s:red",       "color for difference markers");
+	define("a|align=b",           "align measures and notes (allows added/deleted measures)");
+	define("json=b",              "print JSON edit script (implies --align)");
+	defineThreadOption();
 }
 
 
@@ -64199,23 +68176,45 @@ bool Tool_humdiff::run(HumdrumFileSet& infiles) {
 		cerr << "Usage: " << getCommand() << " files" << endl;
 		return false;
 	} else {
-		HumNum targetdur = infiles[0].getScoreDuration();
-		for (int i=1; i<infiles.getSize(); i++) {
-			HumNum dur = infiles[i].getScoreDuration();
-			if (dur != targetdur) {
-				cerr << "Error: all files must have the same duration" << endl;
-				return false;
+		m_reportQ = getBoolean("report");
+		m_jsonQ = getBoolean("json");
+		bool alignQ = m_jsonQ || getBoolean("align");
+		if (!alignQ) {
+			HumNum targetdur = infiles[0].getScoreDuration();
+			for (int i=1; i<infiles.getSize(); i++) {
+				HumNum dur = infiles[i].getScoreDuration();
+				if (dur != targetdur) {
+					cerr << "Error: all files must have the same duration" << endl;
+					return false;
+				}
 			}
 		}
 
+		if (m_jsonQ) {
+			m_json_text << "{\n";
+			m_json_text << "\t\"reference\": \""
+			            << getJsonString(infiles[reference].getFilename()) << "\",\n";
+			m_json_text << "\t\"comparisons\": [";
+		}
+
+		int count = 0;
 		for (int i=0; i<infiles.getCount(); i++) {
 			if (i == reference) {
 				continue;
 			}
-			compareFiles(infiles[reference], infiles[i]);
+			if (!alignQ) {
+				compareFiles(infiles[reference], infiles[i]);
+				continue;
+			}
+			if (m_jsonQ && count++) {
+				m_json_text << ",";
+			}
+			alignFiles(infiles[reference], infiles[i], i + 1);
 		}
 
-		if (!getBoolean("report")) {
+		if (m_jsonQ) {
+			m_json_text << "\n\t]\n}\n";
+		} else if (!m_reportQ) {
 			infiles[reference].createLinesFromTokens();
 			m_humdrum_text << infiles[reference];
 			if (m_marked) {
@@ -64528,7 +68527,7 @@ void Tool_humdiff::getNoteList(vector<NotePoint>& notelist, HumdrumFile& infile,
 			notelist.back().subtoken = subtok;
 			notelist.back().subindex = j;
 			notelist.back().measurequarter = token->getDurationFromBarline();
-			notelist.back().measure =
+			notelist.back().measure = measure;
 			notelist.back().track = track;
 			notelist.back().layer = layer;
 			notelist.back().sourceindex = sourceindex;
@@ -64541,6 +68540,459 @@ void Tool_humdiff::getNoteList(vector<NotePoint>& notelist, HumdrumFile& infile,
 
 
 
+//////////////////////////////
+//
+// Tool_humdiff::alignFiles -- Compare two files which may have added or
+//     deleted measures.  The measures of each file are aligned by their
+//     note fingerprints with a linear-space diff (see alignSequences()).
+//     Measures which are not aligned are paired in order within the gaps
+//     between aligned measures, and the notes of paired measures are then
+//     aligned in the same way.  Reference notes with no match in the
+//     alternate file are marked, and all differences are added to the
+//     JSON edit script (--json) or report (--report).
+//
+
+void Tool_humdiff::alignFiles(HumdrumFile& reference, HumdrumFile& alternate,
+		int altindex) {
+	m_altindex = altindex;
+	m_edits.clear();
+
+	vector<MeasurePoint> refmeasures;
+	vector<MeasurePoint> altmeasures;
+	extractMeasurePoints(refmeasures, reference, 0);
+	extractMeasurePoints(altmeasures, alternate, altindex);
+
+	vector<uint64_t> reffingerprints(refmeasures.size());
+	for (int i=0; i<(int)refmeasures.size(); i++) {
+		reffingerprints[i] = refmeasures[i].fingerprint;
+	}
+	vector<uint64_t> altfingerprints(altmeasures.size());
+	for (int i=0; i<(int)altmeasures.size(); i++) {
+		altfingerprints[i] = altmeasures[i].fingerprint;
+	}
+
+	vector<pair<int, int>> matches;
+	alignSequences(matches, reffingerprints, altfingerprints);
+	matches.emplace_back((int)refmeasures.size(), (int)altmeasures.size());
+
+	int rindex = 0;
+	int aindex = 0;
+	for (int i=0; i<(int)matches.size(); i++) {
+		alignMeasureGap(refmeasures, rindex, matches[i].first,
+				altmeasures, aindex, matches[i].second);
+		rindex = matches[i].first + 1;
+		aindex = matches[i].second + 1;
+	}
+
+	if (!m_jsonQ) {
+		return;
+	}
+	m_json_text << "\n\t\t{\n";
+	m_json_text << "\t\t\t\"alternate\": \""
+	            << getJsonString(alternate.getFilename()) << "\",\n";
+	m_json_text << "\t\t\t\"source\": " << altindex << ",\n";
+	m_json_text << "\t\t\t\"measures\": {\"reference\": " << refmeasures.size()
+	            << ", \"alternate\": " << altmeasures.size()
+	            << ", \"matched\": " << (matches.size() - 1) << "},\n";
+	m_json_text << "\t\t\t\"edits\": [";
+	for (int i=0; i<(int)m_edits.size(); i++) {
+		m_json_text << (i ? ",\n" : "\n") << "\t\t\t\t" << m_edits[i];
+	}
+	m_json_text << (m_edits.empty() ? "]\n" : "\n\t\t\t]\n");
+	m_json_text << "\t\t}";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignMeasureGap -- Process the measures between two
+//     aligned measures (or the start/end of the files).  Measures are
+//     paired in order, and any extra measures in the reference or the
+//     alternate file are deleted or inserted measures.
+//
+
+void Tool_humdiff::alignMeasureGap(vector<MeasurePoint>& refmeasures,
+		int rstart, int rend, vector<MeasurePoint>& altmeasures, int astart,
+		int aend) {
+	int pairs = std::min(rend - rstart, aend - astart);
+	for (int i=0; i<pairs; i++) {
+		alignMeasureNotes(refmeasures[rstart + i], altmeasures[astart + i]);
+	}
+	for (int i=rstart+pairs; i<rend; i++) {
+		addEdit("delete-measure", &refmeasures[i], NULL, NULL, NULL);
+		if (m_reportQ || m_jsonQ) {
+			continue;
+		}
+		for (int j=0; j<(int)refmeasures[i].notes.size(); j++) {
+			markNote(refmeasures[i].notes[j]);
+		}
+	}
+	for (int i=astart+pairs; i<aend; i++) {
+		addEdit("insert-measure", NULL, NULL, &altmeasures[i], NULL);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignMeasureNotes -- Align the notes of two measures
+//     which have different fingerprints.
+//
+
+void Tool_humdiff::alignMeasureNotes(MeasurePoint& refmeasure,
+		MeasurePoint& altmeasure) {
+	vector<pair<int, int>> matches;
+	alignSequences(matches, refmeasure.keys, altmeasure.keys);
+	matches.emplace_back((int)refmeasure.notes.size(), (int)altmeasure.notes.size());
+
+	int rindex = 0;
+	int aindex = 0;
+	bool changed = false;
+	for (int i=0; i<(int)matches.size(); i++) {
+		if ((rindex < matches[i].first) || (aindex < matches[i].second)) {
+			changed = true;
+		}
+		for (int j=rindex; j<matches[i].first; j++) {
+			addEdit("delete-note", &refmeasure, &refmeasure.notes[j], &altmeasure, NULL);
+			if (!(m_reportQ || m_jsonQ)) {
+				markNote(refmeasure.notes[j]);
+			}
+		}
+		for (int j=aindex; j<matches[i].second; j++) {
+			addEdit("insert-note", &refmeasure, NULL, &altmeasure, &altmeasure.notes[j]);
+		}
+		rindex = matches[i].first + 1;
+		aindex = matches[i].second + 1;
+	}
+	if (!changed && (refmeasure.duration != altmeasure.duration)) {
+		// Same notes, but the measures have a different duration:
+		addEdit("change-measure", &refmeasure, NULL, &altmeasure, NULL);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::addEdit -- Add a difference to the JSON edit script
+//     or to the report.  Line and field numbers start at 1.
+//
+
+void Tool_humdiff::addEdit(const string& op, MeasurePoint* refmeasure,
+		NotePoint* refnote, MeasurePoint* altmeasure, NotePoint* altnote) {
+	if (m_jsonQ) {
+		stringstream edit;
+		edit << "{\"op\": \"" << op << "\"";
+		if (refmeasure) {
+			edit << ", \"reference\": ";
+			printEditLocation(edit, *refmeasure, refnote);
+		}
+		if (altmeasure) {
+			edit << ", \"alternate\": ";
+			printEditLocation(edit, *altmeasure, altnote);
+		}
+		edit << "}";
+		m_edits.push_back(edit.str());
+		return;
+	}
+	if (!m_reportQ) {
+		return;
+	}
+
+	m_free_text << op;
+	if (refnote) {
+		m_free_text << " " << refnote->subtoken;
+	} else if (altnote) {
+		m_free_text << " " << altnote->subtoken;
+	}
+	m_free_text << " IN SOURCE " << m_altindex << endl;
+	if (refmeasure) {
+		int line = refnote ? refnote->token->getLineIndex() : refmeasure->line;
+		m_free_text << "\tREFERENCE MEASURE\t: " << refmeasure->measure << endl;
+		m_free_text << "\tREFERENCE LINE NO.\t: " << line + 1 << endl;
+	}
+	if (altmeasure) {
+		int line = altnote ? altnote->token->getLineIndex() : altmeasure->line;
+		m_free_text << "\tTARGET " << m_altindex << " MEASURE\t: " << altmeasure->measure << endl;
+		m_free_text << "\tTARGET " << m_altindex << " LINE NO.\t: " << line + 1 << endl;
+	}
+	m_free_text << endl;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::printEditLocation -- Print the location of a measure
+//     or a note in a measure as a JSON object.
+//
+
+void Tool_humdiff::printEditLocation(ostream& out, MeasurePoint& mp,
+		NotePoint* np) {
+	out << "{\"measure\": " << mp.measure;
+	if (!np) {
+		out << ", \"line\": " << mp.line + 1 << "}";
+		return;
+	}
+	out << ", \"line\": " << np->token->getLineIndex() + 1;
+	out << ", \"field\": " << np->token->getFieldIndex() + 1;
+	out << ", \"subtoken\": " << np->subindex + 1;
+	out << ", \"note\": \"" << getJsonString(np->subtoken) << "\"}";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::getJsonString -- Escape quotes and backslashes.
+//
+
+string Tool_humdiff::getJsonString(const string& value) {
+	string output;
+	for (int i=0; i<(int)value.size(); i++) {
+		if ((value[i] == '"') || (value[i] == '\\')) {
+			output += '\\';
+		}
+		output += value[i];
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::extractMeasurePoints -- Extract the notes of each measure
+//     in a file.  Grace notes and rests are ignored (as in
+//     extractTimePoints()), and barlines which are not followed by
+//     music do not create a measure.
+//
+
+void Tool_humdiff::extractMeasurePoints(vector<MeasurePoint>& measures,
+		HumdrumFile& infile, int sourceindex) {
+	measures.clear();
+	HumRegex hre;
+	int measure = -1;
+	int barline = -1;
+	bool newmeasure = true;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isBarline()) {
+			if (hre.search(infile.token(i, 0), "(\\d+)")) {
+				measure = hre.getMatchInt(1);
+			}
+			barline = i;
+			newmeasure = true;
+			continue;
+		}
+		if (!infile[i].isData()) {
+			continue;
+		}
+		if (infile[i].getDuration() == 0) {
+			// ignore grace notes for now
+			continue;
+		}
+		if (newmeasure) {
+			measures.resize(measures.size() + 1);
+			measures.back().measure = measure;
+			measures.back().line = barline < 0 ? i : barline;
+			newmeasure = false;
+		}
+		MeasurePoint& mp = measures.back();
+		mp.duration += infile[i].getDuration();
+		getNoteList(mp.notes, infile, i, measure, sourceindex, (int)measures.size() - 1);
+	}
+
+	for (int i=0; i<(int)measures.size(); i++) {
+		MeasurePoint& mp = measures[i];
+		stable_sort(mp.notes.begin(), mp.notes.end(),
+			[](const NotePoint& a, const NotePoint& b) {
+				if (a.measurequarter != b.measurequarter) {
+					return a.measurequarter < b.measurequarter;
+				}
+				if (a.b40 != b.b40) {
+					return a.b40 < b.b40;
+				}
+				return a.duration < b.duration;
+			});
+		mp.keys.resize(mp.notes.size());
+		uint64_t fingerprint = hashValue(0, mp.duration.getNumerator());
+		fingerprint = hashValue(fingerprint, mp.duration.getDenominator());
+		for (int j=0; j<(int)mp.notes.size(); j++) {
+			NotePoint& np = mp.notes[j];
+			uint64_t key = hashValue(0, np.measurequarter.getNumerator());
+			key = hashValue(key, np.measurequarter.getDenominator());
+			key = hashValue(key, np.b40);
+			key = hashValue(key, np.duration.getNumerator());
+			key = hashValue(key, np.duration.getDenominator());
+			mp.keys[j] = key;
+			fingerprint = hashValue(fingerprint, (int64_t)key);
+		}
+		mp.fingerprint = fingerprint;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::hashValue -- Add a value to a 64-bit hash (FNV-1a
+//     style mixing of a full word).
+//
+
+uint64_t Tool_humdiff::hashValue(uint64_t hash, int64_t value) {
+	hash ^= (uint64_t)value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+	hash *= 0x100000001b3ULL;
+	return hash;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignSequences -- Find a longest common subsequence of
+//     two lists of keys, returning the pairs of indexes of matched keys
+//     in increasing order.  This is Myers' O(ND) difference algorithm
+//     with the linear-space refinement: the middle snake of the shortest
+//     edit path is found by searching from both ends at the same time,
+//     and the two halves are then solved recursively.  Only two vectors
+//     of size N+M are needed.
+//
+
+void Tool_humdiff::alignSequences(vector<pair<int, int>>& matches,
+		const vector<uint64_t>& a, const vector<uint64_t>& b) {
+	matches.clear();
+	alignRange(matches, a, 0, (int)a.size(), b, 0, (int)b.size());
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignRange -- Align a[alow..ahigh) with b[blow..bhigh).
+//
+
+void Tool_humdiff::alignRange(vector<pair<int, int>>& matches,
+		const vector<uint64_t>& a, int alow, int ahigh,
+		const vector<uint64_t>& b, int blow, int bhigh) {
+	// common prefix and suffix:
+	while ((alow < ahigh) && (blow < bhigh) && (a[alow] == b[blow])) {
+		matches.emplace_back(alow++, blow++);
+	}
+	int suffix = 0;
+	while ((alow < ahigh) && (blow < bhigh) && (a[ahigh-1] == b[bhigh-1])) {
+		ahigh--;
+		bhigh--;
+		suffix++;
+	}
+
+	if ((alow < ahigh) && (blow < bhigh)) {
+		int xstart;
+		int ystart;
+		int xend;
+		int yend;
+		findMiddleSnake(a, alow, ahigh, b, blow, bhigh, xstart, ystart, xend, yend);
+		alignRange(matches, a, alow, xstart, b, blow, ystart);
+		while (xstart < xend) {
+			matches.emplace_back(xstart++, ystart++);
+		}
+		alignRange(matches, a, xend, ahigh, b, yend, bhigh);
+	}
+
+	for (int i=0; i<suffix; i++) {
+		matches.emplace_back(ahigh + i, bhigh + i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::findMiddleSnake -- Find the middle diagonal run of the
+//     shortest edit path between a[alow..ahigh) and b[blow..bhigh).  The
+//     forward and backward searches store the furthest x position reached
+//     on each diagonal k = x - y (the backward search works on the reversed
+//     sequences).  Returns the length of the edit path.
+//
+
+int Tool_humdiff::findMiddleSnake(const vector<uint64_t>& a, int alow,
+		int ahigh, const vector<uint64_t>& b, int blow, int bhigh,
+		int& xstart, int& ystart, int& xend, int& yend) {
+	int n = ahigh - alow;
+	int m = bhigh - blow;
+	int delta = n - m;
+	bool odd = delta & 1;
+	int maxd = (n + m + 1) / 2;
+	int offset = maxd + 1;
+	if ((int)m_forward.size() < 2 * offset + 1) {
+		m_forward.resize(2 * offset + 1);
+		m_backward.resize(2 * offset + 1);
+	}
+	int* forward = m_forward.data() + offset;
+	int* backward = m_backward.data() + offset;
+	forward[1] = 0;
+	backward[1] = 0;
+
+	for (int d=0; d<=maxd; d++) {
+		for (int k=-d; k<=d; k+=2) {
+			int x;
+			if ((k == -d) || ((k != d) && (forward[k-1] < forward[k+1]))) {
+				x = forward[k+1];
+			} else {
+				x = forward[k-1] + 1;
+			}
+			int y = x - k;
+			int x0 = x;
+			int y0 = y;
+			while ((x < n) && (y < m) && (a[alow+x] == b[blow+y])) {
+				x++;
+				y++;
+			}
+			forward[k] = x;
+			int rk = delta - k;
+			if (odd && (rk >= -(d-1)) && (rk <= d-1) && (x + backward[rk] >= n)) {
+				xstart = alow + x0;
+				ystart = blow + y0;
+				xend   = alow + x;
+				yend   = blow + y;
+				return 2 * d - 1;
+			}
+		}
+		for (int k=-d; k<=d; k+=2) {
+			int x;
+			if ((k == -d) || ((k != d) && (backward[k-1] < backward[k+1]))) {
+				x = backward[k+1];
+			} else {
+				x = backward[k-1] + 1;
+			}
+			int y = x - k;
+			int x0 = x;
+			int y0 = y;
+			while ((x < n) && (y < m) && (a[ahigh-1-x] == b[bhigh-1-y])) {
+				x++;
+				y++;
+			}
+			backward[k] = x;
+			int fk = delta - k;
+			if (!odd && (fk >= -d) && (fk <= d) && (x + forward[fk] >= n)) {
+				xstart = ahigh - x;
+				ystart = bhigh - y;
+				xend   = ahigh - x0;
+				yend   = bhigh - y0;
+				return 2 * d;
+			}
+		}
+	}
+
+	// not reached for valid input:
+	xstart = xend = alow;
+	ystart = yend = blow;
+	return n + m;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_humdiff::extractTimePoints -- Extract a list of the timestamps in a file.
@@ -64640,6 +69092,7 @@ Tool_humsheet::Tool_humsheet(void) {
 	define("X|no-exinterp=b", "do not embed exclusive interp data");
 	define("J|no-javascript=b", "do not embed javascript code");
 	define("S|no-style=b", "do not embed CSS style element");
+	defineThreadOption();
 }
 
 
@@ -65693,6 +70146,7 @@ Tool_humsort::Tool_humsort(void) {
 	define("s|spine=i:1", "Spine to sort (1-indexed)");
 	define("I|do-not-ignore-case=b", "Do not ignore case when sorting alphabetically");
 	define("i|e|x|interp|exclusive-interpretation=s", "Exclusive interpretation to sort");
+	defineThreadOption();
 }
 
 
@@ -65850,8 +70304,6 @@ void Tool_humsort::processFile(HumdrumFile& infile) {
 
 
 
-int Tool_imitation::Enumerator = 0;
-
 
 /////////////////////////////////
 //
@@ -65894,6 +70346,7 @@ Tool_imitation::Tool_imitation(void) {
 	define("a|add=b",             "add inversions, retrograde, etc. if specified to normal search");
 	define("v|inversion=b",       "match inversions");
 	define("g|retrograde=b",      "match retrograde");
+	defineThreadOption();
 }
 
 
@@ -65936,8 +70389,6 @@ bool Tool_imitation::run(HumdrumFile& infile, ostream& out) {
 
 
 bool Tool_imitation::run(HumdrumFile& infile) {
-	Enumerator = 0;
-
 	NoteGrid grid(infile);
 
 	if (getBoolean("debug")) {
@@ -65945,7 +70396,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 		// return 1;
 	}
 
-	Enumerator = 0;
+	m_enumerator = 0;
 	m_threshold = getInteger("threshold") + 1;
 	if (m_threshold < 3) {
 		m_threshold = 3;
@@ -66041,7 +70492,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 			infile.insertDataSpineBefore(track, results.at(i-1), "", exinterp);
 		}
 	}
-	if (m_mark && Enumerator) {
+	if (m_mark && m_enumerator) {
 		string rdfline = "!!!RDF**kern: ";
 		rdfline += m_marker;
 		rdfline += " = marked note (color=\"chocolate\")";
@@ -66087,9 +70538,258 @@ void Tool_imitation::doAnalysis(vector<vector<string> >& results,
 		getIntervals(intervals.at(i), attacks.at(i));
 	}
 
-	for (int i=0; i<(int)attacks.size(); i++) {
-		for (int j=i+1; j<(int)attacks.size(); j++) {
-			analyzeImitation(results, attacks, intervals, i, j);
+	vector<ImitationSequence> sequences;
+	getSequences(sequences, attacks, intervals);
+	ImitationCandidates candidates;
+	getCandidates(candidates, sequences);
+
+	int voices = (int)attacks.size();
+	int target = (int)sequences.size() - voices;
+	for (int i=0; i<voices; i++) {
+		for (int j=i+1; j<voices; j++) {
+			analyzeImitation(results, attacks, intervals, sequences, i,
+					target + j, candidates);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_imitation::getSequences -- Convert the attacks of each voice into
+//     symbols for matching.  The first sequence for each voice is in
+//     performance order.  If searching for inversions or retrograde,
+//     a second set of sequences is added after these with the intervals
+//     negated and/or the notes in reverse order; otherwise the first
+//     sequences are compared to each other.
+//
+
+void Tool_imitation::getSequences(vector<ImitationSequence>& sequences,
+		vector<vector<NoteCell*>>& attacks, vector<vector<double>>& intervals) {
+	int voices = (int)attacks.size();
+	bool variant = m_inversion || m_retrograde;
+	sequences.clear();
+	sequences.resize(variant ? 2 * voices : voices);
+
+	map<HumNum, int> durations;
+	for (int v=0; v<voices; v++) {
+		int size = (int)attacks.at(v).size();
+		ImitationSequence& seq = sequences.at(v);
+		seq.m_voice = v;
+		seq.m_notes.resize(size);
+		seq.m_durations.resize(size);
+		seq.m_intervals.resize(size);
+		for (int k=0; k<size; k++) {
+			seq.m_notes[k] = k;
+			seq.m_durations[k] = 0;
+			if (m_duration) {
+				HumNum duration = attacks.at(v).at(k)->getDuration();
+				auto it = durations.find(duration);
+				if (it == durations.end()) {
+					int id = (int)durations.size();
+					durations[duration] = id;
+					seq.m_durations[k] = id;
+				} else {
+					seq.m_durations[k] = it->second;
+				}
+			}
+			double interval = intervals.at(v).at(k);
+			if (Convert::isNaN(interval)) {
+				seq.m_intervals[k] = ImitationSequence::IMITATION_REST;
+			} else {
+				seq.m_intervals[k] = int(interval);
+			}
+		}
+		if (!variant) {
+			continue;
+		}
+
+		ImitationSequence& target = sequences.at(voices + v);
+		target.m_voice = v;
+		target.m_notes.resize(size);
+		target.m_durations.resize(size);
+		target.m_intervals.resize(size);
+		for (int k=0; k<size; k++) {
+			int n = m_retrograde ? size - 1 - k : k;
+			int interval;
+			if (!m_retrograde) {
+				interval = seq.m_intervals[n];
+			} else if (k < size - 1) {
+				// interval from note n back to the previous note:
+				interval = seq.m_intervals[n-1];
+				if (interval != ImitationSequence::IMITATION_REST) {
+					interval = -interval;
+				}
+			} else {
+				interval = ImitationSequence::IMITATION_REST;
+			}
+			if (m_inversion && (interval != ImitationSequence::IMITATION_REST)) {
+				interval = -interval;
+			}
+			target.m_notes[k] = n;
+			target.m_durations[k] = seq.m_durations[n];
+			target.m_intervals[k] = interval;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_imitation::getCandidates -- Find the groups of positions in the
+//     sequences which are followed by at least threshold-1 identical
+//     symbols, using a suffix array of all sequences.  The suffixes which
+//     share a prefix of that length are adjacent in the suffix array, so
+//     each run of adjacent suffixes with long enough common prefixes is
+//     one group, and every pair of its positions in different voices is a
+//     candidate match.  Each position is in at most one group, so only
+//     the groups are stored and analyzeImitation() visits the pairs of
+//     each voice pair from them.  A passage of repeated notes would
+//     otherwise give a number of pairs quadratic in its length.
+//
+
+void Tool_imitation::getCandidates(ImitationCandidates& candidates,
+		vector<ImitationSequence>& sequences) {
+	candidates.m_group.clear();
+	candidates.m_group.resize(sequences.size());
+	candidates.m_members.clear();
+	for (int s=0; s<(int)sequences.size(); s++) {
+		candidates.m_group[s].assign(sequences[s].m_intervals.size(), -1);
+	}
+
+	// Concatenate the sequences, with a unique (negative) separator after
+	// each one so that common prefixes do not cross sequence boundaries.
+	vector<int> text;
+	vector<int> owner;
+	vector<int> position;
+	map<pair<int, int>, int> symbols;
+	for (int s=0; s<(int)sequences.size(); s++) {
+		ImitationSequence& seq = sequences[s];
+		for (int k=0; k<(int)seq.m_intervals.size(); k++) {
+			pair<int, int> key(seq.m_durations[k], seq.m_intervals[k]);
+			auto it = symbols.find(key);
+			if (it == symbols.end()) {
+				int id = (int)symbols.size();
+				symbols[key] = id;
+				text.push_back(id);
+			} else {
+				text.push_back(it->second);
+			}
+			owner.push_back(s);
+			position.push_back(k);
+		}
+		text.push_back(-1 - s);
+		owner.push_back(-1);
+		position.push_back(-1);
+	}
+
+	vector<int> suffixes;
+	vector<int> lcp;
+	buildSuffixArray(suffixes, lcp, text);
+
+	// A match of threshold-1 notes needs threshold-2 matching intervals.
+	int minlcp = m_threshold - 2;
+	vector<pair<int, int>> members;
+	int n = (int)suffixes.size();
+	int start = 0;
+	for (int r=1; r<=n; r++) {
+		if ((r < n) && (lcp[r] >= minlcp)) {
+			continue;
+		}
+		if (r - start > 1) {
+			for (int t=start; t<r; t++) {
+				int s = owner[suffixes[t]];
+				if (s < 0) {
+					continue;
+				}
+				int k = position[suffixes[t]];
+				if (k >= (int)sequences[s].m_intervals.size() - 1) {
+					continue;
+				}
+				if (sequences[s].m_intervals[k] == ImitationSequence::IMITATION_REST) {
+					// sequences cannot start with rests
+					continue;
+				}
+				members.emplace_back(s, k);
+			}
+			if (members.size() > 1) {
+				int group = (int)candidates.m_members.size();
+				for (auto& member : members) {
+					candidates.m_group[member.first][member.second] = group;
+				}
+				std::sort(members.begin(), members.end());
+				candidates.m_members.push_back(members);
+			}
+			members.clear();
+		}
+		start = r;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_imitation::buildSuffixArray -- Sort the suffixes of the text by
+//     prefix doubling, and calculate the length of the longest common
+//     prefix between each suffix and the one before it in sorted order
+//     (Kasai's algorithm).
+//
+
+void Tool_imitation::buildSuffixArray(vector<int>& suffixes, vector<int>& lcp,
+		const vector<int>& text) {
+	int n = (int)text.size();
+	suffixes.resize(n);
+	lcp.assign(n, 0);
+	if (n == 0) {
+		return;
+	}
+	vector<int> rank(n);
+	vector<int> temp(n);
+	for (int i=0; i<n; i++) {
+		suffixes[i] = i;
+	}
+	std::sort(suffixes.begin(), suffixes.end(), [&](int a, int b) {
+		return text[a] < text[b];
+	});
+	rank[suffixes[0]] = 0;
+	for (int i=1; i<n; i++) {
+		rank[suffixes[i]] = rank[suffixes[i-1]] + (text[suffixes[i-1]] < text[suffixes[i]]);
+	}
+
+	for (int k=1; rank[suffixes[n-1]] < n-1; k *= 2) {
+		auto compare = [&](int a, int b) {
+			if (rank[a] != rank[b]) {
+				return rank[a] < rank[b];
+			}
+			int ra = a + k < n ? rank[a + k] : -1;
+			int rb = b + k < n ? rank[b + k] : -1;
+			return ra < rb;
+		};
+		std::sort(suffixes.begin(), suffixes.end(), compare);
+		temp[suffixes[0]] = 0;
+		for (int i=1; i<n; i++) {
+			temp[suffixes[i]] = temp[suffixes[i-1]] + compare(suffixes[i-1], suffixes[i]);
+		}
+		rank.swap(temp);
+	}
+
+	// rank is now the inverse of suffixes.
+	int h = 0;
+	for (int i=0; i<n; i++) {
+		if (rank[i] == 0) {
+			h = 0;
+			continue;
+		}
+		int j = suffixes[rank[i] - 1];
+		while ((i + h < n) && (j + h < n) && (text[i + h] == text[j + h])) {
+			h++;
+		}
+		lcp[rank[i]] = h;
+		if (h > 0) {
+			h--;
 		}
 	}
 }
@@ -66122,17 +70822,27 @@ void Tool_imitation::getIntervals(vector<double>& intervals,
 
 //////////////////////////////
 //
-// Tool_imitation::analyzeImitation -- do imitation analysis between two voices.
+// Tool_imitation::analyzeImitation -- do imitation analysis between two
+//     voices.  The candidate matches are the pairs of positions in the
+//     sequences index1 and index2 which are in the same candidate group,
+//     visited by position in the first sequence and then the second.
+//     After a match (or partial match), later candidates for the same
+//     note in the first voice which start inside of it are skipped.
 //
 
 void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 		vector<vector<NoteCell*>>& attacks, vector<vector<double>>& intervals,
-		int v1, int v2) {
+		vector<ImitationSequence>& sequences, int index1, int index2,
+		ImitationCandidates& candidates) {
+
+	ImitationSequence& seq1 = sequences.at(index1);
+	ImitationSequence& seq2 = sequences.at(index2);
 
+	int v1 = seq1.m_voice;
+	int v2 = seq2.m_voice;
 	vector<NoteCell*>& v1a = attacks.at(v1);
 	vector<NoteCell*>& v2a = attacks.at(v2);
 	vector<double>& v1i = intervals.at(v1);
-	vector<double>& v2i = intervals.at(v2);
 
 	int min = m_threshold - 1;
 	int count;
@@ -66140,9 +70850,21 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 	vector<int> enum1(v1a.size(), 0);
 	vector<int> enum2(v2a.size(), 0);
 
-	for (int i=0; i<(int)v1i.size() - 1; i++) {
-		count = 0;
-		for (int j=0; j<(int)v2i.size() - 1; j++) {
+	vector<int>& groups = candidates.m_group.at(index1);
+	for (int i=0; i<(int)groups.size(); i++) {
+		if (groups[i] < 0) {
+			continue;
+		}
+		// The (sequence, position) entries of the group are sorted, so the
+		// positions in seq2 are contiguous and in order.
+		vector<pair<int, int>>& members = candidates.m_members.at(groups[i]);
+		auto it = std::lower_bound(members.begin(), members.end(), std::make_pair(index2, 0));
+		int skip = -1;
+		for (; (it != members.end()) && (it->first == index2); it++) {
+			int p = it->second;
+			if (p <= skip) {
+				continue;
+			}
 			if (m_rest || m_rest2) {
 				if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
 					// match initiator must be preceded by a rest (or start of music)
@@ -66150,24 +70872,42 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 				}
 			}
 			if (m_rest2) {
-				if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
+				if ((p > 0) && (!Convert::isNaN(attacks.at(v2).at(seq2.m_notes.at(p-1))->getSgnDiatonicPitch()))) {
 					// match target must be preceded by a rest (or start of music)
 					continue;
 				}
 			}
-			if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(j))) {
+			if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(seq2.m_notes.at(p)))) {
 				// avoid re-matching an existing match as a submatch
 				continue;
 			}
-			count = compareSequences(v1a, v1i, i, v2a, v2i, j);
+			if (m_nozero || m_onlyzero) {
+				HumNum start1 = attacks.at(v1).at(i)->getToken()->getDurationFromStart();
+				HumNum start2 = attacks.at(v2).at(seq2.m_notes.at(p))->getToken()->getDurationFromStart();
+				if (m_nozero && (start1 == start2)) {
+					// exclude matches that start at the same time.
+					continue;
+				}
+				if (m_onlyzero && (start1 != start2)) {
+					// exclude matches that do not start at the same time (parallel motion).
+					continue;
+				}
+			}
+			count = compareSequences(seq1, i, seq2, p);
 			if ((count >= min) && (m_intervals.size() > 0)) {
 				count = checkForIntervalSequence(m_intervals, v1i, i, count);
 			}
 			if (count < min) {
-				j += count;
+				skip = p + count;
 				continue;
 			}
 
+			// jfirst: the note in the second voice matched to note i in the first.
+			// j: the first note of the match in the second voice (these differ
+			// for retrograde matches).
+			int jfirst = seq2.m_notes.at(p);
+			int j = std::min(jfirst, seq2.m_notes.at(p + count - 1));
+
 			// cout << "Match length count " << count << endl;
 			HTp token1 = attacks.at(v1).at(i)->getToken();
 			HTp token2 = attacks.at(v2).at(j)->getToken();
@@ -66177,17 +70917,17 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 			HumNum distance2 = time1 - time2;
 
 			if (m_maxdistanceQ && (distance1.getAbs().getFloat() > m_maxdistance)) {
-				j += count;
+				skip = p + count;
 				continue;
 			}
 
-			Enumerator++;
+			m_enumerator++;
 			for (int k=0; k<count; k++) {
-				enum1.at(i+k) = Enumerator;
-				enum2.at(j+k) = Enumerator;
+				enum1.at(i+k) = m_enumerator;
+				enum2.at(seq2.m_notes.at(p+k)) = m_enumerator;
 			}
 
-			int interval = int(*attacks.at(v2).at(j) - *attacks.at(v1).at(i));
+			int interval = int(*attacks.at(v2).at(jfirst) - *attacks.at(v1).at(i));
 
 			if (!m_noInfo) {
 				if (!(m_first && (distance1 < 0))) {
@@ -66207,7 +70947,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v1).at(line1) += "n";
 						}
-						results.at(v1).at(line1) += to_string(Enumerator);
+						results.at(v1).at(line1) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -66314,7 +71054,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v2).at(line2) += "n";
 						}
-						results.at(v2).at(line2) += to_string(Enumerator);
+						results.at(v2).at(line2) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -66409,10 +71149,11 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						break;
 					}
 					token1 = attacks.at(v1).at(i+z)->getToken();
-					if (j+z >= (int)attacks.at(v2).size()) {
+					if (p+z >= (int)seq2.m_notes.size()) {
 						break;
 					}
-					token2 = attacks.at(v2).at(j+z)->getToken();
+					int jz = seq2.m_notes.at(p+z);
+					token2 = attacks.at(v2).at(jz)->getToken();
 					if (m_single) {
 						if (token1->find(m_marker) == string::npos) {
 							token1->setText(*token1 + m_marker);
@@ -66425,25 +71166,25 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						token2->setText(*token2 + m_marker);
 					}
 
-               if (attacks.at(v1).at(i+z)->isRest() && (z < count - 1) ) {
+					if (attacks.at(v1).at(i+z)->isRest() && (z < count - 1) ) {
 						markedTiedNotes(attacks.at(v1).at(i+z)->m_tiedtokens);
 					} else if (!attacks.at(v1).at(i+z)->isRest()) {
 						markedTiedNotes(attacks.at(v1).at(i+z)->m_tiedtokens);
 					}
 
-               if (attacks.at(v2).at(j+z)->isRest() && (z < count - 1) ) {
-						markedTiedNotes(attacks.at(v2).at(j+z)->m_tiedtokens);
-					} else if (!attacks.at(v2).at(j+z)->isRest()) {
-						markedTiedNotes(attacks.at(v2).at(j+z)->m_tiedtokens);
+					if (attacks.at(v2).at(jz)->isRest() && (z < count - 1) ) {
+						markedTiedNotes(attacks.at(v2).at(jz)->m_tiedtokens);
+					} else if (!attacks.at(v2).at(jz)->isRest()) {
+						markedTiedNotes(attacks.at(v2).at(jz)->m_tiedtokens);
 					}
 
 				}
 			}
 
 			// skip over match (need to do in i as well somehow)
-			j += count;
-		} // j loop
-	} // i loop
+			skip = p + count;
+		} // candidate loop
+	}
 }
 
 
@@ -66497,91 +71238,46 @@ int Tool_imitation::checkForIntervalSequence(vector<int>& m_intervals,
 ///////////////////////////////
 //
 // Tool_imitation::compareSequences -- Returns the number of notes that
-//     match between the two sequences (which is one more than the 
-//     interval count).
+//     match between the two sequences (which is one more than the
+//     interval count).  Intervals to/from rests match only other
+//     intervals to/from rests.
 //
 
-int Tool_imitation::compareSequences(vector<NoteCell*>& attack1,
-		vector<double>& seq1, int i1, vector<NoteCell*>& attack2,
-		vector<double>& seq2, int i2) {
+int Tool_imitation::compareSequences(ImitationSequence& seq1, int p1,
+		ImitationSequence& seq2, int p2) {
 	int count = 0;
+	vector<int>& int1 = seq1.m_intervals;
+	vector<int>& int2 = seq2.m_intervals;
 	// sequences cannot start with rests
-	if (Convert::isNaN(seq1.at(i1)) || Convert::isNaN(seq2.at(i2))) {
+	if ((int1.at(p1) == ImitationSequence::IMITATION_REST) || (int2.at(p2) == ImitationSequence::IMITATION_REST)) {
 		return count;
 	}
-	if (m_nozero) {
-		// exclude matches that start at the same time.
-		if (attack1.at(i1)->getToken()->getDurationFromStart() == attack2.at(i2)->getToken()->getDurationFromStart()) {
-			return count;
-		}
-	} else if (m_onlyzero) {
-		// exclude matches that do not start at the same time (parallel motion).
-		if (attack1.at(i1)->getToken()->getDurationFromStart() != attack2.at(i2)->getToken()->getDurationFromStart()) {
-			return count;
-		}
-	}
-
-	HumNum dur1;
-	HumNum dur2;
-
-	while ((i1+count < (int)seq1.size()) && (i2+count < (int)seq2.size())) {
 
-		if (m_duration) {
-			dur1 = attack1.at(i1+count)->getDuration();
-			dur2 = attack2.at(i2+count)->getDuration();
-			if (dur1 != dur2) {
-				break;
-			}
+	while ((p1+count < (int)int1.size()) && (p2+count < (int)int2.size())) {
+		if (seq1.m_durations[p1+count] != seq2.m_durations[p2+count]) {
+			break;
 		}
-
-		if (Convert::isNaN(seq1.at(i1+count))) {
-			// the first voice's interval is to/from a rest
-			if (Convert::isNaN(seq2.at(i2+count))) {
-				// The seoncd voice's interval is also to/from a rest,
-				// so increment count and continue.
-				count++;
-				continue;
-			} else {
-				// The second voice's interval is not to/from a rest,
-				// so return the current count.
-				if (count) {
-					return count + 1;
-				} else {
-					return count;
-				}
-			}
-		} else if (Convert::isNaN(seq2.at(i2+count))) {
-			// The second voice's interval is to/from a rest
-			// but already know that the first one is not, so return
-			// current count;
-			if (count) {
-				return count + 1;
-			} else {
-				return count;
-			}
-		} else if (m_inversion && (seq1.at(i1+count) == -seq2.at(i2+count))) {
-         // The two sequences match as inversions at this point, so continue.
-			count++;
-		} else if ((!m_inversion) && (seq1.at(i1+count) == seq2.at(i2+count))) {
-         // The two sequences match at this point, so continue.
+		int a = int1[p1+count];
+		int b = int2[p2+count];
+		if ((a == ImitationSequence::IMITATION_REST) && (b == ImitationSequence::IMITATION_REST)) {
+			// Both intervals are to/from a rest, so increment count and continue.
 			count++;
 			continue;
-		} else {
-			// The sequences do not match so return the current count.
+		}
+		if (a != b) {
+			// The sequences do not match (or only one interval is to/from
+			// a rest) so return the current count.
 			if (count) {
 				return count + 1;
 			} else {
 				return count;
 			}
 		}
+		count++;
 	}
 
-	if (count) {
-		// don't add one for some reaason (this will cause out-of-bounds)
-		return count;
-	} else {
-		return count;
-	}
+	// don't add one for some reaason (this will cause out-of-bounds)
+	return count;
 }
 
 
@@ -66598,6 +71294,7 @@ Tool_kern2mens::Tool_kern2mens(void) {
 	define("I|not-invisible=b",       "keep measures visible");
 	define("D|no-double-bar=b",       "keep thick final barlines");
 	define("c|clef=s",                "clef to use in mensural notation");
+	defineThreadOption();
 }
 
 
@@ -66837,6 +71534,7 @@ Tool_kernview::Tool_kernview(void) {
 	define("g=s", "Regular expression of kern spines to view");
 	define("G=s", "Regular expression of kern spines to hide");
 	define("h|hide|r|remove=s", "hide the list of spines");
+	defineThreadOption();
 }
 
 
@@ -67151,6 +71849,7 @@ bool Tool_mei2hum::convert(ostream& out, xml_document& doc) {
 		m_outdata.enableRecipSpine();
 	}
 
+	HumArena* oldarena = HumArena::setActive(m_outdata.getArena());
 	HumNum systemstamp = 0;  // timestamp for music.
 	systemstamp = parseScore(score, systemstamp);
 
@@ -67201,6 +71900,7 @@ bool Tool_mei2hum::convert(ostream& out, xml_document& doc) {
 	} else {
 		m_outdata.transferTokens(outfile);
 	}
+	HumArena::setActive(oldarena);
 
 	addHeaderRecords(outfile, doc);
 	addExtMetaRecords(outfile, doc);
@@ -71163,6 +75863,7 @@ Tool_melisma::Tool_melisma(void) {
 	define("a|average|avg=b",  "calculate note-to-syllable ratio");
 	define("w|words=b",        "list words that contain a melisma");
 	define("p|part=b", "also calculate note-to-syllable ratios by part");
+	defineThreadOption();
 }
 
 
@@ -71927,6 +76628,7 @@ Tool_metlev::Tool_metlev(void) {
 	define("G|no-grace-notes=b",  "do not mark grace note lines");
 	define("k|kern-spine=i:1",    "analyze only given kern spine");
 	define("e|exinterp=s:blev",   "exclusive interpretation type for output");
+	defineThreadOption();
 }
 
 
@@ -72132,6 +76834,7 @@ Tool_modori::Tool_modori(void) {
 	define("K|no-key|no-keys=b", "Do not change key signatures");
 	define("C|no-clef|no-clefs=b", "Do not change clefs");
 	define("M|no-mensuration|no-mensurations=b", "Do not change mensurations");
+	defineThreadOption();
 }
 
 
@@ -72731,6 +77434,432 @@ void MSearchQueryToken::parseHarmonicQuery(void) {
 
 
 
+const char MSearchIndex::INDEX_MAGIC[9] = "HUMMSIDX";
+const int MSearchIndex::INDEX_VERSION = 1;
+
+
+//////////////////////////////
+//
+// MSearchIndex::MSearchIndex -- Constructor.
+//
+
+MSearchIndex::MSearchIndex(void) {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::~MSearchIndex -- Deconstructor.
+//
+
+MSearchIndex::~MSearchIndex() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::clear -- Remove all files from the index.
+//
+
+void MSearchIndex::clear(void) {
+	m_filenames.clear();
+	m_entries.clear();
+	m_map.close();
+	m_keys     = NULL;
+	m_offsets  = NULL;
+	m_postings = NULL;
+	m_keyCount = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addFile -- Add the trigrams of note features for each
+//    voice of a file to the index.  The filename is used to read the file
+//    again when verifying matches.
+//
+
+void MSearchIndex::addFile(HumdrumFile& infile, const string& filename) {
+	uint64_t findex = (uint64_t)m_filenames.size();
+	m_filenames.push_back(filename);
+
+	NoteGrid grid(infile);
+	vector<NoteCell*> attacks;
+	vector<int64_t> values;
+	int position = 0;
+	for (int v=0; v<grid.getVoiceCount(); v++) {
+		grid.getNoteAndRestAttacks(attacks, v);
+		int count = (int)attacks.size();
+		values.resize(count);
+		for (int f=FEATURE_PITCH40; f<FEATURE_COUNT; f++) {
+			for (int i=0; i<count; i++) {
+				values[i] = getNoteFeature(attacks, i, f);
+			}
+			for (int i=0; i<count - 2; i++) {
+				uint64_t key = makeKey(f, values[i], values[i+1], values[i+2]);
+				m_entries.emplace_back(key, (findex << 32) | (uint64_t)(position + i));
+			}
+		}
+		position += count;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::write -- Store the index in a file.  The format is
+//    "HUMMSIDX", the format version and file count (32-bit integers),
+//    the filenames (32-bit length followed by the characters), padding
+//    to a multiple of 8 bytes, the key and posting counts (64-bit
+//    integers), the sorted keys, the posting offset for each key plus
+//    a final end offset (64-bit integers), and then the file index
+//    and attack position of each posting (32-bit integers).  Integers
+//    are stored in the byte order of the computer, so that an index file
+//    can be searched in place after it has been memory-mapped.
+//
+
+bool MSearchIndex::write(const string& filename) {
+	std::ofstream output(filename, std::ios::out | std::ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+	sort(m_entries.begin(), m_entries.end());
+
+	string header(INDEX_MAGIC, 8);
+	uint32_t value32 = (uint32_t)INDEX_VERSION;
+	header.append((const char*)&value32, 4);
+	value32 = (uint32_t)m_filenames.size();
+	header.append((const char*)&value32, 4);
+	for (int i=0; i<(int)m_filenames.size(); i++) {
+		value32 = (uint32_t)m_filenames[i].size();
+		header.append((const char*)&value32, 4);
+		header += m_filenames[i];
+	}
+	header.append((8 - header.size() % 8) % 8, '\0');
+
+	vector<uint64_t> keys;
+	vector<uint64_t> offsets;
+	vector<uint32_t> postings;
+	keys.reserve(m_entries.size());
+	offsets.reserve(m_entries.size() + 1);
+	postings.reserve(m_entries.size() * 2);
+	for (int i=0; i<(int)m_entries.size(); i++) {
+		if (keys.empty() || (keys.back() != m_entries[i].first)) {
+			keys.push_back(m_entries[i].first);
+			offsets.push_back(i);
+		}
+		postings.push_back((uint32_t)(m_entries[i].second >> 32));
+		postings.push_back((uint32_t)(m_entries[i].second & 0xffffffff));
+	}
+	offsets.push_back(m_entries.size());
+
+	uint64_t counts[2] = { (uint64_t)keys.size(), (uint64_t)m_entries.size() };
+	output.write(header.data(), header.size());
+	output.write((const char*)counts, sizeof(counts));
+	output.write((const char*)keys.data(), keys.size() * sizeof(uint64_t));
+	output.write((const char*)offsets.data(), offsets.size() * sizeof(uint64_t));
+	output.write((const char*)postings.data(), postings.size() * sizeof(uint32_t));
+	output.close();
+	return !output.fail();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::read -- Load an index file written by write().  The file
+//    is memory-mapped, so only the parts of the index which are searched
+//    are read from the disk.  Returns false if the file cannot be read or
+//    is not an index file.
+//
+
+bool MSearchIndex::read(const string& filename) {
+	clear();
+	if (!m_map.open(filename)) {
+		return false;
+	}
+	const char* data = m_map.getData();
+	size_t size = m_map.getSize();
+	size_t position = 16;
+	if ((size < position) || (memcmp(data, INDEX_MAGIC, 8) != 0)) {
+		clear();
+		return false;
+	}
+	uint32_t version;
+	uint32_t filecount;
+	memcpy(&version, data + 8, 4);
+	memcpy(&filecount, data + 12, 4);
+	if ((int)version != INDEX_VERSION) {
+		clear();
+		return false;
+	}
+	for (uint32_t i=0; i<filecount; i++) {
+		uint32_t length;
+		if (size - position < 4) {
+			clear();
+			return false;
+		}
+		memcpy(&length, data + position, 4);
+		position += 4;
+		if (size - position < length) {
+			clear();
+			return false;
+		}
+		m_filenames.emplace_back(data + position, length);
+		position += length;
+	}
+	position += (8 - position % 8) % 8;
+
+	uint64_t counts[2];
+	if ((position > size) || (size - position < sizeof(counts))) {
+		clear();
+		return false;
+	}
+	memcpy(counts, data + position, sizeof(counts));
+	position += sizeof(counts);
+	uint64_t needed = counts[0] * 16 + 8 + counts[1] * 8;
+	if ((counts[0] > size) || (counts[1] > size) || (size - position != needed)) {
+		clear();
+		return false;
+	}
+	m_keyCount = counts[0];
+	m_keys     = (const uint64_t*)(data + position);
+	m_offsets  = m_keys + m_keyCount;
+	m_postings = (const uint32_t*)(m_offsets + m_keyCount + 1);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileCount -- Return the number of files in the index.
+//
+
+int MSearchIndex::getFileCount(void) {
+	return (int)m_filenames.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFilename -- Return the name of a file in the index.
+//
+
+string MSearchIndex::getFilename(int index) {
+	return m_filenames.at(index);
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::findKey -- Return the index of a key in the index file,
+//    or -1 if the key is not present.
+//
+
+int MSearchIndex::findKey(uint64_t key) {
+	const uint64_t* found = std::lower_bound(m_keys, m_keys + m_keyCount, key);
+	if ((found == m_keys + m_keyCount) || (*found != key)) {
+		return -1;
+	}
+	return (int)(found - m_keys);
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getPostingCount -- Return the number of postings for a key
+//    in the index file.
+//
+
+int MSearchIndex::getPostingCount(uint64_t key) {
+	int index = findKey(key);
+	if (index < 0) {
+		return 0;
+	}
+	return (int)(m_offsets[index+1] - m_offsets[index]);
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getPostings -- Return the file indexes and attack positions
+//    for a key in the index file, sorted by file and then by position.
+//
+
+void MSearchIndex::getPostings(uint64_t key, vector<pair<int, int>>& postings) {
+	postings.clear();
+	int index = findKey(key);
+	if (index < 0) {
+		return;
+	}
+	postings.reserve(m_offsets[index+1] - m_offsets[index]);
+	for (uint64_t i=m_offsets[index]; i<m_offsets[index+1]; i++) {
+		postings.emplace_back((int)m_postings[2*i], (int)m_postings[2*i+1]);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::hasPosting -- Returns true if the key in the index file
+//    has a posting for the given file index and attack position.
+//
+
+bool MSearchIndex::hasPosting(uint64_t key, int file, int position) {
+	int index = findKey(key);
+	if (index < 0) {
+		return false;
+	}
+	uint64_t target = ((uint64_t)file << 32) | (uint32_t)position;
+	uint64_t low = m_offsets[index];
+	uint64_t high = m_offsets[index+1];
+	while (low < high) {
+		uint64_t mid = low + (high - low) / 2;
+		uint64_t value = ((uint64_t)m_postings[2*mid] << 32) | m_postings[2*mid+1];
+		if (value == target) {
+			return true;
+		} else if (value < target) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::makeKey -- Combine a feature type and the feature values
+//    of three successive notes into an index key.
+//
+
+uint64_t MSearchIndex::makeKey(int feature, int64_t value1, int64_t value2,
+		int64_t value3) {
+	uint64_t key = (uint64_t)feature * 0x9e3779b97f4a7c15ULL;
+	int64_t values[3] = { value1, value2, value3 };
+	for (int i=0; i<3; i++) {
+		key ^= (uint64_t)values[i] + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+		key *= 0xbf58476d1ce4e5b9ULL;
+		key ^= key >> 31;
+	}
+	return key;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getNoteFeature -- Return a feature of a note in a voice.
+//    The values are calculated in the same way as in
+//    Tool_msearch::checkForMusicMatch(), so that a note which matches a
+//    query token will always have the same feature value as the token.
+//
+
+int64_t MSearchIndex::getNoteFeature(vector<NoteCell*>& notes, int index,
+		int feature) {
+	const int64_t rest = INT64_MIN;
+	NoteCell* note = notes[index];
+	switch (feature) {
+		case FEATURE_PITCH40:
+			return note->isRest() ? rest : (int64_t)note->getAbsBase40PitchClass();
+		case FEATURE_PITCH12:
+			return note->isRest() ? rest : (int64_t)(((int)note->getAbsMidiPitch()) % 12);
+		case FEATURE_PITCH7:
+			return note->isRest() ? rest : (int64_t)(((int)note->getAbsDiatonicPitch()) % 7);
+		case FEATURE_CINTERVAL:
+		case FEATURE_DINTERVAL:
+			{
+				bool diatonicQ = feature == FEATURE_DINTERVAL;
+				double currpitch = diatonicQ ? note->getAbsDiatonicPitch() : note->getAbsBase40Pitch();
+				double nextpitch = -123456789.0;
+				if (index + 1 < (int)notes.size()) {
+					nextpitch = diatonicQ ? notes[index+1]->getAbsDiatonicPitch()
+							: notes[index+1]->getAbsBase40Pitch();
+				}
+				return (int64_t)(int)(nextpitch - currpitch);
+			}
+		case FEATURE_DURATION:
+			{
+				HumNum duration = note->getDuration();
+				return ((int64_t)duration.getNumerator() << 32) ^ (int64_t)duration.getDenominator();
+			}
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getQueryFeature -- Return true and the feature value if
+//    the query token requires a particular value for the feature.
+//
+
+bool MSearchIndex::getQueryFeature(MSearchQueryToken& token, int feature,
+		int64_t& value) {
+	if (token.anything) {
+		return false;
+	}
+	const int64_t rest = INT64_MIN;
+	switch (feature) {
+		case FEATURE_PITCH40:
+		case FEATURE_PITCH12:
+		case FEATURE_PITCH7:
+			{
+				if (token.anypitch) {
+					return false;
+				}
+				int base = 40;
+				if ((token.base == 12) || (token.base == 7)) {
+					base = token.base;
+				}
+				if (((feature == FEATURE_PITCH40) && (base != 40)) ||
+				    ((feature == FEATURE_PITCH12) && (base != 12)) ||
+				    ((feature == FEATURE_PITCH7)  && (base != 7))) {
+					return false;
+				}
+				value = Convert::isNaN(token.pc) ? rest : (int64_t)token.pc;
+				return true;
+			}
+		case FEATURE_DINTERVAL:
+			if (token.dinterval > -1000) {
+				value = token.dinterval;
+				return true;
+			}
+			return false;
+		case FEATURE_CINTERVAL:
+			if ((token.dinterval <= -1000) && (token.cinterval > -1000)) {
+				value = token.cinterval;
+				return true;
+			}
+			return false;
+		case FEATURE_DURATION:
+			if (!token.anyrhythm) {
+				value = ((int64_t)token.duration.getNumerator() << 32)
+						^ (int64_t)token.duration.getDenominator();
+				return true;
+			}
+			return false;
+	}
+	return false;
+}
+
+
+
 /////////////////////////////////
 //
 // Tool_msearch::Tool_msearch -- Set the recognized options for the tool.
@@ -72749,6 +77878,7 @@ Tool_msearch::Tool_msearch(void) {
 	define("m|mark|marker=s:@",     "marking character");
 	define("M|no-mark|no-marker=b", "do not mark matches");
 	define("Q|quiet=b",             "quite mode: do not summarize matches");
+	defineThreadOption();
 }
 
 
@@ -72827,6 +77957,185 @@ bool Tool_msearch::run(HumdrumFile& infile) {
 }
 
 
+//////////////////////////////
+//
+// Tool_msearch::searchIndex -- Search the files in an n-gram index for
+//    the music query, printing the filename, line number and field number
+//    of the first note of each match.  The index is used to find the files
+//    and notes which can start a match, and then each candidate is checked
+//    with checkForMusicMatch().  If the query does not have three successive
+//    tokens which can be looked up in the index, all notes in all files of
+//    the index are checked.
+//
+
+bool Tool_msearch::searchIndex(MSearchIndex& index, ostream& out) {
+	m_debugQ = getBoolean("debug");
+	m_quietQ = getBoolean("quiet");
+	m_nooverlapQ = getBoolean("no-overlap");
+	initialize();
+
+	vector<MSearchQueryToken> query;
+	fillMusicQuery(query);
+	if (query.empty()) {
+		return false;
+	}
+	if (m_debugQ) {
+		printQuery(query);
+	}
+
+	// candidates: file index and attack position of the possible
+	// starting notes of matches, sorted by file and then by position.
+	vector<pair<int, int>> candidates;
+	vector<pair<uint64_t, int>> lookups;
+	bool indexQ = planIndexSearch(index, query, lookups);
+	if (indexQ) {
+		index.getPostings(lookups[0].first, candidates);
+		int start = lookups[0].second;
+		int count = 0;
+		for (int i=0; i<(int)candidates.size(); i++) {
+			int position = candidates[i].second - start;
+			if (position < 0) {
+				continue;
+			}
+			bool foundQ = true;
+			for (int j=1; j<(int)lookups.size(); j++) {
+				if (!index.hasPosting(lookups[j].first, candidates[i].first,
+						position + lookups[j].second)) {
+					foundQ = false;
+					break;
+				}
+			}
+			if (foundQ) {
+				candidates[count++] = std::make_pair(candidates[i].first, position);
+			}
+		}
+		candidates.resize(count);
+		if (m_debugQ) {
+			cerr << "INDEX CANDIDATES: " << count << endl;
+		}
+	}
+
+	int mcount = 0;
+	int c = 0;
+	vector<NoteCell*> match;
+	vector<vector<NoteCell*>> attacks;
+	vector<int> offsets;
+	for (int f=0; f<index.getFileCount(); f++) {
+		if (indexQ && ((c >= (int)candidates.size()) || (candidates[c].first != f))) {
+			continue;
+		}
+		string filename = index.getFilename(f);
+		HumdrumFile infile;
+		if (!infile.read(filename)) {
+			cerr << "Warning: cannot read " << filename << endl;
+			while ((c < (int)candidates.size()) && (candidates[c].first == f)) {
+				c++;
+			}
+			continue;
+		}
+		m_sonorities.clear();
+		m_sonorities.resize(infile.getLineCount());
+		m_sonoritiesChecked.assign(infile.getLineCount(), false);
+
+		NoteGrid grid(infile);
+		attacks.resize(grid.getVoiceCount());
+		offsets.resize(grid.getVoiceCount() + 1);
+		offsets[0] = 0;
+		for (int v=0; v<grid.getVoiceCount(); v++) {
+			grid.getNoteAndRestAttacks(attacks[v], v);
+			offsets[v+1] = offsets[v] + (int)attacks[v].size();
+		}
+
+		vector<pair<int, int>> notes;
+		if (indexQ) {
+			for (; (c < (int)candidates.size()) && (candidates[c].first == f); c++) {
+				int position = candidates[c].second;
+				int v = (int)(upper_bound(offsets.begin(), offsets.end(), position) - offsets.begin()) - 1;
+				if ((v < 0) || (v >= grid.getVoiceCount())) {
+					// index is out of date
+					continue;
+				}
+				notes.emplace_back(v, position - offsets[v]);
+			}
+		} else {
+			for (int v=0; v<grid.getVoiceCount(); v++) {
+				for (int n=0; n<(int)attacks[v].size(); n++) {
+					notes.emplace_back(v, n);
+				}
+			}
+		}
+
+		for (int i=0; i<(int)notes.size(); i++) {
+			int v = notes[i].first;
+			int n = notes[i].second;
+			bool status = checkForMusicMatch(attacks[v], n, query, match);
+			if (!status || match.empty()) {
+				continue;
+			}
+			mcount++;
+			HTp token = attacks[v][n]->getToken();
+			out << filename << "\t" << token->getLineNumber()
+			    << "\t" << token->getFieldNumber() << endl;
+		}
+	}
+
+	if (!m_quietQ) {
+		out << "!!MATCHES: " << mcount << endl;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::planIndexSearch -- Make a list of index lookups for the
+//    query.  Each feature (pitch, interval or rhythm) which is required by
+//    three successive query tokens is a possible lookup.  The lookups are
+//    sorted by the number of postings in the index, so that the first
+//    lookup gives the smallest list of candidate notes, which are then
+//    filtered by checking for postings of the other lookups.  The second
+//    value of each lookup is the index of the first of the three tokens
+//    in the query.  Returns false if there are no possible lookups.
+//
+
+bool Tool_msearch::planIndexSearch(MSearchIndex& index,
+		vector<MSearchQueryToken>& query, vector<pair<uint64_t, int>>& lookups) {
+	lookups.clear();
+	vector<pair<int, int>> order;
+	int64_t values[3];
+	for (int f=MSearchIndex::FEATURE_PITCH40; f<MSearchIndex::FEATURE_COUNT; f++) {
+		for (int i=0; i<(int)query.size() - 2; i++) {
+			bool foundQ = true;
+			for (int j=0; j<3; j++) {
+				if (!MSearchIndex::getQueryFeature(query[i+j], f, values[j])) {
+					foundQ = false;
+					break;
+				}
+			}
+			if (!foundQ) {
+				continue;
+			}
+			uint64_t key = MSearchIndex::makeKey(f, values[0], values[1], values[2]);
+			order.emplace_back(index.getPostingCount(key), (int)lookups.size());
+			lookups.emplace_back(key, i);
+		}
+	}
+	sort(order.begin(), order.end());
+	vector<pair<uint64_t, int>> sorted;
+	for (int i=0; i<(int)order.size(); i++) {
+		sorted.push_back(lookups[order[i].second]);
+	}
+	lookups.swap(sorted);
+	if (m_debugQ && !order.empty()) {
+		cerr << "INDEX LOOKUPS: " << lookups.size() << ", FEWEST POSTINGS: "
+		     << order[0].first << endl;
+	}
+	return !lookups.empty();
+}
+
+
+
 //////////////////////////////
 //
 // Tool_msearch::initialize --
@@ -74619,6 +79928,7 @@ bool Tool_musedata2hum::convert(ostream& out, MuseDataSet& mds) {
 	initialize();
 
 	HumGrid outdata;
+	HumArena* oldarena = HumArena::setActive(outdata.getArena());
 	int partcount = mds.getPartCount();
 	bool status = true;
 	for (int i=0; i<partcount; i++) {
@@ -74628,6 +79938,7 @@ bool Tool_musedata2hum::convert(ostream& out, MuseDataSet& mds) {
 	HumdrumFile outfile;
 	outdata.transferTokens(outfile);
 	outfile.createLinesFromTokens();
+	HumArena::setActive(oldarena);
 
 	// Convert comments in header of first part:
 	for (int i=0; i< mds[0].getLineCount(); i++) {
@@ -75298,6 +80609,10 @@ Tool_musicxml2hum::Tool_musicxml2hum(void) {
 
 	define("r|recip=b", "output **recip spine");
 	define("s|stems=b", "include stems in output");
+	define("batch=b", "convert all input files (and MusicXML files in input directories)");
+	define("o|outdir=s", "directory for --batch output files (default: print segments)");
+	define("stream=b", "read partwise MusicXML one measure at a time to reduce memory usage");
+	defineThreadOption();
 
 	VoiceDebugQ = false;
 	DebugQ = false;
@@ -75313,12 +80628,56 @@ Tool_musicxml2hum::Tool_musicxml2hum(void) {
 
 bool Tool_musicxml2hum::convertFile(ostream& out, const char* filename) {
 	xml_document doc;
-	auto result = doc.load_file(filename);
+	vector<char> buffer;
+	return convertFile(out, filename, doc, buffer);
+}
+
+
+//
+// The document and the buffer for the contents of the file are given
+// so that they can be reused for converting many files.  The file is
+// parsed in place (pugixml stores pointers into the buffer rather than
+// copies of the text).  Errors are stored in the error text of the tool.
+//
+
+bool Tool_musicxml2hum::convertFile(ostream& out, const char* filename,
+		xml_document& doc, vector<char>& buffer) {
+	if (getBoolean("stream")) {
+		MxmlStream stream;
+		if (stream.open(filename)) {
+			return convertStream(out, stream);
+		}
+		// Otherwise read the entire file (for timewise scores,
+		// non-UTF-8 files, or to report syntax errors).
+	}
+
+	ifstream input(filename, std::ios::binary);
+	if (!input.is_open()) {
+		m_error_text << "Cannot read file: " << filename << endl;
+		return false;
+	}
+	input.seekg(0, std::ios::end);
+	std::streamoff size = input.tellg();
+	input.seekg(0, std::ios::beg);
+	if (size < 0) {
+		m_error_text << "Cannot read file: " << filename << endl;
+		return false;
+	}
+	buffer.resize((size_t)size);
+	if (size > 0) {
+		input.read(buffer.data(), size);
+	}
+	if (!input) {
+		m_error_text << "Cannot read file: " << filename << endl;
+		return false;
+	}
+
+	auto result = doc.load_buffer_inplace(buffer.data(), buffer.size());
 	if (!result) {
-		cerr << "\nXML file [" << filename << "] has syntax errors\n";
-		cerr << "Error description:\t" << result.description() << "\n";
-		cerr << "Error offset:\t" << result.offset << "\n\n";
-		exit(1);
+		m_error_text << "XML file [" << filename << "] has syntax errors: "
+		             << result.description() << " at offset "
+		             << result.offset << endl;
+		return false;
 	}
 
 	return convert(out, doc);
@@ -75335,10 +80694,10 @@ bool Tool_musicxml2hum::convert(ostream& out, const char* input) {
 	xml_document doc;
 	auto result = doc.load_string(input);
 	if (!result) {
-		cout << "\nXML content has syntax errors\n";
-		cout << "Error description:\t" << result.description() << "\n";
-		cout << "Error offset:\t" << result.offset << "\n\n";
-		exit(1);
+		m_error_text << "XML content has syntax errors: "
+		             << result.description() << " at offset "
+		             << result.offset << endl;
+		return false;
 	}
 
 	return convert(out, doc);
@@ -75387,7 +80746,102 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	reindexVoices(partdata);
 
 	HumGrid outdata;
+	HumArena* oldarena = HumArena::setActive(outdata.getArena());
 	status &= stitchParts(outdata, partids, partinfo, partcontent, partdata);
+	if (hasError()) {
+		HumArena::setActive(oldarena);
+		return false;
+	}
+
+	status &= convertGrid(out, doc, outdata, partids, partdata);
+	HumArena::setActive(oldarena);
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertStream -- Convert a partwise MusicXML file one
+//     measure at a time.  Only the measures currently being inserted into
+//     the grid are parsed into XML documents, rather than the entire score,
+//     so memory usage depends on the size of the Humdrum output rather than
+//     the size of the MusicXML file.  The output is the same as for
+//     convert().
+//
+
+bool Tool_musicxml2hum::convertStream(ostream& out, MxmlStream& stream) {
+	initialize();
+
+	bool status = true; // for keeping track of problems in conversion process.
+
+	xml_document doc;
+	if (!stream.loadSkeleton(doc)) {
+		m_error_text << stream.getError() << endl;
+		return false;
+	}
+
+	setSoftwareInfo(doc);
+	vector<string> partids;            // list of part IDs
+	map<string, xml_node> partinfo;    // mapping if IDs to score-part elements
+	map<string, xml_node> partcontent; // mapping of IDs to (empty) part elements
+
+	getPartInfo(partinfo, partids, doc);
+	m_used_hairpins.resize(partinfo.size());
+
+	m_current_dynamic.resize(partids.size());
+	m_stop_char.resize(partids.size(), "[");
+
+	getPartContent(partcontent, partids, doc);
+	vector<MxmlPart> partdata;
+	partdata.resize(partids.size());
+	m_last_ottava_direction.resize(partids.size());
+
+	// index of each part in the stream, or -1 if the part has no content:
+	vector<int> partindex(partids.size());
+	for (int i=0; i<(int)partids.size(); i++) {
+		partindex[i] = stream.getPartIndex(partids[i]);
+	}
+
+	if (!fillPartData(partdata, partids, partinfo, stream, partindex)) {
+		return false;
+	}
+
+	m_maxstaff = 0;
+	// check the voice info
+	for (int i=0; i<(int)partdata.size(); i++) {
+		partdata[i].prepareVoiceMapping();
+		m_maxstaff += partdata[i].getStaffCount();
+		// for debugging:
+		if (VoiceDebugQ) {
+			partdata[i].printStaffVoiceInfo();
+		}
+	}
+
+	HumGrid outdata;
+	HumArena* oldarena = HumArena::setActive(outdata.getArena());
+	status &= stitchParts(outdata, partdata, stream, partindex);
+	if (hasError()) {
+		HumArena::setActive(oldarena);
+		return false;
+	}
+
+	status &= convertGrid(out, doc, outdata, partids, partdata);
+	HumArena::setActive(oldarena);
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertGrid -- Convert the stitched parts into
+//     Humdrum data and print it.
+//
+
+bool Tool_musicxml2hum::convertGrid(ostream& out, xml_document& doc,
+		HumGrid& outdata, vector<string>& partids, vector<MxmlPart>& partdata) {
+	bool status = true;
 
 	if (outdata.size() > 2) {
 		if (outdata.at(0)->getDuration() == 0) {
@@ -75452,9 +80906,18 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	HumdrumFile outfile;
 	outdata.transferTokens(outfile);
 
+	// Lines and tokens added to the output file from now on should not
+	// be allocated from the grid's arena:
+	HumArena* gridarena = HumArena::setActive(outfile.getArena());
+
 	addHeaderRecords(outfile, doc);
 	addFooterRecords(outfile, doc);
 
+	// Analyze the tokens of the output file rather than printing the
+	// data and reading it back in (start times and note durations are
+	// taken from the grid):
+	outfile.analyzeFromTokens();
+
 	Tool_ruthfix ruthfix;
 	ruthfix.run(outfile);
 
@@ -75533,6 +80996,7 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	prepareRdfs(partdata);
 	printRdfs(out);
 
+	HumArena::setActive(gridarena);
 	return status;
 }
 
@@ -75653,8 +81117,8 @@ void Tool_musicxml2hum::printRdfs(ostream& out) {
 //
 
 void Tool_musicxml2hum::setSoftwareInfo(xml_document& doc) {
-	string xpath = "/score-partwise/identification/encoding/software";
-	string software = doc.select_node(xpath.c_str()).node().child_value();
+	string software = getFirstNode(doc, {"score-partwise", "identification",
+			"encoding", "software"}).child_value();
 	HumRegex hre;
 	if (hre.search(software, "sibelius", "i")) {
 		m_software = "sibelius";
@@ -75735,13 +81199,17 @@ void Tool_musicxml2hum::addHeaderRecords(HumdrumFile& outfile, xml_document& doc
 		}
 	}
 
-	xpath = "/score-partwise/credit/credit-words";
-   pugi::xpath_node_set credits = doc.select_nodes(xpath.c_str());
+	vector<xml_node> credits;
+	for (xml_node credit : doc.child("score-partwise").children("credit")) {
+		for (xml_node words : credit.children("credit-words")) {
+			credits.push_back(words);
+		}
+	}
 	map<string, int> keys;
 	vector<string> refs;
 	vector<int> positions; // +1 = above, -1 = below;
 	for (auto it = credits.begin(); it != credits.end(); it++) {
-		string contents = cleanSpaces(it->node().child_value());
+		string contents = cleanSpaces(it->child_value());
 		if (contents.empty()) {
 			continue;
 		}
@@ -75776,8 +81244,8 @@ void Tool_musicxml2hum::addHeaderRecords(HumdrumFile& outfile, xml_document& doc
 	// OTL: title //////////////////////////////////////////////////////////
 
 	// Sibelius method
-	xpath = "/score-partwise/work/work-title";
-	string worktitle = cleanSpaces(doc.select_node(xpath.c_str()).node().child_value());
+	string worktitle = cleanSpaces(getFirstNode(doc, {"score-partwise", "work",
+			"work-title"}).child_value());
 	string otl_record;
 	string omv_record;
 	bool worktitleQ = false;
@@ -75787,8 +81255,7 @@ void Tool_musicxml2hum::addHeaderRecords(HumdrumFile& outfile, xml_document& doc
 		worktitleQ = true;
 	}
 
-	xpath = "/score-partwise/movement-title";
-	string mtitle = cleanSpaces(doc.select_node(xpath.c_str()).node().child_value());
+	string mtitle = cleanSpaces(doc.child("score-partwise").child("movement-title").child_value());
 	if (mtitle != "") {
 		if (worktitleQ) {
 			omv_record = "!!!OMV: ";
@@ -75801,8 +81268,14 @@ void Tool_musicxml2hum::addHeaderRecords(HumdrumFile& outfile, xml_document& doc
 
 	// COM: composer /////////////////////////////////////////////////////////
 	// CDT: composer's dates
-	xpath = "/score-partwise/identification/creator[@type='composer']";
-	string composer = cleanSpaces(doc.select_node(xpath.c_str()).node().child_value());
+	xml_node composernode;
+	for (xml_node id : doc.child("score-partwise").children("identification")) {
+		composernode = id.find_child_by_attribute("creator", "type", "composer");
+		if (composernode) {
+			break;
+		}
+	}
+	string composer = cleanSpaces(composernode.child_value());
 	string cdt_record;
 	if (composer != "") {
 		if (hre.search(composer, R"(\((.*?\d.*?)\))")) {
@@ -75876,7 +81349,7 @@ void Tool_musicxml2hum::addHeaderRecords(HumdrumFile& outfile, xml_document& doc
 void Tool_musicxml2hum::addFooterRecords(HumdrumFile& outfile, xml_document& doc) {
 
 	// YEM: copyright
-	string copy = doc.select_node("/score-partwise/identification/rights").node().child_value();
+	string copy = getFirstNode(doc, {"score-partwise", "identification", "rights"}).child_value();
 	bool validcopy = true;
 	if (copy == "") {
 		validcopy = false;
@@ -76110,28 +81583,75 @@ bool Tool_musicxml2hum::fillPartData(MxmlPart& partdata,
 	// be 28-30 staffs too many.
 	m_last_ottava_direction.at(partdata.getPartIndex()).resize(32);
 
-	int count;
-	auto measures = partcontent.select_nodes("./measure");
-	for (int i=0; i<(int)measures.size(); i++) {
-		partdata.addMeasure(measures[i].node());
-		count = partdata.getMeasureCount();
-		if (count > 1) {
-			HumNum dur = partdata.getMeasure(count-1)->getTimeSigDur();
-			if (dur == 0) {
-				HumNum dur = partdata.getMeasure(count-2)
-						->getTimeSigDur();
-				if (dur > 0) {
-					partdata.getMeasure(count - 1)->setTimeSigDur(dur);
-				}
-			}
+	for (xml_node measure : partcontent.children("measure")) {
+		addPartMeasure(partdata, measure);
+	}
+	return true;
+}
+
+
+//
+// Streaming version: the measures of each part are parsed one at a
+// time to collect the information which the measures report to their
+// part (staff/voice usage, verse counts, etc.), which is needed before
+// any measure can be inserted into the grid.  Each measure is deleted
+// after the following one has been parsed, and stitchParts() parses
+// them again when inserting them into the grid.
+//
+
+bool Tool_musicxml2hum::fillPartData(vector<MxmlPart>& partdata,
+		const vector<string>& partids, map<string, xml_node>& partinfo,
+		MxmlStream& stream, const vector<int>& partindex) {
+	xml_document doc;
+	for (int i=0; i<(int)partdata.size(); i++) {
+		partdata[i].setPartNumber(i+1);
+		if (m_stemsQ) {
+			partdata[i].enableStems();
 		}
+		partdata[i].parsePartInfo(partinfo[partids[i]]);
+		m_last_ottava_direction.at(i).resize(32);
 
+		int count = stream.getMeasureCount(partindex[i]);
+		for (int m=0; m<count; m++) {
+			xml_node measure = stream.loadMeasure(doc, partindex[i], m);
+			if (!measure) {
+				m_error_text << stream.getError() << endl;
+				return false;
+			}
+			addPartMeasure(partdata[i], measure);
+			partdata[i].deleteMeasure(m-1);
+		}
+		partdata[i].clearMeasures();
 	}
 	return true;
 }
 
 
 
+//////////////////////////////
+//
+// Tool_musicxml2hum::addPartMeasure -- Append a measure to a part, using
+//     the time signature of the previous measure if the new measure does
+//     not have one.
+//
+
+void Tool_musicxml2hum::addPartMeasure(MxmlPart& partdata, xml_node measure) {
+	partdata.addMeasure(measure);
+	int count = partdata.getMeasureCount();
+	if (count > 1) {
+		HumNum dur = partdata.getMeasure(count-1)->getTimeSigDur();
+		if (dur == 0) {
+			HumNum dur = partdata.getMeasure(count-2)
+					->getTimeSigDur();
+			if (dur > 0) {
+				partdata.getMeasure(count - 1)->setTimeSigDur(dur);
+			}
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_musicxml2hum::printPartInfo -- Debug information.
@@ -76151,10 +81671,11 @@ void Tool_musicxml2hum::printPartInfo(vector<string>& partids,
 		     << getChildElementText(partinfo[partids[i]], "part-abbreviation")
 		     << endl;
 		auto node = partcontent[partids[i]];
-		auto measures = node.select_nodes("./measure");
-		cout << "\t\tMeasure count:\t" << measures.size() << endl;
-		if (maxmeasure < (int)measures.size()) {
-			maxmeasure = (int)measures.size();
+		int measures = (int)std::distance(node.children("measure").begin(),
+				node.children("measure").end());
+		cout << "\t\tMeasure count:\t" << measures << endl;
+		if (maxmeasure < measures) {
+			maxmeasure = measures;
 		}
 		cout << "\t\tTotal duration:\t" << partdata[i].getDuration() << endl;
 	}
@@ -76277,10 +81798,10 @@ bool Tool_musicxml2hum::stitchParts(HumGrid& outdata,
 	// i used to start at 1 for some strange reason.
 	for (i=0; i<(int)partdata.size(); i++) {
 		if (measurecount != partdata[i].getMeasureCount()) {
-			cerr << "ERROR: cannot handle parts with different measure\n";
-			cerr << "counts yet. Compare MM" << measurecount << " to MM";
-			cerr << partdata[i].getMeasureCount() << endl;
-			exit(1);
+			m_error_text << "ERROR: cannot handle parts with different measure\n";
+			m_error_text << "counts yet. Compare MM" << measurecount << " to MM";
+			m_error_text << partdata[i].getMeasureCount() << endl;
+			return false;
 		}
 	}
 
@@ -76306,6 +81827,147 @@ bool Tool_musicxml2hum::stitchParts(HumGrid& outdata,
 }
 
 
+//
+// Streaming version: the measures are parsed again one column (the same
+// measure in every part) at a time.  Three columns of measure documents
+// are kept: the column being inserted into the grid, the next column
+// (since a forward repeat is stored in the barline style of the previous
+// measure), and the previous column (since directions at the end of a
+// measure are attached to the first note of the following measure).
+//
+
+bool Tool_musicxml2hum::stitchParts(HumGrid& outdata,
+		vector<MxmlPart>& partdata, MxmlStream& stream,
+		const vector<int>& partindex) {
+	if (partdata.size() == 0) {
+		return false;
+	}
+
+	int i;
+	int partcount = (int)partdata.size();
+	int measurecount = stream.getMeasureCount(partindex[0]);
+	for (i=0; i<partcount; i++) {
+		int count = stream.getMeasureCount(partindex[i]);
+		if (measurecount != count) {
+			m_error_text << "ERROR: cannot handle parts with different measure\n";
+			m_error_text << "counts yet. Compare MM" << measurecount << " to MM";
+			m_error_text << count << endl;
+			return false;
+		}
+	}
+
+	vector<int> partstaves(partcount, 0);
+	for (i=0; i<(int)partstaves.size(); i++) {
+		partstaves[i] = partdata[i].getStaffCount();
+	}
+
+	const int columns = 3;
+	vector<xml_document> docs(columns * partcount);
+	m_carry.reset();
+
+	bool status = true;
+	for (int m=-1; m<measurecount; m++) {
+		if (m + 1 < measurecount) {
+			int column = (m + 1) % columns;
+			for (i=0; i<partcount; i++) {
+				xml_document& doc = docs[column * partcount + i];
+				partdata[i].deleteMeasure(m + 1 - columns);
+				releaseMeasureNodes(doc);
+				xml_node measure = stream.loadMeasure(doc, partindex[i], m + 1);
+				if (!measure) {
+					m_error_text << stream.getError() << endl;
+					break;
+				}
+				addPartMeasure(partdata[i], measure);
+			}
+			if (hasError()) {
+				break;
+			}
+		}
+		if (m < 0) {
+			continue;
+		}
+		for (i=0; i<partcount; i++) {
+			reindexMeasure(partdata[i].getMeasure(m));
+		}
+		status &= insertMeasure(outdata, m, partdata, partstaves);
+	}
+
+	for (i=0; i<(int)docs.size(); i++) {
+		releaseMeasureNodes(docs[i]);
+	}
+	for (i=0; i<partcount; i++) {
+		partdata[i].clearMeasures();
+	}
+	if (hasError()) {
+		return false;
+	}
+
+	moveBreaksToEndOfPreviousMeasure(outdata);
+
+	insertPartNames(outdata, partdata);
+
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::releaseMeasureNodes -- Remove references to the
+//     nodes of a measure document before it is reused.  Directions which
+//     are still waiting to be attached to a note are copied into m_carry.
+//
+
+void Tool_musicxml2hum::releaseMeasureNodes(xml_document& doc) {
+	for (int i=0; i<(int)m_current_dynamic.size(); i++) {
+		for (int j=0; j<(int)m_current_dynamic[i].size(); j++) {
+			carryNode(m_current_dynamic[i][j], doc);
+		}
+	}
+	for (int i=0; i<(int)m_current_figured_bass.size(); i++) {
+		carryNode(m_current_figured_bass[i], doc);
+	}
+	for (int i=0; i<(int)m_current_text.size(); i++) {
+		carryNode(m_current_text[i].second, doc);
+	}
+	for (int i=0; i<(int)m_current_tempo.size(); i++) {
+		carryNode(m_current_tempo[i].second, doc);
+	}
+	for (auto& it : m_post_note_text) {
+		for (int i=0; i<(int)it.second.size(); i++) {
+			carryNode(it.second[i], doc);
+		}
+	}
+
+	// Used hairpins are only compared by node identity, so references
+	// to a released document can be dropped (and must be, since the nodes
+	// of the next measure parsed into the document may reuse the memory).
+	for (int i=0; i<(int)m_used_hairpins.size(); i++) {
+		vector<xml_node>& hairpins = m_used_hairpins[i];
+		for (int j=(int)hairpins.size()-1; j>=0; j--) {
+			if (hairpins[j].root() == doc) {
+				hairpins.erase(hairpins.begin() + j);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::carryNode -- If the node belongs to the given
+//     document, replace it with a copy stored in m_carry.
+//
+
+void Tool_musicxml2hum::carryNode(xml_node& node, xml_document& doc) {
+	if (node && (node.root() == doc)) {
+		node = m_carry.append_copy(node);
+	}
+}
+
+
 
 //////////////////////////////
 //
@@ -77851,10 +83513,10 @@ void Tool_musicxml2hum::addHairpinEnding(GridPart* part, MxmlEvent* event, int p
 
 string Tool_musicxml2hum::convertFiguredBassNumber(const xml_node& figure) {
 	string output;
-	xml_node fnum = figure.select_node("figure-number").node();
+	xml_node fnum = figure.child("figure-number");
 	// assuming one each of prefix/suffix:
-	xml_node prefixelement = figure.select_node("prefix").node();
-	xml_node suffixelement = figure.select_node("suffix").node();
+	xml_node prefixelement = figure.child("prefix");
+	xml_node suffixelement = figure.child("suffix");
 
 	string prefix;
 	if (prefixelement) {
@@ -77921,7 +83583,7 @@ string Tool_musicxml2hum::convertFiguredBassNumber(const xml_node& figure) {
 	string editorial;
 	string extension;
 
-	xml_node extendelement = figure.select_node("extend").node();
+	xml_node extendelement = figure.child("extend");
 	if (extendelement) {
 		string typestring = extendelement.attribute("type").value();
 		if (typestring == "start") {
@@ -78214,9 +83876,12 @@ string Tool_musicxml2hum::getFiguredBassString(xml_node fnode) {
 	}
 	// There is no bracket for FB in musicxml (3.0).
 
-	auto children = fnode.select_nodes("figure");
+	vector<xml_node> children;
+	for (xml_node figure : fnode.children("figure")) {
+		children.push_back(figure);
+	}
 	for (int i=0; i<(int)children.size(); i++) {
-		output += convertFiguredBassNumber(children[i].node());
+		output += convertFiguredBassNumber(children[i]);
 		output += editorial;
 		if (i < (int)children.size() - 1) {
 			output += " ";
@@ -78757,8 +84422,7 @@ void Tool_musicxml2hum::appendZeroEvents(GridMeasure* outdata,
 					if (nodeType(child, "key")) {
 						keysigs[pindex].push_back(child);
 						haskeysig = true;
-						string xpath = "mode";
-						string mode = child.select_node(xpath.c_str()).node().child_value();
+						string mode = child.child("mode").child_value();
 						if (mode != "") {
 							haskeydesignation = true;
 						}
@@ -78879,7 +84543,7 @@ void Tool_musicxml2hum::appendZeroEvents(GridMeasure* outdata,
 void Tool_musicxml2hum::storeOttava(int pindex, xml_node octaveShift, xml_node direction,
 	vector<vector<vector<xml_node>>>& ottavas) {
 	int staffindex = 0;
-	xml_node staffnode = direction.select_node("staff").node();
+	xml_node staffnode = direction.child("staff");
 	if (staffnode && staffnode.text()) {
 		int staffnum = staffnode.text().as_int();
 		if (staffnum > 0) {
@@ -80097,7 +85761,10 @@ bool Tool_musicxml2hum::getPartContent(
 		map<string, xml_node>& partcontent,
 		vector<string>& partids, xml_document& doc) {
 
-	auto parts = doc.select_nodes("/score-partwise/part");
+	vector<xml_node> parts;
+	for (xml_node part : doc.child("score-partwise").children("part")) {
+		parts.push_back(part);
+	}
 	int count = (int)parts.size();
 	if (count != (int)partids.size()) {
 		cerr << "Warning: part element count does not match part IDs count: "
@@ -80110,7 +85777,7 @@ bool Tool_musicxml2hum::getPartContent(
 		if (partid.size() == 0) {
 			cerr << "Warning: Part " << i << " has no ID" << endl;
 		}
-		auto status = partcontent.insert(make_pair(partid, parts[i].node()));
+		auto status = partcontent.insert(make_pair(partid, parts[i]));
 		if (status.second == false) {
 			cerr << "Error: ID " << partids.back()
 			     << " is duplicated and secondary part will be ignored" << endl;
@@ -80148,18 +85815,23 @@ bool Tool_musicxml2hum::getPartContent(
 
 bool Tool_musicxml2hum::getPartInfo(map<string, xml_node>& partinfo,
 		vector<string>& partids, xml_document& doc) {
-	auto scoreparts = doc.select_nodes("/score-partwise/part-list/score-part");
+	vector<xml_node> scoreparts;
+	for (xml_node partlist : doc.child("score-partwise").children("part-list")) {
+		for (xml_node scorepart : partlist.children("score-part")) {
+			scoreparts.push_back(scorepart);
+		}
+	}
 	partids.reserve(scoreparts.size());
 	bool output = true;
 	for (auto el : scoreparts) {
-		partids.emplace_back(getAttributeValue(el.node(), "id"));
-		auto status = partinfo.insert(make_pair(partids.back(), el.node()));
+		partids.emplace_back(getAttributeValue(el, "id"));
+		auto status = partinfo.insert(make_pair(partids.back(), el));
 		if (status.second == false) {
 			cerr << "Error: ID " << partids.back()
 			     << " is duplicated and secondary part will be ignored" << endl;
 		}
 		output &= status.second;
-		partinfo[partids.back()] = el.node();
+		partinfo[partids.back()] = el;
 	}
 	return output;
 }
@@ -80294,7 +85966,7 @@ void Tool_musicxml2hum::printAttributes(xml_node node) {
 string Tool_musicxml2hum::getSystemDecoration(xml_document& doc, HumGrid& grid,
 	vector<string>& partids) {
 
-	xml_node partlist = doc.select_node("/score-partwise/part-list").node();
+	xml_node partlist = doc.child("score-partwise").child("part-list");
 	if (!partlist) {
 		cerr << "Error: cannot find partlist\n";
 		return "";
@@ -80325,6 +85997,13 @@ string Tool_musicxml2hum::getSystemDecoration(xml_document& doc, HumGrid& grid,
 	int pcounter = 0;
 	scounter = 1;
 	vector<string> typeendings(100);
+
+	// The first group-symbol in the document (in document order) is used
+	// for every part group:
+	xml_node groupsymbol = doc.find_node([](xml_node node) {
+		return strcmp(node.name(), "group-symbol") == 0;
+	});
+
 	for (int i=0; i<(int)children.size(); i++) {
 		string name = children[i].name();
 		if (name == "part-group") {
@@ -80332,7 +86011,7 @@ string Tool_musicxml2hum::getSystemDecoration(xml_document& doc, HumGrid& grid,
 			string gsymbol = "";
 			int number = children[i].attribute("number").as_int();
 			if (grouptype == "start") {
-				string g = children[i].select_node("//group-symbol").node().child_value();
+				string g = groupsymbol.child_value();
 				if (g == "bracket") {
 					output += "[(";
 					typeendings[number] = ")]";
@@ -80391,6 +86070,240 @@ void Tool_musicxml2hum::getChildrenVector(vector<xml_node>& children,
 
 
 
+//////////////////////////////
+//
+// Tool_musicxml2hum::getFirstNode -- Return the first element (in
+//   document order) at the end of a path of element names, such as
+//   {"score-partwise", "work", "work-title"}.  This is the same as the
+//   first result of the XPath query "/score-partwise/work/work-title",
+//   but without compiling and evaluating the query.
+//
+
+xml_node Tool_musicxml2hum::getFirstNode(xml_node parent,
+		const vector<string>& path, int index) {
+	if (index >= (int)path.size()) {
+		return parent;
+	}
+	const char* name = path[index].c_str();
+	for (xml_node child : parent.children(name)) {
+		xml_node output = getFirstNode(child, path, index + 1);
+		if (output) {
+			return output;
+		}
+	}
+	return xml_node();
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertFiles -- Convert a list of MusicXML files (or
+//   directories containing MusicXML files) with a pool of -j threads.
+//   Each thread reuses one XML document and one file buffer for all of
+//   the files that it converts.  If the -o option is given, each file
+//   is written to the output directory with a .krn extension, otherwise
+//   the conversions are printed in input order as segments of a Humdrum
+//   stream (with at most one file per thread waiting to be printed).
+//   Files that cannot be converted are reported in the error text
+//   (one line per file) and do not stop the other conversions.  Nothing
+//   is converted if an input directory cannot be read, or if two input
+//   files would be written to the same file in the output directory.
+//   Returns false if any file could not be converted.
+//
+
+bool Tool_musicxml2hum::convertFiles(ostream& out,
+		const vector<string>& filenames) {
+	vector<string> files;
+	bool status = true;
+	for (int i=0; i<(int)filenames.size(); i++) {
+		status &= getInputFiles(files, filenames[i]);
+	}
+	bool outdirQ = getBoolean("outdir");
+	string outdir = getString("outdir");
+	if (outdirQ) {
+		// Input files with the same name in different directories would
+		// overwrite each other in the output directory:
+		map<string, int> outnames;
+		for (int i=0; i<(int)files.size(); i++) {
+			string outname = getOutputFilename(files[i]);
+			auto it = outnames.find(outname);
+			if (it != outnames.end()) {
+				m_error_text << files[i] << ":\tSame output file as "
+				             << files[it->second] << ": " << outdir << "/"
+				             << outname << endl;
+				status = false;
+			} else {
+				outnames[outname] = i;
+			}
+		}
+	}
+	if (!status) {
+		return false;
+	}
+
+	std::mutex mutex;
+	std::condition_variable turn;
+	int readindex  = 0;
+	int writeindex = 0;
+	map<int, string> errors;
+
+	auto worker = [&]() {
+		xml_document doc;
+		vector<char> buffer;
+		while (true) {
+			int index;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (readindex >= (int)files.size()) {
+					break;
+				}
+				index = readindex++;
+			}
+
+			Tool_musicxml2hum converter;
+			converter.process(argv());
+			stringstream output;
+			bool status = converter.convertFile(output, files[index].c_str(),
+					doc, buffer);
+			string error;
+			if (!status) {
+				error = converter.getError();
+				if (error.empty()) {
+					error = "Could not convert file";
+				}
+			} else if (outdirQ) {
+				string outname = outdir + "/" + getOutputFilename(files[index]);
+				std::ofstream outfile(outname, std::ios::binary);
+				outfile << output.str();
+				outfile.close();
+				if (!outfile) {
+					error = "Cannot write file: " + outname;
+					status = false;
+				}
+			}
+			while (!error.empty() && std::isspace(error.back())) {
+				error.pop_back();
+			}
+			for (int i=0; i<(int)error.size(); i++) {
+				if (error[i] == '\n') {
+					error[i] = ' ';
+				}
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			if (!status) {
+				errors[index] = error;
+			}
+			if (!outdirQ) {
+				turn.wait(lock, [&]() { return writeindex == index; });
+				if (status) {
+					out << "!!!!SEGMENT: " << getOutputFilename(files[index]) << "\n";
+					out << output.str();
+				}
+				writeindex++;
+				turn.notify_all();
+			}
+		}
+	};
+
+	int threads = getThreadCount();
+	if (threads <= 1) {
+		worker();
+	} else {
+		vector<std::thread> pool;
+		for (int i=0; i<threads; i++) {
+			pool.emplace_back(worker);
+		}
+		for (int i=0; i<(int)pool.size(); i++) {
+			pool[i].join();
+		}
+	}
+
+	for (auto& it : errors) {
+		m_error_text << files[it.first] << ":\t" << it.second << endl;
+	}
+	return errors.empty();
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::getInputFiles -- Add a file to the list of files to
+//   convert, or the MusicXML files (.xml and .musicxml) in a directory
+//   sorted by name.  Subdirectories are not searched.  Reading
+//   directories is not implemented for Windows, so directories given
+//   as input files are reported as errors there.  Returns false if the
+//   path cannot be added.
+//
+
+bool Tool_musicxml2hum::getInputFiles(vector<string>& files,
+		const string& path) {
+#ifdef _WIN32
+	struct _stat info;
+	if ((_stat(path.c_str(), &info) == 0) && (info.st_mode & _S_IFDIR)) {
+		m_error_text << path << ":\tDirectory input is not supported on Windows"
+		             << endl;
+		return false;
+	}
+#else
+	struct stat info;
+	if ((stat(path.c_str(), &info) == 0) && S_ISDIR(info.st_mode)) {
+		DIR* dir = opendir(path.c_str());
+		if (!dir) {
+			m_error_text << path << ":\tCannot read directory" << endl;
+			return false;
+		}
+		vector<string> names;
+		struct dirent* entry;
+		while ((entry = readdir(dir)) != NULL) {
+			string name = entry->d_name;
+			size_t dot = name.rfind('.');
+			if ((dot == string::npos) || (dot == 0)) {
+				continue;
+			}
+			string extension = name.substr(dot);
+			if ((extension == ".xml") || (extension == ".musicxml")) {
+				names.push_back(name);
+			}
+		}
+		closedir(dir);
+		sort(names.begin(), names.end());
+		for (int i=0; i<(int)names.size(); i++) {
+			files.push_back(path + "/" + names[i]);
+		}
+		return true;
+	}
+#endif
+	files.push_back(path);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::getOutputFilename -- Return the filename without
+//   the directory and with a .krn extension instead of the original one.
+//
+
+string Tool_musicxml2hum::getOutputFilename(const string& filename) {
+	string output = filename;
+	size_t slash = output.find_last_of("/\\");
+	if (slash != string::npos) {
+		output = output.substr(slash + 1);
+	}
+	size_t dot = output.rfind('.');
+	if ((dot != string::npos) && (dot > 0)) {
+		output.resize(dot);
+	}
+	output += ".krn";
+	return output;
+}
+
+
+
 
 /////////////////////////////////
 //
@@ -80417,6 +86330,7 @@ Tool_myank::Tool_myank(void) {
 	define("version=b",       "Program version");
 	define("example=b",       "Program examples");
 	define("h|help=b",        "Short description");
+	defineThreadOption();
 }
 
 
@@ -82813,6 +88727,22 @@ Tool_pccount::Tool_pccount(void) {
 	define("title=s", "Title for plot");
 	define("t|template|vega-template=b", "display the vega-lite template.");
 	define("w|width=i:400", "width of vega-lite plot");
+	define("csv=b", "print pitch-class profiles as CSV");
+	define("binary=b", "write pitch-class profiles in packed binary format");
+	define("measures=b", "print CSV/binary profiles for each measure");
+	defineThreadOption();
+}
+
+
+
+///////////////////////////////
+//
+// Tool_pccount::isBatchMode -- True if the profiles of all input files
+//     should be printed as a single CSV or binary stream.
+//
+
+bool Tool_pccount::isBatchMode(void) {
+	return getBoolean("csv") || getBoolean("binary");
 }
 
 
@@ -82850,6 +88780,78 @@ bool Tool_pccount::run(HumdrumFile& infile) {
 }
 
 
+//
+// Streaming interface for CSV (default) or --binary profiles of a corpus.
+// Files are parsed and counted by a pool of -j threads (see
+// runStreamPool()), each with its own copy of the tool.  The profiles of
+// each file are written to the output in input order.  The corpus totals
+// for each part index (with partial sums kept by each copy of the tool)
+// are written at the end with the filename "*".
+//
+
+bool Tool_pccount::run(HumdrumFileStream& instream, ostream& out) {
+	m_attack   = getBoolean("attacks");
+	m_binary   = getBoolean("binary");
+	m_csv      = !m_binary;
+	m_measures = getBoolean("measures");
+	if (m_binary) {
+		writeBinaryHeader(out);
+	} else {
+		printCsvHeader(out);
+	}
+
+	bool csv      = m_csv;
+	bool binary   = m_binary;
+	bool measures = m_measures;
+	auto process = [csv, binary, measures](Tool_pccount& tool,
+			HumdrumFileSet& infiles, StreamSegmentResult& result) {
+		HumdrumFile& infile = infiles[0];
+		tool.initialize(infile);
+		tool.m_csv    = csv;
+		tool.m_binary = binary;
+		tool.countPitches(infile);
+		if (measures) {
+			tool.countMeasures(infile);
+		}
+		stringstream block;
+		tool.printProfiles(block, infile.getFilename());
+		result.text = block.str();
+		addTotals(tool.m_totals, tool.m_counts);
+	};
+
+	vector<vector<double>> totals;
+	auto finish = [&totals](Tool_pccount& tool) {
+		addTotals(totals, tool.m_totals);
+	};
+
+	int status = runStreamPool<Tool_pccount>(instream, argv(),
+			getThreadCount(), out, process, finish);
+
+	printTotals(out, totals);
+	return status == 0;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::addTotals -- Add pitch-class counts to totals, indexed
+//     by part.
+//
+
+void Tool_pccount::addTotals(vector<vector<double>>& totals,
+		const vector<vector<double>>& counts) {
+	if (totals.size() < counts.size()) {
+		totals.resize(counts.size(), vector<double>(40, 0.0));
+	}
+	for (int i=0; i<(int)counts.size(); i++) {
+		for (int j=0; j<(int)counts[i].size(); j++) {
+			totals[i][j] += counts[i][j];
+		}
+	}
+}
+
+
 
 //////////////////////////////
 //
@@ -82873,6 +88875,9 @@ void Tool_pccount::initialize(HumdrumFile& infile) {
 	}
 	m_html       = getBoolean("html");
 	m_page       = getBoolean("page");
+	m_csv        = getBoolean("csv");
+	m_binary     = getBoolean("binary");
+	m_measures   = getBoolean("measures");
 	if (getBoolean("id")) {
 		m_id = getString("id");
 	} else {
@@ -82996,7 +89001,17 @@ void Tool_pccount::processFile(HumdrumFile& infile) {
 		jsonvar = "vega_" + m_id + "_dur";
 	}
 
-	if (m_template) {
+	if (m_csv || m_binary) {
+		if (m_measures) {
+			countMeasures(infile);
+		}
+		if (m_binary) {
+			writeBinaryHeader(m_free_text);
+		} else {
+			printCsvHeader(m_free_text);
+		}
+		printProfiles(m_free_text, infile.getFilename());
+	} else if (m_template) {
 		printVegaLiteJsonTemplate(datavar, infile);
 	} else if (m_data) {
 		printVegaLiteJsonData();
@@ -83294,31 +89309,343 @@ void Tool_pccount::addCounts(HTp sstart, HTp send) {
 			current = current->getNextToken();
 			continue;
 		}
-		if (current->isNull() || current->isRest()) {
-			current = current->getNextToken();
+		addTokenCounts(current, m_counts[kindex].data());
+		current = current->getNextToken();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::addTokenCounts -- Add the pitch classes of a **kern data
+//     token (durations, or attacks if -a is used) to a list of 40 counts.
+//
+
+void Tool_pccount::addTokenCounts(HTp token, double* counts) {
+	if (token->isNull() || token->isRest()) {
+		return;
+	}
+	if (token->find(' ') == string::npos) {
+		addSubtokenCounts(*token, counts);
+		return;
+	}
+	vector<string> subtokens = token->getSubtokens();
+	for (int i=0; i<(int)subtokens.size(); i++) {
+		addSubtokenCounts(subtokens[i], counts);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::addSubtokenCounts -- Add the pitch class of a single note.
+//
+
+void Tool_pccount::addSubtokenCounts(const string& subtoken, double* counts) {
+	if (m_attack) {
+		// ignore sustained parts of notes when counting attacks
+		if (subtoken.find("_") != string::npos) {
+			return;
+		}
+		if (subtoken.find("]") != string::npos) {
+			return;
+		}
+	}
+	int b40 = Convert::kernToBase40(subtoken);
+	if (b40 < 0) {
+		return;
+	}
+	if (m_attack) {
+		counts[b40%40]++;
+	} else {
+		counts[b40%40] += Convert::recipToDuration(subtoken).getFloat();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::countMeasures -- Count pitch classes separately for each
+//     measure.  A new measure starts at each barline with a new bar number
+//     (so unnumbered barlines do not split measures).  Notes before the
+//     first numbered barline are in measure 0.  The counts for all parts
+//     are stored in part 0 as in countPitches().
+//
+
+void Tool_pccount::countMeasures(HumdrumFile& infile) {
+	m_measurecounts.clear();
+	m_measurenums.clear();
+	int parts = (int)m_parttracks.size();
+	if (parts == 0) {
+		return;
+	}
+	int size = parts * 40;
+	vector<int> barnums = infile.getMeasureNumbers();
+	int lastnum = -1;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		int num = barnums[i] < 0 ? 0 : barnums[i];
+		if (num != lastnum) {
+			m_measurenums.push_back(num);
+			m_measurecounts.resize(m_measurecounts.size() + size, 0.0);
+			lastnum = num;
+		}
+		if (!infile[i].isData()) {
 			continue;
 		}
-		vector<string> subtokens = current->getSubtokens();
-		for (int i=0; i<(int)subtokens.size(); i++) {
-			if (m_attack) {
-				// ignore sustained parts of notes when counting attacks
-				if (subtokens[i].find("_") != string::npos) {
-					continue;
+		double* counts = m_measurecounts.data() + m_measurecounts.size() - size;
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (!token->isKern()) {
+				continue;
+			}
+			int kindex = m_rkern[token->getTrack()];
+			if (kindex < 0) {
+				continue;
+			}
+			addTokenCounts(token, counts + kindex * 40);
+		}
+	}
+
+	// fill in sum for all parts
+	for (int m=0; m<(int)m_measurenums.size(); m++) {
+		double* counts = m_measurecounts.data() + m * size;
+		for (int j=1; j<parts; j++) {
+			for (int i=0; i<40; i++) {
+				counts[i] += counts[j * 40 + i];
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::printProfiles -- Print the pitch-class counts of the
+//     current file for each part (and all parts as part 0), either for the
+//     whole file or for each measure if --measures is used.  Measures
+//     without notes are not printed.  Only the 35 valid base-40 pitch
+//     classes are included.
+//
+
+void Tool_pccount::printProfiles(ostream& out, const string& filename) {
+	int parts = (int)m_counts.size();
+	vector<int> measures;
+	vector<double> counts;
+	if (m_measures) {
+		for (int m=0; m<(int)m_measurenums.size(); m++) {
+			const double* mcounts = m_measurecounts.data() + m * parts * 40;
+			bool empty = true;
+			for (int i=0; i<40; i++) {
+				if (mcounts[i] != 0.0) {
+					empty = false;
+					break;
 				}
-				if (subtokens[i].find("]") != string::npos) {
+			}
+			if (empty) {
+				continue;
+			}
+			measures.push_back(m_measurenums[m]);
+			counts.insert(counts.end(), mcounts, mcounts + parts * 40);
+		}
+	} else {
+		measures.push_back(-1);
+		for (int i=0; i<parts; i++) {
+			counts.insert(counts.end(), m_counts[i].begin(), m_counts[i].end());
+		}
+	}
+
+	vector<string> names(parts);
+	for (int i=0; i<parts; i++) {
+		if (i < (int)m_names.size()) {
+			names[i] = m_names[i];
+		}
+	}
+
+	if (m_binary) {
+		writeBinaryBlock(out, filename, names, measures, counts);
+		return;
+	}
+	for (int m=0; m<(int)measures.size(); m++) {
+		for (int i=0; i<parts; i++) {
+			printCsvRow(out, filename, measures[m], i, names[i],
+					counts.data() + (m * parts + i) * 40);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::printTotals -- Print the sum of all counts in a corpus by
+//     part index.  The filename is "*".
+//
+
+void Tool_pccount::printTotals(ostream& out, vector<vector<double>>& totals) {
+	vector<string> names(totals.size());
+	vector<double> counts;
+	for (int i=0; i<(int)totals.size(); i++) {
+		counts.insert(counts.end(), totals[i].begin(), totals[i].end());
+	}
+	if (!names.empty()) {
+		names[0] = "all";
+	}
+	if (m_binary) {
+		writeBinaryBlock(out, "*", names, vector<int>(1, -1), counts);
+		return;
+	}
+	for (int i=0; i<(int)totals.size(); i++) {
+		printCsvRow(out, "*", -1, i, names[i], counts.data() + i * 40);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::printCsvHeader -- The columns are the filename, the
+//     measure (empty for counts of the whole file), the part index (0
+//     for all parts), the part name, and then the counts for each pitch
+//     class as **kern pitches from c-- to b##.
+//
+
+void Tool_pccount::printCsvHeader(ostream& out) {
+	out << "file,measure,part,name";
+	for (int i=0; i<40; i++) {
+		if ((i == 5) || (i == 11) || (i == 22) || (i == 28) || (i == 34)) {
+			continue;
+		}
+		out << "," << Convert::base40ToKern(i + 4*40);
+	}
+	out << "\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::printCsvRow --
+//
+
+void Tool_pccount::printCsvRow(ostream& out, const string& filename,
+		int measure, int part, const string& name, const double* counts) {
+	std::streamsize precision = out.precision(12);
+	out << getCsvField(filename) << ",";
+	if (measure >= 0) {
+		out << measure;
+	}
+	out << "," << part << "," << getCsvField(name);
+	for (int i=0; i<40; i++) {
+		if ((i == 5) || (i == 11) || (i == 22) || (i == 28) || (i == 34)) {
+			continue;
+		}
+		out << ",";
+		if (counts[i] != 0.0) {
+			out << counts[i];
+		} else {
+			out << "0";
+		}
+	}
+	out << "\n";
+	out.precision(precision);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::getCsvField -- Quote a CSV field if necessary.
+//
+
+string Tool_pccount::getCsvField(const string& value) {
+	if (value.find_first_of(",\"\n\r") == string::npos) {
+		return value;
+	}
+	string output = "\"";
+	for (int i=0; i<(int)value.size(); i++) {
+		if (value[i] == '"') {
+			output += '"';
+		}
+		output += value[i];
+	}
+	output += '"';
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::writeBinaryHeader -- Write the header of the binary
+//    profile format.  All values are little-endian.  The 16-byte header is:
+//
+//       0  char[8]  "HUMPCCNT"
+//       8  uint16   format version (1)
+//      10  uint16   flags (bit 0: attack counts, bit 1: measure profiles)
+//      12  uint16   number of pitch classes in a profile (35)
+//      14  uint16   reserved (0)
+//
+//    Each file is then a block:
+//
+//       uint32  length of the filename, followed by the filename
+//       uint32  number of parts (P), including all parts as part 0
+//       P x     uint32 length of part name, followed by the name
+//       uint32  number of rows (R)
+//       R x     int32 measure (-1 for the whole file), followed by
+//               P x 35 float64 counts (part by part, c-- to b##)
+//
+//    The corpus totals are a final block with the filename "*".
+//
+
+void Tool_pccount::writeBinaryHeader(ostream& out) {
+	string header = "HUMPCCNT";
+	Convert::appendLittleEndian(header, 1, 2);
+	Convert::appendLittleEndian(header, (m_attack ? 1 : 0) | (m_measures ? 2 : 0), 2);
+	Convert::appendLittleEndian(header, 35, 2);
+	Convert::appendLittleEndian(header, 0, 2);
+	out.write(header.data(), header.size());
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::writeBinaryBlock -- Write the profiles for a file.
+//
+
+void Tool_pccount::writeBinaryBlock(ostream& out, const string& filename,
+		const vector<string>& names, const vector<int>& measures,
+		const vector<double>& counts) {
+	int parts = (int)names.size();
+	string buffer;
+	buffer.reserve(32 + filename.size() + measures.size() * (4 + parts * 35 * 8));
+	Convert::appendLittleEndian(buffer, filename.size(), 4);
+	buffer += filename;
+	Convert::appendLittleEndian(buffer, parts, 4);
+	for (int i=0; i<parts; i++) {
+		Convert::appendLittleEndian(buffer, names[i].size(), 4);
+		buffer += names[i];
+	}
+	Convert::appendLittleEndian(buffer, measures.size(), 4);
+	for (int m=0; m<(int)measures.size(); m++) {
+		Convert::appendLittleEndian(buffer, (uint32_t)measures[m], 4);
+		for (int i=0; i<parts; i++) {
+			const double* pcounts = counts.data() + (m * parts + i) * 40;
+			for (int j=0; j<40; j++) {
+				if ((j == 5) || (j == 11) || (j == 22) || (j == 28) || (j == 34)) {
 					continue;
 				}
-			}
-			int b40 = Convert::kernToBase40(subtokens[i]);
-			if (m_attack) {
-				m_counts[kindex][b40%40]++;
-			} else {
-				double duration = Convert::recipToDuration(subtokens[i]).getFloat();
-				m_counts[kindex][b40%40] += duration;
+				uint64_t value;
+				std::memcpy(&value, pcounts + j, sizeof(value));
+				Convert::appendLittleEndian(buffer, value, 8);
 			}
 		}
-		current = current->getNextToken();
 	}
+	out.write(buffer.data(), buffer.size());
 }
 
 
@@ -83705,6 +90032,7 @@ Tool_periodicity::Tool_periodicity(void) {
 	define("s|svg=b", "output svg image");
 	define("p|power=d:2.0", "scaling power for visual display");
 	define("1|one=b", "composite rhythms are not weighted by attack");
+	defineThreadOption();
 }
 
 
@@ -83813,13 +90141,25 @@ void Tool_periodicity::printPeriodicityAnalysis(ostream& out, vector<vector<doub
 
 //////////////////////////////
 //
-// Tool_periodicity::doPeriodicAnalysis --
+// Tool_periodicity::doPeriodicAnalysis -- Only the attack positions of the
+//     grid contribute to the analysis, so these are extracted once and
+//     folded into each period, which is much faster than scanning the
+//     full grid for each period when minrhy is small compared to the
+//     note durations.
 //
 
 void Tool_periodicity::doPeriodicityAnalysis(vector<vector<double>> &analysis, vector<double>& grid, HumNum minrhy) {
+	vector<int> positions;
+	vector<double> weights;
+	for (int i=0; i<(int)grid.size(); i++) {
+		if (grid[i] != 0.0) {
+			positions.push_back(i);
+			weights.push_back(grid[i]);
+		}
+	}
 	analysis.resize(minrhy.getNumerator());
 	for (int i=0; i<(int)analysis.size(); i++) {
-		doAnalysis(analysis, i, grid);
+		doAnalysis(analysis, i, positions, weights);
 	}
 }
 
@@ -83827,19 +90167,20 @@ void Tool_periodicity::doPeriodicityAnalysis(vector<vector<double>> &analysis, v
 
 //////////////////////////////
 //
-// Tool_periodicity::doAnalysis --
+// Tool_periodicity::doAnalysis -- Sum the attacks at each phase of the
+//     period for the given level.  positions are the grid indexes of the
+//     attacks (in increasing order) and weights are the grid values at
+//     those positions.
 //
 
-void Tool_periodicity::doAnalysis(vector<vector<double>>& analysis, int level, vector<double>& grid) {
+void Tool_periodicity::doAnalysis(vector<vector<double>>& analysis, int level,
+		vector<int>& positions, vector<double>& weights) {
 	int period = level + 1;
 	analysis[level].resize(period);
 	std::fill(analysis[level].begin(), analysis[level].end(), 0.0);
-	for (int i=0; i<period; i++) {
-		int j = i;
-		while (j < (int)grid.size()) {
-			analysis[level][i] += grid[j];
-			j += period;
-		}
+	double* sums = analysis[level].data();
+	for (int i=0; i<(int)positions.size(); i++) {
+		sums[positions[i] % period] += weights[i];
 	}
 }
 
@@ -83890,6 +90231,9 @@ void Tool_periodicity::fillAttackGrids(HumdrumFile& infile, vector<vector<double
 		grids[t].resize(elements.getNumerator());
 	}
 
+	// grids[0] is the composite rhythm of all tracks, which is either
+	// the number of attacks at each position or 1 if there are any.
+	bool oneQ = getBoolean("one");
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].isData()) {
 			continue;
@@ -83908,20 +90252,10 @@ void Tool_periodicity::fillAttackGrids(HumdrumFile& infile, vector<vector<double
 			}
 			int track = token->getTrack();
 			grids.at(track).at(position.getNumerator()) += 1;
-		}
-	}
-
-	bool oneQ = getBoolean("one");
-	for (int j=0; j<(int)grids.at(0).size(); j++) {
-		grids.at(0).at(j) = 0;
-		for (int i=0; i<(int)grids.size(); i++) {
-			if (!grids.at(i).at(j)) {
-				continue;
-			}
 			if (oneQ) {
-				grids.at(0).at(j) = 1;
+				grids.at(0).at(position.getNumerator()) = 1;
 			} else {
-				grids.at(0).at(j) += grids.at(i).at(j);
+				grids.at(0).at(position.getNumerator()) += 1;
 			}
 		}
 	}
@@ -84481,6 +90815,7 @@ Tool_pnum::Tool_pnum(void) {
 	define("r|rest=s:0",         "representation string for rests");
 	define("R|no-rests=b",       "do not include rests in conversion");
 	define("x|attacks-only=b",   "only mark lines with note attacks");
+	defineThreadOption();
 }
 
 
@@ -84711,6 +91046,7 @@ Tool_recip::Tool_recip(void) {
 	define("e|exinterp=s:**recip",   "use the given exinterp for data output");
 	define("n|kern-pitch=s:e",       "note to add for '-e kern' option");
 	define("kern=b",                 "equivalent to '-e kern' option");
+	defineThreadOption();
 }
 
 
@@ -84942,6 +91278,7 @@ void Tool_recip::initialize(HumdrumFile& infile) {
 Tool_restfill::Tool_restfill(void) {
 	define("y|hidden-rests=b",        "hide inserted rests");
 	define("i|exinterp=s:kern",       "type of spine to fill with rests");
+	defineThreadOption();
 }
 
 
@@ -85198,6 +91535,7 @@ Tool_rid::Tool_rid(void) {
    define("M|all-barlines=b", "remove measure lines");
    define("C|all-comments=b", "remove all comment lines");
    define("c=b", "remove global and local comment lines");
+   defineThreadOption();
 }
 
 
@@ -85479,8 +91817,9 @@ void Tool_ruthfix::insertCrossBarTies(HumdrumFile& infile) {
 	int scount = infile.getStrandCount();
 	if (scount == 0) {
 		// The input file was not read from a file but was created
-		// dynamically.  The easiest thing to do is to reload to get the
-		// spine/strand information.
+		// dynamically and not analyzed (see
+		// HumdrumFileStructure::analyzeFromTokens()).  The easiest thing
+		// to do is to reload to get the spine/strand information.
 		stringstream ss;
 		infile.createLinesFromTokens();
 		ss << infile;
@@ -85557,6 +91896,7 @@ void Tool_ruthfix::createTiedNote(HTp left, HTp right) {
 
 Tool_satb2gs::Tool_satb2gs(void) {
 	// no options
+	defineThreadOption();
 }
 
 
@@ -86187,6 +92527,7 @@ Tool_scordatura::Tool_scordatura(void) {
 	define("d|diatonic=i:0", "diatonic interval of marked pitches");
 	define("color=s", "color marked pitches");
 	define("string=s", "string number");
+	defineThreadOption();
 }
 
 
@@ -86710,6 +93051,7 @@ Tool_semitones::Tool_semitones(void) {
 	define("s|step=b", "highlight notes that have step-wise motion");
 	define("u|up=b", "highlight notes that that have a positive semitone interval");
 	define("x|exclude=s", "exclude **kern tokens with given pattern");
+	defineThreadOption();
 }
 
 
@@ -87413,6 +93755,7 @@ Tool_shed::Tool_shed(void) {
 	define("X=s", "defineable exclusive interpretation x");
 	define("Y=s", "defineable exclusive interpretation y");
 	define("Z=s", "defineable exclusive interpretation z");
+	defineThreadOption();
 }
 
 
@@ -88164,6 +94507,7 @@ Tool_sic::Tool_sic(void) {
 	define("r|remove=b", "remove sic layout tokens");
 	define("v|verbose=b", "add verbose parameter");
 	define("q|quiet=b", "remove verbose parameter");
+	defineThreadOption();
 }
 
 
@@ -88843,6 +95187,171 @@ double MeasureDataSet::getScoreDuration(void) {
 
 
 
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::MeasureHistogramMatrix --
+//
+
+MeasureHistogramMatrix::MeasureHistogramMatrix(void) {
+	// do nothing
+}
+
+
+MeasureHistogramMatrix::MeasureHistogramMatrix(MeasureDataSet& set) {
+	load(set);
+}
+
+
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::~MeasureHistogramMatrix --
+//
+
+MeasureHistogramMatrix::~MeasureHistogramMatrix() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::clear --
+//
+
+void MeasureHistogramMatrix::clear(void) {
+	m_values.clear();
+	m_state.clear();
+	m_size = 0;
+	m_set = NULL;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::load -- Center each measure's pitch-class
+//    histogram on its mean and scale it to unit length.  Measures with
+//    no notes are marked EMPTY, and measures with the same duration for
+//    every pitch class (no variance) are marked FLAT.
+//
+
+void MeasureHistogramMatrix::load(MeasureDataSet& set) {
+	m_set = &set;
+	m_size = set.size();
+	m_values.assign(7 * m_size, 0.0);
+	m_state.assign(m_size, EMPTY);
+	double centered[7];
+	for (int i=0; i<m_size; i++) {
+		if (set[i].getSum7pc() == 0.0) {
+			continue;
+		}
+		std::vector<double>& hist = set[i].getHistogram7pc();
+		double mean = 0.0;
+		for (int k=0; k<7; k++) {
+			mean += hist[k];
+		}
+		mean /= 7.0;
+		double sumsq = 0.0;
+		for (int k=0; k<7; k++) {
+			centered[k] = hist[k] - mean;
+			sumsq += centered[k] * centered[k];
+		}
+		if (sumsq == 0.0) {
+			m_state[i] = FLAT;
+			continue;
+		}
+		double scale = 1.0 / sqrt(sumsq);
+		for (int k=0; k<7; k++) {
+			m_values[k * m_size + i] = centered[k] * scale;
+		}
+		m_state[i] = NORMAL;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::getRow -- Return the normalized values of the
+//    given pitch class for all measures.
+//
+
+const double* MeasureHistogramMatrix::getRow(int pc) const {
+	return m_values.data() + pc * m_size;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::correlateRow -- Store the correlations between
+//    measure "index" and measures startcol to stopcol-1 of "other" in
+//    output.  The results are the same as MeasureComparison::compare()
+//    up to floating-point error.  Values close to halfway between two
+//    printed (two-decimal) values are calculated again as in compare()
+//    so that they print the same.
+//
+
+void MeasureHistogramMatrix::correlateRow(const MeasureHistogramMatrix& other,
+		int index, int startcol, int stopcol, double* output) const {
+	int count = stopcol - startcol;
+	int state = m_state[index];
+
+	if (state == EMPTY) {
+		for (int j=0; j<count; j++) {
+			output[j] = other.m_state[startcol + j] == EMPTY ? 1.0 : 0.0;
+		}
+		return;
+	}
+	if (state == FLAT) {
+		for (int j=0; j<count; j++) {
+			output[j] = other.m_state[startcol + j] == EMPTY ? 0.0 : NAN;
+		}
+		return;
+	}
+
+	const double a0 = m_values[0 * m_size + index];
+	const double a1 = m_values[1 * m_size + index];
+	const double a2 = m_values[2 * m_size + index];
+	const double a3 = m_values[3 * m_size + index];
+	const double a4 = m_values[4 * m_size + index];
+	const double a5 = m_values[5 * m_size + index];
+	const double a6 = m_values[6 * m_size + index];
+	const double* b0 = other.getRow(0) + startcol;
+	const double* b1 = other.getRow(1) + startcol;
+	const double* b2 = other.getRow(2) + startcol;
+	const double* b3 = other.getRow(3) + startcol;
+	const double* b4 = other.getRow(4) + startcol;
+	const double* b5 = other.getRow(5) + startcol;
+	const double* b6 = other.getRow(6) + startcol;
+	for (int j=0; j<count; j++) {
+		output[j] = a0 * b0[j] + a1 * b1[j] + a2 * b2[j] + a3 * b3[j]
+				+ a4 * b4[j] + a5 * b5[j] + a6 * b6[j];
+	}
+
+	const char* states = other.m_state.data() + startcol;
+	for (int j=0; j<count; j++) {
+		if (states[j] == EMPTY) {
+			output[j] = 0.0;
+		} else if (states[j] == FLAT) {
+			output[j] = NAN;
+		} else if (fabs(output[j] - 1.0) < 0.00000001) {
+			output[j] = 1.0;
+		} else {
+			double scaled = fabs(output[j]) * 100.0;
+			if (fabs(scaled - floor(scaled) - 0.5) < 0.000001) {
+				MeasureComparison comparison((*m_set)[index],
+						(*other.m_set)[startcol + j]);
+				output[j] = comparison.getCorrelation7pc();
+			}
+		}
+	}
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 
 //////////////////////////////
@@ -88971,35 +95480,217 @@ MeasureComparisonGrid::~MeasureComparisonGrid() {
 
 void MeasureComparisonGrid::clear(void) {
 	m_grid.clear();
+	m_matches.clear();
+	m_rows = 0;
+	m_cols = 0;
 }
 
 
 
 //////////////////////////////
 //
-// MeasureComparisonGrid::analyze --
+// runMeasureBlocks -- Call worker(block) for each block from 0 to
+//    blocks-1, using the given number of threads.
 //
 
-void MeasureComparisonGrid::analyze(MeasureDataSet* set1, MeasureDataSet* set2) {
-	analyze(*set1, *set2);
+template <class WORKER>
+static void runMeasureBlocks(int blocks, int threads, WORKER worker) {
+	if (threads > blocks) {
+		threads = blocks;
+	}
+	if (threads <= 1) {
+		for (int i=0; i<blocks; i++) {
+			worker(i);
+		}
+		return;
+	}
+	std::atomic<int> next(0);
+	auto loop = [&]() {
+		int block;
+		while ((block = next++) < blocks) {
+			worker(block);
+		}
+	};
+	std::vector<std::thread> pool;
+	for (int i=0; i<threads; i++) {
+		pool.emplace_back(loop);
+	}
+	for (int i=0; i<(int)pool.size(); i++) {
+		pool[i].join();
+	}
 }
 
-void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2) {
-	m_grid.resize(set1.size());
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		m_grid[i].resize(set2.size());
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::analyze -- Calculate the correlation between
+//    every measure in set1 and every measure in set2.  The grid is
+//    calculated in tiles of rows and columns so that the histograms for
+//    a range of columns are reused while they are in the cache, and
+//    tiles of rows are distributed over the given number of threads.
+//    default value: threads = 1
+//
+
+void MeasureComparisonGrid::analyze(MeasureDataSet* set1, MeasureDataSet* set2,
+		int threads) {
+	analyze(*set1, *set2, threads);
+}
+
+void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2,
+		int threads) {
+	clear();
+	MeasureHistogramMatrix matrix1(set1);
+	MeasureHistogramMatrix matrix2;
+	if (&set1 != &set2) {
+		matrix2.load(set2);
 	}
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			m_grid[i][j].compare(set1[i], set2[j]);
+	const MeasureHistogramMatrix& columns = (&set1 == &set2) ? matrix1 : matrix2;
+
+	m_rows = matrix1.size();
+	m_cols = columns.size();
+	m_grid.resize((size_t)m_rows * m_cols);
+
+	const int rowtile = 32;
+	const int coltile = 1024;
+	int blocks = (m_rows + rowtile - 1) / rowtile;
+	runMeasureBlocks(blocks, threads, [&](int block) {
+		int startrow = block * rowtile;
+		int stoprow = std::min(startrow + rowtile, m_rows);
+		for (int c=0; c<m_cols; c+=coltile) {
+			int stopcol = std::min(c + coltile, m_cols);
+			for (int i=startrow; i<stoprow; i++) {
+				matrix1.correlateRow(columns, i, c, stopcol,
+						m_grid.data() + (size_t)i * m_cols + c);
+			}
 		}
+	});
+
+	m_set1 = &set1;
+	m_set2 = &set2;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::analyzeTopMatches -- Find the count most
+//    similar measures in set2 for each measure in set1, without storing
+//    the full correlation grid.  Each row keeps a heap of its best
+//    matches while the columns are scanned.  Ties are resolved in favor
+//    of the earlier measure, and measures which have an undefined
+//    correlation are skipped.  If skipdiagonal is true, a measure is
+//    not compared to the measure with the same index (for comparing a
+//    score to itself).
+//    default value: skipdiagonal = false
+//    default value: threads = 1
+//
+
+void MeasureComparisonGrid::analyzeTopMatches(MeasureDataSet& set1,
+		MeasureDataSet& set2, int count, bool skipdiagonal, int threads) {
+	clear();
+	MeasureHistogramMatrix matrix1(set1);
+	MeasureHistogramMatrix matrix2;
+	if (&set1 != &set2) {
+		matrix2.load(set2);
 	}
+	const MeasureHistogramMatrix& columns = (&set1 == &set2) ? matrix1 : matrix2;
+
+	m_rows = matrix1.size();
+	m_cols = columns.size();
+	m_matches.resize(m_rows);
+	if (count <= 0) {
+		m_set1 = &set1;
+		m_set2 = &set2;
+		return;
+	}
+
+	// better(a, b): a is a better match than b (for heap ordering the
+	// worst match is at the front of the heap).
+	auto better = [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+		if (a.first != b.first) {
+			return a.first > b.first;
+		}
+		return a.second < b.second;
+	};
+
+	const int rowtile = 32;
+	const int coltile = 1024;
+	int blocks = (m_rows + rowtile - 1) / rowtile;
+	runMeasureBlocks(blocks, threads, [&](int block) {
+		int startrow = block * rowtile;
+		int stoprow = std::min(startrow + rowtile, m_rows);
+		std::vector<double> buffer(coltile);
+		std::vector<std::vector<std::pair<double, int>>> heaps(stoprow - startrow);
+		for (int c=0; c<m_cols; c+=coltile) {
+			int stopcol = std::min(c + coltile, m_cols);
+			for (int i=startrow; i<stoprow; i++) {
+				matrix1.correlateRow(columns, i, c, stopcol, buffer.data());
+				std::vector<std::pair<double, int>>& heap = heaps[i - startrow];
+				for (int j=c; j<stopcol; j++) {
+					double value = buffer[j - c];
+					if (std::isnan(value)) {
+						continue;
+					}
+					if (skipdiagonal && (i == j)) {
+						continue;
+					}
+					std::pair<double, int> entry(value, j);
+					if ((int)heap.size() < count) {
+						heap.push_back(entry);
+						std::push_heap(heap.begin(), heap.end(), better);
+					} else if (better(entry, heap.front())) {
+						std::pop_heap(heap.begin(), heap.end(), better);
+						heap.back() = entry;
+						std::push_heap(heap.begin(), heap.end(), better);
+					}
+				}
+			}
+		}
+		for (int i=startrow; i<stoprow; i++) {
+			std::vector<std::pair<double, int>>& heap = heaps[i - startrow];
+			std::sort_heap(heap.begin(), heap.end(), better);
+			m_matches[i].reserve(heap.size());
+			for (int k=0; k<(int)heap.size(); k++) {
+				m_matches[i].emplace_back(heap[k].second, heap[k].first);
+			}
+		}
+	});
+
 	m_set1 = &set1;
 	m_set2 = &set2;
 }
 
 
 
+//////////////////////////////
+//
+// MeasureComparisonGrid::getCorrelation -- Return the correlation between
+//    the given measures of the first and second sets.
+//
+
+double MeasureComparisonGrid::getCorrelation(int index1, int index2) {
+	return m_grid.at((size_t)index1 * m_cols + index2);
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::printCorrelation -- Print a correlation value
+//    rounded to two decimal places.
+//
+
+void MeasureComparisonGrid::printCorrelation(ostream& out, double correl) {
+	if (correl > 0.0) {
+		out << int(correl * 100.0 + 0.5)/100.0;
+	} else {
+		out << -int(-correl * 100.0 + 0.5)/100.0;
+	}
+}
+
+
+
 //////////////////////////////
 //
 // MeasureComparisonGrid::printCorrelationGrid --
@@ -89007,15 +95698,10 @@ void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2)
 //
 
 ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			double correl = m_grid[i][j].getCorrelation7pc();
-			if (correl > 0.0) {
-				out << int(correl * 100.0 + 0.5)/100.0;
-			} else {
-				out << -int(-correl * 100.0 + 0.5)/100.0;
-			}
-			if (j < (int)m_grid[i].size() - 1) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
+			printCorrelation(out, getCorrelation(i, j));
+			if (j < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -89033,18 +95719,10 @@ ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
 //
 
 ostream& MeasureComparisonGrid::printCorrelationDiagonal(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			if (i != j) {
-				continue;
-			}
-			double correl = m_grid[i][j].getCorrelation7pc();
-			if (correl > 0.0) {
-				out << int(correl * 100.0 + 0.5)/100.0;
-			} else {
-				out << -int(-correl * 100.0 + 0.5)/100.0;
-			}
-			if (j < (int)m_grid[i].size() - 1) {
+	for (int i=0; i<m_rows; i++) {
+		if (i < m_cols) {
+			printCorrelation(out, getCorrelation(i, i));
+			if (i < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -89055,6 +95733,28 @@ ostream& MeasureComparisonGrid::printCorrelationDiagonal(ostream& out) {
 
 
 
+//////////////////////////////
+//
+// MeasureComparisonGrid::printTopMatches -- Print the results of
+//    analyzeTopMatches(), one line for each match: the measure number in
+//    the first score, the measure number in the second score and the
+//    correlation between them, with the best matches first.
+//    default value: out = std::cout
+//
+
+ostream& MeasureComparisonGrid::printTopMatches(ostream& out) {
+	for (int i=0; i<(int)m_matches.size(); i++) {
+		for (int k=0; k<(int)m_matches[i].size(); k++) {
+			out << getMeasure1(i) << '\t' << getMeasure2(m_matches[i][k].first) << '\t';
+			printCorrelation(out, m_matches[i][k].second);
+			out << endl;
+		}
+	}
+	return out;
+}
+
+
+
 //////////////////////////////
 //
 // MeasureComparisonGrid::getColorMapping --
@@ -89342,15 +96042,15 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 	double sdur1 = getScoreDuration1();
 	double sdur2 = getScoreDuration2();
 
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
 			width = getDuration2(j) / sdur2 * imagewidth;
 			height = getDuration1(i) / sdur1 * imageheight;
 
 			x = getStartTime2(j)/sdur2 * imageheight;
 			y = getStartTime1(i)/sdur1 * imagewidth;
 
-			getColorMapping(m_grid[i][j].getCorrelation7pc(), hue, saturation, lightness);
+			getColorMapping(getCorrelation(i, j), hue, saturation, lightness);
 			ss << "hsl(" << hue << "," << saturation << "%," << lightness << "%)";
 			crect = grid.append_child("rect");
 			crect.append_attribute("x") = to_string(x).c_str();
@@ -89383,6 +96083,9 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 Tool_simat::Tool_simat(void) {
 	define("r|raw=b", "output raw correlation matrix");
 	define("d|diagonal=b", "output diagonal of correlation matrix");
+	define("k|top=i:0", "list the k most similar measures for each measure");
+	define("threads=i:1", "number of threads for the similarity grid of each file");
+	defineThreadOption();
 }
 
 
@@ -89463,9 +96166,25 @@ bool Tool_simat::run(HumdrumFile& infile1, HumdrumFile& infile2) {
 //
 
 void Tool_simat::processFile(HumdrumFile& infile1, HumdrumFile& infile2) {
+	m_data1.clear();
+	m_data2.clear();
 	m_data1.parse(infile1);
-	m_data2.parse(infile2);
-	m_grid.analyze(m_data1, m_data2);
+	MeasureDataSet* data2 = &m_data1;
+	if (&infile1 != &infile2) {
+		m_data2.parse(infile2);
+		data2 = &m_data2;
+	}
+	int threads = getThreadCount("threads");
+
+	if (getInteger("top") > 0) {
+		m_grid.analyzeTopMatches(m_data1, *data2, getInteger("top"),
+				&infile1 == &infile2, threads);
+		m_grid.printTopMatches(m_free_text);
+		suppressHumdrumFileOutput();
+		return;
+	}
+
+	m_grid.analyze(m_data1, *data2, threads);
 	if (getBoolean("raw")) {
 		m_grid.printCorrelationGrid(m_free_text);
 		suppressHumdrumFileOutput();
@@ -89493,6 +96212,7 @@ Tool_slurcheck::Tool_slurcheck(void) {
 	define("c|count=b", "count unclosed slur endings");
 	define("Z|no-zeros=b", "do not list files that have zero unclosed slurs in counts");
 	define("f|filename=b", "print filename for list and count options");
+	defineThreadOption();
 }
 
 
@@ -89662,6 +96382,7 @@ void Tool_slurcheck::processFile(HumdrumFile& infile) {
 Tool_spinetrace::Tool_spinetrace(void) {
 	define("a|append=b", "append analysis to input data lines");
 	define("p|prepend=b", "prepend analysis to input data lines");
+	defineThreadOption();
 }
 
 
@@ -89777,6 +96498,7 @@ Tool_strophe::Tool_strophe(void) {
 	define("m=b",              "mark strophe music");
 	define("mark|marker=s:@",  "character to mark with");
 	define("c|color=s:red",    "character to mark with");
+	defineThreadOption();
 }
 
 
@@ -89948,6 +96670,7 @@ void Tool_strophe::displayStropheVariants(HumdrumFile& infile) {
 Tool_tabber::Tool_tabber(void) {
 	// do nothing for now.
 	define("r|remove=b",    "remove any extra tabs");
+	defineThreadOption();
 }
 
 
@@ -90038,6 +96761,7 @@ Tool_tassoize::Tool_tassoize(void) {
 
 	define("N|do-not-remove-empty-transpositions=b", "Do not remove empty transposition instructions");
 	define ("n|only-remove-empty-transpositions=b", "Only remove empty transpositions");
+	defineThreadOption();
 }
 
 
@@ -90934,6 +97658,7 @@ Tool_tie::Tool_tie(void) {
 	define("p|printable=b", "merge tied notes only if single note is a printable note.");
 	define("M|mark=b", "Mark overfill notes.");
 	define("i|invisible=b", "Mark overfill barlines invisible.");
+	defineThreadOption();
 }
 
 
@@ -91444,6 +98169,7 @@ Tool_transpose::Tool_transpose(void) {
 	define("version=b",  "compilation info");
 	define("example=b",  "example usages");
 	define("help=b",     "short description");
+	defineThreadOption();
 }
 
 
@@ -93008,6 +99734,7 @@ Tool_tremolo::Tool_tremolo(void) {
 	define("k|keep=b", "Keep tremolo rhythm markup");
 	define("F|no-fill=b", "Do not fill in tremolo spaces");
 	define("T|no-tremolo-interpretation=b", "Do not add *tremolo/*Xtremolo marks");
+	defineThreadOption();
 }
 
 
@@ -93598,6 +100325,7 @@ void Tool_tremolo::storeLastTremoloNoteInfo(HTp token) {
 
 Tool_trillspell::Tool_trillspell(void) {
 	define("x=b", "mark trills with x (interpretation)");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Nov 30 01:02:57 PST 2016
-// Last Modified: Sun May 21 21:11:12 CEST 2017 Ignore non-kern spines when adding beams
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-autobeam.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-autobeam.cpp
 // Syntax:        C++11; humlib
@@ -39,6 +39,7 @@ Tool_autobeam::Tool_autobeam(void) {
 	define("l|lyric|lyrics=b",     "break beam by lyric syllables");
 	define("L|lyric-info=b",       "return the number of breaks needed");
 	define("rest|include-rests=b", "include rests in beam edges");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Dec 26 03:28:25 PST 2010
-// Last Modified: Sun Dec  4 16:15:36 PST 2016 Ported from humextras
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-autostem.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-autostem.cpp
 // Syntax:        C++11; humlib
@@ -48,6 +48,7 @@ Tool_autostem::Tool_autostem(void) {
 	define("version=b",       "Program version");
 	define("example=b",       "Program examples");
 	define("h|help=b",        "Short description");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Mar  4 21:09:10 PST 2018
-// Last Modified: Sun Mar  4 21:09:13 PST 2018
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-binroll.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-binroll.cpp
 // Syntax:        C++11; humlib
@@ -14,6 +14,8 @@
 #include "Convert.h"
 #include "HumRegex.h"
 
+#include <algorithm>
+
 using namespace std;
 
 namespace hum {
@@ -29,6 +31,11 @@ namespace hum {
 Tool_binroll::Tool_binroll(void) {
 	// add options here
 	define("t|timebase=s:16", "timebase to do analysis at");
+	define("b|binary=b",      "output packed binary roll (per voice)");
+	define("r|rle=b",         "run-length compress binary roll");
+	define("low=i:0",         "lowest MIDI pitch in binary roll");
+	define("high=i:127",      "highest MIDI pitch in binary roll");
+	defineThreadOption();
 }
 
 
@@ -71,25 +78,72 @@ bool Tool_binroll::run(HumdrumFile& infile, ostream& out) {
 
 
 bool Tool_binroll::run(HumdrumFile& infile) {
-	m_duration.setValue(1, 4); // 16th note
-	processFile(infile);
+	initialize();
+	processFile(infile, m_free_text);
+	return true;
+}
+
+
+//
+// Streaming interface: each file is written to the output as soon as it
+// has been read, so only one score is kept in memory.
+//
+
+bool Tool_binroll::run(HumdrumFileStream& instream, ostream& out) {
+	initialize();
+	HumdrumFile infile;
+	while (instream.read(infile)) {
+		processFile(infile, out);
+	}
 	return true;
 }
 
 
 
+//////////////////////////////
+//
+// Tool_binroll::initialize --
+//
+
+void Tool_binroll::initialize(void) {
+	m_duration.setValue(1, 4); // 16th note
+	m_binaryQ = getBoolean("binary");
+	m_rleQ    = getBoolean("rle");
+	m_low     = getInteger("low");
+	m_high    = getInteger("high");
+	m_low     = std::max(0, std::min(127, m_low));
+	m_high    = std::max(0, std::min(127, m_high));
+	if (m_low > m_high) {
+		std::swap(m_low, m_high);
+	}
+	m_words = (m_high - m_low) / 64 + 1;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_binroll::processFile --
 //
 
-void Tool_binroll::processFile(HumdrumFile& infile) {
-	vector<vector<char>> output;
-	output.resize(128);
+void Tool_binroll::processFile(HumdrumFile& infile, ostream& out) {
 	int count = (infile.getScoreDuration() / m_duration).getInteger() + 1;
-	for (int i=0; i<(int)output.size(); i++) {
-		output[i].resize(count);
-		std::fill(output[i].begin(), output[i].end(), 0);
+
+	vector<vector<char>> output;
+	vector<int> voices(infile.getMaxTrack() + 1, -1);
+	if (m_binaryQ) {
+		vector<HTp> kernspines = infile.getKernSpineStartList();
+		m_voices = (int)kernspines.size();
+		for (int i=0; i<m_voices; i++) {
+			voices[kernspines[i]->getTrack()] = i;
+		}
+		m_bits.assign((size_t)count * m_voices * 2 * m_words, 0);
+	} else {
+		output.resize(128);
+		for (int i=0; i<(int)output.size(); i++) {
+			output[i].resize(count);
+			std::fill(output[i].begin(), output[i].end(), 0);
+		}
 	}
 
 	int strandcount = infile.getStrandCount();
@@ -99,11 +153,120 @@ void Tool_binroll::processFile(HumdrumFile& infile) {
 			continue;
 		}
 		HTp ending = infile.getStrandEnd(i);
-		processStrand(output, starting, ending);
+		processStrand(output, starting, ending, voices[starting->getTrack()]);
+	}
+
+	if (m_binaryQ) {
+		writeBinaryRoll(out, count);
+	} else {
+		printAnalysis(infile, output, out);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::writeBinaryRoll -- Write the packed roll of the current
+//    file.  All values are little-endian.  The 40-byte header is:
+//
+//       0  char[8]  "HUMBROLL"
+//       8  uint16   format version (1)
+//      10  uint16   flags (bit 0: run-length compressed)
+//      12  uint8    lowest MIDI pitch
+//      13  uint8    highest MIDI pitch
+//      14  uint16   number of voices (**kern spines)
+//      16  uint32   numerator of time step duration (in quarter notes)
+//      20  uint32   denominator of time step duration
+//      24  uint32   number of time steps
+//      28  uint32   words per voice plane: (high - low) / 64 + 1
+//      32  uint64   number of data bytes following the header
+//
+//    Each time step is a record of 64-bit words: for each voice, the
+//    sounding notes followed by the note attacks, one bit per pitch
+//    (bit 0 of the first word is the lowest pitch).  Uncompressed data
+//    is the records for each time step, so a step can be accessed
+//    directly when the file is memory-mapped.  Compressed data is a
+//    list of runs, each a uint64 repeat count followed by the record.
+//    Multiple scores are written one after another.
+//
+//    Voices are kept separate, so a record is 16 * voices * words bytes,
+//    while the text roll is about 256 bytes per step regardless of the
+//    number of voices.  The binary roll is therefore only smaller than
+//    the text roll when voices * words is less than 16: fewer than 8
+//    voices for the full MIDI range, or fewer than 16 voices when
+//    --low/--high limit the range to 64 keys or less (22k lines with
+//    16 voices: 10.2 MB text, 20.5 MB -b, 10.2 MB -b --low 36 --high 99).
+//    Use -b for access to individual voices or time steps without
+//    parsing text, and add -r for music with sustained textures, since
+//    only identical consecutive steps are compressed.
+//
+
+void Tool_binroll::writeBinaryRoll(ostream& out, int steps) {
+	size_t recordsize = (size_t)m_voices * 2 * m_words;
+
+	// Starting index of each run of identical records:
+	vector<int> runs;
+	if (m_rleQ) {
+		for (int i=0; i<steps; i++) {
+			if ((i == 0) || !std::equal(m_bits.data() + i * recordsize,
+					m_bits.data() + (i + 1) * recordsize,
+					m_bits.data() + (i - 1) * recordsize)) {
+				runs.push_back(i);
+			}
+		}
+	}
+	uint64_t databytes = m_bits.size() * 8;
+	if (m_rleQ) {
+		databytes = runs.size() * (recordsize + 1) * 8;
 	}
 
-	printAnalysis(infile, output);
+	string header = "HUMBROLL";
+	Convert::appendLittleEndian(header, 1, 2);
+	Convert::appendLittleEndian(header, m_rleQ ? 1 : 0, 2);
+	Convert::appendLittleEndian(header, m_low, 1);
+	Convert::appendLittleEndian(header, m_high, 1);
+	Convert::appendLittleEndian(header, m_voices, 2);
+	Convert::appendLittleEndian(header, m_duration.getNumerator(), 4);
+	Convert::appendLittleEndian(header, m_duration.getDenominator(), 4);
+	Convert::appendLittleEndian(header, steps, 4);
+	Convert::appendLittleEndian(header, m_words, 4);
+	Convert::appendLittleEndian(header, databytes, 8);
+	out.write(header.data(), header.size());
+
+	if (!m_rleQ) {
+		writeWords(out, m_bits.data(), m_bits.size());
+		return;
+	}
+	for (int i=0; i<(int)runs.size(); i++) {
+		int next = (i + 1 < (int)runs.size()) ? runs[i+1] : steps;
+		uint64_t count = next - runs[i];
+		writeWords(out, &count, 1);
+		writeWords(out, m_bits.data() + runs[i] * recordsize, recordsize);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_binroll::writeWords -- Write 64-bit words in little-endian order.
+//
 
+void Tool_binroll::writeWords(ostream& out, const uint64_t* words,
+		size_t count) {
+	uint16_t test = 1;
+	if (*(char*)&test == 1) {
+		// little-endian computer: write the words directly.
+		out.write((const char*)words, count * 8);
+		return;
+	}
+	string buffer;
+	buffer.reserve(count * 8);
+	for (size_t i=0; i<count; i++) {
+		Convert::appendLittleEndian(buffer, words[i], 8);
+	}
+	out.write(buffer.data(), buffer.size());
 }
 
 
@@ -114,7 +277,7 @@ void Tool_binroll::processFile(HumdrumFile& infile) {
 //
 
 void Tool_binroll::printAnalysis(HumdrumFile& infile,
-		vector<vector<char>>& roll) {
+		vector<vector<char>>& roll, ostream& out) {
 	HumRegex hre;
 
 	for (int i=0; i<infile.getLineCount(); i++) {
@@ -128,23 +291,23 @@ void Tool_binroll::printAnalysis(HumdrumFile& infile,
 		int found = 0;
 		for (int j=0; j<(int)line.size(); j++) {
 			if ((line[j] == '!') && !found) {
-				m_free_text << "#";
+				out << "#";
 			} else {
 				found = 1;
-				m_free_text << line[j];
+				out << line[j];
 			}
 		}
-		m_free_text << "\n";
+		out << "\n";
 	}
 
 	for (int i=0; i<(int)roll[0].size(); i++) {
 		for (int j=0; j<(int)roll.size(); j++) {
-			m_free_text << (int)roll[j][i];
+			out << (int)roll[j][i];
 			if (j < (int)roll.size() - 1) {
-				m_free_text << ' ';
+				out << ' ';
 			}
 		}
-		m_free_text << "\n";
+		out << "\n";
 	}
 
 	int startindex = infile.getLineCount() - 1;
@@ -164,13 +327,13 @@ void Tool_binroll::printAnalysis(HumdrumFile& infile,
 		int found = 0;
 		for (int j=0; j<(int)line.size(); j++) {
 			if ((line[j] == '!') && !found) {
-				m_free_text << "#";
+				out << "#";
 			} else {
 				found = 1;
-				m_free_text << line[j];
+				out << line[j];
 			}
 		}
-		m_free_text << "\n";
+		out << "\n";
 	}
 }
 
@@ -182,7 +345,7 @@ void Tool_binroll::printAnalysis(HumdrumFile& infile,
 //
 
 void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
-		HTp ending) {
+		HTp ending, int voice) {
 	HTp current = starting;
 	int base12;
 	HumNum starttime;
@@ -211,10 +374,7 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 				}
 				duration = Convert::recipToDuration(tok);
 				endindex = ((starttime+duration) / m_duration).getInteger();
-				roll[base12][startindex] = 2;
-				for (int i=startindex+1; i<endindex; i++) {
-					roll[base12][i] = 1;
-				}
+				storeNote(roll, voice, base12, startindex, endindex);
 			}
 		} else {
 			base12 = Convert::kernToMidiNoteNumber(current);
@@ -226,10 +386,7 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 			duration = current->getDuration();
 			startindex = (starttime / m_duration).getInteger();
 			endindex   = ((starttime+duration) / m_duration).getInteger();
-			roll[base12][startindex] = 2;
-			for (int i=startindex+1; i<endindex; i++) {
-				roll[base12][i] = 1;
-			}
+			storeNote(roll, voice, base12, startindex, endindex);
 		}
 		current = current->getNextToken();
 	}
@@ -237,6 +394,38 @@ void Tool_binroll::processStrand(vector<vector<char>>& roll, HTp starting,
 
 
 
+//////////////////////////////
+//
+// Tool_binroll::storeNote -- Mark a note in the text roll (2 for the
+//    attack, 1 for the sustain), or in the packed binary roll.
+//
+
+void Tool_binroll::storeNote(vector<vector<char>>& roll, int voice,
+		int base12, int startindex, int endindex) {
+	if (!m_binaryQ) {
+		roll[base12][startindex] = 2;
+		for (int i=startindex+1; i<endindex; i++) {
+			roll[base12][i] = 1;
+		}
+		return;
+	}
+
+	if ((voice < 0) || (base12 < m_low) || (base12 > m_high)) {
+		return;
+	}
+	int bit = base12 - m_low;
+	uint64_t mask = (uint64_t)1 << (bit % 64);
+	size_t recordsize = (size_t)m_voices * 2 * m_words;
+	uint64_t* cell = m_bits.data() + (size_t)voice * 2 * m_words + bit / 64;
+	cell[startindex * recordsize] |= mask;
+	cell[startindex * recordsize + m_words] |= mask;
+	for (int i=startindex+1; i<endindex; i++) {
+		cell[i * recordsize] |= mask;
+	}
+}
+
+
+
 
 // END_MERGE
 
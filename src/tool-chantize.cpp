@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Tue May 19 22:12:33 PDT 2020
-// Last Modified: Tue May 19 22:12:36 PDT 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-chantize.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-chantize.cpp
 // Syntax:        C++11; humlib
@@ -46,6 +46,7 @@ Tool_chantize::Tool_chantize(void) {
 
 	define("N|do-not-remove-empty-transpositions=b", "Do not remove empty transposition instructions");
 	define ("n|only-remove-empty-transpositions=b", "Only remove empty transpositions");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Fri Feb  9 21:05:41 PST 2018
-// Last Modified: Fri Feb  9 21:05:45 PST 2018
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-chord.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-chord.cpp
 // Syntax:        C++11; humlib
@@ -39,6 +39,7 @@ Tool_chord::Tool_chord(void) {
 	define("s|spine=i:-1",        "spine to process (indexed from 1)");
 	define("m|minimize=b",        "minimize chords");
 	define("M|maximize=b",        "maximize chords");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Dec 26 17:03:54 PST 2010
-// Last Modified: Tue May 30 15:35:10 CEST 2017
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-cint.cpp
 // URL:           https://github.com/craigsapp/minHumdrum/blob/master/src/tool-cint.cpp
 // Syntax:        C++11; humlib
@@ -16,6 +16,10 @@
 #include "Convert.h"
 
 #include <algorithm>
+#include <atomic>
+#include <map>
+#include <thread>
+#include <unordered_map>
 
 using namespace std;
 
@@ -80,11 +84,15 @@ Tool_cint::Tool_cint(void) {
 	define("search=s:", "search string");
 	define("mark=b", "mark matches notes from searches in data");
 	define("count=b", "count matched modules from search query");
+	define("module-counts|mc=b", "count all modules for each pair of voices");
+	define("json=b", "print module counts as JSON (one line per file)");
 	define("debug=b");              // determine bad input line num
 	define("author=b");             // author of program
 	define("version=b");            // compilation info
 	define("example=b");            // example usages
 	define("help=b");               // short description
+	define("threads=i:1", "number of threads for --module-counts in each file");
+	defineThreadOption();
 }
 
 
@@ -133,15 +141,7 @@ bool Tool_cint::run(HumdrumFile& infile, ostream& out) {
 
 bool Tool_cint::run(HumdrumFile& infile) {
 	processFile(infile);
-
-
-	if (hasAnyText()) {
-		// getAllText(cout);
-	} else {
-		// Re-load the text for each line from their tokens.
-		cout << infile;
-	}
-
+	// If there is no text output, the caller prints infile.
 	return true;
 }
 
@@ -257,6 +257,10 @@ int Tool_cint::processFile(HumdrumFile& infile) {
 		notes[i].resize(0);
 	}
 
+	if (moduleCountQ) {
+		return printModuleCounts(infile, ktracks, reverselookup);
+	}
+
 	getNames(names, reverselookup, infile);
 	HumRegex pre;
 	extractNoteArray(notes, infile, ktracks, reverselookup);
@@ -309,6 +313,441 @@ int Tool_cint::processFile(HumdrumFile& infile) {
 
 
 
+//////////////////////////////
+//
+// Tool_cint::printModuleCounts -- Count every module (or module chain of
+//     length -n) for each pair of voices in the score, and print one line
+//     for each distinct module and voice pair:
+//        filename <tab> part1 <tab> part2 <tab> count <tab> module
+//     where parts are indexed from 0 for the lowest voice.  With --json,
+//     print a single JSON object for the file instead.  The modules are
+//     identified with numeric interval codes, and voice pairs are
+//     processed in parallel with the --threads option (separate from
+//     the -j option, which processes input files in parallel).  Returns
+//     the total number of modules.
+//
+
+int Tool_cint::printModuleCounts(HumdrumFile& infile, vector<int>& ktracks,
+		vector<int>& reverselookup) {
+	if (attackQ || octaveQ) {
+		m_error_text << "Error: --module-counts cannot be used with --attacks or -o" << endl;
+		return 0;
+	}
+
+	int voices = (int)ktracks.size();
+	vector<int> pitches;
+	int rows = extractNoteMatrix(pitches, infile, reverselookup, voices);
+
+	vector<pair<int, int>> pairs;
+	for (int i=0; i<voices; i++) {
+		for (int j=i+1; j<voices; j++) {
+			pairs.emplace_back(i, j);
+		}
+	}
+	vector<vector<pair<string, int>>> counts(pairs.size());
+
+	int threads = getThreadCount("threads");
+	if (threads > (int)pairs.size()) {
+		threads = (int)pairs.size();
+	}
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		int index;
+		while ((index = next++) < (int)pairs.size()) {
+			countPairModules(counts[index],
+					pitches.data() + pairs[index].first * rows,
+					pitches.data() + pairs[index].second * rows, rows, Chaincount);
+		}
+	};
+	if (threads <= 1) {
+		worker();
+	} else {
+		vector<std::thread> pool;
+		for (int i=0; i<threads; i++) {
+			pool.emplace_back(worker);
+		}
+		for (int i=0; i<(int)pool.size(); i++) {
+			pool[i].join();
+		}
+	}
+
+	suppressHumdrumFileOutput();
+	string filename = infile.getFilename();
+	int total = 0;
+	if (jsonQ) {
+		string escaped;
+		for (int i=0; i<(int)filename.size(); i++) {
+			if ((filename[i] == '"') || (filename[i] == '\\')) {
+				escaped += '\\';
+			}
+			escaped += filename[i];
+		}
+		m_json_text << "{\"file\":\"" << escaped << "\",\"n\":" << Chaincount
+		            << ",\"voices\":" << voices << ",\"pairs\":[";
+		for (int i=0; i<(int)pairs.size(); i++) {
+			if (i > 0) {
+				m_json_text << ",";
+			}
+			m_json_text << "{\"parts\":[" << pairs[i].first << ","
+			            << pairs[i].second << "],\"modules\":[";
+			for (int j=0; j<(int)counts[i].size(); j++) {
+				if (j > 0) {
+					m_json_text << ",";
+				}
+				m_json_text << "[\"" << counts[i][j].first << "\","
+				            << counts[i][j].second << "]";
+				total += counts[i][j].second;
+			}
+			m_json_text << "]}";
+		}
+		m_json_text << "]}\n";
+	} else {
+		for (int i=0; i<(int)pairs.size(); i++) {
+			for (int j=0; j<(int)counts[i].size(); j++) {
+				m_free_text << filename
+				            << "\t" << pairs[i].first
+				            << "\t" << pairs[i].second
+				            << "\t" << counts[i][j].second
+				            << "\t" << counts[i][j].first << "\n";
+				total += counts[i][j].second;
+			}
+		}
+	}
+	return total;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::extractNoteMatrix -- Numeric version of extractNoteArray()
+//     for counting modules.  The base-40 pitch of each voice for each
+//     sonority is stored in pitches, one voice after another (index
+//     voice * rows + row).  Rests are 0 and sustained notes are negative.
+//     The same sonorities as in extractNoteArray() are stored.  Returns
+//     the number of sonorities (rows).
+//
+
+int Tool_cint::extractNoteMatrix(vector<int>& pitches, HumdrumFile& infile,
+		vector<int>& reverselookup, int voices) {
+	pitches.clear();
+	if (voices == 0) {
+		return 0;
+	}
+
+	vector<int> rowdata;  // sonorities stored one after another
+	rowdata.reserve(infile.getLineCount() * voices);
+	vector<int> current(voices);
+	bool lastrests = true;  // last voice contains only rests so far
+
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isBarline() && (infile.token(i, 0)->find("||") != string::npos)) {
+			// double barline: add a row of rests (see extractNoteArray).
+			rowdata.insert(rowdata.end(), voices, REST);
+			continue;
+		}
+		if (!infile[i].isData()) {
+			continue;
+		}
+		std::fill(current.begin(), current.end(), REST);
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (!token->isKern()) {
+				continue;
+			}
+			int index = reverselookup[token->getTrack()];
+			if (index < 0) {
+				continue;
+			}
+			int sign = 1;
+			if (token->isNull()) {
+				sign = -1;
+				token = token->resolveNull();
+				if (token == NULL) {
+					continue;
+				}
+			}
+			if (token->find('r') != string::npos) {
+				continue;
+			}
+			if ((token->find('_') != string::npos) ||
+					(token->find(']') != string::npos)) {
+				sign = -1;
+			}
+			current[index] = sign * Convert::kernToBase40(*token);
+		}
+
+		bool onlyrests = true;
+		bool attack = false;
+		for (int j=0; j<voices; j++) {
+			if (current[j] != REST) {
+				onlyrests = false;
+			}
+			if (current[j] > 0) {
+				attack = true;
+			}
+		}
+		if (onlyrests && lastrests) {
+			// don't store more than one row of rests.
+			continue;
+		}
+		if (!onlyrests && !attack) {
+			// don't store sonorities which are purely sustained.
+			continue;
+		}
+		rowdata.insert(rowdata.end(), current.begin(), current.end());
+		lastrests = lastrests && (current.back() == REST);
+	}
+
+	int rows = (int)rowdata.size() / voices;
+	pitches.resize(rowdata.size());
+	for (int i=0; i<rows; i++) {
+		for (int j=0; j<voices; j++) {
+			pitches[j * rows + i] = rowdata[i * voices + j];
+		}
+	}
+	return rows;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::countPairModules -- Count the modules between two voices.
+//     Sonorities where both voices are sustained (or resting) are skipped,
+//     so modules are built from the remaining "events".  Each event has a
+//     harmonic interval code, and melodic interval codes from the previous
+//     event.  A rolling hash of the codes for the n events after the start
+//     of a module (combined with its starting harmonic interval) is used
+//     to find repeated modules; the codes are compared to resolve
+//     collisions.  The output list is sorted by decreasing count.
+//
+
+void Tool_cint::countPairModules(vector<pair<string, int>>& counts,
+		const int* pitch1, const int* pitch2, int rows, int n) {
+	counts.clear();
+
+	vector<int> events;
+	for (int i=0; i<rows; i++) {
+		if ((pitch1[i] > 0) || (pitch2[i] > 0)) {
+			events.push_back(i);
+		}
+	}
+	int ecount = (int)events.size();
+	if (ecount <= n) {
+		return;
+	}
+
+	bool melodicQ = !nomelodicQ;
+	vector<int64_t> harmonic(ecount, 0);
+	vector<int64_t> bottom(ecount, 0);
+	vector<int64_t> top(ecount, 0);
+	vector<uint64_t> token(ecount, 0);
+	// prefix sums for rests and melodic unisons (-R and -U options):
+	vector<int> rests(ecount + 1, 0);
+	vector<int> unisons(ecount + 1, 0);
+
+	for (int k=0; k<ecount; k++) {
+		int a = pitch1[events[k]];
+		int b = pitch2[events[k]];
+		if (!noharmonicQ) {
+			harmonic[k] = getIntervalCode(a, b, INTERVAL_HARMONIC);
+		}
+		rests[k+1] = rests[k] + (((a == REST) || (b == REST)) ? 1 : 0);
+		bool unison = false;
+		if (k > 0) {
+			int preva = pitch1[events[k-1]];
+			int prevb = pitch2[events[k-1]];
+			if (melodicQ && !toponlyQ) {
+				bottom[k] = getIntervalCode(preva, a, INTERVAL_MELODIC);
+			}
+			if (melodicQ && (topQ || toponlyQ)) {
+				top[k] = getIntervalCode(prevb, b, INTERVAL_MELODIC);
+			}
+			unison = ((a != REST) && (abs(a) == abs(preva))) ||
+			         ((b != REST) && (abs(b) == abs(prevb)));
+		}
+		unisons[k+1] = unisons[k] + (unison ? 1 : 0);
+		uint64_t value = (uint64_t)bottom[k] * 0x9E3779B97F4A7C15ULL;
+		value ^= (uint64_t)top[k] * 0xC2B2AE3D27D4EB4FULL;
+		value ^= (uint64_t)harmonic[k] * 0x165667B19E3779F9ULL;
+		value ^= value >> 29;
+		token[k] = value;
+	}
+
+	// Rolling hash of the tokens for events start+1 to start+n:
+	const uint64_t base = 0x100000001B3ULL;
+	uint64_t highpower = 1;
+	for (int i=1; i<n; i++) {
+		highpower *= base;
+	}
+	uint64_t window = 0;
+	for (int i=1; i<=n; i++) {
+		window = window * base + token[i];
+	}
+
+	class ModuleEntry {
+		public:
+			int start; // starting event of first instance of module
+			int count; // number of instances
+			int next;  // next entry with the same hash, or -1
+	};
+	vector<ModuleEntry> entries;
+	unordered_map<uint64_t, int> table;
+
+	for (int k=0; k+n<ecount; k++) {
+		if (k > 0) {
+			if (n > 0) {
+				window = (window - token[k] * highpower) * base + token[k+n];
+			}
+		}
+		if ((n == 0) && (events[k] == 0)) {
+			// printCombinationModule() does not report this one.
+			continue;
+		}
+		if (norestsQ && (rests[k+n+1] - rests[k] > 0)) {
+			continue;
+		}
+		if (nounisonsQ && (unisons[k+n+1] - unisons[k+1] > 0)) {
+			continue;
+		}
+		uint64_t key = window ^ ((uint64_t)harmonic[k] * 0xD6E8FEB86659FD93ULL);
+		auto found = table.find(key);
+		if (found == table.end()) {
+			table[key] = (int)entries.size();
+			entries.push_back(ModuleEntry{k, 1, -1});
+			continue;
+		}
+		int index = found->second;
+		while (true) {
+			int start = entries[index].start;
+			bool same = (harmonic[start] == harmonic[k]);
+			for (int i=1; same && (i<=n); i++) {
+				same = (harmonic[start+i] == harmonic[k+i]) &&
+				       (bottom[start+i] == bottom[k+i]) &&
+				       (top[start+i] == top[k+i]);
+			}
+			if (same) {
+				entries[index].count++;
+				break;
+			}
+			if (entries[index].next < 0) {
+				entries[index].next = (int)entries.size();
+				entries.push_back(ModuleEntry{k, 1, -1});
+				break;
+			}
+			index = entries[index].next;
+		}
+	}
+
+	// Different codes may print the same (such as the sustain state of
+	// notes if -s is not given), so merge the counts by module text:
+	unordered_map<string, int> merged;
+	merged.reserve(entries.size());
+	stringstream label;
+	for (int i=0; i<(int)entries.size(); i++) {
+		label.str("");
+		printModuleLabel(label, pitch1, pitch2, events, entries[i].start, n);
+		merged[label.str()] += entries[i].count;
+	}
+	counts.assign(merged.begin(), merged.end());
+	std::sort(counts.begin(), counts.end(),
+		[](const pair<string, int>& a, const pair<string, int>& b) {
+			if (a.second != b.second) {
+				return a.second > b.second;
+			}
+			return a.first < b.first;
+		});
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::getIntervalCode -- Return a number which identifies the
+//     interval as printed by printInterval().
+//
+
+int64_t Tool_cint::getIntervalCode(int b40a, int b40b, int type) {
+	if ((b40a == REST) || (b40b == REST)) {
+		return (int64_t)RESTINT * 4;
+	}
+	int64_t output = (int64_t)getIntervalValue(b40a, b40b, type) * 4;
+	if (sustainQ || ((type == INTERVAL_HARMONIC) && xoptionQ)) {
+		output += (b40a < 0 ? 2 : 0) + (b40b < 0 ? 1 : 0);
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::printModuleLabel -- Print a module in the same format as
+//     printCombinationModule() (without --dur or --id information).
+//
+
+void Tool_cint::printModuleLabel(ostream& out, const int* pitch1,
+		const int* pitch2, const vector<int>& events, int start, int n) {
+	NoteNode note1;
+	NoteNode note2;
+	NoteNode last1;
+	NoteNode last2;
+	if (parenQ) {
+		out << "(";
+	}
+	for (int count=0; count<=n; count++) {
+		note1.b40 = pitch1[events[start+count]];
+		note2.b40 = pitch2[events[start+count]];
+		if ((count > 0) && !nomelodicQ) {
+			if (mparenQ) {
+				out << "{";
+			}
+			if (!toponlyQ) {
+				printInterval(out, last1, note1, INTERVAL_MELODIC);
+				if (mmarkerQ) {
+					out << "m";
+				}
+			}
+			if (topQ || toponlyQ) {
+				if (!toponlyQ) {
+					printSpacer(out);
+				}
+				printInterval(out, last2, note2, INTERVAL_MELODIC);
+				if (mmarkerQ) {
+					out << "m";
+				}
+			}
+			if (mparenQ) {
+				out << "}";
+			}
+			printSpacer(out);
+		}
+		if (!noharmonicQ) {
+			if (hparenQ) {
+				out << "[";
+			}
+			printInterval(out, note1, note2, INTERVAL_HARMONIC);
+			if (hmarkerQ) {
+				out << "h";
+			}
+			if (hparenQ) {
+				out << "]";
+			}
+		}
+		if ((count < n) && !noharmonicQ) {
+			printSpacer(out);
+		}
+		last1.b40 = note1.b40;
+		last2.b40 = note2.b40;
+	}
+	if (parenQ) {
+		out << ")";
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_cint::adjustKTracks -- Select only two spines to do analysis on.
@@ -1873,12 +2312,59 @@ int Tool_cint::printInterval(ostream& out, NoteNode& note1, NoteNode& note2,
 		return 0;
 	}
 	int cross = 0;
-	int pitch1 = abs(note1.b40);
-	int pitch2 = abs(note2.b40);
+	if ((type == INTERVAL_HARMONIC) && (abs(note2.b40) < abs(note1.b40))) {
+		cross = 1;
+	}
+	int interval = getIntervalValue(note1.b40, note2.b40, type, octaveadjust);
+
+	if (chromaticQ) {
+		out << Convert::base40ToIntervalAbbr(interval);
+	} else {
+		int negative = 1;
+		if (interval < 0) {
+			negative = -1;
+			interval = -interval;
+		}
+		if (base7Q && !zeroQ) {
+			out << negative * (interval+1);
+		} else {
+			out << negative * interval;
+		}
+	}
+
+	if (sustainQ || ((type == INTERVAL_HARMONIC) && xoptionQ)) {
+		// print sustain/attack information of intervals.
+		if (note1.b40 < 0) {
+			out << "s";
+		} else {
+			out << "x";
+		}
+		if (note2.b40 < 0) {
+			out << "s";
+		} else {
+			out << "x";
+		}
+	}
+
+	return cross;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_cint::getIntervalValue -- Return the interval between two
+//     (non-rest) notes in the units selected by the options, before
+//     formatting by printInterval().  Sustained notes are negative.
+//
+
+int Tool_cint::getIntervalValue(int b40a, int b40b, int type,
+		int octaveadjust) {
+	int pitch1 = abs(b40a);
+	int pitch2 = abs(b40b);
 	int interval = pitch2 - pitch1;
 
 	if ((type == INTERVAL_HARMONIC) && (interval < 0)) {
-		cross = 1;
 		if (uncrossQ) {
 			interval = -interval;
 		}
@@ -1936,37 +2422,7 @@ int Tool_cint::printInterval(ostream& out, NoteNode& note1, NoteNode& note2,
 		interval = interval + octaveadjust  * 7;
 	}
 
-
-	if (chromaticQ) {
-		out << Convert::base40ToIntervalAbbr(interval);
-	} else {
-		int negative = 1;
-		if (interval < 0) {
-			negative = -1;
-			interval = -interval;
-		}
-		if (base7Q && !zeroQ) {
-			out << negative * (interval+1);
-		} else {
-			out << negative * interval;
-		}
-	}
-
-	if (sustainQ || ((type == INTERVAL_HARMONIC) && xoptionQ)) {
-		// print sustain/attack information of intervals.
-		if (note1.b40 < 0) {
-			out << "s";
-		} else {
-			out << "x";
-		}
-		if (note2.b40 < 0) {
-			out << "s";
-		} else {
-			out << "x";
-		}
-	}
-
-	return cross;
+	return interval;
 }
 
 
@@ -2674,6 +3130,8 @@ void Tool_cint::initialize(void) {
 	markQ        = getBoolean("mark");
 	idQ          = getBoolean("id");
 	countQ       = getBoolean("count");
+	moduleCountQ = getBoolean("module-counts");
+	jsonQ        = getBoolean("json");
 	filenameQ    = getBoolean("filename");
 	suspensionsQ = getBoolean("suspensions");
 	uncrossQ     = getBoolean("uncross");
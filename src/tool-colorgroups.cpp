@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Sep 28 12:08:25 PDT 2020
-// Last Modified: Mon Sep 28 13:10:14 PDT 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-colorgroups.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-colorgroups.cpp
 // Syntax:        C++11; humlib
@@ -38,6 +38,7 @@ Tool_colorgroups::Tool_colorgroups(void) {
 	define("B=s:dodgerblue", "Color for group B");
 	define("C=s:limegreen",  "Color for group C");
 	define("command=b",     "print shed command only");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Sep  9 22:03:46 PDT 2020
-// Last Modified: Wed Sep  9 22:03:49 PDT 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-colortriads.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-colortriads.cpp
 // Syntax:        C++11; humlib
@@ -46,6 +46,7 @@ Tool_colortriads::Tool_colortriads(void) {
 	define("k|key=s",            "key to transpose coloring to");
 	define("commands=b",         "print msearch commands only");
 	define("filters=b",          "print filter commands only");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Jul 14 01:03:07 CEST 2019
-// Last Modified: Mon Jan 18 11:10:22 PST 2021
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-composite.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-composite.cpp
 // Syntax:        C++11; humlib
@@ -36,6 +36,7 @@ Tool_composite::Tool_composite(void) {
 	define("p|prepend=b",  "prepend data to end of line");
 	define("b|beam=b",     "apply automatic beaming");
 	define("G|no-grace=b", "do not include grace notes");
+	defineThreadOption();
 }
 
 
@@ -2,7 +2,7 @@
 // Programmer:    Alexander Morgan
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  8 12:24:49 PDT 2015
-// Last Modified: Wed May 24 15:39:19 CEST 2017
+// Last Modified: Sun Oct 18 14:52:48 UTC 2026
 // Filename:      tool-dissonant.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-dissonant.cpp
 // Syntax:        C++11; humlib
@@ -49,6 +49,20 @@ Tool_dissonant::Tool_dissonant(void) {
 	define("i|x|e|exinterp=s:**cdata","specify exinterp for **cdata spine");
 	define("color|colorize|color-by-rhythm=b", "color dissonant notes by beat level");
 	define("color2|colorize2|color-by-interval=b", "color dissonant notes by dissonant interval");
+	define("batch=b",                 "count dissonances over all input files");
+	defineThreadOption();
+}
+
+
+
+/////////////////////////////////
+//
+// Tool_dissonant::isBatchMode -- True if a single table of dissonance
+//     counts should be printed for all input files.
+//
+
+bool Tool_dissonant::isBatchMode(void) {
+	return getBoolean("batch");
 }
 
 
@@ -103,6 +117,65 @@ bool Tool_dissonant::run(HumdrumFile& infile, ostream& out) {
 }
 
 
+//
+// Batch version: count the dissonances in all files of the input stream
+// and print a single table of the totals (as for -c).  Input files are
+// parsed and analyzed by a pool of -j threads (see runStreamPool()), each
+// with its own copy of the tool, and the counts are merged by voice index.
+//
+
+bool Tool_dissonant::run(HumdrumFileStream& instream) {
+	if (getBoolean("undirected")) {
+		fillLabels2();
+	} else {
+		fillLabels();
+	}
+	m_counts.clear();
+	int filecount = 0;
+
+	auto process = [](Tool_dissonant& tool, HumdrumFileSet& infiles,
+			StreamSegmentResult& result) {
+		tool.m_accumulateQ = true;
+		tool.run(infiles[0]);
+		if (tool.hasError()) {
+			result.status = false;
+			result.errortext = tool.getError();
+		}
+		tool.clearOutput();
+		tool.m_filecount++;
+	};
+
+	auto finish = [&](Tool_dissonant& tool) {
+		filecount += tool.m_filecount;
+		if (m_counts.size() < tool.m_counts.size()) {
+			m_counts.resize(tool.m_counts.size());
+		}
+		for (int i=0; i<(int)tool.m_counts.size(); i++) {
+			for (auto& it : tool.m_counts[i]) {
+				m_counts[i][it.first] += it.second;
+			}
+		}
+	};
+
+	int status = runStreamPool<Tool_dissonant>(instream, argv(),
+			getThreadCount(), m_humdrum_text, process, finish);
+
+	printCountTable(m_counts);
+	m_humdrum_text << "!!total_files:\t" << filecount << endl;
+	return status == 0;
+}
+
+
+bool Tool_dissonant::run(HumdrumFileStream& instream, ostream& out) {
+	bool status = run(instream);
+	if (hasAnyText()) {
+		getAllText(out);
+	}
+	clearOutput();
+	return status;
+}
+
+
 bool Tool_dissonant::run(HumdrumFile& infile) {
 
 	if (getBoolean("voice-number")) {
@@ -150,6 +223,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 
 	suppressQ = getBoolean("suppress");
 	voiceFuncsQ = getBoolean("voice-functions");
+	bool countQ = getBoolean("count") || getBoolean("batch") || m_accumulateQ;
 
 	vector<vector<string>> results;
 	vector<vector<string>> results2;
@@ -184,7 +258,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 	}
 
 	if (suppressQ) {
-		if (getBoolean("count")) {
+		if (countQ) {
 			printCountAnalysis(results2);
 			return false;
 		} else {
@@ -203,7 +277,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 			return true;
 		}
 	} else if (voiceFuncsQ) { // run cadnetial-voice-function analysis if requested
-		if (getBoolean("count")) {
+		if (countQ) {
 			printCountAnalysis(voiceFuncs);
 			return false;
 		}
@@ -231,7 +305,7 @@ bool Tool_dissonant::run(HumdrumFile& infile) {
 		infile.createLinesFromTokens();
 		return true;
 	} else {
-		if (getBoolean("count")) {
+		if (countQ) {
 			printCountAnalysis(results);
 			return false;
 		} else {
@@ -1179,6 +1253,10 @@ void Tool_dissonant::printColorLegend(HumdrumFile& infile) {
 void Tool_dissonant::doAnalysis(vector<vector<string>>& results,
 		NoteGrid& grid, vector<vector<NoteCell*>>& attacks, bool debug) {
 	attacks.resize(grid.getVoiceCount());
+	m_intervals.resize(grid.getVoiceCount());
+	m_durations.resize(grid.getVoiceCount());
+	m_levels.resize(grid.getVoiceCount());
+	storeLowestNotes(grid);
 
 	for (int i=0; i<grid.getVoiceCount(); i++) {
 		attacks[i].clear();
@@ -1204,6 +1282,54 @@ void Tool_dissonant::doAnalysis(vector<vector<string>>& results,
 
 
 
+//////////////////////////////
+//
+// Tool_dissonant::storeLowestNotes -- Store the lowest sounding diatonic
+//     pitch in each slice of the grid (1000 if all voices are resting).
+//
+
+void Tool_dissonant::storeLowestNotes(NoteGrid& grid) {
+	int vcount = grid.getVoiceCount();
+	int scount = grid.getSliceCount();
+	m_lowestnote.assign(scount, 1000);
+	double tpitch;
+	for (int i=0; i<scount; i++) {
+		for (int v=0; v<vcount; v++) {
+			tpitch = grid.cell(v, i)->getAbsDiatonicPitch();
+			if ((!Convert::isNaN(tpitch)) && (tpitch <= m_lowestnote[i])) {
+				m_lowestnote[i] = (int)tpitch;
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_dissonant::storeVoiceFeatures -- Store the melodic interval from the
+//     previous attack, the duration and the metric level of each attack
+//     in a voice, so that they are calculated only once for all of the
+//     dissonance checks.
+//
+
+void Tool_dissonant::storeVoiceFeatures(vector<NoteCell*>& attacks, int vindex) {
+	int size = (int)attacks.size();
+	vector<double>& intervals = m_intervals[vindex];
+	vector<HumNum>& durations = m_durations[vindex];
+	vector<double>& levels    = m_levels[vindex];
+	intervals.resize(size);
+	durations.resize(size);
+	levels.resize(size);
+	for (int i=0; i<size; i++) {
+		intervals[i] = (i > 0) ? *attacks[i] - *attacks[i-1] : NAN;
+		durations[i] = attacks[i]->getDuration();
+		levels[i]    = attacks[i]->getMetricLevel();
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_dissonant::doAnalysisForVoice -- do analysis for a single voice by
@@ -1214,6 +1340,10 @@ void Tool_dissonant::doAnalysisForVoice(vector<vector<string>>& results,
 		NoteGrid& grid, vector<NoteCell*>& attacks, int vindex, bool debug) {
 	attacks.clear();
 	grid.getNoteAndRestAttacks(attacks, vindex);
+	storeVoiceFeatures(attacks, vindex);
+	vector<double>& intervals = m_intervals[vindex];
+	vector<HumNum>& durations = m_durations[vindex];
+	vector<double>& levels    = m_levels[vindex];
 
 	if (debug) {
 		cerr << "=======================================================";
@@ -1266,17 +1396,8 @@ void Tool_dissonant::doAnalysisForVoice(vector<vector<string>>& results,
 		marking = '\0';
 
 		// calculate harmonic intervals:
-		int lowestnote = 1000;
-		double tpitch;
-		// int lowestnotei = -1;
+		int lowestnote = m_lowestnote[sliceindex];
 		for (int j=0; j<(int)harmint.size(); j++) {
-			tpitch = grid.cell(j, sliceindex)->getAbsDiatonicPitch();
-			if (!Convert::isNaN(tpitch)) {
-				if (tpitch <= lowestnote) {
-					lowestnote = (int)tpitch;
-					// lowestnotei = j;
-				}
-			}
 			if (j == vindex) {
 				harmint[j] = 0;
 			}
@@ -1383,7 +1504,7 @@ RECONSIDER:
 		}
 
 		if (colorizeQ) {
-			double metriclevel = attacks[i]->getMetricLevel();
+			double metriclevel = levels[i];
 			if (metriclevel <= 0) {
 				dissL0Q = true;
 				marking = 'N';
@@ -1406,17 +1527,17 @@ RECONSIDER:
 		}
 
 		// variables for dissonant voice
-		durp = attacks[i-1]->getDuration();
-		dur  = attacks[i]->getDuration();
-		durn = attacks[i+1]->getDuration();
-		intp = *attacks[i] - *attacks[i-1];
-		intn = *attacks[i+1] - *attacks[i];
-		levp = attacks[i-1]->getMetricLevel();
-		lev  = attacks[i]->getMetricLevel();
-		levn = attacks[i+1]->getMetricLevel();
+		durp = durations[i-1];
+		dur  = durations[i];
+		durn = durations[i+1];
+		intp = intervals[i];
+		intn = intervals[i+1];
+		levp = levels[i-1];
+		lev  = levels[i];
+		levn = levels[i+1];
 		if (i >= 2) {
-			intpp = *attacks[i-1] - *attacks[i-2];
-			durpp = attacks[i-2]->getDuration();
+			intpp = intervals[i-1];
+			durpp = durations[i-2];
 			lineindexpp = attacks[i-2]->getLineIndex();
 		}
 
@@ -1671,8 +1792,8 @@ RECONSIDER:
 
 		if (i < ((int)attacks.size() - 2)) { // expand the analysis window
 
-			double intnn = *attacks[i+2] - *attacks[i+1];
-			HumNum durnn = attacks[i+2]->getDuration();       // dur of note after next
+			double intnn = intervals[i+2];
+			HumNum durnn = durations[i+2];       // dur of note after next
 			// double levnn = attacks[i+2]->getMetricLevel(); // lev of note after next
 
 			if ((dur <= durp) && (lev >= levp) && (lev >= levn) &&
@@ -1733,6 +1854,7 @@ void Tool_dissonant::findFakeSuspensions(vector<vector<string>>& results, NoteGr
 	double intp;        // abs value of diatonic interval from previous melodic note
 	int lineindexn;     // line index of the next note in the voice
 	bool sfound;        // boolean for if a suspension is found after a Z dissonance
+	vector<double>& intervals = m_intervals[vindex];
 
 	for (int i=1; i<(int)attacks.size()-1; i++) {
 		int lineindex = attacks[i]->getLineIndex();
@@ -1742,7 +1864,7 @@ void Tool_dissonant::findFakeSuspensions(vector<vector<string>>& results, NoteGr
 			(results[vindex][lineindex].find("m") == string::npos)) {
 			continue;
 		}
-		intp = fabs(*attacks[i] - *attacks[i-1]);
+		intp = fabs(intervals[i]);
 		lineindexn = attacks[i+1]->getLineIndex();
 		sfound = false;
 		for (int j=lineindex + 1; j<=lineindexn; j++) {
@@ -1763,7 +1885,7 @@ void Tool_dissonant::findFakeSuspensions(vector<vector<string>>& results, NoteGr
 		} else if (intp > 1) {
 			results[vindex][lineindex] = m_labels[FAKE_SUSPENSION_LEAP];
 		} else if (i > 1) { // as long as i > 1 intpp will be in range.
-			double intpp = fabs(*attacks[i-1] - *attacks[i-2]);
+			double intpp = fabs(intervals[i-1]);
 			if (intp == 0) { // fake suspensions preceded by an anticipation.
 				if (intpp == 1) {
 					results[vindex][lineindex] = m_labels[FAKE_SUSPENSION_STEP];
@@ -1796,6 +1918,8 @@ void Tool_dissonant::findLs(vector<vector<string>>& results, NoteGrid& grid,
 	double opitchp;    // previous pitch in other voice
 	double opitch;     // current pitch in other voice
 	double opitchn;    // next pitch in other voice
+	vector<double>& intervals = m_intervals[vindex];
+	vector<HumNum>& durations = m_durations[vindex];
 
 	for (int i=1; i<(int)attacks.size()-1; i++) {
 		lineindex = attacks[i]->getLineIndex();
@@ -1803,9 +1927,9 @@ void Tool_dissonant::findLs(vector<vector<string>>& results, NoteGrid& grid,
 			(results[vindex][lineindex].find("z") == string::npos)) {
 			continue;
 		}
-		dur  = attacks[i]->getDuration();
-		intp = *attacks[i] - *attacks[i-1];
-		intn = *attacks[i+1] - *attacks[i];
+		dur  = durations[i];
+		intp = intervals[i];
+		intn = intervals[i+1];
 		sliceindex = attacks[i]->getSliceIndex();
 
 		for (int j=0; j<(int)grid.getVoiceCount(); j++) { // j is the voice index of the other voice
@@ -1866,6 +1990,7 @@ void Tool_dissonant::findYs(vector<vector<string>>& results, NoteGrid& grid,
 	double opitch;     // current pitch in other voice
 	bool onlyWithValids; // note is only dissonant with identifiable dissonances
 	bool valid_acc_exit; // if accompaniment voice conforms to necessary standards
+	vector<double>& intervals = m_intervals[vindex];
 
 	for (int i=1; i<(int)attacks.size()-1; i++) {
 		lineindex = attacks[i]->getLineIndex();
@@ -1873,20 +1998,12 @@ void Tool_dissonant::findYs(vector<vector<string>>& results, NoteGrid& grid,
 			(results[vindex][lineindex].find("z") == string::npos)) {
 			continue;
 		}
-		intp = *attacks[i] - *attacks[i-1];
-		intn = *attacks[i+1] - *attacks[i];
+		intp = intervals[i];
+		intn = intervals[i+1];
 		sliceindex = attacks[i]->getSliceIndex();
 
-		int lowestnote = 1000; // lowest sounding diatonic note in any voice at this sliceindex
-		double tpitch;
-		for (int v=0; v<(int)grid.getVoiceCount(); v++) {
-			tpitch = grid.cell(v, sliceindex)->getAbsDiatonicPitch();
-			if (!Convert::isNaN(tpitch)) {
-				if (tpitch <= lowestnote) {
-					lowestnote = (int)tpitch;
-				}
-			}
-		}
+		// lowest sounding diatonic note in any voice at this sliceindex
+		int lowestnote = m_lowestnote[sliceindex];
 
 		onlyWithValids = true;
 		for (int j=0; j<(int)grid.getVoiceCount(); j++) { // j = index of other voice
@@ -1965,6 +2082,9 @@ void Tool_dissonant::findAppoggiaturas(vector<vector<string>>& results, NoteGrid
 	bool ant_down;     // if the current note was preceded by a descending anticipation
 	bool ant_up;       // if the current note was preceded by an ascending anticipation
 	bool ant_leapt_to; // if the current note was preceded by an anticipation leapt to
+	vector<double>& intervals = m_intervals[vindex];
+	vector<HumNum>& durations = m_durations[vindex];
+	vector<double>& levels    = m_levels[vindex];
 
 	for (int i=1; i<(int)attacks.size()-1; i++) {
 		lineindexp = attacks[i-1]->getLineIndex();
@@ -1975,13 +2095,13 @@ void Tool_dissonant::findAppoggiaturas(vector<vector<string>>& results, NoteGrid
 			(results[vindex][lineindex].find("j") == string::npos)) {
 			continue;
 		}
-		durp = attacks[i-1]->getDuration();
-		dur  = attacks[i]->getDuration();
-		durn = attacks[i+1]->getDuration();
-		intp = *attacks[i] - *attacks[i-1];
-		intn = *attacks[i+1] - *attacks[i];
-		lev  = attacks[i]->getMetricLevel();
-		levn = attacks[i+1]->getMetricLevel();
+		durp = durations[i-1];
+		dur  = durations[i];
+		durn = durations[i+1];
+		intp = intervals[i];
+		intn = intervals[i+1];
+		lev  = levels[i];
+		levn = levels[i+1];
 		sliceindex = attacks[i]->getSliceIndex();
 
 		if (!((lev <= levn) && (dur <= durn))) {
@@ -1993,26 +2113,20 @@ void Tool_dissonant::findAppoggiaturas(vector<vector<string>>& results, NoteGrid
 		ant_up       = false;
 		ant_leapt_to = false;
 		if (i > 1) {
-			durpp = attacks[i-2]->getDuration();
+			durpp = durations[i-2];
 			if ((intp == 0) && (durp <= dur) && (durp <= durpp)) {
-				if ((*attacks[i-1] - *attacks[i-2]) == -1) {
+				if (intervals[i-1] == -1) {
 					ant_down = true;
-				} else if ((*attacks[i-1] - *attacks[i-2]) == 1) {
+				} else if (intervals[i-1] == 1) {
 					ant_up = true;
-				} else if (fabs(*attacks[i-1] - *attacks[i-2]) > 1) {
+				} else if (fabs(intervals[i-1]) > 1) {
 					ant_leapt_to = true;
 				}
 			}
 		}
 
-		int lowestnote = 1000; // lowest sounding diatonic note in any voice at this sliceindex
-		double tpitch;
-		for (int v=0; v<(int)grid.getVoiceCount(); v++) {
-			tpitch = grid.cell(v, sliceindex)->getAbsDiatonicPitch();
-			if ((!Convert::isNaN(tpitch)) && (tpitch <= lowestnote)) {
-				lowestnote = (int)tpitch;
-			}
-		}
+		// lowest sounding diatonic note in any voice at this sliceindex
+		int lowestnote = m_lowestnote[sliceindex];
 
 		for (int j=0; j<(int)grid.getVoiceCount(); j++) { // j is the voice index of the other voice
 			if (vindex == j) { // only compare different voices
@@ -2338,24 +2452,50 @@ void Tool_dissonant::findCadentialVoiceFunctions(vector<vector<string>>& results
 //
 
 void Tool_dissonant::printCountAnalysis(vector<vector<string>>& data) {
+	if (m_accumulateQ) {
+		countAnalysis(m_counts, data);
+		return;
+	}
+	vector<map<string, int>> analysis;
+	countAnalysis(analysis, data);
+	printCountTable(analysis);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_dissonant::countAnalysis -- Add the number of times each label
+//     occurs in each voice to the analysis counts.
+//
+
+void Tool_dissonant::countAnalysis(vector<map<string, int>>& analysis,
+		vector<vector<string>>& data) {
+	if (analysis.size() < data.size()) {
+		analysis.resize(data.size());
+	}
+	for (int i=0; i<(int)data.size(); i++) {
+		for (int j=0; j<(int)data[i].size(); j++) {
+			analysis[i][data[i][j]]++;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_dissonant::printCountTable -- Print the number of dissonances
+//     of each type for each voice.
+//
+
+void Tool_dissonant::printCountTable(vector<map<string, int>>& analysis) {
 
 	map<string, bool> reduced;
 	bool brief = getBoolean("u");
 	bool percentQ = getBoolean("percent");
-
-	vector<map<string, int>> analysis;
-	analysis.resize(data.size());
 	int i;
 	int j;
-	for (i=0; i<(int)data.size(); i++) {
-		for (j=0; j<(int)data[i].size(); j++) {
-			if (analysis[i].find(data[i][j]) != analysis[i].end()) {
-				analysis[i][data[i][j]]++;
-			} else {
-				analysis[i][data[i][j]] = 1;
-			}
-		}
-	}
 
 	m_humdrum_text << "**rdis";
 	if (brief) {
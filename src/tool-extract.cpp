@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Jul 18 11:23:42 PDT 2005
-// Last Modified: Mon Oct  7 22:39:02 PDT 2019 Fixed -g option
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-extract.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-extract.h
 // Syntax:        C++11;; humlib
@@ -64,6 +64,7 @@ Tool_extract::Tool_extract(void) {
 	define("version=b");             // compilation info
 	define("example=b");             // example usages
 	define("h|help=b");              // short description
+	defineThreadOption();
 }
 
 
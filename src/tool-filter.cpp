@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Nov 30 01:02:57 PST 2016
-// Last Modified: Sat Jun 17 23:27:51 CEST 2017
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-filter.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-filter.cpp
 // Syntax:        C++11; humlib
@@ -76,6 +76,7 @@ namespace hum {
 #define RUNTOOL(NAME, INFILE, COMMAND, STATUS)     \
 	Tool_##NAME *tool = new Tool_##NAME;            \
 	tool->process(COMMAND);                         \
+	int linecount = INFILE.getLineCount();          \
 	tool->run(INFILE);                              \
 	if (tool->hasError()) {                         \
 		status = false;                              \
@@ -83,7 +84,7 @@ namespace hum {
 		delete tool;                                 \
 		break;                                       \
 	} else if (tool->hasHumdrumText()) {            \
-		INFILE.readString(tool->getHumdrumText());   \
+		updateFile(INFILE, tool->getHumdrumText(), linecount); \
 	}                                               \
 	delete tool;
 
@@ -138,6 +139,8 @@ namespace hum {
 
 Tool_filter::Tool_filter(void) {
 	define("debug=b", "print debug statement");
+	define("reparse=b", "re-parse the output text after each filter stage");
+	defineThreadOption();
 }
 
 
@@ -173,7 +176,7 @@ bool Tool_filter::runUniversal(HumdrumFileSet& infiles) {
 		} else if (commands[i].first == "chooser") {
 			RUNTOOLSET(chooser, infiles, commands[i].second, status);
 		} else if (commands[i].first == "myank") {
-			RUNTOOL(myank, infiles, commands[i].second, status);
+			RUNTOOLSET(myank, infiles, commands[i].second, status);
 		}
 	}
 
@@ -199,6 +202,11 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 	bool status = true;
 	vector<pair<string, string> > commands;
 	getCommandList(commands, infile);
+	// Lines edited by a stage are checked when the next Humdrum text
+	// output of a stage is used to update the file (see updateFile()), so
+	// the edits of tools which only change the file in place are checked
+	// along with those of the next stage.
+	infile.clearDirtyLines();
 	for (int i=0; i<(int)commands.size(); i++) {
 		if (commands[i].first == "autobeam") {
 			RUNTOOL(autobeam, infile, commands[i].second, status);
@@ -321,6 +329,71 @@ bool Tool_filter::run(HumdrumFileSet& infiles) {
 
 
 
+//////////////////////////////
+//
+// Tool_filter::updateFile -- Update the input file with the Humdrum text
+//    output of a filter stage.  Most tools edit tokens in the file and
+//    then print it (possibly with added global comments or reference
+//    records at the end).  In that case the file is kept in memory and
+//    only the edited lines are checked, rather than parsing the text
+//    again for the next stage.  Otherwise, or if the edits change the
+//    structure of the file, the text is parsed.  linecount is the number
+//    of lines in the file before the stage was run.  Lines edited in
+//    place by earlier stages without Humdrum text output are still marked
+//    as dirty, so they are checked as well.
+//
+
+void Tool_filter::updateFile(HumdrumFile& infile, const string& text,
+		int linecount) {
+	if (m_reparseQ) {
+		infile.readString(text);
+		return;
+	}
+
+	infile.createLinesFromTokens();
+	size_t pos = 0;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		const string& line = infile[i];
+		if (text.compare(pos, line.size(), line) != 0) {
+			infile.readString(text);
+			return;
+		}
+		pos += line.size();
+		if ((pos >= text.size()) || (text[pos] != '\n')) {
+			infile.readString(text);
+			return;
+		}
+		pos++;
+	}
+
+	// Lines added after the end of the file:
+	vector<string> extra;
+	while (pos < text.size()) {
+		size_t end = text.find('\n', pos);
+		if (end == string::npos) {
+			end = text.size();
+		}
+		if (text.compare(pos, 2, "!!") != 0) {
+			infile.readString(text);
+			return;
+		}
+		extra.push_back(text.substr(pos, end - pos));
+		pos = end + 1;
+	}
+	for (int i=0; i<(int)extra.size(); i++) {
+		infile.appendLine(extra[i]);
+	}
+
+	if (!infile.analyzeDirtyLines(linecount)) {
+		if (m_debugQ) {
+			cerr << "Re-parsing output of filter stage" << endl;
+		}
+		infile.readString(text);
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_filter::removeGlobalFilterLines --
@@ -543,6 +616,7 @@ void Tool_filter::getUniversalCommandList(vector<pair<string, string> >& command
 
 void Tool_filter::initialize(HumdrumFile& infile) {
 	m_debugQ = getBoolean("debug");
+	m_reparseQ = getBoolean("reparse");
 }
 
 
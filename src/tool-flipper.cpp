@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Aug 26 15:24:30 PDT 2020
-// Last Modified: Sun Sep 20 12:36:46 PDT 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-flipper.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-flipper.cpp
 // Syntax:        C++11; humlib
@@ -32,6 +32,7 @@ Tool_flipper::Tool_flipper(void) {
 	define("s|strophe=b",      "flip inside of strophes as well");
 	define("S|strophe-only|only-strophe=b", "flip only inside of strophes as well");
 	define("i|interp=s:kern",  "flip only in this interpretation");
+	defineThreadOption();
 }
 
 
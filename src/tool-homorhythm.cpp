@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Fri Aug  9 17:58:05 EDT 2019
-// Last Modified: Fri Aug  9 17:58:08 EDT 2019
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-homorhythm.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-homorhythm.cpp
 // Syntax:        C++11; humlib
@@ -40,6 +40,7 @@ Tool_homorhythm::Tool_homorhythm(void) {
 	define("s|score=d:1.0", "Score assigned to a sonority with three or more attacks");
 	define("m|intermediate-score=d:0.5", "Score to give sonority between two adjacent attack sonoroties");
 	define("l|letter=b", "Display letter scoress before calculations");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Fri Aug  9 17:58:05 EDT 2019
-// Last Modified: Fri Aug  9 17:58:08 EDT 2019
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-homorhythm2.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-homorhythm2.cpp
 // Syntax:        C++11; humlib
@@ -12,7 +12,7 @@
 
 #include "tool-homorhythm2.h"
 #include "Convert.h"
-#include "NoteGrid.h"
+#include "CompactNoteGrid.h"
 
 using namespace std;
 
@@ -32,6 +32,7 @@ Tool_homorhythm2::Tool_homorhythm2(void) {
 	define("s|score=b", "Show numeric scores");
 	define("n|length=i:4", "Sonority length to calculate");
 	define("f|fraction=b", "Report fraction of music that is homorhythm");
+	defineThreadOption();
 }
 
 
@@ -113,7 +114,7 @@ void Tool_homorhythm2::initialize(void) {
 
 void Tool_homorhythm2::processFile(HumdrumFile& infile) {
 	infile.analyzeStructure();
-	NoteGrid grid(infile);
+	CompactNoteGrid& grid = infile.getCompactNoteGrid();
 	m_score.resize(infile.getLineCount());
 	fill(m_score.begin(), m_score.end(), 0.0);
 
@@ -127,16 +128,14 @@ void Tool_homorhythm2::processFile(HumdrumFile& infile) {
 		for (int j=0; j<grid.getVoiceCount(); j++) {
 			for (int k=j+1; k<grid.getVoiceCount(); k++) {
 				for (int m=0; m<wsize; m++) {
-					NoteCell* cell1 = grid.cell(j, i+m);
-					if (cell1->isRest()) {
+					if (grid.isRest(j, i+m)) {
 						continue;
 					}
-					NoteCell* cell2 = grid.cell(k, i+m);
-					if (cell2->isRest()) {
+					if (grid.isRest(k, i+m)) {
 						continue;
 					}
 					count++;
-					if (cell1->isAttack() && cell2->isAttack()) {
+					if (grid.isAttack(j, i+m) && grid.isAttack(k, i+m)) {
 						score += 1.0;
 					}
 				}
@@ -152,16 +151,14 @@ void Tool_homorhythm2::processFile(HumdrumFile& infile) {
 		for (int j=0; j<grid.getVoiceCount(); j++) {
 			for (int k=j+1; k<grid.getVoiceCount(); k++) {
 				for (int m=0; m<wsize; m++) {
-					NoteCell* cell1 = grid.cell(j, i-m);
-					if (cell1->isRest()) {
+					if (grid.isRest(j, i-m)) {
 						continue;
 					}
-					NoteCell* cell2 = grid.cell(k, i-m);
-					if (cell2->isRest()) {
+					if (grid.isRest(k, i-m)) {
 						continue;
 					}
 					count++;
-					if (cell1->isAttack() && cell2->isAttack()) {
+					if (grid.isAttack(j, i-m) && grid.isAttack(k, i-m)) {
 						score += 1.0;
 					}
 				}
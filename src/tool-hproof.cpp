@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Aug  7 20:13:37 EDT 2017
-// Last Modified: Wed Aug 16 07:14:55 EDT 2017
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-hproof.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-hproof.cpp
 // Syntax:        C++11; humlib
@@ -28,6 +28,7 @@ namespace hum {
 
 Tool_hproof::Tool_hproof(void) {
 	// put option definitions here
+	defineThreadOption();
 }
 
 
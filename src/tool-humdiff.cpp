@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Jul 29 11:38:01 CEST 2019
-// Last Modified: Sat Aug  3 17:48:04 EDT 2019
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      humdiff.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/cli/humdiff.cpp
 // Syntax:        C++11
@@ -13,7 +13,10 @@
 #include "tool-humdiff.h"
 #include "HumRegex.h"
 #include "Convert.h"
+
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 
 using namespace std;
 
@@ -33,6 +36,9 @@ Tool_humdiff::Tool_humdiff(void) {
 	define("time-points|times=b", "display timepoint lists for each file");
 	define("note-points|notes=b", "display notepoint lists for each file");
 	define("c|color=s:red",       "color for difference markers");
+	define("a|align=b",           "align measures and notes (allows added/deleted measures)");
+	define("json=b",              "print JSON edit script (implies --align)");
+	defineThreadOption();
 }
 
 
@@ -62,23 +68,45 @@ bool Tool_humdiff::run(HumdrumFileSet& infiles) {
 		cerr << "Usage: " << getCommand() << " files" << endl;
 		return false;
 	} else {
-		HumNum targetdur = infiles[0].getScoreDuration();
-		for (int i=1; i<infiles.getSize(); i++) {
-			HumNum dur = infiles[i].getScoreDuration();
-			if (dur != targetdur) {
-				cerr << "Error: all files must have the same duration" << endl;
-				return false;
+		m_reportQ = getBoolean("report");
+		m_jsonQ = getBoolean("json");
+		bool alignQ = m_jsonQ || getBoolean("align");
+		if (!alignQ) {
+			HumNum targetdur = infiles[0].getScoreDuration();
+			for (int i=1; i<infiles.getSize(); i++) {
+				HumNum dur = infiles[i].getScoreDuration();
+				if (dur != targetdur) {
+					cerr << "Error: all files must have the same duration" << endl;
+					return false;
+				}
 			}
 		}
 
+		if (m_jsonQ) {
+			m_json_text << "{\n";
+			m_json_text << "\t\"reference\": \""
+			            << getJsonString(infiles[reference].getFilename()) << "\",\n";
+			m_json_text << "\t\"comparisons\": [";
+		}
+
+		int count = 0;
 		for (int i=0; i<infiles.getCount(); i++) {
 			if (i == reference) {
 				continue;
 			}
-			compareFiles(infiles[reference], infiles[i]);
+			if (!alignQ) {
+				compareFiles(infiles[reference], infiles[i]);
+				continue;
+			}
+			if (m_jsonQ && count++) {
+				m_json_text << ",";
+			}
+			alignFiles(infiles[reference], infiles[i], i + 1);
 		}
 
-		if (!getBoolean("report")) {
+		if (m_jsonQ) {
+			m_json_text << "\n\t]\n}\n";
+		} else if (!m_reportQ) {
 			infiles[reference].createLinesFromTokens();
 			m_humdrum_text << infiles[reference];
 			if (m_marked) {
@@ -391,7 +419,7 @@ void Tool_humdiff::getNoteList(vector<NotePoint>& notelist, HumdrumFile& infile,
 			notelist.back().subtoken = subtok;
 			notelist.back().subindex = j;
 			notelist.back().measurequarter = token->getDurationFromBarline();
-			notelist.back().measure =
+			notelist.back().measure = measure;
 			notelist.back().track = track;
 			notelist.back().layer = layer;
 			notelist.back().sourceindex = sourceindex;
@@ -404,6 +432,459 @@ void Tool_humdiff::getNoteList(vector<NotePoint>& notelist, HumdrumFile& infile,
 
 
 
+//////////////////////////////
+//
+// Tool_humdiff::alignFiles -- Compare two files which may have added or
+//     deleted measures.  The measures of each file are aligned by their
+//     note fingerprints with a linear-space diff (see alignSequences()).
+//     Measures which are not aligned are paired in order within the gaps
+//     between aligned measures, and the notes of paired measures are then
+//     aligned in the same way.  Reference notes with no match in the
+//     alternate file are marked, and all differences are added to the
+//     JSON edit script (--json) or report (--report).
+//
+
+void Tool_humdiff::alignFiles(HumdrumFile& reference, HumdrumFile& alternate,
+		int altindex) {
+	m_altindex = altindex;
+	m_edits.clear();
+
+	vector<MeasurePoint> refmeasures;
+	vector<MeasurePoint> altmeasures;
+	extractMeasurePoints(refmeasures, reference, 0);
+	extractMeasurePoints(altmeasures, alternate, altindex);
+
+	vector<uint64_t> reffingerprints(refmeasures.size());
+	for (int i=0; i<(int)refmeasures.size(); i++) {
+		reffingerprints[i] = refmeasures[i].fingerprint;
+	}
+	vector<uint64_t> altfingerprints(altmeasures.size());
+	for (int i=0; i<(int)altmeasures.size(); i++) {
+		altfingerprints[i] = altmeasures[i].fingerprint;
+	}
+
+	vector<pair<int, int>> matches;
+	alignSequences(matches, reffingerprints, altfingerprints);
+	matches.emplace_back((int)refmeasures.size(), (int)altmeasures.size());
+
+	int rindex = 0;
+	int aindex = 0;
+	for (int i=0; i<(int)matches.size(); i++) {
+		alignMeasureGap(refmeasures, rindex, matches[i].first,
+				altmeasures, aindex, matches[i].second);
+		rindex = matches[i].first + 1;
+		aindex = matches[i].second + 1;
+	}
+
+	if (!m_jsonQ) {
+		return;
+	}
+	m_json_text << "\n\t\t{\n";
+	m_json_text << "\t\t\t\"alternate\": \""
+	            << getJsonString(alternate.getFilename()) << "\",\n";
+	m_json_text << "\t\t\t\"source\": " << altindex << ",\n";
+	m_json_text << "\t\t\t\"measures\": {\"reference\": " << refmeasures.size()
+	            << ", \"alternate\": " << altmeasures.size()
+	            << ", \"matched\": " << (matches.size() - 1) << "},\n";
+	m_json_text << "\t\t\t\"edits\": [";
+	for (int i=0; i<(int)m_edits.size(); i++) {
+		m_json_text << (i ? ",\n" : "\n") << "\t\t\t\t" << m_edits[i];
+	}
+	m_json_text << (m_edits.empty() ? "]\n" : "\n\t\t\t]\n");
+	m_json_text << "\t\t}";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignMeasureGap -- Process the measures between two
+//     aligned measures (or the start/end of the files).  Measures are
+//     paired in order, and any extra measures in the reference or the
+//     alternate file are deleted or inserted measures.
+//
+
+void Tool_humdiff::alignMeasureGap(vector<MeasurePoint>& refmeasures,
+		int rstart, int rend, vector<MeasurePoint>& altmeasures, int astart,
+		int aend) {
+	int pairs = std::min(rend - rstart, aend - astart);
+	for (int i=0; i<pairs; i++) {
+		alignMeasureNotes(refmeasures[rstart + i], altmeasures[astart + i]);
+	}
+	for (int i=rstart+pairs; i<rend; i++) {
+		addEdit("delete-measure", &refmeasures[i], NULL, NULL, NULL);
+		if (m_reportQ || m_jsonQ) {
+			continue;
+		}
+		for (int j=0; j<(int)refmeasures[i].notes.size(); j++) {
+			markNote(refmeasures[i].notes[j]);
+		}
+	}
+	for (int i=astart+pairs; i<aend; i++) {
+		addEdit("insert-measure", NULL, NULL, &altmeasures[i], NULL);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignMeasureNotes -- Align the notes of two measures
+//     which have different fingerprints.
+//
+
+void Tool_humdiff::alignMeasureNotes(MeasurePoint& refmeasure,
+		MeasurePoint& altmeasure) {
+	vector<pair<int, int>> matches;
+	alignSequences(matches, refmeasure.keys, altmeasure.keys);
+	matches.emplace_back((int)refmeasure.notes.size(), (int)altmeasure.notes.size());
+
+	int rindex = 0;
+	int aindex = 0;
+	bool changed = false;
+	for (int i=0; i<(int)matches.size(); i++) {
+		if ((rindex < matches[i].first) || (aindex < matches[i].second)) {
+			changed = true;
+		}
+		for (int j=rindex; j<matches[i].first; j++) {
+			addEdit("delete-note", &refmeasure, &refmeasure.notes[j], &altmeasure, NULL);
+			if (!(m_reportQ || m_jsonQ)) {
+				markNote(refmeasure.notes[j]);
+			}
+		}
+		for (int j=aindex; j<matches[i].second; j++) {
+			addEdit("insert-note", &refmeasure, NULL, &altmeasure, &altmeasure.notes[j]);
+		}
+		rindex = matches[i].first + 1;
+		aindex = matches[i].second + 1;
+	}
+	if (!changed && (refmeasure.duration != altmeasure.duration)) {
+		// Same notes, but the measures have a different duration:
+		addEdit("change-measure", &refmeasure, NULL, &altmeasure, NULL);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::addEdit -- Add a difference to the JSON edit script
+//     or to the report.  Line and field numbers start at 1.
+//
+
+void Tool_humdiff::addEdit(const string& op, MeasurePoint* refmeasure,
+		NotePoint* refnote, MeasurePoint* altmeasure, NotePoint* altnote) {
+	if (m_jsonQ) {
+		stringstream edit;
+		edit << "{\"op\": \"" << op << "\"";
+		if (refmeasure) {
+			edit << ", \"reference\": ";
+			printEditLocation(edit, *refmeasure, refnote);
+		}
+		if (altmeasure) {
+			edit << ", \"alternate\": ";
+			printEditLocation(edit, *altmeasure, altnote);
+		}
+		edit << "}";
+		m_edits.push_back(edit.str());
+		return;
+	}
+	if (!m_reportQ) {
+		return;
+	}
+
+	m_free_text << op;
+	if (refnote) {
+		m_free_text << " " << refnote->subtoken;
+	} else if (altnote) {
+		m_free_text << " " << altnote->subtoken;
+	}
+	m_free_text << " IN SOURCE " << m_altindex << endl;
+	if (refmeasure) {
+		int line = refnote ? refnote->token->getLineIndex() : refmeasure->line;
+		m_free_text << "\tREFERENCE MEASURE\t: " << refmeasure->measure << endl;
+		m_free_text << "\tREFERENCE LINE NO.\t: " << line + 1 << endl;
+	}
+	if (altmeasure) {
+		int line = altnote ? altnote->token->getLineIndex() : altmeasure->line;
+		m_free_text << "\tTARGET " << m_altindex << " MEASURE\t: " << altmeasure->measure << endl;
+		m_free_text << "\tTARGET " << m_altindex << " LINE NO.\t: " << line + 1 << endl;
+	}
+	m_free_text << endl;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::printEditLocation -- Print the location of a measure
+//     or a note in a measure as a JSON object.
+//
+
+void Tool_humdiff::printEditLocation(ostream& out, MeasurePoint& mp,
+		NotePoint* np) {
+	out << "{\"measure\": " << mp.measure;
+	if (!np) {
+		out << ", \"line\": " << mp.line + 1 << "}";
+		return;
+	}
+	out << ", \"line\": " << np->token->getLineIndex() + 1;
+	out << ", \"field\": " << np->token->getFieldIndex() + 1;
+	out << ", \"subtoken\": " << np->subindex + 1;
+	out << ", \"note\": \"" << getJsonString(np->subtoken) << "\"}";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::getJsonString -- Escape quotes and backslashes.
+//
+
+string Tool_humdiff::getJsonString(const string& value) {
+	string output;
+	for (int i=0; i<(int)value.size(); i++) {
+		if ((value[i] == '"') || (value[i] == '\\')) {
+			output += '\\';
+		}
+		output += value[i];
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::extractMeasurePoints -- Extract the notes of each measure
+//     in a file.  Grace notes and rests are ignored (as in
+//     extractTimePoints()), and barlines which are not followed by
+//     music do not create a measure.
+//
+
+void Tool_humdiff::extractMeasurePoints(vector<MeasurePoint>& measures,
+		HumdrumFile& infile, int sourceindex) {
+	measures.clear();
+	HumRegex hre;
+	int measure = -1;
+	int barline = -1;
+	bool newmeasure = true;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		if (infile[i].isBarline()) {
+			if (hre.search(infile.token(i, 0), "(\\d+)")) {
+				measure = hre.getMatchInt(1);
+			}
+			barline = i;
+			newmeasure = true;
+			continue;
+		}
+		if (!infile[i].isData()) {
+			continue;
+		}
+		if (infile[i].getDuration() == 0) {
+			// ignore grace notes for now
+			continue;
+		}
+		if (newmeasure) {
+			measures.resize(measures.size() + 1);
+			measures.back().measure = measure;
+			measures.back().line = barline < 0 ? i : barline;
+			newmeasure = false;
+		}
+		MeasurePoint& mp = measures.back();
+		mp.duration += infile[i].getDuration();
+		getNoteList(mp.notes, infile, i, measure, sourceindex, (int)measures.size() - 1);
+	}
+
+	for (int i=0; i<(int)measures.size(); i++) {
+		MeasurePoint& mp = measures[i];
+		stable_sort(mp.notes.begin(), mp.notes.end(),
+			[](const NotePoint& a, const NotePoint& b) {
+				if (a.measurequarter != b.measurequarter) {
+					return a.measurequarter < b.measurequarter;
+				}
+				if (a.b40 != b.b40) {
+					return a.b40 < b.b40;
+				}
+				return a.duration < b.duration;
+			});
+		mp.keys.resize(mp.notes.size());
+		uint64_t fingerprint = hashValue(0, mp.duration.getNumerator());
+		fingerprint = hashValue(fingerprint, mp.duration.getDenominator());
+		for (int j=0; j<(int)mp.notes.size(); j++) {
+			NotePoint& np = mp.notes[j];
+			uint64_t key = hashValue(0, np.measurequarter.getNumerator());
+			key = hashValue(key, np.measurequarter.getDenominator());
+			key = hashValue(key, np.b40);
+			key = hashValue(key, np.duration.getNumerator());
+			key = hashValue(key, np.duration.getDenominator());
+			mp.keys[j] = key;
+			fingerprint = hashValue(fingerprint, (int64_t)key);
+		}
+		mp.fingerprint = fingerprint;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::hashValue -- Add a value to a 64-bit hash (FNV-1a
+//     style mixing of a full word).
+//
+
+uint64_t Tool_humdiff::hashValue(uint64_t hash, int64_t value) {
+	hash ^= (uint64_t)value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+	hash *= 0x100000001b3ULL;
+	return hash;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignSequences -- Find a longest common subsequence of
+//     two lists of keys, returning the pairs of indexes of matched keys
+//     in increasing order.  This is Myers' O(ND) difference algorithm
+//     with the linear-space refinement: the middle snake of the shortest
+//     edit path is found by searching from both ends at the same time,
+//     and the two halves are then solved recursively.  Only two vectors
+//     of size N+M are needed.
+//
+
+void Tool_humdiff::alignSequences(vector<pair<int, int>>& matches,
+		const vector<uint64_t>& a, const vector<uint64_t>& b) {
+	matches.clear();
+	alignRange(matches, a, 0, (int)a.size(), b, 0, (int)b.size());
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::alignRange -- Align a[alow..ahigh) with b[blow..bhigh).
+//
+
+void Tool_humdiff::alignRange(vector<pair<int, int>>& matches,
+		const vector<uint64_t>& a, int alow, int ahigh,
+		const vector<uint64_t>& b, int blow, int bhigh) {
+	// common prefix and suffix:
+	while ((alow < ahigh) && (blow < bhigh) && (a[alow] == b[blow])) {
+		matches.emplace_back(alow++, blow++);
+	}
+	int suffix = 0;
+	while ((alow < ahigh) && (blow < bhigh) && (a[ahigh-1] == b[bhigh-1])) {
+		ahigh--;
+		bhigh--;
+		suffix++;
+	}
+
+	if ((alow < ahigh) && (blow < bhigh)) {
+		int xstart;
+		int ystart;
+		int xend;
+		int yend;
+		findMiddleSnake(a, alow, ahigh, b, blow, bhigh, xstart, ystart, xend, yend);
+		alignRange(matches, a, alow, xstart, b, blow, ystart);
+		while (xstart < xend) {
+			matches.emplace_back(xstart++, ystart++);
+		}
+		alignRange(matches, a, xend, ahigh, b, yend, bhigh);
+	}
+
+	for (int i=0; i<suffix; i++) {
+		matches.emplace_back(ahigh + i, bhigh + i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_humdiff::findMiddleSnake -- Find the middle diagonal run of the
+//     shortest edit path between a[alow..ahigh) and b[blow..bhigh).  The
+//     forward and backward searches store the furthest x position reached
+//     on each diagonal k = x - y (the backward search works on the reversed
+//     sequences).  Returns the length of the edit path.
+//
+
+int Tool_humdiff::findMiddleSnake(const vector<uint64_t>& a, int alow,
+		int ahigh, const vector<uint64_t>& b, int blow, int bhigh,
+		int& xstart, int& ystart, int& xend, int& yend) {
+	int n = ahigh - alow;
+	int m = bhigh - blow;
+	int delta = n - m;
+	bool odd = delta & 1;
+	int maxd = (n + m + 1) / 2;
+	int offset = maxd + 1;
+	if ((int)m_forward.size() < 2 * offset + 1) {
+		m_forward.resize(2 * offset + 1);
+		m_backward.resize(2 * offset + 1);
+	}
+	int* forward = m_forward.data() + offset;
+	int* backward = m_backward.data() + offset;
+	forward[1] = 0;
+	backward[1] = 0;
+
+	for (int d=0; d<=maxd; d++) {
+		for (int k=-d; k<=d; k+=2) {
+			int x;
+			if ((k == -d) || ((k != d) && (forward[k-1] < forward[k+1]))) {
+				x = forward[k+1];
+			} else {
+				x = forward[k-1] + 1;
+			}
+			int y = x - k;
+			int x0 = x;
+			int y0 = y;
+			while ((x < n) && (y < m) && (a[alow+x] == b[blow+y])) {
+				x++;
+				y++;
+			}
+			forward[k] = x;
+			int rk = delta - k;
+			if (odd && (rk >= -(d-1)) && (rk <= d-1) && (x + backward[rk] >= n)) {
+				xstart = alow + x0;
+				ystart = blow + y0;
+				xend   = alow + x;
+				yend   = blow + y;
+				return 2 * d - 1;
+			}
+		}
+		for (int k=-d; k<=d; k+=2) {
+			int x;
+			if ((k == -d) || ((k != d) && (backward[k-1] < backward[k+1]))) {
+				x = backward[k+1];
+			} else {
+				x = backward[k-1] + 1;
+			}
+			int y = x - k;
+			int x0 = x;
+			int y0 = y;
+			while ((x < n) && (y < m) && (a[ahigh-1-x] == b[bhigh-1-y])) {
+				x++;
+				y++;
+			}
+			backward[k] = x;
+			int fk = delta - k;
+			if (!odd && (fk >= -d) && (fk <= d) && (x + forward[fk] >= n)) {
+				xstart = ahigh - x;
+				ystart = bhigh - y;
+				xend   = ahigh - x0;
+				yend   = bhigh - y0;
+				return 2 * d;
+			}
+		}
+	}
+
+	// not reached for valid input:
+	xstart = xend = alow;
+	ystart = yend = blow;
+	return n + m;
+}
+
+
+
 //////////////////////////////
 //
 // Tool_humdiff::extractTimePoints -- Extract a list of the timestamps in a file.
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Feb 26 09:49:14 PST 2020
-// Last Modified: Wed Feb 26 09:49:17 PST 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-humsheet.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-humsheet.cpp
 // Syntax:        C++11; humlib
@@ -34,6 +34,7 @@ Tool_humsheet::Tool_humsheet(void) {
 	define("X|no-exinterp=b", "do not embed exclusive interp data");
 	define("J|no-javascript=b", "do not embed javascript code");
 	define("S|no-style=b", "do not embed CSS style element");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Jun 17 15:24:23 CEST 2017
-// Last Modified: Sat Jul  8 17:17:21 CEST 2017
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-humsort.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-humsort.cpp
 // Syntax:        C++11; humlib
@@ -37,6 +37,7 @@ Tool_humsort::Tool_humsort(void) {
 	define("s|spine=i:1", "Spine to sort (1-indexed)");
 	define("I|do-not-ignore-case=b", "Do not ignore case when sorting alphabetically");
 	define("i|e|x|interp|exclusive-interpretation=s", "Exclusive interpretation to sort");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Jun 17 15:24:23 CEST 2017
-// Last Modified: Fri Aug 11 18:25:50 EDT 2017
+// Last Modified: Sun Oct 18 10:37:17 UTC 2026
 // Filename:      tool-imitation.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-imitation.cpp
 // Syntax:        C++11; humlib
@@ -9,8 +9,7 @@
 //
 // Description:   Counterpoint imitation tool.
 //
-// Todo:          retrograde/inversion searches
-//                imitation at specific rhythmic scaling (double, half, etc)
+// Todo:          imitation at specific rhythmic scaling (double, half, etc)
 //                add inexact rhythm for first/last note in match
 //                allow inexact rhythm after x notes with exact rhythm
 //                color imitations by interval
@@ -25,7 +24,9 @@
 #include "HumRegex.h"
 
 #include <algorithm>
+#include <climits>
 #include <cmath>
+#include <map>
 #include <sstream>
 
 using namespace std;
@@ -35,8 +36,6 @@ namespace hum {
 // START_MERGE
 
 
-int Tool_imitation::Enumerator = 0;
-
 
 /////////////////////////////////
 //
@@ -79,6 +78,7 @@ Tool_imitation::Tool_imitation(void) {
 	define("a|add=b",             "add inversions, retrograde, etc. if specified to normal search");
 	define("v|inversion=b",       "match inversions");
 	define("g|retrograde=b",      "match retrograde");
+	defineThreadOption();
 }
 
 
@@ -121,8 +121,6 @@ bool Tool_imitation::run(HumdrumFile& infile, ostream& out) {
 
 
 bool Tool_imitation::run(HumdrumFile& infile) {
-	Enumerator = 0;
-
 	NoteGrid grid(infile);
 
 	if (getBoolean("debug")) {
@@ -130,7 +128,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 		// return 1;
 	}
 
-	Enumerator = 0;
+	m_enumerator = 0;
 	m_threshold = getInteger("threshold") + 1;
 	if (m_threshold < 3) {
 		m_threshold = 3;
@@ -226,7 +224,7 @@ bool Tool_imitation::run(HumdrumFile& infile) {
 			infile.insertDataSpineBefore(track, results.at(i-1), "", exinterp);
 		}
 	}
-	if (m_mark && Enumerator) {
+	if (m_mark && m_enumerator) {
 		string rdfline = "!!!RDF**kern: ";
 		rdfline += m_marker;
 		rdfline += " = marked note (color=\"chocolate\")";
@@ -272,9 +270,258 @@ void Tool_imitation::doAnalysis(vector<vector<string> >& results,
 		getIntervals(intervals.at(i), attacks.at(i));
 	}
 
-	for (int i=0; i<(int)attacks.size(); i++) {
-		for (int j=i+1; j<(int)attacks.size(); j++) {
-			analyzeImitation(results, attacks, intervals, i, j);
+	vector<ImitationSequence> sequences;
+	getSequences(sequences, attacks, intervals);
+	ImitationCandidates candidates;
+	getCandidates(candidates, sequences);
+
+	int voices = (int)attacks.size();
+	int target = (int)sequences.size() - voices;
+	for (int i=0; i<voices; i++) {
+		for (int j=i+1; j<voices; j++) {
+			analyzeImitation(results, attacks, intervals, sequences, i,
+					target + j, candidates);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_imitation::getSequences -- Convert the attacks of each voice into
+//     symbols for matching.  The first sequence for each voice is in
+//     performance order.  If searching for inversions or retrograde,
+//     a second set of sequences is added after these with the intervals
+//     negated and/or the notes in reverse order; otherwise the first
+//     sequences are compared to each other.
+//
+
+void Tool_imitation::getSequences(vector<ImitationSequence>& sequences,
+		vector<vector<NoteCell*>>& attacks, vector<vector<double>>& intervals) {
+	int voices = (int)attacks.size();
+	bool variant = m_inversion || m_retrograde;
+	sequences.clear();
+	sequences.resize(variant ? 2 * voices : voices);
+
+	map<HumNum, int> durations;
+	for (int v=0; v<voices; v++) {
+		int size = (int)attacks.at(v).size();
+		ImitationSequence& seq = sequences.at(v);
+		seq.m_voice = v;
+		seq.m_notes.resize(size);
+		seq.m_durations.resize(size);
+		seq.m_intervals.resize(size);
+		for (int k=0; k<size; k++) {
+			seq.m_notes[k] = k;
+			seq.m_durations[k] = 0;
+			if (m_duration) {
+				HumNum duration = attacks.at(v).at(k)->getDuration();
+				auto it = durations.find(duration);
+				if (it == durations.end()) {
+					int id = (int)durations.size();
+					durations[duration] = id;
+					seq.m_durations[k] = id;
+				} else {
+					seq.m_durations[k] = it->second;
+				}
+			}
+			double interval = intervals.at(v).at(k);
+			if (Convert::isNaN(interval)) {
+				seq.m_intervals[k] = ImitationSequence::IMITATION_REST;
+			} else {
+				seq.m_intervals[k] = int(interval);
+			}
+		}
+		if (!variant) {
+			continue;
+		}
+
+		ImitationSequence& target = sequences.at(voices + v);
+		target.m_voice = v;
+		target.m_notes.resize(size);
+		target.m_durations.resize(size);
+		target.m_intervals.resize(size);
+		for (int k=0; k<size; k++) {
+			int n = m_retrograde ? size - 1 - k : k;
+			int interval;
+			if (!m_retrograde) {
+				interval = seq.m_intervals[n];
+			} else if (k < size - 1) {
+				// interval from note n back to the previous note:
+				interval = seq.m_intervals[n-1];
+				if (interval != ImitationSequence::IMITATION_REST) {
+					interval = -interval;
+				}
+			} else {
+				interval = ImitationSequence::IMITATION_REST;
+			}
+			if (m_inversion && (interval != ImitationSequence::IMITATION_REST)) {
+				interval = -interval;
+			}
+			target.m_notes[k] = n;
+			target.m_durations[k] = seq.m_durations[n];
+			target.m_intervals[k] = interval;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_imitation::getCandidates -- Find the groups of positions in the
+//     sequences which are followed by at least threshold-1 identical
+//     symbols, using a suffix array of all sequences.  The suffixes which
+//     share a prefix of that length are adjacent in the suffix array, so
+//     each run of adjacent suffixes with long enough common prefixes is
+//     one group, and every pair of its positions in different voices is a
+//     candidate match.  Each position is in at most one group, so only
+//     the groups are stored and analyzeImitation() visits the pairs of
+//     each voice pair from them.  A passage of repeated notes would
+//     otherwise give a number of pairs quadratic in its length.
+//
+
+void Tool_imitation::getCandidates(ImitationCandidates& candidates,
+		vector<ImitationSequence>& sequences) {
+	candidates.m_group.clear();
+	candidates.m_group.resize(sequences.size());
+	candidates.m_members.clear();
+	for (int s=0; s<(int)sequences.size(); s++) {
+		candidates.m_group[s].assign(sequences[s].m_intervals.size(), -1);
+	}
+
+	// Concatenate the sequences, with a unique (negative) separator after
+	// each one so that common prefixes do not cross sequence boundaries.
+	vector<int> text;
+	vector<int> owner;
+	vector<int> position;
+	map<pair<int, int>, int> symbols;
+	for (int s=0; s<(int)sequences.size(); s++) {
+		ImitationSequence& seq = sequences[s];
+		for (int k=0; k<(int)seq.m_intervals.size(); k++) {
+			pair<int, int> key(seq.m_durations[k], seq.m_intervals[k]);
+			auto it = symbols.find(key);
+			if (it == symbols.end()) {
+				int id = (int)symbols.size();
+				symbols[key] = id;
+				text.push_back(id);
+			} else {
+				text.push_back(it->second);
+			}
+			owner.push_back(s);
+			position.push_back(k);
+		}
+		text.push_back(-1 - s);
+		owner.push_back(-1);
+		position.push_back(-1);
+	}
+
+	vector<int> suffixes;
+	vector<int> lcp;
+	buildSuffixArray(suffixes, lcp, text);
+
+	// A match of threshold-1 notes needs threshold-2 matching intervals.
+	int minlcp = m_threshold - 2;
+	vector<pair<int, int>> members;
+	int n = (int)suffixes.size();
+	int start = 0;
+	for (int r=1; r<=n; r++) {
+		if ((r < n) && (lcp[r] >= minlcp)) {
+			continue;
+		}
+		if (r - start > 1) {
+			for (int t=start; t<r; t++) {
+				int s = owner[suffixes[t]];
+				if (s < 0) {
+					continue;
+				}
+				int k = position[suffixes[t]];
+				if (k >= (int)sequences[s].m_intervals.size() - 1) {
+					continue;
+				}
+				if (sequences[s].m_intervals[k] == ImitationSequence::IMITATION_REST) {
+					// sequences cannot start with rests
+					continue;
+				}
+				members.emplace_back(s, k);
+			}
+			if (members.size() > 1) {
+				int group = (int)candidates.m_members.size();
+				for (auto& member : members) {
+					candidates.m_group[member.first][member.second] = group;
+				}
+				std::sort(members.begin(), members.end());
+				candidates.m_members.push_back(members);
+			}
+			members.clear();
+		}
+		start = r;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_imitation::buildSuffixArray -- Sort the suffixes of the text by
+//     prefix doubling, and calculate the length of the longest common
+//     prefix between each suffix and the one before it in sorted order
+//     (Kasai's algorithm).
+//
+
+void Tool_imitation::buildSuffixArray(vector<int>& suffixes, vector<int>& lcp,
+		const vector<int>& text) {
+	int n = (int)text.size();
+	suffixes.resize(n);
+	lcp.assign(n, 0);
+	if (n == 0) {
+		return;
+	}
+	vector<int> rank(n);
+	vector<int> temp(n);
+	for (int i=0; i<n; i++) {
+		suffixes[i] = i;
+	}
+	std::sort(suffixes.begin(), suffixes.end(), [&](int a, int b) {
+		return text[a] < text[b];
+	});
+	rank[suffixes[0]] = 0;
+	for (int i=1; i<n; i++) {
+		rank[suffixes[i]] = rank[suffixes[i-1]] + (text[suffixes[i-1]] < text[suffixes[i]]);
+	}
+
+	for (int k=1; rank[suffixes[n-1]] < n-1; k *= 2) {
+		auto compare = [&](int a, int b) {
+			if (rank[a] != rank[b]) {
+				return rank[a] < rank[b];
+			}
+			int ra = a + k < n ? rank[a + k] : -1;
+			int rb = b + k < n ? rank[b + k] : -1;
+			return ra < rb;
+		};
+		std::sort(suffixes.begin(), suffixes.end(), compare);
+		temp[suffixes[0]] = 0;
+		for (int i=1; i<n; i++) {
+			temp[suffixes[i]] = temp[suffixes[i-1]] + compare(suffixes[i-1], suffixes[i]);
+		}
+		rank.swap(temp);
+	}
+
+	// rank is now the inverse of suffixes.
+	int h = 0;
+	for (int i=0; i<n; i++) {
+		if (rank[i] == 0) {
+			h = 0;
+			continue;
+		}
+		int j = suffixes[rank[i] - 1];
+		while ((i + h < n) && (j + h < n) && (text[i + h] == text[j + h])) {
+			h++;
+		}
+		lcp[rank[i]] = h;
+		if (h > 0) {
+			h--;
 		}
 	}
 }
@@ -307,17 +554,27 @@ void Tool_imitation::getIntervals(vector<double>& intervals,
 
 //////////////////////////////
 //
-// Tool_imitation::analyzeImitation -- do imitation analysis between two voices.
+// Tool_imitation::analyzeImitation -- do imitation analysis between two
+//     voices.  The candidate matches are the pairs of positions in the
+//     sequences index1 and index2 which are in the same candidate group,
+//     visited by position in the first sequence and then the second.
+//     After a match (or partial match), later candidates for the same
+//     note in the first voice which start inside of it are skipped.
 //
 
 void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 		vector<vector<NoteCell*>>& attacks, vector<vector<double>>& intervals,
-		int v1, int v2) {
+		vector<ImitationSequence>& sequences, int index1, int index2,
+		ImitationCandidates& candidates) {
+
+	ImitationSequence& seq1 = sequences.at(index1);
+	ImitationSequence& seq2 = sequences.at(index2);
 
+	int v1 = seq1.m_voice;
+	int v2 = seq2.m_voice;
 	vector<NoteCell*>& v1a = attacks.at(v1);
 	vector<NoteCell*>& v2a = attacks.at(v2);
 	vector<double>& v1i = intervals.at(v1);
-	vector<double>& v2i = intervals.at(v2);
 
 	int min = m_threshold - 1;
 	int count;
@@ -325,9 +582,21 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 	vector<int> enum1(v1a.size(), 0);
 	vector<int> enum2(v2a.size(), 0);
 
-	for (int i=0; i<(int)v1i.size() - 1; i++) {
-		count = 0;
-		for (int j=0; j<(int)v2i.size() - 1; j++) {
+	vector<int>& groups = candidates.m_group.at(index1);
+	for (int i=0; i<(int)groups.size(); i++) {
+		if (groups[i] < 0) {
+			continue;
+		}
+		// The (sequence, position) entries of the group are sorted, so the
+		// positions in seq2 are contiguous and in order.
+		vector<pair<int, int>>& members = candidates.m_members.at(groups[i]);
+		auto it = std::lower_bound(members.begin(), members.end(), std::make_pair(index2, 0));
+		int skip = -1;
+		for (; (it != members.end()) && (it->first == index2); it++) {
+			int p = it->second;
+			if (p <= skip) {
+				continue;
+			}
 			if (m_rest || m_rest2) {
 				if ((i > 0) && (!Convert::isNaN(attacks.at(v1).at(i-1)->getSgnDiatonicPitch()))) {
 					// match initiator must be preceded by a rest (or start of music)
@@ -335,24 +604,42 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 				}
 			}
 			if (m_rest2) {
-				if ((j > 0) && (!Convert::isNaN(attacks.at(v2).at(j-1)->getSgnDiatonicPitch()))) {
+				if ((p > 0) && (!Convert::isNaN(attacks.at(v2).at(seq2.m_notes.at(p-1))->getSgnDiatonicPitch()))) {
 					// match target must be preceded by a rest (or start of music)
 					continue;
 				}
 			}
-			if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(j))) {
+			if ((enum1.at(i) != 0) && (enum1.at(i) == enum2.at(seq2.m_notes.at(p)))) {
 				// avoid re-matching an existing match as a submatch
 				continue;
 			}
-			count = compareSequences(v1a, v1i, i, v2a, v2i, j);
+			if (m_nozero || m_onlyzero) {
+				HumNum start1 = attacks.at(v1).at(i)->getToken()->getDurationFromStart();
+				HumNum start2 = attacks.at(v2).at(seq2.m_notes.at(p))->getToken()->getDurationFromStart();
+				if (m_nozero && (start1 == start2)) {
+					// exclude matches that start at the same time.
+					continue;
+				}
+				if (m_onlyzero && (start1 != start2)) {
+					// exclude matches that do not start at the same time (parallel motion).
+					continue;
+				}
+			}
+			count = compareSequences(seq1, i, seq2, p);
 			if ((count >= min) && (m_intervals.size() > 0)) {
 				count = checkForIntervalSequence(m_intervals, v1i, i, count);
 			}
 			if (count < min) {
-				j += count;
+				skip = p + count;
 				continue;
 			}
 
+			// jfirst: the note in the second voice matched to note i in the first.
+			// j: the first note of the match in the second voice (these differ
+			// for retrograde matches).
+			int jfirst = seq2.m_notes.at(p);
+			int j = std::min(jfirst, seq2.m_notes.at(p + count - 1));
+
 			// cout << "Match length count " << count << endl;
 			HTp token1 = attacks.at(v1).at(i)->getToken();
 			HTp token2 = attacks.at(v2).at(j)->getToken();
@@ -362,17 +649,17 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 			HumNum distance2 = time1 - time2;
 
 			if (m_maxdistanceQ && (distance1.getAbs().getFloat() > m_maxdistance)) {
-				j += count;
+				skip = p + count;
 				continue;
 			}
 
-			Enumerator++;
+			m_enumerator++;
 			for (int k=0; k<count; k++) {
-				enum1.at(i+k) = Enumerator;
-				enum2.at(j+k) = Enumerator;
+				enum1.at(i+k) = m_enumerator;
+				enum2.at(seq2.m_notes.at(p+k)) = m_enumerator;
 			}
 
-			int interval = int(*attacks.at(v2).at(j) - *attacks.at(v1).at(i));
+			int interval = int(*attacks.at(v2).at(jfirst) - *attacks.at(v1).at(i));
 
 			if (!m_noInfo) {
 				if (!(m_first && (distance1 < 0))) {
@@ -392,7 +679,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v1).at(line1) += "n";
 						}
-						results.at(v1).at(line1) += to_string(Enumerator);
+						results.at(v1).at(line1) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -499,7 +786,7 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						} else {
 							results.at(v2).at(line2) += "n";
 						}
-						results.at(v2).at(line2) += to_string(Enumerator);
+						results.at(v2).at(line2) += to_string(m_enumerator);
 					}
 
 					if (m_measure) {
@@ -594,10 +881,11 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						break;
 					}
 					token1 = attacks.at(v1).at(i+z)->getToken();
-					if (j+z >= (int)attacks.at(v2).size()) {
+					if (p+z >= (int)seq2.m_notes.size()) {
 						break;
 					}
-					token2 = attacks.at(v2).at(j+z)->getToken();
+					int jz = seq2.m_notes.at(p+z);
+					token2 = attacks.at(v2).at(jz)->getToken();
 					if (m_single) {
 						if (token1->find(m_marker) == string::npos) {
 							token1->setText(*token1 + m_marker);
@@ -610,25 +898,25 @@ void Tool_imitation::analyzeImitation(vector<vector<string>>& results,
 						token2->setText(*token2 + m_marker);
 					}
 
-               if (attacks.at(v1).at(i+z)->isRest() && (z < count - 1) ) {
+					if (attacks.at(v1).at(i+z)->isRest() && (z < count - 1) ) {
 						markedTiedNotes(attacks.at(v1).at(i+z)->m_tiedtokens);
 					} else if (!attacks.at(v1).at(i+z)->isRest()) {
 						markedTiedNotes(attacks.at(v1).at(i+z)->m_tiedtokens);
 					}
 
-               if (attacks.at(v2).at(j+z)->isRest() && (z < count - 1) ) {
-						markedTiedNotes(attacks.at(v2).at(j+z)->m_tiedtokens);
-					} else if (!attacks.at(v2).at(j+z)->isRest()) {
-						markedTiedNotes(attacks.at(v2).at(j+z)->m_tiedtokens);
+					if (attacks.at(v2).at(jz)->isRest() && (z < count - 1) ) {
+						markedTiedNotes(attacks.at(v2).at(jz)->m_tiedtokens);
+					} else if (!attacks.at(v2).at(jz)->isRest()) {
+						markedTiedNotes(attacks.at(v2).at(jz)->m_tiedtokens);
 					}
 
 				}
 			}
 
 			// skip over match (need to do in i as well somehow)
-			j += count;
-		} // j loop
-	} // i loop
+			skip = p + count;
+		} // candidate loop
+	}
 }
 
 
@@ -682,91 +970,46 @@ int Tool_imitation::checkForIntervalSequence(vector<int>& m_intervals,
 ///////////////////////////////
 //
 // Tool_imitation::compareSequences -- Returns the number of notes that
-//     match between the two sequences (which is one more than the 
-//     interval count).
+//     match between the two sequences (which is one more than the
+//     interval count).  Intervals to/from rests match only other
+//     intervals to/from rests.
 //
 
-int Tool_imitation::compareSequences(vector<NoteCell*>& attack1,
-		vector<double>& seq1, int i1, vector<NoteCell*>& attack2,
-		vector<double>& seq2, int i2) {
+int Tool_imitation::compareSequences(ImitationSequence& seq1, int p1,
+		ImitationSequence& seq2, int p2) {
 	int count = 0;
+	vector<int>& int1 = seq1.m_intervals;
+	vector<int>& int2 = seq2.m_intervals;
 	// sequences cannot start with rests
-	if (Convert::isNaN(seq1.at(i1)) || Convert::isNaN(seq2.at(i2))) {
+	if ((int1.at(p1) == ImitationSequence::IMITATION_REST) || (int2.at(p2) == ImitationSequence::IMITATION_REST)) {
 		return count;
 	}
-	if (m_nozero) {
-		// exclude matches that start at the same time.
-		if (attack1.at(i1)->getToken()->getDurationFromStart() == attack2.at(i2)->getToken()->getDurationFromStart()) {
-			return count;
-		}
-	} else if (m_onlyzero) {
-		// exclude matches that do not start at the same time (parallel motion).
-		if (attack1.at(i1)->getToken()->getDurationFromStart() != attack2.at(i2)->getToken()->getDurationFromStart()) {
-			return count;
-		}
-	}
-
-	HumNum dur1;
-	HumNum dur2;
 
-	while ((i1+count < (int)seq1.size()) && (i2+count < (int)seq2.size())) {
-
-		if (m_duration) {
-			dur1 = attack1.at(i1+count)->getDuration();
-			dur2 = attack2.at(i2+count)->getDuration();
-			if (dur1 != dur2) {
-				break;
-			}
+	while ((p1+count < (int)int1.size()) && (p2+count < (int)int2.size())) {
+		if (seq1.m_durations[p1+count] != seq2.m_durations[p2+count]) {
+			break;
 		}
-
-		if (Convert::isNaN(seq1.at(i1+count))) {
-			// the first voice's interval is to/from a rest
-			if (Convert::isNaN(seq2.at(i2+count))) {
-				// The seoncd voice's interval is also to/from a rest,
-				// so increment count and continue.
-				count++;
-				continue;
-			} else {
-				// The second voice's interval is not to/from a rest,
-				// so return the current count.
-				if (count) {
-					return count + 1;
-				} else {
-					return count;
-				}
-			}
-		} else if (Convert::isNaN(seq2.at(i2+count))) {
-			// The second voice's interval is to/from a rest
-			// but already know that the first one is not, so return
-			// current count;
-			if (count) {
-				return count + 1;
-			} else {
-				return count;
-			}
-		} else if (m_inversion && (seq1.at(i1+count) == -seq2.at(i2+count))) {
-         // The two sequences match as inversions at this point, so continue.
-			count++;
-		} else if ((!m_inversion) && (seq1.at(i1+count) == seq2.at(i2+count))) {
-         // The two sequences match at this point, so continue.
+		int a = int1[p1+count];
+		int b = int2[p2+count];
+		if ((a == ImitationSequence::IMITATION_REST) && (b == ImitationSequence::IMITATION_REST)) {
+			// Both intervals are to/from a rest, so increment count and continue.
 			count++;
 			continue;
-		} else {
-			// The sequences do not match so return the current count.
+		}
+		if (a != b) {
+			// The sequences do not match (or only one interval is to/from
+			// a rest) so return the current count.
 			if (count) {
 				return count + 1;
 			} else {
 				return count;
 			}
 		}
+		count++;
 	}
 
-	if (count) {
-		// don't add one for some reaason (this will cause out-of-bounds)
-		return count;
-	} else {
-		return count;
-	}
+	// don't add one for some reaason (this will cause out-of-bounds)
+	return count;
 }
 
 
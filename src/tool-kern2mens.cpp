@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat May  5 21:06:29 PDT 2018
-// Last Modified: Sat May  5 21:06:32 PDT 2018
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-kern2mens.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-kern2mens.cpp
 // Syntax:        C++11; humlib
@@ -33,6 +33,7 @@ Tool_kern2mens::Tool_kern2mens(void) {
 	define("I|not-invisible=b",       "keep measures visible");
 	define("D|no-double-bar=b",       "keep thick final barlines");
 	define("c|clef=s",                "clef to use in mensural notation");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Mar  1 21:40:18 PST 2020
-// Last Modified: Sun Mar  1 21:40:21 PST 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-view.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-view.cpp
 // Syntax:        C++11; humlib
@@ -31,6 +31,7 @@ Tool_kernview::Tool_kernview(void) {
 	define("g=s", "Regular expression of kern spines to view");
 	define("G=s", "Regular expression of kern spines to hide");
 	define("h|hide|r|remove=s", "hide the list of spines");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Sep 13 14:58:26 PDT 2017
-// Last Modified: Thu Sep 21 13:10:56 PDT 2017
+// Last Modified: Sun Oct 18 08:32:14 UTC 2026
 // Filename:      mei2hum.cpp
 // URL:           https://github.com/craigsapp/mei2hum/blob/master/src/mei2hum.cpp
 // Syntax:        C++11; humlib
@@ -145,6 +145,7 @@ bool Tool_mei2hum::convert(ostream& out, xml_document& doc) {
 		m_outdata.enableRecipSpine();
 	}
 
+	HumArena* oldarena = HumArena::setActive(m_outdata.getArena());
 	HumNum systemstamp = 0;  // timestamp for music.
 	systemstamp = parseScore(score, systemstamp);
 
@@ -195,6 +196,7 @@ bool Tool_mei2hum::convert(ostream& out, xml_document& doc) {
 	} else {
 		m_outdata.transferTokens(outfile);
 	}
+	HumArena::setActive(oldarena);
 
 	addHeaderRecords(outfile, doc);
 	addExtMetaRecords(outfile, doc);
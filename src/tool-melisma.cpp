@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug 24 17:50:06 EDT 2019
-// Last Modified: Sat Aug 24 17:50:08 EDT 2019
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-melisma.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-melisma.cpp
 // Syntax:        C++11; humlib
@@ -32,6 +32,7 @@ Tool_melisma::Tool_melisma(void) {
 	define("a|average|avg=b",  "calculate note-to-syllable ratio");
 	define("w|words=b",        "list words that contain a melisma");
 	define("p|part=b", "also calculate note-to-syllable ratios by part");
+	defineThreadOption();
 }
 
 
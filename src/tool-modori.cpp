@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Sep 28 12:08:25 PDT 2020
-// Last Modified: Thu Dec 17 23:28:58 PST 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-modori.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-modori.cpp
 // Syntax:        C++11; humlib
@@ -45,6 +45,7 @@ Tool_modori::Tool_modori(void) {
 	define("K|no-key|no-keys=b", "Do not change key signatures");
 	define("C|no-clef|no-clefs=b", "Do not change clefs");
 	define("M|no-mensuration|no-mensurations=b", "Do not change mensurations");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Aug 27 06:15:38 PDT 2017
-// Last Modified: Sat Sep  5 18:55:53 PDT 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-msearch.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-msearch.cpp
 // Syntax:        C++11; humlib
@@ -14,6 +14,10 @@
 #include "HumRegex.h"
 #include "Convert.h"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
 using namespace std;
 
 namespace hum {
@@ -117,6 +121,432 @@ void MSearchQueryToken::parseHarmonicQuery(void) {
 
 
 
+const char MSearchIndex::INDEX_MAGIC[9] = "HUMMSIDX";
+const int MSearchIndex::INDEX_VERSION = 1;
+
+
+//////////////////////////////
+//
+// MSearchIndex::MSearchIndex -- Constructor.
+//
+
+MSearchIndex::MSearchIndex(void) {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::~MSearchIndex -- Deconstructor.
+//
+
+MSearchIndex::~MSearchIndex() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::clear -- Remove all files from the index.
+//
+
+void MSearchIndex::clear(void) {
+	m_filenames.clear();
+	m_entries.clear();
+	m_map.close();
+	m_keys     = NULL;
+	m_offsets  = NULL;
+	m_postings = NULL;
+	m_keyCount = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::addFile -- Add the trigrams of note features for each
+//    voice of a file to the index.  The filename is used to read the file
+//    again when verifying matches.
+//
+
+void MSearchIndex::addFile(HumdrumFile& infile, const string& filename) {
+	uint64_t findex = (uint64_t)m_filenames.size();
+	m_filenames.push_back(filename);
+
+	NoteGrid grid(infile);
+	vector<NoteCell*> attacks;
+	vector<int64_t> values;
+	int position = 0;
+	for (int v=0; v<grid.getVoiceCount(); v++) {
+		grid.getNoteAndRestAttacks(attacks, v);
+		int count = (int)attacks.size();
+		values.resize(count);
+		for (int f=FEATURE_PITCH40; f<FEATURE_COUNT; f++) {
+			for (int i=0; i<count; i++) {
+				values[i] = getNoteFeature(attacks, i, f);
+			}
+			for (int i=0; i<count - 2; i++) {
+				uint64_t key = makeKey(f, values[i], values[i+1], values[i+2]);
+				m_entries.emplace_back(key, (findex << 32) | (uint64_t)(position + i));
+			}
+		}
+		position += count;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::write -- Store the index in a file.  The format is
+//    "HUMMSIDX", the format version and file count (32-bit integers),
+//    the filenames (32-bit length followed by the characters), padding
+//    to a multiple of 8 bytes, the key and posting counts (64-bit
+//    integers), the sorted keys, the posting offset for each key plus
+//    a final end offset (64-bit integers), and then the file index
+//    and attack position of each posting (32-bit integers).  Integers
+//    are stored in the byte order of the computer, so that an index file
+//    can be searched in place after it has been memory-mapped.
+//
+
+bool MSearchIndex::write(const string& filename) {
+	std::ofstream output(filename, std::ios::out | std::ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+	sort(m_entries.begin(), m_entries.end());
+
+	string header(INDEX_MAGIC, 8);
+	uint32_t value32 = (uint32_t)INDEX_VERSION;
+	header.append((const char*)&value32, 4);
+	value32 = (uint32_t)m_filenames.size();
+	header.append((const char*)&value32, 4);
+	for (int i=0; i<(int)m_filenames.size(); i++) {
+		value32 = (uint32_t)m_filenames[i].size();
+		header.append((const char*)&value32, 4);
+		header += m_filenames[i];
+	}
+	header.append((8 - header.size() % 8) % 8, '\0');
+
+	vector<uint64_t> keys;
+	vector<uint64_t> offsets;
+	vector<uint32_t> postings;
+	keys.reserve(m_entries.size());
+	offsets.reserve(m_entries.size() + 1);
+	postings.reserve(m_entries.size() * 2);
+	for (int i=0; i<(int)m_entries.size(); i++) {
+		if (keys.empty() || (keys.back() != m_entries[i].first)) {
+			keys.push_back(m_entries[i].first);
+			offsets.push_back(i);
+		}
+		postings.push_back((uint32_t)(m_entries[i].second >> 32));
+		postings.push_back((uint32_t)(m_entries[i].second & 0xffffffff));
+	}
+	offsets.push_back(m_entries.size());
+
+	uint64_t counts[2] = { (uint64_t)keys.size(), (uint64_t)m_entries.size() };
+	output.write(header.data(), header.size());
+	output.write((const char*)counts, sizeof(counts));
+	output.write((const char*)keys.data(), keys.size() * sizeof(uint64_t));
+	output.write((const char*)offsets.data(), offsets.size() * sizeof(uint64_t));
+	output.write((const char*)postings.data(), postings.size() * sizeof(uint32_t));
+	output.close();
+	return !output.fail();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::read -- Load an index file written by write().  The file
+//    is memory-mapped, so only the parts of the index which are searched
+//    are read from the disk.  Returns false if the file cannot be read or
+//    is not an index file.
+//
+
+bool MSearchIndex::read(const string& filename) {
+	clear();
+	if (!m_map.open(filename)) {
+		return false;
+	}
+	const char* data = m_map.getData();
+	size_t size = m_map.getSize();
+	size_t position = 16;
+	if ((size < position) || (memcmp(data, INDEX_MAGIC, 8) != 0)) {
+		clear();
+		return false;
+	}
+	uint32_t version;
+	uint32_t filecount;
+	memcpy(&version, data + 8, 4);
+	memcpy(&filecount, data + 12, 4);
+	if ((int)version != INDEX_VERSION) {
+		clear();
+		return false;
+	}
+	for (uint32_t i=0; i<filecount; i++) {
+		uint32_t length;
+		if (size - position < 4) {
+			clear();
+			return false;
+		}
+		memcpy(&length, data + position, 4);
+		position += 4;
+		if (size - position < length) {
+			clear();
+			return false;
+		}
+		m_filenames.emplace_back(data + position, length);
+		position += length;
+	}
+	position += (8 - position % 8) % 8;
+
+	uint64_t counts[2];
+	if ((position > size) || (size - position < sizeof(counts))) {
+		clear();
+		return false;
+	}
+	memcpy(counts, data + position, sizeof(counts));
+	position += sizeof(counts);
+	uint64_t needed = counts[0] * 16 + 8 + counts[1] * 8;
+	if ((counts[0] > size) || (counts[1] > size) || (size - position != needed)) {
+		clear();
+		return false;
+	}
+	m_keyCount = counts[0];
+	m_keys     = (const uint64_t*)(data + position);
+	m_offsets  = m_keys + m_keyCount;
+	m_postings = (const uint32_t*)(m_offsets + m_keyCount + 1);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFileCount -- Return the number of files in the index.
+//
+
+int MSearchIndex::getFileCount(void) {
+	return (int)m_filenames.size();
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getFilename -- Return the name of a file in the index.
+//
+
+string MSearchIndex::getFilename(int index) {
+	return m_filenames.at(index);
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::findKey -- Return the index of a key in the index file,
+//    or -1 if the key is not present.
+//
+
+int MSearchIndex::findKey(uint64_t key) {
+	const uint64_t* found = std::lower_bound(m_keys, m_keys + m_keyCount, key);
+	if ((found == m_keys + m_keyCount) || (*found != key)) {
+		return -1;
+	}
+	return (int)(found - m_keys);
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getPostingCount -- Return the number of postings for a key
+//    in the index file.
+//
+
+int MSearchIndex::getPostingCount(uint64_t key) {
+	int index = findKey(key);
+	if (index < 0) {
+		return 0;
+	}
+	return (int)(m_offsets[index+1] - m_offsets[index]);
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getPostings -- Return the file indexes and attack positions
+//    for a key in the index file, sorted by file and then by position.
+//
+
+void MSearchIndex::getPostings(uint64_t key, vector<pair<int, int>>& postings) {
+	postings.clear();
+	int index = findKey(key);
+	if (index < 0) {
+		return;
+	}
+	postings.reserve(m_offsets[index+1] - m_offsets[index]);
+	for (uint64_t i=m_offsets[index]; i<m_offsets[index+1]; i++) {
+		postings.emplace_back((int)m_postings[2*i], (int)m_postings[2*i+1]);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::hasPosting -- Returns true if the key in the index file
+//    has a posting for the given file index and attack position.
+//
+
+bool MSearchIndex::hasPosting(uint64_t key, int file, int position) {
+	int index = findKey(key);
+	if (index < 0) {
+		return false;
+	}
+	uint64_t target = ((uint64_t)file << 32) | (uint32_t)position;
+	uint64_t low = m_offsets[index];
+	uint64_t high = m_offsets[index+1];
+	while (low < high) {
+		uint64_t mid = low + (high - low) / 2;
+		uint64_t value = ((uint64_t)m_postings[2*mid] << 32) | m_postings[2*mid+1];
+		if (value == target) {
+			return true;
+		} else if (value < target) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::makeKey -- Combine a feature type and the feature values
+//    of three successive notes into an index key.
+//
+
+uint64_t MSearchIndex::makeKey(int feature, int64_t value1, int64_t value2,
+		int64_t value3) {
+	uint64_t key = (uint64_t)feature * 0x9e3779b97f4a7c15ULL;
+	int64_t values[3] = { value1, value2, value3 };
+	for (int i=0; i<3; i++) {
+		key ^= (uint64_t)values[i] + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+		key *= 0xbf58476d1ce4e5b9ULL;
+		key ^= key >> 31;
+	}
+	return key;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getNoteFeature -- Return a feature of a note in a voice.
+//    The values are calculated in the same way as in
+//    Tool_msearch::checkForMusicMatch(), so that a note which matches a
+//    query token will always have the same feature value as the token.
+//
+
+int64_t MSearchIndex::getNoteFeature(vector<NoteCell*>& notes, int index,
+		int feature) {
+	const int64_t rest = INT64_MIN;
+	NoteCell* note = notes[index];
+	switch (feature) {
+		case FEATURE_PITCH40:
+			return note->isRest() ? rest : (int64_t)note->getAbsBase40PitchClass();
+		case FEATURE_PITCH12:
+			return note->isRest() ? rest : (int64_t)(((int)note->getAbsMidiPitch()) % 12);
+		case FEATURE_PITCH7:
+			return note->isRest() ? rest : (int64_t)(((int)note->getAbsDiatonicPitch()) % 7);
+		case FEATURE_CINTERVAL:
+		case FEATURE_DINTERVAL:
+			{
+				bool diatonicQ = feature == FEATURE_DINTERVAL;
+				double currpitch = diatonicQ ? note->getAbsDiatonicPitch() : note->getAbsBase40Pitch();
+				double nextpitch = -123456789.0;
+				if (index + 1 < (int)notes.size()) {
+					nextpitch = diatonicQ ? notes[index+1]->getAbsDiatonicPitch()
+							: notes[index+1]->getAbsBase40Pitch();
+				}
+				return (int64_t)(int)(nextpitch - currpitch);
+			}
+		case FEATURE_DURATION:
+			{
+				HumNum duration = note->getDuration();
+				return ((int64_t)duration.getNumerator() << 32) ^ (int64_t)duration.getDenominator();
+			}
+	}
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// MSearchIndex::getQueryFeature -- Return true and the feature value if
+//    the query token requires a particular value for the feature.
+//
+
+bool MSearchIndex::getQueryFeature(MSearchQueryToken& token, int feature,
+		int64_t& value) {
+	if (token.anything) {
+		return false;
+	}
+	const int64_t rest = INT64_MIN;
+	switch (feature) {
+		case FEATURE_PITCH40:
+		case FEATURE_PITCH12:
+		case FEATURE_PITCH7:
+			{
+				if (token.anypitch) {
+					return false;
+				}
+				int base = 40;
+				if ((token.base == 12) || (token.base == 7)) {
+					base = token.base;
+				}
+				if (((feature == FEATURE_PITCH40) && (base != 40)) ||
+				    ((feature == FEATURE_PITCH12) && (base != 12)) ||
+				    ((feature == FEATURE_PITCH7)  && (base != 7))) {
+					return false;
+				}
+				value = Convert::isNaN(token.pc) ? rest : (int64_t)token.pc;
+				return true;
+			}
+		case FEATURE_DINTERVAL:
+			if (token.dinterval > -1000) {
+				value = token.dinterval;
+				return true;
+			}
+			return false;
+		case FEATURE_CINTERVAL:
+			if ((token.dinterval <= -1000) && (token.cinterval > -1000)) {
+				value = token.cinterval;
+				return true;
+			}
+			return false;
+		case FEATURE_DURATION:
+			if (!token.anyrhythm) {
+				value = ((int64_t)token.duration.getNumerator() << 32)
+						^ (int64_t)token.duration.getDenominator();
+				return true;
+			}
+			return false;
+	}
+	return false;
+}
+
+
+
 /////////////////////////////////
 //
 // Tool_msearch::Tool_msearch -- Set the recognized options for the tool.
@@ -135,6 +565,7 @@ Tool_msearch::Tool_msearch(void) {
 	define("m|mark|marker=s:@",     "marking character");
 	define("M|no-mark|no-marker=b", "do not mark matches");
 	define("Q|quiet=b",             "quite mode: do not summarize matches");
+	defineThreadOption();
 }
 
 
@@ -213,6 +644,185 @@ bool Tool_msearch::run(HumdrumFile& infile) {
 }
 
 
+//////////////////////////////
+//
+// Tool_msearch::searchIndex -- Search the files in an n-gram index for
+//    the music query, printing the filename, line number and field number
+//    of the first note of each match.  The index is used to find the files
+//    and notes which can start a match, and then each candidate is checked
+//    with checkForMusicMatch().  If the query does not have three successive
+//    tokens which can be looked up in the index, all notes in all files of
+//    the index are checked.
+//
+
+bool Tool_msearch::searchIndex(MSearchIndex& index, ostream& out) {
+	m_debugQ = getBoolean("debug");
+	m_quietQ = getBoolean("quiet");
+	m_nooverlapQ = getBoolean("no-overlap");
+	initialize();
+
+	vector<MSearchQueryToken> query;
+	fillMusicQuery(query);
+	if (query.empty()) {
+		return false;
+	}
+	if (m_debugQ) {
+		printQuery(query);
+	}
+
+	// candidates: file index and attack position of the possible
+	// starting notes of matches, sorted by file and then by position.
+	vector<pair<int, int>> candidates;
+	vector<pair<uint64_t, int>> lookups;
+	bool indexQ = planIndexSearch(index, query, lookups);
+	if (indexQ) {
+		index.getPostings(lookups[0].first, candidates);
+		int start = lookups[0].second;
+		int count = 0;
+		for (int i=0; i<(int)candidates.size(); i++) {
+			int position = candidates[i].second - start;
+			if (position < 0) {
+				continue;
+			}
+			bool foundQ = true;
+			for (int j=1; j<(int)lookups.size(); j++) {
+				if (!index.hasPosting(lookups[j].first, candidates[i].first,
+						position + lookups[j].second)) {
+					foundQ = false;
+					break;
+				}
+			}
+			if (foundQ) {
+				candidates[count++] = std::make_pair(candidates[i].first, position);
+			}
+		}
+		candidates.resize(count);
+		if (m_debugQ) {
+			cerr << "INDEX CANDIDATES: " << count << endl;
+		}
+	}
+
+	int mcount = 0;
+	int c = 0;
+	vector<NoteCell*> match;
+	vector<vector<NoteCell*>> attacks;
+	vector<int> offsets;
+	for (int f=0; f<index.getFileCount(); f++) {
+		if (indexQ && ((c >= (int)candidates.size()) || (candidates[c].first != f))) {
+			continue;
+		}
+		string filename = index.getFilename(f);
+		HumdrumFile infile;
+		if (!infile.read(filename)) {
+			cerr << "Warning: cannot read " << filename << endl;
+			while ((c < (int)candidates.size()) && (candidates[c].first == f)) {
+				c++;
+			}
+			continue;
+		}
+		m_sonorities.clear();
+		m_sonorities.resize(infile.getLineCount());
+		m_sonoritiesChecked.assign(infile.getLineCount(), false);
+
+		NoteGrid grid(infile);
+		attacks.resize(grid.getVoiceCount());
+		offsets.resize(grid.getVoiceCount() + 1);
+		offsets[0] = 0;
+		for (int v=0; v<grid.getVoiceCount(); v++) {
+			grid.getNoteAndRestAttacks(attacks[v], v);
+			offsets[v+1] = offsets[v] + (int)attacks[v].size();
+		}
+
+		vector<pair<int, int>> notes;
+		if (indexQ) {
+			for (; (c < (int)candidates.size()) && (candidates[c].first == f); c++) {
+				int position = candidates[c].second;
+				int v = (int)(upper_bound(offsets.begin(), offsets.end(), position) - offsets.begin()) - 1;
+				if ((v < 0) || (v >= grid.getVoiceCount())) {
+					// index is out of date
+					continue;
+				}
+				notes.emplace_back(v, position - offsets[v]);
+			}
+		} else {
+			for (int v=0; v<grid.getVoiceCount(); v++) {
+				for (int n=0; n<(int)attacks[v].size(); n++) {
+					notes.emplace_back(v, n);
+				}
+			}
+		}
+
+		for (int i=0; i<(int)notes.size(); i++) {
+			int v = notes[i].first;
+			int n = notes[i].second;
+			bool status = checkForMusicMatch(attacks[v], n, query, match);
+			if (!status || match.empty()) {
+				continue;
+			}
+			mcount++;
+			HTp token = attacks[v][n]->getToken();
+			out << filename << "\t" << token->getLineNumber()
+			    << "\t" << token->getFieldNumber() << endl;
+		}
+	}
+
+	if (!m_quietQ) {
+		out << "!!MATCHES: " << mcount << endl;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_msearch::planIndexSearch -- Make a list of index lookups for the
+//    query.  Each feature (pitch, interval or rhythm) which is required by
+//    three successive query tokens is a possible lookup.  The lookups are
+//    sorted by the number of postings in the index, so that the first
+//    lookup gives the smallest list of candidate notes, which are then
+//    filtered by checking for postings of the other lookups.  The second
+//    value of each lookup is the index of the first of the three tokens
+//    in the query.  Returns false if there are no possible lookups.
+//
+
+bool Tool_msearch::planIndexSearch(MSearchIndex& index,
+		vector<MSearchQueryToken>& query, vector<pair<uint64_t, int>>& lookups) {
+	lookups.clear();
+	vector<pair<int, int>> order;
+	int64_t values[3];
+	for (int f=MSearchIndex::FEATURE_PITCH40; f<MSearchIndex::FEATURE_COUNT; f++) {
+		for (int i=0; i<(int)query.size() - 2; i++) {
+			bool foundQ = true;
+			for (int j=0; j<3; j++) {
+				if (!MSearchIndex::getQueryFeature(query[i+j], f, values[j])) {
+					foundQ = false;
+					break;
+				}
+			}
+			if (!foundQ) {
+				continue;
+			}
+			uint64_t key = MSearchIndex::makeKey(f, values[0], values[1], values[2]);
+			order.emplace_back(index.getPostingCount(key), (int)lookups.size());
+			lookups.emplace_back(key, i);
+		}
+	}
+	sort(order.begin(), order.end());
+	vector<pair<uint64_t, int>> sorted;
+	for (int i=0; i<(int)order.size(); i++) {
+		sorted.push_back(lookups[order[i].second]);
+	}
+	lookups.swap(sorted);
+	if (m_debugQ && !order.empty()) {
+		cerr << "INDEX LOOKUPS: " << lookups.size() << ", FEWEST POSTINGS: "
+		     << order[0].first << endl;
+	}
+	return !lookups.empty();
+}
+
+
+
 //////////////////////////////
 //
 // Tool_msearch::initialize --
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Sep 25 19:23:06 PDT 2019
-// Last Modified: Wed Sep 25 19:23:08 PDT 2019
+// Last Modified: Sun Oct 18 08:32:14 UTC 2026
 // Filename:      musedata2hum.cpp
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/src/musedata2hum.cpp
 // Syntax:        C++11; humlib
@@ -122,6 +122,7 @@ bool Tool_musedata2hum::convert(ostream& out, MuseDataSet& mds) {
 	initialize();
 
 	HumGrid outdata;
+	HumArena* oldarena = HumArena::setActive(outdata.getArena());
 	int partcount = mds.getPartCount();
 	bool status = true;
 	for (int i=0; i<partcount; i++) {
@@ -131,6 +132,7 @@ bool Tool_musedata2hum::convert(ostream& out, MuseDataSet& mds) {
 	HumdrumFile outfile;
 	outdata.transferTokens(outfile);
 	outfile.createLinesFromTokens();
+	HumArena::setActive(oldarena);
 
 	// Convert comments in header of first part:
 	for (int i=0; i< mds[0].getLineCount(); i++) {
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug  6 10:53:40 CEST 2016
-// Last Modified: Sun Jan 19 08:07:04 PST 2020
+// Last Modified: Sun Oct 18 09:34:30 UTC 2026
 // Filename:      musicxml2hum.cpp
 // URL:           https://github.com/craigsapp/hum2ly/blob/master/src/musicxml2hum.cpp
 // Syntax:        C++11; humlib
@@ -27,6 +27,19 @@
 
 #include <cctype>
 #include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+	#include <dirent.h>      /* opendir, readdir */
+	#include <sys/stat.h>    /* stat             */
+#else
+	#include <sys/types.h>
+	#include <sys/stat.h>    /* _stat            */
+#endif
 
 using namespace std;
 using namespace pugi;
@@ -46,6 +59,10 @@ Tool_musicxml2hum::Tool_musicxml2hum(void) {
 
 	define("r|recip=b", "output **recip spine");
 	define("s|stems=b", "include stems in output");
+	define("batch=b", "convert all input files (and MusicXML files in input directories)");
+	define("o|outdir=s", "directory for --batch output files (default: print segments)");
+	define("stream=b", "read partwise MusicXML one measure at a time to reduce memory usage");
+	defineThreadOption();
 
 	VoiceDebugQ = false;
 	DebugQ = false;
@@ -61,12 +78,56 @@ Tool_musicxml2hum::Tool_musicxml2hum(void) {
 
 bool Tool_musicxml2hum::convertFile(ostream& out, const char* filename) {
 	xml_document doc;
-	auto result = doc.load_file(filename);
+	vector<char> buffer;
+	return convertFile(out, filename, doc, buffer);
+}
+
+
+//
+// The document and the buffer for the contents of the file are given
+// so that they can be reused for converting many files.  The file is
+// parsed in place (pugixml stores pointers into the buffer rather than
+// copies of the text).  Errors are stored in the error text of the tool.
+//
+
+bool Tool_musicxml2hum::convertFile(ostream& out, const char* filename,
+		xml_document& doc, vector<char>& buffer) {
+	if (getBoolean("stream")) {
+		MxmlStream stream;
+		if (stream.open(filename)) {
+			return convertStream(out, stream);
+		}
+		// Otherwise read the entire file (for timewise scores,
+		// non-UTF-8 files, or to report syntax errors).
+	}
+
+	ifstream input(filename, std::ios::binary);
+	if (!input.is_open()) {
+		m_error_text << "Cannot read file: " << filename << endl;
+		return false;
+	}
+	input.seekg(0, std::ios::end);
+	std::streamoff size = input.tellg();
+	input.seekg(0, std::ios::beg);
+	if (size < 0) {
+		m_error_text << "Cannot read file: " << filename << endl;
+		return false;
+	}
+	buffer.resize((size_t)size);
+	if (size > 0) {
+		input.read(buffer.data(), size);
+	}
+	if (!input) {
+		m_error_text << "Cannot read file: " << filename << endl;
+		return false;
+	}
+
+	auto result = doc.load_buffer_inplace(buffer.data(), buffer.size());
 	if (!result) {
-		cerr << "\nXML file [" << filename << "] has syntax errors\n";
-		cerr << "Error description:\t" << result.description() << "\n";
-		cerr << "Error offset:\t" << result.offset << "\n\n";
-		exit(1);
+		m_error_text << "XML file [" << filename << "] has syntax errors: "
+		             << result.description() << " at offset "
+		             << result.offset << endl;
+		return false;
 	}
 
 	return convert(out, doc);
@@ -83,10 +144,10 @@ bool Tool_musicxml2hum::convert(ostream& out, const char* input) {
 	xml_document doc;
 	auto result = doc.load_string(input);
 	if (!result) {
-		cout << "\nXML content has syntax errors\n";
-		cout << "Error description:\t" << result.description() << "\n";
-		cout << "Error offset:\t" << result.offset << "\n\n";
-		exit(1);
+		m_error_text << "XML content has syntax errors: "
+		             << result.description() << " at offset "
+		             << result.offset << endl;
+		return false;
 	}
 
 	return convert(out, doc);
@@ -135,7 +196,102 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	reindexVoices(partdata);
 
 	HumGrid outdata;
+	HumArena* oldarena = HumArena::setActive(outdata.getArena());
 	status &= stitchParts(outdata, partids, partinfo, partcontent, partdata);
+	if (hasError()) {
+		HumArena::setActive(oldarena);
+		return false;
+	}
+
+	status &= convertGrid(out, doc, outdata, partids, partdata);
+	HumArena::setActive(oldarena);
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertStream -- Convert a partwise MusicXML file one
+//     measure at a time.  Only the measures currently being inserted into
+//     the grid are parsed into XML documents, rather than the entire score,
+//     so memory usage depends on the size of the Humdrum output rather than
+//     the size of the MusicXML file.  The output is the same as for
+//     convert().
+//
+
+bool Tool_musicxml2hum::convertStream(ostream& out, MxmlStream& stream) {
+	initialize();
+
+	bool status = true; // for keeping track of problems in conversion process.
+
+	xml_document doc;
+	if (!stream.loadSkeleton(doc)) {
+		m_error_text << stream.getError() << endl;
+		return false;
+	}
+
+	setSoftwareInfo(doc);
+	vector<string> partids;            // list of part IDs
+	map<string, xml_node> partinfo;    // mapping if IDs to score-part elements
+	map<string, xml_node> partcontent; // mapping of IDs to (empty) part elements
+
+	getPartInfo(partinfo, partids, doc);
+	m_used_hairpins.resize(partinfo.size());
+
+	m_current_dynamic.resize(partids.size());
+	m_stop_char.resize(partids.size(), "[");
+
+	getPartContent(partcontent, partids, doc);
+	vector<MxmlPart> partdata;
+	partdata.resize(partids.size());
+	m_last_ottava_direction.resize(partids.size());
+
+	// index of each part in the stream, or -1 if the part has no content:
+	vector<int> partindex(partids.size());
+	for (int i=0; i<(int)partids.size(); i++) {
+		partindex[i] = stream.getPartIndex(partids[i]);
+	}
+
+	if (!fillPartData(partdata, partids, partinfo, stream, partindex)) {
+		return false;
+	}
+
+	m_maxstaff = 0;
+	// check the voice info
+	for (int i=0; i<(int)partdata.size(); i++) {
+		partdata[i].prepareVoiceMapping();
+		m_maxstaff += partdata[i].getStaffCount();
+		// for debugging:
+		if (VoiceDebugQ) {
+			partdata[i].printStaffVoiceInfo();
+		}
+	}
+
+	HumGrid outdata;
+	HumArena* oldarena = HumArena::setActive(outdata.getArena());
+	status &= stitchParts(outdata, partdata, stream, partindex);
+	if (hasError()) {
+		HumArena::setActive(oldarena);
+		return false;
+	}
+
+	status &= convertGrid(out, doc, outdata, partids, partdata);
+	HumArena::setActive(oldarena);
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertGrid -- Convert the stitched parts into
+//     Humdrum data and print it.
+//
+
+bool Tool_musicxml2hum::convertGrid(ostream& out, xml_document& doc,
+		HumGrid& outdata, vector<string>& partids, vector<MxmlPart>& partdata) {
+	bool status = true;
 
 	if (outdata.size() > 2) {
 		if (outdata.at(0)->getDuration() == 0) {
@@ -200,9 +356,18 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	HumdrumFile outfile;
 	outdata.transferTokens(outfile);
 
+	// Lines and tokens added to the output file from now on should not
+	// be allocated from the grid's arena:
+	HumArena* gridarena = HumArena::setActive(outfile.getArena());
+
 	addHeaderRecords(outfile, doc);
 	addFooterRecords(outfile, doc);
 
+	// Analyze the tokens of the output file rather than printing the
+	// data and reading it back in (start times and note durations are
+	// taken from the grid):
+	outfile.analyzeFromTokens();
+
 	Tool_ruthfix ruthfix;
 	ruthfix.run(outfile);
 
@@ -281,6 +446,7 @@ bool Tool_musicxml2hum::convert(ostream& out, xml_document& doc) {
 	prepareRdfs(partdata);
 	printRdfs(out);
 
+	HumArena::setActive(gridarena);
 	return status;
 }
 
@@ -401,8 +567,8 @@ void Tool_musicxml2hum::printRdfs(ostream& out) {
 //
 
 void Tool_musicxml2hum::setSoftwareInfo(xml_document& doc) {
-	string xpath = "/score-partwise/identification/encoding/software";
-	string software = doc.select_node(xpath.c_str()).node().child_value();
+	string software = getFirstNode(doc, {"score-partwise", "identification",
+			"encoding", "software"}).child_value();
 	HumRegex hre;
 	if (hre.search(software, "sibelius", "i")) {
 		m_software = "sibelius";
@@ -483,13 +649,17 @@ void Tool_musicxml2hum::addHeaderRecords(HumdrumFile& outfile, xml_document& doc
 		}
 	}
 
-	xpath = "/score-partwise/credit/credit-words";
-   pugi::xpath_node_set credits = doc.select_nodes(xpath.c_str());
+	vector<xml_node> credits;
+	for (xml_node credit : doc.child("score-partwise").children("credit")) {
+		for (xml_node words : credit.children("credit-words")) {
+			credits.push_back(words);
+		}
+	}
 	map<string, int> keys;
 	vector<string> refs;
 	vector<int> positions; // +1 = above, -1 = below;
 	for (auto it = credits.begin(); it != credits.end(); it++) {
-		string contents = cleanSpaces(it->node().child_value());
+		string contents = cleanSpaces(it->child_value());
 		if (contents.empty()) {
 			continue;
 		}
@@ -524,8 +694,8 @@ void Tool_musicxml2hum::addHeaderRecords(HumdrumFile& outfile, xml_document& doc
 	// OTL: title //////////////////////////////////////////////////////////
 
 	// Sibelius method
-	xpath = "/score-partwise/work/work-title";
-	string worktitle = cleanSpaces(doc.select_node(xpath.c_str()).node().child_value());
+	string worktitle = cleanSpaces(getFirstNode(doc, {"score-partwise", "work",
+			"work-title"}).child_value());
 	string otl_record;
 	string omv_record;
 	bool worktitleQ = false;
@@ -535,8 +705,7 @@ void Tool_musicxml2hum::addHeaderRecords(HumdrumFile& outfile, xml_document& doc
 		worktitleQ = true;
 	}
 
-	xpath = "/score-partwise/movement-title";
-	string mtitle = cleanSpaces(doc.select_node(xpath.c_str()).node().child_value());
+	string mtitle = cleanSpaces(doc.child("score-partwise").child("movement-title").child_value());
 	if (mtitle != "") {
 		if (worktitleQ) {
 			omv_record = "!!!OMV: ";
@@ -549,8 +718,14 @@ void Tool_musicxml2hum::addHeaderRecords(HumdrumFile& outfile, xml_document& doc
 
 	// COM: composer /////////////////////////////////////////////////////////
 	// CDT: composer's dates
-	xpath = "/score-partwise/identification/creator[@type='composer']";
-	string composer = cleanSpaces(doc.select_node(xpath.c_str()).node().child_value());
+	xml_node composernode;
+	for (xml_node id : doc.child("score-partwise").children("identification")) {
+		composernode = id.find_child_by_attribute("creator", "type", "composer");
+		if (composernode) {
+			break;
+		}
+	}
+	string composer = cleanSpaces(composernode.child_value());
 	string cdt_record;
 	if (composer != "") {
 		if (hre.search(composer, R"(\((.*?\d.*?)\))")) {
@@ -624,7 +799,7 @@ void Tool_musicxml2hum::addHeaderRecords(HumdrumFile& outfile, xml_document& doc
 void Tool_musicxml2hum::addFooterRecords(HumdrumFile& outfile, xml_document& doc) {
 
 	// YEM: copyright
-	string copy = doc.select_node("/score-partwise/identification/rights").node().child_value();
+	string copy = getFirstNode(doc, {"score-partwise", "identification", "rights"}).child_value();
 	bool validcopy = true;
 	if (copy == "") {
 		validcopy = false;
@@ -858,28 +1033,75 @@ bool Tool_musicxml2hum::fillPartData(MxmlPart& partdata,
 	// be 28-30 staffs too many.
 	m_last_ottava_direction.at(partdata.getPartIndex()).resize(32);
 
-	int count;
-	auto measures = partcontent.select_nodes("./measure");
-	for (int i=0; i<(int)measures.size(); i++) {
-		partdata.addMeasure(measures[i].node());
-		count = partdata.getMeasureCount();
-		if (count > 1) {
-			HumNum dur = partdata.getMeasure(count-1)->getTimeSigDur();
-			if (dur == 0) {
-				HumNum dur = partdata.getMeasure(count-2)
-						->getTimeSigDur();
-				if (dur > 0) {
-					partdata.getMeasure(count - 1)->setTimeSigDur(dur);
-				}
-			}
+	for (xml_node measure : partcontent.children("measure")) {
+		addPartMeasure(partdata, measure);
+	}
+	return true;
+}
+
+
+//
+// Streaming version: the measures of each part are parsed one at a
+// time to collect the information which the measures report to their
+// part (staff/voice usage, verse counts, etc.), which is needed before
+// any measure can be inserted into the grid.  Each measure is deleted
+// after the following one has been parsed, and stitchParts() parses
+// them again when inserting them into the grid.
+//
+
+bool Tool_musicxml2hum::fillPartData(vector<MxmlPart>& partdata,
+		const vector<string>& partids, map<string, xml_node>& partinfo,
+		MxmlStream& stream, const vector<int>& partindex) {
+	xml_document doc;
+	for (int i=0; i<(int)partdata.size(); i++) {
+		partdata[i].setPartNumber(i+1);
+		if (m_stemsQ) {
+			partdata[i].enableStems();
 		}
+		partdata[i].parsePartInfo(partinfo[partids[i]]);
+		m_last_ottava_direction.at(i).resize(32);
 
+		int count = stream.getMeasureCount(partindex[i]);
+		for (int m=0; m<count; m++) {
+			xml_node measure = stream.loadMeasure(doc, partindex[i], m);
+			if (!measure) {
+				m_error_text << stream.getError() << endl;
+				return false;
+			}
+			addPartMeasure(partdata[i], measure);
+			partdata[i].deleteMeasure(m-1);
+		}
+		partdata[i].clearMeasures();
 	}
 	return true;
 }
 
 
 
+//////////////////////////////
+//
+// Tool_musicxml2hum::addPartMeasure -- Append a measure to a part, using
+//     the time signature of the previous measure if the new measure does
+//     not have one.
+//
+
+void Tool_musicxml2hum::addPartMeasure(MxmlPart& partdata, xml_node measure) {
+	partdata.addMeasure(measure);
+	int count = partdata.getMeasureCount();
+	if (count > 1) {
+		HumNum dur = partdata.getMeasure(count-1)->getTimeSigDur();
+		if (dur == 0) {
+			HumNum dur = partdata.getMeasure(count-2)
+					->getTimeSigDur();
+			if (dur > 0) {
+				partdata.getMeasure(count - 1)->setTimeSigDur(dur);
+			}
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // Tool_musicxml2hum::printPartInfo -- Debug information.
@@ -899,10 +1121,11 @@ void Tool_musicxml2hum::printPartInfo(vector<string>& partids,
 		     << getChildElementText(partinfo[partids[i]], "part-abbreviation")
 		     << endl;
 		auto node = partcontent[partids[i]];
-		auto measures = node.select_nodes("./measure");
-		cout << "\t\tMeasure count:\t" << measures.size() << endl;
-		if (maxmeasure < (int)measures.size()) {
-			maxmeasure = (int)measures.size();
+		int measures = (int)std::distance(node.children("measure").begin(),
+				node.children("measure").end());
+		cout << "\t\tMeasure count:\t" << measures << endl;
+		if (maxmeasure < measures) {
+			maxmeasure = measures;
 		}
 		cout << "\t\tTotal duration:\t" << partdata[i].getDuration() << endl;
 	}
@@ -1025,10 +1248,10 @@ bool Tool_musicxml2hum::stitchParts(HumGrid& outdata,
 	// i used to start at 1 for some strange reason.
 	for (i=0; i<(int)partdata.size(); i++) {
 		if (measurecount != partdata[i].getMeasureCount()) {
-			cerr << "ERROR: cannot handle parts with different measure\n";
-			cerr << "counts yet. Compare MM" << measurecount << " to MM";
-			cerr << partdata[i].getMeasureCount() << endl;
-			exit(1);
+			m_error_text << "ERROR: cannot handle parts with different measure\n";
+			m_error_text << "counts yet. Compare MM" << measurecount << " to MM";
+			m_error_text << partdata[i].getMeasureCount() << endl;
+			return false;
 		}
 	}
 
@@ -1054,6 +1277,147 @@ bool Tool_musicxml2hum::stitchParts(HumGrid& outdata,
 }
 
 
+//
+// Streaming version: the measures are parsed again one column (the same
+// measure in every part) at a time.  Three columns of measure documents
+// are kept: the column being inserted into the grid, the next column
+// (since a forward repeat is stored in the barline style of the previous
+// measure), and the previous column (since directions at the end of a
+// measure are attached to the first note of the following measure).
+//
+
+bool Tool_musicxml2hum::stitchParts(HumGrid& outdata,
+		vector<MxmlPart>& partdata, MxmlStream& stream,
+		const vector<int>& partindex) {
+	if (partdata.size() == 0) {
+		return false;
+	}
+
+	int i;
+	int partcount = (int)partdata.size();
+	int measurecount = stream.getMeasureCount(partindex[0]);
+	for (i=0; i<partcount; i++) {
+		int count = stream.getMeasureCount(partindex[i]);
+		if (measurecount != count) {
+			m_error_text << "ERROR: cannot handle parts with different measure\n";
+			m_error_text << "counts yet. Compare MM" << measurecount << " to MM";
+			m_error_text << count << endl;
+			return false;
+		}
+	}
+
+	vector<int> partstaves(partcount, 0);
+	for (i=0; i<(int)partstaves.size(); i++) {
+		partstaves[i] = partdata[i].getStaffCount();
+	}
+
+	const int columns = 3;
+	vector<xml_document> docs(columns * partcount);
+	m_carry.reset();
+
+	bool status = true;
+	for (int m=-1; m<measurecount; m++) {
+		if (m + 1 < measurecount) {
+			int column = (m + 1) % columns;
+			for (i=0; i<partcount; i++) {
+				xml_document& doc = docs[column * partcount + i];
+				partdata[i].deleteMeasure(m + 1 - columns);
+				releaseMeasureNodes(doc);
+				xml_node measure = stream.loadMeasure(doc, partindex[i], m + 1);
+				if (!measure) {
+					m_error_text << stream.getError() << endl;
+					break;
+				}
+				addPartMeasure(partdata[i], measure);
+			}
+			if (hasError()) {
+				break;
+			}
+		}
+		if (m < 0) {
+			continue;
+		}
+		for (i=0; i<partcount; i++) {
+			reindexMeasure(partdata[i].getMeasure(m));
+		}
+		status &= insertMeasure(outdata, m, partdata, partstaves);
+	}
+
+	for (i=0; i<(int)docs.size(); i++) {
+		releaseMeasureNodes(docs[i]);
+	}
+	for (i=0; i<partcount; i++) {
+		partdata[i].clearMeasures();
+	}
+	if (hasError()) {
+		return false;
+	}
+
+	moveBreaksToEndOfPreviousMeasure(outdata);
+
+	insertPartNames(outdata, partdata);
+
+	return status;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::releaseMeasureNodes -- Remove references to the
+//     nodes of a measure document before it is reused.  Directions which
+//     are still waiting to be attached to a note are copied into m_carry.
+//
+
+void Tool_musicxml2hum::releaseMeasureNodes(xml_document& doc) {
+	for (int i=0; i<(int)m_current_dynamic.size(); i++) {
+		for (int j=0; j<(int)m_current_dynamic[i].size(); j++) {
+			carryNode(m_current_dynamic[i][j], doc);
+		}
+	}
+	for (int i=0; i<(int)m_current_figured_bass.size(); i++) {
+		carryNode(m_current_figured_bass[i], doc);
+	}
+	for (int i=0; i<(int)m_current_text.size(); i++) {
+		carryNode(m_current_text[i].second, doc);
+	}
+	for (int i=0; i<(int)m_current_tempo.size(); i++) {
+		carryNode(m_current_tempo[i].second, doc);
+	}
+	for (auto& it : m_post_note_text) {
+		for (int i=0; i<(int)it.second.size(); i++) {
+			carryNode(it.second[i], doc);
+		}
+	}
+
+	// Used hairpins are only compared by node identity, so references
+	// to a released document can be dropped (and must be, since the nodes
+	// of the next measure parsed into the document may reuse the memory).
+	for (int i=0; i<(int)m_used_hairpins.size(); i++) {
+		vector<xml_node>& hairpins = m_used_hairpins[i];
+		for (int j=(int)hairpins.size()-1; j>=0; j--) {
+			if (hairpins[j].root() == doc) {
+				hairpins.erase(hairpins.begin() + j);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::carryNode -- If the node belongs to the given
+//     document, replace it with a copy stored in m_carry.
+//
+
+void Tool_musicxml2hum::carryNode(xml_node& node, xml_document& doc) {
+	if (node && (node.root() == doc)) {
+		node = m_carry.append_copy(node);
+	}
+}
+
+
 
 //////////////////////////////
 //
@@ -2599,10 +2963,10 @@ void Tool_musicxml2hum::addHairpinEnding(GridPart* part, MxmlEvent* event, int p
 
 string Tool_musicxml2hum::convertFiguredBassNumber(const xml_node& figure) {
 	string output;
-	xml_node fnum = figure.select_node("figure-number").node();
+	xml_node fnum = figure.child("figure-number");
 	// assuming one each of prefix/suffix:
-	xml_node prefixelement = figure.select_node("prefix").node();
-	xml_node suffixelement = figure.select_node("suffix").node();
+	xml_node prefixelement = figure.child("prefix");
+	xml_node suffixelement = figure.child("suffix");
 
 	string prefix;
 	if (prefixelement) {
@@ -2669,7 +3033,7 @@ string Tool_musicxml2hum::convertFiguredBassNumber(const xml_node& figure) {
 	string editorial;
 	string extension;
 
-	xml_node extendelement = figure.select_node("extend").node();
+	xml_node extendelement = figure.child("extend");
 	if (extendelement) {
 		string typestring = extendelement.attribute("type").value();
 		if (typestring == "start") {
@@ -2962,9 +3326,12 @@ string Tool_musicxml2hum::getFiguredBassString(xml_node fnode) {
 	}
 	// There is no bracket for FB in musicxml (3.0).
 
-	auto children = fnode.select_nodes("figure");
+	vector<xml_node> children;
+	for (xml_node figure : fnode.children("figure")) {
+		children.push_back(figure);
+	}
 	for (int i=0; i<(int)children.size(); i++) {
-		output += convertFiguredBassNumber(children[i].node());
+		output += convertFiguredBassNumber(children[i]);
 		output += editorial;
 		if (i < (int)children.size() - 1) {
 			output += " ";
@@ -3505,8 +3872,7 @@ void Tool_musicxml2hum::appendZeroEvents(GridMeasure* outdata,
 					if (nodeType(child, "key")) {
 						keysigs[pindex].push_back(child);
 						haskeysig = true;
-						string xpath = "mode";
-						string mode = child.select_node(xpath.c_str()).node().child_value();
+						string mode = child.child("mode").child_value();
 						if (mode != "") {
 							haskeydesignation = true;
 						}
@@ -3627,7 +3993,7 @@ void Tool_musicxml2hum::appendZeroEvents(GridMeasure* outdata,
 void Tool_musicxml2hum::storeOttava(int pindex, xml_node octaveShift, xml_node direction,
 	vector<vector<vector<xml_node>>>& ottavas) {
 	int staffindex = 0;
-	xml_node staffnode = direction.select_node("staff").node();
+	xml_node staffnode = direction.child("staff");
 	if (staffnode && staffnode.text()) {
 		int staffnum = staffnode.text().as_int();
 		if (staffnum > 0) {
@@ -4845,7 +5211,10 @@ bool Tool_musicxml2hum::getPartContent(
 		map<string, xml_node>& partcontent,
 		vector<string>& partids, xml_document& doc) {
 
-	auto parts = doc.select_nodes("/score-partwise/part");
+	vector<xml_node> parts;
+	for (xml_node part : doc.child("score-partwise").children("part")) {
+		parts.push_back(part);
+	}
 	int count = (int)parts.size();
 	if (count != (int)partids.size()) {
 		cerr << "Warning: part element count does not match part IDs count: "
@@ -4858,7 +5227,7 @@ bool Tool_musicxml2hum::getPartContent(
 		if (partid.size() == 0) {
 			cerr << "Warning: Part " << i << " has no ID" << endl;
 		}
-		auto status = partcontent.insert(make_pair(partid, parts[i].node()));
+		auto status = partcontent.insert(make_pair(partid, parts[i]));
 		if (status.second == false) {
 			cerr << "Error: ID " << partids.back()
 			     << " is duplicated and secondary part will be ignored" << endl;
@@ -4896,18 +5265,23 @@ bool Tool_musicxml2hum::getPartContent(
 
 bool Tool_musicxml2hum::getPartInfo(map<string, xml_node>& partinfo,
 		vector<string>& partids, xml_document& doc) {
-	auto scoreparts = doc.select_nodes("/score-partwise/part-list/score-part");
+	vector<xml_node> scoreparts;
+	for (xml_node partlist : doc.child("score-partwise").children("part-list")) {
+		for (xml_node scorepart : partlist.children("score-part")) {
+			scoreparts.push_back(scorepart);
+		}
+	}
 	partids.reserve(scoreparts.size());
 	bool output = true;
 	for (auto el : scoreparts) {
-		partids.emplace_back(getAttributeValue(el.node(), "id"));
-		auto status = partinfo.insert(make_pair(partids.back(), el.node()));
+		partids.emplace_back(getAttributeValue(el, "id"));
+		auto status = partinfo.insert(make_pair(partids.back(), el));
 		if (status.second == false) {
 			cerr << "Error: ID " << partids.back()
 			     << " is duplicated and secondary part will be ignored" << endl;
 		}
 		output &= status.second;
-		partinfo[partids.back()] = el.node();
+		partinfo[partids.back()] = el;
 	}
 	return output;
 }
@@ -5042,7 +5416,7 @@ void Tool_musicxml2hum::printAttributes(xml_node node) {
 string Tool_musicxml2hum::getSystemDecoration(xml_document& doc, HumGrid& grid,
 	vector<string>& partids) {
 
-	xml_node partlist = doc.select_node("/score-partwise/part-list").node();
+	xml_node partlist = doc.child("score-partwise").child("part-list");
 	if (!partlist) {
 		cerr << "Error: cannot find partlist\n";
 		return "";
@@ -5073,6 +5447,13 @@ string Tool_musicxml2hum::getSystemDecoration(xml_document& doc, HumGrid& grid,
 	int pcounter = 0;
 	scounter = 1;
 	vector<string> typeendings(100);
+
+	// The first group-symbol in the document (in document order) is used
+	// for every part group:
+	xml_node groupsymbol = doc.find_node([](xml_node node) {
+		return strcmp(node.name(), "group-symbol") == 0;
+	});
+
 	for (int i=0; i<(int)children.size(); i++) {
 		string name = children[i].name();
 		if (name == "part-group") {
@@ -5080,7 +5461,7 @@ string Tool_musicxml2hum::getSystemDecoration(xml_document& doc, HumGrid& grid,
 			string gsymbol = "";
 			int number = children[i].attribute("number").as_int();
 			if (grouptype == "start") {
-				string g = children[i].select_node("//group-symbol").node().child_value();
+				string g = groupsymbol.child_value();
 				if (g == "bracket") {
 					output += "[(";
 					typeendings[number] = ")]";
@@ -5138,6 +5519,240 @@ void Tool_musicxml2hum::getChildrenVector(vector<xml_node>& children,
 }
 
 
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::getFirstNode -- Return the first element (in
+//   document order) at the end of a path of element names, such as
+//   {"score-partwise", "work", "work-title"}.  This is the same as the
+//   first result of the XPath query "/score-partwise/work/work-title",
+//   but without compiling and evaluating the query.
+//
+
+xml_node Tool_musicxml2hum::getFirstNode(xml_node parent,
+		const vector<string>& path, int index) {
+	if (index >= (int)path.size()) {
+		return parent;
+	}
+	const char* name = path[index].c_str();
+	for (xml_node child : parent.children(name)) {
+		xml_node output = getFirstNode(child, path, index + 1);
+		if (output) {
+			return output;
+		}
+	}
+	return xml_node();
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::convertFiles -- Convert a list of MusicXML files (or
+//   directories containing MusicXML files) with a pool of -j threads.
+//   Each thread reuses one XML document and one file buffer for all of
+//   the files that it converts.  If the -o option is given, each file
+//   is written to the output directory with a .krn extension, otherwise
+//   the conversions are printed in input order as segments of a Humdrum
+//   stream (with at most one file per thread waiting to be printed).
+//   Files that cannot be converted are reported in the error text
+//   (one line per file) and do not stop the other conversions.  Nothing
+//   is converted if an input directory cannot be read, or if two input
+//   files would be written to the same file in the output directory.
+//   Returns false if any file could not be converted.
+//
+
+bool Tool_musicxml2hum::convertFiles(ostream& out,
+		const vector<string>& filenames) {
+	vector<string> files;
+	bool status = true;
+	for (int i=0; i<(int)filenames.size(); i++) {
+		status &= getInputFiles(files, filenames[i]);
+	}
+	bool outdirQ = getBoolean("outdir");
+	string outdir = getString("outdir");
+	if (outdirQ) {
+		// Input files with the same name in different directories would
+		// overwrite each other in the output directory:
+		map<string, int> outnames;
+		for (int i=0; i<(int)files.size(); i++) {
+			string outname = getOutputFilename(files[i]);
+			auto it = outnames.find(outname);
+			if (it != outnames.end()) {
+				m_error_text << files[i] << ":\tSame output file as "
+				             << files[it->second] << ": " << outdir << "/"
+				             << outname << endl;
+				status = false;
+			} else {
+				outnames[outname] = i;
+			}
+		}
+	}
+	if (!status) {
+		return false;
+	}
+
+	std::mutex mutex;
+	std::condition_variable turn;
+	int readindex  = 0;
+	int writeindex = 0;
+	map<int, string> errors;
+
+	auto worker = [&]() {
+		xml_document doc;
+		vector<char> buffer;
+		while (true) {
+			int index;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (readindex >= (int)files.size()) {
+					break;
+				}
+				index = readindex++;
+			}
+
+			Tool_musicxml2hum converter;
+			converter.process(argv());
+			stringstream output;
+			bool status = converter.convertFile(output, files[index].c_str(),
+					doc, buffer);
+			string error;
+			if (!status) {
+				error = converter.getError();
+				if (error.empty()) {
+					error = "Could not convert file";
+				}
+			} else if (outdirQ) {
+				string outname = outdir + "/" + getOutputFilename(files[index]);
+				std::ofstream outfile(outname, std::ios::binary);
+				outfile << output.str();
+				outfile.close();
+				if (!outfile) {
+					error = "Cannot write file: " + outname;
+					status = false;
+				}
+			}
+			while (!error.empty() && std::isspace(error.back())) {
+				error.pop_back();
+			}
+			for (int i=0; i<(int)error.size(); i++) {
+				if (error[i] == '\n') {
+					error[i] = ' ';
+				}
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			if (!status) {
+				errors[index] = error;
+			}
+			if (!outdirQ) {
+				turn.wait(lock, [&]() { return writeindex == index; });
+				if (status) {
+					out << "!!!!SEGMENT: " << getOutputFilename(files[index]) << "\n";
+					out << output.str();
+				}
+				writeindex++;
+				turn.notify_all();
+			}
+		}
+	};
+
+	int threads = getThreadCount();
+	if (threads <= 1) {
+		worker();
+	} else {
+		vector<std::thread> pool;
+		for (int i=0; i<threads; i++) {
+			pool.emplace_back(worker);
+		}
+		for (int i=0; i<(int)pool.size(); i++) {
+			pool[i].join();
+		}
+	}
+
+	for (auto& it : errors) {
+		m_error_text << files[it.first] << ":\t" << it.second << endl;
+	}
+	return errors.empty();
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::getInputFiles -- Add a file to the list of files to
+//   convert, or the MusicXML files (.xml and .musicxml) in a directory
+//   sorted by name.  Subdirectories are not searched.  Reading
+//   directories is not implemented for Windows, so directories given
+//   as input files are reported as errors there.  Returns false if the
+//   path cannot be added.
+//
+
+bool Tool_musicxml2hum::getInputFiles(vector<string>& files,
+		const string& path) {
+#ifdef _WIN32
+	struct _stat info;
+	if ((_stat(path.c_str(), &info) == 0) && (info.st_mode & _S_IFDIR)) {
+		m_error_text << path << ":\tDirectory input is not supported on Windows"
+		             << endl;
+		return false;
+	}
+#else
+	struct stat info;
+	if ((stat(path.c_str(), &info) == 0) && S_ISDIR(info.st_mode)) {
+		DIR* dir = opendir(path.c_str());
+		if (!dir) {
+			m_error_text << path << ":\tCannot read directory" << endl;
+			return false;
+		}
+		vector<string> names;
+		struct dirent* entry;
+		while ((entry = readdir(dir)) != NULL) {
+			string name = entry->d_name;
+			size_t dot = name.rfind('.');
+			if ((dot == string::npos) || (dot == 0)) {
+				continue;
+			}
+			string extension = name.substr(dot);
+			if ((extension == ".xml") || (extension == ".musicxml")) {
+				names.push_back(name);
+			}
+		}
+		closedir(dir);
+		sort(names.begin(), names.end());
+		for (int i=0; i<(int)names.size(); i++) {
+			files.push_back(path + "/" + names[i]);
+		}
+		return true;
+	}
+#endif
+	files.push_back(path);
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_musicxml2hum::getOutputFilename -- Return the filename without
+//   the directory and with a .krn extension instead of the original one.
+//
+
+string Tool_musicxml2hum::getOutputFilename(const string& filename) {
+	string output = filename;
+	size_t slash = output.find_last_of("/\\");
+	if (slash != string::npos) {
+		output = output.substr(slash + 1);
+	}
+	size_t dot = output.rfind('.');
+	if ((dot != string::npos) && (dot > 0)) {
+		output.resize(dot);
+	}
+	output += ".krn";
+	return output;
+}
+
+
 // END_MERGE
 
 } // end namespace hum
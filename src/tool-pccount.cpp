@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Sep  7 20:22:22 PDT 2019
-// Last Modified: Sat Sep  7 20:22:25 PDT 2019
+// Last Modified: Sun Oct 18 14:53:01 UTC 2026
 // Filename:      tool-pccount.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-pccount.cpp
 // Syntax:        C++11; humlib
@@ -15,6 +15,8 @@
 #include "HumRegex.h"
 #include "Convert.h"
 
+#include <cstring>
+
 using namespace std;
 
 namespace hum {
@@ -43,6 +45,22 @@ Tool_pccount::Tool_pccount(void) {
 	define("title=s", "Title for plot");
 	define("t|template|vega-template=b", "display the vega-lite template.");
 	define("w|width=i:400", "width of vega-lite plot");
+	define("csv=b", "print pitch-class profiles as CSV");
+	define("binary=b", "write pitch-class profiles in packed binary format");
+	define("measures=b", "print CSV/binary profiles for each measure");
+	defineThreadOption();
+}
+
+
+
+///////////////////////////////
+//
+// Tool_pccount::isBatchMode -- True if the profiles of all input files
+//     should be printed as a single CSV or binary stream.
+//
+
+bool Tool_pccount::isBatchMode(void) {
+	return getBoolean("csv") || getBoolean("binary");
 }
 
 
@@ -80,6 +98,78 @@ bool Tool_pccount::run(HumdrumFile& infile) {
 }
 
 
+//
+// Streaming interface for CSV (default) or --binary profiles of a corpus.
+// Files are parsed and counted by a pool of -j threads (see
+// runStreamPool()), each with its own copy of the tool.  The profiles of
+// each file are written to the output in input order.  The corpus totals
+// for each part index (with partial sums kept by each copy of the tool)
+// are written at the end with the filename "*".
+//
+
+bool Tool_pccount::run(HumdrumFileStream& instream, ostream& out) {
+	m_attack   = getBoolean("attacks");
+	m_binary   = getBoolean("binary");
+	m_csv      = !m_binary;
+	m_measures = getBoolean("measures");
+	if (m_binary) {
+		writeBinaryHeader(out);
+	} else {
+		printCsvHeader(out);
+	}
+
+	bool csv      = m_csv;
+	bool binary   = m_binary;
+	bool measures = m_measures;
+	auto process = [csv, binary, measures](Tool_pccount& tool,
+			HumdrumFileSet& infiles, StreamSegmentResult& result) {
+		HumdrumFile& infile = infiles[0];
+		tool.initialize(infile);
+		tool.m_csv    = csv;
+		tool.m_binary = binary;
+		tool.countPitches(infile);
+		if (measures) {
+			tool.countMeasures(infile);
+		}
+		stringstream block;
+		tool.printProfiles(block, infile.getFilename());
+		result.text = block.str();
+		addTotals(tool.m_totals, tool.m_counts);
+	};
+
+	vector<vector<double>> totals;
+	auto finish = [&totals](Tool_pccount& tool) {
+		addTotals(totals, tool.m_totals);
+	};
+
+	int status = runStreamPool<Tool_pccount>(instream, argv(),
+			getThreadCount(), out, process, finish);
+
+	printTotals(out, totals);
+	return status == 0;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::addTotals -- Add pitch-class counts to totals, indexed
+//     by part.
+//
+
+void Tool_pccount::addTotals(vector<vector<double>>& totals,
+		const vector<vector<double>>& counts) {
+	if (totals.size() < counts.size()) {
+		totals.resize(counts.size(), vector<double>(40, 0.0));
+	}
+	for (int i=0; i<(int)counts.size(); i++) {
+		for (int j=0; j<(int)counts[i].size(); j++) {
+			totals[i][j] += counts[i][j];
+		}
+	}
+}
+
+
 
 //////////////////////////////
 //
@@ -103,6 +193,9 @@ void Tool_pccount::initialize(HumdrumFile& infile) {
 	}
 	m_html       = getBoolean("html");
 	m_page       = getBoolean("page");
+	m_csv        = getBoolean("csv");
+	m_binary     = getBoolean("binary");
+	m_measures   = getBoolean("measures");
 	if (getBoolean("id")) {
 		m_id = getString("id");
 	} else {
@@ -226,7 +319,17 @@ void Tool_pccount::processFile(HumdrumFile& infile) {
 		jsonvar = "vega_" + m_id + "_dur";
 	}
 
-	if (m_template) {
+	if (m_csv || m_binary) {
+		if (m_measures) {
+			countMeasures(infile);
+		}
+		if (m_binary) {
+			writeBinaryHeader(m_free_text);
+		} else {
+			printCsvHeader(m_free_text);
+		}
+		printProfiles(m_free_text, infile.getFilename());
+	} else if (m_template) {
 		printVegaLiteJsonTemplate(datavar, infile);
 	} else if (m_data) {
 		printVegaLiteJsonData();
@@ -524,31 +627,343 @@ void Tool_pccount::addCounts(HTp sstart, HTp send) {
 			current = current->getNextToken();
 			continue;
 		}
-		if (current->isNull() || current->isRest()) {
-			current = current->getNextToken();
+		addTokenCounts(current, m_counts[kindex].data());
+		current = current->getNextToken();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::addTokenCounts -- Add the pitch classes of a **kern data
+//     token (durations, or attacks if -a is used) to a list of 40 counts.
+//
+
+void Tool_pccount::addTokenCounts(HTp token, double* counts) {
+	if (token->isNull() || token->isRest()) {
+		return;
+	}
+	if (token->find(' ') == string::npos) {
+		addSubtokenCounts(*token, counts);
+		return;
+	}
+	vector<string> subtokens = token->getSubtokens();
+	for (int i=0; i<(int)subtokens.size(); i++) {
+		addSubtokenCounts(subtokens[i], counts);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::addSubtokenCounts -- Add the pitch class of a single note.
+//
+
+void Tool_pccount::addSubtokenCounts(const string& subtoken, double* counts) {
+	if (m_attack) {
+		// ignore sustained parts of notes when counting attacks
+		if (subtoken.find("_") != string::npos) {
+			return;
+		}
+		if (subtoken.find("]") != string::npos) {
+			return;
+		}
+	}
+	int b40 = Convert::kernToBase40(subtoken);
+	if (b40 < 0) {
+		return;
+	}
+	if (m_attack) {
+		counts[b40%40]++;
+	} else {
+		counts[b40%40] += Convert::recipToDuration(subtoken).getFloat();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::countMeasures -- Count pitch classes separately for each
+//     measure.  A new measure starts at each barline with a new bar number
+//     (so unnumbered barlines do not split measures).  Notes before the
+//     first numbered barline are in measure 0.  The counts for all parts
+//     are stored in part 0 as in countPitches().
+//
+
+void Tool_pccount::countMeasures(HumdrumFile& infile) {
+	m_measurecounts.clear();
+	m_measurenums.clear();
+	int parts = (int)m_parttracks.size();
+	if (parts == 0) {
+		return;
+	}
+	int size = parts * 40;
+	vector<int> barnums = infile.getMeasureNumbers();
+	int lastnum = -1;
+	for (int i=0; i<infile.getLineCount(); i++) {
+		int num = barnums[i] < 0 ? 0 : barnums[i];
+		if (num != lastnum) {
+			m_measurenums.push_back(num);
+			m_measurecounts.resize(m_measurecounts.size() + size, 0.0);
+			lastnum = num;
+		}
+		if (!infile[i].isData()) {
 			continue;
 		}
-		vector<string> subtokens = current->getSubtokens();
-		for (int i=0; i<(int)subtokens.size(); i++) {
-			if (m_attack) {
-				// ignore sustained parts of notes when counting attacks
-				if (subtokens[i].find("_") != string::npos) {
-					continue;
+		double* counts = m_measurecounts.data() + m_measurecounts.size() - size;
+		for (int j=0; j<infile[i].getFieldCount(); j++) {
+			HTp token = infile.token(i, j);
+			if (!token->isKern()) {
+				continue;
+			}
+			int kindex = m_rkern[token->getTrack()];
+			if (kindex < 0) {
+				continue;
+			}
+			addTokenCounts(token, counts + kindex * 40);
+		}
+	}
+
+	// fill in sum for all parts
+	for (int m=0; m<(int)m_measurenums.size(); m++) {
+		double* counts = m_measurecounts.data() + m * size;
+		for (int j=1; j<parts; j++) {
+			for (int i=0; i<40; i++) {
+				counts[i] += counts[j * 40 + i];
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::printProfiles -- Print the pitch-class counts of the
+//     current file for each part (and all parts as part 0), either for the
+//     whole file or for each measure if --measures is used.  Measures
+//     without notes are not printed.  Only the 35 valid base-40 pitch
+//     classes are included.
+//
+
+void Tool_pccount::printProfiles(ostream& out, const string& filename) {
+	int parts = (int)m_counts.size();
+	vector<int> measures;
+	vector<double> counts;
+	if (m_measures) {
+		for (int m=0; m<(int)m_measurenums.size(); m++) {
+			const double* mcounts = m_measurecounts.data() + m * parts * 40;
+			bool empty = true;
+			for (int i=0; i<40; i++) {
+				if (mcounts[i] != 0.0) {
+					empty = false;
+					break;
 				}
-				if (subtokens[i].find("]") != string::npos) {
+			}
+			if (empty) {
+				continue;
+			}
+			measures.push_back(m_measurenums[m]);
+			counts.insert(counts.end(), mcounts, mcounts + parts * 40);
+		}
+	} else {
+		measures.push_back(-1);
+		for (int i=0; i<parts; i++) {
+			counts.insert(counts.end(), m_counts[i].begin(), m_counts[i].end());
+		}
+	}
+
+	vector<string> names(parts);
+	for (int i=0; i<parts; i++) {
+		if (i < (int)m_names.size()) {
+			names[i] = m_names[i];
+		}
+	}
+
+	if (m_binary) {
+		writeBinaryBlock(out, filename, names, measures, counts);
+		return;
+	}
+	for (int m=0; m<(int)measures.size(); m++) {
+		for (int i=0; i<parts; i++) {
+			printCsvRow(out, filename, measures[m], i, names[i],
+					counts.data() + (m * parts + i) * 40);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::printTotals -- Print the sum of all counts in a corpus by
+//     part index.  The filename is "*".
+//
+
+void Tool_pccount::printTotals(ostream& out, vector<vector<double>>& totals) {
+	vector<string> names(totals.size());
+	vector<double> counts;
+	for (int i=0; i<(int)totals.size(); i++) {
+		counts.insert(counts.end(), totals[i].begin(), totals[i].end());
+	}
+	if (!names.empty()) {
+		names[0] = "all";
+	}
+	if (m_binary) {
+		writeBinaryBlock(out, "*", names, vector<int>(1, -1), counts);
+		return;
+	}
+	for (int i=0; i<(int)totals.size(); i++) {
+		printCsvRow(out, "*", -1, i, names[i], counts.data() + i * 40);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::printCsvHeader -- The columns are the filename, the
+//     measure (empty for counts of the whole file), the part index (0
+//     for all parts), the part name, and then the counts for each pitch
+//     class as **kern pitches from c-- to b##.
+//
+
+void Tool_pccount::printCsvHeader(ostream& out) {
+	out << "file,measure,part,name";
+	for (int i=0; i<40; i++) {
+		if ((i == 5) || (i == 11) || (i == 22) || (i == 28) || (i == 34)) {
+			continue;
+		}
+		out << "," << Convert::base40ToKern(i + 4*40);
+	}
+	out << "\n";
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::printCsvRow --
+//
+
+void Tool_pccount::printCsvRow(ostream& out, const string& filename,
+		int measure, int part, const string& name, const double* counts) {
+	std::streamsize precision = out.precision(12);
+	out << getCsvField(filename) << ",";
+	if (measure >= 0) {
+		out << measure;
+	}
+	out << "," << part << "," << getCsvField(name);
+	for (int i=0; i<40; i++) {
+		if ((i == 5) || (i == 11) || (i == 22) || (i == 28) || (i == 34)) {
+			continue;
+		}
+		out << ",";
+		if (counts[i] != 0.0) {
+			out << counts[i];
+		} else {
+			out << "0";
+		}
+	}
+	out << "\n";
+	out.precision(precision);
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::getCsvField -- Quote a CSV field if necessary.
+//
+
+string Tool_pccount::getCsvField(const string& value) {
+	if (value.find_first_of(",\"\n\r") == string::npos) {
+		return value;
+	}
+	string output = "\"";
+	for (int i=0; i<(int)value.size(); i++) {
+		if (value[i] == '"') {
+			output += '"';
+		}
+		output += value[i];
+	}
+	output += '"';
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::writeBinaryHeader -- Write the header of the binary
+//    profile format.  All values are little-endian.  The 16-byte header is:
+//
+//       0  char[8]  "HUMPCCNT"
+//       8  uint16   format version (1)
+//      10  uint16   flags (bit 0: attack counts, bit 1: measure profiles)
+//      12  uint16   number of pitch classes in a profile (35)
+//      14  uint16   reserved (0)
+//
+//    Each file is then a block:
+//
+//       uint32  length of the filename, followed by the filename
+//       uint32  number of parts (P), including all parts as part 0
+//       P x     uint32 length of part name, followed by the name
+//       uint32  number of rows (R)
+//       R x     int32 measure (-1 for the whole file), followed by
+//               P x 35 float64 counts (part by part, c-- to b##)
+//
+//    The corpus totals are a final block with the filename "*".
+//
+
+void Tool_pccount::writeBinaryHeader(ostream& out) {
+	string header = "HUMPCCNT";
+	Convert::appendLittleEndian(header, 1, 2);
+	Convert::appendLittleEndian(header, (m_attack ? 1 : 0) | (m_measures ? 2 : 0), 2);
+	Convert::appendLittleEndian(header, 35, 2);
+	Convert::appendLittleEndian(header, 0, 2);
+	out.write(header.data(), header.size());
+}
+
+
+
+//////////////////////////////
+//
+// Tool_pccount::writeBinaryBlock -- Write the profiles for a file.
+//
+
+void Tool_pccount::writeBinaryBlock(ostream& out, const string& filename,
+		const vector<string>& names, const vector<int>& measures,
+		const vector<double>& counts) {
+	int parts = (int)names.size();
+	string buffer;
+	buffer.reserve(32 + filename.size() + measures.size() * (4 + parts * 35 * 8));
+	Convert::appendLittleEndian(buffer, filename.size(), 4);
+	buffer += filename;
+	Convert::appendLittleEndian(buffer, parts, 4);
+	for (int i=0; i<parts; i++) {
+		Convert::appendLittleEndian(buffer, names[i].size(), 4);
+		buffer += names[i];
+	}
+	Convert::appendLittleEndian(buffer, measures.size(), 4);
+	for (int m=0; m<(int)measures.size(); m++) {
+		Convert::appendLittleEndian(buffer, (uint32_t)measures[m], 4);
+		for (int i=0; i<parts; i++) {
+			const double* pcounts = counts.data() + (m * parts + i) * 40;
+			for (int j=0; j<40; j++) {
+				if ((j == 5) || (j == 11) || (j == 22) || (j == 28) || (j == 34)) {
 					continue;
 				}
-			}
-			int b40 = Convert::kernToBase40(subtokens[i]);
-			if (m_attack) {
-				m_counts[kindex][b40%40]++;
-			} else {
-				double duration = Convert::recipToDuration(subtokens[i]).getFloat();
-				m_counts[kindex][b40%40] += duration;
+				uint64_t value;
+				std::memcpy(&value, pcounts + j, sizeof(value));
+				Convert::appendLittleEndian(buffer, value, 8);
 			}
 		}
-		current = current->getNextToken();
 	}
+	out.write(buffer.data(), buffer.size());
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Jul 15 09:57:12 CEST 2018
-// Last Modified: Sun Jul 15 09:57:16 CEST 2018
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-periodicity.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-periodicity.cpp
 // Syntax:        C++11; humlib
@@ -38,6 +38,7 @@ Tool_periodicity::Tool_periodicity(void) {
 	define("s|svg=b", "output svg image");
 	define("p|power=d:2.0", "scaling power for visual display");
 	define("1|one=b", "composite rhythms are not weighted by attack");
+	defineThreadOption();
 }
 
 
@@ -146,13 +147,25 @@ void Tool_periodicity::printPeriodicityAnalysis(ostream& out, vector<vector<doub
 
 //////////////////////////////
 //
-// Tool_periodicity::doPeriodicAnalysis --
+// Tool_periodicity::doPeriodicAnalysis -- Only the attack positions of the
+//     grid contribute to the analysis, so these are extracted once and
+//     folded into each period, which is much faster than scanning the
+//     full grid for each period when minrhy is small compared to the
+//     note durations.
 //
 
 void Tool_periodicity::doPeriodicityAnalysis(vector<vector<double>> &analysis, vector<double>& grid, HumNum minrhy) {
+	vector<int> positions;
+	vector<double> weights;
+	for (int i=0; i<(int)grid.size(); i++) {
+		if (grid[i] != 0.0) {
+			positions.push_back(i);
+			weights.push_back(grid[i]);
+		}
+	}
 	analysis.resize(minrhy.getNumerator());
 	for (int i=0; i<(int)analysis.size(); i++) {
-		doAnalysis(analysis, i, grid);
+		doAnalysis(analysis, i, positions, weights);
 	}
 }
 
@@ -160,19 +173,20 @@ void Tool_periodicity::doPeriodicityAnalysis(vector<vector<double>> &analysis, v
 
 //////////////////////////////
 //
-// Tool_periodicity::doAnalysis --
+// Tool_periodicity::doAnalysis -- Sum the attacks at each phase of the
+//     period for the given level.  positions are the grid indexes of the
+//     attacks (in increasing order) and weights are the grid values at
+//     those positions.
 //
 
-void Tool_periodicity::doAnalysis(vector<vector<double>>& analysis, int level, vector<double>& grid) {
+void Tool_periodicity::doAnalysis(vector<vector<double>>& analysis, int level,
+		vector<int>& positions, vector<double>& weights) {
 	int period = level + 1;
 	analysis[level].resize(period);
 	std::fill(analysis[level].begin(), analysis[level].end(), 0.0);
-	for (int i=0; i<period; i++) {
-		int j = i;
-		while (j < (int)grid.size()) {
-			analysis[level][i] += grid[j];
-			j += period;
-		}
+	double* sums = analysis[level].data();
+	for (int i=0; i<(int)positions.size(); i++) {
+		sums[positions[i] % period] += weights[i];
 	}
 }
 
@@ -223,6 +237,9 @@ void Tool_periodicity::fillAttackGrids(HumdrumFile& infile, vector<vector<double
 		grids[t].resize(elements.getNumerator());
 	}
 
+	// grids[0] is the composite rhythm of all tracks, which is either
+	// the number of attacks at each position or 1 if there are any.
+	bool oneQ = getBoolean("one");
 	for (int i=0; i<infile.getLineCount(); i++) {
 		if (!infile[i].isData()) {
 			continue;
@@ -241,20 +258,10 @@ void Tool_periodicity::fillAttackGrids(HumdrumFile& infile, vector<vector<double
 			}
 			int track = token->getTrack();
 			grids.at(track).at(position.getNumerator()) += 1;
-		}
-	}
-
-	bool oneQ = getBoolean("one");
-	for (int j=0; j<(int)grids.at(0).size(); j++) {
-		grids.at(0).at(j) = 0;
-		for (int i=0; i<(int)grids.size(); i++) {
-			if (!grids.at(i).at(j)) {
-				continue;
-			}
 			if (oneQ) {
-				grids.at(0).at(j) = 1;
+				grids.at(0).at(position.getNumerator()) = 1;
 			} else {
-				grids.at(0).at(j) += grids.at(i).at(j);
+				grids.at(0).at(position.getNumerator()) += 1;
 			}
 		}
 	}
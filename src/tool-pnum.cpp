@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Apr 10 08:59:49 EDT 2019
-// Last Modified: Wed Apr 10 10:21:32 EDT 2019
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-pnum.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-pnum.cpp
 // Syntax:        C++11; humlib
@@ -38,6 +38,7 @@ Tool_pnum::Tool_pnum(void) {
 	define("r|rest=s:0",         "representation string for rests");
 	define("R|no-rests=b",       "do not include rests in conversion");
 	define("x|attacks-only=b",   "only mark lines with note attacks");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Dec  7 08:01:07 PST 2016
-// Last Modified: Wed Dec  7 12:40:28 PST 2016
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-recip.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-recip.cpp
 // Syntax:        C++11; humlib
@@ -43,6 +43,7 @@ Tool_recip::Tool_recip(void) {
 	define("e|exinterp=s:**recip",   "use the given exinterp for data output");
 	define("n|kern-pitch=s:e",       "note to add for '-e kern' option");
 	define("kern=b",                 "equivalent to '-e kern' option");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Jul 14 01:03:07 CEST 2019
-// Last Modified: Sun Jul 14 01:03:12 CEST 2019
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-restfill.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-restfill.cpp
 // Syntax:        C++11; humlib
@@ -30,6 +30,7 @@ namespace hum {
 Tool_restfill::Tool_restfill(void) {
 	define("y|hidden-rests=b",        "hide inserted rests");
 	define("i|exinterp=s:kern",       "type of spine to fill with rests");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Nov 23 05:24:14 PST 2009
-// Last Modified: Sun Feb  2 22:47:01 PST 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-rid.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-rid.cpp
 // Syntax:        C++11; humlib
@@ -46,6 +46,7 @@ Tool_rid::Tool_rid(void) {
    define("M|all-barlines=b", "remove measure lines");
    define("C|all-comments=b", "remove all comment lines");
    define("c=b", "remove global and local comment lines");
+   defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Feb  6 14:33:36 PST 2011
-// Last Modified: Wed Jan  1 21:19:24 PST 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-satb2gs.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-satb2gs.cpp
 // Syntax:        C++11; humlib
@@ -31,6 +31,7 @@ namespace hum {
 
 Tool_satb2gs::Tool_satb2gs(void) {
 	// no options
+	defineThreadOption();
 }
 
 
@@ -37,6 +37,7 @@ Tool_scordatura::Tool_scordatura(void) {
 	define("d|diatonic=i:0", "diatonic interval of marked pitches");
 	define("color=s", "color marked pitches");
 	define("string=s", "string number");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Fri Nov 13 02:39:59 PST 2020
-// Last Modified: Sat Nov 14 21:25:35 PST 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-semitones.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-semitones.cpp
 // Syntax:        C++11; humlib
@@ -48,6 +48,7 @@ Tool_semitones::Tool_semitones(void) {
 	define("s|step=b", "highlight notes that have step-wise motion");
 	define("u|up=b", "highlight notes that that have a positive semitone interval");
 	define("x|exclude=s", "exclude **kern tokens with given pattern");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Oct 13 11:41:16 PDT 2019
-// Last Modified: Mon Oct 28 21:56:33 PDT 2019
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-shed.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-shed.cpp
 // Syntax:        C++11; humlib
@@ -35,6 +35,7 @@ Tool_shed::Tool_shed(void) {
 	define("X=s", "defineable exclusive interpretation x");
 	define("Y=s", "defineable exclusive interpretation y");
 	define("Z=s", "defineable exclusive interpretation z");
+	defineThreadOption();
 }
 
 
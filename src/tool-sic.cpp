@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Thu Jan 30 22:26:33 PST 2020
-// Last Modified: Thu Jan 30 22:26:35 PST 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-sic.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-sic.cpp
 // Syntax:        C++11; humlib
@@ -32,6 +32,7 @@ Tool_sic::Tool_sic(void) {
 	define("r|remove=b", "remove sic layout tokens");
 	define("v|verbose=b", "add verbose parameter");
 	define("q|quiet=b", "remove verbose parameter");
+	defineThreadOption();
 }
 
 
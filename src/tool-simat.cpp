@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Jul 15 09:57:12 CEST 2018
-// Last Modified: Sun Jul 15 09:57:16 CEST 2018
+// Last Modified: Sun Oct 18 15:03:10 UTC 2026
 // Filename:      tool-simat.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-simat.cpp
 // Syntax:        C++11; humlib
@@ -13,7 +13,10 @@
 #include "tool-simat.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <sstream>
+#include <thread>
 
 #include "Convert.h"
 #include "HumRegex.h"
@@ -450,6 +453,171 @@ double MeasureDataSet::getScoreDuration(void) {
 
 
 
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::MeasureHistogramMatrix --
+//
+
+MeasureHistogramMatrix::MeasureHistogramMatrix(void) {
+	// do nothing
+}
+
+
+MeasureHistogramMatrix::MeasureHistogramMatrix(MeasureDataSet& set) {
+	load(set);
+}
+
+
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::~MeasureHistogramMatrix --
+//
+
+MeasureHistogramMatrix::~MeasureHistogramMatrix() {
+	clear();
+}
+
+
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::clear --
+//
+
+void MeasureHistogramMatrix::clear(void) {
+	m_values.clear();
+	m_state.clear();
+	m_size = 0;
+	m_set = NULL;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::load -- Center each measure's pitch-class
+//    histogram on its mean and scale it to unit length.  Measures with
+//    no notes are marked EMPTY, and measures with the same duration for
+//    every pitch class (no variance) are marked FLAT.
+//
+
+void MeasureHistogramMatrix::load(MeasureDataSet& set) {
+	m_set = &set;
+	m_size = set.size();
+	m_values.assign(7 * m_size, 0.0);
+	m_state.assign(m_size, EMPTY);
+	double centered[7];
+	for (int i=0; i<m_size; i++) {
+		if (set[i].getSum7pc() == 0.0) {
+			continue;
+		}
+		std::vector<double>& hist = set[i].getHistogram7pc();
+		double mean = 0.0;
+		for (int k=0; k<7; k++) {
+			mean += hist[k];
+		}
+		mean /= 7.0;
+		double sumsq = 0.0;
+		for (int k=0; k<7; k++) {
+			centered[k] = hist[k] - mean;
+			sumsq += centered[k] * centered[k];
+		}
+		if (sumsq == 0.0) {
+			m_state[i] = FLAT;
+			continue;
+		}
+		double scale = 1.0 / sqrt(sumsq);
+		for (int k=0; k<7; k++) {
+			m_values[k * m_size + i] = centered[k] * scale;
+		}
+		m_state[i] = NORMAL;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::getRow -- Return the normalized values of the
+//    given pitch class for all measures.
+//
+
+const double* MeasureHistogramMatrix::getRow(int pc) const {
+	return m_values.data() + pc * m_size;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureHistogramMatrix::correlateRow -- Store the correlations between
+//    measure "index" and measures startcol to stopcol-1 of "other" in
+//    output.  The results are the same as MeasureComparison::compare()
+//    up to floating-point error.  Values close to halfway between two
+//    printed (two-decimal) values are calculated again as in compare()
+//    so that they print the same.
+//
+
+void MeasureHistogramMatrix::correlateRow(const MeasureHistogramMatrix& other,
+		int index, int startcol, int stopcol, double* output) const {
+	int count = stopcol - startcol;
+	int state = m_state[index];
+
+	if (state == EMPTY) {
+		for (int j=0; j<count; j++) {
+			output[j] = other.m_state[startcol + j] == EMPTY ? 1.0 : 0.0;
+		}
+		return;
+	}
+	if (state == FLAT) {
+		for (int j=0; j<count; j++) {
+			output[j] = other.m_state[startcol + j] == EMPTY ? 0.0 : NAN;
+		}
+		return;
+	}
+
+	const double a0 = m_values[0 * m_size + index];
+	const double a1 = m_values[1 * m_size + index];
+	const double a2 = m_values[2 * m_size + index];
+	const double a3 = m_values[3 * m_size + index];
+	const double a4 = m_values[4 * m_size + index];
+	const double a5 = m_values[5 * m_size + index];
+	const double a6 = m_values[6 * m_size + index];
+	const double* b0 = other.getRow(0) + startcol;
+	const double* b1 = other.getRow(1) + startcol;
+	const double* b2 = other.getRow(2) + startcol;
+	const double* b3 = other.getRow(3) + startcol;
+	const double* b4 = other.getRow(4) + startcol;
+	const double* b5 = other.getRow(5) + startcol;
+	const double* b6 = other.getRow(6) + startcol;
+	for (int j=0; j<count; j++) {
+		output[j] = a0 * b0[j] + a1 * b1[j] + a2 * b2[j] + a3 * b3[j]
+				+ a4 * b4[j] + a5 * b5[j] + a6 * b6[j];
+	}
+
+	const char* states = other.m_state.data() + startcol;
+	for (int j=0; j<count; j++) {
+		if (states[j] == EMPTY) {
+			output[j] = 0.0;
+		} else if (states[j] == FLAT) {
+			output[j] = NAN;
+		} else if (fabs(output[j] - 1.0) < 0.00000001) {
+			output[j] = 1.0;
+		} else {
+			double scaled = fabs(output[j]) * 100.0;
+			if (fabs(scaled - floor(scaled) - 0.5) < 0.000001) {
+				MeasureComparison comparison((*m_set)[index],
+						(*other.m_set)[startcol + j]);
+				output[j] = comparison.getCorrelation7pc();
+			}
+		}
+	}
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 
 //////////////////////////////
@@ -578,35 +746,217 @@ MeasureComparisonGrid::~MeasureComparisonGrid() {
 
 void MeasureComparisonGrid::clear(void) {
 	m_grid.clear();
+	m_matches.clear();
+	m_rows = 0;
+	m_cols = 0;
+}
+
+
+
+//////////////////////////////
+//
+// runMeasureBlocks -- Call worker(block) for each block from 0 to
+//    blocks-1, using the given number of threads.
+//
+
+template <class WORKER>
+static void runMeasureBlocks(int blocks, int threads, WORKER worker) {
+	if (threads > blocks) {
+		threads = blocks;
+	}
+	if (threads <= 1) {
+		for (int i=0; i<blocks; i++) {
+			worker(i);
+		}
+		return;
+	}
+	std::atomic<int> next(0);
+	auto loop = [&]() {
+		int block;
+		while ((block = next++) < blocks) {
+			worker(block);
+		}
+	};
+	std::vector<std::thread> pool;
+	for (int i=0; i<threads; i++) {
+		pool.emplace_back(loop);
+	}
+	for (int i=0; i<(int)pool.size(); i++) {
+		pool[i].join();
+	}
 }
 
 
 
 //////////////////////////////
 //
-// MeasureComparisonGrid::analyze --
+// MeasureComparisonGrid::analyze -- Calculate the correlation between
+//    every measure in set1 and every measure in set2.  The grid is
+//    calculated in tiles of rows and columns so that the histograms for
+//    a range of columns are reused while they are in the cache, and
+//    tiles of rows are distributed over the given number of threads.
+//    default value: threads = 1
 //
 
-void MeasureComparisonGrid::analyze(MeasureDataSet* set1, MeasureDataSet* set2) {
-	analyze(*set1, *set2);
+void MeasureComparisonGrid::analyze(MeasureDataSet* set1, MeasureDataSet* set2,
+		int threads) {
+	analyze(*set1, *set2, threads);
 }
 
-void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2) {
-	m_grid.resize(set1.size());
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		m_grid[i].resize(set2.size());
+void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2,
+		int threads) {
+	clear();
+	MeasureHistogramMatrix matrix1(set1);
+	MeasureHistogramMatrix matrix2;
+	if (&set1 != &set2) {
+		matrix2.load(set2);
 	}
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			m_grid[i][j].compare(set1[i], set2[j]);
+	const MeasureHistogramMatrix& columns = (&set1 == &set2) ? matrix1 : matrix2;
+
+	m_rows = matrix1.size();
+	m_cols = columns.size();
+	m_grid.resize((size_t)m_rows * m_cols);
+
+	const int rowtile = 32;
+	const int coltile = 1024;
+	int blocks = (m_rows + rowtile - 1) / rowtile;
+	runMeasureBlocks(blocks, threads, [&](int block) {
+		int startrow = block * rowtile;
+		int stoprow = std::min(startrow + rowtile, m_rows);
+		for (int c=0; c<m_cols; c+=coltile) {
+			int stopcol = std::min(c + coltile, m_cols);
+			for (int i=startrow; i<stoprow; i++) {
+				matrix1.correlateRow(columns, i, c, stopcol,
+						m_grid.data() + (size_t)i * m_cols + c);
+			}
 		}
+	});
+
+	m_set1 = &set1;
+	m_set2 = &set2;
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::analyzeTopMatches -- Find the count most
+//    similar measures in set2 for each measure in set1, without storing
+//    the full correlation grid.  Each row keeps a heap of its best
+//    matches while the columns are scanned.  Ties are resolved in favor
+//    of the earlier measure, and measures which have an undefined
+//    correlation are skipped.  If skipdiagonal is true, a measure is
+//    not compared to the measure with the same index (for comparing a
+//    score to itself).
+//    default value: skipdiagonal = false
+//    default value: threads = 1
+//
+
+void MeasureComparisonGrid::analyzeTopMatches(MeasureDataSet& set1,
+		MeasureDataSet& set2, int count, bool skipdiagonal, int threads) {
+	clear();
+	MeasureHistogramMatrix matrix1(set1);
+	MeasureHistogramMatrix matrix2;
+	if (&set1 != &set2) {
+		matrix2.load(set2);
 	}
+	const MeasureHistogramMatrix& columns = (&set1 == &set2) ? matrix1 : matrix2;
+
+	m_rows = matrix1.size();
+	m_cols = columns.size();
+	m_matches.resize(m_rows);
+	if (count <= 0) {
+		m_set1 = &set1;
+		m_set2 = &set2;
+		return;
+	}
+
+	// better(a, b): a is a better match than b (for heap ordering the
+	// worst match is at the front of the heap).
+	auto better = [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+		if (a.first != b.first) {
+			return a.first > b.first;
+		}
+		return a.second < b.second;
+	};
+
+	const int rowtile = 32;
+	const int coltile = 1024;
+	int blocks = (m_rows + rowtile - 1) / rowtile;
+	runMeasureBlocks(blocks, threads, [&](int block) {
+		int startrow = block * rowtile;
+		int stoprow = std::min(startrow + rowtile, m_rows);
+		std::vector<double> buffer(coltile);
+		std::vector<std::vector<std::pair<double, int>>> heaps(stoprow - startrow);
+		for (int c=0; c<m_cols; c+=coltile) {
+			int stopcol = std::min(c + coltile, m_cols);
+			for (int i=startrow; i<stoprow; i++) {
+				matrix1.correlateRow(columns, i, c, stopcol, buffer.data());
+				std::vector<std::pair<double, int>>& heap = heaps[i - startrow];
+				for (int j=c; j<stopcol; j++) {
+					double value = buffer[j - c];
+					if (std::isnan(value)) {
+						continue;
+					}
+					if (skipdiagonal && (i == j)) {
+						continue;
+					}
+					std::pair<double, int> entry(value, j);
+					if ((int)heap.size() < count) {
+						heap.push_back(entry);
+						std::push_heap(heap.begin(), heap.end(), better);
+					} else if (better(entry, heap.front())) {
+						std::pop_heap(heap.begin(), heap.end(), better);
+						heap.back() = entry;
+						std::push_heap(heap.begin(), heap.end(), better);
+					}
+				}
+			}
+		}
+		for (int i=startrow; i<stoprow; i++) {
+			std::vector<std::pair<double, int>>& heap = heaps[i - startrow];
+			std::sort_heap(heap.begin(), heap.end(), better);
+			m_matches[i].reserve(heap.size());
+			for (int k=0; k<(int)heap.size(); k++) {
+				m_matches[i].emplace_back(heap[k].second, heap[k].first);
+			}
+		}
+	});
+
 	m_set1 = &set1;
 	m_set2 = &set2;
 }
 
 
 
+//////////////////////////////
+//
+// MeasureComparisonGrid::getCorrelation -- Return the correlation between
+//    the given measures of the first and second sets.
+//
+
+double MeasureComparisonGrid::getCorrelation(int index1, int index2) {
+	return m_grid.at((size_t)index1 * m_cols + index2);
+}
+
+
+
+//////////////////////////////
+//
+// MeasureComparisonGrid::printCorrelation -- Print a correlation value
+//    rounded to two decimal places.
+//
+
+void MeasureComparisonGrid::printCorrelation(ostream& out, double correl) {
+	if (correl > 0.0) {
+		out << int(correl * 100.0 + 0.5)/100.0;
+	} else {
+		out << -int(-correl * 100.0 + 0.5)/100.0;
+	}
+}
+
+
+
 //////////////////////////////
 //
 // MeasureComparisonGrid::printCorrelationGrid --
@@ -614,15 +964,10 @@ void MeasureComparisonGrid::analyze(MeasureDataSet& set1, MeasureDataSet& set2)
 //
 
 ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			double correl = m_grid[i][j].getCorrelation7pc();
-			if (correl > 0.0) {
-				out << int(correl * 100.0 + 0.5)/100.0;
-			} else {
-				out << -int(-correl * 100.0 + 0.5)/100.0;
-			}
-			if (j < (int)m_grid[i].size() - 1) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
+			printCorrelation(out, getCorrelation(i, j));
+			if (j < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -640,18 +985,10 @@ ostream& MeasureComparisonGrid::printCorrelationGrid(ostream& out) {
 //
 
 ostream& MeasureComparisonGrid::printCorrelationDiagonal(ostream& out) {
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
-			if (i != j) {
-				continue;
-			}
-			double correl = m_grid[i][j].getCorrelation7pc();
-			if (correl > 0.0) {
-				out << int(correl * 100.0 + 0.5)/100.0;
-			} else {
-				out << -int(-correl * 100.0 + 0.5)/100.0;
-			}
-			if (j < (int)m_grid[i].size() - 1) {
+	for (int i=0; i<m_rows; i++) {
+		if (i < m_cols) {
+			printCorrelation(out, getCorrelation(i, i));
+			if (i < m_cols - 1) {
 				out << '\t';
 			}
 		}
@@ -662,6 +999,28 @@ ostream& MeasureComparisonGrid::printCorrelationDiagonal(ostream& out) {
 
 
 
+//////////////////////////////
+//
+// MeasureComparisonGrid::printTopMatches -- Print the results of
+//    analyzeTopMatches(), one line for each match: the measure number in
+//    the first score, the measure number in the second score and the
+//    correlation between them, with the best matches first.
+//    default value: out = std::cout
+//
+
+ostream& MeasureComparisonGrid::printTopMatches(ostream& out) {
+	for (int i=0; i<(int)m_matches.size(); i++) {
+		for (int k=0; k<(int)m_matches[i].size(); k++) {
+			out << getMeasure1(i) << '\t' << getMeasure2(m_matches[i][k].first) << '\t';
+			printCorrelation(out, m_matches[i][k].second);
+			out << endl;
+		}
+	}
+	return out;
+}
+
+
+
 //////////////////////////////
 //
 // MeasureComparisonGrid::getColorMapping --
@@ -949,15 +1308,15 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 	double sdur1 = getScoreDuration1();
 	double sdur2 = getScoreDuration2();
 
-	for (int i=0; i<(int)m_grid.size(); i++) {
-		for (int j=0; j<(int)m_grid[i].size(); j++) {
+	for (int i=0; i<m_rows; i++) {
+		for (int j=0; j<m_cols; j++) {
 			width = getDuration2(j) / sdur2 * imagewidth;
 			height = getDuration1(i) / sdur1 * imageheight;
 
 			x = getStartTime2(j)/sdur2 * imageheight;
 			y = getStartTime1(i)/sdur1 * imagewidth;
 
-			getColorMapping(m_grid[i][j].getCorrelation7pc(), hue, saturation, lightness);
+			getColorMapping(getCorrelation(i, j), hue, saturation, lightness);
 			ss << "hsl(" << hue << "," << saturation << "%," << lightness << "%)";
 			crect = grid.append_child("rect");
 			crect.append_attribute("x") = to_string(x).c_str();
@@ -990,6 +1349,9 @@ ostream& MeasureComparisonGrid::printSvgGrid(ostream& out) {
 Tool_simat::Tool_simat(void) {
 	define("r|raw=b", "output raw correlation matrix");
 	define("d|diagonal=b", "output diagonal of correlation matrix");
+	define("k|top=i:0", "list the k most similar measures for each measure");
+	define("threads=i:1", "number of threads for the similarity grid of each file");
+	defineThreadOption();
 }
 
 
@@ -1070,9 +1432,25 @@ bool Tool_simat::run(HumdrumFile& infile1, HumdrumFile& infile2) {
 //
 
 void Tool_simat::processFile(HumdrumFile& infile1, HumdrumFile& infile2) {
+	m_data1.clear();
+	m_data2.clear();
 	m_data1.parse(infile1);
-	m_data2.parse(infile2);
-	m_grid.analyze(m_data1, m_data2);
+	MeasureDataSet* data2 = &m_data1;
+	if (&infile1 != &infile2) {
+		m_data2.parse(infile2);
+		data2 = &m_data2;
+	}
+	int threads = getThreadCount("threads");
+
+	if (getInteger("top") > 0) {
+		m_grid.analyzeTopMatches(m_data1, *data2, getInteger("top"),
+				&infile1 == &infile2, threads);
+		m_grid.printTopMatches(m_free_text);
+		suppressHumdrumFileOutput();
+		return;
+	}
+
+	m_grid.analyze(m_data1, *data2, threads);
 	if (getBoolean("raw")) {
 		m_grid.printCorrelationGrid(m_free_text);
 		suppressHumdrumFileOutput();
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Fri Jul  6 00:05:27 CEST 2018
-// Last Modified: Fri Jul  6 22:06:26 CEST 2018
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-slurcheck.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-slurcheck.cpp
 // Syntax:        C++11; humlib
@@ -32,6 +32,7 @@ Tool_slurcheck::Tool_slurcheck(void) {
 	define("c|count=b", "count unclosed slur endings");
 	define("Z|no-zeros=b", "do not list files that have zero unclosed slurs in counts");
 	define("f|filename=b", "print filename for list and count options");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Oct 16 21:44:03 PDT 2000
-// Last Modified: Fri Jun 14 11:45:17 CEST 2019 Updated for humlib.
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      src/tool-spinetrace.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-spinetrace.cpp
 // Syntax:        C++11; humlib
@@ -26,6 +26,7 @@ namespace hum {
 Tool_spinetrace::Tool_spinetrace(void) {
 	define("a|append=b", "append analysis to input data lines");
 	define("p|prepend=b", "prepend analysis to input data lines");
+	defineThreadOption();
 }
 
 
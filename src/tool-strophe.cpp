@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Oct 21 21:18:45 PDT 2020
-// Last Modified: Wed Oct 21 21:18:49 PDT 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-strophe.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-strophe.cpp
 // Syntax:        C++11; humlib
@@ -31,6 +31,7 @@ Tool_strophe::Tool_strophe(void) {
 	define("m=b",              "mark strophe music");
 	define("mark|marker=s:@",  "character to mark with");
 	define("c|color=s:red",    "character to mark with");
+	defineThreadOption();
 }
 
 
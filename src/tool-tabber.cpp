@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Jun 12 12:08:10 CEST 2019
-// Last Modified: Wed Jun 12 12:08:13 CEST 2019
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-tabber.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-tabber.cpp
 // Syntax:        C++11; humlib
@@ -28,6 +28,7 @@ namespace hum {
 Tool_tabber::Tool_tabber(void) {
 	// do nothing for now.
 	define("r|remove=b",    "remove any extra tabs");
+	defineThreadOption();
 }
 
 
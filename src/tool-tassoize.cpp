@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Wed Oct 18 13:40:23 PDT 2017
-// Last Modified: Wed Oct 18 13:40:26 PDT 2017
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-tassoize.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-tassoize.cpp
 // Syntax:        C++11; humlib
@@ -49,6 +49,7 @@ Tool_tassoize::Tool_tassoize(void) {
 
 	define("N|do-not-remove-empty-transpositions=b", "Do not remove empty transposition instructions");
 	define ("n|only-remove-empty-transpositions=b", "Only remove empty transpositions");
+	defineThreadOption();
 }
 
 
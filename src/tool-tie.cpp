@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Thu Jul 16 17:58:16 PDT 2020
-// Last Modified: Thu Jul 16 19:05:13 PDT 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-tie.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-tie.cpp
 // Syntax:        C++11; humlib
@@ -42,6 +42,7 @@ Tool_tie::Tool_tie(void) {
 	define("p|printable=b", "merge tied notes only if single note is a printable note.");
 	define("M|mark=b", "Mark overfill notes.");
 	define("i|invisible=b", "Mark overfill barlines invisible.");
+	defineThreadOption();
 }
 
 
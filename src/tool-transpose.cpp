@@ -63,6 +63,7 @@ Tool_transpose::Tool_transpose(void) {
 	define("version=b",  "compilation info");
 	define("example=b",  "example usages");
 	define("help=b",     "short description");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Oct 13 11:41:16 PDT 2019
-// Last Modified: Tue Jul 21 09:33:26 PDT 2020
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-tremolo.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/src/tool-tremolo.cpp
 // Syntax:        C++11; humlib
@@ -30,6 +30,7 @@ Tool_tremolo::Tool_tremolo(void) {
 	define("k|keep=b", "Keep tremolo rhythm markup");
 	define("F|no-fill=b", "Do not fill in tremolo spaces");
 	define("T|no-tremolo-interpretation=b", "Do not add *tremolo/*Xtremolo marks");
+	defineThreadOption();
 }
 
 
@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sat Aug 25 14:12:42 PDT 2018
-// Last Modified: Sat Aug 25 19:47:08 PDT 2018
+// Last Modified: Sun Oct 18 10:29:23 UTC 2026
 // Filename:      tool-trillspell.cpp
 // URL:           https://github.com/craigsapp/humlib/blob/master/include/tool-trillspell.cpp
 // Syntax:        C++11; humlib
@@ -33,6 +33,7 @@ namespace hum {
 
 Tool_trillspell::Tool_trillspell(void) {
 	define("x=b", "mark trills with x (interpretation)");
+	defineThreadOption();
 }
 
 
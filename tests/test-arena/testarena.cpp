@@ -0,0 +1,76 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 10:39:33 UTC 2026
+// Last Modified: Sun Oct 18 10:47:20 UTC 2026
+// Filename:      testarena.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/tests/test-arena/testarena.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Check that the memory blocks of a HumGrid's slices,
+//                parts, staves and voices are freed when the grid is
+//                deleted, even though the file which received its tokens
+//                is still in use.  The blocks of the tokens, which were
+//                moved into the file, are freed when the file is cleared.
+//
+// Options:       -n count  Number of quarter notes in the grid, placed in
+//                          4/4 measures (default 2000).
+//
+
+#include "humlib.h"
+
+using namespace std;
+using namespace hum;
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:2000", "number of notes in the grid");
+	options.process(argc, argv);
+	int count = options.getInteger("count");
+
+	int retired = HumArena::getRetiredBlockCount();
+	HumdrumFile outfile;
+	int gridblocks = 0;
+	int tokenblocks = 0;
+	{
+		HumGrid grid;
+		grid.setVerseCount(0, 0, 1);
+		HumArena* oldarena = HumArena::setActive(grid.getArena());
+		GridMeasure* measure = NULL;
+		for (int i=0; i<count; i++) {
+			if (i % 4 == 0) {
+				measure = grid.addMeasureToBack();
+				measure->setTimestamp(i);
+				measure->setDuration(4);
+				measure->setTimeSigDur(4);
+			}
+			GridSlice* slice = measure->addDataToken("4c", i, 0, 0, 0, 1);
+			slice->at(0)->at(0)->setVerse(0, "la");
+		}
+		grid.transferTokens(outfile);
+		HumArena::setActive(oldarena);
+		gridblocks = grid.getArena()->getBlockCount();
+		tokenblocks = grid.getArena()->getTokenArena()->getBlockCount();
+	}
+	outfile.analyzeFromTokens();
+
+	cout << "grid blocks: " << (gridblocks > 1 ? "several" : "one") << endl;
+	cout << "grid blocks alive after deleting the grid: "
+	     << HumArena::getRetiredBlockCount() - retired - tokenblocks << endl;
+	cout << "token blocks alive after deleting the grid: "
+	     << (HumArena::getRetiredBlockCount() - retired == tokenblocks ?
+	     "all" : "not all") << endl;
+	cout << "output lines: " << outfile.getLineCount() << endl;
+	for (int i=0; i<outfile.getLineCount(); i++) {
+		if (outfile[i].isData()) {
+			cout << "first data line: " << outfile[i] << endl;
+			break;
+		}
+	}
+
+	outfile.clear();
+	cout << "blocks alive after clearing the file: "
+	     << HumArena::getRetiredBlockCount() - retired << endl;
+
+	return 0;
+}
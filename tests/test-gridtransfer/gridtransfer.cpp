@@ -0,0 +1,193 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 10:49:37 UTC 2026
+// Last Modified: Sun Oct 18 16:20:41 UTC 2026
+// Filename:      gridtransfer.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/tests/test-gridtransfer/gridtransfer.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Compare two ways of getting an analyzed HumdrumFile from
+//                a HumGrid: HumdrumFileStructure::analyzeFromTokens() on
+//                the lines made by HumGrid::transferTokens(), and printing
+//                those lines and reading the text again.  Both files must
+//                print the same and have the same start times and
+//                durations for all lines and tokens.
+//
+// Options:       -p parts     Number of parts (default 4).
+//                -m measures  Number of 4/4 measures (default 200).
+//                -r repeats   Number of times to run each method (default 1).
+//                -t           Print the average time of each method.
+//
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace std;
+using namespace hum;
+
+void   buildGrid     (HumGrid& grid, int parts, int measures);
+bool   sameTiming    (HumdrumFile& infile1, HumdrumFile& infile2);
+double getSeconds    (chrono::steady_clock::time_point start);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("p|parts=i:4", "number of parts");
+	options.define("m|measures=i:200", "number of 4/4 measures");
+	options.define("r|repeats=i:1", "number of times to run each method");
+	options.define("t|time=b", "print the average time of each method");
+	options.process(argc, argv);
+	int parts    = options.getInteger("parts");
+	int measures = options.getInteger("measures");
+	int repeats  = options.getInteger("repeats");
+
+	double transfertime = 0.0;
+	double tokentime    = 0.0;
+	double texttime     = 0.0;
+	string tokenoutput;
+	string textoutput;
+	HumNum tokenduration;
+	HumNum textduration;
+	bool sametiming = true;
+
+	for (int r=0; r<repeats; r++) {
+		// Convert the grid and analyze the tokens directly:
+		auto start = chrono::steady_clock::now();
+		HumdrumFile tokenfile;
+		{
+			HumGrid grid;
+			HumArena* oldarena = HumArena::setActive(grid.getArena());
+			buildGrid(grid, parts, measures);
+			grid.transferTokens(tokenfile);
+			HumArena::setActive(oldarena);
+		}
+		transfertime += getSeconds(start);
+		tokenfile.analyzeFromTokens();
+		tokentime += getSeconds(start);
+		stringstream tokenstream;
+		tokenstream << tokenfile;
+		tokenoutput = tokenstream.str();
+		tokenduration = tokenfile.getScoreDuration();
+
+		// Convert the grid, print it and read the text again:
+		start = chrono::steady_clock::now();
+		HumdrumFile textfile;
+		{
+			HumdrumFile outfile;
+			HumGrid grid;
+			HumArena* oldarena = HumArena::setActive(grid.getArena());
+			buildGrid(grid, parts, measures);
+			grid.transferTokens(outfile);
+			HumArena::setActive(oldarena);
+			stringstream textstream;
+			for (int i=0; i<outfile.getLineCount(); i++) {
+				outfile[i].createLineFromTokens();
+				textstream << outfile[i] << "\n";
+			}
+			textfile.readString(textstream.str());
+		}
+		texttime += getSeconds(start);
+		stringstream textstream;
+		textstream << textfile;
+		textoutput = textstream.str();
+		textduration = textfile.getScoreDuration();
+		sametiming &= sameTiming(tokenfile, textfile);
+	}
+
+	cout << "lines: " << count(tokenoutput.begin(), tokenoutput.end(), '\n') << endl;
+	cout << "same text: " << (tokenoutput == textoutput ? "yes" : "no") << endl;
+	cout << "score duration: " << tokenduration << " " << textduration << endl;
+	cout << "same timing: " << (sametiming ? "yes" : "no") << endl;
+
+	if (options.getBoolean("time")) {
+		cout << "transfer:                     " << transfertime / repeats << " s" << endl;
+		cout << "transfer + analyzeFromTokens: " << tokentime / repeats << " s" << endl;
+		cout << "transfer + print + read:      " << texttime / repeats << " s" << endl;
+	}
+
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// buildGrid -- Fill the grid with a scale in quarter notes for the even
+//    parts and in eighth, eighth, quarter and half notes for the odd parts,
+//    so that some lines have null tokens in the even parts.
+//
+
+void buildGrid(HumGrid& grid, int parts, int measures) {
+	vector<string> pitches = {"c", "d", "e", "f", "g", "a", "b", "cc"};
+	vector<string> recips = {"8", "8", "4", "2"};
+	vector<HumNum> onsets = {0, HumNum(1, 2), 1, 2};
+	vector<HumNum> durations = {HumNum(1, 2), HumNum(1, 2), 1, 2};
+	for (int m=0; m<measures; m++) {
+		GridMeasure* measure = grid.addMeasureToBack();
+		measure->setTimestamp(4 * m);
+		measure->setDuration(4);
+		measure->setTimeSigDur(4);
+		for (int b=0; b<4; b++) {
+			for (int p=0; p<parts; p++) {
+				string pitch = pitches[(4 * m + b + p) % pitches.size()];
+				GridSlice* slice;
+				HumNum duration;
+				if (p % 2) {
+					slice = measure->addDataToken(recips[b] + pitch, onsets[b] + 4 * m,
+							p, 0, 0, parts);
+					duration = durations[b];
+				} else {
+					slice = measure->addDataToken("4" + pitch, 4 * m + b, p, 0, 0, parts);
+					duration = 1;
+				}
+				slice->at(p)->at(0)->at(0)->setDuration(duration);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// sameTiming -- Return true if the lines of the two files have the same
+//    start times, durations and durations from/to barlines, and their
+//    tokens have the same durations.
+//
+
+bool sameTiming(HumdrumFile& infile1, HumdrumFile& infile2) {
+	if (infile1.getLineCount() != infile2.getLineCount()) {
+		return false;
+	}
+	for (int i=0; i<infile1.getLineCount(); i++) {
+		HumdrumLine& line1 = infile1[i];
+		HumdrumLine& line2 = infile2[i];
+		if ((line1.getDurationFromStart() != line2.getDurationFromStart())
+				|| (line1.getDuration() != line2.getDuration())
+				|| (line1.getDurationFromBarline() != line2.getDurationFromBarline())
+				|| (line1.getDurationToBarline() != line2.getDurationToBarline())
+				|| (line1.getFieldCount() != line2.getFieldCount())) {
+			return false;
+		}
+		for (int j=0; j<line1.getFieldCount(); j++) {
+			if (line1.token(j)->getDuration() != line2.token(j)->getDuration()) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// getSeconds -- Return the time in seconds since the start time.
+//
+
+double getSeconds(chrono::steady_clock::time_point start) {
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
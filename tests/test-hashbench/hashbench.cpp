@@ -0,0 +1,228 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 18:14:48 UTC 2026
+// Last Modified: Sun Oct 18 18:14:48 UTC 2026
+// Filename:      hashbench.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/tests/test-hashbench/hashbench.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Benchmark for HumHash parameters.  The accidental, slur,
+//                tie and rest analyses are run on the input files, which
+//                store "auto" parameters in the tokens, and the heap memory
+//                which they allocate and keep is measured.  Then parameters
+//                are set and read in a list of hashes, and read from one
+//                hash with eight parameters.  The values read must be the
+//                ones set.
+//
+// Options:       -n count     Number of hashes for set/get (default 20000).
+//                -r repeats   Number of times to run set/get (default 1).
+//                -t           Print the average time of set/get and the
+//                             heap memory used for parameters.
+//
+
+#include "humlib.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+using namespace hum;
+
+// Heap usage of the program, counted by the global operator new.  The
+// size of each allocation is stored in front of it so that operator delete
+// can subtract it from the bytes in use:
+static size_t s_bytes = 0;
+static size_t s_inuse = 0;
+static size_t s_allocations = 0;
+static const size_t s_header = alignof(std::max_align_t);
+
+void* operator new(size_t size) {
+	s_bytes += size;
+	s_inuse += size;
+	s_allocations++;
+	char* output = (char*)malloc(size + s_header);
+	if (output == NULL) {
+		throw std::bad_alloc();
+	}
+	*(size_t*)output = size;
+	return output + s_header;
+}
+
+void operator delete(void* pointer) noexcept {
+	if (pointer == NULL) {
+		return;
+	}
+	char* start = (char*)pointer - s_header;
+	s_inuse -= *(size_t*)start;
+	free(start);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	operator delete(pointer);
+}
+
+bool   setAndGet      (int count, double& settime, double& gettime);
+bool   getFromOne     (int count, double& gettime);
+double getSeconds     (chrono::steady_clock::time_point start);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:20000", "number of hashes for set/get");
+	options.define("r|repeats=i:1", "number of times to run set/get");
+	options.define("t|time=b", "print the average time of set/get");
+	options.process(argc, argv);
+	int count   = options.getInteger("count");
+	int repeats = options.getInteger("repeats");
+
+	int tokencount = 0;
+	int paramcount = 0;
+	size_t analysisbytes = 0;
+	size_t analysisinuse = 0;
+	size_t analysisallocations = 0;
+	double analysistime = 0.0;
+	for (int i=1; i<=options.getArgCount(); i++) {
+		HumdrumFile infile;
+		if (!infile.read(options.getArg(i))) {
+			cout << options.getArg(i) << ": " << infile.getParseError() << endl;
+			continue;
+		}
+		size_t bytes = s_bytes;
+		size_t inuse = s_inuse;
+		size_t allocations = s_allocations;
+		auto start = chrono::steady_clock::now();
+		infile.analyzeKernAccidentals();
+		infile.analyzeSlurs();
+		infile.analyzeKernTies();
+		infile.analyzeRestPositions();
+		analysistime += getSeconds(start);
+		analysisbytes += s_bytes - bytes;
+		analysisinuse += s_inuse - inuse;
+		analysisallocations += s_allocations - allocations;
+		for (int j=0; j<infile.getLineCount(); j++) {
+			for (int k=0; k<infile[j].getFieldCount(); k++) {
+				tokencount++;
+				if (infile.token(j, k)->hasParameters()) {
+					paramcount++;
+				}
+			}
+		}
+	}
+
+	double settime = 0.0;
+	double gettime = 0.0;
+	double onetime = 0.0;
+	bool same = true;
+	for (int r=0; r<repeats; r++) {
+		same &= setAndGet(count, settime, gettime);
+		same &= getFromOne(count * 8, onetime);
+	}
+
+	cout << "tokens: " << tokencount << endl;
+	cout << "tokens with parameters: " << paramcount << endl;
+	cout << "hashes: " << count << endl;
+	cout << "same values: " << (same ? "yes" : "no") << endl;
+
+	if (options.getBoolean("time")) {
+		cout << "analysis:                     " << analysistime << " s" << endl;
+		cout << "allocated by the analysis:    " << analysisbytes << " bytes in "
+		     << analysisallocations << " allocations" << endl;
+		cout << "kept after the analysis:      " << analysisinuse << " bytes" << endl;
+		if (paramcount) {
+			cout << "kept per token with params:   "
+			     << analysisinuse / paramcount << " bytes" << endl;
+		}
+		cout << "4 set per hash:               " << settime / repeats << " s" << endl;
+		cout << "8 isDefined, 8 get per hash:  " << gettime / repeats << " s" << endl;
+		cout << "get from an 8-entry hash:     " << onetime / repeats << " s" << endl;
+	}
+
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// setAndGet -- Set four parameters in each of count hashes, then check
+//    eight keys (four of which are defined) in each hash and read their
+//    values.  Returns true if all values read are the ones set.
+//
+
+bool setAndGet(int count, double& settime, double& gettime) {
+	vector<HumHash> hashes(count);
+	auto start = chrono::steady_clock::now();
+	for (int i=0; i<count; i++) {
+		hashes[i].setValue("auto", "accidental", "n");
+		hashes[i].setValue("auto", "tieStart", "true");
+		hashes[i].setValue("auto", "slurEnd", i % 100);
+		hashes[i].setValue("LO", "N", "vis", "4");
+	}
+	settime += getSeconds(start);
+
+	bool output = true;
+	vector<string> keys = {"accidental", "tieStart", "slurEnd", "vis",
+			"tieEnd", "slurStart", "cautionary", "ignore"};
+	start = chrono::steady_clock::now();
+	for (int i=0; i<count; i++) {
+		for (int k=0; k<(int)keys.size(); k++) {
+			bool defined = (k == 3) ? hashes[i].isDefined("LO", "N", keys[k])
+					: hashes[i].isDefined("auto", keys[k]);
+			string value = (k == 3) ? hashes[i].getValue("LO", "N", keys[k])
+					: hashes[i].getValue("auto", keys[k]);
+			if (defined != (k < 4)) {
+				output = false;
+			}
+			if ((k == 0) && (value != "n")) {
+				output = false;
+			} else if ((k == 2) && (value != to_string(i % 100))) {
+				output = false;
+			} else if ((k >= 4) && !value.empty()) {
+				output = false;
+			}
+		}
+	}
+	gettime += getSeconds(start);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// getFromOne -- Read count values from one hash with eight parameters.
+//    Returns true if all values read are the ones set.
+//
+
+bool getFromOne(int count, double& gettime) {
+	HumHash hash;
+	vector<string> keys;
+	for (int i=0; i<8; i++) {
+		keys.push_back("key" + to_string(i));
+		hash.setValue("auto", keys.back(), i);
+	}
+	bool output = true;
+	auto start = chrono::steady_clock::now();
+	for (int i=0; i<count; i++) {
+		if (hash.getValueInt("auto", keys[i % 8]) != i % 8) {
+			output = false;
+		}
+	}
+	gettime += getSeconds(start);
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// getSeconds -- Return the time since start in seconds.
+//
+
+double getSeconds(chrono::steady_clock::time_point start) {
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
@@ -0,0 +1,278 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:52:40 UTC 2026
+// Last Modified: Sun Oct 18 17:52:40 UTC 2026
+// Filename:      mxmlbench.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/tests/test-mxmlbench/mxmlbench.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Benchmark for converting large MusicXML files with
+//                musicxml2hum.  A partwise score with the given number of
+//                parts and 4/4 measures (with a second voice, chords,
+//                lyrics, harmony and dynamics) is generated and written to
+//                a temporary file, or a MusicXML file is given as an
+//                argument.  The file is converted after parsing the whole
+//                document and measure by measure with --stream, and both
+//                conversions must give the same Humdrum data.  Since the
+//                peak memory use is measured for the whole process, use
+//                -d or -s to run only one of the conversions.
+//
+// Options:       -p parts     Number of parts (default 4).
+//                -m measures  Number of 4/4 measures (default 200).
+//                -r repeats   Number of times to convert the file (default 1).
+//                -t           Print the average time of each method and the
+//                             peak memory use.
+//                -d           Only convert after parsing the whole document.
+//                -s           Only convert with --stream.
+//                -g           Print the generated score and exit.
+//
+
+#include "humlib.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+using namespace std;
+using namespace hum;
+
+string makeScore      (int parts, int measures);
+void   printNote      (ostream& out, int p, int m, int n, const string& type,
+                       int duration, bool chord, int voice);
+double convertFile    (const string& filename, bool stream, string& output);
+long   getPeakMemory  (void);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("p|parts=i:4", "number of parts");
+	options.define("m|measures=i:200", "number of 4/4 measures");
+	options.define("r|repeats=i:1", "number of times to convert the file");
+	options.define("t|time=b", "print the average time of each method");
+	options.define("d|dom=b", "only convert after parsing the whole document");
+	options.define("s|stream=b", "only convert with --stream");
+	options.define("g|generate=b", "print the generated score and exit");
+	options.process(argc, argv);
+	int parts    = options.getInteger("parts");
+	int measures = options.getInteger("measures");
+	int repeats  = options.getInteger("repeats");
+	bool domQ    = !options.getBoolean("stream");
+	bool streamQ = !options.getBoolean("dom");
+
+	string filename;
+	bool generated = false;
+	if (options.getArgCount() > 0) {
+		filename = options.getArg(1);
+	} else {
+		string score = makeScore(parts, measures);
+		if (options.getBoolean("generate")) {
+			cout << score;
+			return 0;
+		}
+		filename = "mxmlbench-" + to_string(getpid()) + ".musicxml";
+		ofstream out(filename, std::ios::binary);
+		out << score;
+		out.close();
+		generated = true;
+	}
+
+	double domtime    = 0.0;
+	double streamtime = 0.0;
+	string domoutput;
+	string streamoutput;
+	for (int r=0; r<repeats; r++) {
+		if (domQ) {
+			domtime += convertFile(filename, false, domoutput);
+		}
+		if (streamQ) {
+			streamtime += convertFile(filename, true, streamoutput);
+		}
+	}
+	if (generated) {
+		remove(filename.c_str());
+	}
+
+	const string& output = domQ ? domoutput : streamoutput;
+	cout << "lines: " << count(output.begin(), output.end(), '\n') << endl;
+	if (domQ && streamQ) {
+		cout << "same output: " << (domoutput == streamoutput ? "yes" : "no")
+		     << endl;
+	}
+
+	if (options.getBoolean("time")) {
+		if (domQ) {
+			cout << "convert (document): " << domtime / repeats << " s" << endl;
+		}
+		if (streamQ) {
+			cout << "convert (--stream): " << streamtime / repeats << " s" << endl;
+		}
+		cout << "peak memory: " << getPeakMemory() << " kB" << endl;
+	}
+
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// makeScore -- Generate a partwise MusicXML score.  The first part has
+//    lyrics, harmony, and a second voice in every fourth measure, and
+//    the other parts have chords and dynamics.
+//
+
+string makeScore(int parts, int measures) {
+	vector<vector<pair<string, int>>> rhythms = {
+		{{"quarter", 4}, {"quarter", 4}, {"quarter", 4}, {"quarter", 4}},
+		{{"eighth", 2}, {"eighth", 2}, {"quarter", 4}, {"half", 8}},
+		{{"half", 8}, {"quarter", 4}, {"16th", 1}, {"16th", 1}, {"eighth", 2}},
+		{{"whole", 16}}
+	};
+	vector<string> kinds = {"major", "minor", "dominant", "major-seventh"};
+	vector<string> dynamics = {"p", "mf", "f", "pp"};
+
+	stringstream out;
+	out << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
+	out << "<!DOCTYPE score-partwise PUBLIC \"-//Recordare//DTD MusicXML 3.1 "
+	    << "Partwise//EN\" \"http://www.musicxml.org/dtds/partwise.dtd\">\n";
+	out << "<score-partwise version=\"3.1\">\n";
+	out << "  <work>\n    <work-title>mxmlbench</work-title>\n  </work>\n";
+	out << "  <part-list>\n";
+	for (int p=0; p<parts; p++) {
+		out << "    <score-part id=\"P" << p + 1 << "\">\n";
+		out << "      <part-name>Part " << p + 1 << "</part-name>\n";
+		out << "    </score-part>\n";
+	}
+	out << "  </part-list>\n";
+
+	for (int p=0; p<parts; p++) {
+		out << "  <part id=\"P" << p + 1 << "\">\n";
+		for (int m=0; m<measures; m++) {
+			out << "    <measure number=\"" << m + 1 << "\">\n";
+			if (m == 0) {
+				out << "      <attributes>\n";
+				out << "        <divisions>4</divisions>\n";
+				out << "        <key><fifths>0</fifths></key>\n";
+				out << "        <time><beats>4</beats><beat-type>4</beat-type></time>\n";
+				if (p == parts - 1) {
+					out << "        <clef><sign>F</sign><line>4</line></clef>\n";
+				} else {
+					out << "        <clef><sign>G</sign><line>2</line></clef>\n";
+				}
+				out << "      </attributes>\n";
+			}
+			if ((p > 0) && (m % 8 == 0)) {
+				out << "      <direction placement=\"below\">\n";
+				out << "        <direction-type><dynamics><"
+				    << dynamics[(m / 8) % dynamics.size()]
+				    << "/></dynamics></direction-type>\n";
+				out << "      </direction>\n";
+			}
+			if (p == 0) {
+				out << "      <harmony>\n";
+				out << "        <root><root-step>" << "CDEFGAB"[m % 7]
+				    << "</root-step></root>\n";
+				out << "        <kind>" << kinds[m % kinds.size()] << "</kind>\n";
+				out << "      </harmony>\n";
+			}
+			vector<pair<string, int>>& rhythm = rhythms[(m + p) % rhythms.size()];
+			for (int n=0; n<(int)rhythm.size(); n++) {
+				printNote(out, p, m, n, rhythm[n].first, rhythm[n].second,
+						false, 1);
+				if ((p > 0) && ((m + n) % 3 == 0)) {
+					printNote(out, p, m, n + 2, rhythm[n].first,
+							rhythm[n].second, true, 1);
+				}
+			}
+			if ((p == 0) && (m % 4 == 0)) {
+				out << "      <backup><duration>16</duration></backup>\n";
+				for (int n=0; n<2; n++) {
+					printNote(out, p, m, n + 5, "half", 8, false, 2);
+				}
+			}
+			out << "    </measure>\n";
+		}
+		out << "  </part>\n";
+	}
+	out << "</score-partwise>\n";
+	return out.str();
+}
+
+
+
+//////////////////////////////
+//
+// printNote -- Print a note of the generated score.  Notes in the first
+//    voice of the first part have lyrics.
+//
+
+void printNote(ostream& out, int p, int m, int n, const string& type,
+		int duration, bool chord, int voice) {
+	int step = (m * 3 + n * 2 + p * 5) % 7;
+	int octave = 5 - p % 3 - (voice == 2 ? 1 : 0);
+	out << "      <note>\n";
+	if (chord) {
+		out << "        <chord/>\n";
+	}
+	out << "        <pitch><step>" << "CDEFGAB"[step] << "</step><octave>"
+	    << octave << "</octave></pitch>\n";
+	out << "        <duration>" << duration << "</duration>\n";
+	out << "        <voice>" << voice << "</voice>\n";
+	out << "        <type>" << type << "</type>\n";
+	if ((p == 0) && (voice == 1) && !chord) {
+		out << "        <lyric number=\"1\"><syllabic>single</syllabic>"
+		    << "<text>la" << (m + n) % 10 << "</text></lyric>\n";
+	}
+	out << "      </note>\n";
+}
+
+
+
+//////////////////////////////
+//
+// convertFile -- Convert the file to Humdrum data with musicxml2hum.
+//    Returns the time taken by the conversion.
+//
+
+double convertFile(const string& filename, bool stream, string& output) {
+	auto start = chrono::steady_clock::now();
+	Tool_musicxml2hum converter;
+	vector<string> arguments = {"musicxml2hum"};
+	if (stream) {
+		arguments.push_back("--stream");
+	}
+	converter.process(arguments);
+	stringstream out;
+	bool status;
+	if (stream) {
+		status = converter.convertFile(out, filename.c_str());
+	} else {
+		pugi::xml_document infile;
+		infile.load_file(filename.c_str());
+		status = converter.convert(out, infile);
+	}
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	if (!status || converter.hasError()) {
+		converter.getError(cerr);
+		cerr << "Error converting file: " << filename << endl;
+	}
+	output = out.str();
+	return elapsed.count();
+}
+
+
+
+//////////////////////////////
+//
+// getPeakMemory -- Return the peak resident memory of the process in kB.
+//
+
+long getPeakMemory(void) {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
@@ -0,0 +1,179 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 17:20:06 UTC 2026
+// Last Modified: Sun Oct 18 17:20:06 UTC 2026
+// Filename:      numbench.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/tests/test-numbench/numbench.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Benchmark for HumNum arithmetic on the durations of real
+//                scores.  The durations of the lines and tokens of the
+//                input files are collected, then added in order (as in
+//                rhythm analysis), multiplied and divided by tuplet
+//                ratios and sorted.  The sum of the line durations must
+//                be the score duration, and the tuplet scaling must give
+//                back the original durations.  Files with durations that
+//                cannot be calculated exactly are reported as errors.
+//
+// Options:       -r repeats   Number of times to run each operation (default 1).
+//                -t           Print the average time of each operation.
+//                -e           Print the results and overflow state of
+//                             arithmetic on extreme values and exit.
+//
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace std;
+using namespace hum;
+
+void   printExtremes   (void);
+void   printResult     (const string& label, const HumNum& value);
+double getSeconds      (chrono::steady_clock::time_point start);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("r|repeats=i:1", "number of times to run each operation");
+	options.define("t|time=b", "print the average time of each operation");
+	options.define("e|extremes=b", "print arithmetic on extreme values");
+	options.process(argc, argv);
+	int repeats = options.getInteger("repeats");
+
+	if (options.getBoolean("extremes")) {
+		printExtremes();
+		return 0;
+	}
+
+	// Durations of lines (in file order) and of non-null data tokens:
+	vector<HumNum> lines;
+	vector<HumNum> tokens;
+	HumNum scoreduration = 0;
+	int filecount = 0;
+	for (int i=1; i<=options.getArgCount(); i++) {
+		HumdrumFile infile;
+		if (!infile.read(options.getArg(i))) {
+			cout << options.getArg(i) << ": " << infile.getParseError() << endl;
+			continue;
+		}
+		filecount++;
+		scoreduration += infile.getScoreDuration();
+		for (int j=0; j<infile.getLineCount(); j++) {
+			lines.push_back(infile[j].getDuration());
+			if (!infile[j].isData()) {
+				continue;
+			}
+			for (int k=0; k<infile[j].getFieldCount(); k++) {
+				HTp token = infile.token(j, k);
+				if (!token->isNull()) {
+					tokens.push_back(token->getDuration());
+				}
+			}
+		}
+	}
+
+	vector<HumNum> ratios = {HumNum(2, 3), HumNum(4, 5), HumNum(4, 6),
+			HumNum(8, 7), HumNum(3, 2)};
+	double addtime     = 0.0;
+	double scaletime   = 0.0;
+	double sorttime    = 0.0;
+	HumNum sum;
+	bool samescale = true;
+	HumNum::clearOverflow();
+	for (int r=0; r<repeats; r++) {
+		auto start = chrono::steady_clock::now();
+		sum = 0;
+		for (int i=0; i<(int)lines.size(); i++) {
+			sum += lines[i];
+		}
+		addtime += getSeconds(start);
+
+		start = chrono::steady_clock::now();
+		for (int i=0; i<(int)tokens.size(); i++) {
+			const HumNum& ratio = ratios[i % ratios.size()];
+			HumNum scaled = tokens[i] * ratio;
+			if (scaled / ratio != tokens[i]) {
+				samescale = false;
+			}
+		}
+		scaletime += getSeconds(start);
+
+		start = chrono::steady_clock::now();
+		vector<HumNum> sorted = tokens;
+		sort(sorted.begin(), sorted.end());
+		sorttime += getSeconds(start);
+	}
+
+	cout << "files: " << filecount << endl;
+	cout << "line durations: " << lines.size() << endl;
+	cout << "token durations: " << tokens.size() << endl;
+	cout << "sum of line durations: " << sum << endl;
+	cout << "score duration: " << scoreduration << endl;
+	cout << "same sum: " << (sum == scoreduration ? "yes" : "no") << endl;
+	cout << "same after scaling: " << (samescale ? "yes" : "no") << endl;
+	cout << "overflow: " << (HumNum::hasOverflow() ? "yes" : "no") << endl;
+
+	if (options.getBoolean("time")) {
+		cout << "add:              " << addtime / repeats << " s" << endl;
+		cout << "multiply, divide: " << scaletime / repeats << " s" << endl;
+		cout << "sort:             " << sorttime / repeats << " s" << endl;
+	}
+
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// printExtremes -- Print the results of arithmetic on values at the
+//    limits of int numerators and denominators.
+//
+
+void printExtremes(void) {
+	HumNum minimum(INT_MIN);
+	HumNum maximum(INT_MAX);
+	HumNum small(1, INT_MAX);
+	HumNum small2(1, INT_MAX - 1);
+
+	printResult("INT_MIN + INT_MIN", minimum + minimum);
+	printResult("INT_MIN - INT_MIN", minimum - minimum);
+	printResult("INT_MIN + 1/INT_MAX", minimum + small);
+	printResult("INT_MIN - 1/INT_MAX", minimum - small);
+	printResult("INT_MIN * INT_MIN", minimum * minimum);
+	printResult("INT_MAX + INT_MAX", maximum + maximum);
+	printResult("INT_MAX + 1", maximum + 1);
+	printResult("INT_MAX - INT_MAX", maximum - maximum);
+	printResult("1/INT_MAX + 1/(INT_MAX-1)", small + small2);
+	printResult("1/INT_MAX * 1/(INT_MAX-1)", small * small2);
+	printResult("1/INT_MAX - 1/INT_MAX", small - small);
+	printResult("1/3 + 1/5", HumNum(1, 3) + HumNum(1, 5));
+}
+
+
+
+//////////////////////////////
+//
+// printResult -- Print a result and whether its calculation overflowed.
+//    HumNum::clearOverflow() is called for the next calculation.
+//
+
+void printResult(const string& label, const HumNum& value) {
+	cout << label << " = " << value << "\toverflow: "
+	     << (HumNum::hasOverflow() ? "yes" : "no") << endl;
+	HumNum::clearOverflow();
+}
+
+
+
+//////////////////////////////
+//
+// getSeconds -- Return the time since start in seconds.
+//
+
+double getSeconds(chrono::steady_clock::time_point start) {
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
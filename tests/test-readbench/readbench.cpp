@@ -0,0 +1,214 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 15:02:11 UTC 2026
+// Last Modified: Sun Oct 18 15:02:11 UTC 2026
+// Filename:      readbench.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/tests/test-readbench/readbench.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Benchmark for reading large scores.  A score with the
+//                given number of voices and 4/4 measures is generated in
+//                memory, then read and freed repeatedly with lines and
+//                tokens allocated on the heap and from the file's arena
+//                (HumdrumFileBase::setArenaAllocation).  Both files must
+//                print the same as the generated score.
+//
+// Options:       -v voices    Number of **kern voices (default 4).
+//                -m measures  Number of 4/4 measures (default 5000).
+//                -r repeats   Number of times to read the score (default 1).
+//                -t           Print the average time of each method.
+//                -g           Print the generated score and exit.
+//
+
+#include "humlib.h"
+
+#include <chrono>
+
+using namespace std;
+using namespace hum;
+
+string makeScore   (int voices, int measures);
+double readScore   (const string& score, bool arena, string& output,
+                    int& tokens);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("v|voices=i:4", "number of **kern voices");
+	options.define("m|measures=i:5000", "number of 4/4 measures");
+	options.define("r|repeats=i:1", "number of times to read the score");
+	options.define("t|time=b", "print the average time of each method");
+	options.define("g|generate=b", "print the generated score and exit");
+	options.process(argc, argv);
+	int voices   = options.getInteger("voices");
+	int measures = options.getInteger("measures");
+	int repeats  = options.getInteger("repeats");
+
+	string score = makeScore(voices, measures);
+	if (options.getBoolean("generate")) {
+		cout << score;
+		return 0;
+	}
+
+	double heaptime  = 0.0;
+	double arenatime = 0.0;
+	string heapoutput;
+	string arenaoutput;
+	int heaptokens  = 0;
+	int arenatokens = 0;
+	for (int r=0; r<repeats; r++) {
+		heaptime  += readScore(score, false, heapoutput, heaptokens);
+		arenatime += readScore(score, true, arenaoutput, arenatokens);
+	}
+
+	cout << "lines: " << count(score.begin(), score.end(), '\n') << endl;
+	cout << "tokens: " << heaptokens << " " << arenatokens << endl;
+	cout << "same text: "
+	     << ((heapoutput == score) && (arenaoutput == score) ? "yes" : "no")
+	     << endl;
+
+	if (options.getBoolean("time")) {
+		cout << "read + free (heap):  " << heaptime / repeats << " s" << endl;
+		cout << "read + free (arena): " << arenatime / repeats << " s" << endl;
+	}
+
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// makeScore -- Generate a score with a mixture of rhythms, beams, ties,
+//    articulations and local comments in each voice so that lines have
+//    tokens of varied lengths.
+//
+
+string makeScore(int voices, int measures) {
+	vector<string> pitches = {"C", "D", "E", "F", "G", "A", "B", "c",
+			"d", "e", "f", "g", "a", "b", "cc", "dd"};
+	vector<vector<string>> rhythms = {
+		{"4", "4", "4", "4"},
+		{"8", "8", "4", "4", "4"},
+		{"4.", "8", "2"},
+		{"16", "16", "8", "4", "2"}
+	};
+	stringstream output;
+	output << "!!!COM: readbench\n";
+	for (int v=0; v<voices; v++) {
+		output << (v ? "\t" : "") << "**kern";
+	}
+	output << "\n";
+	for (int v=0; v<voices; v++) {
+		output << (v ? "\t" : "") << "*M4/4";
+	}
+	output << "\n";
+
+	for (int m=0; m<measures; m++) {
+		// Each voice uses one rhythm pattern in the measure, so list
+		// the attack times of all voices and fill in null tokens.
+		vector<vector<pair<int, string>>> notes(voices);
+		vector<int> times;
+		for (int v=0; v<voices; v++) {
+			vector<string>& rhythm = rhythms[(m + v) % rhythms.size()];
+			int time = 0;
+			for (int n=0; n<(int)rhythm.size(); n++) {
+				string token = rhythm[n];
+				token += pitches[(m * 3 + v * 5 + n * 2) % pitches.size()];
+				if ((m + n) % 7 == 0) {
+					token += "'";
+				}
+				if ((rhythm[n] == "8") || (rhythm[n] == "16")) {
+					token += (n == 0) || (rhythm[n-1] != rhythm[n]) ? "L" : "J";
+				}
+				notes[v].emplace_back(time, token);
+				times.push_back(time);
+				int dots = count(rhythm[n].begin(), rhythm[n].end(), '.');
+				int dur = 16 / stoi(rhythm[n]);
+				time += dots ? dur + dur / 2 : dur;
+			}
+			// Beamed notes which are not followed by another beamed note
+			// of the same rhythm end the beam:
+			for (int n=0; n<(int)notes[v].size(); n++) {
+				string& token = notes[v][n].second;
+				if ((token.back() == 'L') && ((n == (int)notes[v].size() - 1)
+						|| (notes[v][n+1].second.find('J') == string::npos))) {
+					token.pop_back();
+				}
+			}
+		}
+		sort(times.begin(), times.end());
+		times.erase(unique(times.begin(), times.end()), times.end());
+
+		output << "=" << (m + 1);
+		for (int v=1; v<voices; v++) {
+			output << "\t=" << (m + 1);
+		}
+		output << "\n";
+		if (m % 16 == 0) {
+			for (int v=0; v<voices; v++) {
+				output << (v ? "\t" : "") << "!phrase";
+			}
+			output << "\n";
+		}
+		vector<int> index(voices, 0);
+		for (int t=0; t<(int)times.size(); t++) {
+			for (int v=0; v<voices; v++) {
+				if (v) {
+					output << "\t";
+				}
+				if ((index[v] < (int)notes[v].size())
+						&& (notes[v][index[v]].first == times[t])) {
+					output << notes[v][index[v]++].second;
+				} else {
+					output << ".";
+				}
+			}
+			output << "\n";
+		}
+	}
+
+	output << "==";
+	for (int v=1; v<voices; v++) {
+		output << "\t==";
+	}
+	output << "\n";
+	for (int v=0; v<voices; v++) {
+		output << (v ? "\t" : "") << "*-";
+	}
+	output << "\n";
+	return output.str();
+}
+
+
+
+//////////////////////////////
+//
+// readScore -- Read the score into a HumdrumFile, print it and free it.
+//    Returns the time taken to read and free the file.
+//
+
+double readScore(const string& score, bool arena, string& output,
+		int& tokens) {
+	chrono::duration<double> elapsed(0.0);
+	auto start = chrono::steady_clock::now();
+	HumdrumFile* infile = new HumdrumFile;
+	infile->setArenaAllocation(arena);
+	infile->readStringNoRhythm(score);
+	elapsed += chrono::steady_clock::now() - start;
+
+	stringstream text;
+	text << *infile;
+	output = text.str();
+	tokens = 0;
+	for (int i=0; i<infile->getLineCount(); i++) {
+		tokens += (*infile)[i].getTokenCount();
+	}
+
+	start = chrono::steady_clock::now();
+	delete infile;
+	elapsed += chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
@@ -0,0 +1,198 @@
+//
+// Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
+// Creation Date: Sun Oct 18 18:05:31 UTC 2026
+// Last Modified: Sun Oct 18 18:05:31 UTC 2026
+// Filename:      regexbench.cpp
+// URL:           https://github.com/craigsapp/humlib/blob/master/tests/test-regexbench/regexbench.cpp
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Benchmark for the per-token cost of HumRegex.  Typical
+//                expressions used by the tools are searched for and
+//                replaced in every token of the input files in three ways:
+//                with a new HumRegex object for each call (which uses the
+//                compiled expression cache), with one HumRegex object for
+//                all calls, and with a std::regex compiled for each call
+//                (as HumRegex did before the cache).  All three must give
+//                the same results.
+//
+// Options:       -r repeats   Number of times to process the tokens (default 1).
+//                -t           Print the average time per token of each method.
+//
+
+#include "humlib.h"
+
+#include <chrono>
+#include <regex>
+
+using namespace std;
+using namespace hum;
+
+// Expressions and replacements which are similar to those used by the
+// tools when processing **kern tokens:
+static const vector<pair<string, string>> expressions = {
+	{"^\\*k\\[([a-g#-]*)\\]", "*k[]"},
+	{"([a-gA-G]+)([#n-]*)", "X"},
+	{"^=(\\d+)", "=0"},
+	{"[LJkK]+", ""},
+	{"(\\d+)(%\\d+)?(\\.*)", "4"},
+	{"[;)(]", ""}
+};
+
+long   runFresh      (const vector<string>& tokens, string& output);
+long   runReused     (const vector<string>& tokens, string& output);
+long   runStdRegex   (const vector<string>& tokens, string& output);
+double getSeconds    (chrono::steady_clock::time_point start);
+
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("r|repeats=i:1", "number of times to process the tokens");
+	options.define("t|time=b", "print the average time per token of each method");
+	options.process(argc, argv);
+	int repeats = options.getInteger("repeats");
+
+	vector<string> tokens;
+	for (int i=1; i<=options.getArgCount(); i++) {
+		HumdrumFile infile;
+		if (!infile.read(options.getArg(i))) {
+			cout << options.getArg(i) << ": " << infile.getParseError() << endl;
+			continue;
+		}
+		for (int j=0; j<infile.getLineCount(); j++) {
+			for (int k=0; k<infile[j].getFieldCount(); k++) {
+				tokens.push_back(*infile.token(j, k));
+			}
+		}
+	}
+
+	double freshtime  = 0.0;
+	double reusedtime = 0.0;
+	double stdtime    = 0.0;
+	long freshcount  = 0;
+	long reusedcount = 0;
+	long stdcount    = 0;
+	string freshoutput;
+	string reusedoutput;
+	string stdoutput;
+	for (int r=0; r<repeats; r++) {
+		auto start = chrono::steady_clock::now();
+		freshcount = runFresh(tokens, freshoutput);
+		freshtime += getSeconds(start);
+
+		start = chrono::steady_clock::now();
+		reusedcount = runReused(tokens, reusedoutput);
+		reusedtime += getSeconds(start);
+
+		start = chrono::steady_clock::now();
+		stdcount = runStdRegex(tokens, stdoutput);
+		stdtime += getSeconds(start);
+	}
+
+	cout << "tokens: " << tokens.size() << endl;
+	cout << "expressions: " << expressions.size() << endl;
+	cout << "matches: " << freshcount << endl;
+	cout << "same results: "
+	     << ((freshcount == reusedcount) && (freshcount == stdcount)
+	         && (freshoutput == reusedoutput) && (freshoutput == stdoutput)
+	         ? "yes" : "no") << endl;
+
+	if (options.getBoolean("time") && !tokens.empty()) {
+		double scale = 1e9 / repeats / tokens.size();
+		cout << "new HumRegex per call:   " << freshtime * scale << " ns/token" << endl;
+		cout << "one HumRegex:            " << reusedtime * scale << " ns/token" << endl;
+		cout << "std::regex per call:     " << stdtime * scale << " ns/token" << endl;
+	}
+
+	return 0;
+}
+
+
+
+//////////////////////////////
+//
+// runFresh -- Search and replace with a new HumRegex object for each
+//    call, as is done when a HumRegex is declared in a function which
+//    is called for each token.  Returns the number of tokens matched, and
+//    the replaced tokens are stored in output.
+//
+
+long runFresh(const vector<string>& tokens, string& output) {
+	long count = 0;
+	output.clear();
+	for (int i=0; i<(int)tokens.size(); i++) {
+		for (int j=0; j<(int)expressions.size(); j++) {
+			HumRegex hre;
+			if (hre.search(tokens[i], expressions[j].first)) {
+				count++;
+				HumRegex hre2;
+				output += hre2.replaceCopy(tokens[i], expressions[j].second,
+						expressions[j].first);
+				output += "\n";
+			}
+		}
+	}
+	return count;
+}
+
+
+
+//////////////////////////////
+//
+// runReused -- Search and replace with one HumRegex object for all
+//    calls.
+//
+
+long runReused(const vector<string>& tokens, string& output) {
+	long count = 0;
+	output.clear();
+	HumRegex hre;
+	for (int i=0; i<(int)tokens.size(); i++) {
+		for (int j=0; j<(int)expressions.size(); j++) {
+			if (hre.search(tokens[i], expressions[j].first)) {
+				count++;
+				output += hre.replaceCopy(tokens[i], expressions[j].second,
+						expressions[j].first);
+				output += "\n";
+			}
+		}
+	}
+	return count;
+}
+
+
+
+//////////////////////////////
+//
+// runStdRegex -- Search and replace with a std::regex compiled for each
+//    call.
+//
+
+long runStdRegex(const vector<string>& tokens, string& output) {
+	long count = 0;
+	output.clear();
+	for (int i=0; i<(int)tokens.size(); i++) {
+		for (int j=0; j<(int)expressions.size(); j++) {
+			regex re(expressions[j].first, regex::ECMAScript);
+			if (regex_search(tokens[i], re)) {
+				count++;
+				regex re2(expressions[j].first, regex::ECMAScript);
+				output += regex_replace(tokens[i], re2, expressions[j].second);
+				output += "\n";
+			}
+		}
+	}
+	return count;
+}
+
+
+
+//////////////////////////////
+//
+// getSeconds -- Return the time since start in seconds.
+//
+
+double getSeconds(chrono::steady_clock::time_point start) {
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}